@@ -0,0 +1,700 @@
+/*******************************************
+	BatchMain.cpp
+
+	Command line tool running full screen post-
+	process chains over image sequences
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#if defined(_WIN32)
+	#include <Windows.h>
+	#include <io.h>
+	#include <fcntl.h>
+#else
+	#include <dirent.h>
+#endif
+
+#include "Defines.h"
+#include "Image.h"
+#include "ImageIO.h"
+#include "FilterChain.h"
+#include "StripExecutor.h"
+#include "Parallel.h"
+#include "BoundedQueue.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+struct SBatchOptions
+{
+	string          Chain;            // Chain description or file
+	bool            ChainIsFile;
+	string          Input;            // Directory, or "-" for stdin
+	string          Output;           // Directory, or "-" for stdout
+	EImageFormat    InputFormat;      // Stream input format
+	EImageFormat    OutputFormat;
+	TUInt32         RawWidth;         // Size of raw input frames
+	TUInt32         RawHeight;
+	TFloat32        FrameRate;        // Animation advances by 1 / FrameRate per frame
+	TUInt32         Workers;          // Frames processed at once
+	TUInt32         QueueDepth;       // Frames waiting between each pair of stages
+	string          MapDirectory;     // Noise / Burn / Distort maps
+	vector<SRipple> Ripples;          // Centres and start times (as Time), empty for one at the frame centre
+	TFloat32        FocusCentre[2];   // FocusBlur settings, as in CFilterAnimation
+	TFloat32        FocusRadius;
+	TFloat32        FocusFalloff;
+	TUInt32         FocusBlurRadius;
+	bool            LinearLight;      // Convolution filters work in linear light
+	bool            Temporal;         // Reuse half of the pixels of expensive filters from the last frame
+	TUInt32         TemporalThreshold;
+	bool            Tiled;            // Filter in the tiled layout
+	TUInt32         StripRows;        // Filter in strips of this many rows, 0 for whole frames
+	bool            Quiet;
+
+	SBatchOptions()
+	{
+		ChainIsFile = false;
+		InputFormat = kImagePPM;
+		OutputFormat = kImageTGA;
+		RawWidth = RawHeight = 0;
+		FrameRate = 60.0f;
+		Workers = 0;
+		QueueDepth = 4;
+		FocusCentre[0] = FocusCentre[1] = -1.0f;
+		FocusRadius = FocusFalloff = 0.0f;
+		FocusBlurRadius = 16;
+		LinearLight = false;
+		Temporal = false;
+		TemporalThreshold = kTemporalThreshold;
+		Tiled = false;
+		StripRows = 0;
+		Quiet = false;
+	}
+};
+
+void PrintUsage()
+{
+	fprintf( stderr,
+		"Usage: PostProcessBatch --chain <filters> --in <dir|-> --out <dir|-> [options]\n"
+		"\n"
+		"  --chain <list>        Filters to apply in order, e.g. \"Tint,GaussianBlur,Spiral\"\n"
+		"  --chain-file <file>   Read the filter list from a file (# starts a comment)\n"
+		"  --in <dir|->          Directory of .tga / .ppm frames (sorted by name), or - for stdin\n"
+		"  --out <dir|->         Directory to write frames to (same names), or - for stdout\n"
+		"  --in-format <fmt>     Stream input format: ppm (default), tga or raw\n"
+		"  --out-format <fmt>    Output format: tga (default), ppm or raw\n"
+		"  --size <WxH>          Frame size, required for raw input\n"
+		"  --fps <rate>          Animation frame rate (default 60)\n"
+		"  --workers <n>         Frames processed in parallel (default: hardware threads)\n"
+		"  --queue <n>           Frames queued between pipeline stages (default 4)\n"
+		"  --maps <dir>          Directory holding Noise, Burn and Distort maps (.tga / .ppm)\n"
+		"  --ripple <x,y[,t]>    Ripple centre in pixels, starting t seconds into the sequence (default 0).\n"
+		"                        Repeat for up to 8 ripples at once (default: one at the frame centre)\n"
+		"  --focus <x,y>         FocusBlur sharpest point in pixels (default: the frame centre)\n"
+		"  --focus-radius <r,f>  FocusBlur is sharp within r pixels of the focus, blurring fully by f\n"
+		"                        pixels (default: a tenth and a half of the frame height)\n"
+		"  --focus-blur <n>      FocusBlur box radius in pixels where fully blurred, 0-255 (default 16)\n"
+		"  --linear-light        Sharpen, EdgeDetect and Emboss filter in linear light rather than on\n"
+		"                        the gamma encoded values. PostProcessFilterBench shows the cost\n"
+		"  --temporal <n>        Recompute half of the GaussianBlur / Distort pixels each frame, reusing\n"
+		"                        the rest where no channel changed by more than n (0-255, e.g. 8).\n"
+		"                        Frames are then filtered in order by one worker\n"
+		"  --tiled               Filter in a tiled memory layout, converting each frame on the way in and\n"
+		"                        out. Output is unchanged, PostProcessFilterBench shows if it is faster\n"
+		"  --strip <rows>        Run the chain down each frame in strips of this many rows, holding only\n"
+		"                        the rows each filter still needs between filters. Output is unchanged\n"
+		"  --quiet               No progress output\n"
+		"\n"
+		"Filters: " );
+	for (int f = 0; f < kNumFilters; ++f)
+	{
+		fprintf( stderr, "%s%s", FilterNames[f], (f + 1 < kNumFilters) ? ", " : "\n" );
+	}
+}
+
+bool ParseFormat( const char* text, EImageFormat& format )
+{
+	return ImageFormatFromPath( string( "." ) + text, format );
+}
+
+// Parse the command line. Returns false on error, having printed a message
+bool ParseOptions( int argc, char* argv[], SBatchOptions& options )
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : 0;
+		bool usedValue = true;
+		if (arg == "--quiet")
+		{
+			options.Quiet = true;
+			usedValue = false;
+		}
+		else if (arg == "--tiled")
+		{
+			options.Tiled = true;
+			usedValue = false;
+		}
+		else if (arg == "--linear-light")
+		{
+			options.LinearLight = true;
+			usedValue = false;
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		else if (!value)
+		{
+			fprintf( stderr, "Missing value for %s\n", arg.c_str() );
+			return false;
+		}
+		else if (arg == "--chain")
+		{
+			options.Chain = value;
+			options.ChainIsFile = false;
+		}
+		else if (arg == "--chain-file")
+		{
+			options.Chain = value;
+			options.ChainIsFile = true;
+		}
+		else if (arg == "--in")
+		{
+			options.Input = value;
+		}
+		else if (arg == "--out")
+		{
+			options.Output = value;
+		}
+		else if (arg == "--in-format" || arg == "--out-format")
+		{
+			if (!ParseFormat( value, (arg == "--in-format") ? options.InputFormat : options.OutputFormat ))
+			{
+				fprintf( stderr, "Unknown image format '%s'\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--size")
+		{
+			if (sscanf( value, "%ux%u", &options.RawWidth, &options.RawHeight ) != 2)
+			{
+				fprintf( stderr, "Bad size '%s', expected WxH\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--fps")
+		{
+			options.FrameRate = static_cast<TFloat32>(atof( value ));
+		}
+		else if (arg == "--workers")
+		{
+			options.Workers = static_cast<TUInt32>(atoi( value ));
+		}
+		else if (arg == "--queue")
+		{
+			options.QueueDepth = static_cast<TUInt32>(atoi( value ));
+		}
+		else if (arg == "--maps")
+		{
+			options.MapDirectory = value;
+		}
+		else if (arg == "--ripple")
+		{
+			SRipple ripple;
+			ripple.Time = 0.0f;
+			if (sscanf( value, "%f,%f,%f", &ripple.Position[0], &ripple.Position[1], &ripple.Time ) < 2 || ripple.Time < 0.0f)
+			{
+				fprintf( stderr, "Bad ripple '%s', expected x,y or x,y,t\n", value );
+				return false;
+			}
+			if (options.Ripples.size() == kMaxRipples)
+			{
+				fprintf( stderr, "At most %u ripples can be given\n", kMaxRipples );
+				return false;
+			}
+			options.Ripples.push_back( ripple );
+		}
+		else if (arg == "--focus")
+		{
+			if (sscanf( value, "%f,%f", &options.FocusCentre[0], &options.FocusCentre[1] ) != 2)
+			{
+				fprintf( stderr, "Bad focus '%s', expected x,y\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--focus-radius")
+		{
+			if (sscanf( value, "%f,%f", &options.FocusRadius, &options.FocusFalloff ) != 2 ||
+			    options.FocusRadius < 0.0f || options.FocusFalloff <= options.FocusRadius)
+			{
+				fprintf( stderr, "Bad focus radius '%s', expected r,f with 0 <= r < f\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--focus-blur")
+		{
+			options.FocusBlurRadius = static_cast<TUInt32>(atoi( value ));
+			if (options.FocusBlurRadius > 255)
+			{
+				fprintf( stderr, "--focus-blur must be 0 to 255\n" );
+				return false;
+			}
+		}
+		else if (arg == "--strip")
+		{
+			options.StripRows = static_cast<TUInt32>(atoi( value ));
+			if (options.StripRows == 0)
+			{
+				fprintf( stderr, "--strip must be positive\n" );
+				return false;
+			}
+		}
+		else if (arg == "--temporal")
+		{
+			options.Temporal = true;
+			options.TemporalThreshold = static_cast<TUInt32>(atoi( value ));
+		}
+		else
+		{
+			fprintf( stderr, "Unknown option %s\n", arg.c_str() );
+			return false;
+		}
+		if (usedValue) ++i;
+	}
+
+	if (options.Chain.empty() || options.Input.empty() || options.Output.empty())
+	{
+		fprintf( stderr, "--chain, --in and --out are required\n" );
+		return false;
+	}
+	if (options.Input == "-" && options.InputFormat == kImageRaw && (options.RawWidth == 0 || options.RawHeight == 0))
+	{
+		fprintf( stderr, "--size is required for raw input\n" );
+		return false;
+	}
+	if ((options.Temporal ? 1 : 0) + (options.Tiled ? 1 : 0) + (options.StripRows > 0 ? 1 : 0) > 1)
+	{
+		fprintf( stderr, "Only one of --temporal, --tiled and --strip can be used\n" );
+		return false;
+	}
+	if (options.FrameRate <= 0.0f)
+	{
+		fprintf( stderr, "--fps must be positive\n" );
+		return false;
+	}
+	if (options.Workers == 0)
+	{
+		options.Workers = NumWorkerThreads();
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Input and output
+//-----------------------------------------------------------------------------
+
+// Names of the frame files in a directory, sorted. Returns false if the directory can't be read
+bool ListFrames( const string& directory, vector<string>& names )
+{
+	names.clear();
+#if defined(_WIN32)
+	WIN32_FIND_DATAA findData;
+	HANDLE find = FindFirstFileA( (directory + "\\*").c_str(), &findData );
+	if (find == INVALID_HANDLE_VALUE) return false;
+	do
+	{
+		string name = findData.cFileName;
+		EImageFormat format;
+		if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && ImageFormatFromPath( name, format ) && format != kImageRaw)
+		{
+			names.push_back( name );
+		}
+	} while (FindNextFileA( find, &findData ));
+	FindClose( find );
+#else
+	DIR* dir = opendir( directory.c_str() );
+	if (!dir) return false;
+	while (dirent* entry = readdir( dir ))
+	{
+		string name = entry->d_name;
+		EImageFormat format;
+		if (name[0] != '.' && ImageFormatFromPath( name, format ) && format != kImageRaw)
+		{
+			names.push_back( name );
+		}
+	}
+	closedir( dir );
+#endif
+	sort( names.begin(), names.end() );
+	return true;
+}
+
+// Output file name for an input frame - same name with the output format's extension
+string OutputName( const string& inputName, EImageFormat format )
+{
+	const char* extensions[] = { ".tga", ".ppm", ".rgba" };
+	size_t dot = inputName.find_last_of( '.' );
+	return inputName.substr( 0, dot ) + extensions[format];
+}
+
+
+//-----------------------------------------------------------------------------
+// Pipeline
+//-----------------------------------------------------------------------------
+
+// A frame passing through the pipeline. A fixed pool of these is allocated up front and they
+// are recycled, so memory use does not depend on sequence length
+struct SFrame
+{
+	TUInt32             Index;
+	string              Name;
+	vector<SFilterStep> Steps;
+	CImage              Source;
+	CImage              Work[2];
+	CTiledImage         Tiled[2];  // Work images for the tiled layout
+	CStripExecutor      Strips;    // Line buffers for filtering in strips
+	const CImage*       Result;
+	bool                Failed;
+};
+
+// Shared state for the pipeline stages
+struct SPipeline
+{
+	const SBatchOptions*   Options;
+	const CFilterChain*    Chain;
+	vector<SFilterHistory> Histories;   // One per filter in temporal mode
+	vector<string>         InputNames;  // Empty for stream input
+	CBoundedQueue<SFrame*> FreeFrames;
+	CBoundedQueue<SFrame*> ReadFrames;
+	CBoundedQueue<SFrame*> DoneFrames;
+	TUInt32                FramesWritten;
+	atomic<bool>           Error;
+
+	SPipeline( TUInt32 poolSize, TUInt32 queueDepth, TUInt32 numFilters )
+		: Histories( numFilters ), FreeFrames( poolSize ), ReadFrames( queueDepth ), DoneFrames( poolSize )
+	{
+		FramesWritten = 0;
+		Error = false;
+	}
+};
+
+// Reader stage: decodes frames in order and attaches the filter steps for each, advancing the
+// animation per frame as UpdatePostProcesses does. Runs on its own thread
+void ReaderStage( SPipeline& pipeline )
+{
+	const SBatchOptions& options = *pipeline.Options;
+	CFilterAnimation animation;
+	const TFloat32 updateTime = 1.0f / options.FrameRate;
+	animation.FocusCentre[0] = options.FocusCentre[0];
+	animation.FocusCentre[1] = options.FocusCentre[1];
+	animation.FocusRadius = options.FocusRadius;
+	animation.FocusFalloff = options.FocusFalloff;
+	animation.FocusBlurRadius = options.FocusBlurRadius;
+	animation.LinearLight = options.LinearLight;
+
+	FILE* stream = 0;
+	if (options.Input == "-")
+	{
+		stream = stdin;
+	}
+
+	SFrame* frame;
+	for (TUInt32 index = 0; pipeline.FreeFrames.Pop( frame ); ++index)
+	{
+		bool success;
+		if (stream)
+		{
+			if (options.InputFormat == kImageRaw)
+			{
+				frame->Source.Create( options.RawWidth, options.RawHeight );
+			}
+			success = ReadImage( stream, options.InputFormat, frame->Source );
+			frame->Name.clear();
+		}
+		else
+		{
+			if (index >= pipeline.InputNames.size()) break;
+			frame->Name = pipeline.InputNames[index];
+			success = LoadImageFile( options.Input + "/" + frame->Name, frame->Source );
+			if (!success)
+			{
+				fprintf( stderr, "Failed to read %s\n", frame->Name.c_str() );
+				pipeline.Error = true;
+			}
+		}
+		if (!success) break; // End of stream or error
+
+		// The ripples start with the sequence or after their delays, one centred unless given
+		if (index == 0)
+		{
+			if (options.Ripples.empty())
+			{
+				animation.StartRipple( frame->Source.Width() * 0.5f, frame->Source.Height() * 0.5f );
+			}
+			else
+			{
+				animation.NumRipples = 0;
+				for (size_t i = 0; i < options.Ripples.size(); ++i)
+				{
+					const SRipple& ripple = options.Ripples[i];
+					animation.AddRipple( ripple.Position[0], ripple.Position[1], ripple.Time );
+				}
+			}
+		}
+		else
+		{
+			animation.Update( updateTime );
+		}
+
+		frame->Index = index;
+		frame->Failed = false;
+		pipeline.Chain->SelectSteps( animation, frame->Source.Width(), frame->Source.Height(), frame->Steps );
+		if (!pipeline.ReadFrames.Push( frame )) break;
+	}
+	pipeline.ReadFrames.Close();
+}
+
+// Filter stage: runs the chain on frames as they arrive. Several of these run at once
+void FilterStage( SPipeline& pipeline )
+{
+	SFrame* frame;
+	while (pipeline.ReadFrames.Pop( frame ))
+	{
+		if (pipeline.Options->Temporal)
+		{
+			frame->Failed = !CFilterChain::RunTemporal( frame->Steps, frame->Source, frame->Work[0], frame->Work[1], frame->Result,
+			                                            pipeline.Histories, pipeline.Options->TemporalThreshold );
+		}
+		else if (pipeline.Options->Tiled)
+		{
+			frame->Failed = !CFilterChain::RunTiled( frame->Steps, frame->Source, frame->Tiled[0], frame->Tiled[1], frame->Work[0] );
+			frame->Result = &frame->Work[0];
+		}
+		else if (pipeline.Options->StripRows > 0)
+		{
+			frame->Strips.SetStripRows( pipeline.Options->StripRows );
+			frame->Failed = !frame->Strips.Run( frame->Steps, frame->Source, frame->Work[0] );
+			frame->Result = &frame->Work[0];
+		}
+		else
+		{
+			frame->Failed = !CFilterChain::Run( frame->Steps, frame->Source, frame->Work[0], frame->Work[1], frame->Result );
+		}
+		pipeline.DoneFrames.Push( frame );
+	}
+}
+
+// Writer stage: encodes frames in sequence order, holding back any that finish early, and
+// returns them to the pool. Runs on the calling thread and reports progress
+void WriterStage( SPipeline& pipeline, TUInt32 numFilterThreads )
+{
+	const SBatchOptions& options = *pipeline.Options;
+	FILE* stream = (options.Output == "-") ? stdout : 0;
+
+	typedef chrono::steady_clock Clock;
+	Clock::time_point startTime = Clock::now();
+	Clock::time_point lastReport = startTime;
+
+	map<TUInt32, SFrame*> pending;
+	TUInt32 filtersFinished = 0;
+	SFrame* frame;
+	while (filtersFinished < numFilterThreads || !pending.empty())
+	{
+		// Write any frames that are next in sequence
+		map<TUInt32, SFrame*>::iterator next = pending.find( pipeline.FramesWritten );
+		if (next == pending.end())
+		{
+			if (filtersFinished == numFilterThreads || !pipeline.DoneFrames.Pop( frame )) break;
+			if (!frame)
+			{
+				++filtersFinished; // End marker from a filter thread
+			}
+			else
+			{
+				pending[frame->Index] = frame;
+			}
+			continue;
+		}
+		frame = next->second;
+		pending.erase( next );
+
+		bool success = !frame->Failed;
+		if (!success)
+		{
+			fprintf( stderr, "Filter chain failed on frame %u\n", frame->Index );
+		}
+		else if (stream)
+		{
+			success = WriteImage( stream, options.OutputFormat, *frame->Result );
+			if (!success) fprintf( stderr, "Failed to write frame %u to the output stream\n", frame->Index );
+		}
+		else
+		{
+			string path = options.Output + "/" + OutputName( frame->Name, options.OutputFormat );
+			success = SaveImageFile( path, *frame->Result );
+			if (!success) fprintf( stderr, "Failed to write frame %u to %s\n", frame->Index, path.c_str() );
+		}
+		if (!success)
+		{
+			pipeline.Error = true;
+			break;
+		}
+		++pipeline.FramesWritten;
+		pipeline.FreeFrames.Push( frame );
+
+		Clock::time_point now = Clock::now();
+		if (!options.Quiet && now - lastReport >= chrono::seconds( 1 ))
+		{
+			TFloat32 seconds = chrono::duration<TFloat32>( now - startTime ).count();
+			fprintf( stderr, "%u frames, %.1f fps\n", pipeline.FramesWritten, pipeline.FramesWritten / seconds );
+			lastReport = now;
+		}
+	}
+	if (stream) fflush( stream );
+
+	// Release the reader if it is waiting for a free frame after an error
+	pipeline.FreeFrames.Close();
+}
+
+
+// Run the pipeline: one reader thread, a number of filter threads and the writer on this thread
+// connected by bounded queues. Returns the process exit code
+int RunBatch( const SBatchOptions& options )
+{
+	// Chain and maps
+	CFilterChain chain;
+	string error;
+	if (!(options.ChainIsFile ? chain.LoadFile( options.Chain, error ) : chain.Parse( options.Chain, error )))
+	{
+		fprintf( stderr, "%s\n", error.c_str() );
+		return 1;
+	}
+	SFilterMaps maps;
+	LoadFilterMaps( options.MapDirectory, &chain, maps );
+	chain.SetMaps( maps );
+
+	// Frame level parallelism replaces the row parallelism inside each filter, so give each
+	// filter one thread unless there is only one frame worker. Temporal filtering needs each
+	// frame's predecessor, so frames are filtered in order by one worker
+	TUInt32 workers = options.Temporal ? 1 : options.Workers;
+	if (workers > 1)
+	{
+		SetNumWorkerThreads( 1 );
+	}
+
+	// Enough frames for every queue slot and every stage to hold one
+	const TUInt32 poolSize = options.QueueDepth * 2 + workers + 2;
+	SPipeline pipeline( poolSize, options.QueueDepth, options.Temporal ? static_cast<TUInt32>(chain.Filters().size()) : 0 );
+	pipeline.Options = &options;
+	pipeline.Chain = &chain;
+	if (options.Input != "-")
+	{
+		if (!ListFrames( options.Input, pipeline.InputNames ))
+		{
+			fprintf( stderr, "Cannot read input directory '%s'\n", options.Input.c_str() );
+			return 1;
+		}
+	}
+#if defined(_WIN32)
+	if (options.Input == "-")  _setmode( _fileno( stdin ), _O_BINARY );
+	if (options.Output == "-") _setmode( _fileno( stdout ), _O_BINARY );
+#endif
+
+	vector<SFrame> frames( poolSize );
+	for (TUInt32 i = 0; i < poolSize; ++i)
+	{
+		pipeline.FreeFrames.Push( &frames[i] );
+	}
+
+	chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+	thread reader( ReaderStage, ref( pipeline ) );
+	vector<thread> filters;
+	for (TUInt32 i = 0; i < workers; ++i)
+	{
+		filters.push_back( thread( [&pipeline]()
+		{
+			FilterStage( pipeline );
+			pipeline.DoneFrames.Push( 0 ); // End marker for the writer
+		}));
+	}
+	WriterStage( pipeline, workers );
+
+	// On error the writer stops early, so unblock the other stages before joining
+	pipeline.ReadFrames.Close();
+	pipeline.DoneFrames.Close();
+	reader.join();
+	for (size_t i = 0; i < filters.size(); ++i)
+	{
+		filters[i].join();
+	}
+
+	TFloat32 seconds = chrono::duration<TFloat32>( chrono::steady_clock::now() - startTime ).count();
+	if (!options.Quiet || pipeline.Error)
+	{
+		fprintf( stderr, "Processed %u frames in %.2fs: %.1f fps (%u workers, %u filters)\n",
+		         pipeline.FramesWritten, seconds, (seconds > 0.0f) ? pipeline.FramesWritten / seconds : 0.0f,
+		         workers, static_cast<TUInt32>(chain.Filters().size()) );
+	}
+	if (!options.Quiet && options.StripRows > 0 && pipeline.FramesWritten > 0)
+	{
+		// Compared with the second work image that whole-frame filtering would need (the result
+		// takes the place of the first)
+		size_t ringBytes = 0, frameBytes = 0;
+		for (TUInt32 i = 0; i < poolSize; ++i)
+		{
+			ringBytes = max( ringBytes, frames[i].Strips.RingBytes() );
+			frameBytes = max( frameBytes, static_cast<size_t>(frames[i].Work[0].Pitch()) * frames[i].Work[0].Height() );
+		}
+		fprintf( stderr, "Strip line buffers: %.1fKB per frame in flight, a whole work image is %.1fKB\n",
+		         ringBytes / 1024.0, frameBytes / 1024.0 );
+	}
+	if (!options.Quiet && options.Temporal)
+	{
+		TUInt64 computed = 0, reused = 0, rejected = 0;
+		for (size_t i = 0; i < pipeline.Histories.size(); ++i)
+		{
+			computed += pipeline.Histories[i].PixelsComputed;
+			reused += pipeline.Histories[i].PixelsReused;
+			rejected += pipeline.Histories[i].PixelsRejected;
+		}
+		TUInt64 total = computed + reused + rejected;
+		if (total > 0)
+		{
+			fprintf( stderr, "Temporal filters: %.1f%% of pixels reused, %.1f%% rejected\n",
+			         100.0 * reused / total, 100.0 * rejected / total );
+		}
+	}
+	return pipeline.Error ? 1 : 0;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	gen::SBatchOptions options;
+	if (!gen::ParseOptions( argc, argv, options ))
+	{
+		gen::PrintUsage();
+		return 1;
+	}
+	return gen::RunBatch( options );
+}
@@ -0,0 +1,91 @@
+/*******************************************
+	BoundedQueue.h
+
+	Fixed capacity blocking queue connecting
+	the stages of the batch pipeline
+********************************************/
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// A first-in first-out queue shared between threads. Push blocks while the queue is full and Pop
+// blocks while it is empty, so a slow stage holds back the stages feeding it and memory use stays
+// bounded. Closing the queue releases all waiting threads: Pop then returns the remaining items
+// followed by false, and Push fails
+template <class T>
+class CBoundedQueue
+{
+public:
+	CBoundedQueue( TUInt32 capacity )
+	{
+		m_Capacity = (capacity > 0) ? capacity : 1;
+		m_Closed = false;
+	}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CBoundedQueue( const CBoundedQueue& );
+	CBoundedQueue& operator=( const CBoundedQueue& );
+
+public:
+	// Add an item, waiting for space. Returns false if the queue has been closed
+	bool Push( const T& item )
+	{
+		unique_lock<mutex> lock( m_Mutex );
+		while (m_Items.size() >= m_Capacity && !m_Closed)
+		{
+			m_NotFull.wait( lock );
+		}
+		if (m_Closed) return false;
+
+		m_Items.push_back( item );
+		m_NotEmpty.notify_one();
+		return true;
+	}
+
+	// Remove the oldest item, waiting for one to arrive. Returns false once the queue is closed
+	// and empty
+	bool Pop( T& item )
+	{
+		unique_lock<mutex> lock( m_Mutex );
+		while (m_Items.empty() && !m_Closed)
+		{
+			m_NotEmpty.wait( lock );
+		}
+		if (m_Items.empty()) return false;
+
+		item = m_Items.front();
+		m_Items.pop_front();
+		m_NotFull.notify_one();
+		return true;
+	}
+
+	// No more items will be pushed - wake all waiting threads
+	void Close()
+	{
+		lock_guard<mutex> lock( m_Mutex );
+		m_Closed = true;
+		m_NotEmpty.notify_all();
+		m_NotFull.notify_all();
+	}
+
+private:
+	TUInt32            m_Capacity;
+	bool               m_Closed;
+	deque<T>           m_Items;
+	mutex              m_Mutex;
+	condition_variable m_NotFull;
+	condition_variable m_NotEmpty;
+};
+
+
+} // namespace gen
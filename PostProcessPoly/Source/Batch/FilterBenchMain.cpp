@@ -0,0 +1,914 @@
+/*******************************************
+	FilterBenchMain.cpp
+
+	Benchmark comparing the CPU filters in the
+	linear and tiled image layouts, the chain
+	run whole or in strips, the filters against
+	the translated shaders, the convolution
+	paths against a naive convolution, the
+	summed-area table against 64-bit sums, the
+	cost of linear light and the fast maths
+	against libm
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+#include "ImageIO.h"
+#include "TiledImage.h"
+#include "FilterChain.h"
+#include "StripExecutor.h"
+#include "GeneratedFilters.h"
+#include "DepthPyramid.h"
+#include "Convolution.h"
+#include "SummedAreaTable.h"
+#include "Parallel.h"
+#include "FastMathSSE.h"
+#include "ColourSpace.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+struct SFilterBenchOptions
+{
+	TUInt32 Width;
+	TUInt32 Height;
+	string  Chain;    // Filters timed one at a time, then as a chain
+	string  Input;    // Image to filter, empty for a generated frame
+	TUInt32 Repeats;
+	TUInt32 Threads;  // Threads used by each filter, 0 for the hardware threads
+	TUInt32 Strip;    // Rows per strip when running the chain in strips
+	TUInt32 Ripples;  // Ripples under way at once
+	bool    Generated; // Compare each filter with its technique run from the translated shaders
+	TFloat32 Occluded; // Part of an area hidden when timing the techniques with depth rejection, negative for none
+	bool    Convolution; // Check the convolution paths against a naive convolution
+	bool    SummedArea;  // Check the variable radius blur's box sums against 64-bit sums
+	bool    LinearLight; // Time the convolutions in linear light against gamma encoded
+	bool    FastMath;    // Check the warp filters' vectorised maths against libm
+
+	SFilterBenchOptions()
+	{
+		Width = 3840;
+		Height = 2160;
+		Chain = "GaussianBlur,Spiral,Ripple,HeatHaze,Distort,Tint";
+		Repeats = 10;
+		Threads = 1;
+		Strip = kDefaultStripRows;
+		Ripples = 1;
+		Generated = false;
+		Occluded = -1.0f;
+		Convolution = false;
+		SummedArea = false;
+		LinearLight = false;
+		FastMath = false;
+	}
+};
+
+void PrintUsage()
+{
+	fprintf( stderr,
+		"Usage: PostProcessFilterBench [options]\n"
+		"\n"
+		"  --size <WxH>       Frame size (default 3840x2160)\n"
+		"  --chain <list>     Filters to time (default GaussianBlur,Spiral,Ripple,HeatHaze,Distort,Tint)\n"
+		"  --in <file>        Frame to filter (.tga / .ppm), overrides --size (default: generated)\n"
+		"  --repeats <n>      Runs of each measurement, the median is reported (default 10)\n"
+		"  --threads <n>      Threads each filter uses, 0 for all hardware threads (default 1)\n"
+		"  --strip <rows>     Rows per strip when running the chain in strips (default 32)\n"
+		"  --ripples <n>      Ripples under way at once, 1 to 8 (default 1)\n"
+		"  --generated        Also compare each filter with its technique run from the shaders\n"
+		"                     translated by PostProcessShaderGen\n"
+		"  --occluded <f>     Also time each technique over an area with this part of it (0 to 1)\n"
+		"                     hidden, with and without depth pyramid rejection\n"
+		"  --convolution      Also time the separable and 2D convolution paths against a naive\n"
+		"                     convolution, failing if any output differs from it by more than 1\n"
+		"  --summed-area      Also time FocusBlur's summed-area table and box blur, failing if any\n"
+		"                     box sum or output pixel differs from one from 64-bit sums\n"
+		"  --linear-light     Also time the convolutions in linear light against the same on gamma\n"
+		"                     encoded values, showing the overhead against its 10%% budget, after\n"
+		"                     checking the SSE encode against LinearToSRGB for every float\n"
+		"  --fast-math        Also check the warp filters' vectorised sincos, pow, length and\n"
+		"                     normalise against libm, failing if any exceeds its error bound\n" );
+}
+
+// Parse the command line. Returns false on error, having printed a message
+bool ParseOptions( int argc, char* argv[], SFilterBenchOptions& options )
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		if (arg == "--generated")
+		{
+			options.Generated = true;
+			continue;
+		}
+		if (arg == "--convolution")
+		{
+			options.Convolution = true;
+			continue;
+		}
+		if (arg == "--summed-area")
+		{
+			options.SummedArea = true;
+			continue;
+		}
+		if (arg == "--linear-light")
+		{
+			options.LinearLight = true;
+			continue;
+		}
+		if (arg == "--fast-math")
+		{
+			options.FastMath = true;
+			continue;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf( stderr, "Missing value for %s\n", arg.c_str() );
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--size")
+		{
+			if (sscanf( value, "%ux%u", &options.Width, &options.Height ) != 2)
+			{
+				fprintf( stderr, "Bad size '%s', expected WxH\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--chain")   options.Chain = value;
+		else if (arg == "--in")      options.Input = value;
+		else if (arg == "--repeats") options.Repeats = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--threads") options.Threads = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--strip")   options.Strip = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--ripples") options.Ripples = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--occluded")
+		{
+			options.Occluded = static_cast<TFloat32>(atof( value ));
+			if (options.Occluded < 0.0f || options.Occluded > 1.0f)
+			{
+				fprintf( stderr, "--occluded must be 0 to 1\n" );
+				return false;
+			}
+		}
+		else
+		{
+			fprintf( stderr, "Unknown option %s\n", arg.c_str() );
+			return false;
+		}
+	}
+
+	if (options.Width == 0 || options.Height == 0 || options.Repeats == 0 || options.Strip == 0)
+	{
+		fprintf( stderr, "--size, --repeats and --strip must be positive\n" );
+		return false;
+	}
+	if (options.Ripples == 0 || options.Ripples > kMaxRipples)
+	{
+		fprintf( stderr, "--ripples must be 1 to %u\n", kMaxRipples );
+		return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Timing
+//-----------------------------------------------------------------------------
+
+// Median time in milliseconds of a number of calls to a function
+template <class TFunction>
+TFloat64 MedianTime( TUInt32 repeats, TFunction function )
+{
+	typedef chrono::steady_clock Clock;
+	vector<TFloat64> times( repeats );
+	function(); // Warm up, faulting in any memory allocated on first use
+	for (TUInt32 i = 0; i < repeats; ++i)
+	{
+		Clock::time_point start = Clock::now();
+		function();
+		times[i] = chrono::duration<TFloat64, milli>( Clock::now() - start ).count();
+	}
+	sort( times.begin(), times.end() );
+	return times[repeats / 2];
+}
+
+// Fill a frame with a repeatable mixture of gradients and noise, so filters see detail
+// everywhere rather than flat colour
+void GenerateFrame( CImage& frame, TUInt32 width, TUInt32 height )
+{
+	frame.Create( width, height );
+	TUInt32 state = 1;
+	for (TUInt32 y = 0; y < height; ++y)
+	{
+		TUInt8* pixel = frame.Row( y );
+		for (TUInt32 x = 0; x < width; ++x)
+		{
+			state = state * 1664525u + 1013904223u;
+			TUInt32 noise = state >> 27;
+			pixel[0] = static_cast<TUInt8>((x * 255) / width + noise);
+			pixel[1] = static_cast<TUInt8>((y * 255) / height + noise);
+			pixel[2] = static_cast<TUInt8>(((x ^ y) & 0x3f) + noise);
+			pixel[3] = 255;
+			pixel += 4;
+		}
+	}
+}
+
+
+// Largest difference in any channel between two images of the same size
+TUInt32 MaxDifference( const CImage& a, const CImage& b )
+{
+	TUInt32 difference = 0;
+	for (TUInt32 y = 0; y < a.Height(); ++y)
+	{
+		const TUInt8* rowA = a.Row( y );
+		const TUInt8* rowB = b.Row( y );
+		for (TUInt32 i = 0; i < a.Width() * 4; ++i)
+		{
+			TUInt32 d = (rowA[i] > rowB[i]) ? rowA[i] - rowB[i] : rowB[i] - rowA[i];
+			if (d > difference) difference = d;
+		}
+	}
+	return difference;
+}
+
+
+// Whether a filter has a technique with translated shaders to compare it with
+bool HasGeneratedFilter( EPostProcessFilter filter )
+{
+	string name = FilterNames[filter];
+	for (TUInt32 i = 0; i < NumGeneratedFilters(); ++i)
+	{
+		if (name == GeneratedFilterName( i )) return true;
+	}
+	return false;
+}
+
+
+//-----------------------------------------------------------------------------
+// Naive convolution
+//-----------------------------------------------------------------------------
+
+// Convolve as the definition reads: every tap of every channel of every pixel, in double
+// precision, with clamped addressing. The reference for the optimised paths in Convolution.cpp
+void NaiveConvolve( const CImage& source, CImage& dest, const CConvolutionKernel& kernel )
+{
+	const TInt32 width = static_cast<TInt32>(source.Width());
+	const TInt32 height = static_cast<TInt32>(source.Height());
+	const TInt32 anchorX = static_cast<TInt32>(kernel.Width() - 1) / 2;
+	const TInt32 anchorY = static_cast<TInt32>(kernel.Height() - 1) / 2;
+	dest.Create( source.Width(), source.Height() );
+	for (TInt32 y = 0; y < height; ++y)
+	{
+		for (TInt32 x = 0; x < width; ++x)
+		{
+			TUInt8* out = dest.Row( y ) + x * 4;
+			for (TUInt32 channel = 0; channel < 3; ++channel)
+			{
+				TFloat64 sum = kernel.Bias();
+				for (TInt32 r = 0; r < static_cast<TInt32>(kernel.Height()); ++r)
+				{
+					TInt32 sourceY = min( max( y + r - anchorY, 0 ), height - 1 );
+					for (TInt32 c = 0; c < static_cast<TInt32>(kernel.Width()); ++c)
+					{
+						TInt32 sourceX = min( max( x + c - anchorX, 0 ), width - 1 );
+						sum += kernel.Weight( c, r ) * static_cast<TFloat64>(source.Row( sourceY )[sourceX * 4 + channel]);
+					}
+				}
+				sum = floor( sum + 0.5 );
+				out[channel] = static_cast<TUInt8>((sum < 0.0) ? 0.0 : ((sum > 255.0) ? 255.0 : sum));
+			}
+			out[3] = 255;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Summed-area check
+//-----------------------------------------------------------------------------
+
+// Check one variable radius box blur pass against box sums from a 64-bit summed-area table, which
+// cannot wrap. The 64-bit table is built a row at a time into a ring holding the rows the boxes
+// of one output row reach. Counts the boxes whose sum from the 32-bit table differs, and the
+// output pixels that differ from averages of the 64-bit sums made as VariableBoxRow makes them
+void CheckBoxSums
+(
+	const CImage&           source,
+	const CSummedAreaTable& table,
+	const TUInt8*           radiusMap,
+	TUInt32                 maxRadius,
+	const CImage&           blurred,
+	TUInt64&                badSums,
+	TUInt64&                badPixels
+)
+{
+	const TInt32 width = static_cast<TInt32>(source.Width());
+	const TInt32 height = static_cast<TInt32>(source.Height());
+	const TUInt32 stride = (width + 1) * 4;
+	const TUInt32 ringRows = 2 * maxRadius + 2;
+	vector<TUInt64> ring( static_cast<size_t>(ringRows) * stride, 0 );
+	TInt32 builtRows = 1; // Table row 0 is zeros
+	badSums = badPixels = 0;
+
+	for (TInt32 y = 0; y < height; ++y)
+	{
+		// Table rows up to the bottom of the tallest box
+		TInt32 needed = min( y + static_cast<TInt32>(maxRadius) + 2, height + 1 );
+		for (; builtRows < needed; ++builtRows)
+		{
+			const TUInt64* above = &ring[((builtRows - 1) % ringRows) * stride];
+			TUInt64* entry = &ring[(builtRows % ringRows) * stride];
+			const TUInt8* pixel = source.Row( builtRows - 1 );
+			TUInt64 rowSum[4] = { 0, 0, 0, 0 };
+			for (TInt32 x = 0; x <= width; ++x)
+			{
+				for (TUInt32 channel = 0; channel < 4; ++channel)
+				{
+					if (x > 0) rowSum[channel] += pixel[(x - 1) * 4 + channel];
+					entry[x * 4 + channel] = above[x * 4 + channel] + rowSum[channel];
+				}
+			}
+		}
+
+		const TUInt8* radius = radiusMap + y * width;
+		const TUInt8* outPixel = blurred.Row( y );
+		for (TInt32 x = 0; x < width; ++x)
+		{
+			TInt32 r = radius[x];
+			TInt32 x0 = max( x - r, 0 ), y0 = max( y - r, 0 );
+			TInt32 x1 = min( x + r, width - 1 ), y1 = min( y + r, height - 1 );
+			const TUInt64* top = &ring[(y0 % ringRows) * stride];
+			const TUInt64* bottom = &ring[((y1 + 1) % ringRows) * stride];
+
+			TUInt32 tableSum[4];
+			table.BoxSum( x0, y0, x1, y1, tableSum );
+			TFloat32 area = static_cast<TFloat32>((x1 - x0 + 1) * (y1 - y0 + 1));
+			bool sumsMatch = true, pixelMatches = true;
+			for (TUInt32 channel = 0; channel < 4; ++channel)
+			{
+				TUInt64 sum = bottom[(x1 + 1) * 4 + channel] - top[(x1 + 1) * 4 + channel] -
+				              bottom[x0 * 4 + channel] + top[x0 * 4 + channel];
+				if (sum != tableSum[channel]) sumsMatch = false;
+				TFloat32 average = static_cast<TFloat32>(sum) * (1.0f / area);
+				if (outPixel[x * 4 + channel] != static_cast<TUInt8>(lrintf( average ))) pixelMatches = false;
+			}
+			if (!sumsMatch) ++badSums;
+			if (!pixelMatches) ++badPixels;
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Fast maths check
+//-----------------------------------------------------------------------------
+
+// Values sampled across each range checked
+const TUInt32 kMathSamples = 1 << 22;
+
+// Largest error of a four-wide function of one value against a double precision reference, over
+// evenly spaced values from low to high. Error is relative to the reference if requested, except
+// where the reference is zero
+template <class TApproximation, class TReference>
+TFloat64 MaxMathError( TFloat32 low, TFloat32 high, bool relative, TApproximation approximation, TReference reference )
+{
+	TFloat64 maxError = 0.0;
+	for (TUInt32 i = 0; i < kMathSamples; i += 4)
+	{
+		GEN_ALIGN(16) TFloat32 x[4];
+		GEN_ALIGN(16) TFloat32 result[4];
+		for (TUInt32 lane = 0; lane < 4; ++lane)
+		{
+			x[lane] = static_cast<TFloat32>(low + (static_cast<TFloat64>(high) - low) * (i + lane) / (kMathSamples - 1));
+		}
+		_mm_store_ps( result, approximation( _mm_load_ps( x ) ) );
+		for (TUInt32 lane = 0; lane < 4; ++lane)
+		{
+			TFloat64 expected = reference( static_cast<TFloat64>(x[lane]) );
+			TFloat64 error = fabs( result[lane] - expected );
+			if (relative && expected != 0.0) error /= fabs( expected );
+			maxError = max( maxError, error );
+		}
+	}
+	return maxError;
+}
+
+// Largest errors of LengthSSE and NormaliseSSE over a grid of 2D vectors with both components
+// from low to high: the relative error of each length and the absolute error of the normalised
+// components. Zero vectors must give zero
+void MaxLengthErrors( TFloat32 low, TFloat32 high, TFloat64& lengthError, TFloat64& normaliseError,
+                      TFloat64& componentError )
+{
+	const TUInt32 gridSize = 2048;
+	lengthError = normaliseError = componentError = 0.0;
+	for (TUInt32 row = 0; row < gridSize; ++row)
+	{
+		TFloat32 y = static_cast<TFloat32>(low + (static_cast<TFloat64>(high) - low) * row / (gridSize - 1));
+		for (TUInt32 column = 0; column < gridSize; column += 4)
+		{
+			GEN_ALIGN(16) TFloat32 x[4];
+			for (TUInt32 lane = 0; lane < 4; ++lane)
+			{
+				x[lane] = static_cast<TFloat32>(low + (static_cast<TFloat64>(high) - low) * (column + lane) / (gridSize - 1));
+			}
+			__m128 normalX = _mm_load_ps( x );
+			__m128 normalY = _mm_set1_ps( y );
+			GEN_ALIGN(16) TFloat32 length[4];
+			GEN_ALIGN(16) TFloat32 normalLength[4];
+			GEN_ALIGN(16) TFloat32 normal[2][4];
+			_mm_store_ps( length, LengthSSE( normalX, normalY ) );
+			_mm_store_ps( normalLength, NormaliseSSE( normalX, normalY ) );
+			_mm_store_ps( normal[0], normalX );
+			_mm_store_ps( normal[1], normalY );
+			for (TUInt32 lane = 0; lane < 4; ++lane)
+			{
+				TFloat64 expected = sqrt( static_cast<TFloat64>(x[lane]) * x[lane] + static_cast<TFloat64>(y) * y );
+				if (expected == 0.0)
+				{
+					if (length[lane] != 0.0f || normalLength[lane] != 0.0f) lengthError = normaliseError = 1.0;
+					continue;
+				}
+				lengthError = max( lengthError, fabs( length[lane] - expected ) / expected );
+				normaliseError = max( normaliseError, fabs( normalLength[lane] - expected ) / expected );
+				componentError = max( componentError, fabs( normal[0][lane] - x[lane] / expected ) );
+				componentError = max( componentError, fabs( normal[1][lane] - y / expected ) );
+			}
+		}
+	}
+}
+
+// Print one fast maths result against its documented bound. Returns false if over the bound
+bool PrintMathError( const char* name, const char* range, TFloat64 error, TFloat64 bound )
+{
+	bool withinBound = (error <= bound);
+	fprintf( stderr, "  %-20s %-22s %10.3g %10.3g%s\n", name, range, error, bound, withinBound ? "" : "  over bound" );
+	return withinBound;
+}
+
+// Store one pixel through StorePixelLinearSSE and count its colour codes that differ from
+// LinearToSRGB, returning the largest difference. Alpha must be rounded directly
+TUInt32 CheckEncodedPixel( TFloat32 r, TFloat32 g, TFloat32 b, TFloat32 a, TUInt64& differing )
+{
+	TUInt8 pixel[4];
+	StorePixelLinearSSE( pixel, _mm_set_ps( a, b, g, r ) );
+	const TFloat32 colour[3] = { r, g, b };
+	TUInt32 maxDifference = 0;
+	for (TUInt32 channel = 0; channel < 3; ++channel)
+	{
+		TUInt8 expected = LinearToSRGB( colour[channel] * (1.0f / 255.0f) );
+		TUInt32 difference = static_cast<TUInt32>(abs( pixel[channel] - expected ));
+		if (difference != 0) ++differing;
+		maxDifference = max( maxDifference, difference );
+	}
+	TUInt8 alpha = static_cast<TUInt8>(min( max( lrintf( a ), 0L ), 255L ));
+	if (pixel[3] != alpha) maxDifference = max( maxDifference, 256u );
+	return maxDifference;
+}
+
+union UFloatBits { TFloat32 f; TUInt32 u; };
+
+// Largest difference between the SSE encode and LinearToSRGB over every float from 0 to 255,
+// three to a pixel with the first also as alpha, and over values out of range and NaN. The
+// number of colour codes that differ and the number checked are returned in differing and checked
+TUInt32 MaxEncodeDifference( TUInt64& differing, TUInt64& checked )
+{
+	UFloatBits top = { 255.0f };
+	TUInt32 maxDifference = 0;
+	differing = checked = 0;
+	for (TUInt32 bits = 0; bits <= top.u; bits += 3)
+	{
+		UFloatBits r, g, b;
+		r.u = bits;
+		g.u = bits + 1;
+		b.u = bits + 2;
+		maxDifference = max( maxDifference, CheckEncodedPixel( r.f, g.f, b.f, r.f, differing ) );
+		checked += 3;
+	}
+
+	const TFloat32 outside[] = { -0.0f, -1.0f, -1e30f, -numeric_limits<TFloat32>::infinity(), 256.0f, 1e30f,
+	                             numeric_limits<TFloat32>::infinity(), numeric_limits<TFloat32>::quiet_NaN() };
+	for (size_t i = 0; i < sizeof(outside) / sizeof(outside[0]); ++i)
+	{
+		maxDifference = max( maxDifference, CheckEncodedPixel( outside[i], outside[i], outside[i], 128.0f, differing ) );
+		checked += 3;
+	}
+	return maxDifference;
+}
+
+
+//-----------------------------------------------------------------------------
+// Access patterns
+//-----------------------------------------------------------------------------
+
+// Read one channel of every pixel down each column in turn, as the vertical blur pass does
+template <class TImage>
+TUInt32 ReadColumns( const TImage& image )
+{
+	TUInt32 sum = 0;
+	for (TUInt32 x = 0; x < image.Width(); ++x)
+	{
+		for (TUInt32 y = 0; y < image.Height(); ++y)
+		{
+			sum += *image.Pixel( x, y );
+		}
+	}
+	return sum;
+}
+
+// Read one channel along rays from the centre to each edge pixel, as the warps' sample
+// positions move around their centre
+template <class TImage>
+TUInt32 ReadRays( const TImage& image )
+{
+	const TFloat32 centreX = image.Width() * 0.5f;
+	const TFloat32 centreY = image.Height() * 0.5f;
+	const TUInt32 numRays = 2 * (image.Width() + image.Height());
+	TUInt32 sum = 0;
+	for (TUInt32 ray = 0; ray < numRays; ++ray)
+	{
+		TFloat32 angle = ray * (6.2831853f / numRays);
+		TFloat32 stepX = cosf( angle );
+		TFloat32 stepY = sinf( angle );
+		TFloat32 x = centreX;
+		TFloat32 y = centreY;
+		while (x >= 0.0f && y >= 0.0f && x < image.Width() && y < image.Height())
+		{
+			sum += *image.Pixel( static_cast<TUInt32>(x), static_cast<TUInt32>(y) );
+			x += stepX;
+			y += stepY;
+		}
+	}
+	return sum;
+}
+
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+void PrintComparison( const char* label, TFloat64 linear, TFloat64 tiled )
+{
+	fprintf( stderr, "  %-14s %9.2fms %9.2fms %8.2fx\n", label, linear, tiled, linear / tiled );
+}
+
+int RunFilterBench( const SFilterBenchOptions& options )
+{
+	CFilterChain chain;
+	string error;
+	if (!chain.Parse( options.Chain, error ))
+	{
+		fprintf( stderr, "%s\n", error.c_str() );
+		return 1;
+	}
+	SFilterMaps maps;
+	LoadFilterMaps( "", &chain, maps );
+	chain.SetMaps( maps );
+	SetNumWorkerThreads( options.Threads );
+
+	CImage source;
+	if (!options.Input.empty())
+	{
+		if (!LoadImageFile( options.Input, source ))
+		{
+			fprintf( stderr, "Failed to read %s\n", options.Input.c_str() );
+			return 1;
+		}
+	}
+	else
+	{
+		GenerateFrame( source, options.Width, options.Height );
+	}
+	const TUInt32 width = source.Width();
+	const TUInt32 height = source.Height();
+
+	CTiledImage tiledSource;
+	tiledSource.FromLinear( source );
+	fprintf( stderr, "%ux%u, %u thread(s), %ux%u tiles, median of %u runs\n\n", width, height, NumWorkerThreads(),
+	         kTileSize, kTileSize, options.Repeats );
+	fprintf( stderr, "  %-14s %11s %11s %9s\n", "", "linear", "tiled", "speedup" );
+
+	// Reading patterns without any filter arithmetic, to show the layout effect on its own.
+	// Rows are the linear layout's best case
+	volatile TUInt32 sink = 0;
+	PrintComparison( "columns", MedianTime( options.Repeats, [&]() { sink += ReadColumns( source ); } ),
+	                            MedianTime( options.Repeats, [&]() { sink += ReadColumns( tiledSource ); } ) );
+	PrintComparison( "rays", MedianTime( options.Repeats, [&]() { sink += ReadRays( source ); } ),
+	                         MedianTime( options.Repeats, [&]() { sink += ReadRays( tiledSource ); } ) );
+
+	// Conversion cost paid once each way by a chain
+	CImage linearDest;
+	CTiledImage tiledDest;
+	fprintf( stderr, "  %-14s %9.2fms %9.2fms\n", "convert in/out",
+	         MedianTime( options.Repeats, [&]() { tiledDest.FromLinear( source ); } ),
+	         MedianTime( options.Repeats, [&]() { tiledSource.ToLinear( linearDest ); } ) );
+	fprintf( stderr, "\n" );
+
+	// Each filter on its own with the animation part way through, when the spiral and ripples are
+	// well developed. Ripples after the first are spread over the frame and start a little later
+	// each, so their rings have different sizes
+	CFilterAnimation animation;
+	animation.StartRipple( width * 0.5f, height * 0.5f );
+	for (TUInt32 i = 1; i < options.Ripples; ++i)
+	{
+		animation.AddRipple( width * fmodf( 0.13f + i * 0.37f, 1.0f ), height * fmodf( 0.29f + i * 0.61f, 1.0f ), i * 0.04f );
+	}
+	animation.Update( 0.35f );
+	animation.SpiralTimer = 2.0f;
+	vector<SFilterStep> steps;
+	chain.SelectSteps( animation, width, height, steps );
+	bool success = true;
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		const SFilterStep& step = steps[i];
+		TFloat64 linear = MedianTime( options.Repeats, [&]() { success &= ApplyFilter( step.Filter, source, linearDest, step.Params ); } );
+		TFloat64 tiled = MedianTime( options.Repeats, [&]() { success &= ApplyFilter( step.Filter, tiledSource, tiledDest, step.Params ); } );
+		PrintComparison( FilterNames[step.Filter], linear, tiled );
+	}
+
+	// Each filter against its technique run from the translated shaders. GaussianBlur differs
+	// by design - the shader's second pass blurs horizontally again, the filter's vertically
+	if (options.Generated)
+	{
+		CImage generatedDest;
+		fprintf( stderr, "\n  %-14s %11s %11s %9s %9s\n", "", "filter", "generated", "speedup", "max diff" );
+		for (size_t i = 0; i < steps.size(); ++i)
+		{
+			const SFilterStep& step = steps[i];
+			if (!HasGeneratedFilter( step.Filter )) continue;
+			TFloat64 filter = MedianTime( options.Repeats, [&]() { success &= ApplyFilter( step.Filter, source, linearDest, step.Params ); } );
+			TFloat64 generated = MedianTime( options.Repeats, [&]() { success &= ApplyGeneratedFilter( FilterNames[step.Filter], source, generatedDest, step.Params ); } );
+			fprintf( stderr, "  %-14s %9.2fms %9.2fms %8.2fx %9u\n", FilterNames[step.Filter], filter, generated, filter / generated,
+			         MaxDifference( linearDest, generatedDest ) );
+		}
+		fprintf( stderr, "\n" );
+	}
+
+	// Each technique over an area in the middle of the frame, drawn behind an occluder that covers
+	// part of it from the left, as the area over the cube is hidden by the garage. Without the
+	// depth pyramid every pixel of the area is shaded, with it only those that pass the depth test
+	if (options.Occluded >= 0.0f)
+	{
+		const SFilterArea area = { { 0.25f, 0.25f }, { 0.75f, 0.75f }, 0.5f };
+		const TUInt32 occluderRight = static_cast<TUInt32>(width * (0.25f + 0.5f * options.Occluded));
+		vector<TFloat32> depthBuffer( width * height );
+		for (TUInt32 y = 0; y < height; ++y)
+		{
+			for (TUInt32 x = 0; x < width; ++x)
+			{
+				depthBuffer[y * width + x] = (x < occluderRight) ? 0.2f : 1.0f;
+			}
+		}
+		CDepthPyramid depth;
+		TFloat64 build = MedianTime( options.Repeats, [&]() { success &= depth.Build( &depthBuffer[0], width, height, width * sizeof(TFloat32) ); } );
+
+		CImage areaDest;
+		fprintf( stderr, "\n  %-14s %11s %11s %9s   (pyramid build %.2fms)\n", "", "area", "rejection", "speedup", build );
+		for (size_t i = 0; i < steps.size(); ++i)
+		{
+			const SFilterStep& step = steps[i];
+			if (!HasGeneratedFilter( step.Filter )) continue;
+			TFloat64 shaded = MedianTime( options.Repeats, [&]() { success &= ApplyGeneratedAreaFilter( FilterNames[step.Filter], source, areaDest, step.Params, area ); } );
+			TFloat64 rejected = MedianTime( options.Repeats, [&]() { success &= ApplyGeneratedAreaFilter( FilterNames[step.Filter], source, areaDest, step.Params, area, &depth ); } );
+			PrintComparison( FilterNames[step.Filter], shaded, rejected );
+		}
+		fprintf( stderr, "\n" );
+	}
+
+	// Each path through Convolve against the naive convolution: the Gaussians are separable so run
+	// as two 1D passes, the 3x3 kernels of the CPU only filters are not so run in 2D. The naive
+	// convolution is run once, it is only there to check against. Results may differ by 1 where
+	// float and double sums round either side of a half
+	struct SConvolutionCase
+	{
+		const char*        Name;
+		CConvolutionKernel Kernel;
+	};
+	const SConvolutionCase convolutions[] =
+	{
+		{ "Gaussian 9x9", GaussianBlurKernel() },
+		{ "Gaussian s=3", GaussianBlurKernel( 3.0f ) },
+		{ "Sharpen",      SharpenKernel() },
+		{ "EdgeDetect",   EdgeDetectKernel() },
+		{ "Emboss",       EmbossKernel() },
+	};
+	const size_t numConvolutions = sizeof(convolutions) / sizeof(convolutions[0]);
+	if (options.Convolution)
+	{
+		CImage convolved, reference;
+		fprintf( stderr, "\n  %-14s %9s %11s %11s %9s %9s\n", "", "path", "convolve", "naive", "speedup", "max diff" );
+		for (size_t i = 0; i < numConvolutions; ++i)
+		{
+			const CConvolutionKernel& kernel = convolutions[i].Kernel;
+			TFloat64 convolve = MedianTime( options.Repeats, [&]() { Convolve( source, convolved, kernel ); } );
+			chrono::steady_clock::time_point start = chrono::steady_clock::now();
+			NaiveConvolve( source, reference, kernel );
+			TFloat64 naive = chrono::duration<TFloat64, milli>( chrono::steady_clock::now() - start ).count();
+
+			TUInt32 difference = MaxDifference( convolved, reference );
+			fprintf( stderr, "  %-14s %9s %9.2fms %9.2fms %8.2fx %9u\n", convolutions[i].Name, kernel.IsSeparable() ? "separable" : "2D",
+			         convolve, naive, naive / convolve, difference );
+			if (difference > 1)
+			{
+				fprintf( stderr, "  %s differs from the naive convolution\n", convolutions[i].Name );
+				success = false;
+			}
+		}
+		fprintf( stderr, "\n" );
+	}
+
+	// The convolutions in linear light, which costs a table lookup per channel to decode each
+	// source pixel and a polynomial to encode each output pixel whatever the kernel. The 1x1
+	// kernel is the conversions alone. The encode is checked against the table driven
+	// LinearToSRGB for every float first, failing if any code differs by more than 1. At around
+	// 2.5ns a pixel the conversions only come within budget for kernels that cost many times that
+	// - the 3x3 kernels and the separable 9x9 gaussian are still over, which is why linear light
+	// is an option rather than the default
+	if (options.LinearLight)
+	{
+		TUInt64 differing, checked;
+		TUInt32 encodeDifference = MaxEncodeDifference( differing, checked );
+		fprintf( stderr, "\n  %-14s %llu of %llu codes differ from LinearToSRGB, by at most %u\n", "encode check",
+		         static_cast<unsigned long long>(differing), static_cast<unsigned long long>(checked), encodeDifference );
+		if (encodeDifference > 1)
+		{
+			fprintf( stderr, "  The SSE encode differs from LinearToSRGB by more than 1\n" );
+			success = false;
+		}
+
+		const TFloat64 kBudget = 10.0;
+		CImage gamma, linear;
+		fprintf( stderr, "\n  %-14s %11s %11s %9s\n", "", "gamma", "linear", "overhead" );
+		for (size_t i = 0; i <= numConvolutions; ++i)
+		{
+			CConvolutionKernel identity;
+			const CConvolutionKernel& kernel = (i < numConvolutions) ? convolutions[i].Kernel : identity;
+			TFloat64 gammaTime = MedianTime( options.Repeats, [&]() { Convolve( source, gamma, kernel ); } );
+			TFloat64 linearTime = MedianTime( options.Repeats, [&]() { Convolve( source, linear, kernel, kAddressClamp, true ); } );
+			TFloat64 overhead = 100.0 * (linearTime - gammaTime) / gammaTime;
+			fprintf( stderr, "  %-14s %9.2fms %9.2fms %8.1f%%%s\n", (i < numConvolutions) ? convolutions[i].Name : "1x1 (convert)",
+			         gammaTime, linearTime, overhead, (overhead > kBudget) ? "  over budget" : "" );
+		}
+		fprintf( stderr, "\n" );
+	}
+
+	// FocusBlur's table and box blur, and one box blur pass with a large radius checked against
+	// 64-bit sums. The table's entries wrap for frames over 16.8 million pixels but its box sums
+	// must still be exact, and the whole frame is the largest box there is
+	if (options.SummedArea)
+	{
+		const TUInt32 kCheckRadius = 64;
+		SFilterParams params;
+		CFilterAnimation focus;
+		focus.FocusBlurRadius = kCheckRadius;
+		focus.Select( kFilterFocusBlur, width, height, params );
+		vector<TUInt8> radii( static_cast<size_t>(width) * height );
+		BuildFocusRadiusMap( &radii[0], width, height, params.FocusCentre[0], params.FocusCentre[1], params.FocusRadius,
+		                     params.FocusFalloff, static_cast<TUInt8>(kCheckRadius) );
+
+		CSummedAreaTable table;
+		CImage blurred;
+		TFloat64 build = MedianTime( options.Repeats, [&]() { success &= table.Build( source ); } );
+		TFloat64 pass = MedianTime( options.Repeats, [&]() { VariableBoxBlur( source, blurred, &radii[0] ); } );
+		TFloat64 filter = MedianTime( options.Repeats, [&]() { success &= ApplyFilter( kFilterFocusBlur, source, linearDest, params ); } );
+		fprintf( stderr, "\n  %-14s %9.2fms\n  %-14s %9.2fms\n  %-14s %9.2fms   (%u passes)\n", "table build", build,
+		         "box pass", pass, "FocusBlur", filter, FilterPasses( kFilterFocusBlur ) );
+
+		TUInt64 badSums, badPixels;
+		CheckBoxSums( source, table, &radii[0], kCheckRadius, blurred, badSums, badPixels );
+		TUInt32 frameSum[4];
+		table.BoxSum( 0, 0, width - 1, height - 1, frameSum );
+		TUInt64 frameTotal[4] = { 0, 0, 0, 0 };
+		for (TUInt32 y = 0; y < height; ++y)
+		{
+			for (TUInt32 x = 0; x < width * 4; ++x)
+			{
+				frameTotal[x & 3] += source.Row( y )[x];
+			}
+		}
+		bool frameMatches = true;
+		for (TUInt32 channel = 0; channel < 4; ++channel)
+		{
+			if (frameSum[channel] != frameTotal[channel]) frameMatches = false;
+		}
+		fprintf( stderr, "  %-14s %llu boxes and %llu pixels differ, whole frame box %s\n\n", "64-bit check",
+		         static_cast<unsigned long long>(badSums), static_cast<unsigned long long>(badPixels), frameMatches ? "matches" : "differs" );
+		if (badSums > 0 || badPixels > 0 || !frameMatches) success = false;
+	}
+
+	// The vectorised maths of the warp filters against libm in double precision, over the ranges
+	// the app's UpdatePostProcesses drives them through and over the wider ranges FastMathSSE.h
+	// documents. Each error must be within the bound the header gives
+	if (options.FastMath)
+	{
+		auto sine = []( __m128 x ) { __m128 s, c; SinCosSSE( x, s, c ); return s; };
+		auto cosine = []( __m128 x ) { __m128 s, c; SinCosSSE( x, s, c ); return c; };
+		auto fastLog2 = []( __m128 x ) { return Log2SSE( x ); };
+		auto fastExp2 = []( __m128 x ) { return Exp2SSE( x ); };
+		auto fastRSqrt = []( __m128 x ) { return RSqrtSSE( x ); };
+		auto libmSin = []( TFloat64 x ) { return sin( x ); };
+		auto libmCos = []( TFloat64 x ) { return cos( x ); };
+
+		// Ripple uses pow( |diff| * 0.1, 0.1 ), with |diff| at most 0.05. Other powers are checked
+		// with a gamma exponent, whose bound depends on the largest |y * log2(x)|
+		const TFloat32 rippleExponent = 0.1f;
+		const TFloat32 gammaExponent = 2.2f;
+		const TFloat32 gammaLow = 1e-6f;
+		auto ripplePow = [&]( __m128 x ) { return PowUnitSSE( x, _mm_set1_ps( rippleExponent ) ); };
+		auto gammaPow = [&]( __m128 x ) { return PowUnitSSE( x, _mm_set1_ps( gammaExponent ) ); };
+		TFloat64 gammaBound = 1e-6 + 5e-8 * fabs( gammaExponent * log2( static_cast<TFloat64>(gammaLow) ) );
+
+		TFloat64 spiralLength, rippleLength, normaliseError, componentError, unused;
+		MaxLengthErrors( -0.5f, 0.5f, spiralLength, unused, unused );
+		MaxLengthErrors( -1.0f, 1.0f, rippleLength, normaliseError, componentError );
+
+		fprintf( stderr, "\n  %-20s %-22s %10s %10s\n", "", "range", "max error", "bound" );
+		bool withinBounds = true;
+		withinBounds &= PrintMathError( "sin (Spiral)", "0 to 45", MaxMathError( 0.0f, 45.0f, false, sine, libmSin ), 1e-7 );
+		withinBounds &= PrintMathError( "cos (Spiral)", "0 to 45", MaxMathError( 0.0f, 45.0f, false, cosine, libmCos ), 1e-7 );
+		withinBounds &= PrintMathError( "sin (HeatHaze)", "0 to 70", MaxMathError( 0.0f, 70.0f, false, sine, libmSin ), 1e-7 );
+		withinBounds &= PrintMathError( "sin", "-8191 to 8191", MaxMathError( -8191.0f, 8191.0f, false, sine, libmSin ), 1e-7 );
+		withinBounds &= PrintMathError( "cos", "-8191 to 8191", MaxMathError( -8191.0f, 8191.0f, false, cosine, libmCos ), 1e-7 );
+		withinBounds &= PrintMathError( "log2", "0.5 to 2", MaxMathError( 0.5f, 2.0f, false, fastLog2,
+		                                []( TFloat64 x ) { return log( x ) / log( 2.0 ); } ), 1.3e-7 );
+		withinBounds &= PrintMathError( "exp2 (relative)", "-126 to 127", MaxMathError( -126.0f, 127.0f, true, fastExp2,
+		                                []( TFloat64 x ) { return pow( 2.0, x ); } ), 1.5e-7 );
+		withinBounds &= PrintMathError( "pow (Ripple, rel)", "1e-9 to 0.005, y 0.1", MaxMathError( 1e-9f, 0.005f, true, ripplePow,
+		                                [&]( TFloat64 x ) { return pow( x, static_cast<TFloat64>(rippleExponent) ); } ), 2e-7 );
+		withinBounds &= PrintMathError( "pow (relative)", "1e-6 to 1, y 2.2", MaxMathError( gammaLow, 1.0f, true, gammaPow,
+		                                [&]( TFloat64 x ) { return pow( x, static_cast<TFloat64>(gammaExponent) ); } ), gammaBound );
+		withinBounds &= PrintMathError( "rsqrt (relative)", "0.25 to 4", MaxMathError( 0.25f, 4.0f, true, fastRSqrt,
+		                                []( TFloat64 x ) { return 1.0 / sqrt( x ); } ), 2.5e-7 );
+		withinBounds &= PrintMathError( "length (Spiral, rel)", "x, y -0.5 to 0.5", spiralLength, 4e-7 );
+		withinBounds &= PrintMathError( "length (Ripple, rel)", "x, y -1 to 1", rippleLength, 4e-7 );
+		withinBounds &= PrintMathError( "normalise length", "x, y -1 to 1", normaliseError, 4e-7 );
+		withinBounds &= PrintMathError( "normalise x, y", "x, y -1 to 1", componentError, 4e-7 );
+		fprintf( stderr, "\n" );
+		if (!withinBounds) success = false;
+	}
+
+	// The whole chain, including the tiled layout's conversions
+	if (steps.size() > 1)
+	{
+		CImage work0, work1, tiledResult;
+		CTiledImage tiledWork0, tiledWork1;
+		const CImage* result;
+		TFloat64 linear = MedianTime( options.Repeats, [&]() { success &= CFilterChain::Run( steps, source, work0, work1, result ); } );
+		TFloat64 tiled = MedianTime( options.Repeats, [&]() { success &= CFilterChain::RunTiled( steps, source, tiledWork0, tiledWork1, tiledResult ); } );
+		PrintComparison( "chain", linear, tiled );
+	}
+
+	// The whole chain a strip at a time, against whole frames. Memory is what each holds besides
+	// the source and result: the rings, or one whole work image (the other becomes the result)
+	if (!steps.empty())
+	{
+		CImage work0, work1, stripResult;
+		const CImage* result;
+		CStripExecutor strips( options.Strip );
+		TFloat64 whole = MedianTime( options.Repeats, [&]() { success &= CFilterChain::Run( steps, source, work0, work1, result ); } );
+		TFloat64 streamed = MedianTime( options.Repeats, [&]() { success &= strips.Run( steps, source, stripResult ); } );
+		fprintf( stderr, "\n  %-14s %11s %11s %9s\n", "", "whole", "strips", "speedup" );
+		PrintComparison( "chain", whole, streamed );
+		fprintf( stderr, "  %-14s %9.0fKB %9.0fKB\n", "work memory",
+		         static_cast<TFloat64>(work0.Pitch()) * height / 1024.0, strips.RingBytes() / 1024.0 );
+	}
+
+	if (!success)
+	{
+		fprintf( stderr, "A filter failed\n" );
+		return 1;
+	}
+	return 0;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	gen::SFilterBenchOptions options;
+	if (!gen::ParseOptions( argc, argv, options ))
+	{
+		gen::PrintUsage();
+		return 1;
+	}
+	return gen::RunFilterBench( options );
+}
@@ -0,0 +1,818 @@
+/*******************************************
+	RenderTestMain.cpp
+
+	Tests of the frame code with no graphics
+	API: sets up the scene as the application
+	does on a null render device, renders it
+	and checks the device calls recorded.
+	Returns 1 if any check fails
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <list>
+#include <map>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector2.h"
+#include "PostProcessPoly.h"
+#include "DrawQueue.h"
+#include "RenderMethod.h"
+#include "Parallel.h"
+#include "NullRenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "StateCacheRenderDevice.h"
+#include "MeshArena.h"
+#include "VertexFormat.h"
+#include "TextureCache.h"
+#include "EntityManager.h"
+#include "SceneSnapshot.h"
+#include "Camera.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Globals used by the scene code (defined in MainApp.cpp in the application)
+//-----------------------------------------------------------------------------
+
+// The application's state cache sits in front of the Direct3D device. Here it is in front of a
+// recorder, so each frame's calls can be checked as they would reach the device
+CNullRenderDevice       NullDevice;
+CRecordingRenderDevice  Recorder( &NullDevice );
+CStateCacheRenderDevice StateCache( &Recorder );
+
+IRenderDevice*        RenderDevice = NULL;
+CMeshArena            MeshArena;
+CVertexFormatRegistry VertexFormats;
+CTextureCache         TextureCache;
+
+extern const string MediaFolder = "Media" + ksPathSeparator;
+extern const string ShaderFolder = "Source" + ksPathSeparator + "Render" + ksPathSeparator;
+
+TUInt32 BackBufferWidth = 1280;
+TUInt32 BackBufferHeight = 720;
+CVector2 MousePixel;
+
+// Draw queues of the scene pass and post-processed polygons (PostProcessPoly.cpp)
+extern CDrawQueue SceneQueue;
+extern CDrawQueue PostProcessQueue;
+
+
+//-----------------------------------------------------------------------------
+// Checks
+//-----------------------------------------------------------------------------
+
+// Print a count and the value expected, returning whether they are the same
+bool CheckCount( const char* name, TUInt32 count, TUInt32 expected )
+{
+	bool same = (count == expected);
+	fprintf( stderr, "  %-36s %8u %8u%s\n", name, count, expected, same ? "" : "  FAILED" );
+	return same;
+}
+
+// Print a count that must be above zero, returning whether it is
+bool CheckNonZero( const char* name, TUInt32 count )
+{
+	fprintf( stderr, "  %-36s %8u %8s%s\n", name, count, "> 0", count > 0 ? "" : "  FAILED" );
+	return count > 0;
+}
+
+// Print a count that must be below a limit, returning whether it is
+bool CheckLess( const char* name, TUInt32 count, TUInt32 limit )
+{
+	fprintf( stderr, "  %-36s %8u %7s%u%s\n", name, count, "< ", limit, count < limit ? "" : "  FAILED" );
+	return count < limit;
+}
+
+
+//-----------------------------------------------------------------------------
+// RenderScene
+//-----------------------------------------------------------------------------
+
+// Render frames of the scene with RenderScene and check the calls each makes: the passes,
+// targets and copies of the frame, the indexed draws of the draws the two queues counted, the
+// two area post-process quads, and no resources created. A queued draw is made once for each
+// pass of its technique (one on the null device) then once more, as CMesh::RenderSubMesh always
+// has. Returns false if any check fails
+bool TestRenderScene()
+{
+	const TUInt32 kFrames = 3;
+	bool success = true;
+	for (TUInt32 frame = 0; frame < kFrames; ++frame)
+	{
+		Recorder.Clear();
+		RenderScene();
+
+		const SDrawQueueStats& sceneStats = SceneQueue.Stats();
+		const SDrawQueueStats& postProcessStats = PostProcessQueue.Stats();
+		TUInt32 indexedDraws = Recorder.NumCommands( kCommandDrawIndexed ) + Recorder.NumCommands( kCommandDrawIndexedInstanced );
+		TUInt32 created = Recorder.NumCommands( kCommandCreateVertexBuffer ) + Recorder.NumCommands( kCommandCreateDynamicVertexBuffer ) +
+		                  Recorder.NumCommands( kCommandCreateIndexBuffer ) + Recorder.NumCommands( kCommandCreateRenderTexture ) +
+		                  Recorder.NumCommands( kCommandLoadTexture ) + Recorder.NumCommands( kCommandCreateInputLayout ) +
+		                  Recorder.NumCommands( kCommandCreateOcclusionPredicate ) + Recorder.NumCommands( kCommandLoadEffect ) +
+		                  Recorder.NumCommands( kCommandRelease );
+
+		fprintf( stderr, "Frame %u\n", frame + 1 );
+		fprintf( stderr, "  %-36s %8s %8s\n", "", "calls", "expected" );
+		success &= CheckNonZero( "scene draws", sceneStats.Draws );
+		success &= CheckNonZero( "post-processed polygon draws", postProcessStats.Draws );
+		success &= CheckCount( "indexed draws", indexedDraws, 2 * (sceneStats.Draws + postProcessStats.Draws) );
+		success &= CheckCount( "instanced draws", Recorder.NumCommands( kCommandDrawIndexedInstanced ),
+		                       2 * (sceneStats.InstancedDraws + postProcessStats.InstancedDraws) );
+		success &= CheckCount( "quad draws (area post-process)", Recorder.NumCommands( kCommandDraw ), 2 );
+		success &= CheckCount( "occlusion tests", Recorder.NumCommands( kCommandBeginOcclusionTest ), 1 );
+		success &= CheckCount( "predication changes", Recorder.NumCommands( kCommandSetPredication ), 2 );
+		success &= CheckCount( "render target changes", Recorder.NumCommands( kCommandSetRenderTarget ), 3 );
+		success &= CheckCount( "render target clears", Recorder.NumCommands( kCommandClearRenderTarget ), 4 );
+		success &= CheckCount( "depth clears", Recorder.NumCommands( kCommandClearDepth ), 1 );
+		success &= CheckCount( "texture copies", Recorder.NumCommands( kCommandCopyTexture ), 3 );
+		success &= CheckCount( "presents", Recorder.NumCommands( kCommandPresent ), 1 );
+		success &= CheckCount( "resources created or released", created, 0 );
+		fprintf( stderr, "\n" );
+	}
+	return success;
+}
+
+
+//-----------------------------------------------------------------------------
+// State cache
+//-----------------------------------------------------------------------------
+
+// Whether a recorded command is an effect variable write, one the state cache may drop
+bool IsVariableWrite( ERenderCommand command )
+{
+	return command == kCommandSetFloat || command == kCommandSetVector ||
+	       command == kCommandSetMatrix || command == kCommandSetTexture;
+}
+
+// Number of variable writes recorded
+TUInt32 NumVariableWrites( const CRecordingRenderDevice& recorder )
+{
+	return recorder.NumCommands( kCommandSetFloat ) + recorder.NumCommands( kCommandSetVector ) +
+	       recorder.NumCommands( kCommandSetMatrix ) + recorder.NumCommands( kCommandSetTexture );
+}
+
+// Record a frame of RenderScene with the state cache off, so every variable write reaches the
+// recorder, then replay its writes and present through a second state cache in front of a second
+// recorder. Checks that the cache counts each write as submitted or elided, that exactly the
+// submitted writes reach the device behind it, and that the elided writes are the ones that
+// repeat the value last written to their variable bit for bit - counted here from the stream
+// alone. Returns false if any check fails
+bool TestStateCacheReplay()
+{
+	StateCache.Enable( false );
+	Recorder.Clear();
+	RenderScene();
+	StateCache.Enable( true );
+
+	CRecordingRenderDevice  replayRecorder;
+	CStateCacheRenderDevice replayCache( &replayRecorder );
+
+	TUInt32 writes = 0;
+	TUInt32 repeats = 0;
+	map<TUInt32, vector<TUInt32> > lastValues; // Command then arguments of last write, by variable
+	SRecordedCommand command;
+	for (TUInt32 position = 0; position < Recorder.StreamSize(); )
+	{
+		position = Recorder.ReadCommand( position, command );
+		const TUInt32* args = command.Args;
+		switch (command.Command)
+		{
+			case kCommandSetFloat:   replayCache.SetFloat( args[0], RecordedFloat( args[1] ) ); break;
+			case kCommandSetVector:  replayCache.SetVector( args[0], reinterpret_cast<const TFloat32*>(args + 1), command.NumArgs - 1 ); break;
+			case kCommandSetMatrix:  replayCache.SetMatrix( args[0], reinterpret_cast<const TFloat32*>(args + 1) ); break;
+			case kCommandSetTexture: replayCache.SetTexture( args[0], args[1] ); break;
+			case kCommandPresent:    replayCache.Present(); break;
+			default: break;
+		}
+		if (!IsVariableWrite( command.Command )) continue;
+
+		// A write repeats if its variable was last given the same kind of value with the same bits.
+		// The cache keeps values up to a matrix in size, and passes longer ones on
+		++writes;
+		vector<TUInt32> value( 1, command.Command );
+		value.insert( value.end(), args + 1, args + command.NumArgs );
+		bool cached = args[0] != kNoRenderHandle && args[0] <= CStateCacheRenderDevice::kMaxCachedHandle &&
+		              command.NumArgs - 1 <= 16;
+		map<TUInt32, vector<TUInt32> >::iterator last = lastValues.find( args[0] );
+		if (cached && last != lastValues.end() && last->second == value)
+		{
+			++repeats;
+		}
+		else if (cached)
+		{
+			lastValues[args[0]] = value;
+		}
+	}
+
+	const SStateCacheStats& stats = replayCache.LastFrameStats();
+	bool success = true;
+	fprintf( stderr, "State cache replay\n" );
+	fprintf( stderr, "  %-36s %8s %8s\n", "", "writes", "expected" );
+	success &= CheckNonZero( "variable writes in frame", writes );
+	success &= CheckCount( "presents replayed", replayRecorder.NumCommands( kCommandPresent ), 1 );
+	success &= CheckCount( "submitted + elided", stats.Submitted + stats.Elided, writes );
+	success &= CheckCount( "writes reaching the device", NumVariableWrites( replayRecorder ), stats.Submitted );
+	success &= CheckCount( "elided (repeated values)", stats.Elided, repeats );
+	success &= CheckNonZero( "elided", stats.Elided );
+	fprintf( stderr, "\n" );
+	return success;
+}
+
+
+//-----------------------------------------------------------------------------
+// Synthetic draws
+//-----------------------------------------------------------------------------
+
+// Draws for the draw queue tests, made from a few materials and meshes rather than a level. Each
+// packet is chosen by a hash of its index, so any range of packets can be made on its own
+const TUInt32 kNumSyntheticPackets = 4000;
+
+struct SSyntheticMaterial
+{
+	ERenderMethod Method;
+	TUInt32       Colour;   // Index into SyntheticColours
+	TRenderHandle Texture;  // Only used by textured methods
+};
+
+struct SSyntheticMesh
+{
+	TRenderHandle VertexBuffer;
+	TInt32        BaseVertex;
+	TRenderHandle IndexBuffer;
+	TUInt32       StartIndex;
+	TUInt32       NumIndices;
+	bool          CanInstance;
+};
+
+SColourRGBA SyntheticColours[2] = { SColourRGBA( 1.0f, 0.5f, 0.25f, 1.0f ), SColourRGBA( 0.2f, 0.4f, 0.8f, 1.0f ) };
+
+SSyntheticMaterial SyntheticMaterials[] =
+{
+	{ PlainColour,  0, 0   },
+	{ PlainColour,  1, 0   },
+	{ PixelLit,     0, 0   },
+	{ PlainTexture, 0, 901 },
+	{ PlainTexture, 0, 902 },
+	{ PixelLitTex,  1, 901 },
+};
+const TUInt32 kNumSyntheticMaterials = sizeof(SyntheticMaterials) / sizeof(SyntheticMaterials[0]);
+
+// Geometry in two pairs of shared vertex and index buffers, as the mesh arena lays it out
+SSyntheticMesh SyntheticMeshes[] =
+{
+	{ 801,   0, 851,   0,  36, true  },
+	{ 801,  24, 851,  36,  36, true  },
+	{ 801,  48, 851,  72,  60, false },
+	{ 802,   0, 852,   0,  36, true  },
+	{ 802, 100, 852,  36, 120, true  },
+	{ 802, 300, 852, 156,  12, false },
+};
+const TUInt32 kNumSyntheticMeshes = sizeof(SyntheticMeshes) / sizeof(SyntheticMeshes[0]);
+
+// World matrix of each packet - their addresses tell the packets apart
+CMatrix4x4 SyntheticMatrices[kNumSyntheticPackets];
+
+// Mix the bits of a packet index
+TUInt32 SyntheticHash( TUInt32 value )
+{
+	value = ((value >> 16) ^ value) * 0x45d9f3b;
+	value = ((value >> 16) ^ value) * 0x45d9f3b;
+	return (value >> 16) ^ value;
+}
+
+// Add the synthetic packets [firstPacket, endPacket) to a queue, in two passes with a few depths
+// each, so many packets have the same key
+void AddSyntheticPackets( CDrawQueue* queue, TUInt32 firstPacket, TUInt32 endPacket )
+{
+	for (TUInt32 packet = firstPacket; packet < endPacket; ++packet)
+	{
+		TUInt32 hash = SyntheticHash( packet );
+		SSyntheticMaterial& material = SyntheticMaterials[(hash >> 4) % kNumSyntheticMaterials];
+		const SSyntheticMesh& mesh = SyntheticMeshes[(hash >> 8) % kNumSyntheticMeshes];
+
+		SyntheticMatrices[packet] = CMatrix4x4::kIdentity;
+		SyntheticMatrices[packet].e30 = static_cast<TFloat32>(packet);
+
+		SDrawPacket drawPacket;
+		drawPacket.Method = material.Method;
+		drawPacket.DiffuseColour = &SyntheticColours[material.Colour];
+		drawPacket.SpecularColour = &SyntheticColours[material.Colour];
+		drawPacket.SpecularPower = 16.0f;
+		drawPacket.NumTextures = NumTexturesUsedByRenderMethod( material.Method );
+		drawPacket.Textures = &material.Texture;
+		drawPacket.WorldMatrix = &SyntheticMatrices[packet];
+		drawPacket.VertexBuffer = mesh.VertexBuffer;
+		drawPacket.VertexSize = 32;
+		drawPacket.BaseVertex = mesh.BaseVertex;
+		drawPacket.VertexLayout = 870 + material.Method;
+		drawPacket.InstancedLayout = mesh.CanInstance ? 880 + material.Method : kNoRenderHandle;
+		drawPacket.IndexBuffer = mesh.IndexBuffer;
+		drawPacket.StartIndex = mesh.StartIndex;
+		drawPacket.NumIndices = mesh.NumIndices;
+		queue->Add( drawPacket, hash & 1, ((hash >> 12) % 8) / 8.0f );
+	}
+}
+
+// Prepare the render methods the synthetic packets use
+bool PrepareSyntheticMethods()
+{
+	for (TUInt32 material = 0; material < kNumSyntheticMaterials; ++material)
+	{
+		if (!PrepareMethod( SyntheticMaterials[material].Method )) return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Draw queue
+//-----------------------------------------------------------------------------
+
+// A packet's key and the order it was added, for the reference sort
+struct SKeyedPacket
+{
+	TUInt64 Key;
+	TUInt32 Packet;
+};
+
+bool KeyLess( const SKeyedPacket& a, const SKeyedPacket& b )
+{
+	return a.Key < b.Key;
+}
+
+// Sort the synthetic packets with the queue's radix sort and check the order is that of
+// std::stable_sort on the same keys - packets with equal keys kept in the order added. Then
+// submit them sorted and unsorted and check the state changes counted against those of the
+// packets' own order, and that sorting needs fewer. Returns false if any check fails
+bool TestDrawQueueSort()
+{
+	CDrawQueue queue;
+	AddSyntheticPackets( &queue, 0, kNumSyntheticPackets );
+
+	vector<SKeyedPacket> expected( queue.NumPackets() );
+	for (TUInt32 packet = 0; packet < queue.NumPackets(); ++packet)
+	{
+		expected[packet].Key = queue.GetPacket( packet ).SortKey;
+		expected[packet].Packet = packet;
+	}
+	stable_sort( expected.begin(), expected.end(), KeyLess );
+
+	// Unsorted first, then sorted
+	SDrawQueueStats unsortedStats;
+	memset( &unsortedStats, 0, sizeof(unsortedStats) );
+	bool success = true;
+	fprintf( stderr, "Draw queue sort (%u synthetic packets)\n", kNumSyntheticPackets );
+	fprintf( stderr, "  %-36s %8s %8s\n", "", "count", "expected" );
+	for (TUInt32 sorted = 0; sorted < 2; ++sorted)
+	{
+		fprintf( stderr, "  %s\n", sorted ? "sorted" : "unsorted" );
+		if (sorted)
+		{
+			queue.Sort();
+			TUInt32 misplaced = 0;
+			for (TUInt32 position = 0; position < queue.NumPackets(); ++position)
+			{
+				if (&queue.GetSortedPacket( position ) != &queue.GetPacket( expected[position].Packet )) ++misplaced;
+			}
+			success &= CheckCount( "packets out of stable_sort order", misplaced, 0 );
+		}
+
+		// State changes from one packet to the next in submit order
+		TUInt32 methods = 0, textures = 0, vertexBuffers = 0, indexBuffers = 0, layouts = 0;
+		for (TUInt32 position = 0; position < queue.NumPackets(); ++position)
+		{
+			const SDrawPacket& packet = queue.GetSortedPacket( position );
+			const SDrawPacket* last = position ? &queue.GetSortedPacket( position - 1 ) : 0;
+			if (!last || packet.Method != last->Method) ++methods;
+			if (!last || packet.NumTextures != last->NumTextures ||
+			    (packet.NumTextures && packet.Textures[0] != last->Textures[0])) ++textures;
+			if (!last || packet.VertexBuffer != last->VertexBuffer) ++vertexBuffers;
+			if (!last || packet.IndexBuffer != last->IndexBuffer) ++indexBuffers;
+			if (!last || packet.VertexLayout != last->VertexLayout) ++layouts;
+		}
+
+		Recorder.Clear();
+		queue.Submit();
+		const SDrawQueueStats& stats = queue.Stats();
+		if (!sorted) unsortedStats = stats;
+		success &= CheckCount( "draws", stats.Draws, kNumSyntheticPackets );
+		success &= CheckCount( "indexed draws (pass then once more)", Recorder.NumCommands( kCommandDrawIndexed ),
+		                       2 * kNumSyntheticPackets );
+		success &= CheckCount( "method changes", stats.MethodChanges, methods );
+		success &= CheckCount( "texture changes", stats.TextureChanges, textures );
+		success &= CheckCount( "buffer changes", stats.BufferChanges, vertexBuffers + indexBuffers + layouts );
+		success &= CheckCount( "vertex buffer binds", Recorder.NumCommands( kCommandSetVertexBuffer ), vertexBuffers );
+		success &= CheckCount( "index buffer binds", Recorder.NumCommands( kCommandSetIndexBuffer ), indexBuffers );
+		success &= CheckCount( "input layout binds", Recorder.NumCommands( kCommandSetInputLayout ), layouts );
+	}
+	success &= CheckLess( "sorted material changes", queue.Stats().MaterialChanges, unsortedStats.MaterialChanges );
+	success &= CheckLess( "sorted buffer changes", queue.Stats().BufferChanges, unsortedStats.BufferChanges );
+	fprintf( stderr, "\n" );
+	return success;
+}
+
+
+// Whether a packet can be drawn as an instance of the same draw as the one before it in submit
+// order - everything but the world matrix the same, and the geometry able to be instanced
+bool InstancesWithLast( const SDrawPacket& packet, const SDrawPacket& last )
+{
+	return packet.InstancedLayout != kNoRenderHandle && packet.InstancedLayout == last.InstancedLayout &&
+	       packet.Method == last.Method && packet.DiffuseColour == last.DiffuseColour &&
+	       packet.Textures == last.Textures && packet.VertexBuffer == last.VertexBuffer &&
+	       packet.BaseVertex == last.BaseVertex && packet.IndexBuffer == last.IndexBuffer &&
+	       packet.StartIndex == last.StartIndex && packet.NumIndices == last.NumIndices;
+}
+
+// Submit the sorted synthetic packets with instancing and check the runs of matching packets
+// found here are drawn with one instanced draw each, their world matrices written to the instance
+// buffer in one update, each draw starting at the next unused instance. The buffer starts too
+// small, so must grow. Then check every packet gets its own draw with instancing off. Returns
+// false if any check fails
+bool TestDrawQueueInstancing()
+{
+	CDrawQueue queue;
+	if (!queue.InitialiseInstancing( 64 )) return false;
+	AddSyntheticPackets( &queue, 0, kNumSyntheticPackets );
+	queue.Sort();
+
+	// Runs of matching packets in submit order
+	TUInt32 runs = 0, instancedRuns = 0, instances = 0;
+	for (TUInt32 position = 0; position < queue.NumPackets(); )
+	{
+		TUInt32 count = 1;
+		while (position + count < queue.NumPackets() &&
+		       InstancesWithLast( queue.GetSortedPacket( position + count ), queue.GetSortedPacket( position ) ))
+		{
+			++count;
+		}
+		++runs;
+		if (count > 1)
+		{
+			++instancedRuns;
+			instances += count;
+		}
+		position += count;
+	}
+
+	Recorder.Clear();
+	queue.Submit();
+	const SDrawQueueStats& stats = queue.Stats();
+
+	// Instance buffer updates, and instanced draws that don't start where the one before ended.
+	// The draw after the passes repeats the last pass's draw, so is skipped
+	TUInt32 updateBytes = 0, drawnInstances = 0, misplacedDraws = 0, nextInstance = 0;
+	SRecordedCommand command, lastCommand;
+	lastCommand.Command = kCommandPresent;
+	for (TUInt32 position = 0; position < Recorder.StreamSize(); )
+	{
+		position = Recorder.ReadCommand( position, command );
+		if (command.Command == kCommandUpdateVertexBuffer)
+		{
+			updateBytes += command.Args[1];
+		}
+		else if (command.Command == kCommandDrawIndexedInstanced && lastCommand.Command != kCommandDrawIndexedInstanced)
+		{
+			if (command.Args[4] != nextInstance) ++misplacedDraws;
+			nextInstance = command.Args[4] + command.Args[1];
+			drawnInstances += command.Args[1];
+		}
+		lastCommand = command;
+	}
+
+	bool success = true;
+	fprintf( stderr, "Draw queue instancing (%u synthetic packets)\n", kNumSyntheticPackets );
+	fprintf( stderr, "  %-36s %8s %8s\n", "", "count", "expected" );
+	success &= CheckNonZero( "runs of matching packets", instancedRuns );
+	success &= CheckCount( "draws", stats.Draws, runs );
+	success &= CheckCount( "instanced draws", stats.InstancedDraws, instancedRuns );
+	success &= CheckCount( "instances", stats.Instances, instances );
+	success &= CheckCount( "indexed draws (pass then once more)", Recorder.NumCommands( kCommandDrawIndexed ),
+	                       2 * (runs - instancedRuns) );
+	success &= CheckCount( "instanced device draws", Recorder.NumCommands( kCommandDrawIndexedInstanced ), 2 * instancedRuns );
+	success &= CheckCount( "instances drawn", drawnInstances, instances );
+	success &= CheckCount( "draws not at next instance", misplacedDraws, 0 );
+	success &= CheckCount( "instance buffer updates", Recorder.NumCommands( kCommandUpdateVertexBuffer ), 1 );
+	success &= CheckCount( "instance bytes written", updateBytes, instances * static_cast<TUInt32>(sizeof(CMatrix4x4)) );
+	success &= CheckCount( "instance buffer grown", Recorder.NumCommands( kCommandCreateDynamicVertexBuffer ), 1 );
+
+	queue.EnableInstancing( false );
+	Recorder.Clear();
+	queue.Submit();
+	fprintf( stderr, "  instancing off\n" );
+	success &= CheckCount( "draws", queue.Stats().Draws, kNumSyntheticPackets );
+	success &= CheckCount( "instanced draws", queue.Stats().InstancedDraws, 0 );
+	success &= CheckCount( "instanced device draws", Recorder.NumCommands( kCommandDrawIndexedInstanced ), 0 );
+	fprintf( stderr, "\n" );
+
+	queue.ReleaseInstancing();
+	return success;
+}
+
+
+// Number of packets of a queue that differ from those of another, in the order added or in submit
+// order. Packets are the same if they have the same key and world matrix
+TUInt32 DifferentPackets( CDrawQueue& queue, CDrawQueue& expected, bool sorted )
+{
+	TUInt32 different = 0;
+	for (TUInt32 packet = 0; packet < queue.NumPackets() && packet < expected.NumPackets(); ++packet)
+	{
+		const SDrawPacket& a = sorted ? queue.GetSortedPacket( packet ) : queue.GetPacket( packet );
+		const SDrawPacket& b = sorted ? expected.GetSortedPacket( packet ) : expected.GetPacket( packet );
+		if (a.SortKey != b.SortKey || a.WorldMatrix != b.WorldMatrix) ++different;
+	}
+	return different;
+}
+
+// Build the synthetic queue on 1 to 12 threads with CThreadDrawLists, twice each so the lists are
+// reused, and check the merged queue has the packets of a queue built on one thread in the same
+// order, before and after sorting. Ranges are forced down to one packet per thread so every
+// thread count is used. Returns false if any check fails
+bool TestThreadDrawLists()
+{
+	CDrawQueue serialQueue;
+	AddSyntheticPackets( &serialQueue, 0, kNumSyntheticPackets );
+	serialQueue.Sort();
+
+	const TUInt32 kMaxThreads = 12;
+	SetNumWorkerThreads( kMaxThreads );
+	CThreadDrawLists threadLists;
+	CDrawQueue queue;
+	TUInt32 wrongSizes = 0, different = 0, differentSorted = 0;
+	for (TUInt32 threads = 1; threads <= kMaxThreads; ++threads)
+	{
+		for (TUInt32 repeat = 0; repeat < 2; ++repeat)
+		{
+			queue.Clear();
+			threadLists.Queue( &queue, kNumSyntheticPackets, threads, []( CDrawQueue* list, TUInt32 first, TUInt32 end )
+			{
+				AddSyntheticPackets( list, first, end );
+			}, 1 );
+			if (queue.NumPackets() != serialQueue.NumPackets()) ++wrongSizes;
+			different += DifferentPackets( queue, serialQueue, false );
+			queue.Sort();
+			differentSorted += DifferentPackets( queue, serialQueue, true );
+		}
+	}
+	SetNumWorkerThreads( 0 );
+
+	bool success = true;
+	fprintf( stderr, "Render list on 1 to %u threads (%u synthetic packets)\n", kMaxThreads, kNumSyntheticPackets );
+	fprintf( stderr, "  %-36s %8s %8s\n", "", "count", "expected" );
+	success &= CheckCount( "merged queues of the wrong size", wrongSizes, 0 );
+	success &= CheckCount( "packets out of order", different, 0 );
+	success &= CheckCount( "packets out of order after sorting", differentSorted, 0 );
+	fprintf( stderr, "\n" );
+	return success;
+}
+
+
+//-----------------------------------------------------------------------------
+// Mesh arena
+//-----------------------------------------------------------------------------
+
+// Data copied into the arena by its tests - the contents don't matter
+TUInt8 ArenaTestData[4096];
+
+// Size argument of the last buffer created on a recorder - bytes for a vertex buffer, indices for
+// an index buffer - or 0 if none was
+TUInt32 LastCreatedSize( const CRecordingRenderDevice& recorder )
+{
+	TUInt32 size = 0;
+	SRecordedCommand command;
+	for (TUInt32 position = 0; position < recorder.StreamSize(); )
+	{
+		position = recorder.ReadCommand( position, command );
+		if (command.Command == kCommandCreateVertexBuffer || command.Command == kCommandCreateIndexBuffer)
+		{
+			size = command.Args[1];
+		}
+	}
+	return size;
+}
+
+// Allocate and free geometry in an arena of small buffers on a null device, checking where each
+// allocation goes and when buffers are created and released: the first gap that fits is taken,
+// freed space merges with the gaps either side, a buffer is released when its last allocation is
+// freed, and an allocation bigger than a buffer gets one of its own. Returns false if any check
+// fails
+bool TestMeshArena()
+{
+	// 1 KB vertex buffers hold 32 vertices of 32 bytes, 256 byte index buffers 128 indices
+	CNullRenderDevice nullDevice;
+	CRecordingRenderDevice recorder( &nullDevice );
+	CMeshArena arena( &recorder, 1024, 256 );
+	bool success = true;
+	fprintf( stderr, "Mesh arena\n" );
+	fprintf( stderr, "  %-36s %8s %8s\n", "", "value", "expected" );
+
+	// First fit: fill a buffer, free the second and fourth quarters, then a small allocation
+	// goes in the first gap and one too big for the rest of that gap in the second
+	SArenaAllocation quarters[4];
+	for (TUInt32 quarter = 0; quarter < 4; ++quarter)
+	{
+		arena.AllocateVertices( ArenaTestData, 8, 32, quarters[quarter] );
+	}
+	success &= CheckCount( "buffers for a full buffer's vertices", arena.Stats().Buffers, 1 );
+	success &= CheckCount( "last quarter offset", quarters[3].Offset, 768 );
+	success &= CheckCount( "gaps in a full buffer", arena.Stats().FreeRanges, 0 );
+	arena.Free( quarters[1] );
+	arena.Free( quarters[3] );
+	SArenaAllocation small, large;
+	arena.AllocateVertices( ArenaTestData, 4, 32, small );
+	arena.AllocateVertices( ArenaTestData, 8, 32, large );
+	success &= CheckCount( "small allocation offset (first gap)", small.Offset, 256 );
+	success &= CheckCount( "large allocation offset (second gap)", large.Offset, 768 );
+	success &= CheckCount( "buffers after refilling gaps", arena.Stats().Buffers, 1 );
+	success &= CheckCount( "gaps left", arena.Stats().FreeRanges, 1 );
+
+	// Neighbour merging: the gap at 384 merges with the third quarter freed after it, then with
+	// the small allocation freed before it, leaving one gap that holds 16 vertices
+	arena.Free( quarters[2] );
+	success &= CheckCount( "gaps after freeing after a gap", arena.Stats().FreeRanges, 1 );
+	arena.Free( small );
+	success &= CheckCount( "gaps after freeing before a gap", arena.Stats().FreeRanges, 1 );
+	SArenaAllocation merged;
+	arena.AllocateVertices( ArenaTestData, 16, 32, merged );
+	success &= CheckCount( "allocation in merged gap offset", merged.Offset, 256 );
+	success &= CheckCount( "buffers after merging", arena.Stats().Buffers, 1 );
+
+	// A gap freed between two gaps merges with both
+	arena.Free( merged );
+	success &= CheckCount( "gaps after freeing it again", arena.Stats().FreeRanges, 1 );
+	SArenaAllocation middle;
+	arena.AllocateVertices( ArenaTestData, 8, 32, middle );
+	arena.Free( quarters[0] );
+	success &= CheckCount( "gaps either side of an allocation", arena.Stats().FreeRanges, 2 );
+	SArenaAllocation keep;
+	arena.AllocateVertices( ArenaTestData, 1, 32, keep ); // Keeps the buffer alive
+	arena.Free( middle );
+	success &= CheckCount( "gaps after freeing between two", arena.Stats().FreeRanges, 1 );
+	success &= CheckCount( "bytes used", static_cast<TUInt32>(arena.Stats().BytesUsed), 32 + 256 );
+
+	// Whole-buffer release: freeing the last allocations releases the buffer, and freeing an
+	// allocation that was already freed does nothing
+	recorder.Clear();
+	arena.Free( keep );
+	success &= CheckCount( "releases with allocations left", recorder.NumCommands( kCommandRelease ), 0 );
+	arena.Free( large );
+	success &= CheckCount( "releases of an emptied buffer", recorder.NumCommands( kCommandRelease ), 1 );
+	success &= CheckCount( "buffers after emptying", arena.Stats().Buffers, 0 );
+	arena.Free( large );
+	success &= CheckCount( "releases freeing twice", recorder.NumCommands( kCommandRelease ), 1 );
+
+	// Oversize: allocations bigger than a buffer get a buffer of their own size, other sizes of
+	// vertex get a pool of buffers rounded down to whole vertices
+	recorder.Clear();
+	SArenaAllocation bigVertices, bigIndices, otherSize;
+	arena.AllocateVertices( ArenaTestData, 64, 32, bigVertices );
+	success &= CheckCount( "oversize vertex buffer bytes", LastCreatedSize( recorder ), 64 * 32 );
+	arena.AllocateIndices( reinterpret_cast<const TUInt16*>(ArenaTestData), 200, bigIndices );
+	success &= CheckCount( "oversize index buffer indices", LastCreatedSize( recorder ), 200 );
+	arena.AllocateVertices( ArenaTestData, 2, 24, otherSize );
+	success &= CheckCount( "24-byte vertex buffer bytes", LastCreatedSize( recorder ), 1024 - 1024 % 24 );
+	SArenaAllocation afterBig;
+	arena.AllocateVertices( ArenaTestData, 1, 32, afterBig );
+	success &= CheckCount( "buffers after a full oversize one", arena.Stats().Buffers, 4 );
+	success &= CheckCount( "pools", arena.Stats().Pools, 3 );
+	arena.Free( bigVertices );
+	arena.Free( bigIndices );
+	success &= CheckCount( "releases of oversize buffers", recorder.NumCommands( kCommandRelease ), 2 );
+
+	arena.Release();
+	success &= CheckCount( "buffers after release", arena.Stats().Buffers, 0 );
+	success &= CheckCount( "buffers created and released",
+	                       recorder.NumCommands( kCommandCreateVertexBuffer ) + recorder.NumCommands( kCommandCreateIndexBuffer ),
+	                       recorder.NumCommands( kCommandRelease ) );
+	fprintf( stderr, "\n" );
+	return success;
+}
+
+
+//-----------------------------------------------------------------------------
+// Snapshot post-process bucket
+//-----------------------------------------------------------------------------
+
+// Queue a snapshot frame's scene then its post-processed polygons, and check that there is one
+// post-process packet for each visible entity with a post-processed sub-mesh, in bucket order,
+// each using the world matrix of the entity the sub-mesh belongs to. Returns false if any check
+// fails
+bool CheckSnapshotPostProcess( const char* label, CEntityManager& entities, CCamera& camera,
+                               const vector<TEntityUID>& expected )
+{
+	CSceneSnapshot snapshot;
+	snapshot.Capture( entities, NULL, 0, 1, 0.0 );
+	CSnapshotFrame frame;
+	frame.Build( snapshot, snapshot, 1.0f );
+
+	CDrawQueue sceneQueue, postProcessQueue;
+	frame.Queue( &sceneQueue, &camera );
+	frame.QueuePostProcess( &postProcessQueue, &camera );
+
+	TUInt32 numPackets = postProcessQueue.NumPackets();
+	TUInt32 matching = 0;
+	for (TUInt32 packet = 0; packet < numPackets && packet < expected.size(); ++packet)
+	{
+		CMatrix4x4 matrix;
+		if (frame.GetEntityMatrix( expected[packet], matrix ) &&
+		    memcmp( postProcessQueue.GetPacket( packet ).WorldMatrix, &matrix, sizeof(CMatrix4x4) ) == 0)
+		{
+			++matching;
+		}
+	}
+
+	fprintf( stderr, "  %s\n", label );
+	bool success = CheckCount( "post-process packets", numPackets, static_cast<TUInt32>(expected.size()) );
+	success &= CheckCount( "packets with their entity's matrix", matching, static_cast<TUInt32>(expected.size()) );
+	success &= CheckNonZero( "scene packets", sceneQueue.NumPackets() );
+	return success;
+}
+
+// Make a scene of post-processed blocks in front of and behind a camera among cubes with no
+// post-processed materials, and check the post-processed polygons queued from a snapshot of it:
+// only the visible blocks, from the snapshot's copy of the post-process bucket. Destroying an
+// entity moves the last entity into its place, which the copy's entity indices must follow.
+// Returns false if any check fails
+bool TestSnapshotPostProcess()
+{
+	CEntityManager entities;
+	entities.CreateTemplate( "Object", "TestBlock", "Block.x" );
+	entities.CreateTemplate( "Object", "TestCube", "Cube.x" );
+
+	// Blocks are created first, second and last, so destroying the first moves the last
+	vector<TEntityUID> visible;
+	visible.push_back( entities.CreateEntity( "TestBlock", "", CVector3( -60.0f, 0.0f, 200.0f ) ) );
+	entities.CreateEntity( "TestBlock", "", CVector3( 0.0f, 0.0f, -200.0f ) );
+	entities.CreateEntity( "TestCube", "", CVector3( 60.0f, 0.0f, 200.0f ) );
+	visible.push_back( entities.CreateEntity( "TestBlock", "", CVector3( -20.0f, 0.0f, 200.0f ) ) );
+	entities.CreateEntity( "TestCube", "", CVector3( 0.0f, 0.0f, -200.0f ) );
+	entities.CreateEntity( "TestBlock", "", CVector3( 40.0f, 0.0f, -200.0f ) );
+	visible.push_back( entities.CreateEntity( "TestBlock", "", CVector3( 20.0f, 0.0f, 200.0f ) ) );
+
+	CCamera camera;
+	camera.CalculateMatrices();
+	camera.CalculateFrustrumPlanes();
+
+	fprintf( stderr, "Snapshot post-process bucket\n" );
+	fprintf( stderr, "  %-36s %8s %8s\n", "", "value", "expected" );
+	bool success = CheckCount( "post-process items", entities.NumPostProcessItems(), 5 );
+	success &= CheckSnapshotPostProcess( "all entities", entities, camera, visible );
+
+	entities.DestroyEntity( visible[0] );
+	visible.erase( visible.begin() );
+	success &= CheckSnapshotPostProcess( "after destroying the first", entities, camera, visible );
+	fprintf( stderr, "\n" );
+
+	entities.DestroyAllEntities();
+	entities.DestroyAllTemplates();
+	return success;
+}
+
+
+//-----------------------------------------------------------------------------
+// Tests
+//-----------------------------------------------------------------------------
+
+int RunRenderTests()
+{
+	RenderDevice = &StateCache;
+	MeshArena.SetDevice( RenderDevice );
+	VertexFormats.SetDevice( RenderDevice );
+	TextureCache.SetDevice( RenderDevice );
+	if (!SceneSetup() || !PostProcessSetup())
+	{
+		fprintf( stderr, "Failed to set up the scene - run from the folder holding Entities.xml and Media\n" );
+		return 1;
+	}
+
+	bool success = TestRenderScene();
+	success &= TestStateCacheReplay();
+	success &= PrepareSyntheticMethods() && TestDrawQueueSort();
+	success &= TestDrawQueueInstancing();
+	success &= TestThreadDrawLists();
+	success &= TestMeshArena();
+	success &= TestSnapshotPostProcess();
+
+	PostProcessShutdown();
+	SceneShutdown();
+	MeshArena.Release();
+	VertexFormats.Release();
+	TextureCache.ReleaseAll();
+
+	fprintf( stderr, success ? "All checks passed\n" : "Checks FAILED\n" );
+	return success ? 0 : 1;
+}
+
+
+} // namespace gen
+
+
+int main()
+{
+	return gen::RunRenderTests();
+}
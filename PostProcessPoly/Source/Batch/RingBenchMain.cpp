@@ -0,0 +1,449 @@
+/*******************************************
+	RingBenchMain.cpp
+
+	Throughput and latency benchmark for frames
+	passed between processes in a shared ring
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#else
+	#include <unistd.h>
+	#include <sys/wait.h>
+#endif
+
+#include "Defines.h"
+#include "Image.h"
+#include "FilterChain.h"
+#include "SharedFrameRing.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+enum ERingRole
+{
+	kRoleBoth,     // Create the ring, start a consumer process and produce
+	kRoleProducer, // Create the ring and produce (consumer started separately)
+	kRoleConsumer, // Open an existing ring and consume
+};
+
+struct SRingBenchOptions
+{
+	ERingRole Role;
+	string    Name;
+	TUInt32   Slots;
+	TUInt32   Width;
+	TUInt32   Height;
+	TUInt32   Frames;
+	TFloat32  FrameRate;  // Producer pacing, 0 for as fast as possible
+	string    Chain;      // Filters run by the consumer, empty for transport only
+	bool      Touch;      // Producer writes every pixel, as a renderer would
+
+	SRingBenchOptions()
+	{
+		Role = kRoleBoth;
+		Name = "PostProcessRing";
+		Slots = 4;
+		Width = 3840;
+		Height = 2160;
+		Frames = 600;
+		FrameRate = 0.0f;
+		Touch = false;
+	}
+};
+
+void PrintUsage()
+{
+	fprintf( stderr,
+		"Usage: PostProcessRingBench [options]\n"
+		"\n"
+		"  --role <both|producer|consumer>  Process role (default both: starts its own consumer)\n"
+		"  --name <name>      Shared memory name (default PostProcessRing)\n"
+		"  --slots <n>        Frame slots in the ring (default 4)\n"
+		"  --size <WxH>       Frame size (default 3840x2160)\n"
+		"  --frames <n>       Frames to send (default 600)\n"
+		"  --fps <rate>       Producer frame rate, 0 for unlimited (default 0)\n"
+		"  --chain <list>     Filters the consumer runs on each frame (default none)\n"
+		"  --touch            Producer writes every pixel of each frame\n" );
+}
+
+// Parse the command line. Returns false on error, having printed a message
+bool ParseOptions( int argc, char* argv[], SRingBenchOptions& options )
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : 0;
+		bool usedValue = true;
+		if (arg == "--touch")
+		{
+			options.Touch = true;
+			usedValue = false;
+		}
+		else if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		else if (!value)
+		{
+			fprintf( stderr, "Missing value for %s\n", arg.c_str() );
+			return false;
+		}
+		else if (arg == "--role")
+		{
+			string role = value;
+			if (role == "both")          options.Role = kRoleBoth;
+			else if (role == "producer") options.Role = kRoleProducer;
+			else if (role == "consumer") options.Role = kRoleConsumer;
+			else
+			{
+				fprintf( stderr, "Unknown role '%s'\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--name")
+		{
+			options.Name = value;
+		}
+		else if (arg == "--slots")
+		{
+			options.Slots = static_cast<TUInt32>(atoi( value ));
+		}
+		else if (arg == "--size")
+		{
+			if (sscanf( value, "%ux%u", &options.Width, &options.Height ) != 2)
+			{
+				fprintf( stderr, "Bad size '%s', expected WxH\n", value );
+				return false;
+			}
+		}
+		else if (arg == "--frames")
+		{
+			options.Frames = static_cast<TUInt32>(atoi( value ));
+		}
+		else if (arg == "--fps")
+		{
+			options.FrameRate = static_cast<TFloat32>(atof( value ));
+		}
+		else if (arg == "--chain")
+		{
+			options.Chain = value;
+		}
+		else
+		{
+			fprintf( stderr, "Unknown option %s\n", arg.c_str() );
+			return false;
+		}
+		if (usedValue) ++i;
+	}
+
+	if (options.Slots == 0 || options.Width == 0 || options.Height == 0 || options.Frames == 0)
+	{
+		fprintf( stderr, "--slots, --size and --frames must be positive\n" );
+		return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Statistics
+//-----------------------------------------------------------------------------
+
+// Print percentiles of a set of latencies given in nanoseconds
+void PrintLatencies( const char* label, vector<TUInt64>& latencies )
+{
+	if (latencies.empty()) return;
+	sort( latencies.begin(), latencies.end() );
+	const size_t count = latencies.size();
+	fprintf( stderr, "  %-10s p50 %8.3fms  p90 %8.3fms  p99 %8.3fms  max %8.3fms\n", label,
+	         latencies[count / 2] * 1e-6, latencies[(count * 9) / 10] * 1e-6,
+	         latencies[(count * 99) / 100] * 1e-6, latencies[count - 1] * 1e-6 );
+}
+
+// Time to copy one frame in this process, the least a copying transport would add per frame
+TFloat64 MeasureFrameCopy( TUInt32 width, TUInt32 height )
+{
+	CImage source( width, height ), dest( width, height );
+	source.Fill( 1, 2, 3, 4 );
+	dest.CopyFrom( source ); // Fault in the pages
+
+	const int repeats = 10;
+	TUInt64 start = CSharedFrameRing::RingTime();
+	for (int i = 0; i < repeats; ++i)
+	{
+		dest.CopyFrom( source );
+	}
+	return (CSharedFrameRing::RingTime() - start) * 1e-6 / repeats;
+}
+
+
+//-----------------------------------------------------------------------------
+// Producer and consumer
+//-----------------------------------------------------------------------------
+
+// Mark a frame so the consumer can check it received the right pixels
+void StampFrame( CImage& pixels, TUInt32 index, bool touch )
+{
+	if (touch)
+	{
+		TUInt8 shade = static_cast<TUInt8>(index);
+		pixels.Fill( shade, shade, shade, 255 );
+	}
+	memcpy( pixels.Row( pixels.Height() - 1 ), &index, sizeof(index) );
+	memcpy( pixels.Row( 0 ), &index, sizeof(index) );
+}
+
+bool CheckStamp( const CImage& pixels, TUInt32 index )
+{
+	TUInt32 first, last;
+	memcpy( &first, pixels.Row( 0 ), sizeof(first) );
+	memcpy( &last, pixels.Row( pixels.Height() - 1 ), sizeof(last) );
+	return first == index && last == index;
+}
+
+// Write frames into the ring with filter steps from an animated chain. Returns an exit code
+int RunProducer( const SRingBenchOptions& options, CSharedFrameRing& ring, const CFilterChain& chain )
+{
+	CFilterAnimation animation;
+	animation.StartRipple( options.Width * 0.5f, options.Height * 0.5f );
+	const TFloat32 updateTime = 1.0f / ((options.FrameRate > 0.0f) ? options.FrameRate : 60.0f);
+
+	typedef chrono::steady_clock Clock;
+	Clock::time_point start = Clock::now();
+	vector<SFilterStep> steps;
+	CImage pixels;
+	TUInt64 blockedTime = 0;
+	TUInt32 sent = 0;
+	for (; sent < options.Frames; ++sent)
+	{
+		if (options.FrameRate > 0.0f)
+		{
+			this_thread::sleep_until( start + chrono::duration_cast<Clock::duration>( chrono::duration<TFloat64>( sent / options.FrameRate ) ) );
+		}
+
+		// Time waiting for a free slot shows when the consumer is the bottleneck
+		TUInt64 waitStart = CSharedFrameRing::RingTime();
+		SRingFrame* frame = ring.BeginWrite( options.Width, options.Height, pixels, 10000 );
+		if (!frame) break;
+		blockedTime += CSharedFrameRing::RingTime() - waitStart;
+
+		StampFrame( pixels, frame->Index, options.Touch );
+		if (sent > 0) animation.Update( updateTime );
+		chain.SelectSteps( animation, options.Width, options.Height, steps );
+		ring.SetSteps( frame, steps );
+		ring.EndWrite();
+	}
+	ring.Close();
+
+	TFloat64 seconds = chrono::duration<TFloat64>( Clock::now() - start ).count();
+	fprintf( stderr, "Producer: sent %u frames in %.2fs (%.1f fps), blocked on a full ring %.1f%% of the time\n",
+	         sent, seconds, sent / seconds, blockedTime * 1e-9 * 100.0 / seconds );
+	return (sent == options.Frames) ? 0 : 1;
+}
+
+// Read frames from the ring, running the filter steps each carries on the pixels in place.
+// Returns an exit code
+int RunConsumer( const SRingBenchOptions& options, CSharedFrameRing& ring, const CFilterChain& chain )
+{
+	vector<SFilterStep> steps;
+	vector<TUInt64> transferLatencies;
+	vector<TUInt64> totalLatencies;
+	transferLatencies.reserve( options.Frames );
+	totalLatencies.reserve( options.Frames );
+
+	CImage pixels, work0, work1;
+	TUInt64 start = 0;
+	TUInt64 pixelBytes = 0;
+	TUInt32 received = 0;
+	TUInt32 errors = 0;
+	for (;;)
+	{
+		const SRingFrame* frame = ring.BeginRead( pixels, 10000 );
+		if (!frame) break;
+		TUInt64 now = CSharedFrameRing::RingTime();
+		if (received == 0) start = frame->SubmitTime;
+		transferLatencies.push_back( now - frame->SubmitTime );
+
+		if (frame->Index != received || !CheckStamp( pixels, frame->Index )) ++errors;
+
+		ring.GetSteps( frame, steps );
+		chain.AttachMaps( steps );
+		const CImage* result;
+		if (!CFilterChain::Run( steps, pixels, work0, work1, result )) ++errors;
+
+		totalLatencies.push_back( CSharedFrameRing::RingTime() - frame->SubmitTime );
+		pixelBytes += static_cast<TUInt64>(frame->Width) * frame->Height * 4;
+		ring.EndRead();
+		++received;
+	}
+	if (!ring.IsFinished())
+	{
+		fprintf( stderr, "Consumer: timed out waiting for the producer\n" );
+		++errors;
+	}
+
+	TFloat64 seconds = (received > 0) ? (CSharedFrameRing::RingTime() - start) * 1e-9 : 0.0;
+	if (seconds <= 0.0) seconds = 1e-9;
+	fprintf( stderr, "Consumer: received %u frames in %.2fs (%.1f fps, %.2f GB/s of pixels), %u errors\n",
+	         received, seconds, received / seconds, pixelBytes / seconds * 1e-9, errors );
+	fprintf( stderr, "Latency from publish:\n" );
+	PrintLatencies( "acquired", transferLatencies );
+	PrintLatencies( "processed", totalLatencies );
+	return (errors == 0 && received == options.Frames) ? 0 : 1;
+}
+
+
+//-----------------------------------------------------------------------------
+// Processes
+//-----------------------------------------------------------------------------
+
+int RunRingBench( const SRingBenchOptions& options, int argc, char* argv[] );
+
+// Start a consumer for the ring in a separate process. On POSIX systems the process is forked
+// and runs the consumer directly; on Windows this executable is started again in the consumer
+// role. Returns false on failure
+bool StartConsumerProcess( const SRingBenchOptions& options, int argc, char* argv[], void*& process )
+{
+#if defined(_WIN32)
+	char path[MAX_PATH];
+	if (!GetModuleFileNameA( 0, path, MAX_PATH )) return false;
+	string commandLine = string( "\"" ) + path + "\"";
+	for (int i = 1; i < argc; ++i)
+	{
+		if (string( argv[i] ) == "--role")
+		{
+			++i;
+			continue;
+		}
+		commandLine += string( " \"" ) + argv[i] + "\"";
+	}
+	commandLine += " --role consumer --name \"" + options.Name + "\"";
+
+	STARTUPINFOA startup;
+	memset( &startup, 0, sizeof(startup) );
+	startup.cb = sizeof(startup);
+	PROCESS_INFORMATION info;
+	vector<char> buffer( commandLine.begin(), commandLine.end() );
+	buffer.push_back( 0 );
+	if (!CreateProcessA( 0, &buffer[0], 0, 0, FALSE, 0, 0, 0, &startup, &info )) return false;
+	CloseHandle( info.hThread );
+	process = info.hProcess;
+	return true;
+#else
+	fflush( stderr );
+	pid_t child = fork();
+	if (child < 0) return false;
+	if (child == 0)
+	{
+		// The child opens the ring by name as an unrelated process would
+		SRingBenchOptions consumerOptions = options;
+		consumerOptions.Role = kRoleConsumer;
+		_exit( RunRingBench( consumerOptions, argc, argv ) );
+	}
+	process = reinterpret_cast<void*>(static_cast<size_t>(child));
+	return true;
+#endif
+}
+
+// Wait for the consumer process and return its exit code
+int WaitConsumerProcess( void* process )
+{
+#if defined(_WIN32)
+	WaitForSingleObject( static_cast<HANDLE>(process), INFINITE );
+	DWORD exitCode = 1;
+	GetExitCodeProcess( static_cast<HANDLE>(process), &exitCode );
+	CloseHandle( static_cast<HANDLE>(process) );
+	return static_cast<int>(exitCode);
+#else
+	int status = 0;
+	if (waitpid( static_cast<pid_t>(reinterpret_cast<size_t>(process)), &status, 0 ) < 0) return 1;
+	return WIFEXITED( status ) ? WEXITSTATUS( status ) : 1;
+#endif
+}
+
+
+// Run the benchmark in the role given by the options. Returns an exit code
+int RunRingBench( const SRingBenchOptions& options, int argc, char* argv[] )
+{
+	CFilterChain chain;
+	string error;
+	if (!chain.Parse( options.Chain, error ))
+	{
+		fprintf( stderr, "%s\n", error.c_str() );
+		return 1;
+	}
+	SFilterMaps maps;
+	if (options.Role == kRoleConsumer)
+	{
+		LoadFilterMaps( "", &chain, maps );
+		chain.SetMaps( maps );
+	}
+
+	CSharedFrameRing ring;
+	if (options.Role == kRoleConsumer)
+	{
+		// The producer may not have created the ring yet
+		for (int attempt = 0; !ring.Open( options.Name ); ++attempt)
+		{
+			if (attempt == 100)
+			{
+				fprintf( stderr, "Cannot open ring '%s'\n", options.Name.c_str() );
+				return 1;
+			}
+			this_thread::sleep_for( chrono::milliseconds( 100 ) );
+		}
+		return RunConsumer( options, ring, chain );
+	}
+
+	if (!ring.Create( options.Name, options.Slots, options.Width, options.Height ))
+	{
+		fprintf( stderr, "Cannot create ring '%s' of %u %ux%u slots\n", options.Name.c_str(),
+		         options.Slots, options.Width, options.Height );
+		return 1;
+	}
+	fprintf( stderr, "Ring '%s': %u slots of %ux%u, copying one frame takes %.3fms\n", options.Name.c_str(),
+	         options.Slots, options.Width, options.Height, MeasureFrameCopy( options.Width, options.Height ) );
+
+	void* consumer = 0;
+	if (options.Role == kRoleBoth && !StartConsumerProcess( options, argc, argv, consumer ))
+	{
+		fprintf( stderr, "Cannot start consumer process\n" );
+		return 1;
+	}
+	int result = RunProducer( options, ring, chain );
+	if (consumer)
+	{
+		int consumerResult = WaitConsumerProcess( consumer );
+		if (result == 0) result = consumerResult;
+	}
+	return result;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	gen::SRingBenchOptions options;
+	if (!gen::ParseOptions( argc, argv, options ))
+	{
+		gen::PrintUsage();
+		return 1;
+	}
+	return gen::RunRingBench( options, argc, argv );
+}
@@ -0,0 +1,558 @@
+/*******************************************
+	SceneBenchMain.cpp
+
+	Benchmark of the scene render pass with no
+	graphics API: loads a level into a null
+	render device, then times and counts the
+	device calls of each way of rendering it
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <set>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "Camera.h"
+#include "Light.h"
+#include "EntityManager.h"
+#include "CParseLevel.h"
+#include "RenderMethod.h"
+#include "DrawQueue.h"
+#include "NullRenderDevice.h"
+#include "RecordingRenderDevice.h"
+#include "MeshArena.h"
+#include "VertexFormat.h"
+#include "TextureCache.h"
+#include "Parallel.h"
+#include "SceneSnapshot.h"
+#include "SimulationThread.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Globals used by the scene code (defined in MainApp.cpp in the application)
+//-----------------------------------------------------------------------------
+
+IRenderDevice*        RenderDevice = NULL;
+CMeshArena            MeshArena;
+CVertexFormatRegistry VertexFormats;
+CTextureCache         TextureCache;
+
+extern const string MediaFolder = "Media\\";
+extern const string ShaderFolder = "Source\\Render\\";
+
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+struct SSceneBenchOptions
+{
+	string   Level;
+	TUInt32  Entities; // Total entities wanted, made up with copies of the level's objects
+	TFloat32 Spread;   // Distance in front of the camera the copies are spread over
+	TUInt32  Repeats;
+	TUInt32  Seed;
+	TUInt32  Threads;  // Most threads the render list is built with, 0 for the worker thread count
+	TFloat32 Duration; // Seconds each way of running the simulation is timed for
+	TFloat32 TickRate; // Simulation ticks per second when run in real time
+
+	SSceneBenchOptions()
+	{
+		Level = "Entities.xml";
+		Entities = 0;
+		Spread = 2000.0f;
+		Repeats = 20;
+		Seed = 1;
+		Threads = 0;
+		Duration = 2.0f;
+		TickRate = 60.0f;
+	}
+};
+
+void PrintUsage()
+{
+	fprintf( stderr,
+		"Usage: PostProcessSceneBench [options]\n"
+		"\n"
+		"  --level <file>     Level to load (default Entities.xml)\n"
+		"  --entities <n>     Make the level up to n entities with copies of its scenery and\n"
+		"                     objects placed in front of the camera (default: the level as it is)\n"
+		"  --spread <d>       Distance in front of the camera the copies cover (default 2000)\n"
+		"  --repeats <n>      Frames timed for each way of rendering, the median is reported (default 20)\n"
+		"  --seed <n>         Seed for placing the copies (default 1)\n"
+		"  --threads <n>      Time building the render list with 1 to n threads (default: hardware threads)\n"
+		"  --duration <s>     Seconds each way of running the simulation is timed for (default 2)\n"
+		"  --tick-rate <hz>   Simulation ticks per second when run in real time (default 60)\n"
+		"\n"
+		"e.g. --entities 50000 for a large synthetic level\n" );
+}
+
+// Parse the command line. Returns false on error, having printed a message
+bool ParseOptions( int argc, char* argv[], SSceneBenchOptions& options )
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h")
+		{
+			return false;
+		}
+		if (i + 1 >= argc)
+		{
+			fprintf( stderr, "Missing value for %s\n", arg.c_str() );
+			return false;
+		}
+		const char* value = argv[++i];
+		if      (arg == "--level")    options.Level = value;
+		else if (arg == "--entities") options.Entities = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--spread")   options.Spread = static_cast<TFloat32>(atof( value ));
+		else if (arg == "--repeats")  options.Repeats = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--seed")     options.Seed = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--threads")  options.Threads = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--duration") options.Duration = static_cast<TFloat32>(atof( value ));
+		else if (arg == "--tick-rate") options.TickRate = static_cast<TFloat32>(atof( value ));
+		else
+		{
+			fprintf( stderr, "Unknown option %s\n", arg.c_str() );
+			return false;
+		}
+	}
+
+	if (options.Repeats == 0 || options.Spread <= 0.0f || options.Duration <= 0.0f || options.TickRate <= 0.0f)
+	{
+		fprintf( stderr, "--repeats, --spread, --duration and --tick-rate must be positive\n" );
+		return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Timing
+//-----------------------------------------------------------------------------
+
+// Median time in milliseconds of a number of calls to a function
+template <class TFunction>
+TFloat64 MedianTime( TUInt32 repeats, TFunction function )
+{
+	typedef chrono::steady_clock Clock;
+	vector<TFloat64> times( repeats );
+	function(); // Warm up, faulting in any memory allocated on first use
+	for (TUInt32 i = 0; i < repeats; ++i)
+	{
+		Clock::time_point start = Clock::now();
+		function();
+		times[i] = chrono::duration<TFloat64, milli>( Clock::now() - start ).count();
+	}
+	sort( times.begin(), times.end() );
+	return times[repeats / 2];
+}
+
+
+//-----------------------------------------------------------------------------
+// Scene
+//-----------------------------------------------------------------------------
+
+CEntityManager EntityManager;
+CParseLevel    LevelParser( &EntityManager );
+CDrawQueue     SceneQueue;
+
+// Camera and lights as set up by SceneSetup in PostProcessPoly.cpp
+const TInt32 NumLights = 2;
+CLight*  Lights[NumLights];
+CCamera* MainCamera;
+const SColourRGBA AmbientColour( 0.3f, 0.3f, 0.4f, 1.0f );
+
+// Load the level and add any copies of its objects asked for. Returns false on error
+bool SceneSetup( const SSceneBenchOptions& options )
+{
+	if (!InitialiseMethods()) return false;
+	if (!SceneQueue.InitialiseInstancing( 1024 )) return false;
+	if (!LevelParser.ParseFile( options.Level )) return false;
+
+	MainCamera = new CCamera( CVector3( 25, 30, -115 ), CVector3( ToRadians( 8.0f ), ToRadians( -35.0f ), 0 ) );
+	MainCamera->SetNearFarClip( 2.0f, 300000.0f );
+	MainCamera->SetAspect( 16.0f / 9.0f );
+	MainCamera->CalculateMatrices();
+	MainCamera->CalculateFrustrumPlanes();
+
+	Lights[0] = new CLight( CVector3( -10000.0f, 6000.0f, 0000.0f ), SColourRGBA( 1.0f, 0.8f, 0.6f ) * 12000, 20000.0f );
+	Lights[1] = new CLight( CVector3( 0.0f, 30.0f, 50.0f ), SColourRGBA( 0.0f, 0.2f, 1.0f ) * 50, 100.0f );
+
+	// Templates of the scenery and objects in the level - the environment (stars, floor, planets)
+	// is not copied
+	vector<string> copyTemplates;
+	for (TUInt32 entity = 0; entity < EntityManager.NumEntities(); ++entity)
+	{
+		CEntityTemplate* entityTemplate = EntityManager.GetEntityAtIndex( entity )->Template();
+		if (entityTemplate->GetType() == "Scenery" || entityTemplate->GetType() == "Object")
+		{
+			copyTemplates.push_back( entityTemplate->GetName() );
+		}
+	}
+
+	// Copies go on the ground in front of the camera, in a wedge a little wider than the view
+	if (options.Entities > EntityManager.NumEntities())
+	{
+		if (copyTemplates.empty())
+		{
+			fprintf( stderr, "%s has no scenery or objects to copy\n", options.Level.c_str() );
+			return false;
+		}
+		CVector3 forward = MainCamera->Matrix().ZAxis();
+		forward.y = 0.0f;
+		forward.Normalise();
+		CVector3 right( forward.z, 0.0f, -forward.x );
+
+		srand( options.Seed );
+		while (EntityManager.NumEntities() < options.Entities)
+		{
+			TFloat32 distance = options.Spread * (rand() + 1.0f) / (RAND_MAX + 1.0f);
+			TFloat32 across = distance * (rand() / static_cast<TFloat32>(RAND_MAX) - 0.5f);
+			CVector3 position = MainCamera->Position() + forward * distance + right * across;
+			position.y = 0.0f;
+			CVector3 rotation( 0.0f, ToRadians( static_cast<TFloat32>(rand() % 360) ), 0.0f );
+			EntityManager.CreateEntity( copyTemplates[rand() % copyTemplates.size()], "", position, rotation );
+		}
+	}
+	return true;
+}
+
+// Release everything in the scene
+void SceneShutdown()
+{
+	ReleaseMethods();
+	SceneQueue.ReleaseInstancing();
+	for (TInt32 light = NumLights - 1; light >= 0; --light)
+	{
+		delete Lights[light];
+	}
+	delete MainCamera;
+	EntityManager.DestroyAllEntities();
+	EntityManager.DestroyAllTemplates();
+}
+
+
+//-----------------------------------------------------------------------------
+// Render modes
+//-----------------------------------------------------------------------------
+
+// Ways of rendering the scene pass that are compared
+enum ESceneRenderMode
+{
+	kRenderEntityOrder,    // Each entity renders itself in turn (RenderAllEntities)
+	kRenderQueueUnsorted,  // Draw queue in the order of the entities
+	kRenderQueueSorted,    // Draw queue sorted by state, each packet drawn on its own
+	kRenderQueueInstanced, // Draw queue sorted by state, runs of matching packets instanced (as RenderBaseScene)
+	kNumSceneRenderModes
+};
+
+const char* const SceneRenderModeNames[kNumSceneRenderModes] =
+{
+	"entity order",
+	"queue unsorted",
+	"queue sorted",
+	"queue instanced",
+};
+
+// Render the scene pass in the given way to the global render device
+void RenderScenePass( ESceneRenderMode mode )
+{
+	SetCamera( MainCamera );
+	SetAmbientLight( AmbientColour );
+	SetLights( &Lights[0] );
+
+	if (mode == kRenderEntityOrder)
+	{
+		EntityManager.RenderAllEntities( MainCamera );
+	}
+	else
+	{
+		SceneQueue.Clear();
+		EntityManager.QueueAllEntities( &SceneQueue, MainCamera );
+		if (mode != kRenderQueueUnsorted) SceneQueue.Sort();
+		SceneQueue.EnableInstancing( mode == kRenderQueueInstanced );
+		SceneQueue.Submit();
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Simulation
+//-----------------------------------------------------------------------------
+
+// Stand-in for the game's simulation: the entity updates, plus a turn of every fourth entity so
+// that snapshots differ from tick to tick and interpolation has work to do
+class CBenchSimulation : public ISimulation
+{
+public:
+	void Tick( TFloat32 tickTime )
+	{
+		EntityManager.UpdateAllEntities( tickTime );
+		for (TUInt32 entity = 0; entity < EntityManager.NumEntities(); entity += 4)
+		{
+			EntityManager.GetEntityAtIndex( entity )->Matrix().RotateY( ToRadians( 30.0f ) * tickTime );
+		}
+	}
+
+	void Capture( CSceneSnapshot& snapshot, TUInt32 tick, TFloat64 time )
+	{
+		snapshot.Capture( EntityManager, Lights, NumLights, tick, time );
+	}
+};
+
+// Ways of running the simulation and render that are compared
+enum ESimulationMode
+{
+	kSimulationCoupled,   // One thread: tick, capture and render in turn, as a frame of a single threaded game loop
+	kSimulationFlatOut,   // Simulation thread ticking as fast as it can, render interpolating half way between snapshots
+	kSimulationRealTime,  // Simulation thread at the tick rate, render interpolating one tick behind, as the application
+	kNumSimulationModes
+};
+
+const char* const SimulationModeNames[kNumSimulationModes] =
+{
+	"coupled",
+	"thread flat out",
+	"thread real time",
+};
+
+// Run the simulation and render the scene pass from its snapshots for the given time, then print
+// the throughput of each. Update times are of ticks and captures, render times of building the
+// frame, queueing, sorting and submitting it
+void RunSimulationMode( ESimulationMode mode, const SSceneBenchOptions& options )
+{
+	typedef chrono::steady_clock Clock;
+
+	CBenchSimulation  simulation;
+	CSnapshotExchange exchange;
+	CSimulationThread simulationThread;
+	CSnapshotFrame    frame;
+	TFloat32 tickTime = 1.0f / options.TickRate;
+	TUInt32  renderThreads = NumWorkerThreads();
+
+	// The render pass from a frame
+	TFloat64 renderSeconds = 0.0;
+	auto renderFrame = [&]( const CSceneSnapshot& previous, const CSceneSnapshot& latest, TFloat32 t )
+	{
+		Clock::time_point start = Clock::now();
+		frame.Build( previous, latest, t, renderThreads );
+		SetCamera( MainCamera );
+		SetAmbientLight( AmbientColour );
+		SetLights( &Lights[0] );
+		SceneQueue.Clear();
+		frame.Queue( &SceneQueue, MainCamera, renderThreads );
+		SceneQueue.Sort();
+		SceneQueue.Submit();
+		renderSeconds += chrono::duration<TFloat64>( Clock::now() - start ).count();
+	};
+
+	TUInt32  frames = 0;
+	TUInt32  ticks = 0;
+	TUInt32  snapshotsTaken = 0;
+	TFloat64 updateSeconds = 0.0;
+	Clock::time_point start = Clock::now();
+	Clock::time_point end = start + chrono::duration_cast<Clock::duration>( chrono::duration<TFloat64>( options.Duration ) );
+	if (mode == kSimulationCoupled)
+	{
+		CSceneSnapshot snapshot;
+		while (Clock::now() < end)
+		{
+			Clock::time_point updateStart = Clock::now();
+			simulation.Tick( tickTime );
+			snapshot.Capture( EntityManager, Lights, NumLights, ticks, ticks * static_cast<TFloat64>(tickTime) );
+			updateSeconds += chrono::duration<TFloat64>( Clock::now() - updateStart ).count();
+			++ticks;
+
+			renderFrame( snapshot, snapshot, 1.0f );
+			++frames;
+		}
+		snapshotsTaken = frames;
+	}
+	else
+	{
+		simulationThread.Start( &simulation, &exchange, tickTime, mode == kSimulationRealTime );
+		while (Clock::now() < end)
+		{
+			const CSceneSnapshot* previous;
+			const CSceneSnapshot* latest;
+			exchange.Acquire( previous, latest );
+			TFloat32 t = 0.5f;
+			if (mode == kSimulationRealTime)
+			{
+				t = CSnapshotFrame::InterpolationFactor( *previous, *latest, simulationThread.Time() - tickTime );
+			}
+			renderFrame( *previous, *latest, t );
+			++frames;
+		}
+		simulationThread.Stop();
+
+		SSimulationStats simulationStats = simulationThread.Stats();
+		ticks = simulationStats.Ticks;
+		updateSeconds = simulationStats.BusySeconds;
+		snapshotsTaken = exchange.Stats().Taken;
+	}
+	TFloat64 seconds = chrono::duration<TFloat64>( Clock::now() - start ).count();
+
+	fprintf( stderr, "  %-16s %9.1f %9.1f %9.3fms %9.3fms %9.2f\n", SimulationModeNames[mode], ticks / seconds, frames / seconds,
+	         (ticks > 0) ? 1000.0 * updateSeconds / ticks : 0.0, (frames > 0) ? 1000.0 * renderSeconds / frames : 0.0,
+	         (frames > 0) ? static_cast<TFloat64>(snapshotsTaken) / frames : 0.0 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Benchmark
+//-----------------------------------------------------------------------------
+
+int RunSceneBench( const SSceneBenchOptions& options )
+{
+	CNullRenderDevice nullDevice;
+	CRecordingRenderDevice recorder( &nullDevice );
+
+	RenderDevice = &nullDevice;
+	MeshArena.SetDevice( &nullDevice );
+	VertexFormats.SetDevice( &nullDevice );
+	TextureCache.SetDevice( &nullDevice );
+	if (!SceneSetup( options ))
+	{
+		fprintf( stderr, "Failed to load %s\n", options.Level.c_str() );
+		return 1;
+	}
+	SMeshArenaStats arenaStats = MeshArena.Stats();
+	fprintf( stderr, "%s: %u entities, geometry in %u buffers (%u allocations, %.1f of %.1f KB used)\n",
+	         options.Level.c_str(), EntityManager.NumEntities(), arenaStats.Buffers, arenaStats.Allocations,
+	         arenaStats.BytesUsed / 1024.0, arenaStats.BytesReserved / 1024.0 );
+
+	// Sub-mesh render data of the distinct meshes loaded, and the vertex formats and layouts they share
+	set<CMesh*> meshes;
+	TUInt32 numSubMeshes = 0;
+	for (TUInt32 entity = 0; entity < EntityManager.NumEntities(); ++entity)
+	{
+		CMesh* mesh = EntityManager.GetEntityAtIndex( entity )->Template()->Mesh();
+		if (meshes.insert( mesh ).second) numSubMeshes += mesh->GetNumSubMeshes();
+	}
+	SVertexFormatStats formatStats = VertexFormats.Stats();
+	fprintf( stderr, "%u meshes, %u sub-meshes of %u bytes each (%u KB)\n", static_cast<TUInt32>(meshes.size()), numSubMeshes,
+	         static_cast<TUInt32>(CMesh::SubMeshDataSize()), static_cast<TUInt32>(numSubMeshes * CMesh::SubMeshDataSize() / 1024) );
+	fprintf( stderr, "%u vertex formats from %u registrations, %u input layouts from %u requests\n", formatStats.Formats,
+	         formatStats.FormatRequests, formatStats.Layouts, formatStats.LayoutRequests );
+
+	// Texture files loaded for the level, and those shared rather than loaded again
+	const STextureCacheStats& textureStats = TextureCache.Stats();
+	fprintf( stderr, "%u texture requests: %u loads (%.1f KB), %u shared by path and %u by content (%.1f KB not loaded)\n\n",
+	         textureStats.Requests, textureStats.Loads, textureStats.BytesLoaded / 1024.0, textureStats.PathHits,
+	         textureStats.ContentHits, textureStats.BytesSaved / 1024.0 );
+
+	// Device calls of one frame in each mode, recorded, then the mode timed with nothing recorded.
+	// Draws are draw calls, instanced or not; buffers are vertex / index / instance buffer, input
+	// layout and topology binds; variables are matrix, vector and float writes
+	fprintf( stderr, "  %-16s %8s %8s %8s %8s %9s %9s\n", "", "draws", "passes", "buffers", "textures", "variables", "time" );
+	for (TUInt32 mode = 0; mode < kNumSceneRenderModes; ++mode)
+	{
+		RenderDevice = &recorder;
+		recorder.Clear();
+		RenderScenePass( static_cast<ESceneRenderMode>(mode) );
+		TUInt32 draws = recorder.NumCommands( kCommandDrawIndexed ) + recorder.NumCommands( kCommandDrawIndexedInstanced );
+		TUInt32 buffers = recorder.NumCommands( kCommandSetVertexBuffer ) + recorder.NumCommands( kCommandSetIndexBuffer ) +
+		                  recorder.NumCommands( kCommandSetInstanceBuffer ) + recorder.NumCommands( kCommandSetInputLayout ) +
+		                  recorder.NumCommands( kCommandSetPrimitiveTopology );
+		TUInt32 variables = recorder.NumCommands( kCommandSetMatrix ) + recorder.NumCommands( kCommandSetVector ) +
+		                    recorder.NumCommands( kCommandSetFloat );
+
+		RenderDevice = &nullDevice;
+		TFloat64 time = MedianTime( options.Repeats, [&]() { RenderScenePass( static_cast<ESceneRenderMode>(mode) ); } );
+
+		fprintf( stderr, "  %-16s %8u %8u %8u %8u %9u %7.3fms\n", SceneRenderModeNames[mode],
+		         draws, recorder.NumCommands( kCommandApplyPass ), buffers,
+		         recorder.NumCommands( kCommandSetTexture ), variables, time );
+	}
+
+	// The queue's own count of draw calls and state changes in each of its modes
+	fprintf( stderr, "\n  %-16s %8s %9s %9s %8s %9s %8s %8s\n", "", "draws", "instanced", "instances", "methods", "materials",
+	         "textures", "buffers" );
+	for (TUInt32 mode = kRenderQueueUnsorted; mode <= kRenderQueueInstanced; ++mode)
+	{
+		RenderScenePass( static_cast<ESceneRenderMode>(mode) );
+		const SDrawQueueStats& stats = SceneQueue.Stats();
+		fprintf( stderr, "  %-16s %8u %9u %9u %8u %9u %8u %8u\n", SceneRenderModeNames[mode], stats.Draws, stats.InstancedDraws,
+		         stats.Instances, stats.MethodChanges, stats.MaterialChanges, stats.TextureChanges, stats.BufferChanges );
+	}
+	fprintf( stderr, "\n" );
+
+	// Building the render list (culling, world matrices and packets) on 1 to n threads. The packets
+	// must come out the same, in the same order, as on one thread
+	TUInt32 maxThreads = (options.Threads > 0) ? options.Threads : NumWorkerThreads();
+	SetNumWorkerThreads( maxThreads );
+	vector<SDrawPacket> serialPackets;
+	TFloat64 serialTime = 0.0;
+	fprintf( stderr, "  %-16s %8s %9s %8s %9s\n", "render list", "packets", "time", "speedup", "order" );
+	for (TUInt32 threads = 1; threads <= maxThreads; ++threads)
+	{
+		TFloat64 time = MedianTime( options.Repeats, [&]()
+		{
+			SceneQueue.Clear();
+			EntityManager.QueueAllEntities( &SceneQueue, MainCamera, false, threads );
+		} );
+
+		bool same = true;
+		if (threads == 1)
+		{
+			serialTime = time;
+			for (TUInt32 packet = 0; packet < SceneQueue.NumPackets(); ++packet)
+			{
+				serialPackets.push_back( SceneQueue.GetPacket( packet ) );
+			}
+		}
+		else
+		{
+			same = (SceneQueue.NumPackets() == serialPackets.size());
+			for (TUInt32 packet = 0; same && packet < SceneQueue.NumPackets(); ++packet)
+			{
+				const SDrawPacket& drawPacket = SceneQueue.GetPacket( packet );
+				same = drawPacket.SortKey == serialPackets[packet].SortKey &&
+				       drawPacket.WorldMatrix == serialPackets[packet].WorldMatrix;
+			}
+		}
+		fprintf( stderr, "  %2u %-13s %8u %7.3fms %7.2fx %9s\n", threads, (threads == 1) ? "thread" : "threads",
+		         SceneQueue.NumPackets(), time, serialTime / time, same ? "same" : "DIFFERENT" );
+	}
+	SetNumWorkerThreads( 0 );
+	fprintf( stderr, "\n" );
+
+	// The simulation on the render thread and on its own thread. Run last as it moves the entities
+	fprintf( stderr, "  %-16s %9s %9s %11s %11s %9s\n", "simulation", "ticks/s", "frames/s", "update/tick", "render/frame",
+	         "new/frame" );
+	for (TUInt32 mode = 0; mode < kNumSimulationModes; ++mode)
+	{
+		RunSimulationMode( static_cast<ESimulationMode>(mode), options );
+	}
+	fprintf( stderr, "\n" );
+
+	SceneShutdown();
+	MeshArena.Release();
+	VertexFormats.Release();
+	TextureCache.ReleaseAll();
+	return 0;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	gen::SSceneBenchOptions options;
+	if (!gen::ParseOptions( argc, argv, options ))
+	{
+		gen::PrintUsage();
+		return 1;
+	}
+	return gen::RunSceneBench( options );
+}
@@ -0,0 +1,305 @@
+/*******************************************
+	ServiceClientMain.cpp
+
+	Command line client and load generator for
+	the post-processing service
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+#include "ImageIO.h"
+#include "ServiceProtocol.h"
+#include "LatencyHistogram.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Options
+//-----------------------------------------------------------------------------
+
+struct SClientOptions
+{
+	string   Command;     // process, bench, stats or shutdown
+	string   SocketPath;
+	string   Chain;
+	string   Input;       // Image files for the process command
+	string   Output;
+	TUInt32  Frame;
+	TFloat32 FrameRate;
+	TUInt32  Clients;     // Connections used by the bench command
+	TUInt32  Requests;    // Requests sent on each connection
+	TUInt32  Depth;       // Requests in flight on each connection
+	TUInt32  Width;       // Frame size for the bench command
+	TUInt32  Height;
+
+	SClientOptions()
+	{
+		Frame = 0;
+		FrameRate = 60.0f;
+		Clients = 4;
+		Requests = 100;
+		Depth = 1;
+		Width = 1280;
+		Height = 720;
+	}
+};
+
+void PrintUsage()
+{
+	fprintf( stderr,
+		"Usage: PostProcessClient <command> --socket <path> [options]\n"
+		"\n"
+		"Commands:\n"
+		"  process    Process one image: --chain <filters> --in <file> --out <file> [--frame <n>] [--fps <rate>]\n"
+		"  bench      Send frames from several clients at once and report round trip latency:\n"
+		"             --chain <filters> [--clients <n>] [--requests <n>] [--depth <n>] [--size <WxH>]\n"
+		"  stats      Print the service statistics\n"
+		"  shutdown   Stop the service\n" );
+}
+
+// Parse the command line. Returns false on error, having printed a message
+bool ParseOptions( int argc, char* argv[], SClientOptions& options )
+{
+	if (argc < 2) return false;
+	options.Command = argv[1];
+	for (int i = 2; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (i + 1 >= argc)
+		{
+			fprintf( stderr, "Missing value for %s\n", arg.c_str() );
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--socket")        options.SocketPath = value;
+		else if (arg == "--chain")    options.Chain = value;
+		else if (arg == "--in")       options.Input = value;
+		else if (arg == "--out")      options.Output = value;
+		else if (arg == "--frame")    options.Frame = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--fps")      options.FrameRate = static_cast<TFloat32>(atof( value ));
+		else if (arg == "--clients")  options.Clients = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--requests") options.Requests = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--depth")    options.Depth = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--size")
+		{
+			if (sscanf( value, "%ux%u", &options.Width, &options.Height ) != 2)
+			{
+				fprintf( stderr, "Bad size '%s', expected WxH\n", value );
+				return false;
+			}
+		}
+		else
+		{
+			fprintf( stderr, "Unknown option %s\n", arg.c_str() );
+			return false;
+		}
+	}
+
+	if (options.SocketPath.empty())
+	{
+		fprintf( stderr, "--socket is required\n" );
+		return false;
+	}
+	if (options.Command == "process" && (options.Input.empty() || options.Output.empty()))
+	{
+		fprintf( stderr, "process needs --in and --out\n" );
+		return false;
+	}
+	if (options.Command == "bench" && (options.Clients == 0 || options.Requests == 0 || options.Depth == 0))
+	{
+		fprintf( stderr, "--clients, --requests and --depth must be positive\n" );
+		return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Commands
+//-----------------------------------------------------------------------------
+
+int ProcessCommand( const SClientOptions& options )
+{
+	CImage frame, result;
+	if (!LoadImageFile( options.Input, frame ))
+	{
+		fprintf( stderr, "Failed to read %s\n", options.Input.c_str() );
+		return 1;
+	}
+
+	CServiceClient client;
+	SServiceResponseHeader response;
+	string text;
+	if (!client.Connect( options.SocketPath ) ||
+	    !client.SendProcess( 0, options.Chain, frame, options.Frame, options.FrameRate ) ||
+	    !client.Receive( response, result, text ))
+	{
+		fprintf( stderr, "Cannot reach the service at %s\n", options.SocketPath.c_str() );
+		return 1;
+	}
+	if (response.Status != kStatusOK)
+	{
+		fprintf( stderr, "Request failed: %s\n", text.c_str() );
+		return 1;
+	}
+	if (!SaveImageFile( options.Output, result ))
+	{
+		fprintf( stderr, "Failed to write %s\n", options.Output.c_str() );
+		return 1;
+	}
+	fprintf( stderr, "Queued %.3fms, processed in %.3fms (batch of %u)\n",
+	         response.QueueTime * 1e-3, response.ProcessTime * 1e-3, response.BatchSize );
+	return 0;
+}
+
+// Results gathered by the bench clients
+struct SBenchResults
+{
+	mutex             Mutex;
+	CLatencyHistogram RoundTrips;
+	TUInt64           Completed;
+	TUInt64           Busy;
+	TUInt64           Failed;
+	TUInt64           BatchSizeTotal;
+};
+
+// One bench client: sends its requests keeping up to Depth in flight, timing each round trip
+void BenchClient( const SClientOptions& options, TUInt32 clientIndex, SBenchResults& results )
+{
+	typedef chrono::steady_clock Clock;
+	CImage frame( options.Width, options.Height ), result;
+	frame.Fill( static_cast<TUInt8>(clientIndex * 40), 128, 200, 255 );
+
+	CLatencyHistogram roundTrips;
+	TUInt64 completed = 0, busy = 0, failed = 0, batchSizeTotal = 0;
+	vector<Clock::time_point> sendTimes( options.Requests );
+
+	CServiceClient client;
+	if (client.Connect( options.SocketPath ))
+	{
+		TUInt32 sent = 0, received = 0;
+		SServiceResponseHeader response;
+		string text;
+		while (received < options.Requests)
+		{
+			// Each client works through its own sequence, so the service can advance its cached
+			// animation rather than replay it
+			while (sent < options.Requests && sent - received < options.Depth)
+			{
+				sendTimes[sent] = Clock::now();
+				if (!client.SendProcess( sent, options.Chain, frame, sent, options.FrameRate )) break;
+				++sent;
+			}
+			if (!client.Receive( response, result, text ) || response.Id >= options.Requests) break;
+			++received;
+
+			TUInt64 microseconds = chrono::duration_cast<chrono::microseconds>( Clock::now() - sendTimes[response.Id] ).count();
+			if (response.Status == kStatusOK)
+			{
+				roundTrips.Add( microseconds );
+				batchSizeTotal += response.BatchSize;
+				++completed;
+			}
+			else if (response.Status == kStatusBusy)
+			{
+				++busy;
+			}
+			else
+			{
+				++failed;
+			}
+		}
+		failed += options.Requests - received;
+	}
+	else
+	{
+		failed = options.Requests;
+	}
+
+	lock_guard<mutex> lock( results.Mutex );
+	results.RoundTrips.Merge( roundTrips );
+	results.Completed += completed;
+	results.Busy += busy;
+	results.Failed += failed;
+	results.BatchSizeTotal += batchSizeTotal;
+}
+
+int BenchCommand( const SClientOptions& options )
+{
+	SBenchResults results;
+	results.Completed = results.Busy = results.Failed = results.BatchSizeTotal = 0;
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<thread> clients;
+	for (TUInt32 i = 0; i < options.Clients; ++i)
+	{
+		clients.push_back( thread( BenchClient, cref( options ), i, ref( results ) ) );
+	}
+	for (size_t i = 0; i < clients.size(); ++i)
+	{
+		clients[i].join();
+	}
+	TFloat64 seconds = chrono::duration<TFloat64>( chrono::steady_clock::now() - start ).count();
+
+	fprintf( stderr, "%u clients x %u requests of %ux%u, depth %u: %llu done, %llu busy, %llu failed in %.2fs\n",
+	         options.Clients, options.Requests, options.Width, options.Height, options.Depth,
+	         static_cast<unsigned long long>(results.Completed), static_cast<unsigned long long>(results.Busy),
+	         static_cast<unsigned long long>(results.Failed), seconds );
+	fprintf( stderr, "Throughput %.1f frames/s, mean batch size %.2f\n", results.Completed / seconds,
+	         (results.Completed > 0) ? static_cast<TFloat64>(results.BatchSizeTotal) / results.Completed : 0.0 );
+	fprintf( stderr, "Round trip  %s\n", results.RoundTrips.Summary().c_str() );
+	return (results.Failed == 0) ? 0 : 1;
+}
+
+// Send a request with no data and print any text returned
+int SimpleCommand( const SClientOptions& options, EServiceRequest type )
+{
+	CServiceClient client;
+	SServiceResponseHeader response;
+	CImage unused;
+	string text;
+	if (!client.Connect( options.SocketPath ) || !client.SendRequest( type, 0 ) || !client.Receive( response, unused, text ))
+	{
+		fprintf( stderr, "Cannot reach the service at %s\n", options.SocketPath.c_str() );
+		return 1;
+	}
+	printf( "%s", text.c_str() );
+	return (response.Status == kStatusOK) ? 0 : 1;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	gen::SClientOptions options;
+	if (!gen::ParseOptions( argc, argv, options ))
+	{
+		gen::PrintUsage();
+		return 1;
+	}
+	if (!gen::InitLocalSockets())
+	{
+		fprintf( stderr, "Cannot initialise sockets\n" );
+		return 1;
+	}
+
+	if (options.Command == "process")  return gen::ProcessCommand( options );
+	if (options.Command == "bench")    return gen::BenchCommand( options );
+	if (options.Command == "stats")    return gen::SimpleCommand( options, gen::kRequestStats );
+	if (options.Command == "shutdown") return gen::SimpleCommand( options, gen::kRequestShutdown );
+	fprintf( stderr, "Unknown command '%s'\n", options.Command.c_str() );
+	gen::PrintUsage();
+	return 1;
+}
@@ -0,0 +1,127 @@
+/*******************************************
+	ServiceMain.cpp
+
+	Post-processing service listening on a
+	Unix domain socket
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+using namespace std;
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#endif
+
+#include "Defines.h"
+#include "PostProcessService.h"
+
+namespace gen
+{
+
+// The running service, for the signal handlers
+CPostProcessService* RunningService = 0;
+
+#if defined(_WIN32)
+BOOL WINAPI ConsoleHandler( DWORD )
+{
+	if (RunningService) RunningService->Stop();
+	return TRUE;
+}
+#else
+void SignalHandler( int )
+{
+	if (RunningService) RunningService->Stop();
+}
+#endif
+
+void PrintUsage()
+{
+	fprintf( stderr,
+		"Usage: PostProcessService --socket <path> [options]\n"
+		"\n"
+		"  --socket <path>        Unix domain socket to listen on\n"
+		"  --workers <n>          Batches processed at once (default 2)\n"
+		"  --filter-threads <n>   Threads per filter within a frame (default: hardware threads / workers)\n"
+		"  --max-batch <n>        Most requests with the same chain processed together (default 8)\n"
+		"  --batch-window <us>    Time a request may wait for others to batch with (default 1000)\n"
+		"  --max-queue <n>        Queued requests beyond which new ones are refused (default 64)\n"
+		"  --max-connections <n>  Most clients connected at once (default 32)\n"
+		"  --maps <dir>           Directory holding Noise, Burn and Distort maps (.tga / .ppm)\n"
+		"\n"
+		"Statistics are printed when the service stops (Ctrl+C or a shutdown request)\n" );
+}
+
+// Parse the command line. Returns false on error, having printed a message
+bool ParseOptions( int argc, char* argv[], SServiceOptions& options )
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		string arg = argv[i];
+		if (arg == "--help" || arg == "-h") return false;
+		if (i + 1 >= argc)
+		{
+			fprintf( stderr, "Missing value for %s\n", arg.c_str() );
+			return false;
+		}
+		const char* value = argv[++i];
+		if (arg == "--socket")               options.SocketPath = value;
+		else if (arg == "--workers")         options.Workers = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--filter-threads")  options.FilterThreads = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--max-batch")       options.MaxBatch = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--batch-window")    options.BatchWindow = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--max-queue")       options.MaxQueue = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--max-connections") options.MaxConnections = static_cast<TUInt32>(atoi( value ));
+		else if (arg == "--maps")            options.MapDirectory = value;
+		else
+		{
+			fprintf( stderr, "Unknown option %s\n", arg.c_str() );
+			return false;
+		}
+	}
+	if (options.SocketPath.empty())
+	{
+		fprintf( stderr, "--socket is required\n" );
+		return false;
+	}
+	return true;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	gen::SServiceOptions options;
+	if (!gen::ParseOptions( argc, argv, options ))
+	{
+		gen::PrintUsage();
+		return 1;
+	}
+	if (!gen::InitLocalSockets())
+	{
+		fprintf( stderr, "Cannot initialise sockets\n" );
+		return 1;
+	}
+
+	gen::CPostProcessService service( options );
+	gen::RunningService = &service;
+#if defined(_WIN32)
+	SetConsoleCtrlHandler( gen::ConsoleHandler, TRUE );
+#else
+	signal( SIGINT, gen::SignalHandler );
+	signal( SIGTERM, gen::SignalHandler );
+#endif
+
+	fprintf( stderr, "Listening on %s\n", options.SocketPath.c_str() );
+	if (!service.Run())
+	{
+		fprintf( stderr, "Cannot listen on %s\n", options.SocketPath.c_str() );
+		return 1;
+	}
+	gen::RunningService = 0;
+	fprintf( stderr, "%s", service.Statistics().c_str() );
+	return 0;
+}
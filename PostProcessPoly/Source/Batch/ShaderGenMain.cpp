@@ -0,0 +1,938 @@
+/*******************************************
+	ShaderGenMain.cpp
+
+	Translates the pixel shaders in an effect
+	file to C++ for the CPU filters
+********************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Translates the subset of HLSL used by PostProcess.fx to C++ using the types in ShaderTypes.h:
+// the effect's variables, sampler states and input structures, each pixel shader, and a table of
+// the techniques whose passes all have translated shaders. Shader code is translated token by
+// token keeping its layout and comments, changing only what C++ spells differently - float
+// literals, swizzles and matrix types. Vertex shaders are skipped, since the CPU filters make
+// their own UVs. A shader using anything outside the subset (e.g. a helper function, discard or
+// a swizzle write) is reported and left out along with its techniques, without failing the build
+
+//-----------------------------------------------------------------------------
+// Tokens
+//-----------------------------------------------------------------------------
+
+enum ETokenType
+{
+	kTokenName,
+	kTokenNumber,
+	kTokenSymbol,
+	kTokenEnd,
+};
+
+// A token with the whitespace and comments before it
+struct SToken
+{
+	ETokenType Type;
+	string     Text;
+	string     Space;
+	TUInt32    Line;
+};
+
+// Split effect source into tokens, ending with a kTokenEnd. Returns false on a character that
+// cannot start a token, having set the error
+bool Tokenise( const string& source, vector<SToken>& tokens, string& error )
+{
+	static const char* const TwoCharSymbols[] =
+		{ "==", "!=", "<=", ">=", "&&", "||", "+=", "-=", "*=", "/=", "++", "--", "<<", ">>" };
+
+	TUInt32 line = 1;
+	size_t i = 0;
+	const size_t size = source.size();
+	while (true)
+	{
+		SToken token;
+
+		// Whitespace and comments
+		size_t spaceStart = i;
+		while (i < size)
+		{
+			if (isspace( static_cast<unsigned char>(source[i]) ))
+			{
+				if (source[i] == '\n') ++line;
+				++i;
+			}
+			else if (source.compare( i, 2, "//" ) == 0)
+			{
+				while (i < size && source[i] != '\n') ++i;
+			}
+			else if (source.compare( i, 2, "/*" ) == 0)
+			{
+				size_t end = source.find( "*/", i + 2 );
+				end = (end == string::npos) ? size : end + 2;
+				for (; i < end; ++i)
+				{
+					if (source[i] == '\n') ++line;
+				}
+			}
+			else
+			{
+				break;
+			}
+		}
+		token.Space = source.substr( spaceStart, i - spaceStart );
+		token.Line = line;
+		if (i >= size)
+		{
+			token.Type = kTokenEnd;
+			tokens.push_back( token );
+			return true;
+		}
+
+		size_t start = i;
+		char c = source[i];
+		if (isalpha( static_cast<unsigned char>(c) ) || c == '_')
+		{
+			while (i < size && (isalnum( static_cast<unsigned char>(source[i]) ) || source[i] == '_')) ++i;
+			token.Type = kTokenName;
+		}
+		else if (isdigit( static_cast<unsigned char>(c) ) ||
+		         (c == '.' && i + 1 < size && isdigit( static_cast<unsigned char>(source[i + 1]) )))
+		{
+			// Digits, point, exponent (with sign) and suffix letters
+			while (i < size)
+			{
+				char d = source[i];
+				if ((d == '+' || d == '-') && (source[i - 1] == 'e' || source[i - 1] == 'E') &&
+				    source.compare( start, 2, "0x" ) != 0)
+				{
+					++i;
+				}
+				else if (isalnum( static_cast<unsigned char>(d) ) || d == '.')
+				{
+					++i;
+				}
+				else
+				{
+					break;
+				}
+			}
+			token.Type = kTokenNumber;
+		}
+		else
+		{
+			i += 1;
+			for (size_t s = 0; s < sizeof(TwoCharSymbols) / sizeof(TwoCharSymbols[0]); ++s)
+			{
+				if (source.compare( start, 2, TwoCharSymbols[s] ) == 0) i = start + 2;
+			}
+			if (strchr( "{}()[]<>;:,.=+-*/%!&|?~^", c ) == 0)
+			{
+				char message[64];
+				sprintf( message, "line %u: unexpected character '%c'", line, c );
+				error = message;
+				return false;
+			}
+			token.Type = kTokenSymbol;
+		}
+		token.Text = source.substr( start, i - start );
+		tokens.push_back( token );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Effect contents
+//-----------------------------------------------------------------------------
+
+// A global variable. Those without an initialiser become members of the shader structure, the
+// others (constants) are declared before it
+struct SVariable
+{
+	string Type;
+	string Name;
+	string ArraySize;   // Empty if not an array
+	string Initialiser; // Translated, empty if none
+};
+
+struct SSamplerState
+{
+	string Name;
+	string Filter;  // C++ enum values
+	string Address;
+};
+
+struct SStructure
+{
+	string                       Name;
+	vector<pair<string, string>> Members; // Type and name
+};
+
+struct SPixelShader
+{
+	string  Name;
+	string  InputType;
+	string  InputName;
+	string  Body;    // Translated, from the opening brace to the closing brace
+	TUInt32 Line;
+	string  Problem; // Why the shader cannot be translated, empty if it can
+};
+
+struct SPass
+{
+	string Shader;
+	bool   AlphaBlend;
+};
+
+struct STechnique
+{
+	string        Name;
+	vector<SPass> Passes;
+};
+
+struct SEffect
+{
+	vector<SVariable>     Variables;
+	vector<SVariable>     Textures;
+	vector<SSamplerState> Samplers;
+	vector<SStructure>    Structures;
+	vector<SPixelShader>  Shaders;
+	vector<STechnique>    Techniques;
+	set<string>           AlphaBlendStates;
+};
+
+
+//-----------------------------------------------------------------------------
+// Translation
+//-----------------------------------------------------------------------------
+
+// Names a translated shader may call: constructors, the intrinsics in ShaderTypes.h and the
+// keywords that are followed by a bracket
+const char* const CallableNames[] =
+{
+	"float", "float2", "float3", "float4", "int", "bool", "float2x2",
+	"abs", "sqrt", "sin", "cos", "sincos", "pow", "exp", "floor", "frac", "radians", "min", "max",
+	"clamp", "saturate", "step", "lerp", "dot", "length", "distance", "normalize", "mul",
+	"if", "for", "while", "switch", "return",
+};
+
+// Names with no C++ equivalent here
+const char* const UnsupportedNames[] =
+{
+	"discard", "clip", "ddx", "ddy", "out", "inout", "half", "double", "uint", "matrix",
+};
+
+bool IsSwizzle( const string& name )
+{
+	if (name.size() > 4) return false;
+	bool xyzw = name.find_first_not_of( "xyzw" ) == string::npos;
+	bool rgba = name.find_first_not_of( "rgba" ) == string::npos;
+	return xyzw || rgba;
+}
+
+// Component index of a swizzle letter
+int SwizzleIndex( char c )
+{
+	const char* xyzw = "xyzw";
+	const char* rgba = "rgba";
+	const char* p = strchr( xyzw, c );
+	return p ? static_cast<int>(p - xyzw) : static_cast<int>(strchr( rgba, c ) - rgba);
+}
+
+// Add an f suffix to floating point literals (HLSL literals are float, C++ ones double)
+string FloatLiteral( const string& text )
+{
+	if (text.compare( 0, 2, "0x" ) == 0) return text;
+	bool isFloat = text.find_first_of( ".eE" ) != string::npos;
+	char last = text[text.size() - 1];
+	if (last == 'f' || last == 'F') return text;
+	if (last == 'h' || last == 'H') return text.substr( 0, text.size() - 1 ) + "f";
+	return isFloat ? text + "f" : text;
+}
+
+// Add an indent after each line break in whitespace
+string Indent( const string& space, const string& indent )
+{
+	string result;
+	for (size_t i = 0; i < space.size(); ++i)
+	{
+		result += space[i];
+		if (space[i] == '\n') result += indent;
+	}
+	return result;
+}
+
+// Whether the local constant declared by the statement at tokens[statement] is unused in tokens
+// [begin, end). Only a "const type name" at the start of a statement counts as a constant
+bool IsUnusedConstant( const vector<SToken>& tokens, size_t begin, size_t end, size_t statement )
+{
+	if (statement == begin) return false;
+	const string& previous = tokens[statement - 1].Text;
+	if (previous != "{" && previous != ";" && previous != "}") return false;
+	if (statement + 3 >= end || tokens[statement].Text != "const" || tokens[statement + 2].Type != kTokenName) return false;
+	const string& after = tokens[statement + 3].Text;
+	if (after != "=" && after != "[" && after != ";") return false;
+
+	const string& name = tokens[statement + 2].Text;
+	for (size_t i = begin; i < end; ++i)
+	{
+		bool member = i > begin && tokens[i - 1].Text == ".";
+		if (i != statement + 2 && !member && tokens[i].Text == name) return false;
+	}
+	return true;
+}
+
+// Translate tokens [begin, end) of HLSL code to C++, with each line after the first indented
+// further by the given indent. The textures are names whose Sample method may be called. Local
+// constants that are never used are left out, as C++ compilers warn about them. Returns false if
+// the code uses anything that cannot be translated, setting the problem
+bool TranslateCode
+(
+	const vector<SToken>& tokens,
+	size_t                begin,
+	size_t                end,
+	const string&         indent,
+	const set<string>&    textures,
+	string&               code,
+	string&               problem
+)
+{
+	set<string> callable( CallableNames, CallableNames + sizeof(CallableNames) / sizeof(CallableNames[0]) );
+	set<string> unsupported( UnsupportedNames, UnsupportedNames + sizeof(UnsupportedNames) / sizeof(UnsupportedNames[0]) );
+
+	code.clear();
+	for (size_t i = begin; i < end; ++i)
+	{
+		const SToken& token = tokens[i];
+		const SToken& next = tokens[i + 1];
+		char lineText[32];
+		sprintf( lineText, "line %u: ", token.Line );
+		const string line = lineText;
+
+		if (IsUnusedConstant( tokens, begin, end, i ))
+		{
+			while (i + 1 < end && tokens[i].Text != ";") ++i;
+			continue;
+		}
+
+		string text = token.Text;
+		if (token.Type == kTokenNumber)
+		{
+			text = FloatLiteral( text );
+		}
+		else if (token.Type == kTokenName)
+		{
+			bool member = i > begin && tokens[i - 1].Text == ".";
+			if (unsupported.count( text ) && !member)
+			{
+				// matrix<float, 2, 2> is the one matrix type supported
+				if (text == "matrix" && i + 7 < end && tokens[i + 1].Text == "<" && tokens[i + 2].Text == "float" &&
+				    tokens[i + 4].Text == "2" && tokens[i + 6].Text == "2" && tokens[i + 7].Text == ">")
+				{
+					code += ((i > begin) ? Indent( token.Space, indent ) : string()) + "float2x2";
+					i += 7;
+					continue;
+				}
+				problem = line + text + " is not supported";
+				return false;
+			}
+			if (member && textures.count( tokens[i - 2].Text ))
+			{
+				if (text != "Sample")
+				{
+					problem = line + "texture method " + text + " is not supported";
+					return false;
+				}
+			}
+			else if (member && IsSwizzle( text ))
+			{
+				if (text.size() == 1)
+				{
+					text = "xyzw"[SwizzleIndex( text[0] )];
+				}
+				else
+				{
+					// Swizzles of more than one component are function results so cannot be written
+					if (next.Text == "=" || next.Text == "+=" || next.Text == "-=" || next.Text == "*=" || next.Text == "/=")
+					{
+						problem = line + "writing to swizzle " + text + " is not supported";
+						return false;
+					}
+					string call = "Swizzle<";
+					for (size_t c = 0; c < text.size(); ++c)
+					{
+						if (c > 0) call += ", ";
+						call += static_cast<char>('0' + SwizzleIndex( text[c] ));
+					}
+					text = call + ">()";
+				}
+			}
+			else if (!member && next.Text == "(" && !callable.count( text ))
+			{
+				problem = line + "call to " + text + " is not supported";
+				return false;
+			}
+		}
+		else if (token.Text == "[" && i > begin && (tokens[i - 1].Text == ";" || tokens[i - 1].Text == "{" || tokens[i - 1].Text == "}"))
+		{
+			problem = line + "attributes are not supported";
+			return false;
+		}
+		code += ((i > begin) ? Indent( token.Space, indent ) : string()) + text;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Parsing
+//-----------------------------------------------------------------------------
+
+class CEffectParser
+{
+public:
+	CEffectParser( const vector<SToken>& tokens, SEffect& effect ) : m_Tokens( tokens ), m_Effect( effect ), m_Pos( 0 ) {}
+
+	// Parse the whole effect. Returns false on a syntax error, having set the error
+	bool Parse( string& error )
+	{
+		while (Peek().Type != kTokenEnd)
+		{
+			if (!ParseTopLevel())
+			{
+				char message[64];
+				sprintf( message, "line %u: ", Peek().Line );
+				error = message + m_Error;
+				return false;
+			}
+		}
+		return true;
+	}
+
+private:
+	const SToken& Peek( size_t offset = 0 ) const
+	{
+		size_t pos = m_Pos + offset;
+		return (pos < m_Tokens.size()) ? m_Tokens[pos] : m_Tokens.back();
+	}
+
+	const SToken& Next()
+	{
+		const SToken& token = Peek();
+		if (m_Pos < m_Tokens.size() - 1) ++m_Pos;
+		return token;
+	}
+
+	bool Expect( const char* text )
+	{
+		if (Peek().Text != text)
+		{
+			m_Error = string( "expected " ) + text + " but found " + Peek().Text;
+			return false;
+		}
+		Next();
+		return true;
+	}
+
+	// Position of the bracket matching the one at the current position
+	size_t MatchingBracket() const
+	{
+		const string open = Peek().Text;
+		const string close = (open == "{") ? "}" : ((open == "(") ? ")" : "]");
+		TUInt32 depth = 0;
+		for (size_t pos = m_Pos; pos < m_Tokens.size(); ++pos)
+		{
+			if (m_Tokens[pos].Text == open) ++depth;
+			else if (m_Tokens[pos].Text == close && --depth == 0) return pos;
+		}
+		return m_Tokens.size() - 1;
+	}
+
+	// Skip to after the bracket matching the current one, and a following semicolon
+	void SkipBlock()
+	{
+		m_Pos = MatchingBracket();
+		Next();
+		if (Peek().Text == ";") Next();
+	}
+
+	// Parse a state block of "Name = value;" lines into a map. Indices on names are dropped
+	bool ParseStateBlock( map<string, string>& states )
+	{
+		if (!Expect( "{" )) return false;
+		while (Peek().Text != "}")
+		{
+			if (Peek().Type == kTokenEnd) return Expect( "}" );
+			string name = Next().Text;
+			if (Peek().Text == "[")
+			{
+				m_Pos = MatchingBracket();
+				Next();
+			}
+			if (!Expect( "=" )) return false;
+			string value;
+			while (Peek().Text != ";" && Peek().Type != kTokenEnd) value += Next().Text;
+			if (!Expect( ";" )) return false;
+			states[name] = value;
+		}
+		Next();
+		if (Peek().Text == ";") Next();
+		return true;
+	}
+
+	bool ParseTopLevel()
+	{
+		const string keyword = Peek().Text;
+		if (keyword == "SamplerState")
+		{
+			Next();
+			SSamplerState sampler;
+			sampler.Name = Next().Text;
+			map<string, string> states;
+			if (!ParseStateBlock( states )) return false;
+
+			// D3D10 defaults are trilinear and clamp. The maps are magnified over the screen, so
+			// only the magnification filter matters
+			const string& filter = states.count( "Filter" ) ? states["Filter"] : "MIN_MAG_MIP_LINEAR";
+			bool point = filter.find( "MAG_POINT" ) != string::npos || filter.find( "MAG_MIP_POINT" ) != string::npos;
+			sampler.Filter = point ? "kSamplerPoint" : "kSamplerLinear";
+			const string& address = states.count( "AddressU" ) ? states["AddressU"] : "Clamp";
+			if (address == "Wrap")        sampler.Address = "kSamplerWrap";
+			else if (address == "Border") sampler.Address = "kSamplerBorder";
+			else                          sampler.Address = "kSamplerClamp";
+			m_Effect.Samplers.push_back( sampler );
+			return true;
+		}
+		if (keyword == "BlendState")
+		{
+			Next();
+			string name = Next().Text;
+			map<string, string> states;
+			if (!ParseStateBlock( states )) return false;
+			if (states["BlendEnable"] == "TRUE") m_Effect.AlphaBlendStates.insert( name );
+			return true;
+		}
+		if (keyword == "RasterizerState" || keyword == "DepthStencilState")
+		{
+			Next();
+			Next();
+			map<string, string> states;
+			return ParseStateBlock( states );
+		}
+		if (keyword == "technique10" || keyword == "technique11" || keyword == "technique")
+		{
+			return ParseTechnique();
+		}
+		if (keyword == "struct")
+		{
+			return ParseStructure();
+		}
+
+		// Variable or function
+		while (Peek().Text == "const" || Peek().Text == "uniform" || Peek().Text == "static" || Peek().Text == "shared")
+		{
+			Next();
+		}
+		SVariable variable;
+		variable.Type = Next().Text;
+		if (Peek().Text == "<")
+		{
+			// Templated type, not used by the pixel shaders
+			while (Next().Text != ">" && Peek().Type != kTokenEnd) {}
+		}
+		variable.Name = Next().Text;
+		if (Peek().Text == "(") return ParseFunction( variable.Type, variable.Name );
+
+		if (Peek().Text == "[")
+		{
+			Next();
+			while (Peek().Text != "]" && Peek().Type != kTokenEnd) variable.ArraySize += Next().Text;
+			if (!Expect( "]" )) return false;
+		}
+		if (Peek().Text == ":")
+		{
+			Next();
+			Next();
+		}
+		if (Peek().Text == "=")
+		{
+			Next();
+			size_t begin = m_Pos;
+			while (Peek().Text != ";" && Peek().Type != kTokenEnd) Next();
+			string problem;
+			if (!TranslateCode( m_Tokens, begin, m_Pos, "", set<string>(), variable.Initialiser, problem ))
+			{
+				m_Error = "initialiser of " + variable.Name + ": " + problem;
+				return false;
+			}
+		}
+		if (!Expect( ";" )) return false;
+
+		if (variable.Type == "Texture2D")
+		{
+			m_Effect.Textures.push_back( variable );
+		}
+		else
+		{
+			m_Effect.Variables.push_back( variable );
+		}
+		return true;
+	}
+
+	bool ParseStructure()
+	{
+		Next();
+		SStructure structure;
+		structure.Name = Next().Text;
+		if (!Expect( "{" )) return false;
+		while (Peek().Text != "}" && Peek().Type != kTokenEnd)
+		{
+			string type = Next().Text;
+			string name = Next().Text;
+			if (Peek().Text == ":")
+			{
+				Next();
+				Next();
+			}
+			if (!Expect( ";" )) return false;
+			structure.Members.push_back( make_pair( type, name ) );
+		}
+		if (!Expect( "}" )) return false;
+		if (!Expect( ";" )) return false;
+		m_Effect.Structures.push_back( structure );
+		return true;
+	}
+
+	// Pixel shaders are functions returning float4 to SV_Target with one structure input, others
+	// are skipped
+	bool ParseFunction( const string& returnType, const string& name )
+	{
+		SPixelShader shader;
+		shader.Name = name;
+		shader.Line = Peek().Line;
+		size_t close = MatchingBracket();
+		if (close == m_Pos + 3)
+		{
+			shader.InputType = Peek( 1 ).Text;
+			shader.InputName = Peek( 2 ).Text;
+		}
+		m_Pos = close;
+		Next();
+		string semantic;
+		if (Peek().Text == ":")
+		{
+			Next();
+			semantic = Next().Text;
+		}
+		if (Peek().Text != "{")
+		{
+			m_Error = "expected function body for " + name;
+			return false;
+		}
+		bool isPixelShader = returnType == "float4" && (semantic == "SV_Target" || semantic == "COLOR") && !shader.InputType.empty();
+		if (!isPixelShader)
+		{
+			SkipBlock();
+			return true;
+		}
+
+		set<string> textures;
+		for (size_t i = 0; i < m_Effect.Textures.size(); ++i)
+		{
+			textures.insert( m_Effect.Textures[i].Name );
+		}
+		size_t end = MatchingBracket();
+		if (!TranslateCode( m_Tokens, m_Pos, end + 1, "\t", textures, shader.Body, shader.Problem ))
+		{
+			shader.Body.clear();
+		}
+		m_Pos = end;
+		Next();
+		m_Effect.Shaders.push_back( shader );
+		return true;
+	}
+
+	// A technique's passes, each with the pixel shader it compiles and whether its blend state
+	// alpha blends
+	bool ParseTechnique()
+	{
+		Next();
+		STechnique technique;
+		technique.Name = Next().Text;
+		if (!Expect( "{" )) return false;
+		while (Peek().Text == "pass")
+		{
+			Next();
+			Next();
+			if (Peek().Text != "{") return Expect( "{" );
+			size_t end = MatchingBracket();
+			SPass pass;
+			pass.AlphaBlend = false;
+			for (size_t i = m_Pos; i < end; ++i)
+			{
+				if (m_Tokens[i].Text == "SetPixelShader" && m_Tokens[i + 2].Text == "CompileShader")
+				{
+					pass.Shader = m_Tokens[i + 6].Text;
+				}
+				else if (m_Tokens[i].Text == "SetBlendState")
+				{
+					pass.AlphaBlend = m_Effect.AlphaBlendStates.count( m_Tokens[i + 2].Text ) != 0;
+				}
+			}
+			technique.Passes.push_back( pass );
+			m_Pos = end;
+			Next();
+		}
+		if (!Expect( "}" )) return false;
+		m_Effect.Techniques.push_back( technique );
+		return true;
+	}
+
+	const vector<SToken>& m_Tokens;
+	SEffect&              m_Effect;
+	size_t                m_Pos;
+	string                m_Error;
+};
+
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+void WriteSection( FILE* file, const char* title )
+{
+	fprintf( file, "\n\n//-----------------------------------------------------------------------------\n" );
+	fprintf( file, "// %s\n", title );
+	fprintf( file, "//-----------------------------------------------------------------------------\n\n" );
+}
+
+const SPixelShader* FindShader( const SEffect& effect, const string& name )
+{
+	for (size_t i = 0; i < effect.Shaders.size(); ++i)
+	{
+		if (effect.Shaders[i].Name == name) return &effect.Shaders[i];
+	}
+	return 0;
+}
+
+// Whether every pass of a technique has a translated pixel shader
+bool IsTranslated( const SEffect& effect, const STechnique& technique )
+{
+	for (size_t i = 0; i < technique.Passes.size(); ++i)
+	{
+		const SPixelShader* shader = FindShader( effect, technique.Passes[i].Shader );
+		if (!shader || !shader->Problem.empty()) return false;
+	}
+	return !technique.Passes.empty();
+}
+
+// Write the generated header
+void WriteEffect( FILE* file, const SEffect& effect, const string& headerName, const string& effectName )
+{
+	fprintf( file, "/*******************************************\n" );
+	fprintf( file, "\t%s\n\n", headerName.c_str() );
+	fprintf( file, "\tC++ versions of the pixel shaders in\n" );
+	fprintf( file, "\t%s. Generated by\n", effectName.c_str() );
+	fprintf( file, "\tPostProcessShaderGen - do not edit\n" );
+	fprintf( file, "********************************************/\n\n" );
+	fprintf( file, "#pragma once\n\n" );
+	fprintf( file, "#include \"ShaderTypes.h\"\n\n" );
+	fprintf( file, "namespace gen\n{\nnamespace hlsl\n{\n" );
+
+	WriteSection( file, "Sampler states" );
+	for (size_t i = 0; i < effect.Samplers.size(); ++i)
+	{
+		const SSamplerState& sampler = effect.Samplers[i];
+		fprintf( file, "const SSamplerState<%s, %s> %s = {};\n", sampler.Filter.c_str(), sampler.Address.c_str(), sampler.Name.c_str() );
+	}
+
+	WriteSection( file, "Constants and structures" );
+	for (size_t i = 0; i < effect.Variables.size(); ++i)
+	{
+		const SVariable& variable = effect.Variables[i];
+		if (variable.Initialiser.empty()) continue;
+		string array = variable.ArraySize.empty() ? "" : "[" + variable.ArraySize + "]";
+		fprintf( file, "const %s %s%s = %s;\n", variable.Type.c_str(), variable.Name.c_str(), array.c_str(), variable.Initialiser.c_str() );
+	}
+	set<string> inputs;
+	for (size_t i = 0; i < effect.Shaders.size(); ++i)
+	{
+		inputs.insert( effect.Shaders[i].InputType );
+	}
+	for (size_t i = 0; i < effect.Structures.size(); ++i)
+	{
+		const SStructure& structure = effect.Structures[i];
+		if (!inputs.count( structure.Name )) continue;
+		fprintf( file, "\nstruct %s\n{\n", structure.Name.c_str() );
+		for (size_t m = 0; m < structure.Members.size(); ++m)
+		{
+			fprintf( file, "\t%s %s;\n", structure.Members[m].first.c_str(), structure.Members[m].second.c_str() );
+		}
+		fprintf( file, "};\n" );
+	}
+
+	// The variables and shaders
+	WriteSection( file, "Shaders" );
+	fprintf( file, "// The effect's variables and translated pixel shaders. Variables are zero until set\n" );
+	fprintf( file, "struct SPostProcessShaders\n{\n" );
+	for (size_t i = 0; i < effect.Variables.size(); ++i)
+	{
+		const SVariable& variable = effect.Variables[i];
+		if (!variable.Initialiser.empty()) continue;
+		string array = variable.ArraySize.empty() ? "" : "[" + variable.ArraySize + "]";
+		fprintf( file, "\t%s %s%s;\n", variable.Type.c_str(), variable.Name.c_str(), array.c_str() );
+	}
+	for (size_t i = 0; i < effect.Textures.size(); ++i)
+	{
+		fprintf( file, "\tTexture2D %s;\n", effect.Textures[i].Name.c_str() );
+	}
+	fprintf( file, "\n\tSPostProcessShaders()\n\t{\n" );
+	for (size_t i = 0; i < effect.Variables.size(); ++i)
+	{
+		const SVariable& variable = effect.Variables[i];
+		if (!variable.Initialiser.empty()) continue;
+		if (variable.ArraySize.empty())
+		{
+			fprintf( file, "\t\t%s = 0;\n", variable.Name.c_str() );
+		}
+		else
+		{
+			fprintf( file, "\t\tfor (int i = 0; i < %s; ++i) %s[i] = 0;\n", variable.ArraySize.c_str(), variable.Name.c_str() );
+		}
+	}
+	fprintf( file, "\t}\n" );
+	for (size_t i = 0; i < effect.Shaders.size(); ++i)
+	{
+		const SPixelShader& shader = effect.Shaders[i];
+		if (!shader.Problem.empty()) continue;
+		fprintf( file, "\n\t// %s line %u\n", effectName.c_str(), shader.Line );
+		fprintf( file, "\tfloat4 %s( const %s& %s ) const\n\t%s\n", shader.Name.c_str(), shader.InputType.c_str(),
+		         shader.InputName.c_str(), shader.Body.c_str() );
+	}
+	fprintf( file, "};\n" );
+
+	// Technique table
+	WriteSection( file, "Techniques" );
+	vector<const STechnique*> techniques;
+	for (size_t i = 0; i < effect.Techniques.size(); ++i)
+	{
+		if (IsTranslated( effect, effect.Techniques[i] )) techniques.push_back( &effect.Techniques[i] );
+	}
+	fprintf( file, "// Techniques whose passes all have translated shaders\n" );
+	fprintf( file, "const TUInt32 kNumPostProcessTechniques = %u;\n", static_cast<TUInt32>(techniques.size()) );
+	fprintf( file, "const char* const PostProcessTechniques[kNumPostProcessTechniques] =\n{\n" );
+	for (size_t i = 0; i < techniques.size(); ++i)
+	{
+		fprintf( file, "\t\"%s\",\n", techniques[i]->Name.c_str() );
+	}
+	fprintf( file, "};\n\n" );
+	fprintf( file, "// Run the passes of the named technique in order, calling the runner for each as\n" );
+	fprintf( file, "// runner( pass, numPasses, alphaBlend, shader ), where shader( shaders, input ) runs the pass's\n" );
+	fprintf( file, "// pixel shader. Stops if the runner returns false. Returns false if the runner failed or there\n" );
+	fprintf( file, "// is no technique of that name in PostProcessTechniques\n" );
+	fprintf( file, "template <class TRunner>\nbool RunPostProcessTechnique( const char* name, TRunner& runner )\n{\n" );
+	for (size_t i = 0; i < techniques.size(); ++i)
+	{
+		const STechnique& technique = *techniques[i];
+		fprintf( file, "\tif (strcmp( name, \"%s\" ) == 0)\n\t{\n", technique.Name.c_str() );
+		for (size_t p = 0; p < technique.Passes.size(); ++p)
+		{
+			const SPass& pass = technique.Passes[p];
+			const SPixelShader& shader = *FindShader( effect, pass.Shader );
+			bool last = p + 1 == technique.Passes.size();
+			fprintf( file, "\t\t%srunner( %u, %u, %s, []( const SPostProcessShaders& s, const %s& input ) { return s.%s( input ); } )%s;\n",
+			         last ? "return " : "if (!", static_cast<TUInt32>(p), static_cast<TUInt32>(technique.Passes.size()),
+			         pass.AlphaBlend ? "true" : "false", shader.InputType.c_str(), shader.Name.c_str(), last ? "" : ") return false" );
+		}
+		fprintf( file, "\t}\n" );
+	}
+	fprintf( file, "\treturn false;\n}\n" );
+
+	fprintf( file, "\n\n} // namespace hlsl\n} // namespace gen\n" );
+}
+
+
+// Name of a file without its directory
+string FileName( const string& path )
+{
+	size_t slash = path.find_last_of( "/\\" );
+	return (slash == string::npos) ? path : path.substr( slash + 1 );
+}
+
+int RunShaderGen( const string& effectPath, const string& outputPath )
+{
+	FILE* file = fopen( effectPath.c_str(), "rb" );
+	if (!file)
+	{
+		fprintf( stderr, "Cannot open %s\n", effectPath.c_str() );
+		return 1;
+	}
+	string source;
+	char buffer[4096];
+	size_t read;
+	while ((read = fread( buffer, 1, sizeof(buffer), file )) > 0)
+	{
+		source.append( buffer, read );
+	}
+	fclose( file );
+
+	vector<SToken> tokens;
+	SEffect effect;
+	string error;
+	CEffectParser parser( tokens, effect );
+	if (!Tokenise( source, tokens, error ) || !parser.Parse( error ))
+	{
+		fprintf( stderr, "%s: %s\n", effectPath.c_str(), error.c_str() );
+		return 1;
+	}
+
+	// Shaders that cannot be translated are warnings in the format Visual Studio lists
+	for (size_t i = 0; i < effect.Shaders.size(); ++i)
+	{
+		const SPixelShader& shader = effect.Shaders[i];
+		if (!shader.Problem.empty())
+		{
+			fprintf( stderr, "%s: warning: %s not translated, %s\n", effectPath.c_str(), shader.Name.c_str(), shader.Problem.c_str() );
+		}
+	}
+
+	FILE* output = fopen( outputPath.c_str(), "wb" );
+	if (!output)
+	{
+		fprintf( stderr, "Cannot create %s\n", outputPath.c_str() );
+		return 1;
+	}
+	WriteEffect( output, effect, FileName( outputPath ), FileName( effectPath ) );
+	if (fclose( output ) != 0)
+	{
+		fprintf( stderr, "Failed to write %s\n", outputPath.c_str() );
+		return 1;
+	}
+	return 0;
+}
+
+
+} // namespace gen
+
+
+int main( int argc, char* argv[] )
+{
+	if (argc != 3)
+	{
+		fprintf( stderr,
+			"Usage: PostProcessShaderGen <effect.fx> <output.h>\n"
+			"\n"
+			"Writes C++ versions of the effect's pixel shaders for the CPU filters\n" );
+		return 1;
+	}
+	return gen::RunShaderGen( argv[1], argv[2] );
+}
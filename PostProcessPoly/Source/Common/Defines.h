@@ -20,8 +20,10 @@ using namespace std;
 // Include platform specific definitions
 #if defined (_MSC_VER)
 	#include "MSDefines.h" // _MSC_VER is only defined on Microsoft compilers
+#elif defined (__GNUC__)
+	#include "GCCDefines.h" // Also defined by Clang
 #else
-	#error "Unsupported OS/compiler - only Windows and Visual Studio supported at present"
+	#error "Unsupported OS/compiler - only Visual Studio, GCC and Clang supported at present"
 #endif
 
 namespace gen
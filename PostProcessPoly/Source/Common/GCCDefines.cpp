@@ -0,0 +1,34 @@
+/*******************************************
+	GCCDefines.cpp
+
+	Utility functions for GCC and Clang
+	on platforms other than Windows
+********************************************/
+
+#include <stdio.h>
+
+#include "Defines.h"
+#include "GCCDefines.h"
+
+namespace gen
+{
+
+/*------------------------------------------------------------------------------------------------
+	OS-specific GUI support
+ ------------------------------------------------------------------------------------------------*/
+
+// System message box used to display errors or warnings, written to stderr as there is no GUI
+// to show it in. Return value is whether the Yes or OK button would have been pressed
+bool SystemMessageBox
+(
+	const string& sMessage, // Main message to display
+	const string& sCaption, // Caption to display at top of box
+	const bool    bYesNo    // Display Yes and No buttons instead of OK
+)
+{
+	fprintf( stderr, "%s: %s\n", sCaption.c_str(), sMessage.c_str() );
+	return !bYesNo;
+}
+
+
+} // namespace gen
@@ -0,0 +1,109 @@
+/*******************************************
+	GCCDefines.h
+
+	Utility functions for GCC and Clang
+	on platforms other than Windows
+********************************************/
+
+#ifndef GEN_GCC_DEFINES_H_INCLUDED
+#define GEN_GCC_DEFINES_H_INCLUDED
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string>
+using namespace std;
+
+namespace gen
+{
+
+/*------------------------------------------------------------------------------------------------
+	Compiler settings
+ ------------------------------------------------------------------------------------------------*/
+
+// Check compiler options
+#if !defined(__EXCEPTIONS) && !defined(__cpp_exceptions)
+	#error "Bad compiler option: C++ exception handling must be enabled"
+#endif
+
+
+/*------------------------------------------------------------------------------------------------
+	Macros
+ ------------------------------------------------------------------------------------------------*/
+
+// Prefix to align a structure or class in memory to a multiple of the given amount
+#define GEN_ALIGN(a) __attribute__((aligned(a)))
+
+
+/*------------------------------------------------------------------------------------------------
+	Constants
+ ------------------------------------------------------------------------------------------------*/
+
+// Define compiler name
+#if defined(__clang__)
+	static const string ksCompiler = "Clang";
+#else
+	static const string ksCompiler = "GCC";
+#endif
+
+
+// String locale
+const string ksPathSeparator = "/";
+const string ksNewline = "\n";
+
+
+/*------------------------------------------------------------------------------------------------
+	Types
+ ------------------------------------------------------------------------------------------------*/
+
+// Typedefs for fixed size types
+typedef int8_t           TInt8;
+typedef int16_t          TInt16;
+typedef int32_t          TInt32;
+typedef int64_t          TInt64;
+
+typedef uint8_t          TUInt8;
+typedef uint16_t         TUInt16;
+typedef uint32_t         TUInt32;
+typedef uint64_t         TUInt64;
+
+typedef float            TFloat32;
+typedef double           TFloat64;
+
+
+/*------------------------------------------------------------------------------------------------
+	GUI support
+ ------------------------------------------------------------------------------------------------*/
+
+// There is no system message box here, so the message is written to stderr. Defaults to having an
+// OK button only, but can request Yes/No buttons. Return value is whether the Yes or OK button
+// would have been pressed - always No for a question, as nobody is there to answer it
+bool SystemMessageBox
+(
+	const string& sMessage,                       // Main message to display
+	const string& sCaption = "TL-Engine Extreme", // Caption to display at top of box
+	const bool    bYesNo = false                  // Display Yes and No buttons instead of OK
+);
+
+
+} // namespace gen
+
+
+/*------------------------------------------------------------------------------------------------
+	Microsoft CRT functions
+ ------------------------------------------------------------------------------------------------*/
+
+// Aligned allocation as provided by the Microsoft CRT, used for SSE image data
+inline void* _aligned_malloc( size_t size, size_t alignment )
+{
+	void* memory = NULL;
+	if (alignment < sizeof(void*)) alignment = sizeof(void*);
+	if (posix_memalign( &memory, alignment, size ) != 0) return NULL;
+	return memory;
+}
+
+inline void _aligned_free( void* memory )
+{
+	free( memory );
+}
+
+#endif // GEN_GCC_DEFINES_H_INCLUDED
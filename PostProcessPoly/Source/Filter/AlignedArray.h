@@ -0,0 +1,102 @@
+/*******************************************
+	AlignedArray.h
+
+	Fixed size array with 16 byte aligned storage,
+	used for SSE working buffers in the filters
+********************************************/
+
+#pragma once
+
+#include <malloc.h>
+#include <string.h>
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Simple owning array whose storage is aligned for SSE loads and stores. Only intended for plain
+// data types (floats, integers) - constructors and destructors of elements are not called
+template <class T>
+class CAlignedArray
+{
+public:
+	CAlignedArray()
+	{
+		m_Data = 0;
+		m_Size = 0;
+	}
+
+	CAlignedArray( TUInt32 size )
+	{
+		m_Data = 0;
+		m_Size = 0;
+		Resize( size );
+	}
+
+	~CAlignedArray()
+	{
+		Release();
+	}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CAlignedArray( const CAlignedArray& );
+	CAlignedArray& operator=( const CAlignedArray& );
+
+public:
+	// Resize the array, existing contents are lost. Returns false on memory failure
+	bool Resize( TUInt32 size )
+	{
+		if (size == m_Size) return true;
+		Release();
+		if (size == 0) return true;
+		m_Data = static_cast<T*>(_aligned_malloc( sizeof(T) * static_cast<size_t>(size), 16 ));
+		if (!m_Data) return false;
+		m_Size = size;
+		return true;
+	}
+
+	void Release()
+	{
+		if (m_Data) _aligned_free( m_Data );
+		m_Data = 0;
+		m_Size = 0;
+	}
+
+	// Set every byte of the array to zero
+	void Clear()
+	{
+		if (m_Data) memset( m_Data, 0, sizeof(T) * static_cast<size_t>(m_Size) );
+	}
+
+	TUInt32 Size() const
+	{
+		return m_Size;
+	}
+
+	T* Data()
+	{
+		return m_Data;
+	}
+	const T* Data() const
+	{
+		return m_Data;
+	}
+
+	T& operator[]( TUInt32 index )
+	{
+		return m_Data[index];
+	}
+	const T& operator[]( TUInt32 index ) const
+	{
+		return m_Data[index];
+	}
+
+private:
+	T*      m_Data;
+	TUInt32 m_Size;
+};
+
+
+} // namespace gen
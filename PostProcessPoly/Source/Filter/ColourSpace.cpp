@@ -0,0 +1,119 @@
+/*******************************************
+	ColourSpace.cpp
+
+	Table driven conversion between 8-bit sRGB
+	and linear light for the CPU filters
+********************************************/
+
+#include <math.h>
+#include <float.h>
+
+#include "ColourSpace.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Transfer functions
+//-----------------------------------------------------------------------------
+
+// Double precision versions used to build the tables
+double SRGBToLinearDouble( double srgb )
+{
+	if (srgb <= 0.04045)
+	{
+		return srgb / 12.92;
+	}
+	return pow( (srgb + 0.055) / 1.055, 2.4 );
+}
+
+double LinearToSRGBDouble( double linear )
+{
+	if (linear <= 0.0031308)
+	{
+		return linear * 12.92;
+	}
+	return 1.055 * pow( linear, 1.0 / 2.4 ) - 0.055;
+}
+
+
+// Exact sRGB transfer functions on 0->1 values, for reference and table building
+TFloat32 SRGBToLinearExact( TFloat32 srgb )
+{
+	return static_cast<TFloat32>(SRGBToLinearDouble( srgb ));
+}
+
+TFloat32 LinearToSRGBExact( TFloat32 linear )
+{
+	return static_cast<TFloat32>(LinearToSRGBDouble( linear ));
+}
+
+
+//-----------------------------------------------------------------------------
+// Conversion tables
+//-----------------------------------------------------------------------------
+
+TFloat32 SRGBDecodeTable[256];
+__m128   SRGBDecodeTableR[256];
+__m128   SRGBDecodeTableG[256];
+__m128   SRGBDecodeTableB[256];
+TUInt32  SRGBEncodeTable[kSRGBEncodeBuckets];
+
+// Fills the tables during static initialisation, so they are ready before any filter runs
+struct SSRGBTableBuilder
+{
+	SSRGBTableBuilder()
+	{
+		for (int code = 0; code < 256; ++code)
+		{
+			TFloat32 linear = static_cast<TFloat32>(SRGBToLinearDouble( code / 255.0 ) * 255.0);
+			SRGBDecodeTable[code] = linear;
+			SRGBDecodeTableR[code] = _mm_set_ps( 0.0f, 0.0f, 0.0f, linear );
+			SRGBDecodeTableG[code] = _mm_set_ps( 0.0f, 0.0f, linear, 0.0f );
+			SRGBDecodeTableB[code] = _mm_set_ps( 0.0f, linear, 0.0f, 0.0f );
+		}
+
+		// Rounding boundaries as float bit patterns - the smallest float that encodes to at least
+		// code + 0.5, found by nudging the float nearest the true boundary. This makes the table
+		// encode agree exactly with rounding the double precision curve
+		TUInt32 thresholds[256];
+		for (int code = 0; code < 255; ++code)
+		{
+			double boundary = (code + 0.5) / 255.0;
+			TFloat32 threshold = static_cast<TFloat32>(SRGBToLinearDouble( boundary ));
+			while (LinearToSRGBDouble( threshold ) >= boundary)
+			{
+				threshold = nextafterf( threshold, 0.0f );
+			}
+			while (LinearToSRGBDouble( threshold ) < boundary)
+			{
+				threshold = nextafterf( threshold, 2.0f );
+			}
+			union { TFloat32 f; TUInt32 u; } bits;
+			bits.f = threshold;
+			thresholds[code] = bits.u;
+		}
+		thresholds[255] = 0xffffffff;
+
+		// Code at the bottom of each bucket and the boundary within it if there is one
+		TUInt32 code = 0;
+		for (TUInt32 bucket = 0; bucket < kSRGBEncodeBuckets; ++bucket)
+		{
+			TUInt32 bucketStart = (kSRGBEncodeMinExponent << 23) + (bucket << 15);
+			while (thresholds[code] <= bucketStart)
+			{
+				++code;
+			}
+			// Buckets are at most a third of a code wide so never hold a second boundary
+			TUInt32 boundary = 0x8000;
+			if (thresholds[code] < bucketStart + 0x8000)
+			{
+				boundary = thresholds[code] - bucketStart;
+			}
+			SRGBEncodeTable[bucket] = (code << 16) | boundary;
+		}
+	}
+} SRGBTableBuilder;
+
+
+} // namespace gen
@@ -0,0 +1,140 @@
+/*******************************************
+	ColourSpace.h
+
+	Conversion between 8-bit sRGB and linear
+	light for the CPU filters
+********************************************/
+
+#pragma once
+
+#include <emmintrin.h> // SSE2
+
+#include "Defines.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Conversion tables
+//-----------------------------------------------------------------------------
+
+// The scene textures are R8G8B8A8_UNORM holding gamma (sRGB) encoded colours. Filters that
+// average pixels (blurs, blends) should do so in linear light, which needs a pow per channel in
+// each direction. Here decoding is a 256 entry lookup. The scalar encode uses a table indexed by
+// the exponent and top 8 mantissa bits of the linear float (13 octaves down to 2^-13, below which
+// everything encodes to 0). Each bucket is narrow enough to contain at most one rounding
+// boundary, so each entry holds the code at the bottom of the bucket and the position of the
+// boundary within it (in the remaining 15 mantissa bits). One lookup and one comparison gives
+// exactly the same result as rounding the true sRGB curve. The SSE encode, used by the filters,
+// is a polynomial instead (see EncodeSRGBSSE) - three scalar table reads a pixel cost more than
+// the filters they were added to
+
+// Decode table: sRGB byte -> linear light, scaled to the 0->255 range used by the filters
+extern TFloat32 SRGBDecodeTable[256];
+
+// Decode tables giving a float4 with the linear value in just one channel (and zero elsewhere),
+// so an RGB pixel decodes with three aligned loads and no shuffling
+extern __m128 SRGBDecodeTableR[256];
+extern __m128 SRGBDecodeTableG[256];
+extern __m128 SRGBDecodeTableB[256];
+
+// Encode table for LinearToSRGB: bucket -> (code at bottom of bucket << 16) | (low mantissa bits
+// at which the code rounds up to the next, 0x8000 if it does not within the bucket)
+const TUInt32 kSRGBEncodeMinExponent = 114; // Biased exponent of 2^-13
+const TUInt32 kSRGBEncodeBuckets = 13 * 256;
+extern TUInt32 SRGBEncodeTable[kSRGBEncodeBuckets];
+
+
+//-----------------------------------------------------------------------------
+// Scalar conversion
+//-----------------------------------------------------------------------------
+
+// Exact sRGB transfer functions on 0->1 values, for reference and table building
+TFloat32 SRGBToLinearExact( TFloat32 srgb );
+TFloat32 LinearToSRGBExact( TFloat32 linear );
+
+// Convert an 8-bit sRGB value to linear light (0->1)
+inline TFloat32 SRGBToLinear( TUInt8 srgb )
+{
+	return SRGBDecodeTable[srgb] * (1.0f / 255.0f);
+}
+
+// Convert linear light (0->1, clamped) to the nearest 8-bit sRGB value
+inline TUInt8 LinearToSRGB( TFloat32 linear )
+{
+	if (!(linear > 0.0f)) return 0; // Also catches NaN
+	if (linear >= 1.0f) return 255;
+
+	// Values below the table range are all well under the first rounding boundary
+	union { TFloat32 f; TUInt32 u; } bits;
+	bits.f = linear;
+	if (bits.u < (kSRGBEncodeMinExponent << 23)) return 0;
+
+	TUInt32 entry = SRGBEncodeTable[(bits.u - (kSRGBEncodeMinExponent << 23)) >> 15];
+	return static_cast<TUInt8>((entry >> 16) + ((bits.u & 0x7fff) >= (entry & 0xffff) ? 1 : 0));
+}
+
+
+//-----------------------------------------------------------------------------
+// SSE conversion
+//-----------------------------------------------------------------------------
+
+// Load one sRGB RGBA8 pixel as a linear light float4 in the 0->255 range. Alpha is not gamma
+// encoded so is converted directly
+inline __m128 LoadPixelLinearSSE( const TUInt8* pixel )
+{
+	__m128 alpha = _mm_cvtepi32_ps( _mm_slli_si128( _mm_cvtsi32_si128( pixel[3] ), 12 ) );
+	__m128 rg = _mm_or_ps( SRGBDecodeTableR[pixel[0]], SRGBDecodeTableG[pixel[1]] );
+	return _mm_or_ps( _mm_or_ps( rg, SRGBDecodeTableB[pixel[2]] ), alpha );
+}
+
+// Encode a linear light float4 (0->255 range) to sRGB codes one per 32-bit lane, with alpha
+// rounded directly. There are no table reads, as SSE2 has no gather. Above 0.0031308 the curve
+// 1.055 x^(1/2.4) - 0.055 is a function of q = x^(1/4), which a degree 5 polynomial in q (a
+// Chebyshev fit on the 0->255 range) follows to within 0.0025 of a code. The square root taken on
+// the way to q is q^2, and x is q^4, so the even and odd terms are summed separately while q is
+// found and the chain of dependent instructions is short. Below 0.0031308 the curve is the line
+// 12.92 x, which is under the curve there and over it above, so the code is the lesser of the
+// line and the curve with x clamped to at least 0.0031308 - no comparison needed. Alpha's
+// constant term is 1024 higher so in that lane the line, which is alpha itself, is always taken.
+// Codes only differ from the exactly rounded LinearToSRGB within 0.0025 of a code of a rounding
+// boundary, and then by 1 (PostProcessFilterBench --linear-light checks every float). NaN stays
+// NaN, which converts to 0x80000000 and so stores as 0
+inline __m128i EncodeSRGBSSE( __m128 colour )
+{
+	const __m128 low = _mm_set1_ps( 0.0031308f * 255.0f );
+	__m128 x = _mm_min_ps( _mm_max_ps( colour, low ), _mm_set1_ps( 255.0f ) );
+	__m128 q2 = _mm_sqrt_ps( x );
+	__m128 q = _mm_sqrt_ps( q2 );
+
+	// c0 + c2 q^2 + c4 q^4 + q (c1 + c3 q^2 + c5 q^4)
+	__m128 even = _mm_add_ps( _mm_mul_ps( q2, _mm_set1_ps( 1.986850357e+01f ) ), _mm_mul_ps( x, _mm_set1_ps( 2.727522552e-01f ) ) );
+	even = _mm_add_ps( even, _mm_set_ps( -1.571557522e+01f + 1024.0f, -1.571557522e+01f, -1.571557522e+01f, -1.571557522e+01f ) );
+	__m128 odd = _mm_add_ps( _mm_mul_ps( q2, _mm_set1_ps( -2.228041410e+00f ) ), _mm_mul_ps( x, _mm_set1_ps( -1.570510678e-02f ) ) );
+	odd = _mm_add_ps( odd, _mm_set1_ps( 1.052738857e+01f ) );
+	__m128 curve = _mm_add_ps( even, _mm_mul_ps( q, odd ) );
+
+	// Min returns the second operand if either is NaN
+	__m128 line = _mm_mul_ps( colour, _mm_set_ps( 1.0f, 12.92f, 12.92f, 12.92f ) );
+	return _mm_cvtps_epi32( _mm_min_ps( curve, line ) );
+}
+
+// Store a linear light float4 (0->255 range) as one sRGB RGBA8 pixel
+inline void StorePixelLinearSSE( TUInt8* pixel, __m128 colour )
+{
+	__m128i p = EncodeSRGBSSE( colour );
+	p = _mm_packs_epi32( p, p );
+	p = _mm_packus_epi16( p, p );
+	*reinterpret_cast<int*>(pixel) = _mm_cvtsi128_si32( p );
+}
+
+// Store four linear light float4 registers as four consecutive sRGB RGBA8 pixels
+inline void StorePixels4LinearSSE( TUInt8* pixels, __m128 p0, __m128 p1, __m128 p2, __m128 p3 )
+{
+	__m128i lo = _mm_packs_epi32( EncodeSRGBSSE( p0 ), EncodeSRGBSSE( p1 ) );
+	__m128i hi = _mm_packs_epi32( EncodeSRGBSSE( p2 ), EncodeSRGBSSE( p3 ) );
+	_mm_storeu_si128( reinterpret_cast<__m128i*>(pixels), _mm_packus_epi16( lo, hi ) );
+}
+
+
+} // namespace gen
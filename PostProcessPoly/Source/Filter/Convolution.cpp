@@ -0,0 +1,586 @@
+/*******************************************
+	Convolution.cpp
+
+	General convolution of CPU images with
+	arbitrary kernels. Separable kernels are
+	detected and run as two 1D passes
+********************************************/
+
+#include <math.h>
+#include <string.h>
+#include <limits.h>
+
+#include "Convolution.h"
+#include "AlignedArray.h"
+#include "PixelSSE.h"
+#include "ColourSpace.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Convolution kernel
+//-----------------------------------------------------------------------------
+
+// Relative tolerance used when testing whether a kernel is rank 1
+const TFloat32 kSeparableTolerance = 1e-5f;
+
+// Default constructor gives a 1x1 identity kernel
+CConvolutionKernel::CConvolutionKernel()
+{
+	m_Width = 1;
+	m_Height = 1;
+	m_Weights.assign( 1, 1.0f );
+	m_Bias = 0.0f;
+	Decompose();
+}
+
+// Construct from a row-major array of width * height weights
+CConvolutionKernel::CConvolutionKernel( TUInt32 width, TUInt32 height, const TFloat32* weights, TFloat32 bias /*= 0.0f*/ )
+{
+	m_Width = width;
+	m_Height = height;
+	m_Weights.assign( weights, weights + width * height );
+	m_Bias = bias;
+	Decompose();
+}
+
+// Construct a separable kernel directly from a column and a row vector
+CConvolutionKernel::CConvolutionKernel( const vector<TFloat32>& column, const vector<TFloat32>& row, TFloat32 bias /*= 0.0f*/ )
+{
+	m_Width = static_cast<TUInt32>(row.size());
+	m_Height = static_cast<TUInt32>(column.size());
+	m_Weights.resize( m_Width * m_Height );
+	for (TUInt32 y = 0; y < m_Height; ++y)
+	{
+		for (TUInt32 x = 0; x < m_Width; ++x)
+		{
+			m_Weights[y * m_Width + x] = column[y] * row[x];
+		}
+	}
+	m_Bias = bias;
+	Decompose();
+}
+
+
+// Test the kernel for rank 1 and extract the column and row vectors if so. A rank 1 matrix K
+// has every row a multiple of every other row. Choose the largest element K[p][q] as pivot,
+// then column = K[*][q] and row = K[p][*] / K[p][q]. The kernel is separable if the outer
+// product of these two vectors reproduces K within tolerance
+void CConvolutionKernel::Decompose()
+{
+	m_IsSeparable = false;
+	m_Column.clear();
+	m_Row.clear();
+
+	// Find pivot - the element of largest magnitude
+	TUInt32 pivotX = 0, pivotY = 0;
+	TFloat32 maxAbs = 0.0f;
+	for (TUInt32 y = 0; y < m_Height; ++y)
+	{
+		for (TUInt32 x = 0; x < m_Width; ++x)
+		{
+			TFloat32 absWeight = fabsf( Weight( x, y ) );
+			if (absWeight > maxAbs)
+			{
+				maxAbs = absWeight;
+				pivotX = x;
+				pivotY = y;
+			}
+		}
+	}
+
+	// An all-zero kernel is trivially separable
+	m_Column.resize( m_Height );
+	m_Row.resize( m_Width );
+	if (maxAbs == 0.0f)
+	{
+		m_IsSeparable = true;
+		return;
+	}
+
+	TFloat32 pivot = Weight( pivotX, pivotY );
+	for (TUInt32 y = 0; y < m_Height; ++y)
+	{
+		m_Column[y] = Weight( pivotX, y );
+	}
+	for (TUInt32 x = 0; x < m_Width; ++x)
+	{
+		m_Row[x] = Weight( x, pivotY ) / pivot;
+	}
+
+	// Check residual of the rank 1 reconstruction
+	for (TUInt32 y = 0; y < m_Height; ++y)
+	{
+		for (TUInt32 x = 0; x < m_Width; ++x)
+		{
+			if (fabsf( Weight( x, y ) - m_Column[y] * m_Row[x] ) > kSeparableTolerance * maxAbs)
+			{
+				m_Column.clear();
+				m_Row.clear();
+				return;
+			}
+		}
+	}
+	m_IsSeparable = true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Standard kernels
+//-----------------------------------------------------------------------------
+
+// Gaussian blur built from the BlurWeights half kernel in PostProcess.fx (9x9, separable)
+CConvolutionKernel GaussianBlurKernel()
+{
+	const TFloat32 BlurWeights[5] = { 0.2270270270f, 0.1945945946f, 0.1216216216f, 0.0540540541f, 0.0162162162f };
+
+	// Mirror the half kernel to give the full 9 taps
+	vector<TFloat32> weights( 9 );
+	for (int i = 0; i < 5; ++i)
+	{
+		weights[4 + i] = BlurWeights[i];
+		weights[4 - i] = BlurWeights[i];
+	}
+	return CConvolutionKernel( weights, weights );
+}
+
+// Gaussian blur with the given standard deviation in pixels (separable, radius 3 sigma)
+CConvolutionKernel GaussianBlurKernel( TFloat32 sigma )
+{
+	if (sigma <= 0.0f)
+	{
+		return CConvolutionKernel();
+	}
+
+	int radius = static_cast<int>(ceilf( 3.0f * sigma ));
+	vector<TFloat32> weights( 2 * radius + 1 );
+	TFloat32 sum = 0.0f;
+	for (int i = -radius; i <= radius; ++i)
+	{
+		weights[i + radius] = expf( -(i * i) / (2.0f * sigma * sigma) );
+		sum += weights[i + radius];
+	}
+	for (size_t i = 0; i < weights.size(); ++i)
+	{
+		weights[i] /= sum;
+	}
+	return CConvolutionKernel( weights, weights );
+}
+
+// Sharpen the image - centre weighted Laplacian added to the original (3x3, not separable)
+CConvolutionKernel SharpenKernel()
+{
+	const TFloat32 weights[9] = {  0.0f, -1.0f,  0.0f,
+	                              -1.0f,  5.0f, -1.0f,
+	                               0.0f, -1.0f,  0.0f };
+	return CConvolutionKernel( 3, 3, weights );
+}
+
+// Edge detection - 8-neighbour Laplacian (3x3, not separable)
+CConvolutionKernel EdgeDetectKernel()
+{
+	const TFloat32 weights[9] = { -1.0f, -1.0f, -1.0f,
+	                              -1.0f,  8.0f, -1.0f,
+	                              -1.0f, -1.0f, -1.0f };
+	return CConvolutionKernel( 3, 3, weights );
+}
+
+// Emboss lit from the top-left, biased to mid-grey (3x3, not separable)
+CConvolutionKernel EmbossKernel()
+{
+	const TFloat32 weights[9] = { -2.0f, -1.0f,  0.0f,
+	                              -1.0f,  1.0f,  1.0f,
+	                               0.0f,  1.0f,  2.0f };
+	return CConvolutionKernel( 3, 3, weights, 128.0f );
+}
+
+
+//-----------------------------------------------------------------------------
+// Convolution support
+//-----------------------------------------------------------------------------
+
+// Work is done on rows of float4 pixels (0->255 range). Source rows are expanded to floats with
+// extra pixels either side for the kernel to read past the image edges. Only as many rows as the
+// kernel height are held at once, in a ring indexed by source row modulo the kernel height.
+
+// Convert source row y to a row of float4 pixels (0->255 range) with padLeft / padRight extra
+// pixels filled according to the addressing mode. Rows above or below the image are clamped or
+// zeroed in the same way. If linearLight is set the colour channels are decoded from sRGB to
+// linear light (still 0->255 range). The output must be 16 byte aligned
+void ExpandRow
+(
+	const CImage& source,
+	TInt32        y,
+	TUInt32       padLeft,
+	TUInt32       padRight,
+	EAddressMode  addressMode,
+	TFloat32*     out,
+	bool          linearLight /*= false*/
+)
+{
+	const TUInt32 width = source.Width();
+	const TInt32 height = static_cast<TInt32>(source.Height());
+
+	if (y < 0 || y >= height)
+	{
+		if (addressMode == kAddressBorder)
+		{
+			memset( out, 0, (padLeft + width + padRight) * 4 * sizeof(TFloat32) );
+			return;
+		}
+		y = (y < 0) ? 0 : height - 1;
+	}
+	const TUInt8* row = source.Row( y );
+
+	// Decoding is table lookups per channel, so linear rows are converted a pixel at a time
+	if (linearLight)
+	{
+		__m128 edge = (addressMode == kAddressClamp) ? LoadPixelLinearSSE( row ) : _mm_setzero_ps();
+		for (TUInt32 i = 0; i < padLeft; ++i)
+		{
+			_mm_store_ps( out, edge );
+			out += 4;
+		}
+		for (TUInt32 x = 0; x < width; ++x)
+		{
+			_mm_store_ps( out, LoadPixelLinearSSE( row + x * 4 ) );
+			out += 4;
+		}
+		edge = (addressMode == kAddressClamp) ? LoadPixelLinearSSE( row + (width - 1) * 4 ) : _mm_setzero_ps();
+		for (TUInt32 i = 0; i < padRight; ++i)
+		{
+			_mm_store_ps( out, edge );
+			out += 4;
+		}
+		return;
+	}
+
+	// Left padding
+	__m128 edge = (addressMode == kAddressClamp) ? LoadPixelSSE( row ) : _mm_setzero_ps();
+	for (TUInt32 i = 0; i < padLeft; ++i)
+	{
+		_mm_store_ps( out, edge );
+		out += 4;
+	}
+
+	// Row content, four pixels at a time
+	TUInt32 x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128 p0, p1, p2, p3;
+		LoadPixels4SSE( row + x * 4, p0, p1, p2, p3 );
+		_mm_store_ps( out,      p0 );
+		_mm_store_ps( out + 4,  p1 );
+		_mm_store_ps( out + 8,  p2 );
+		_mm_store_ps( out + 12, p3 );
+		out += 16;
+	}
+	for (; x < width; ++x)
+	{
+		_mm_store_ps( out, LoadPixelSSE( row + x * 4 ) );
+		out += 4;
+	}
+
+	// Right padding
+	edge = (addressMode == kAddressClamp) ? LoadPixelSSE( row + (width - 1) * 4 ) : _mm_setzero_ps();
+	for (TUInt32 i = 0; i < padRight; ++i)
+	{
+		_mm_store_ps( out, edge );
+		out += 4;
+	}
+}
+
+// 1D filter a padded float row: out[x] = sum over i of weights[i] * in[x + i]. Four output
+// pixels are accumulated together so each weight is broadcast once per block
+void FilterRow
+(
+	const TFloat32* in,
+	const TFloat32* weights,
+	TUInt32         numTaps,
+	TUInt32         width,
+	TFloat32*       out
+)
+{
+	TUInt32 x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128 acc0 = _mm_setzero_ps();
+		__m128 acc1 = _mm_setzero_ps();
+		__m128 acc2 = _mm_setzero_ps();
+		__m128 acc3 = _mm_setzero_ps();
+		const TFloat32* p = in + x * 4;
+		for (TUInt32 tap = 0; tap < numTaps; ++tap)
+		{
+			__m128 w = _mm_set1_ps( weights[tap] );
+			acc0 = _mm_add_ps( acc0, _mm_mul_ps( w, _mm_load_ps( p      ) ) );
+			acc1 = _mm_add_ps( acc1, _mm_mul_ps( w, _mm_load_ps( p + 4  ) ) );
+			acc2 = _mm_add_ps( acc2, _mm_mul_ps( w, _mm_load_ps( p + 8  ) ) );
+			acc3 = _mm_add_ps( acc3, _mm_mul_ps( w, _mm_load_ps( p + 12 ) ) );
+			p += 4;
+		}
+		_mm_store_ps( out + x * 4,      acc0 );
+		_mm_store_ps( out + x * 4 + 4,  acc1 );
+		_mm_store_ps( out + x * 4 + 8,  acc2 );
+		_mm_store_ps( out + x * 4 + 12, acc3 );
+	}
+	for (; x < width; ++x)
+	{
+		__m128 acc = _mm_setzero_ps();
+		const TFloat32* p = in + x * 4;
+		for (TUInt32 tap = 0; tap < numTaps; ++tap)
+		{
+			acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( weights[tap] ), _mm_load_ps( p ) ) );
+			p += 4;
+		}
+		_mm_store_ps( out + x * 4, acc );
+	}
+}
+
+// Replace the alpha channel with 255, post-process shaders output opaque pixels
+inline __m128 OpaqueAlpha( __m128 colour )
+{
+	const __m128 rgbMask = _mm_castsi128_ps( _mm_set_epi32( 0, -1, -1, -1 ) );
+	const __m128 alpha = _mm_set_ps( 255.0f, 0.0f, 0.0f, 0.0f );
+	return _mm_or_ps( _mm_and_ps( colour, rgbMask ), alpha );
+}
+
+// Store four output pixels, encoding from linear light to sRGB if required
+inline void StoreOutput4( TUInt8* pixels, __m128 p0, __m128 p1, __m128 p2, __m128 p3, bool linearLight )
+{
+	if (linearLight)
+	{
+		StorePixels4LinearSSE( pixels, p0, p1, p2, p3 );
+	}
+	else
+	{
+		StorePixels4SSE( pixels, p0, p1, p2, p3 );
+	}
+}
+
+// Store one output pixel, encoding from linear light to sRGB if required
+inline void StoreOutput( TUInt8* pixel, __m128 colour, bool linearLight )
+{
+	if (linearLight)
+	{
+		StorePixelLinearSSE( pixel, colour );
+	}
+	else
+	{
+		StorePixelSSE( pixel, colour );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Convolution
+//-----------------------------------------------------------------------------
+
+// Separable path: each source row is filtered horizontally once as it enters the ring, then each
+// output row is the column-weighted sum of the filtered rows in the ring
+void ConvolveSeparable
+(
+	const CImage&             source,
+	CImage&                   dest,
+	const CConvolutionKernel& kernel,
+	EAddressMode              addressMode,
+	bool                      linearLight
+)
+{
+	const TUInt32 width = source.Width();
+	const TInt32 height = static_cast<TInt32>(source.Height());
+	const TUInt32 kernelWidth = kernel.Width();
+	const TUInt32 kernelHeight = kernel.Height();
+	const TUInt32 anchorX = (kernelWidth - 1) / 2;
+	const TInt32 anchorY = static_cast<TInt32>((kernelHeight - 1) / 2);
+	const TFloat32* rowWeights = &kernel.Row()[0];
+	const TFloat32* columnWeights = &kernel.Column()[0];
+
+	// Working memory: one padded source row, the ring of filtered rows and a zero row for borders
+	const TUInt32 rowFloats = width * 4;
+	CAlignedArray<TFloat32> expanded( (width + kernelWidth - 1) * 4 );
+	CAlignedArray<TFloat32> ring( rowFloats * kernelHeight );
+	CAlignedArray<TFloat32> zeroRow( rowFloats );
+	zeroRow.Clear();
+	vector<TInt32> ringSourceRow( kernelHeight, INT_MIN );
+	vector<const TFloat32*> rows( kernelHeight );
+
+	const __m128 bias = _mm_set1_ps( kernel.Bias() );
+	for (TInt32 y = 0; y < height; ++y)
+	{
+		// Gather the filtered rows needed for this output row, filtering any new ones
+		for (TUInt32 r = 0; r < kernelHeight; ++r)
+		{
+			TInt32 sourceY = y + static_cast<TInt32>(r) - anchorY;
+			if (sourceY < 0 || sourceY >= height)
+			{
+				if (addressMode == kAddressBorder)
+				{
+					rows[r] = zeroRow.Data();
+					continue;
+				}
+				sourceY = (sourceY < 0) ? 0 : height - 1;
+			}
+			TUInt32 slot = static_cast<TUInt32>(sourceY) % kernelHeight;
+			TFloat32* slotRow = ring.Data() + slot * rowFloats;
+			if (ringSourceRow[slot] != sourceY)
+			{
+				ExpandRow( source, sourceY, anchorX, kernelWidth - 1 - anchorX, addressMode, expanded.Data(), linearLight );
+				FilterRow( expanded.Data(), rowWeights, kernelWidth, width, slotRow );
+				ringSourceRow[slot] = sourceY;
+			}
+			rows[r] = slotRow;
+		}
+
+		// Vertical pass, four pixels at a time
+		TUInt8* outRow = dest.Row( y );
+		TUInt32 x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128 acc0 = bias, acc1 = bias, acc2 = bias, acc3 = bias;
+			for (TUInt32 r = 0; r < kernelHeight; ++r)
+			{
+				__m128 w = _mm_set1_ps( columnWeights[r] );
+				const TFloat32* p = rows[r] + x * 4;
+				acc0 = _mm_add_ps( acc0, _mm_mul_ps( w, _mm_load_ps( p      ) ) );
+				acc1 = _mm_add_ps( acc1, _mm_mul_ps( w, _mm_load_ps( p + 4  ) ) );
+				acc2 = _mm_add_ps( acc2, _mm_mul_ps( w, _mm_load_ps( p + 8  ) ) );
+				acc3 = _mm_add_ps( acc3, _mm_mul_ps( w, _mm_load_ps( p + 12 ) ) );
+			}
+			StoreOutput4( outRow + x * 4, OpaqueAlpha( acc0 ), OpaqueAlpha( acc1 ), OpaqueAlpha( acc2 ), OpaqueAlpha( acc3 ), linearLight );
+		}
+		for (; x < width; ++x)
+		{
+			__m128 acc = bias;
+			for (TUInt32 r = 0; r < kernelHeight; ++r)
+			{
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( columnWeights[r] ), _mm_load_ps( rows[r] + x * 4 ) ) );
+			}
+			StoreOutput( outRow + x * 4, OpaqueAlpha( acc ), linearLight );
+		}
+	}
+}
+
+// Non-separable path: the ring holds padded source rows and each block of four output pixels
+// keeps its accumulators in registers while all kernel taps are applied
+void ConvolveGeneral
+(
+	const CImage&             source,
+	CImage&                   dest,
+	const CConvolutionKernel& kernel,
+	EAddressMode              addressMode,
+	bool                      linearLight
+)
+{
+	const TUInt32 width = source.Width();
+	const TInt32 height = static_cast<TInt32>(source.Height());
+	const TUInt32 kernelWidth = kernel.Width();
+	const TUInt32 kernelHeight = kernel.Height();
+	const TUInt32 anchorX = (kernelWidth - 1) / 2;
+	const TInt32 anchorY = static_cast<TInt32>((kernelHeight - 1) / 2);
+
+	// Ring of padded source rows
+	const TUInt32 rowFloats = (width + kernelWidth - 1) * 4;
+	CAlignedArray<TFloat32> ring( rowFloats * kernelHeight );
+	CAlignedArray<TFloat32> zeroRow( rowFloats );
+	zeroRow.Clear();
+	vector<TInt32> ringSourceRow( kernelHeight, INT_MIN );
+	vector<const TFloat32*> rows( kernelHeight );
+
+	const __m128 bias = _mm_set1_ps( kernel.Bias() );
+	for (TInt32 y = 0; y < height; ++y)
+	{
+		for (TUInt32 r = 0; r < kernelHeight; ++r)
+		{
+			TInt32 sourceY = y + static_cast<TInt32>(r) - anchorY;
+			if (sourceY < 0 || sourceY >= height)
+			{
+				if (addressMode == kAddressBorder)
+				{
+					rows[r] = zeroRow.Data();
+					continue;
+				}
+				sourceY = (sourceY < 0) ? 0 : height - 1;
+			}
+			TUInt32 slot = static_cast<TUInt32>(sourceY) % kernelHeight;
+			TFloat32* slotRow = ring.Data() + slot * rowFloats;
+			if (ringSourceRow[slot] != sourceY)
+			{
+				ExpandRow( source, sourceY, anchorX, kernelWidth - 1 - anchorX, addressMode, slotRow, linearLight );
+				ringSourceRow[slot] = sourceY;
+			}
+			rows[r] = slotRow;
+		}
+
+		TUInt8* outRow = dest.Row( y );
+		TUInt32 x = 0;
+		for (; x + 4 <= width; x += 4)
+		{
+			__m128 acc0 = bias, acc1 = bias, acc2 = bias, acc3 = bias;
+			for (TUInt32 r = 0; r < kernelHeight; ++r)
+			{
+				const TFloat32* weights = kernel.Weights() + r * kernelWidth;
+				const TFloat32* p = rows[r] + x * 4;
+				for (TUInt32 c = 0; c < kernelWidth; ++c)
+				{
+					__m128 w = _mm_set1_ps( weights[c] );
+					acc0 = _mm_add_ps( acc0, _mm_mul_ps( w, _mm_load_ps( p      ) ) );
+					acc1 = _mm_add_ps( acc1, _mm_mul_ps( w, _mm_load_ps( p + 4  ) ) );
+					acc2 = _mm_add_ps( acc2, _mm_mul_ps( w, _mm_load_ps( p + 8  ) ) );
+					acc3 = _mm_add_ps( acc3, _mm_mul_ps( w, _mm_load_ps( p + 12 ) ) );
+					p += 4;
+				}
+			}
+			StoreOutput4( outRow + x * 4, OpaqueAlpha( acc0 ), OpaqueAlpha( acc1 ), OpaqueAlpha( acc2 ), OpaqueAlpha( acc3 ), linearLight );
+		}
+		for (; x < width; ++x)
+		{
+			__m128 acc = bias;
+			for (TUInt32 r = 0; r < kernelHeight; ++r)
+			{
+				const TFloat32* weights = kernel.Weights() + r * kernelWidth;
+				const TFloat32* p = rows[r] + x * 4;
+				for (TUInt32 c = 0; c < kernelWidth; ++c)
+				{
+					acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( weights[c] ), _mm_load_ps( p ) ) );
+					p += 4;
+				}
+			}
+			StoreOutput( outRow + x * 4, OpaqueAlpha( acc ), linearLight );
+		}
+	}
+}
+
+
+// Convolve the source image with the given kernel writing to the destination image, which is
+// resized to match the source. Source and destination must be different images. Pixels outside
+// the source are read with the given addressing mode. Output alpha is set to 1, matching the
+// full screen post-process shaders. If linearLight is set the source is decoded from sRGB
+// before filtering and the result encoded back, so blurs average light rather than gamma
+// encoded values (see ColourSpace.h)
+void Convolve
+(
+	const CImage&             source,
+	CImage&                   dest,
+	const CConvolutionKernel& kernel,
+	EAddressMode              addressMode /*= kAddressClamp*/,
+	bool                      linearLight /*= false*/
+)
+{
+	if (source.IsEmpty() || &source == &dest) return;
+	if (!dest.Create( source.Width(), source.Height() )) return;
+
+	// A separable kernel costs width + height multiplies per pixel rather than width * height.
+	// For a single row or column kernel the 2D path is already a 1D pass
+	if (kernel.IsSeparable() && kernel.Width() > 1 && kernel.Height() > 1)
+	{
+		ConvolveSeparable( source, dest, kernel, addressMode, linearLight );
+	}
+	else
+	{
+		ConvolveGeneral( source, dest, kernel, addressMode, linearLight );
+	}
+}
+
+
+} // namespace gen
@@ -0,0 +1,168 @@
+/*******************************************
+	Convolution.h
+
+	General convolution of CPU images with
+	arbitrary kernels. Separable kernels are
+	detected and run as two 1D passes
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Convolution kernel
+//-----------------------------------------------------------------------------
+
+// A 2D grid of weights applied around each pixel. The kernel is anchored at its centre (for even
+// sizes the anchor is the element just before the centre). A bias is added after weighting, in
+// 0->255 pixel units. On construction the kernel is tested for separability: if it is the outer
+// product of a column and a row vector (rank 1) those two vectors are stored and used instead
+class CConvolutionKernel
+{
+public:
+	// Default constructor gives a 1x1 identity kernel
+	CConvolutionKernel();
+
+	// Construct from a row-major array of width * height weights
+	CConvolutionKernel( TUInt32 width, TUInt32 height, const TFloat32* weights, TFloat32 bias = 0.0f );
+
+	// Construct a separable kernel directly from a column and a row vector
+	CConvolutionKernel( const vector<TFloat32>& column, const vector<TFloat32>& row, TFloat32 bias = 0.0f );
+
+
+	/////////////////////////////////////
+	// Access
+
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+	TFloat32 Bias() const
+	{
+		return m_Bias;
+	}
+
+	// Weight at the given column and row
+	TFloat32 Weight( TUInt32 x, TUInt32 y ) const
+	{
+		return m_Weights[y * m_Width + x];
+	}
+	const TFloat32* Weights() const
+	{
+		return &m_Weights[0];
+	}
+
+	// Whether the kernel is rank 1, in which case it equals Column() * Row()
+	bool IsSeparable() const
+	{
+		return m_IsSeparable;
+	}
+	const vector<TFloat32>& Column() const
+	{
+		return m_Column;
+	}
+	const vector<TFloat32>& Row() const
+	{
+		return m_Row;
+	}
+
+
+private:
+	// Test the kernel for rank 1 and extract the column and row vectors if so
+	void Decompose();
+
+	TUInt32          m_Width;
+	TUInt32          m_Height;
+	vector<TFloat32> m_Weights; // Row-major
+	TFloat32         m_Bias;
+
+	bool             m_IsSeparable;
+	vector<TFloat32> m_Column;  // Height entries
+	vector<TFloat32> m_Row;     // Width entries
+};
+
+
+//-----------------------------------------------------------------------------
+// Standard kernels
+//-----------------------------------------------------------------------------
+
+// Gaussian blur built from the BlurWeights half kernel in PostProcess.fx (9x9, separable)
+CConvolutionKernel GaussianBlurKernel();
+
+// Gaussian blur with the given standard deviation in pixels (separable, radius 3 sigma)
+CConvolutionKernel GaussianBlurKernel( TFloat32 sigma );
+
+// Sharpen the image - centre weighted Laplacian added to the original (3x3, not separable)
+CConvolutionKernel SharpenKernel();
+
+// Edge detection - 8-neighbour Laplacian (3x3, not separable)
+CConvolutionKernel EdgeDetectKernel();
+
+// Emboss lit from the top-left, biased to mid-grey (3x3, not separable)
+CConvolutionKernel EmbossKernel();
+
+
+//-----------------------------------------------------------------------------
+// Row operations
+//-----------------------------------------------------------------------------
+
+// Convert source row y to a row of float4 pixels (0->255 range) with padLeft / padRight extra
+// pixels filled according to the addressing mode. Rows above or below the image are clamped or
+// zeroed in the same way. If linearLight is set the colour channels are decoded from sRGB to
+// linear light (still 0->255 range). The output must be 16 byte aligned
+void ExpandRow
+(
+	const CImage& source,
+	TInt32        y,
+	TUInt32       padLeft,
+	TUInt32       padRight,
+	EAddressMode  addressMode,
+	TFloat32*     out,
+	bool          linearLight = false
+);
+
+// 1D filter a padded float4 row: out[x] = sum over i of weights[i] * in[x + i], for x from 0 to
+// width - 1. Input and output must be 16 byte aligned
+void FilterRow
+(
+	const TFloat32* in,
+	const TFloat32* weights,
+	TUInt32         numTaps,
+	TUInt32         width,
+	TFloat32*       out
+);
+
+
+//-----------------------------------------------------------------------------
+// Convolution
+//-----------------------------------------------------------------------------
+
+// Convolve the source image with the given kernel writing to the destination image, which is
+// resized to match the source. Source and destination must be different images. Pixels outside
+// the source are read with the given addressing mode. Output alpha is set to 1, matching the
+// full screen post-process shaders. If linearLight is set the source is decoded from sRGB
+// before filtering and the result encoded back, so blurs average light rather than gamma
+// encoded values (see ColourSpace.h)
+void Convolve
+(
+	const CImage&             source,
+	CImage&                   dest,
+	const CConvolutionKernel& kernel,
+	EAddressMode              addressMode = kAddressClamp,
+	bool                      linearLight = false
+);
+
+
+} // namespace gen
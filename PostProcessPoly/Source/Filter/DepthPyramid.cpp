@@ -0,0 +1,174 @@
+/*******************************************
+	DepthPyramid.cpp
+
+	Per-tile min/max depth pyramid used to
+	reject hidden parts of area post-processes
+********************************************/
+
+#include <string.h>
+
+#include "DepthPyramid.h"
+#include "Parallel.h"
+
+namespace gen
+{
+
+CDepthPyramid::CDepthPyramid()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_NumLevels = 0;
+}
+
+
+// Build the pyramid from a depth buffer of the given size whose rows are pitch bytes apart,
+// e.g. a mapped DXGI_FORMAT_D32_FLOAT texture. Returns false on memory failure
+bool CDepthPyramid::Build( const TFloat32* depth, TUInt32 width, TUInt32 height, TUInt32 pitch )
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_NumLevels = 0;
+	if (width == 0 || height == 0) return true;
+
+	// Level sizes, halving (rounding up) down to a single tile
+	TUInt32 levelWidth = (width + kDepthTileSize - 1) / kDepthTileSize;
+	TUInt32 levelHeight = (height + kDepthTileSize - 1) / kDepthTileSize;
+	TUInt32 numEntries = 0;
+	while (m_NumLevels < kMaxLevels)
+	{
+		m_LevelWidth[m_NumLevels] = levelWidth;
+		m_LevelHeight[m_NumLevels] = levelHeight;
+		m_LevelOffset[m_NumLevels] = numEntries;
+		numEntries += levelWidth * levelHeight * 2;
+		++m_NumLevels;
+		if (levelWidth == 1 && levelHeight == 1) break;
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+	if (!m_Depth.Resize( width * height ) || !m_Tiles.Resize( numEntries )) return false;
+	m_Width = width;
+	m_Height = height;
+
+	// Copy the buffer and find the level 0 tiles a row of tiles at a time
+	TFloat32* copy = m_Depth.Data();
+	TFloat32* tiles = m_Tiles.Data();
+	const TUInt8* source = reinterpret_cast<const TUInt8*>(depth);
+	ParallelFor( 0, m_LevelHeight[0], [&]( TUInt32 tileRowBegin, TUInt32 tileRowEnd )
+	{
+		for (TUInt32 tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+		{
+			TFloat32* tile = tiles + tileY * m_LevelWidth[0] * 2;
+			for (TUInt32 tileX = 0; tileX < m_LevelWidth[0]; ++tileX)
+			{
+				tile[tileX * 2] = 1.0f;
+				tile[tileX * 2 + 1] = 0.0f;
+			}
+
+			const TUInt32 yEnd = (tileY + 1) * kDepthTileSize < height ? (tileY + 1) * kDepthTileSize : height;
+			for (TUInt32 y = tileY * kDepthTileSize; y < yEnd; ++y)
+			{
+				const TFloat32* sourceRow = reinterpret_cast<const TFloat32*>(source + y * pitch);
+				TFloat32* row = copy + y * width;
+				memcpy( row, sourceRow, width * sizeof(TFloat32) );
+				for (TUInt32 x = 0; x < width; ++x)
+				{
+					TFloat32* minMax = tile + (x / kDepthTileSize) * 2;
+					if (row[x] < minMax[0]) minMax[0] = row[x];
+					if (row[x] > minMax[1]) minMax[1] = row[x];
+				}
+			}
+		}
+	}, 1 );
+
+	// Each further level from the 2x2 tiles below it, those off the edge are left out
+	for (TUInt32 level = 1; level < m_NumLevels; ++level)
+	{
+		const TUInt32 belowWidth = m_LevelWidth[level - 1];
+		const TUInt32 belowHeight = m_LevelHeight[level - 1];
+		const TFloat32* below = tiles + m_LevelOffset[level - 1];
+		TFloat32* tile = tiles + m_LevelOffset[level];
+		for (TUInt32 tileY = 0; tileY < m_LevelHeight[level]; ++tileY)
+		{
+			for (TUInt32 tileX = 0; tileX < m_LevelWidth[level]; ++tileX)
+			{
+				TFloat32 minDepth = 1.0f;
+				TFloat32 maxDepth = 0.0f;
+				for (TUInt32 y = tileY * 2; y < tileY * 2 + 2 && y < belowHeight; ++y)
+				{
+					for (TUInt32 x = tileX * 2; x < tileX * 2 + 2 && x < belowWidth; ++x)
+					{
+						const TFloat32* minMax = below + (y * belowWidth + x) * 2;
+						if (minMax[0] < minDepth) minDepth = minMax[0];
+						if (minMax[1] > maxDepth) maxDepth = minMax[1];
+					}
+				}
+				tile[0] = minDepth;
+				tile[1] = maxDepth;
+				tile += 2;
+			}
+		}
+	}
+	return true;
+}
+
+
+// Whether every pixel in the rectangle from (left, top) up to but not including (right, bottom)
+// has depth less than or equal to the given depth, see header
+bool CDepthPyramid::IsHidden( TUInt32 left, TUInt32 top, TUInt32 right, TUInt32 bottom, TFloat32 depth ) const
+{
+	if (right > m_Width)   right = m_Width;
+	if (bottom > m_Height) bottom = m_Height;
+	if (left >= right || top >= bottom) return true;
+	return IsTileHidden( m_NumLevels - 1, 0, 0, left, top, right, bottom, depth );
+}
+
+// As IsHidden for the part of the rectangle in one tile, which it must overlap
+bool CDepthPyramid::IsTileHidden
+(
+	TUInt32  level,
+	TUInt32  tileX,
+	TUInt32  tileY,
+	TUInt32  left,
+	TUInt32  top,
+	TUInt32  right,
+	TUInt32  bottom,
+	TFloat32 depth
+) const
+{
+	if (MaxDepth( level, tileX, tileY ) <= depth) return true;
+	if (MinDepth( level, tileX, tileY ) > depth) return false; // The part in the rectangle is visible
+
+	// Neither - test the tile's pixels in the rectangle, or the tiles below that overlap it
+	const TUInt32 tileSize = kDepthTileSize << level;
+	const TUInt32 tileLeft = tileX * tileSize;
+	const TUInt32 tileTop = tileY * tileSize;
+	const TUInt32 x0 = (left > tileLeft) ? left : tileLeft;
+	const TUInt32 y0 = (top > tileTop) ? top : tileTop;
+	const TUInt32 x1 = (right < tileLeft + tileSize) ? right : tileLeft + tileSize;
+	const TUInt32 y1 = (bottom < tileTop + tileSize) ? bottom : tileTop + tileSize;
+	if (level == 0)
+	{
+		for (TUInt32 y = y0; y < y1; ++y)
+		{
+			const TFloat32* row = Row( y );
+			for (TUInt32 x = x0; x < x1; ++x)
+			{
+				if (row[x] > depth) return false;
+			}
+		}
+		return true;
+	}
+
+	const TUInt32 childSize = tileSize / 2;
+	for (TUInt32 childY = y0 / childSize; childY <= (y1 - 1) / childSize; ++childY)
+	{
+		for (TUInt32 childX = x0 / childSize; childX <= (x1 - 1) / childSize; ++childX)
+		{
+			if (!IsTileHidden( level - 1, childX, childY, x0, y0, x1, y1, depth )) return false;
+		}
+	}
+	return true;
+}
+
+
+} // namespace gen
@@ -0,0 +1,116 @@
+/*******************************************
+	DepthPyramid.h
+
+	Per-tile min/max depth pyramid used to
+	reject hidden parts of area post-processes
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "AlignedArray.h"
+
+namespace gen
+{
+
+// Pixels along each side of the finest tiles of a depth pyramid
+const TUInt32 kDepthTileSize = 8;
+
+
+// Minimum and maximum depth of each tile of a scene depth buffer (0.0 nearest to 1.0 furthest),
+// at several levels. Level 0 has a tile for each kDepthTileSize square of pixels, each further
+// level a tile for each 2x2 tiles of the level below, up to a single tile for the whole buffer.
+// The depth buffer itself is also kept for tests that the tiles cannot decide.
+//
+// An area post-process is drawn at one depth with the LESS depth test, so a pixel is hidden where
+// the buffer's depth is less than or equal to the area's. A tile whose maximum depth is at most
+// the area's is hidden throughout and can be skipped without shading, a tile whose minimum depth
+// is greater is visible throughout and needs no per-pixel test
+class CDepthPyramid
+{
+public:
+	CDepthPyramid();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CDepthPyramid( const CDepthPyramid& );
+	CDepthPyramid& operator=( const CDepthPyramid& );
+
+public:
+	// Build the pyramid from a depth buffer of the given size whose rows are pitch bytes apart,
+	// e.g. a mapped DXGI_FORMAT_D32_FLOAT texture. Returns false on memory failure
+	bool Build( const TFloat32* depth, TUInt32 width, TUInt32 height, TUInt32 pitch );
+
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+	bool IsEmpty() const
+	{
+		return m_Width == 0;
+	}
+
+	// Number of levels, level NumLevels() - 1 has a single tile
+	TUInt32 NumLevels() const
+	{
+		return m_NumLevels;
+	}
+
+	// Tiles across and down at a level
+	TUInt32 LevelWidth( TUInt32 level ) const
+	{
+		return m_LevelWidth[level];
+	}
+	TUInt32 LevelHeight( TUInt32 level ) const
+	{
+		return m_LevelHeight[level];
+	}
+
+	// Minimum and maximum depth over the pixels of a tile
+	TFloat32 MinDepth( TUInt32 level, TUInt32 tileX, TUInt32 tileY ) const
+	{
+		return m_Tiles.Data()[m_LevelOffset[level] + (tileY * m_LevelWidth[level] + tileX) * 2];
+	}
+	TFloat32 MaxDepth( TUInt32 level, TUInt32 tileX, TUInt32 tileY ) const
+	{
+		return m_Tiles.Data()[m_LevelOffset[level] + (tileY * m_LevelWidth[level] + tileX) * 2 + 1];
+	}
+
+	// Pointer to the depth of the first pixel of a row of the buffer
+	const TFloat32* Row( TUInt32 y ) const
+	{
+		return m_Depth.Data() + y * m_Width;
+	}
+
+	// Whether every pixel in the rectangle from (left, top) up to but not including (right,
+	// bottom) has depth less than or equal to the given depth, i.e. a surface drawn there at that
+	// depth is hidden by the depth test. Starts from the single top tile and only descends into
+	// tiles that overlap the rectangle and are neither hidden nor visible throughout, so a hidden
+	// area usually needs a handful of lookups. Empty rectangles are hidden
+	bool IsHidden( TUInt32 left, TUInt32 top, TUInt32 right, TUInt32 bottom, TFloat32 depth ) const;
+
+private:
+	// As IsHidden for the part of the rectangle in one tile, which it must overlap
+	bool IsTileHidden( TUInt32 level, TUInt32 tileX, TUInt32 tileY, TUInt32 left, TUInt32 top, TUInt32 right, TUInt32 bottom,
+	                   TFloat32 depth ) const;
+
+	// Most levels, enough for a buffer of 8 * 2^19 pixels along each side
+	static const TUInt32 kMaxLevels = 20;
+
+	TUInt32 m_Width;
+	TUInt32 m_Height;
+	TUInt32 m_NumLevels;
+	TUInt32 m_LevelWidth[kMaxLevels];
+	TUInt32 m_LevelHeight[kMaxLevels];
+	TUInt32 m_LevelOffset[kMaxLevels]; // Start of each level's min/max pairs in m_Tiles
+
+	CAlignedArray<TFloat32> m_Depth; // Depth buffer copy without row padding
+	CAlignedArray<TFloat32> m_Tiles; // Min and max of each tile, level by level
+};
+
+
+} // namespace gen
@@ -0,0 +1,192 @@
+/*******************************************
+	FastMathSSE.h
+
+	Vectorised approximations of the maths used
+	by the warp filters (sincos, pow, length)
+********************************************/
+
+#pragma once
+
+#include <emmintrin.h> // SSE2
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Four-wide replacements for sinf / cosf / powf / sqrtf in the per-pixel maths of the warp
+// filters (Spiral, Ripple, HeatHaze), which otherwise dominates their cost. Error bounds are
+// against double precision libm over the ranges shown, which cover those driven by the app's
+// UpdatePostProcesses (see the filters for the ranges each one uses). PostProcessFilterBench
+// --fast-math checks every bound
+
+//-----------------------------------------------------------------------------
+// Helpers
+//-----------------------------------------------------------------------------
+
+// Lanes of a where the mask is set, else lanes of b
+inline __m128 SelectSSE( __m128 mask, __m128 a, __m128 b )
+{
+	return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+inline __m128 AbsSSE( __m128 x )
+{
+	return _mm_and_ps( x, _mm_castsi128_ps( _mm_set1_epi32( 0x7FFFFFFF ) ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Trigonometry
+//-----------------------------------------------------------------------------
+
+// Sine and cosine of four angles in radians. The angle is reduced to [-pi/4, pi/4] by the
+// nearest multiple of pi/2 (in three parts so the reduction is exact for |x| < 8192), then
+// minimax polynomials are used for each function. Absolute error is below 1e-7 for |x| < 8192
+// (Spiral angles reach 45, HeatHaze 70), against 3.3e-8 for libm sinf. Results are not valid
+// beyond that - wrap larger angles first
+inline void SinCosSSE( __m128 x, __m128& sinX, __m128& cosX )
+{
+	const __m128 TwoOverPi = _mm_set1_ps( 0.636619772f );
+	const __m128 PiOver2Part1 = _mm_set1_ps( 1.5703125f );
+	const __m128 PiOver2Part2 = _mm_set1_ps( 4.837512969970703125e-4f );
+	const __m128 PiOver2Part3 = _mm_set1_ps( 7.54978995489188216e-8f );
+
+	// Quadrant and remainder
+	__m128i quadrant = _mm_cvtps_epi32( _mm_mul_ps( x, TwoOverPi ) );
+	__m128 n = _mm_cvtepi32_ps( quadrant );
+	__m128 r = _mm_sub_ps( x, _mm_mul_ps( n, PiOver2Part1 ) );
+	r = _mm_sub_ps( r, _mm_mul_ps( n, PiOver2Part2 ) );
+	r = _mm_sub_ps( r, _mm_mul_ps( n, PiOver2Part3 ) );
+	__m128 r2 = _mm_mul_ps( r, r );
+
+	// sin(r) = r + r^3 * P(r^2), cos(r) = 1 - r^2 / 2 + r^4 * Q(r^2)
+	__m128 s = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( -1.9515295891e-4f ), r2 ), _mm_set1_ps( 8.3321608736e-3f ) );
+	s = _mm_add_ps( _mm_mul_ps( s, r2 ), _mm_set1_ps( -1.6666654611e-1f ) );
+	s = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( s, r2 ), r ), r );
+	__m128 c = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( 2.443315711809948e-5f ), r2 ), _mm_set1_ps( -1.388731625493765e-3f ) );
+	c = _mm_add_ps( _mm_mul_ps( c, r2 ), _mm_set1_ps( 4.166664568298827e-2f ) );
+	c = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( c, r2 ), r2 ), _mm_sub_ps( _mm_set1_ps( 1.0f ), _mm_mul_ps( r2, _mm_set1_ps( 0.5f ) ) ) );
+
+	// Odd quadrants swap sine and cosine. Sine is negated in quadrants 2 and 3, cosine in 1 and 2
+	const __m128i one = _mm_set1_epi32( 1 );
+	__m128 swap = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( quadrant, one ), one ) );
+	__m128 sinSign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( quadrant, _mm_set1_epi32( 2 ) ), 30 ) );
+	__m128 cosSign = _mm_castsi128_ps( _mm_slli_epi32( _mm_and_si128( _mm_add_epi32( quadrant, one ), _mm_set1_epi32( 2 ) ), 30 ) );
+	sinX = _mm_xor_ps( SelectSSE( swap, c, s ), sinSign );
+	cosX = _mm_xor_ps( SelectSSE( swap, s, c ), cosSign );
+}
+
+inline __m128 SinSSE( __m128 x )
+{
+	__m128 sinX, cosX;
+	SinCosSSE( x, sinX, cosX );
+	return sinX;
+}
+
+
+//-----------------------------------------------------------------------------
+// Powers
+//-----------------------------------------------------------------------------
+
+// Base 2 logarithm of four positive, normal values. The mantissa is reduced to [sqrt(1/2),
+// sqrt(2)) and log(1 + m) uses a minimax polynomial. Error is within 2.5 ulp of the result, i.e.
+// absolute error below 1.3e-7 for x in [0.5, 2] rising to 4e-6 at 2^-126. Zero, negative or
+// denormal values give meaningless results
+inline __m128 Log2SSE( __m128 x )
+{
+	const __m128 One = _mm_set1_ps( 1.0f );
+
+	// x = m * 2^e with m in [sqrt(1/2), sqrt(2))
+	__m128i bits = _mm_castps_si128( x );
+	__m128i exponent = _mm_sub_epi32( _mm_srli_epi32( bits, 23 ), _mm_set1_epi32( 127 ) );
+	__m128 m = _mm_castsi128_ps( _mm_or_si128( _mm_and_si128( bits, _mm_set1_epi32( 0x007FFFFF ) ), _mm_castps_si128( One ) ) );
+	__m128 large = _mm_cmpge_ps( m, _mm_set1_ps( 1.41421356f ) );
+	m = SelectSSE( large, _mm_mul_ps( m, _mm_set1_ps( 0.5f ) ), m );
+	__m128 e = _mm_add_ps( _mm_cvtepi32_ps( exponent ), _mm_and_ps( large, One ) );
+
+	// log(1 + f) = f - f^2 / 2 + f^3 * P(f)
+	__m128 f = _mm_sub_ps( m, One );
+	__m128 f2 = _mm_mul_ps( f, f );
+	__m128 p = _mm_set1_ps( 7.0376836292e-2f );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( -1.1514610310e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 1.1676998740e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( -1.2420140846e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 1.4249322787e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( -1.6668057665e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 2.0000714765e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( -2.4999993993e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 3.3333331174e-1f ) );
+	__m128 logM = _mm_add_ps( _mm_sub_ps( f, _mm_mul_ps( f2, _mm_set1_ps( 0.5f ) ) ), _mm_mul_ps( _mm_mul_ps( p, f2 ), f ) );
+	return _mm_add_ps( _mm_mul_ps( logM, _mm_set1_ps( 1.44269504089f ) ), e );
+}
+
+// 2 to the power of four values. Values below -126 give 0 and the result is not valid above
+// 127. Split into integer and fraction, with a minimax polynomial for 2^f on [-0.5, 0.5].
+// Relative error is below 1.5e-7
+inline __m128 Exp2SSE( __m128 x )
+{
+	__m128 underflow = _mm_cmplt_ps( x, _mm_set1_ps( -126.0f ) );
+	x = _mm_max_ps( x, _mm_set1_ps( -126.0f ) );
+	__m128i whole = _mm_cvtps_epi32( x ); // Round to nearest
+	__m128 f = _mm_sub_ps( x, _mm_cvtepi32_ps( whole ) );
+
+	__m128 p = _mm_set1_ps( 1.535336188319500e-4f );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 1.339887440266574e-3f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 9.618437357674640e-3f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 5.550332471162809e-2f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 2.402264791363012e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 6.931472028550421e-1f ) );
+	p = _mm_add_ps( _mm_mul_ps( p, f ), _mm_set1_ps( 1.0f ) );
+
+	__m128 scale = _mm_castsi128_ps( _mm_slli_epi32( _mm_add_epi32( whole, _mm_set1_epi32( 127 ) ), 23 ) );
+	return _mm_andnot_ps( underflow, _mm_mul_ps( p, scale ) );
+}
+
+// x to the power y for x in [0, 1] and y > 0, as 2^(y * log2(x)). Zero and denormal x give 0.
+// Relative error is below 1e-6 + 5e-8 * |y * log2(x)|, mostly from rounding the product, and
+// below 2e-7 for the Ripple's use (x up to 0.005, y = 0.1) against 8e-8 for libm powf
+inline __m128 PowUnitSSE( __m128 x, __m128 y )
+{
+	__m128 zero = _mm_cmplt_ps( x, _mm_set1_ps( 1.17549435e-38f ) ); // Smallest normal float
+	return _mm_andnot_ps( zero, Exp2SSE( _mm_mul_ps( y, Log2SSE( x ) ) ) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Lengths
+//-----------------------------------------------------------------------------
+
+// Reciprocal square root of four values: the hardware estimate (12 bits) refined by one
+// Newton-Raphson step. Relative error is below 2.5e-7 for normal positive values. Zero gives
+// infinity, as the estimate does
+inline __m128 RSqrtSSE( __m128 x )
+{
+	__m128 estimate = _mm_rsqrt_ps( x );
+	__m128 halfX = _mm_mul_ps( x, _mm_set1_ps( 0.5f ) );
+	return _mm_mul_ps( estimate, _mm_sub_ps( _mm_set1_ps( 1.5f ), _mm_mul_ps( halfX, _mm_mul_ps( estimate, estimate ) ) ) );
+}
+
+// Length of four 2D vectors, x^2 + y^2 times its reciprocal square root. Zero vectors give 0.
+// Relative error is below 4e-7
+inline __m128 LengthSSE( __m128 x, __m128 y )
+{
+	__m128 lengthSq = _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) );
+	__m128 nonZero = _mm_cmpgt_ps( lengthSq, _mm_setzero_ps() );
+	return _mm_and_ps( nonZero, _mm_mul_ps( lengthSq, RSqrtSSE( lengthSq ) ) );
+}
+
+// Normalise four 2D vectors in place, also returning their lengths. Zero vectors stay zero.
+// Relative error of the length and absolute error of the components are below 4e-7
+inline __m128 NormaliseSSE( __m128& x, __m128& y )
+{
+	__m128 lengthSq = _mm_add_ps( _mm_mul_ps( x, x ), _mm_mul_ps( y, y ) );
+	__m128 nonZero = _mm_cmpgt_ps( lengthSq, _mm_setzero_ps() );
+	__m128 invLength = _mm_and_ps( nonZero, RSqrtSSE( lengthSq ) );
+	x = _mm_mul_ps( x, invLength );
+	y = _mm_mul_ps( y, invLength );
+	return _mm_mul_ps( lengthSq, invLength );
+}
+
+
+} // namespace gen
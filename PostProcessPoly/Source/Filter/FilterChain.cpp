@@ -0,0 +1,252 @@
+/*******************************************
+	FilterChain.cpp
+
+	A list of full screen post-processes run
+	in sequence on the CPU
+********************************************/
+
+#include <stdio.h>
+
+#include "FilterChain.h"
+#include "ImageIO.h"
+
+namespace gen
+{
+
+CFilterChain::CFilterChain()
+{
+	m_NoiseMap = 0;
+	m_BurnMap = 0;
+	m_DistortMap = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Setup
+//-----------------------------------------------------------------------------
+
+// Parse a chain description: filter names (see FilterNames) separated by commas, spaces or
+// new lines, with # starting a comment to the end of the line. Filters are added to the
+// chain. Returns false and sets error for an unknown name
+bool CFilterChain::Parse( const string& description, string& error )
+{
+	size_t pos = 0;
+	while (pos < description.length())
+	{
+		char c = description[pos];
+		if (c == '#')
+		{
+			pos = description.find( '\n', pos );
+			if (pos == string::npos) break;
+		}
+		else if (c == ',' || c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			++pos;
+		}
+		else
+		{
+			size_t end = description.find_first_of( ", \t\r\n#", pos );
+			if (end == string::npos) end = description.length();
+			string name = description.substr( pos, end - pos );
+
+			EPostProcessFilter filter;
+			if (!FilterFromName( name, filter ))
+			{
+				error = "Unknown filter '" + name + "'";
+				return false;
+			}
+			m_Filters.push_back( filter );
+			pos = end;
+		}
+	}
+	return true;
+}
+
+// Parse a chain description from a file
+bool CFilterChain::LoadFile( const string& path, string& error )
+{
+	FILE* file = fopen( path.c_str(), "rb" );
+	if (!file)
+	{
+		error = "Cannot open chain file '" + path + "'";
+		return false;
+	}
+	string description;
+	char buffer[1024];
+	size_t count;
+	while ((count = fread( buffer, 1, sizeof(buffer), file )) > 0)
+	{
+		description.append( buffer, count );
+	}
+	fclose( file );
+	return Parse( description, error );
+}
+
+// Whether any filter in the chain is of the given type
+bool CFilterChain::Contains( EPostProcessFilter filter ) const
+{
+	for (size_t i = 0; i < m_Filters.size(); ++i)
+	{
+		if (m_Filters[i] == filter) return true;
+	}
+	return false;
+}
+
+// Set the special purpose maps used by some filters. The images must outlive the chain
+void CFilterChain::SetMaps( const CImage* noiseMap, const CImage* burnMap, const CImage* distortMap )
+{
+	m_NoiseMap = noiseMap;
+	m_BurnMap = burnMap;
+	m_DistortMap = distortMap;
+}
+
+
+//-----------------------------------------------------------------------------
+// Processing
+//-----------------------------------------------------------------------------
+
+// Build the steps for one frame from the current animation state, skipping one-shot effects
+// that have finished. Call once per frame in frame order (the noise offset is random)
+void CFilterChain::SelectSteps( CFilterAnimation& animation, TUInt32 width, TUInt32 height, vector<SFilterStep>& steps ) const
+{
+	steps.clear();
+	for (size_t i = 0; i < m_Filters.size(); ++i)
+	{
+		if (!animation.IsActive( m_Filters[i] )) continue;
+
+		SFilterStep step;
+		step.Filter = m_Filters[i];
+		step.Params.NoiseMap = m_NoiseMap;
+		step.Params.BurnMap = m_BurnMap;
+		step.Params.DistortMap = m_DistortMap;
+		animation.Select( step.Filter, width, height, step.Params );
+		steps.push_back( step );
+	}
+}
+
+// Point the map parameters of steps built elsewhere (e.g. received from another process, where
+// the pointers are meaningless) at this chain's maps
+void CFilterChain::AttachMaps( vector<SFilterStep>& steps ) const
+{
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		steps[i].Params.NoiseMap = m_NoiseMap;
+		steps[i].Params.BurnMap = m_BurnMap;
+		steps[i].Params.DistortMap = m_DistortMap;
+	}
+}
+
+// Run a frame's steps over the source image, ping-ponging between the two work images.
+// Result is set to the final image, which is the source itself if there are no steps.
+// Returns false if a filter fails
+bool CFilterChain::Run
+(
+	const vector<SFilterStep>& steps,
+	const CImage&              source,
+	CImage&                    work0,
+	CImage&                    work1,
+	const CImage*&             result
+)
+{
+	CImage* work[2] = { &work0, &work1 };
+	const CImage* input = &source;
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		CImage* output = work[i & 1];
+		if (!ApplyFilter( steps[i].Filter, *input, *output, steps[i].Params )) return false;
+		input = output;
+	}
+	result = input;
+	return true;
+}
+
+// As Run, but the filters work on images in the tiled layout (see CTiledImage). The source is
+// converted into work0 and the final image back into the result, so the chain pays for one
+// conversion each way however many filters it has. Returns false if a filter fails
+bool CFilterChain::RunTiled
+(
+	const vector<SFilterStep>& steps,
+	const CImage&              source,
+	CTiledImage&               work0,
+	CTiledImage&               work1,
+	CImage&                    result
+)
+{
+	if (steps.empty())
+	{
+		result.CopyFrom( source );
+		return !result.IsEmpty();
+	}
+
+	CTiledImage* work[2] = { &work0, &work1 };
+	if (!work0.FromLinear( source )) return false;
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		if (!ApplyFilter( steps[i].Filter, *work[i & 1], *work[(i + 1) & 1], steps[i].Params )) return false;
+	}
+	return work[steps.size() & 1]->ToLinear( result );
+}
+
+// As Run, but filters with a temporal mode recompute only half of their pixels and reuse the
+// rest from the previous frame (see ApplyFilterTemporal). Histories holds one entry for each
+// filter in the chain and is kept from frame to frame. Frames must be run in sequence order
+bool CFilterChain::RunTemporal
+(
+	const vector<SFilterStep>& steps,
+	const CImage&              source,
+	CImage&                    work0,
+	CImage&                    work1,
+	const CImage*&             result,
+	vector<SFilterHistory>&    histories,
+	TUInt32                    threshold /*= kTemporalThreshold*/
+)
+{
+	CImage* work[2] = { &work0, &work1 };
+	const CImage* input = &source;
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		// A finished one-shot effect shifts later steps, their histories then no longer match
+		// the filter and the frame is computed in full
+		CImage* output = work[i & 1];
+		bool success = (i < histories.size()) ? ApplyFilterTemporal( steps[i].Filter, *input, *output, steps[i].Params, histories[i], threshold )
+		                                      : ApplyFilter( steps[i].Filter, *input, *output, steps[i].Params );
+		if (!success) return false;
+		input = output;
+	}
+	result = input;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Maps
+//-----------------------------------------------------------------------------
+
+// Load a map from the map directory trying each supported extension, else build a stand-in
+void LoadFilterMap( const string& directory, const char* name, CImage& map, TUInt32 cellSize, TUInt32 seed )
+{
+	if (!directory.empty())
+	{
+		const char* extensions[] = { ".tga", ".ppm" };
+		for (int i = 0; i < 2; ++i)
+		{
+			if (LoadImageFile( directory + "/" + name + extensions[i], map )) return;
+		}
+	}
+	BuildNoiseMap( map, 256, cellSize, seed );
+}
+
+// Load the maps used by a chain (or all maps if the chain is null) from a directory holding
+// Noise, Burn and Distort .tga or .ppm files. Maps that cannot be loaded, or all maps if the
+// directory is empty, are replaced by procedural stand-ins from BuildNoiseMap
+void LoadFilterMaps( const string& directory, const CFilterChain* chain, SFilterMaps& maps )
+{
+	// Cell sizes give stand-ins of roughly the character of the real textures: per-pixel grain,
+	// large burn blotches and medium scale distortion
+	if (!chain || chain->Contains( kFilterGreyNoise )) LoadFilterMap( directory, "Noise", maps.Noise, 1, 1 );
+	if (!chain || chain->Contains( kFilterBurn ))      LoadFilterMap( directory, "Burn", maps.Burn, 32, 2 );
+	if (!chain || chain->Contains( kFilterDistort ))   LoadFilterMap( directory, "Distort", maps.Distort, 16, 3 );
+}
+
+
+} // namespace gen
@@ -0,0 +1,149 @@
+/*******************************************
+	FilterChain.h
+
+	A list of full screen post-processes run
+	in sequence on the CPU
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+#include "TiledImage.h"
+#include "PostProcessFilters.h"
+
+namespace gen
+{
+
+// One filter in a chain together with the shader parameters for a particular frame
+struct SFilterStep
+{
+	EPostProcessFilter Filter;
+	SFilterParams      Params;
+};
+
+
+// Special purpose maps for the filters that need them (PostProcessMap in the shaders)
+struct SFilterMaps
+{
+	CImage Noise;
+	CImage Burn;
+	CImage Distort;
+};
+
+
+// A chain of post-processes applied in order, the CPU equivalent of FullScreenFilterList
+class CFilterChain
+{
+public:
+	CFilterChain();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CFilterChain( const CFilterChain& );
+	CFilterChain& operator=( const CFilterChain& );
+
+public:
+	/////////////////////////////////////
+	// Setup
+
+	// Parse a chain description: filter names (see FilterNames) separated by commas, spaces or
+	// new lines, with # starting a comment to the end of the line. Filters are added to the
+	// chain. Returns false and sets error for an unknown name
+	bool Parse( const string& description, string& error );
+
+	// Parse a chain description from a file
+	bool LoadFile( const string& path, string& error );
+
+	void Add( EPostProcessFilter filter )
+	{
+		m_Filters.push_back( filter );
+	}
+	void Clear()
+	{
+		m_Filters.clear();
+	}
+
+	const vector<EPostProcessFilter>& Filters() const
+	{
+		return m_Filters;
+	}
+
+	// Whether any filter in the chain is of the given type
+	bool Contains( EPostProcessFilter filter ) const;
+
+	// Set the special purpose maps used by some filters. The images must outlive the chain
+	void SetMaps( const CImage* noiseMap, const CImage* burnMap, const CImage* distortMap );
+	void SetMaps( const SFilterMaps& maps )
+	{
+		SetMaps( &maps.Noise, &maps.Burn, &maps.Distort );
+	}
+
+
+	/////////////////////////////////////
+	// Processing
+
+	// Build the steps for one frame from the current animation state, skipping one-shot effects
+	// that have finished. Call once per frame in frame order (the noise offset is random)
+	void SelectSteps( CFilterAnimation& animation, TUInt32 width, TUInt32 height, vector<SFilterStep>& steps ) const;
+
+	// Point the map parameters of steps built elsewhere (e.g. received from another process, where
+	// the pointers are meaningless) at this chain's maps
+	void AttachMaps( vector<SFilterStep>& steps ) const;
+
+	// Run a frame's steps over the source image, ping-ponging between the two work images.
+	// Result is set to the final image, which is the source itself if there are no steps.
+	// Returns false if a filter fails
+	static bool Run
+	(
+		const vector<SFilterStep>& steps,
+		const CImage&              source,
+		CImage&                    work0,
+		CImage&                    work1,
+		const CImage*&             result
+	);
+
+	// As Run, but the filters work on images in the tiled layout (see CTiledImage). The source is
+	// converted into work0 and the final image back into the result, so the chain pays for one
+	// conversion each way however many filters it has. Returns false if a filter fails
+	static bool RunTiled
+	(
+		const vector<SFilterStep>& steps,
+		const CImage&              source,
+		CTiledImage&               work0,
+		CTiledImage&               work1,
+		CImage&                    result
+	);
+
+	// As Run, but filters with a temporal mode recompute only half of their pixels and reuse the
+	// rest from the previous frame (see ApplyFilterTemporal). Histories holds one entry for each
+	// filter in the chain and is kept from frame to frame. Frames must be run in sequence order
+	static bool RunTemporal
+	(
+		const vector<SFilterStep>& steps,
+		const CImage&              source,
+		CImage&                    work0,
+		CImage&                    work1,
+		const CImage*&             result,
+		vector<SFilterHistory>&    histories,
+		TUInt32                    threshold = kTemporalThreshold
+	);
+
+private:
+	vector<EPostProcessFilter> m_Filters;
+	const CImage*              m_NoiseMap;
+	const CImage*              m_BurnMap;
+	const CImage*              m_DistortMap;
+};
+
+
+// Load the maps used by a chain (or all maps if the chain is null) from a directory holding
+// Noise, Burn and Distort .tga or .ppm files. Maps that cannot be loaded, or all maps if the
+// directory is empty, are replaced by procedural stand-ins from BuildNoiseMap
+void LoadFilterMaps( const string& directory, const CFilterChain* chain, SFilterMaps& maps );
+
+
+} // namespace gen
@@ -0,0 +1,272 @@
+/*******************************************
+	GeneratedFilters.cpp
+
+	Runs the techniques in PostProcess.fx on
+	the CPU from their translated shaders
+********************************************/
+
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+using namespace std;
+
+#include "GeneratedFilters.h"
+#include "PostProcessShaders.h"
+#include "Parallel.h"
+
+namespace gen
+{
+
+using namespace hlsl;
+
+//-----------------------------------------------------------------------------
+// Passes
+//-----------------------------------------------------------------------------
+
+// First pixel whose centre is at or after a UV coordinate along a side of the given number of
+// pixels, as the rasteriser covers pixels
+inline TUInt32 PixelEdge( TFloat32 uv, TUInt32 size )
+{
+	return static_cast<TUInt32>(ceilf( clamp( uv * size - 0.5f, 0.0f, static_cast<TFloat32>(size) ) ));
+}
+
+
+// Runs each pass of a technique for RunPostProcessTechnique, into the destination for the last
+// pass and the multipass images for the others. Only the pixels of the area are shaded, and
+// with a depth pyramid only those that pass the depth test against the area's depth
+class CGeneratedPassRunner
+{
+public:
+	CGeneratedPassRunner
+	(
+		SPostProcessShaders& shaders,
+		const CImage&        source,
+		CImage&              dest,
+		const SFilterArea&   area,
+		TUInt32              left,
+		TUInt32              top,
+		TUInt32              right,
+		TUInt32              bottom,
+		const CDepthPyramid* depth
+	)
+		: m_Shaders( shaders ), m_Source( source ), m_Dest( dest ), m_Area( area ), m_Depth( depth )
+	{
+		m_Left = left;
+		m_Top = top;
+		m_Right = right;
+		m_Bottom = bottom;
+		m_InvWidth = 1.0f / source.Width();
+		m_InvHeight = 1.0f / source.Height();
+		m_InvAreaWidth = 1.0f / (area.BottomRight[0] - area.TopLeft[0]);
+		m_InvAreaHeight = 1.0f / (area.BottomRight[1] - area.TopLeft[1]);
+	}
+
+	template <class TShader>
+	bool operator()( TUInt32 pass, TUInt32 numPasses, bool alphaBlend, TShader shader )
+	{
+		CImage& output = (pass + 1 == numPasses) ? m_Dest : m_Multipass[pass & 1];
+		if (!output.Create( m_Source.Width(), m_Source.Height() )) return false;
+		if (m_Left > 0 || m_Top > 0 || m_Right < output.Width() || m_Bottom < output.Height() || m_Depth)
+		{
+			output.CopyFrom( m_Source ); // Pixels not shaded are left as the scene
+		}
+		m_Shaders.MultipassTexture.Image = (pass > 0) ? &m_Multipass[(pass - 1) & 1] : 0;
+
+		// A row of level 0 tiles at a time, so each tile of the depth pyramid is looked up once.
+		// Tiles hidden throughout are skipped and those visible throughout need no depth test
+		ParallelFor( m_Top / kDepthTileSize, (m_Bottom + kDepthTileSize - 1) / kDepthTileSize, [&]( TUInt32 tileRowBegin, TUInt32 tileRowEnd )
+		{
+			for (TUInt32 tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+			{
+				const TUInt32 y0 = (tileY * kDepthTileSize > m_Top) ? tileY * kDepthTileSize : m_Top;
+				const TUInt32 y1 = ((tileY + 1) * kDepthTileSize < m_Bottom) ? (tileY + 1) * kDepthTileSize : m_Bottom;
+				TUInt32 x0 = m_Left;
+				while (x0 < m_Right)
+				{
+					TUInt32 x1 = m_Right;
+					bool depthTest = false;
+					if (m_Depth)
+					{
+						const TUInt32 tileX = x0 / kDepthTileSize;
+						if ((tileX + 1) * kDepthTileSize < x1) x1 = (tileX + 1) * kDepthTileSize;
+						if (m_Depth->MaxDepth( 0, tileX, tileY ) <= m_Area.Depth)
+						{
+							x0 = x1;
+							continue;
+						}
+						depthTest = m_Depth->MinDepth( 0, tileX, tileY ) <= m_Area.Depth;
+					}
+					for (TUInt32 y = y0; y < y1; ++y)
+					{
+						ShadeSpan( shader, output, alphaBlend, y, x0, x1, depthTest );
+					}
+					x0 = x1;
+				}
+			}
+		}, 2 );
+		return true;
+	}
+
+private:
+	// Shade the pixels of a row from x0 up to but not including x1. With the depth test, pixels
+	// whose depth is less than or equal to the area's are left as they are
+	template <class TShader>
+	void ShadeSpan( TShader shader, CImage& output, bool alphaBlend, TUInt32 y, TUInt32 x0, TUInt32 x1, bool depthTest ) const
+	{
+		const __m128 scale = _mm_set1_ps( 255.0f );
+		const TFloat32* depthRow = depthTest ? m_Depth->Row( y ) : 0;
+		TUInt8* outPixel = output.Row( y ) + x0 * 4;
+		const TUInt8* scenePixel = m_Source.Row( y ) + x0 * 4;
+
+		// As the vertex shader, UVArea runs 0 to 1 over the area and UVScene over the scene
+		PS_POSTPROCESS_INPUT input;
+		input.UVScene.y = (y + 0.5f) * m_InvHeight;
+		input.UVArea.y = (input.UVScene.y - m_Area.TopLeft[1]) * m_InvAreaHeight;
+		for (TUInt32 x = x0; x < x1; ++x, outPixel += 4, scenePixel += 4)
+		{
+			if (depthTest && depthRow[x] <= m_Area.Depth) continue;
+
+			input.ProjPos = float4( x + 0.5f, y + 0.5f, m_Area.Depth, 1.0f );
+			input.UVScene.x = (x + 0.5f) * m_InvWidth;
+			input.UVArea.x = (input.UVScene.x - m_Area.TopLeft[0]) * m_InvAreaWidth;
+			float4 colour = shader( m_Shaders, input );
+			__m128 result = _mm_mul_ps( colour.v, scale );
+			if (alphaBlend)
+			{
+				__m128 scene = LoadPixelSSE( scenePixel );
+				result = _mm_add_ps( scene, _mm_mul_ps( _mm_set1_ps( saturate( colour.w ) ), _mm_sub_ps( result, scene ) ) );
+			}
+			StorePixelSSE( outPixel, result );
+			outPixel[3] = 255;
+		}
+	}
+
+	SPostProcessShaders& m_Shaders;
+	const CImage&        m_Source;
+	CImage&              m_Dest;
+	CImage               m_Multipass[2];
+
+	const SFilterArea&   m_Area;
+	const CDepthPyramid* m_Depth;
+	TUInt32              m_Left;   // Pixels shaded, up to but not including right and bottom
+	TUInt32              m_Top;
+	TUInt32              m_Right;
+	TUInt32              m_Bottom;
+	TFloat32             m_InvWidth;
+	TFloat32             m_InvHeight;
+	TFloat32             m_InvAreaWidth;
+	TFloat32             m_InvAreaHeight;
+};
+
+
+//-----------------------------------------------------------------------------
+// Techniques
+//-----------------------------------------------------------------------------
+
+// Number of techniques with translated shaders
+TUInt32 NumGeneratedFilters()
+{
+	return kNumPostProcessTechniques;
+}
+
+// Name of a technique with translated shaders, without the "PP" prefix as in FilterNames
+const char* GeneratedFilterName( TUInt32 index )
+{
+	const char* name = PostProcessTechniques[index];
+	return (strncmp( name, "PP", 2 ) == 0) ? name + 2 : name;
+}
+
+// Run a technique over the source image writing to the destination image, see header
+bool ApplyGeneratedFilter
+(
+	const string&        name,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params
+)
+{
+	// Full screen processing has the whole scene as its area at depth 0 (see SetFullScreenPostProcessArea)
+	SFilterArea fullScreen = { { 0.0f, 0.0f }, { 1.0f, 1.0f }, 0.0f };
+	return ApplyGeneratedAreaFilter( name, source, dest, params, fullScreen );
+}
+
+// Run a technique over an area of the source image writing to the destination image, see header
+bool ApplyGeneratedAreaFilter
+(
+	const string&        name,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params,
+	const SFilterArea&   area,
+	const CDepthPyramid* depth /*= 0*/
+)
+{
+	if (source.IsEmpty() || &source == &dest) return false;
+	if (depth && (depth->Width() != source.Width() || depth->Height() != source.Height())) return false;
+
+	// Find the technique, ignoring case
+	const char* technique = 0;
+	for (TUInt32 i = 0; i < kNumPostProcessTechniques && !technique; ++i)
+	{
+		const char* candidate = GeneratedFilterName( i );
+		if (name.size() != strlen( candidate )) continue;
+		TUInt32 c = 0;
+		while (c < name.size() && tolower( name[c] ) == tolower( candidate[c] )) ++c;
+		if (c == name.size()) technique = PostProcessTechniques[i];
+	}
+	if (!technique) return false;
+
+	// Pixels whose centres the area's quad covers. Nothing is drawn if the quad is clipped by the
+	// near or far plane, or if the depth pyramid shows the whole area hidden
+	TUInt32 left = 0, top = 0, right = 0, bottom = 0;
+	if (area.Depth >= 0.0f && area.Depth <= 1.0f &&
+	    area.TopLeft[0] < area.BottomRight[0] && area.TopLeft[1] < area.BottomRight[1])
+	{
+		left = PixelEdge( area.TopLeft[0], source.Width() );
+		top = PixelEdge( area.TopLeft[1], source.Height() );
+		right = PixelEdge( area.BottomRight[0], source.Width() );
+		bottom = PixelEdge( area.BottomRight[1], source.Height() );
+	}
+	if (left >= right || top >= bottom || (depth && depth->IsHidden( left, top, right, bottom, area.Depth )))
+	{
+		if (!dest.Create( source.Width(), source.Height() )) return false;
+		dest.CopyFrom( source );
+		return true;
+	}
+
+	// Variables as set by SetPostProcessArea and SelectPostProcess
+	SPostProcessShaders shaders;
+	shaders.PPAreaTopLeft = float2( area.TopLeft[0], area.TopLeft[1] );
+	shaders.PPAreaBottomRight = float2( area.BottomRight[0], area.BottomRight[1] );
+	shaders.PPAreaDepth = area.Depth;
+	shaders.TintColour = float3( params.TintColour[0], params.TintColour[1], params.TintColour[2] );
+	shaders.NoiseScale = float2( params.NoiseScale[0], params.NoiseScale[1] );
+	shaders.NoiseOffset = float2( params.NoiseOffset[0], params.NoiseOffset[1] );
+	shaders.DistortLevel = params.DistortLevel;
+	shaders.BurnLevel = params.BurnLevel;
+	shaders.SpiralTimer = params.SpiralTimer;
+	shaders.HeatHazeTimer = params.HeatHazeTimer;
+	shaders.SceneTextureWidth = static_cast<TFloat32>(source.Width());
+	shaders.SceneTextureHeight = static_cast<TFloat32>(source.Height());
+	shaders.RippleTime = (params.NumRipples > 0) ? params.Ripples[0].Time : -1.0f; // -1 is outside any pixel
+	if (params.NumRipples > 0)
+	{
+		shaders.RipplePosition = float2( params.Ripples[0].Position[0], params.Ripples[0].Position[1] );
+	}
+	shaders.ShockwaveScale = params.ShockwaveScale;
+	shaders.ShockwaveSin = params.ShockwaveSin;
+	shaders.BlurStrength = static_cast<int>(params.BlurStrength); // As the effect converts SetFloat on an int
+
+	// Textures, the map by technique as the app selects it
+	shaders.SceneTexture.Image = &source;
+	shaders.PreviousSceneTexture.Image = &source;
+	if (strcmp( technique, "PPGreyNoise" ) == 0)    shaders.PostProcessMap.Image = params.NoiseMap;
+	else if (strcmp( technique, "PPBurn" ) == 0)    shaders.PostProcessMap.Image = params.BurnMap;
+	else if (strcmp( technique, "PPDistort" ) == 0) shaders.PostProcessMap.Image = params.DistortMap;
+
+	CGeneratedPassRunner runner( shaders, source, dest, area, left, top, right, bottom, depth );
+	return RunPostProcessTechnique( technique, runner );
+}
+
+
+} // namespace gen
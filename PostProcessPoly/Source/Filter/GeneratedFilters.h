@@ -0,0 +1,73 @@
+/*******************************************
+	GeneratedFilters.h
+
+	Runs the techniques in PostProcess.fx on
+	the CPU from their translated shaders
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "Image.h"
+#include "PostProcessFilters.h"
+#include "DepthPyramid.h"
+
+namespace gen
+{
+
+// The techniques in PostProcess.fx run from the C++ versions of their pixel shaders made by
+// PostProcessShaderGen (see PostProcessShaders.h), so a technique added to the effect runs on
+// the CPU without a filter being written for it. Each pass runs the shader for every pixel, as
+// the GPU does, so these are slower than the hand-written filters. Use them to check those
+// filters against the shaders, and for techniques that have no filter (e.g. Feedback)
+
+// Screen area and depth of an area post-process, as set in the shaders by SetPostProcessArea
+struct SFilterArea
+{
+	TFloat32 TopLeft[2];     // UVs in the scene, 0.0 to 1.0 left->right and top->bottom
+	TFloat32 BottomRight[2];
+	TFloat32 Depth;          // Depth buffer value the area is drawn at
+};
+
+
+// Number of techniques with translated shaders
+TUInt32 NumGeneratedFilters();
+
+// Name of a technique with translated shaders, without the "PP" prefix as in FilterNames
+const char* GeneratedFilterName( TUInt32 index );
+
+// Run a technique (name as GeneratedFilterName, case insensitive) over the source image writing
+// to the destination image, which is resized to match. Source and destination must differ. The
+// effect variables are set from the parameters as SelectPostProcess sets them for full screen
+// processing, and any the parameters do not cover are zero:
+// - PostProcessMap is the technique's map from the parameters (Noise, Burn or Distort)
+// - MultipassTexture is the previous pass's output
+// - PreviousSceneTexture is the source, as no history is kept
+// - Ripple has the first of the ripples, as the shader has one
+// Passes whose blend state alpha blends are blended over the source as in ApplyFilter. Output
+// alpha is 1. Returns false if the technique has no translated shaders or on memory failure
+bool ApplyGeneratedFilter
+(
+	const string&        name,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params
+);
+
+// As ApplyGeneratedFilter, but only the pixels in the area are shaded, as RenderAreaPostProcess
+// draws them, and the rest of the destination is a copy of the source. With a depth pyramid
+// built from the scene's depth buffer (of the source's size) pixels fail the depth test as on
+// the GPU, and tiles of the pyramid hidden throughout are skipped without shading - as is the
+// whole area if the pyramid shows it hidden. Each pass of the technique shades the area
+bool ApplyGeneratedAreaFilter
+(
+	const string&        name,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params,
+	const SFilterArea&   area,
+	const CDepthPyramid* depth = 0
+);
+
+
+} // namespace gen
@@ -0,0 +1,140 @@
+/*******************************************
+	Image.cpp
+
+	CPU-side RGBA image used by the software
+	post-processing filters
+********************************************/
+
+#include <malloc.h>
+#include <string.h>
+
+#include "Image.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+// Constructor creates an empty image, use Create to allocate pixels
+CImage::CImage()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_Pitch = 0;
+	m_Pixels = 0;
+	m_Owned = true;
+}
+
+// Constructor creates an image of the given size (contents undefined)
+CImage::CImage( TUInt32 width, TUInt32 height )
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_Pitch = 0;
+	m_Pixels = 0;
+	m_Owned = true;
+	Create( width, height );
+}
+
+CImage::~CImage()
+{
+	Release();
+}
+
+
+//-----------------------------------------------------------------------------
+// Creation
+//-----------------------------------------------------------------------------
+
+// Allocate pixels for an image of the given size, releasing any existing pixels. The
+// contents are undefined. Returns false on memory failure
+bool CImage::Create( TUInt32 width, TUInt32 height )
+{
+	// Reuse existing memory if the size is unchanged (views are not resized in place)
+	if (m_Pixels && m_Owned && width == m_Width && height == m_Height)
+	{
+		return true;
+	}
+	Release();
+	if (width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	// Round rows up to 16 bytes (4 pixels) so each row starts aligned
+	TUInt32 pitch = (width * 4 + 15) & ~15u;
+	m_Pixels = static_cast<TUInt8*>(_aligned_malloc( static_cast<size_t>(pitch) * height, 16 ));
+	if (!m_Pixels)
+	{
+		return false;
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_Pitch = pitch;
+	return true;
+}
+
+// Make this image a view of pixel memory owned elsewhere (e.g. shared memory), releasing any
+// existing pixels. The memory must be 16 byte aligned with a pitch that is a multiple of 16,
+// and must outlive the view. Release and Create detach the view without freeing the memory
+void CImage::Attach( TUInt8* pixels, TUInt32 width, TUInt32 height, TUInt32 pitch )
+{
+	Release();
+	m_Pixels = pixels;
+	m_Width = width;
+	m_Height = height;
+	m_Pitch = pitch;
+	m_Owned = false;
+}
+
+// Release pixel memory
+void CImage::Release()
+{
+	if (m_Pixels && m_Owned) _aligned_free( m_Pixels );
+	m_Pixels = 0;
+	m_Owned = true;
+	m_Width = 0;
+	m_Height = 0;
+	m_Pitch = 0;
+}
+
+// Copy the contents of another image of the same size into this one
+void CImage::CopyFrom( const CImage& source )
+{
+	if (!Create( source.Width(), source.Height() )) return;
+	if (source.m_Pitch == m_Pitch)
+	{
+		memcpy( m_Pixels, source.m_Pixels, static_cast<size_t>(m_Pitch) * m_Height );
+	}
+	else
+	{
+		// Views may have a wider pitch
+		for (TUInt32 y = 0; y < m_Height; ++y)
+		{
+			memcpy( Row( y ), source.Row( y ), m_Width * 4 );
+		}
+	}
+}
+
+// Fill the entire image with a single RGBA colour
+void CImage::Fill( TUInt8 r, TUInt8 g, TUInt8 b, TUInt8 a )
+{
+	for (TUInt32 y = 0; y < m_Height; ++y)
+	{
+		TUInt8* pixel = Row( y );
+		for (TUInt32 x = 0; x < m_Width; ++x)
+		{
+			pixel[0] = r;
+			pixel[1] = g;
+			pixel[2] = b;
+			pixel[3] = a;
+			pixel += 4;
+		}
+	}
+}
+
+
+} // namespace gen
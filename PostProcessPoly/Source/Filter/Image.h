@@ -0,0 +1,142 @@
+/*******************************************
+	Image.h
+
+	CPU-side RGBA image used by the software
+	post-processing filters
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Addressing mode used when a filter reads outside the image. Matches the sampler states in
+// PostProcess.fx - Clamp repeats the edge pixel, Border reads transparent black
+enum EAddressMode
+{
+	kAddressClamp,
+	kAddressBorder,
+};
+
+
+// An 8-bit RGBA image matching the DXGI_FORMAT_R8G8B8A8_UNORM scene textures. Rows are padded
+// to a 16 byte boundary and the pixel memory is 16 byte aligned so filters can use SSE loads
+class CImage
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor creates an empty image, use Create to allocate pixels
+	CImage();
+
+	// Constructor creates an image of the given size (contents undefined)
+	CImage( TUInt32 width, TUInt32 height );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CImage( const CImage& );
+	CImage& operator=( const CImage& );
+
+public:
+	~CImage();
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Allocate pixels for an image of the given size, releasing any existing pixels. The
+	// contents are undefined. Returns false on memory failure
+	bool Create( TUInt32 width, TUInt32 height );
+
+	// Make this image a view of pixel memory owned elsewhere (e.g. shared memory), releasing any
+	// existing pixels. The memory must be 16 byte aligned with a pitch that is a multiple of 16,
+	// and must outlive the view. Release and Create detach the view without freeing the memory
+	void Attach( TUInt8* pixels, TUInt32 width, TUInt32 height, TUInt32 pitch );
+
+	// Release pixel memory
+	void Release();
+
+	// Copy the contents of another image of the same size into this one
+	void CopyFrom( const CImage& source );
+
+	// Fill the entire image with a single RGBA colour
+	void Fill( TUInt8 r, TUInt8 g, TUInt8 b, TUInt8 a );
+
+
+	/////////////////////////////////////
+	// Access
+
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+
+	// Distance in bytes between the start of consecutive rows
+	TUInt32 Pitch() const
+	{
+		return m_Pitch;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Pixels == 0;
+	}
+
+	// Whether the pixels are a view of memory owned elsewhere
+	bool IsAttached() const
+	{
+		return m_Pixels != 0 && !m_Owned;
+	}
+
+	// Pointer to the first byte of the given row
+	TUInt8* Row( TUInt32 y )
+	{
+		return m_Pixels + y * m_Pitch;
+	}
+	const TUInt8* Row( TUInt32 y ) const
+	{
+		return m_Pixels + y * m_Pitch;
+	}
+
+	// Offset in bytes of the given column from the start of any row
+	TUInt32 ColumnOffset( TUInt32 x ) const
+	{
+		return x * 4;
+	}
+
+	// Pointer to the given pixel (4 bytes, RGBA order)
+	TUInt8* Pixel( TUInt32 x, TUInt32 y )
+	{
+		return m_Pixels + y * m_Pitch + x * 4;
+	}
+	const TUInt8* Pixel( TUInt32 x, TUInt32 y ) const
+	{
+		return m_Pixels + y * m_Pitch + x * 4;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	TUInt32 m_Width;
+	TUInt32 m_Height;
+	TUInt32 m_Pitch;  // Bytes per row, multiple of 16
+	TUInt8* m_Pixels; // Aligned allocation, or external memory if attached
+	bool    m_Owned;  // False for views of external memory
+};
+
+
+} // namespace gen
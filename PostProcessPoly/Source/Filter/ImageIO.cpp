@@ -0,0 +1,312 @@
+/*******************************************
+	ImageIO.cpp
+
+	Reading and writing CPU images as TGA, PPM
+	and raw RGBA files or streams
+********************************************/
+
+#include <string.h>
+#include <ctype.h>
+#include <vector>
+using namespace std;
+
+#include "ImageIO.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// TGA
+//-----------------------------------------------------------------------------
+
+// TGA image types and descriptor bits used
+const TUInt8 kTGATrueColour = 2;
+const TUInt8 kTGATrueColourRLE = 10;
+const TUInt8 kTGATopLeftOrigin = 0x20;
+
+// Copy one TGA pixel (BGR or BGRA) to an RGBA pixel
+inline void TGAToRGBA( const TUInt8* tga, TUInt32 bytesPerPixel, TUInt8* rgba )
+{
+	rgba[0] = tga[2];
+	rgba[1] = tga[1];
+	rgba[2] = tga[0];
+	rgba[3] = (bytesPerPixel == 4) ? tga[3] : 255;
+}
+
+bool ReadTGA( FILE* file, CImage& image )
+{
+	TUInt8 header[18];
+	if (fread( header, 1, 18, file ) != 18) return false;
+
+	TUInt8 idLength = header[0];
+	TUInt8 colourMapType = header[1];
+	TUInt8 imageType = header[2];
+	TUInt32 width = header[12] | (header[13] << 8);
+	TUInt32 height = header[14] | (header[15] << 8);
+	TUInt32 bytesPerPixel = header[16] / 8;
+	bool topLeft = (header[17] & kTGATopLeftOrigin) != 0;
+	if (colourMapType != 0 || (imageType != kTGATrueColour && imageType != kTGATrueColourRLE) ||
+	    (bytesPerPixel != 3 && bytesPerPixel != 4))
+	{
+		return false;
+	}
+	if (idLength > 0 && fseek( file, idLength, SEEK_CUR ) != 0) return false;
+	if (!image.Create( width, height )) return false;
+
+	vector<TUInt8> row( width * bytesPerPixel );
+	TUInt8 packet[4];
+	TUInt32 runCount = 0;  // Pixels left in the current RLE packet
+	bool runRepeats = false;
+	for (TUInt32 i = 0; i < height; ++i)
+	{
+		TUInt8* outPixel = image.Row( topLeft ? i : height - 1 - i );
+		if (imageType == kTGATrueColour)
+		{
+			if (fread( &row[0], 1, row.size(), file ) != row.size()) return false;
+			for (TUInt32 x = 0; x < width; ++x)
+			{
+				TGAToRGBA( &row[x * bytesPerPixel], bytesPerPixel, outPixel + x * 4 );
+			}
+		}
+		else
+		{
+			// RLE packets may cross row boundaries
+			for (TUInt32 x = 0; x < width; ++x)
+			{
+				if (runCount == 0)
+				{
+					int packetHeader = fgetc( file );
+					if (packetHeader == EOF) return false;
+					runCount = (packetHeader & 0x7f) + 1;
+					runRepeats = (packetHeader & 0x80) != 0;
+					if (runRepeats && fread( packet, 1, bytesPerPixel, file ) != bytesPerPixel) return false;
+				}
+				if (!runRepeats && fread( packet, 1, bytesPerPixel, file ) != bytesPerPixel) return false;
+				TGAToRGBA( packet, bytesPerPixel, outPixel + x * 4 );
+				--runCount;
+			}
+		}
+	}
+	return true;
+}
+
+bool WriteTGA( FILE* file, const CImage& image )
+{
+	const TUInt32 width = image.Width();
+	const TUInt32 height = image.Height();
+	TUInt8 header[18];
+	memset( header, 0, sizeof(header) );
+	header[2] = kTGATrueColour;
+	header[12] = static_cast<TUInt8>(width & 0xff);
+	header[13] = static_cast<TUInt8>(width >> 8);
+	header[14] = static_cast<TUInt8>(height & 0xff);
+	header[15] = static_cast<TUInt8>(height >> 8);
+	header[16] = 32;
+	header[17] = kTGATopLeftOrigin | 8; // 8 alpha bits
+	if (fwrite( header, 1, 18, file ) != 18) return false;
+
+	vector<TUInt8> row( width * 4 );
+	for (TUInt32 y = 0; y < height; ++y)
+	{
+		const TUInt8* pixel = image.Row( y );
+		for (TUInt32 x = 0; x < width * 4; x += 4)
+		{
+			row[x]     = pixel[x + 2];
+			row[x + 1] = pixel[x + 1];
+			row[x + 2] = pixel[x];
+			row[x + 3] = pixel[x + 3];
+		}
+		if (fwrite( &row[0], 1, row.size(), file ) != row.size()) return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// PPM
+//-----------------------------------------------------------------------------
+
+// Read an unsigned decimal header field, skipping whitespace and comments
+bool ReadPPMField( FILE* file, TUInt32& value )
+{
+	int c = fgetc( file );
+	while (c != EOF && (isspace( c ) || c == '#'))
+	{
+		if (c == '#')
+		{
+			while (c != EOF && c != '\n') c = fgetc( file );
+		}
+		c = fgetc( file );
+	}
+	if (c == EOF || !isdigit( c )) return false;
+
+	value = 0;
+	while (c != EOF && isdigit( c ))
+	{
+		value = value * 10 + (c - '0');
+		c = fgetc( file );
+	}
+	return true; // The single whitespace after the field has been consumed
+}
+
+bool ReadPPM( FILE* file, CImage& image )
+{
+	TUInt32 width, height, maxValue;
+	if (fgetc( file ) != 'P' || fgetc( file ) != '6') return false;
+	if (!ReadPPMField( file, width ) || !ReadPPMField( file, height ) || !ReadPPMField( file, maxValue )) return false;
+	if (maxValue != 255 || !image.Create( width, height )) return false;
+
+	vector<TUInt8> row( width * 3 );
+	for (TUInt32 y = 0; y < height; ++y)
+	{
+		if (fread( &row[0], 1, row.size(), file ) != row.size()) return false;
+		TUInt8* outPixel = image.Row( y );
+		for (TUInt32 x = 0; x < width; ++x)
+		{
+			outPixel[0] = row[x * 3];
+			outPixel[1] = row[x * 3 + 1];
+			outPixel[2] = row[x * 3 + 2];
+			outPixel[3] = 255;
+			outPixel += 4;
+		}
+	}
+	return true;
+}
+
+bool WritePPM( FILE* file, const CImage& image )
+{
+	const TUInt32 width = image.Width();
+	if (fprintf( file, "P6\n%u %u\n255\n", width, image.Height() ) < 0) return false;
+
+	vector<TUInt8> row( width * 3 );
+	for (TUInt32 y = 0; y < image.Height(); ++y)
+	{
+		const TUInt8* pixel = image.Row( y );
+		for (TUInt32 x = 0; x < width; ++x)
+		{
+			row[x * 3]     = pixel[0];
+			row[x * 3 + 1] = pixel[1];
+			row[x * 3 + 2] = pixel[2];
+			pixel += 4;
+		}
+		if (fwrite( &row[0], 1, row.size(), file ) != row.size()) return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Raw
+//-----------------------------------------------------------------------------
+
+bool ReadRaw( FILE* file, CImage& image )
+{
+	if (image.IsEmpty()) return false;
+	const size_t rowBytes = image.Width() * 4;
+	for (TUInt32 y = 0; y < image.Height(); ++y)
+	{
+		if (fread( image.Row( y ), 1, rowBytes, file ) != rowBytes) return false;
+	}
+	return true;
+}
+
+bool WriteRaw( FILE* file, const CImage& image )
+{
+	const size_t rowBytes = image.Width() * 4;
+	for (TUInt32 y = 0; y < image.Height(); ++y)
+	{
+		if (fwrite( image.Row( y ), 1, rowBytes, file ) != rowBytes) return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Public interface
+//-----------------------------------------------------------------------------
+
+// Choose a format from a file extension (.tga, .ppm, .rgba / .raw). Returns false if unknown
+bool ImageFormatFromPath( const string& path, EImageFormat& format )
+{
+	size_t dot = path.find_last_of( '.' );
+	if (dot == string::npos) return false;
+	string extension;
+	for (size_t i = dot + 1; i < path.length(); ++i)
+	{
+		extension += static_cast<char>(tolower( path[i] ));
+	}
+
+	if (extension == "tga")
+	{
+		format = kImageTGA;
+	}
+	else if (extension == "ppm")
+	{
+		format = kImagePPM;
+	}
+	else if (extension == "rgba" || extension == "raw")
+	{
+		format = kImageRaw;
+	}
+	else
+	{
+		return false;
+	}
+	return true;
+}
+
+// Load / save an image file, format chosen from the extension. Raw files cannot be loaded this
+// way as they have no size. Return false on failure
+bool LoadImageFile( const string& path, CImage& image )
+{
+	EImageFormat format;
+	if (!ImageFormatFromPath( path, format ) || format == kImageRaw) return false;
+
+	FILE* file = fopen( path.c_str(), "rb" );
+	if (!file) return false;
+	bool success = ReadImage( file, format, image );
+	fclose( file );
+	return success;
+}
+
+bool SaveImageFile( const string& path, const CImage& image )
+{
+	EImageFormat format;
+	if (!ImageFormatFromPath( path, format )) return false;
+
+	FILE* file = fopen( path.c_str(), "wb" );
+	if (!file) return false;
+	bool success = WriteImage( file, format, image );
+	success = (fclose( file ) == 0) && success;
+	return success;
+}
+
+
+// Read / write one image from an open binary stream, so sequences can be piped between tools.
+// ReadImage reads a raw image at the size the image already has. Return false at end of stream
+// or on error
+bool ReadImage( FILE* file, EImageFormat format, CImage& image )
+{
+	switch (format)
+	{
+		case kImageTGA: return ReadTGA( file, image );
+		case kImagePPM: return ReadPPM( file, image );
+		case kImageRaw: return ReadRaw( file, image );
+		default:        return false;
+	}
+}
+
+bool WriteImage( FILE* file, EImageFormat format, const CImage& image )
+{
+	if (image.IsEmpty()) return false;
+	switch (format)
+	{
+		case kImageTGA: return WriteTGA( file, image );
+		case kImagePPM: return WritePPM( file, image );
+		case kImageRaw: return WriteRaw( file, image );
+		default:        return false;
+	}
+}
+
+
+} // namespace gen
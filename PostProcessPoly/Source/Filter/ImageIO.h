@@ -0,0 +1,52 @@
+/*******************************************
+	ImageIO.h
+
+	Reading and writing CPU images as TGA, PPM
+	and raw RGBA files or streams
+********************************************/
+
+#pragma once
+
+#include <stdio.h>
+
+#include "Defines.h"
+#include "Image.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Files
+//-----------------------------------------------------------------------------
+
+// Supported formats. TGA reads uncompressed and RLE 24/32-bit images and writes uncompressed
+// 32-bit. PPM is binary (P6) 8-bit RGB, alpha is set to 255 on reading and dropped on writing.
+// Raw is tightly packed RGBA rows with no header, so the size must be known to read it
+enum EImageFormat
+{
+	kImageTGA,
+	kImagePPM,
+	kImageRaw,
+};
+
+// Choose a format from a file extension (.tga, .ppm, .rgba / .raw). Returns false if unknown
+bool ImageFormatFromPath( const string& path, EImageFormat& format );
+
+// Load / save an image file, format chosen from the extension. Raw files cannot be loaded this
+// way as they have no size. Return false on failure
+bool LoadImageFile( const string& path, CImage& image );
+bool SaveImageFile( const string& path, const CImage& image );
+
+
+//-----------------------------------------------------------------------------
+// Streams
+//-----------------------------------------------------------------------------
+
+// Read / write one image from an open binary stream, so sequences can be piped between tools.
+// ReadImage reads a raw image at the size the image already has. Return false at end of stream
+// or on error
+bool ReadImage( FILE* file, EImageFormat format, CImage& image );
+bool WriteImage( FILE* file, EImageFormat format, const CImage& image );
+
+
+} // namespace gen
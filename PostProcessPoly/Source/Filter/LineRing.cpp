@@ -0,0 +1,111 @@
+/*******************************************
+	LineRing.cpp
+
+	Ring of image rows used by the streaming
+	filter chain
+********************************************/
+
+#include <malloc.h>
+
+#include "LineRing.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+// Constructor creates an empty ring, use Create or Attach
+CLineRing::CLineRing()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_Capacity = 0;
+	m_Pitch = 0;
+	m_Pixels = 0;
+	m_Owned = true;
+	m_BandBegin = m_BandEnd = 0;
+}
+
+CLineRing::~CLineRing()
+{
+	Release();
+}
+
+
+//-----------------------------------------------------------------------------
+// Creation
+//-----------------------------------------------------------------------------
+
+// Allocate a ring holding the given number of rows of an image of the given size, releasing
+// any existing rows. Capacity is limited to the height. Returns false on memory failure
+bool CLineRing::Create( TUInt32 width, TUInt32 height, TUInt32 capacity )
+{
+	if (capacity > height) capacity = height;
+
+	// Reuse existing memory if the shape is unchanged
+	if (m_Pixels && width == m_Width && height == m_Height && capacity == m_Capacity)
+	{
+		m_BandBegin = m_BandEnd = 0;
+		return true;
+	}
+	Release();
+	if (width == 0 || height == 0 || capacity == 0)
+	{
+		return false;
+	}
+
+	// Rows are padded to 16 bytes as in CImage
+	TUInt32 pitch = (width * 4 + 15) & ~15u;
+	m_Pixels = static_cast<TUInt8*>(_aligned_malloc( static_cast<size_t>(pitch) * capacity, 16 ));
+	if (!m_Pixels)
+	{
+		return false;
+	}
+
+	m_Rows.resize( height );
+	for (TUInt32 y = 0; y < height; ++y)
+	{
+		m_Rows[y] = m_Pixels + (y % capacity) * pitch;
+	}
+	m_Width = width;
+	m_Height = height;
+	m_Capacity = capacity;
+	m_Pitch = pitch;
+	return true;
+}
+
+// Make this ring a view of every row of an image, which must outlive the view. The view is
+// writable, a view of an image the caller holds as const must only be read
+void CLineRing::Attach( const CImage& image )
+{
+	Release();
+	m_Rows.resize( image.Height() );
+	for (TUInt32 y = 0; y < image.Height(); ++y)
+	{
+		m_Rows[y] = const_cast<TUInt8*>(image.Row( y ));
+	}
+	m_Width = image.Width();
+	m_Height = image.Height();
+	m_Capacity = image.Height();
+	m_Pitch = image.Pitch();
+	m_Owned = false;
+}
+
+// Release row memory
+void CLineRing::Release()
+{
+	if (m_Pixels) _aligned_free( m_Pixels );
+	m_Pixels = 0;
+	m_Owned = true;
+	m_Rows.clear();
+	m_Width = 0;
+	m_Height = 0;
+	m_Capacity = 0;
+	m_Pitch = 0;
+	m_BandBegin = m_BandEnd = 0;
+}
+
+
+} // namespace gen
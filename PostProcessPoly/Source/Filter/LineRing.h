@@ -0,0 +1,162 @@
+/*******************************************
+	LineRing.h
+
+	Ring of image rows used by the streaming
+	filter chain
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+
+namespace gen
+{
+
+// An RGBA image of which only a limited number of consecutive rows are held at once, in a ring
+// of row buffers. Rows are addressed by their position in the full image, so the filters can
+// read a ring as they would a CImage as long as they stay within the rows it holds. A ring can
+// also be a view of a whole CImage, holding every row.
+//
+// The rows a filter pass writes next are set as the band. Rows in the band replace those a
+// capacity further up, so the band must be no taller than the capacity and a pass reading the
+// ring must have finished with the rows they replace
+class CLineRing
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor creates an empty ring, use Create or Attach
+	CLineRing();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CLineRing( const CLineRing& );
+	CLineRing& operator=( const CLineRing& );
+
+public:
+	~CLineRing();
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Allocate a ring holding the given number of rows of an image of the given size, releasing
+	// any existing rows. Capacity is limited to the height. Returns false on memory failure
+	bool Create( TUInt32 width, TUInt32 height, TUInt32 capacity );
+
+	// Make this ring a view of every row of an image, which must outlive the view. The view is
+	// writable, a view of an image the caller holds as const must only be read
+	void Attach( const CImage& image );
+
+	// Release row memory
+	void Release();
+
+
+	/////////////////////////////////////
+	// Band
+
+	// Set the rows written by the next filter pass
+	void SetBand( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		m_BandBegin = rowBegin;
+		m_BandEnd = rowEnd;
+	}
+
+	TUInt32 BandBegin() const
+	{
+		return m_BandBegin;
+	}
+	TUInt32 BandEnd() const
+	{
+		return m_BandEnd;
+	}
+
+
+	/////////////////////////////////////
+	// Access
+
+	// Size of the full image
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+
+	// Rows held at once
+	TUInt32 Capacity() const
+	{
+		return m_Capacity;
+	}
+
+	// Bytes of row memory owned by the ring (none for a view)
+	size_t Bytes() const
+	{
+		return m_Owned ? static_cast<size_t>(m_Pitch) * m_Capacity : 0;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Rows.empty();
+	}
+
+	// Pointer to the first byte of the given row of the full image. Only meaningful for rows
+	// currently held
+	TUInt8* Row( TUInt32 y )
+	{
+		return m_Rows[y];
+	}
+	const TUInt8* Row( TUInt32 y ) const
+	{
+		return m_Rows[y];
+	}
+
+	// Offset in bytes of the given column from the start of any row
+	TUInt32 ColumnOffset( TUInt32 x ) const
+	{
+		return x * 4;
+	}
+
+	// Pointer to the given pixel (4 bytes, RGBA order)
+	TUInt8* Pixel( TUInt32 x, TUInt32 y )
+	{
+		return m_Rows[y] + x * 4;
+	}
+	const TUInt8* Pixel( TUInt32 x, TUInt32 y ) const
+	{
+		return m_Rows[y] + x * 4;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	TUInt32 m_Width;
+	TUInt32 m_Height;
+	TUInt32 m_Capacity;
+	TUInt32 m_Pitch;      // Bytes per row, multiple of 16
+	TUInt8* m_Pixels;     // Aligned allocation of the ring's rows, 0 for a view
+	bool    m_Owned;
+	TUInt32 m_BandBegin;
+	TUInt32 m_BandEnd;
+
+	// Row pointer for every row of the full image, so finding a row needs no division. Rows a
+	// capacity apart share memory
+	vector<TUInt8*> m_Rows;
+};
+
+
+} // namespace gen
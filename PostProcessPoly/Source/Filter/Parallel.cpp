@@ -0,0 +1,35 @@
+/*******************************************
+	Parallel.cpp
+
+	Simple fork-join helper used to split CPU
+	filter work across threads
+********************************************/
+
+#include "Parallel.h"
+
+namespace gen
+{
+
+// Thread count override, 0 to use the hardware thread count
+TUInt32 WorkerThreadOverride = 0;
+
+
+// Number of threads used by ParallelFor. Defaults to the hardware thread count
+TUInt32 NumWorkerThreads()
+{
+	if (WorkerThreadOverride > 0)
+	{
+		return WorkerThreadOverride;
+	}
+	TUInt32 hardwareThreads = thread::hardware_concurrency();
+	return (hardwareThreads > 0) ? hardwareThreads : 1;
+}
+
+// Override the number of threads used by ParallelFor, 0 restores the default
+void SetNumWorkerThreads( TUInt32 numThreads )
+{
+	WorkerThreadOverride = numThreads;
+}
+
+
+} // namespace gen
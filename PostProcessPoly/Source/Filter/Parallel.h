@@ -0,0 +1,83 @@
+/*******************************************
+	Parallel.h
+
+	Simple fork-join helper used to split CPU
+	filter work across threads
+********************************************/
+
+#pragma once
+
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Number of threads used by ParallelFor. Defaults to the hardware thread count
+TUInt32 NumWorkerThreads();
+
+// Override the number of threads used by ParallelFor, 0 restores the default
+void SetNumWorkerThreads( TUInt32 numThreads );
+
+
+// Split the range [begin, end) into one contiguous chunk per worker thread and call
+// function( chunkBegin, chunkEnd ) for each chunk, returning when all chunks are complete. The
+// calling thread processes the first chunk. Ranges too small to be worth splitting (fewer than
+// minPerThread items per thread) use fewer threads
+template <class TFunction>
+void ParallelFor( TUInt32 begin, TUInt32 end, TFunction function, TUInt32 minPerThread = 16 )
+{
+	if (end <= begin) return;
+
+	TUInt32 count = end - begin;
+	TUInt32 numThreads = NumWorkerThreads();
+	if (minPerThread > 0 && count / minPerThread < numThreads)
+	{
+		numThreads = count / minPerThread;
+	}
+	if (numThreads <= 1)
+	{
+		function( begin, end );
+		return;
+	}
+
+	// Chunk boundaries are spread evenly so chunk sizes differ by at most one
+	vector<thread> threads;
+	threads.reserve( numThreads - 1 );
+	for (TUInt32 t = 1; t < numThreads; ++t)
+	{
+		TUInt32 chunkBegin = begin + static_cast<TUInt32>((static_cast<TUInt64>(count) * t) / numThreads);
+		TUInt32 chunkEnd = begin + static_cast<TUInt32>((static_cast<TUInt64>(count) * (t + 1)) / numThreads);
+		threads.push_back( thread( function, chunkBegin, chunkEnd ) );
+	}
+	function( begin, begin + count / numThreads );
+
+	for (size_t t = 0; t < threads.size(); ++t)
+	{
+		threads[t].join();
+	}
+}
+
+// Split the range [0, count) into numRanges contiguous ranges and call
+// function( range, rangeBegin, rangeEnd ) for each, on up to numRanges threads (as ParallelFor,
+// fewer if there are fewer worker threads). Unlike ParallelFor the split depends only on the
+// number of ranges asked for, so results kept per range come out the same on any machine
+template <class TFunction>
+void ParallelForRanges( TUInt32 count, TUInt32 numRanges, TFunction function )
+{
+	ParallelFor( 0, numRanges, [&]( TUInt32 firstRange, TUInt32 endRange )
+	{
+		for (TUInt32 range = firstRange; range < endRange; ++range)
+		{
+			TUInt32 rangeBegin = static_cast<TUInt32>((static_cast<TUInt64>(count) * range) / numRanges);
+			TUInt32 rangeEnd = static_cast<TUInt32>((static_cast<TUInt64>(count) * (range + 1)) / numRanges);
+			function( range, rangeBegin, rangeEnd );
+		}
+	}, 1 );
+}
+
+
+} // namespace gen
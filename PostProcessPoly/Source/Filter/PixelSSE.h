@@ -0,0 +1,59 @@
+/*******************************************
+	PixelSSE.h
+
+	SSE helpers to convert between 8-bit RGBA
+	pixels and float4 registers
+********************************************/
+
+#pragma once
+
+#include <emmintrin.h> // SSE2
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Load one RGBA8 pixel into a float4 register, channels in the range 0->255
+inline __m128 LoadPixelSSE( const TUInt8* pixel )
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i p = _mm_cvtsi32_si128( *reinterpret_cast<const int*>(pixel) );
+	p = _mm_unpacklo_epi8( p, zero );
+	p = _mm_unpacklo_epi16( p, zero );
+	return _mm_cvtepi32_ps( p );
+}
+
+// Load four consecutive RGBA8 pixels into four float4 registers
+inline void LoadPixels4SSE( const TUInt8* pixels, __m128& p0, __m128& p1, __m128& p2, __m128& p3 )
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i p = _mm_loadu_si128( reinterpret_cast<const __m128i*>(pixels) );
+	__m128i lo = _mm_unpacklo_epi8( p, zero );
+	__m128i hi = _mm_unpackhi_epi8( p, zero );
+	p0 = _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo, zero ) );
+	p1 = _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo, zero ) );
+	p2 = _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi, zero ) );
+	p3 = _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi, zero ) );
+}
+
+// Round a float4 register (0->255 range) to the nearest integers and store as one RGBA8 pixel,
+// saturating values outside the range
+inline void StorePixelSSE( TUInt8* pixel, __m128 colour )
+{
+	__m128i p = _mm_cvtps_epi32( colour );
+	p = _mm_packs_epi32( p, p );
+	p = _mm_packus_epi16( p, p );
+	*reinterpret_cast<int*>(pixel) = _mm_cvtsi128_si32( p );
+}
+
+// Store four float4 registers as four consecutive RGBA8 pixels
+inline void StorePixels4SSE( TUInt8* pixels, __m128 p0, __m128 p1, __m128 p2, __m128 p3 )
+{
+	__m128i lo = _mm_packs_epi32( _mm_cvtps_epi32( p0 ), _mm_cvtps_epi32( p1 ) );
+	__m128i hi = _mm_packs_epi32( _mm_cvtps_epi32( p2 ), _mm_cvtps_epi32( p3 ) );
+	_mm_storeu_si128( reinterpret_cast<__m128i*>(pixels), _mm_packus_epi16( lo, hi ) );
+}
+
+
+} // namespace gen
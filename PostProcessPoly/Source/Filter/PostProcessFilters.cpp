@@ -0,0 +1,1666 @@
+/*******************************************
+	PostProcessFilters.cpp
+
+	CPU versions of the full screen post-process
+	shaders in PostProcess.fx
+********************************************/
+
+#include <math.h>
+#include <string.h>
+#include <ctype.h>
+#include <emmintrin.h> // SSE2
+#include <algorithm>
+#include <atomic>
+#include <vector>
+using namespace std;
+
+#include "PostProcessFilters.h"
+#include "PixelSSE.h"
+#include "Sampling.h"
+#include "FastMathSSE.h"
+#include "Parallel.h"
+#include "ColourConversion.h"
+#include "Convolution.h"
+#include "ColourSpace.h"
+#include "SummedAreaTable.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Filter types and parameters
+//-----------------------------------------------------------------------------
+
+// Name of each filter (technique name without the "PP" prefix)
+const char* const FilterNames[kNumFilters] =
+{
+	"Copy", "Tint", "GreyNoise", "Burn", "Distort", "Spiral", "HeatHaze", "GaussianBlur", "Ripple", "Shockwave", "Negative",
+	"Sharpen", "EdgeDetect", "Emboss", "FocusBlur"
+};
+
+// Find a filter from its name (case insensitive). Returns false if the name is not recognised
+bool FilterFromName( const string& name, EPostProcessFilter& filter )
+{
+	for (int f = 0; f < kNumFilters; ++f)
+	{
+		const char* filterName = FilterNames[f];
+		size_t i = 0;
+		while (i < name.length() && filterName[i] && tolower( name[i] ) == tolower( filterName[i] ))
+		{
+			++i;
+		}
+		if (i == name.length() && !filterName[i])
+		{
+			filter = static_cast<EPostProcessFilter>(f);
+			return true;
+		}
+	}
+	return false;
+}
+
+
+SFilterParams::SFilterParams()
+{
+	TintColour[0] = 1.0f;
+	TintColour[1] = TintColour[2] = 0.0f;
+	NoiseScale[0] = NoiseScale[1] = 1.0f;
+	NoiseOffset[0] = NoiseOffset[1] = 0.0f;
+	DistortLevel = 0.03f;
+	BurnLevel = 0.0f;
+	SpiralTimer = 0.0f;
+	HeatHazeTimer = 0.0f;
+	NumRipples = 1;
+	Ripples[0].Position[0] = Ripples[0].Position[1] = 0.0f;
+	Ripples[0].Time = 0.0f;
+	ShockwaveScale = 1.0f;
+	ShockwaveSin = 0.0f;
+	BlurStrength = 1.0f;
+	FocusCentre[0] = FocusCentre[1] = 0.0f;
+	FocusRadius = 0.0f;
+	FocusFalloff = 1.0f;
+	FocusBlurRadius = 16;
+	LinearLight = false;
+	NoiseMap = 0;
+	BurnMap = 0;
+	DistortMap = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Animation
+//-----------------------------------------------------------------------------
+
+// Animation speeds, as in the main app
+const TFloat32 kBurnSpeed = 0.2f;
+const TFloat32 kSpiralSpeed = 1.0f;
+const TFloat32 kHeatHazeSpeed = 1.0f;
+const TFloat32 kTintHueSpeed = 0.1f;
+const TFloat32 kRippleDuration = 3.0f;
+const TFloat32 kShockwaveFade = 1.5f;
+const TFloat32 kShockwaveStep = 0.2f;
+const TFloat32 kGrainSize = 140.0f;
+
+CFilterAnimation::CFilterAnimation( TUInt32 seed /*= 1*/ )
+{
+	m_Seed = seed;
+	Reset();
+}
+
+// Restart the animated values
+void CFilterAnimation::Reset()
+{
+	BurnLevel = 0.0f;
+	SpiralTimer = 0.0f;
+	HeatHazeTimer = 0.0f;
+	TintColourHSL[0] = 0.0f;
+	TintColourHSL[1] = 1.0f;
+	TintColourHSL[2] = 0.5f;
+	NumRipples = 1;
+	Ripples[0].Position[0] = Ripples[0].Position[1] = 0.0f;
+	Ripples[0].Time = 0.0f;
+	ShockwaveSin = 0.0f;
+	ShockwaveScale = 1.0f;
+	BlurStrength = 1.0f;
+	FocusCentre[0] = FocusCentre[1] = -1.0f;
+	FocusRadius = 0.0f;
+	FocusFalloff = 0.0f;
+	FocusBlurRadius = 16;
+	LinearLight = false;
+	m_RandomState = m_Seed;
+}
+
+// Restart the ripple at the given pixel position, as done by a right click in the app. Any
+// other ripples are removed
+void CFilterAnimation::StartRipple( TFloat32 x, TFloat32 y )
+{
+	NumRipples = 0;
+	AddRipple( x, y );
+}
+
+// Add a ripple at the given pixel position starting after the given delay in seconds,
+// keeping those under way. If there are already kMaxRipples the oldest is removed
+void CFilterAnimation::AddRipple( TFloat32 x, TFloat32 y, TFloat32 delay /*= 0.0f*/ )
+{
+	if (NumRipples == kMaxRipples)
+	{
+		TUInt32 oldest = 0;
+		for (TUInt32 i = 1; i < NumRipples; ++i)
+		{
+			if (Ripples[i].Time > Ripples[oldest].Time) oldest = i;
+		}
+		Ripples[oldest] = Ripples[--NumRipples];
+	}
+	SRipple& ripple = Ripples[NumRipples++];
+	ripple.Position[0] = x;
+	ripple.Position[1] = y;
+	ripple.Time = -delay;
+}
+
+// Restart the shockwave, as done by key 3 in the app
+void CFilterAnimation::StartShockwave()
+{
+	ShockwaveSin = 0.0f;
+	ShockwaveScale = 1.0f;
+}
+
+// Advance the animation by the given time in seconds
+void CFilterAnimation::Update( TFloat32 updateTime )
+{
+	BurnLevel = fmodf( BurnLevel + kBurnSpeed * updateTime, 1.0f );
+	SpiralTimer += kSpiralSpeed * updateTime;
+	HeatHazeTimer += kHeatHazeSpeed * updateTime;
+	TintColourHSL[0] += kTintHueSpeed * updateTime;
+	if (TintColourHSL[0] > 1.0f)
+	{
+		TintColourHSL[0] -= 1.0f;
+	}
+
+	// Finished ripples are removed
+	TUInt32 numRipples = 0;
+	for (TUInt32 i = 0; i < NumRipples; ++i)
+	{
+		Ripples[i].Time += updateTime;
+		if (Ripples[i].Time <= kRippleDuration) Ripples[numRipples++] = Ripples[i];
+	}
+	NumRipples = numRipples;
+
+	if (ShockwaveScale > 0.0f)
+	{
+		ShockwaveScale -= updateTime * kShockwaveFade;
+	}
+	ShockwaveSin += kShockwaveStep; // Per update rather than per second, as in the app
+}
+
+// False for one-shot effects that have finished (the app removes them from the filter list)
+bool CFilterAnimation::IsActive( EPostProcessFilter filter ) const
+{
+	switch (filter)
+	{
+		case kFilterRipple:
+			for (TUInt32 i = 0; i < NumRipples; ++i)
+			{
+				if (Ripples[i].Time >= 0.0f && Ripples[i].Time <= kRippleDuration) return true;
+			}
+			return false;
+
+		case kFilterShockwave: return ShockwaveScale > 0.0f;
+		default:               return true;
+	}
+}
+
+// Fill the parameters used by the given filter for a scene of the given size
+void CFilterAnimation::Select( EPostProcessFilter filter, TUInt32 width, TUInt32 height, SFilterParams& params )
+{
+	params.LinearLight = LinearLight;
+	switch (filter)
+	{
+		case kFilterTint:
+			HSLToRGB( TintColourHSL[0], TintColourHSL[1], TintColourHSL[2], params.TintColour[0], params.TintColour[1], params.TintColour[2] );
+			break;
+
+		case kFilterGreyNoise:
+			params.NoiseScale[0] = width / kGrainSize;
+			params.NoiseScale[1] = height / kGrainSize;
+			params.NoiseOffset[0] = Random();
+			params.NoiseOffset[1] = Random();
+			break;
+
+		case kFilterBurn:
+			params.BurnLevel = BurnLevel;
+			break;
+
+		case kFilterDistort:
+			params.DistortLevel = 0.03f;
+			break;
+
+		case kFilterSpiral:
+			params.SpiralTimer = (1.0f - cosf( SpiralTimer )) * 4.0f;
+			break;
+
+		case kFilterHeatHaze:
+			params.HeatHazeTimer = HeatHazeTimer;
+			break;
+
+		case kFilterGaussianBlur:
+			params.BlurStrength = BlurStrength;
+			break;
+
+		case kFilterRipple:
+			params.NumRipples = 0;
+			for (TUInt32 i = 0; i < NumRipples; ++i)
+			{
+				if (Ripples[i].Time >= 0.0f && Ripples[i].Time <= kRippleDuration)
+				{
+					params.Ripples[params.NumRipples++] = Ripples[i];
+				}
+			}
+			break;
+
+		case kFilterShockwave:
+			params.ShockwaveSin = sinf( ShockwaveSin ) * ShockwaveScale;
+			params.ShockwaveScale = ShockwaveScale;
+			break;
+
+		case kFilterFocusBlur:
+			params.FocusCentre[0] = (FocusCentre[0] < 0.0f) ? width * 0.5f : FocusCentre[0];
+			params.FocusCentre[1] = (FocusCentre[1] < 0.0f) ? height * 0.5f : FocusCentre[1];
+			params.FocusRadius = (FocusRadius > 0.0f) ? FocusRadius : height * 0.1f;
+			params.FocusFalloff = (FocusFalloff > 0.0f) ? FocusFalloff : height * 0.5f;
+			params.FocusBlurRadius = (FocusBlurRadius < 255) ? FocusBlurRadius : 255;
+			break;
+
+		default:
+			break;
+	}
+}
+
+// Random value from 0 to 1 (simple LCG so results repeat for the same seed)
+TFloat32 CFilterAnimation::Random()
+{
+	m_RandomState = m_RandomState * 1664525u + 1013904223u;
+	return (m_RandomState >> 8) * (1.0f / 16777216.0f);
+}
+
+
+//-----------------------------------------------------------------------------
+// Sampling
+//-----------------------------------------------------------------------------
+
+// The samplers matching the sampler states in PostProcess.fx are in Sampling.h
+
+// Linear interpolation of float4 colours
+inline __m128 LerpSSE( __m128 a, __m128 b, TFloat32 t )
+{
+	return _mm_add_ps( a, _mm_mul_ps( _mm_set1_ps( t ), _mm_sub_ps( b, a ) ) );
+}
+
+inline TFloat32 Saturate( TFloat32 x )
+{
+	return (x < 0.0f) ? 0.0f : ((x > 1.0f) ? 1.0f : x);
+}
+
+// Soft edged circle alpha used by several shaders - 1 inside a circle of radius 0.5 centred in
+// the UV area, fading to 0 over softEdge (in squared UV distance)
+inline TFloat32 SoftCircleAlpha( TFloat32 u, TFloat32 v, TFloat32 softEdge )
+{
+	TFloat32 du = u - 0.5f;
+	TFloat32 dv = v - 0.5f;
+	return 1.0f - Saturate( (du * du + dv * dv - 0.25f + softEdge) / softEdge );
+}
+
+// SoftCircleAlpha for four pixels, given their offsets from the centre of the UV area
+inline __m128 SoftCircleAlphaSSE( __m128 du, __m128 dv, TFloat32 softEdge )
+{
+	__m128 t = _mm_add_ps( _mm_add_ps( _mm_mul_ps( du, du ), _mm_mul_ps( dv, dv ) ), _mm_set1_ps( softEdge - 0.25f ) );
+	t = _mm_min_ps( _mm_max_ps( _mm_div_ps( t, _mm_set1_ps( softEdge ) ), _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+	return _mm_sub_ps( _mm_set1_ps( 1.0f ), t );
+}
+
+// Columns of one row grouped by their soft circle alpha: 0 before OuterBegin and from OuterEnd,
+// 1 from InnerBegin to InnerEnd, and in the soft edge band between to be calculated. Bounds are
+// found analytically and moved a pixel or two towards the band, so pixels near a boundary are
+// always calculated in full and output is unchanged by float rounding
+struct SCircleSpan
+{
+	TUInt32 OuterBegin;
+	TUInt32 InnerBegin;
+	TUInt32 InnerEnd;
+	TUInt32 OuterEnd;
+};
+
+enum ECircleCoverage
+{
+	kCircleOutside, // Alpha 0, the filter leaves the scene unchanged
+	kCircleEdge,    // Alpha must be calculated
+	kCircleInside,  // Alpha 1
+};
+
+// Find the span of each row of an image for SoftCircleAlpha with the given soft edge. The
+// circle in UV space is an ellipse in pixels filling the image, so about a fifth of the pixels
+// are outside it
+void SoftCircleSpans( TUInt32 width, TUInt32 height, TFloat32 softEdge, vector<SCircleSpan>& spans )
+{
+	// Pixel x is inside a circle of half width h on its row if |(x + 0.5) / width - 0.5| < h, so
+	// between the edges width * (0.5 -/+ h) - 0.5. Each bound is rounded away from the side it
+	// is certain of, then moved another pixel
+	spans.resize( height );
+	for (TUInt32 y = 0; y < height; ++y)
+	{
+		TFloat32 dv = (y + 0.5f) / height - 0.5f;
+		TFloat32 outerSq = 0.25f - dv * dv;
+		TFloat32 innerSq = outerSq - softEdge;
+		TFloat32 outer = (outerSq > 0.0f) ? sqrtf( outerSq ) : 0.0f;
+
+		TInt32 outerBegin = static_cast<TInt32>(floorf( width * (0.5f - outer) - 0.5f )) - 1;
+		TInt32 outerEnd = static_cast<TInt32>(ceilf( width * (0.5f + outer) - 0.5f )) + 1;
+		outerBegin = max( outerBegin, 0 );
+		outerEnd = min( outerEnd, static_cast<TInt32>(width) );
+
+		// Without an inner span the whole outer span is soft edge
+		TInt32 innerBegin = outerEnd;
+		TInt32 innerEnd = outerEnd;
+		if (innerSq > 0.0f)
+		{
+			TFloat32 inner = sqrtf( innerSq );
+			TInt32 begin = static_cast<TInt32>(ceilf( width * (0.5f - inner) - 0.5f )) + 1;
+			TInt32 end = static_cast<TInt32>(floorf( width * (0.5f + inner) - 0.5f ));
+			if (begin < end)
+			{
+				innerBegin = max( begin, outerBegin );
+				innerEnd = min( end, outerEnd );
+			}
+		}
+
+		SCircleSpan& span = spans[y];
+		span.OuterBegin = static_cast<TUInt32>(outerBegin);
+		span.InnerBegin = static_cast<TUInt32>(innerBegin);
+		span.InnerEnd = static_cast<TUInt32>(innerEnd);
+		span.OuterEnd = static_cast<TUInt32>(outerEnd);
+	}
+}
+
+// Coverage of count pixels from column x by a row's span
+inline ECircleCoverage CircleCoverage( const SCircleSpan& span, TUInt32 x, TUInt32 count )
+{
+	if (x + count <= span.OuterBegin || x >= span.OuterEnd)  return kCircleOutside;
+	if (x >= span.InnerBegin && x + count <= span.InnerEnd) return kCircleInside;
+	return kCircleEdge;
+}
+
+// Write a colour as an opaque pixel
+inline void StoreOpaque( TUInt8* pixel, __m128 colour )
+{
+	StorePixelSSE( pixel, colour );
+	pixel[3] = 255;
+}
+
+
+// Run a per-pixel shader function over the destination image in parallel. The function is
+// called as shader( u, v, x, y ) with the UV of the pixel centre and returns a float4 colour
+// (0->255 range). Output alpha is set to 255. There are versions for each image layout, these
+// work through a linear image row by row
+template <class TShader>
+void RunShader( CImage& dest, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const TFloat32 invWidth = 1.0f / dest.Width();
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	ParallelFor( 0, dest.Height(), [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			TUInt8* outPixel = dest.Row( y );
+			TFloat32 v = (y + 0.5f) * invHeight;
+			for (TUInt32 x = 0; x < width; ++x)
+			{
+				StoreOpaque( outPixel, shader( (x + 0.5f) * invWidth, v, x, y ) );
+				outPixel += 4;
+			}
+		}
+	});
+}
+
+// Run a shader over the destination image four pixels at a time, for shaders with vectorised
+// maths. The function is called as shader( u, v, x, y, count, colours ) with the UVs of the
+// centres of pixels x to x + 3 in row y (v is the same in each lane) and must write the float4
+// colours (0->255 range) of the first count pixels, which is less than four at the right edge
+template <class TShader>
+void RunShader4( CImage& dest, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const __m128 invWidth = _mm_set1_ps( 1.0f / dest.Width() );
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	const __m128 pixelCentres = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+	ParallelFor( 0, dest.Height(), [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		__m128 colours[4];
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			TUInt8* outPixel = dest.Row( y );
+			__m128 v = _mm_set1_ps( (y + 0.5f) * invHeight );
+			for (TUInt32 x = 0; x < width; x += 4)
+			{
+				__m128 u = _mm_mul_ps( _mm_add_ps( _mm_set1_ps( static_cast<TFloat32>(x) ), pixelCentres ), invWidth );
+				TUInt32 count = (width - x < 4) ? width - x : 4;
+				shader( u, v, x, y, count, colours );
+				for (TUInt32 i = 0; i < count; ++i)
+				{
+					StoreOpaque( outPixel, colours[i] );
+					outPixel += 4;
+				}
+			}
+		}
+	});
+}
+
+// Tiled versions of RunShader and RunShader4 working through the destination a tile at a time,
+// so each tile's reads come from a compact area of the source. Threads take rows of tiles
+template <class TShader>
+void RunShader( CTiledImage& dest, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const TUInt32 height = dest.Height();
+	const TFloat32 invWidth = 1.0f / dest.Width();
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	ParallelFor( 0, dest.TilesY(), [&]( TUInt32 tileRowBegin, TUInt32 tileRowEnd )
+	{
+		for (TUInt32 tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+		{
+			TUInt32 y0 = tileY << kTileShift;
+			TUInt32 rows = (height - y0 < kTileSize) ? height - y0 : kTileSize;
+			for (TUInt32 tileX = 0; tileX < dest.TilesX(); ++tileX)
+			{
+				TUInt32 x0 = tileX << kTileShift;
+				TUInt32 columns = (width - x0 < kTileSize) ? width - x0 : kTileSize;
+				TUInt8* tile = dest.Tile( tileX, tileY );
+				for (TUInt32 row = 0; row < rows; ++row)
+				{
+					TUInt8* outPixel = tile + row * kTileSize * 4;
+					TUInt32 y = y0 + row;
+					TFloat32 v = (y + 0.5f) * invHeight;
+					for (TUInt32 x = x0; x < x0 + columns; ++x)
+					{
+						StoreOpaque( outPixel, shader( (x + 0.5f) * invWidth, v, x, y ) );
+						outPixel += 4;
+					}
+				}
+			}
+		}
+	}, 2 );
+}
+
+template <class TShader>
+void RunShader4( CTiledImage& dest, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const TUInt32 height = dest.Height();
+	const __m128 invWidth = _mm_set1_ps( 1.0f / dest.Width() );
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	const __m128 pixelCentres = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+	ParallelFor( 0, dest.TilesY(), [&]( TUInt32 tileRowBegin, TUInt32 tileRowEnd )
+	{
+		__m128 colours[4];
+		for (TUInt32 tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+		{
+			TUInt32 y0 = tileY << kTileShift;
+			TUInt32 rows = (height - y0 < kTileSize) ? height - y0 : kTileSize;
+			for (TUInt32 tileX = 0; tileX < dest.TilesX(); ++tileX)
+			{
+				TUInt32 x0 = tileX << kTileShift;
+				TUInt32 xEnd = (width - x0 < kTileSize) ? width : x0 + kTileSize;
+				TUInt8* tile = dest.Tile( tileX, tileY );
+				for (TUInt32 row = 0; row < rows; ++row)
+				{
+					TUInt8* outPixel = tile + row * kTileSize * 4;
+					TUInt32 y = y0 + row;
+					__m128 v = _mm_set1_ps( (y + 0.5f) * invHeight );
+					for (TUInt32 x = x0; x < xEnd; x += 4)
+					{
+						__m128 u = _mm_mul_ps( _mm_add_ps( _mm_set1_ps( static_cast<TFloat32>(x) ), pixelCentres ), invWidth );
+						TUInt32 count = (xEnd - x < 4) ? xEnd - x : 4;
+						shader( u, v, x, y, count, colours );
+						for (TUInt32 i = 0; i < count; ++i)
+						{
+							StoreOpaque( outPixel, colours[i] );
+							outPixel += 4;
+						}
+					}
+				}
+			}
+		}
+	}, 2 );
+}
+
+// Line ring versions of RunShader and RunShader4, covering only the rows in the destination's
+// band (see CLineRing). Bands are short, so threads take fewer rows each than for a whole image
+template <class TShader>
+void RunShader( CLineRing& dest, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const TFloat32 invWidth = 1.0f / dest.Width();
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	ParallelFor( dest.BandBegin(), dest.BandEnd(), [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			TUInt8* outPixel = dest.Row( y );
+			TFloat32 v = (y + 0.5f) * invHeight;
+			for (TUInt32 x = 0; x < width; ++x)
+			{
+				StoreOpaque( outPixel, shader( (x + 0.5f) * invWidth, v, x, y ) );
+				outPixel += 4;
+			}
+		}
+	}, 4 );
+}
+
+template <class TShader>
+void RunShader4( CLineRing& dest, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const __m128 invWidth = _mm_set1_ps( 1.0f / dest.Width() );
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	const __m128 pixelCentres = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+	ParallelFor( dest.BandBegin(), dest.BandEnd(), [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		__m128 colours[4];
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			TUInt8* outPixel = dest.Row( y );
+			__m128 v = _mm_set1_ps( (y + 0.5f) * invHeight );
+			for (TUInt32 x = 0; x < width; x += 4)
+			{
+				__m128 u = _mm_mul_ps( _mm_add_ps( _mm_set1_ps( static_cast<TFloat32>(x) ), pixelCentres ), invWidth );
+				TUInt32 count = (width - x < 4) ? width - x : 4;
+				shader( u, v, x, y, count, colours );
+				for (TUInt32 i = 0; i < count; ++i)
+				{
+					StoreOpaque( outPixel, colours[i] );
+					outPixel += 4;
+				}
+			}
+		}
+	}, 4 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Filters
+//-----------------------------------------------------------------------------
+
+// Each filter follows the matching pixel shader in PostProcess.fx. For full screen processing
+// the area UVs and scene UVs are the same and the area is the whole screen
+
+void FilterCopy( const CImage& source, CImage& dest )
+{
+	dest.CopyFrom( source );
+	for (TUInt32 y = 0; y < dest.Height(); ++y)
+	{
+		TUInt8* alpha = dest.Row( y ) + 3;
+		for (TUInt32 x = 0; x < dest.Width(); ++x)
+		{
+			*alpha = 255;
+			alpha += 4;
+		}
+	}
+}
+
+void FilterCopy( const CTiledImage& source, CTiledImage& dest )
+{
+	// Padding pixels in edge tiles are undefined, setting their alpha as well does no harm
+	dest.CopyFrom( source );
+	TUInt8* alpha = dest.Tile( 0, 0 ) + 3;
+	for (TUInt32 i = 0; i < dest.TilesX() * dest.TilesY() * kTileSize * kTileSize; ++i)
+	{
+		*alpha = 255;
+		alpha += 4;
+	}
+}
+
+void FilterCopy( const CLineRing& source, CLineRing& dest )
+{
+	for (TUInt32 y = dest.BandBegin(); y < dest.BandEnd(); ++y)
+	{
+		memcpy( dest.Row( y ), source.Row( y ), dest.Width() * 4 );
+		TUInt8* alpha = dest.Row( y ) + 3;
+		for (TUInt32 x = 0; x < dest.Width(); ++x)
+		{
+			*alpha = 255;
+			alpha += 4;
+		}
+	}
+}
+
+template <class TImage>
+void FilterTint( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const __m128 tint = _mm_set_ps( 1.0f, params.TintColour[2], params.TintColour[1], params.TintColour[0] );
+	RunShader( dest, [&]( TFloat32, TFloat32, TUInt32 x, TUInt32 y )
+	{
+		return _mm_mul_ps( LoadPixelSSE( source.Pixel( x, y ) ), tint );
+	});
+}
+
+template <class TImage>
+void FilterGreyNoise( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const TFloat32 NoiseStrength = 0.5f;
+	const TFloat32 softEdge = 0.05f;
+	const CImage& noiseMap = *params.NoiseMap;
+	vector<SCircleSpan> spans;
+	SoftCircleSpans( dest.Width(), dest.Height(), softEdge, spans );
+	RunShader( dest, [&]( TFloat32 u, TFloat32 v, TUInt32 x, TUInt32 y )
+	{
+		// Outside the circle the scene is unchanged
+		__m128 scene = LoadPixelSSE( source.Pixel( x, y ) );
+		ECircleCoverage coverage = CircleCoverage( spans[y], x, 1 );
+		if (coverage == kCircleOutside) return scene;
+
+		GEN_ALIGN(16) TFloat32 texColour[4];
+		_mm_store_ps( texColour, scene );
+		TFloat32 grey = (texColour[0] + texColour[1] + texColour[2]) / 3.0f;
+
+		GEN_ALIGN(16) TFloat32 noise[4];
+		_mm_store_ps( noise, SampleBilinear( noiseMap, u * params.NoiseScale[0] + params.NoiseOffset[0],
+		                                               v * params.NoiseScale[1] + params.NoiseOffset[1], true ) );
+		grey += NoiseStrength * (noise[0] - 127.5f);
+
+		TFloat32 alpha = (coverage == kCircleInside) ? 1.0f : SoftCircleAlpha( u, v, softEdge );
+		return LerpSSE( scene, _mm_set1_ps( grey ), alpha );
+	});
+}
+
+template <class TImage>
+void FilterBurn( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const __m128 White = _mm_set1_ps( 255.0f );
+	const __m128 BurnColour = _mm_set_ps( 1.0f, 0.0f, 0.4f, 0.8f );
+	const __m128 GlowColour = _mm_set_ps( 255.0f, 0.0f, 0.8f * 255.0f, 255.0f );
+	const TFloat32 GlowAmount = 0.15f;
+	const TFloat32 Crinkle = 0.1f;
+	const CImage& burnMap = *params.BurnMap;
+	const TFloat32 burnLevel = params.BurnLevel;
+	const TFloat32 burnLevelMax = burnLevel + GlowAmount;
+
+	RunShader( dest, [&]( TFloat32 u, TFloat32 v, TUInt32 x, TUInt32 y )
+	{
+		GEN_ALIGN(16) TFloat32 burnTexture[4];
+		_mm_store_ps( burnTexture, _mm_mul_ps( SampleBilinear( burnMap, u, v, true ), _mm_set1_ps( 1.0f / 255.0f ) ) );
+
+		// Burnt away, untouched, or in the burning range
+		if (burnTexture[0] <= burnLevel)
+		{
+			return White;
+		}
+		if (burnTexture[0] >= burnLevelMax)
+		{
+			return LoadPixelSSE( source.Pixel( x, y ) );
+		}
+
+		TFloat32 glowLevel = 1.0f - (burnTexture[0] - burnLevel) / GlowAmount;
+		TFloat32 crinkleU = burnTexture[0] - 0.5f;
+		TFloat32 crinkleV = burnTexture[1] - 0.5f;
+		__m128 texColour = SamplePoint( source, u - glowLevel * Crinkle * crinkleU, v - glowLevel * Crinkle * crinkleV, kAddressClamp );
+
+		glowLevel *= 2.0f;
+		__m128 burnt = _mm_mul_ps( BurnColour, texColour );
+		if (glowLevel < 1.0f)
+		{
+			return LerpSSE( texColour, burnt, glowLevel );
+		}
+		return LerpSSE( burnt, GlowColour, glowLevel - 1.0f );
+	});
+}
+
+// One pixel of Distort, shared with the temporal mode
+template <class TImage>
+inline __m128 DistortPixel( const TImage& source, const CImage& distortMap, TFloat32 distortLevel, TFloat32 u, TFloat32 v )
+{
+	const TFloat32 LightStrength = 0.025f * 255.0f;
+	GEN_ALIGN(16) TFloat32 distortTexture[4];
+	_mm_store_ps( distortTexture, _mm_mul_ps( SampleBilinear( distortMap, u, v, true ), _mm_set1_ps( 1.0f / 255.0f ) ) );
+	TFloat32 distortU = distortTexture[0] - 0.5f;
+	TFloat32 distortV = distortTexture[1] - 0.5f;
+
+	// Fake diffuse light from the top-left. A zero vector has no direction so gets no light
+	TFloat32 length = sqrtf( distortU * distortU + distortV * distortV );
+	TFloat32 light = (length > 0.0f) ? (distortU + distortV) * 0.707f / length * LightStrength : 0.0f;
+
+	__m128 colour = SampleBilinear( source, u + distortLevel * distortU, v + distortLevel * distortV );
+	return _mm_add_ps( colour, _mm_set1_ps( light ) );
+}
+
+template <class TImage>
+void FilterDistort( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const CImage& distortMap = *params.DistortMap;
+	RunShader( dest, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+	{
+		return DistortPixel( source, distortMap, params.DistortLevel, u, v );
+	});
+}
+
+// The warp filters (Spiral, HeatHaze, Ripple) work out their sample positions four pixels at a
+// time with the approximations in FastMathSSE.h, then sample each pixel. Over the ranges the
+// animation drives, sample positions are within 6e-6 UV of a double precision calculation
+// (Spiral, where the angle magnifies the length error) or 1e-7 UV (HeatHaze, Ripple), a fiftieth
+// of a pixel at 3840 wide. Output only differs from libm maths where a position is on the edge
+// of a texel
+
+template <class TImage>
+void FilterSpiral( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	// Angles reach 0.71 * 8^2 = 45 radians as the shaped timer is 0->8
+	const TFloat32 softEdge = 0.05f;
+	const __m128 half = _mm_set1_ps( 0.5f );
+	const __m128 spiralSq = _mm_set1_ps( params.SpiralTimer * params.SpiralTimer );
+	vector<SCircleSpan> spans;
+	SoftCircleSpans( dest.Width(), dest.Height(), softEdge, spans );
+	RunShader4( dest, [&]( __m128 u, __m128 v, TUInt32 x, TUInt32 y, TUInt32 count, __m128* colours )
+	{
+		// Outside the circle the scene is unchanged
+		ECircleCoverage coverage = CircleCoverage( spans[y], x, count );
+		if (coverage == kCircleOutside)
+		{
+			for (TUInt32 i = 0; i < count; ++i)
+			{
+				colours[i] = LoadPixelSSE( source.Pixel( x + i, y ) );
+			}
+			return;
+		}
+
+		// Rotate the offset from the centre by an angle increasing with distance
+		__m128 offsetU = _mm_sub_ps( u, half );
+		__m128 offsetV = _mm_sub_ps( v, half );
+		__m128 s, c;
+		SinCosSSE( _mm_mul_ps( LengthSSE( offsetU, offsetV ), spiralSq ), s, c );
+
+		GEN_ALIGN(16) TFloat32 sampleU[4];
+		GEN_ALIGN(16) TFloat32 sampleV[4];
+		GEN_ALIGN(16) TFloat32 alpha[4];
+		_mm_store_ps( sampleU, _mm_add_ps( half, _mm_sub_ps( _mm_mul_ps( offsetU, c ), _mm_mul_ps( offsetV, s ) ) ) );
+		_mm_store_ps( sampleV, _mm_add_ps( half, _mm_add_ps( _mm_mul_ps( offsetU, s ), _mm_mul_ps( offsetV, c ) ) ) );
+		_mm_store_ps( alpha, (coverage == kCircleInside) ? _mm_set1_ps( 1.0f ) : SoftCircleAlphaSSE( offsetU, offsetV, softEdge ) );
+		for (TUInt32 i = 0; i < count; ++i)
+		{
+			__m128 colour = SampleBilinear( source, sampleU[i], sampleV[i] );
+			colours[i] = LerpSSE( LoadPixelSSE( source.Pixel( x + i, y ) ), colour, alpha[i] );
+		}
+	});
+}
+
+template <class TImage>
+void FilterHeatHaze( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const TFloat32 EffectStrength = 0.02f;
+	const TFloat32 softEdge = 0.15f;
+	const __m128 Radians1440 = _mm_set1_ps( 25.13274123f );
+	const __m128 Radians3600 = _mm_set1_ps( 62.83185307f );
+	const __m128 half = _mm_set1_ps( 0.5f );
+
+	// The timer grows without limit, so wrap the phases to keep the angles below 70 radians
+	const __m128 phaseX = _mm_set1_ps( static_cast<TFloat32>(fmod( static_cast<TFloat64>(params.HeatHazeTimer), 6.283185307179586 )) );
+	const __m128 phaseY = _mm_set1_ps( static_cast<TFloat32>(fmod( params.HeatHazeTimer * 0.7, 6.283185307179586 )) );
+	vector<SCircleSpan> spans;
+	SoftCircleSpans( dest.Width(), dest.Height(), softEdge, spans );
+	RunShader4( dest, [&]( __m128 u, __m128 v, TUInt32 x, TUInt32 y, TUInt32 count, __m128* colours )
+	{
+		// Outside the circle the scene is unchanged
+		ECircleCoverage coverage = CircleCoverage( spans[y], x, count );
+		if (coverage == kCircleOutside)
+		{
+			for (TUInt32 i = 0; i < count; ++i)
+			{
+				colours[i] = LoadPixelSSE( source.Pixel( x + i, y ) );
+			}
+			return;
+		}
+		__m128 alpha = (coverage == kCircleInside) ? _mm_set1_ps( 1.0f ) : SoftCircleAlphaSSE( _mm_sub_ps( u, half ), _mm_sub_ps( v, half ), softEdge );
+
+		// Haze is a combination of sine waves in x and y
+		__m128 sinX = SinSSE( _mm_add_ps( _mm_mul_ps( u, Radians1440 ), phaseX ) );
+		__m128 sinY = SinSSE( _mm_add_ps( _mm_mul_ps( v, Radians3600 ), phaseY ) );
+		__m128 hazeScale = _mm_mul_ps( _mm_set1_ps( EffectStrength ), alpha );
+
+		GEN_ALIGN(16) TFloat32 sampleU[4];
+		GEN_ALIGN(16) TFloat32 sampleV[4];
+		GEN_ALIGN(16) TFloat32 blend[4];
+		_mm_store_ps( sampleU, _mm_add_ps( u, _mm_mul_ps( sinY, hazeScale ) ) );
+		_mm_store_ps( sampleV, _mm_add_ps( v, _mm_mul_ps( sinX, hazeScale ) ) );
+		__m128 hazeAlpha = _mm_add_ps( _mm_mul_ps( _mm_mul_ps( sinX, sinY ), _mm_set1_ps( 0.33f ) ), _mm_set1_ps( 0.55f ) );
+		hazeAlpha = _mm_min_ps( _mm_max_ps( hazeAlpha, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) );
+		_mm_store_ps( blend, _mm_mul_ps( alpha, hazeAlpha ) );
+		for (TUInt32 i = 0; i < count; ++i)
+		{
+			__m128 colour = SampleBilinear( source, sampleU[i], sampleV[i] );
+			colours[i] = LerpSSE( LoadPixelSSE( source.Pixel( x + i, y ) ), colour, blend[i] );
+		}
+	});
+}
+
+// One pass of the Gaussian blur: nine bilinear taps centred on the UV, stepping by the given UV
+// offset. Shared with the temporal mode
+template <class TImage>
+inline __m128 BlurTaps( const TImage& image, TFloat32 u, TFloat32 v, TFloat32 stepU, TFloat32 stepV )
+{
+	const TFloat32 BlurWeights[5] = { 0.2270270270f, 0.1945945946f, 0.1216216216f, 0.0540540541f, 0.0162162162f };
+	__m128 colour = _mm_mul_ps( SampleBilinear( image, u, v ), _mm_set1_ps( BlurWeights[0] ) );
+	for (int i = 1; i < 5; ++i)
+	{
+		__m128 taps = _mm_add_ps( SampleBilinear( image, u + stepU * i, v + stepV * i ), SampleBilinear( image, u - stepU * i, v - stepV * i ) );
+		colour = _mm_add_ps( colour, _mm_mul_ps( taps, _mm_set1_ps( BlurWeights[i] ) ) );
+	}
+	return colour;
+}
+
+// UV step of each blur pass
+template <class TImage>
+inline void BlurOffsets( const TImage& source, const SFilterParams& params, TFloat32& offsetU, TFloat32& offsetV )
+{
+	const TFloat32 baseOffset = 0.0005f * params.BlurStrength;
+	offsetU = baseOffset;
+	offsetV = baseOffset * source.Height() / source.Width();
+}
+
+// One pass of the Gaussian blur over the whole destination, 0 horizontal or 1 vertical
+template <class TImage>
+void FilterGaussianBlurPass( const TImage& source, TImage& dest, const SFilterParams& params, TUInt32 pass )
+{
+	TFloat32 offsetU, offsetV;
+	BlurOffsets( source, params, offsetU, offsetV );
+	if (pass == 0)
+	{
+		RunShader( dest, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+		{
+			return BlurTaps( source, u, v, offsetU, 0.0f );
+		});
+	}
+	else
+	{
+		RunShader( dest, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+		{
+			return BlurTaps( source, u, v, 0.0f, offsetV );
+		});
+	}
+}
+
+// Two passes as in the shader technique, the first writing to the multipass image. The shader's
+// second pass steps horizontally again (by the height-scaled offset), here it steps vertically
+// as intended
+template <class TImage>
+bool FilterGaussianBlur( const TImage& source, TImage& dest, const SFilterParams& params, TImage& multipass )
+{
+	if (!multipass.Create( source.Width(), source.Height() )) return false;
+	FilterGaussianBlurPass( source, multipass, params, 0 );
+	FilterGaussianBlurPass( multipass, dest, params, 1 );
+	return true;
+}
+
+// Ripples are binned into square tiles of the destination, each with a bit mask of the ripples
+// whose rings reach any pixel centre in it. The tiles are a multiple of four pixels wide, so a
+// RunShader4 group is always within one (in either layout). A ring is 0.1 UV wide, so each
+// tile sees few ripples however many there are
+const TUInt32 kRippleBinShift = 5;
+
+// Fill the bins for the ripples in the parameters, binsX across
+void BinRipples( const SFilterParams& params, TUInt32 width, TUInt32 height, TFloat32 ringHalfWidth, vector<TUInt32>& bins, TUInt32& binsX )
+{
+	// A little extra width covers the approximations used for the distance
+	const TFloat32 Margin = 1e-4f;
+	binsX = ((width - 1) >> kRippleBinShift) + 1;
+	const TUInt32 binsY = ((height - 1) >> kRippleBinShift) + 1;
+	bins.assign( binsX * binsY, 0 );
+	for (TUInt32 i = 0; i < params.NumRipples; ++i)
+	{
+		const SRipple& ripple = params.Ripples[i];
+		const TFloat32 centreU = ripple.Position[0] / width;
+		const TFloat32 centreV = ripple.Position[1] / height;
+		const TFloat32 ringInner = ripple.Time - ringHalfWidth - Margin;
+		const TFloat32 ringOuter = ripple.Time + ringHalfWidth + Margin;
+		for (TUInt32 binY = 0; binY < binsY; ++binY)
+		{
+			// UVs of the first and last pixel centres in the bin
+			TUInt32 y0 = binY << kRippleBinShift;
+			TUInt32 y1 = min( y0 + (1 << kRippleBinShift), height ) - 1;
+			TFloat32 v0 = (y0 + 0.5f) / height - centreV;
+			TFloat32 v1 = (y1 + 0.5f) / height - centreV;
+			TFloat32 nearV = (v0 > 0.0f) ? v0 : ((v1 < 0.0f) ? -v1 : 0.0f);
+			TFloat32 farV = max( fabsf( v0 ), fabsf( v1 ) );
+			for (TUInt32 binX = 0; binX < binsX; ++binX)
+			{
+				TUInt32 x0 = binX << kRippleBinShift;
+				TUInt32 x1 = min( x0 + (1 << kRippleBinShift), width ) - 1;
+				TFloat32 u0 = (x0 + 0.5f) / width - centreU;
+				TFloat32 u1 = (x1 + 0.5f) / width - centreU;
+				TFloat32 nearU = (u0 > 0.0f) ? u0 : ((u1 < 0.0f) ? -u1 : 0.0f);
+				TFloat32 farU = max( fabsf( u0 ), fabsf( u1 ) );
+
+				// The ring reaches the bin if it overlaps the range of distances of its pixels
+				TFloat32 nearest = sqrtf( nearU * nearU + nearV * nearV );
+				TFloat32 furthest = sqrtf( farU * farU + farV * farV );
+				if (nearest <= ringOuter && furthest >= ringInner)
+				{
+					bins[binY * binsX + binX] |= 1u << i;
+				}
+			}
+		}
+	}
+}
+
+// Any number of ripples (up to kMaxRipples) in one pass. Each pixel adds up the displacements of
+// the rings in its bin, so the cost follows the area the rings cover rather than their number,
+// and pixels no ring reaches are copied. A single ripple gives the same result as the shader
+template <class TImage>
+void FilterRipple( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const TFloat32 shockParams[3] = { 0.1f, 0.1f, 0.05f };
+	vector<TUInt32> bins;
+	TUInt32 binsX;
+	BinRipples( params, dest.Width(), dest.Height(), shockParams[2], bins, binsX );
+
+	__m128 centreU[kMaxRipples];
+	__m128 centreV[kMaxRipples];
+	__m128 rippleTime[kMaxRipples];
+	for (TUInt32 i = 0; i < params.NumRipples; ++i)
+	{
+		centreU[i] = _mm_set1_ps( params.Ripples[i].Position[0] / source.Width() );
+		centreV[i] = _mm_set1_ps( params.Ripples[i].Position[1] / source.Height() );
+		rippleTime[i] = _mm_set1_ps( params.Ripples[i].Time );
+	}
+
+	RunShader4( dest, [&]( __m128 u, __m128 v, TUInt32 x, TUInt32 y, TUInt32 count, __m128* colours )
+	{
+		TUInt32 rippleMask = bins[(y >> kRippleBinShift) * binsX + (x >> kRippleBinShift)];
+		if (!rippleMask)
+		{
+			for (TUInt32 i = 0; i < count; ++i)
+			{
+				colours[i] = LoadPixelSSE( source.Pixel( x + i, y ) );
+			}
+			return;
+		}
+
+		__m128 sampleU = u;
+		__m128 sampleV = v;
+		for (TUInt32 ripple = 0; rippleMask; ++ripple, rippleMask >>= 1)
+		{
+			if (!(rippleMask & 1)) continue;
+			__m128 directionU = _mm_sub_ps( u, centreU[ripple] );
+			__m128 directionV = _mm_sub_ps( v, centreV[ripple] );
+			__m128 distanceToCentre = NormaliseSSE( directionU, directionV );
+
+			// Pixels within the ring sample from further along the radius. The pow argument is at
+			// most 0.005 (diff * 0.1) and is only evaluated if a pixel is in the ring
+			__m128 diff = _mm_sub_ps( distanceToCentre, rippleTime[ripple] );
+			__m128 inRing = _mm_and_ps( _mm_cmple_ps( AbsSSE( diff ), _mm_set1_ps( shockParams[2] ) ),
+			                            _mm_cmpgt_ps( distanceToCentre, _mm_setzero_ps() ) );
+			if (_mm_movemask_ps( inRing ))
+			{
+				__m128 powDiff = _mm_sub_ps( _mm_set1_ps( 1.0f ),
+				                             PowUnitSSE( AbsSSE( _mm_mul_ps( diff, _mm_set1_ps( shockParams[0] ) ) ), _mm_set1_ps( shockParams[1] ) ) );
+				__m128 shift = _mm_and_ps( inRing, _mm_mul_ps( diff, powDiff ) );
+				sampleU = _mm_add_ps( sampleU, _mm_mul_ps( directionU, shift ) );
+				sampleV = _mm_add_ps( sampleV, _mm_mul_ps( directionV, shift ) );
+			}
+		}
+
+		GEN_ALIGN(16) TFloat32 sampleUs[4];
+		GEN_ALIGN(16) TFloat32 sampleVs[4];
+		_mm_store_ps( sampleUs, sampleU );
+		_mm_store_ps( sampleVs, sampleV );
+		for (TUInt32 i = 0; i < count; ++i)
+		{
+			colours[i] = SamplePoint( source, sampleUs[i], sampleVs[i], kAddressClamp );
+		}
+	});
+}
+
+template <class TImage>
+void FilterShockwave( const TImage& source, TImage& dest, const SFilterParams& params )
+{
+	const TFloat32 offsetU = params.ShockwaveSin;
+	const TFloat32 offsetV = params.ShockwaveSin * source.Height() / source.Width();
+	RunShader( dest, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+	{
+		return SamplePoint( source, u + offsetU, v + offsetV, kAddressBorder );
+	});
+}
+
+template <class TImage>
+void FilterNegative( const TImage& source, TImage& dest )
+{
+	const __m128 white = _mm_set1_ps( 255.0f );
+	RunShader( dest, [&]( TFloat32, TFloat32, TUInt32 x, TUInt32 y )
+	{
+		return _mm_sub_ps( white, LoadPixelSSE( source.Pixel( x, y ) ) );
+	});
+}
+
+
+// The CPU only filters are convolutions with the standard kernels. Each is 3x3 so reads one row
+// either side, within the reach FilterRowReach gives every filter
+CConvolutionKernel FilterKernel( EPostProcessFilter filter )
+{
+	switch (filter)
+	{
+		case kFilterSharpen:    return SharpenKernel();
+		case kFilterEdgeDetect: return EdgeDetectKernel();
+		case kFilterEmboss:     return EmbossKernel();
+		default:                return CConvolutionKernel();
+	}
+}
+
+// Linear images use Convolve, which filters rows of floats held in a ring and takes the separable
+// path where the kernel allows. Optionally in linear light (see ColourSpace.h)
+void FilterConvolve( const CImage& source, CImage& dest, const CConvolutionKernel& kernel, bool linearLight )
+{
+	Convolve( source, dest, kernel, kAddressClamp, linearLight );
+}
+
+// Other layouts apply the kernel a pixel at a time with clamped addressing. Taps are accumulated
+// in the same order as Convolve's 2D path, so for non-separable kernels the results are identical.
+// In linear light the result is encoded here, the round trip through a pixel is exact
+template <class TImage>
+void FilterConvolve( const TImage& source, TImage& dest, const CConvolutionKernel& kernel, bool linearLight )
+{
+	const TInt32 maxX = static_cast<TInt32>(source.Width()) - 1;
+	const TInt32 maxY = static_cast<TInt32>(source.Height()) - 1;
+	const TInt32 kernelWidth = static_cast<TInt32>(kernel.Width());
+	const TInt32 kernelHeight = static_cast<TInt32>(kernel.Height());
+	const TInt32 anchorX = (kernelWidth - 1) / 2;
+	const TInt32 anchorY = (kernelHeight - 1) / 2;
+	const __m128 bias = _mm_set1_ps( kernel.Bias() );
+	RunShader( dest, [&]( TFloat32, TFloat32, TUInt32 x, TUInt32 y )
+	{
+		__m128 acc = bias;
+		const TFloat32* weights = kernel.Weights();
+		for (TInt32 r = 0; r < kernelHeight; ++r)
+		{
+			TInt32 sourceY = static_cast<TInt32>(y) + r - anchorY;
+			sourceY = (sourceY < 0) ? 0 : ((sourceY > maxY) ? maxY : sourceY);
+			for (TInt32 c = 0; c < kernelWidth; ++c)
+			{
+				TInt32 sourceX = static_cast<TInt32>(x) + c - anchorX;
+				sourceX = (sourceX < 0) ? 0 : ((sourceX > maxX) ? maxX : sourceX);
+				const TUInt8* pixel = source.Pixel( sourceX, sourceY );
+				__m128 colour = linearLight ? LoadPixelLinearSSE( pixel ) : LoadPixelSSE( pixel );
+				acc = _mm_add_ps( acc, _mm_mul_ps( _mm_set1_ps( *weights++ ), colour ) );
+			}
+		}
+		if (!linearLight) return acc;
+
+		TUInt8 encoded[4];
+		StorePixelLinearSSE( encoded, acc );
+		return LoadPixelSSE( encoded );
+	});
+}
+
+
+// FocusBlur is a variable radius box blur from a summed-area table, the radius rising from zero
+// around the focus point. Each of its passes is one box blur, reading up to FocusBlurRadius rows
+// either side. Filling the radius map for a band of rows gives the same radii as for the whole
+// image
+void FocusRadii( const SFilterParams& params, TUInt32 width, TUInt32 rowBegin, TUInt32 rowEnd, vector<TUInt8>& radii )
+{
+	radii.resize( static_cast<size_t>(width) * (rowEnd - rowBegin) );
+	BuildFocusRadiusMap( &radii[0], width, rowEnd - rowBegin, params.FocusCentre[0], params.FocusCentre[1],
+	                     params.FocusRadius, params.FocusFalloff, static_cast<TUInt8>(params.FocusBlurRadius), rowBegin );
+}
+
+// Set the alpha of a row of pixels to 1, the box blur averages alpha as the other channels
+inline void OpaqueRow( TUInt8* row, TUInt32 width )
+{
+	for (TUInt32 x = 0; x < width; ++x)
+	{
+		row[x * 4 + 3] = 255;
+	}
+}
+
+bool FilterFocusBlur( const CImage& source, CImage& dest, const SFilterParams& params )
+{
+	vector<TUInt8> radii;
+	FocusRadii( params, source.Width(), 0, source.Height(), radii );
+	VariableBoxBlur( source, dest, &radii[0], kFocusBlurIterations );
+	for (TUInt32 y = 0; y < dest.Height(); ++y)
+	{
+		OpaqueRow( dest.Row( y ), dest.Width() );
+	}
+	return true;
+}
+
+// The table needs rows in the linear layout, so tiled images are converted each way
+bool FilterFocusBlur( const CTiledImage& source, CTiledImage& dest, const SFilterParams& params )
+{
+	CImage linearSource, linearDest;
+	return source.ToLinear( linearSource ) && FilterFocusBlur( linearSource, linearDest, params ) &&
+	       dest.FromLinear( linearDest );
+}
+
+// One box blur over the band, from a table of the rows the band's boxes reach
+bool FilterFocusBlurPass( const CLineRing& source, CLineRing& dest, const SFilterParams& params )
+{
+	const TUInt32 width = dest.Width();
+	const TUInt32 height = dest.Height();
+	const TUInt32 reach = params.FocusBlurRadius;
+	TUInt32 firstRow = (dest.BandBegin() > reach) ? dest.BandBegin() - reach : 0;
+	TUInt32 endRow = (dest.BandEnd() + reach < height) ? dest.BandEnd() + reach : height;
+
+	CImage rows;
+	if (!rows.Create( width, endRow - firstRow )) return false;
+	for (TUInt32 y = firstRow; y < endRow; ++y)
+	{
+		memcpy( rows.Row( y - firstRow ), source.Row( y ), width * 4 );
+	}
+	CSummedAreaTable table;
+	if (!table.Build( rows )) return false;
+
+	vector<TUInt8> radii;
+	FocusRadii( params, width, dest.BandBegin(), dest.BandEnd(), radii );
+	ParallelFor( dest.BandBegin(), dest.BandEnd(), [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			VariableBoxRow( table, firstRow, height, y, &radii[(y - dest.BandBegin()) * width], dest.Row( y ) );
+			OpaqueRow( dest.Row( y ), width );
+		}
+	}, 4 );
+	return true;
+}
+
+
+// Apply a full screen post-process to the source image writing to the destination image, which
+// is resized to match. Source and destination must differ. Effects that alpha blend in the app
+// (GreyNoise, Spiral, HeatHaze) are blended over the source. Output alpha is 1. Returns false if
+// a required map is missing or on memory failure. Shared by both image layouts
+template <class TImage>
+bool ApplyFilterToLayout
+(
+	EPostProcessFilter   filter,
+	const TImage&        source,
+	TImage&              dest,
+	const SFilterParams& params
+)
+{
+	if (source.IsEmpty() || &source == &dest) return false;
+	if (!dest.Create( source.Width(), source.Height() )) return false;
+
+	switch (filter)
+	{
+		case kFilterCopy:         FilterCopy( source, dest ); break;
+		case kFilterTint:         FilterTint( source, dest, params ); break;
+		case kFilterGreyNoise:
+			if (!params.NoiseMap || params.NoiseMap->IsEmpty()) return false;
+			FilterGreyNoise( source, dest, params );
+			break;
+		case kFilterBurn:
+			if (!params.BurnMap || params.BurnMap->IsEmpty()) return false;
+			FilterBurn( source, dest, params );
+			break;
+		case kFilterDistort:
+			if (!params.DistortMap || params.DistortMap->IsEmpty()) return false;
+			FilterDistort( source, dest, params );
+			break;
+		case kFilterSpiral:       FilterSpiral( source, dest, params ); break;
+		case kFilterHeatHaze:     FilterHeatHaze( source, dest, params ); break;
+		case kFilterGaussianBlur:
+		{
+			TImage multipass;
+			return FilterGaussianBlur( source, dest, params, multipass );
+		}
+		case kFilterRipple:       FilterRipple( source, dest, params ); break;
+		case kFilterShockwave:    FilterShockwave( source, dest, params ); break;
+		case kFilterNegative:     FilterNegative( source, dest ); break;
+		case kFilterSharpen:
+		case kFilterEdgeDetect:
+		case kFilterEmboss:       FilterConvolve( source, dest, FilterKernel( filter ), params.LinearLight ); break;
+		case kFilterFocusBlur:    return FilterFocusBlur( source, dest, params );
+		default:                  return false;
+	}
+	return true;
+}
+
+// ApplyFilter for each image layout
+bool ApplyFilter
+(
+	EPostProcessFilter   filter,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params
+)
+{
+	return ApplyFilterToLayout( filter, source, dest, params );
+}
+
+bool ApplyFilter
+(
+	EPostProcessFilter   filter,
+	const CTiledImage&   source,
+	CTiledImage&         dest,
+	const SFilterParams& params
+)
+{
+	return ApplyFilterToLayout( filter, source, dest, params );
+}
+
+
+//-----------------------------------------------------------------------------
+// Streaming
+//-----------------------------------------------------------------------------
+
+// Number of passes a filter makes over the image, each of which reads the previous pass's output
+// (or the filter's source). GaussianBlur has two, FocusBlur kFocusBlurIterations, the others one
+TUInt32 FilterPasses( EPostProcessFilter filter )
+{
+	switch (filter)
+	{
+		case kFilterGaussianBlur: return 2;
+		case kFilterFocusBlur:    return kFocusBlurIterations;
+		default:                  return 1;
+	}
+}
+
+// Rows of a pass's input either side of an output row that the pass may read, for the given
+// parameters and image size. Found from the largest vertical UV offset of each filter's samples
+// (the constants match those in the filters above), plus a row for bilinear filtering and one
+// for rounding. Limited to the height - Spiral rotates about the centre so may read any row
+TUInt32 FilterRowReach( EPostProcessFilter filter, TUInt32 pass, const SFilterParams& params, TUInt32 width, TUInt32 height )
+{
+	TFloat32 offset = 0.0f;
+	switch (filter)
+	{
+		case kFilterBurn:         offset = 0.1f * 0.5f; break;             // Crinkle * largest map offset
+		case kFilterDistort:      offset = fabsf( params.DistortLevel ) * 0.5f; break;
+		case kFilterSpiral:       return height;
+		case kFilterHeatHaze:     offset = 0.02f; break;                    // EffectStrength
+		case kFilterGaussianBlur:
+			if (pass == 1) offset = 4.0f * 0.0005f * fabsf( params.BlurStrength ) * height / width;
+			break;
+		case kFilterRipple:       offset = 0.05f * params.NumRipples; break; // Ring half width each, the pow term is <= 1
+		case kFilterShockwave:    offset = fabsf( params.ShockwaveSin ) * height / width; break;
+		case kFilterFocusBlur:    return (params.FocusBlurRadius < height) ? params.FocusBlurRadius : height;
+		default:                  break;
+	}
+	TFloat32 rows = ceilf( offset * height ) + 2.0f;
+	return (rows < static_cast<TFloat32>(height)) ? static_cast<TUInt32>(rows) : height;
+}
+
+// Run one pass of a filter over the rows in the destination's band. The source must hold the
+// band's rows and FilterRowReach rows either side of it (within the image) and be the size of
+// the destination. Output matches the same rows of ApplyFilter. Returns false if a required map
+// is missing
+bool ApplyFilterPass
+(
+	EPostProcessFilter   filter,
+	TUInt32              pass,
+	const CLineRing&     source,
+	CLineRing&           dest,
+	const SFilterParams& params
+)
+{
+	if (source.IsEmpty() || dest.IsEmpty() || &source == &dest) return false;
+
+	switch (filter)
+	{
+		case kFilterCopy:         FilterCopy( source, dest ); break;
+		case kFilterTint:         FilterTint( source, dest, params ); break;
+		case kFilterGreyNoise:
+			if (!params.NoiseMap || params.NoiseMap->IsEmpty()) return false;
+			FilterGreyNoise( source, dest, params );
+			break;
+		case kFilterBurn:
+			if (!params.BurnMap || params.BurnMap->IsEmpty()) return false;
+			FilterBurn( source, dest, params );
+			break;
+		case kFilterDistort:
+			if (!params.DistortMap || params.DistortMap->IsEmpty()) return false;
+			FilterDistort( source, dest, params );
+			break;
+		case kFilterSpiral:       FilterSpiral( source, dest, params ); break;
+		case kFilterHeatHaze:     FilterHeatHaze( source, dest, params ); break;
+		case kFilterGaussianBlur: FilterGaussianBlurPass( source, dest, params, pass ); break;
+		case kFilterRipple:       FilterRipple( source, dest, params ); break;
+		case kFilterShockwave:    FilterShockwave( source, dest, params ); break;
+		case kFilterNegative:     FilterNegative( source, dest ); break;
+		case kFilterSharpen:
+		case kFilterEdgeDetect:
+		case kFilterEmboss:       FilterConvolve( source, dest, FilterKernel( filter ), params.LinearLight ); break;
+		case kFilterFocusBlur:    return FilterFocusBlurPass( source, dest, params );
+		default:                  return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Temporal filtering
+//-----------------------------------------------------------------------------
+
+SFilterHistory::SFilterHistory()
+{
+	Filter = kFilterCopy;
+	Parity = 0;
+	FullFrames = 0;
+	Valid = false;
+	PixelsComputed = PixelsReused = PixelsRejected = 0;
+}
+
+// Whether a filter has a temporal mode - the expensive neighbourhood filters, GaussianBlur and
+// Distort
+bool SupportsTemporal( EPostProcessFilter filter )
+{
+	return filter == kFilterDistort || filter == kFilterGaussianBlur;
+}
+
+// Whether the parameters used by a temporal filter are the same in both sets, so last frame's
+// output is still correct where the source has not changed
+inline bool TemporalParamsMatch( EPostProcessFilter filter, const SFilterParams& a, const SFilterParams& b )
+{
+	if (filter == kFilterDistort)
+	{
+		return a.DistortLevel == b.DistortLevel && a.DistortMap == b.DistortMap;
+	}
+	return a.BlurStrength == b.BlurStrength;
+}
+
+// Largest difference in the colour channels of two pixels
+inline TUInt32 PixelDifference( const TUInt8* a, const TUInt8* b )
+{
+	TUInt32 largest = 0;
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		TUInt32 difference = (a[channel] > b[channel]) ? a[channel] - b[channel] : b[channel] - a[channel];
+		if (difference > largest) largest = difference;
+	}
+	return largest;
+}
+
+// First pixel in a row of the half selected by parity: a checkerboard, or alternate columns
+inline TUInt32 FirstInterleaved( TUInt32 y, bool checkerboard, TUInt32 parity )
+{
+	return (parity + (checkerboard ? y : 0)) & 1;
+}
+
+// As RunShader, but only for the half of the pixels selected by parity. Others are untouched
+template <class TShader>
+void RunShaderInterleaved( CImage& dest, bool checkerboard, TUInt32 parity, TShader shader )
+{
+	const TUInt32 width = dest.Width();
+	const TFloat32 invWidth = 1.0f / dest.Width();
+	const TFloat32 invHeight = 1.0f / dest.Height();
+	ParallelFor( 0, dest.Height(), [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			TUInt8* row = dest.Row( y );
+			TFloat32 v = (y + 0.5f) * invHeight;
+			for (TUInt32 x = FirstInterleaved( y, checkerboard, parity ); x < width; x += 2)
+			{
+				StoreOpaque( row + x * 4, shader( (x + 0.5f) * invWidth, v, x, y ) );
+			}
+		}
+	});
+}
+
+// Mark the pixels in a row where any colour channel differs by more than the threshold between
+// the two rows. Four pixels at a time, with alpha ignored
+void MarkChangedPixels( const TUInt8* a, const TUInt8* b, TUInt32 width, TUInt32 threshold, TUInt8* changed )
+{
+	const TUInt32 limit = (threshold < 255) ? threshold : 255;
+	const __m128i limits = _mm_set1_epi32( static_cast<int>(0xFF000000u | (limit * 0x010101u)) );
+	const __m128i zero = _mm_setzero_si128();
+	TUInt32 x = 0;
+	for (; x + 4 <= width; x += 4)
+	{
+		__m128i pixelsA = _mm_loadu_si128( reinterpret_cast<const __m128i*>(a + x * 4) );
+		__m128i pixelsB = _mm_loadu_si128( reinterpret_cast<const __m128i*>(b + x * 4) );
+		__m128i difference = _mm_or_si128( _mm_subs_epu8( pixelsA, pixelsB ), _mm_subs_epu8( pixelsB, pixelsA ) );
+		int within = _mm_movemask_epi8( _mm_cmpeq_epi8( _mm_subs_epu8( difference, limits ), zero ) );
+		changed[x]     = (within & 0x000F) != 0x000F;
+		changed[x + 1] = (within & 0x00F0) != 0x00F0;
+		changed[x + 2] = (within & 0x0F00) != 0x0F00;
+		changed[x + 3] = (within & 0xF000) != 0xF000;
+	}
+	for (; x < width; ++x)
+	{
+		changed[x] = PixelDifference( a + x * 4, b + x * 4 ) > threshold;
+	}
+}
+
+// Fill the half of the pixels that RunShaderInterleaved skipped, copying each from the previous
+// output unless its source pixel or a recomputed neighbour (left and right, and above and below
+// for a checkerboard) has changed by more than the threshold. Rejected pixels are written by
+// calling reject( x, y, scratch ), where scratch is a working image for each thread. The numbers
+// reused and rejected are added to the history's counts
+template <class TReject>
+void FillFromHistory
+(
+	const CImage&   source,
+	CImage&         dest,
+	SFilterHistory& history,
+	bool            checkerboard,
+	TUInt32         parity,
+	TUInt32         threshold,
+	TReject         reject
+)
+{
+	const TUInt32 width = dest.Width();
+	const TUInt32 height = dest.Height();
+	atomic<TUInt64> reused( 0 ), rejected( 0 );
+	ParallelFor( 0, height, [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		// Changes in the source row and in the output rows above, on and below the current one.
+		// Output changes are only meaningful at recomputed pixels. Rows rotate as y advances
+		vector<TUInt8> changes( width * 4 );
+		TUInt8* sourceChanged = &changes[0];
+		TUInt8* outputChanged[3] = { &changes[width], &changes[width * 2], &changes[width * 3] };
+		if (checkerboard && rowBegin > 0)
+		{
+			MarkChangedPixels( dest.Row( rowBegin - 1 ), history.Output.Row( rowBegin - 1 ), width, threshold, outputChanged[1] );
+		}
+		MarkChangedPixels( dest.Row( rowBegin ), history.Output.Row( rowBegin ), width, threshold, outputChanged[2] );
+
+		CImage scratch;
+		TUInt64 chunkReused = 0, chunkRejected = 0;
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			TUInt8* rotate = outputChanged[0];
+			outputChanged[0] = outputChanged[1];
+			outputChanged[1] = outputChanged[2];
+			outputChanged[2] = rotate;
+			if (y + 1 < (checkerboard ? height : rowEnd))
+			{
+				MarkChangedPixels( dest.Row( y + 1 ), history.Output.Row( y + 1 ), width, threshold, outputChanged[2] );
+			}
+			MarkChangedPixels( source.Row( y ), history.Source.Row( y ), width, threshold, sourceChanged );
+			const TUInt8* above = (checkerboard && y > 0) ? outputChanged[0] : 0;
+			const TUInt8* current = outputChanged[1];
+			const TUInt8* below = (checkerboard && y + 1 < height) ? outputChanged[2] : 0;
+
+			TUInt8* row = dest.Row( y );
+			const TUInt8* previousRow = history.Output.Row( y );
+			for (TUInt32 x = FirstInterleaved( y, checkerboard, parity ^ 1 ); x < width; x += 2)
+			{
+				bool changed = sourceChanged[x] || (x > 0 && current[x - 1]) || (x + 1 < width && current[x + 1]) ||
+				               (above && above[x]) || (below && below[x]);
+				if (changed)
+				{
+					reject( x, y, scratch );
+					++chunkRejected;
+				}
+				else
+				{
+					memcpy( row + x * 4, previousRow + x * 4, 4 );
+					++chunkReused;
+				}
+			}
+		}
+		reused += chunkReused;
+		rejected += chunkRejected;
+	});
+	history.PixelsReused += reused;
+	history.PixelsRejected += rejected;
+}
+
+// As ApplyFilter, but for filters that support it only half of the pixels are recomputed each
+// frame, alternating halves, and the rest are taken from the previous frame's output held in
+// the history. See the header for details
+bool ApplyFilterTemporal
+(
+	EPostProcessFilter   filter,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params,
+	SFilterHistory&      history,
+	TUInt32              threshold /*= kTemporalThreshold*/
+)
+{
+	if (!SupportsTemporal( filter ))
+	{
+		history.Reset();
+		return ApplyFilter( filter, source, dest, params );
+	}
+	if (source.IsEmpty() || &source == &dest) return false;
+	if (filter == kFilterDistort && (!params.DistortMap || params.DistortMap->IsEmpty())) return false;
+
+	const TUInt32 width = source.Width();
+	const TUInt32 height = source.Height();
+	const bool reuse = history.Valid && history.FullFrames == 0 &&
+	                   history.Filter == filter && TemporalParamsMatch( filter, history.Params, params ) &&
+	                   history.Source.Width() == width && history.Source.Height() == height &&
+	                   history.Output.Width() == width && history.Output.Height() == height &&
+	                   width >= 2 && height >= 2; // So every reused pixel has a recomputed neighbour
+	history.Valid = false;
+	if (!dest.Create( width, height )) return false;
+
+	if (!reuse)
+	{
+		// Compute in full. The blur keeps its intermediate image in the history because the
+		// temporal vertical pass reads the skipped columns (with zero weight), so they must be valid
+		if (filter == kFilterDistort)
+		{
+			FilterDistort( source, dest, params );
+		}
+		else if (!FilterGaussianBlur( source, dest, params, history.Multipass ))
+		{
+			return false;
+		}
+		history.PixelsComputed += static_cast<TUInt64>(width) * height;
+		if (history.FullFrames > 0) --history.FullFrames;
+	}
+	else
+	{
+		const TUInt32 parity = history.Parity ^ 1;
+		const TFloat32 invWidth = 1.0f / width;
+		const TFloat32 invHeight = 1.0f / height;
+		const TUInt64 reusedBefore = history.PixelsReused;
+		const TUInt64 rejectedBefore = history.PixelsRejected;
+		if (filter == kFilterDistort)
+		{
+			// Checkerboard, rejected pixels are computed
+			const CImage& distortMap = *params.DistortMap;
+			RunShaderInterleaved( dest, true, parity, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+			{
+				return DistortPixel( source, distortMap, params.DistortLevel, u, v );
+			});
+			FillFromHistory( source, dest, history, true, parity, threshold, [&]( TUInt32 x, TUInt32 y, CImage& )
+			{
+				StoreOpaque( dest.Pixel( x, y ), DistortPixel( source, distortMap, params.DistortLevel, (x + 0.5f) * invWidth, (y + 0.5f) * invHeight ) );
+			});
+		}
+		else
+		{
+			// Alternate columns, so both passes only need the columns being recomputed
+			TFloat32 offsetU, offsetV;
+			BlurOffsets( source, params, offsetU, offsetV );
+			CImage& multipass = history.Multipass;
+			RunShaderInterleaved( multipass, false, parity, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+			{
+				return BlurTaps( source, u, v, offsetU, 0.0f );
+			});
+			RunShaderInterleaved( dest, false, parity, [&]( TFloat32 u, TFloat32 v, TUInt32, TUInt32 )
+			{
+				return BlurTaps( multipass, u, v, 0.0f, offsetV );
+			});
+			// A rejected pixel's column was not recomputed, so run the horizontal pass at the rows
+			// its vertical taps read into a one pixel wide image, then the vertical pass on that
+			const TInt32 reach = static_cast<TInt32>(ceilf( 4.0f * fabsf( offsetV ) * height )) + 1;
+			FillFromHistory( source, dest, history, false, parity, threshold, [&]( TUInt32 x, TUInt32 y, CImage& column )
+			{
+				if (!column.Create( 1, height ))
+				{
+					memcpy( dest.Pixel( x, y ), history.Output.Pixel( x, y ), 4 ); // Out of memory, keep last frame's pixel
+					return;
+				}
+				const TFloat32 u = (x + 0.5f) * invWidth;
+				const TInt32 rowEnd = min( static_cast<TInt32>(y) + reach, static_cast<TInt32>(height) - 1 );
+				for (TInt32 row = max( static_cast<TInt32>(y) - reach, 0 ); row <= rowEnd; ++row)
+				{
+					StoreOpaque( column.Row( row ), BlurTaps( source, u, (row + 0.5f) * invHeight, offsetU, 0.0f ) );
+				}
+				StoreOpaque( dest.Pixel( x, y ), BlurTaps( column, 0.5f, (y + 0.5f) * invHeight, 0.0f, offsetV ) );
+			});
+		}
+		const TUInt64 reused = history.PixelsReused - reusedBefore;
+		const TUInt64 rejected = history.PixelsRejected - rejectedBefore;
+		history.PixelsComputed += static_cast<TUInt64>(width) * height - reused - rejected;
+		history.Parity = parity;
+		if (rejected * 4 > reused + rejected)
+		{
+			history.FullFrames = kTemporalBackoffFrames;
+		}
+	}
+
+	// Keep this frame for the next
+	history.Source.CopyFrom( source );
+	history.Output.CopyFrom( dest );
+	history.Filter = filter;
+	history.Params = params;
+	history.Valid = true;
+	return true;
+}
+
+
+// Fill an image with smooth value noise, one independent pattern per channel, wrapping at the
+// edges. Used in place of the Noise, Burn and Distort textures when they are not available
+void BuildNoiseMap( CImage& map, TUInt32 size, TUInt32 cellSize, TUInt32 seed )
+{
+	if (cellSize == 0 || cellSize > size) cellSize = size;
+	if (!map.Create( size, size )) return;
+
+	// Random lattice values, per channel
+	const TUInt32 cells = (size + cellSize - 1) / cellSize;
+	vector<TFloat32> lattice( cells * cells * 4 );
+	TUInt32 state = seed;
+	for (size_t i = 0; i < lattice.size(); ++i)
+	{
+		state = state * 1664525u + 1013904223u;
+		lattice[i] = (state >> 8) * (255.0f / 16777216.0f);
+	}
+
+	// Smoothstep interpolation between lattice points, wrapping at the edges
+	for (TUInt32 y = 0; y < size; ++y)
+	{
+		TUInt32 cellY = y / cellSize;
+		TFloat32 fy = static_cast<TFloat32>(y % cellSize) / cellSize;
+		fy = fy * fy * (3.0f - 2.0f * fy);
+		const TFloat32* row0 = &lattice[cellY * cells * 4];
+		const TFloat32* row1 = &lattice[((cellY + 1) % cells) * cells * 4];
+		TUInt8* outPixel = map.Row( y );
+		for (TUInt32 x = 0; x < size; ++x)
+		{
+			TUInt32 cellX = x / cellSize;
+			TUInt32 nextX = (cellX + 1) % cells;
+			TFloat32 fx = static_cast<TFloat32>(x % cellSize) / cellSize;
+			fx = fx * fx * (3.0f - 2.0f * fx);
+			for (int channel = 0; channel < 4; ++channel)
+			{
+				TFloat32 top = row0[cellX * 4 + channel] + fx * (row0[nextX * 4 + channel] - row0[cellX * 4 + channel]);
+				TFloat32 bottom = row1[cellX * 4 + channel] + fx * (row1[nextX * 4 + channel] - row1[cellX * 4 + channel]);
+				*outPixel++ = static_cast<TUInt8>(top + fy * (bottom - top) + 0.5f);
+			}
+		}
+	}
+}
+
+
+} // namespace gen
@@ -0,0 +1,279 @@
+/*******************************************
+	PostProcessFilters.h
+
+	CPU versions of the full screen post-process
+	shaders in PostProcess.fx
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "Image.h"
+#include "TiledImage.h"
+#include "LineRing.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Filter types and parameters
+//-----------------------------------------------------------------------------
+
+// Full screen post-processes, in the same order as the PostProcesses enum in the main app,
+// followed by the CPU only filters that have no technique in PostProcess.fx
+enum EPostProcessFilter
+{
+	kFilterCopy,
+	kFilterTint,
+	kFilterGreyNoise,
+	kFilterBurn,
+	kFilterDistort,
+	kFilterSpiral,
+	kFilterHeatHaze,
+	kFilterGaussianBlur,
+	kFilterRipple,
+	kFilterShockwave,
+	kFilterNegative,
+	kFilterSharpen,    // Convolution with the standard kernels in Convolution.h
+	kFilterEdgeDetect,
+	kFilterEmboss,
+	kFilterFocusBlur,  // Variable radius blur away from a point in focus (SummedAreaTable.h)
+	kNumFilters
+};
+
+// Name of each filter (technique name without the "PP" prefix)
+extern const char* const FilterNames[kNumFilters];
+
+// Find a filter from its name (case insensitive). Returns false if the name is not recognised
+bool FilterFromName( const string& name, EPostProcessFilter& filter );
+
+
+// Most ripples the Ripple filter applies at once
+const TUInt32 kMaxRipples = 8;
+
+// Box blurs the FocusBlur filter makes, each a pass. Three boxes are close to a gaussian
+const TUInt32 kFocusBlurIterations = 3;
+
+// One ripple of the Ripple filter
+struct SRipple
+{
+	TFloat32 Position[2]; // Centre in pixels
+	TFloat32 Time;        // Seconds since the ripple started
+};
+
+
+// Values for the shader variables used by the post-processes, as set by SelectPostProcess. UVs
+// and positions use the same conventions as the shaders
+struct SFilterParams
+{
+	TFloat32 TintColour[3];
+	TFloat32 NoiseScale[2];
+	TFloat32 NoiseOffset[2];
+	TFloat32 DistortLevel;
+	TFloat32 BurnLevel;
+	TFloat32 SpiralTimer;     // Already shaped by SelectPostProcess, i.e. (1 - cos(t)) * 4
+	TFloat32 HeatHazeTimer;
+	TUInt32  NumRipples;        // Ripples under way, the shader has one but the CPU filter adds up several
+	SRipple  Ripples[kMaxRipples];
+	TFloat32 ShockwaveScale;
+	TFloat32 ShockwaveSin;      // Already scaled, i.e. sin(t) * scale
+	TFloat32 BlurStrength;
+	TFloat32 FocusCentre[2];    // Sharpest point in pixels
+	TFloat32 FocusRadius;       // Pixels from the centre that stay sharp
+	TFloat32 FocusFalloff;      // Pixels from the centre at which the blur is largest
+	TUInt32  FocusBlurRadius;   // Largest box radius in pixels, at most 255
+	bool     LinearLight;       // Convolution filters decode sRGB before filtering and encode after
+
+	// Special purpose maps (PostProcessMap in the shaders), required by GreyNoise, Burn and Distort
+	const CImage* NoiseMap;
+	const CImage* BurnMap;
+	const CImage* DistortMap;
+
+	SFilterParams();
+};
+
+
+//-----------------------------------------------------------------------------
+// Animation
+//-----------------------------------------------------------------------------
+
+// The time-varying post-process state from the main app. Update advances it in the same way as
+// UpdatePostProcesses (without the keyboard handling) and Select converts it to shader values in
+// the same way as SelectPostProcess. The noise offset comes from a seeded generator so that
+// batch runs are repeatable
+class CFilterAnimation
+{
+public:
+	CFilterAnimation( TUInt32 seed = 1 );
+
+	// Restart the animated values
+	void Reset();
+
+	// Restart the ripple at the given pixel position, as done by a right click in the app. Any
+	// other ripples are removed
+	void StartRipple( TFloat32 x, TFloat32 y );
+
+	// Add a ripple at the given pixel position starting after the given delay in seconds,
+	// keeping those under way. If there are already kMaxRipples the oldest is removed
+	void AddRipple( TFloat32 x, TFloat32 y, TFloat32 delay = 0.0f );
+
+	// Restart the shockwave, as done by key 3 in the app
+	void StartShockwave();
+
+	// Advance the animation by the given time in seconds
+	void Update( TFloat32 updateTime );
+
+	// False for one-shot effects that have finished (the app removes them from the filter list)
+	bool IsActive( EPostProcessFilter filter ) const;
+
+	// Fill the parameters used by the given filter for a scene of the given size
+	void Select( EPostProcessFilter filter, TUInt32 width, TUInt32 height, SFilterParams& params );
+
+	TFloat32 BurnLevel;
+	TFloat32 SpiralTimer;
+	TFloat32 HeatHazeTimer;
+	TFloat32 TintColourHSL[3];
+	TUInt32  NumRipples;
+	SRipple  Ripples[kMaxRipples]; // Time is negative for ripples yet to start
+	TFloat32 ShockwaveSin;
+	TFloat32 ShockwaveScale;
+	TFloat32 BlurStrength;
+	TFloat32 FocusCentre[2];   // In pixels, negative for the frame centre
+	TFloat32 FocusRadius;      // In pixels, 0 for a tenth of the frame height
+	TFloat32 FocusFalloff;     // In pixels, 0 for half of the frame height
+	TUInt32  FocusBlurRadius;
+	bool     LinearLight;      // Set for every filter, only the convolution filters use it
+
+private:
+	TFloat32 Random();
+
+	TUInt32 m_Seed;
+	TUInt32 m_RandomState;
+};
+
+
+//-----------------------------------------------------------------------------
+// Filters
+//-----------------------------------------------------------------------------
+
+// Apply a full screen post-process to the source image writing to the destination image, which
+// is resized to match. Source and destination must differ. Effects that alpha blend in the app
+// (GreyNoise, Spiral, HeatHaze) are blended over the source. Output alpha is 1. Returns false if
+// a required map is missing or on memory failure
+bool ApplyFilter
+(
+	EPostProcessFilter   filter,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params
+);
+
+// As above for images in the tiled layout. Results are identical to the linear version, only
+// the memory access pattern differs - see CTiledImage
+bool ApplyFilter
+(
+	EPostProcessFilter   filter,
+	const CTiledImage&   source,
+	CTiledImage&         dest,
+	const SFilterParams& params
+);
+
+
+//-----------------------------------------------------------------------------
+// Streaming
+//-----------------------------------------------------------------------------
+
+// Filters split into passes that each produce rows from a limited range of rows of their input,
+// so a chain can run down the image in strips holding only those rows (see CStripExecutor)
+
+// Number of passes a filter makes over the image, each of which reads the previous pass's output
+// (or the filter's source). GaussianBlur has two, FocusBlur kFocusBlurIterations, the others one
+TUInt32 FilterPasses( EPostProcessFilter filter );
+
+// Rows of a pass's input either side of an output row that the pass may read, for the given
+// parameters and image size. Limited to the height - Spiral may read any row
+TUInt32 FilterRowReach( EPostProcessFilter filter, TUInt32 pass, const SFilterParams& params, TUInt32 width, TUInt32 height );
+
+// Run one pass of a filter over the rows in the destination's band. The source must hold the
+// band's rows and FilterRowReach rows either side of it (within the image) and be the size of
+// the destination. Output matches the same rows of ApplyFilter. Returns false if a required map
+// is missing
+bool ApplyFilterPass
+(
+	EPostProcessFilter   filter,
+	TUInt32              pass,
+	const CLineRing&     source,
+	CLineRing&           dest,
+	const SFilterParams& params
+);
+
+
+//-----------------------------------------------------------------------------
+// Temporal filtering
+//-----------------------------------------------------------------------------
+
+// Default for the largest change in any channel (0->255) that still lets a pixel be reused
+const TUInt32 kTemporalThreshold = 8;
+
+// Frames computed in full after one where over a quarter of the pixels to reuse were rejected.
+// Rejected pixels cost more than computing them in full, so this limits the cost of a sequence
+// with too much change for the temporal mode to help
+const TUInt32 kTemporalBackoffFrames = 8;
+
+// A filter's input and output from the previous frame, kept by ApplyFilterTemporal. Use one
+// for each filter position in a chain over one sequence of frames
+struct SFilterHistory
+{
+	EPostProcessFilter Filter;
+	SFilterParams      Params;
+	CImage             Source;     // Previous input
+	CImage             Output;     // Previous output
+	CImage             Multipass;  // GaussianBlur intermediate, reused so stale columns stay valid
+	TUInt32            Parity;     // Half of the pixels recomputed last frame
+	TUInt32            FullFrames; // Frames left to compute in full after heavy rejection
+	bool               Valid;
+
+	// Pixel counts for reporting
+	TUInt64 PixelsComputed;
+	TUInt64 PixelsReused;
+	TUInt64 PixelsRejected;
+
+	SFilterHistory();
+
+	// Forget the previous frame so the next is computed in full, e.g. at a cut in the sequence
+	void Reset()
+	{
+		Valid = false;
+		FullFrames = 0;
+	}
+};
+
+// Whether a filter has a temporal mode - the expensive neighbourhood filters, GaussianBlur and
+// Distort
+bool SupportsTemporal( EPostProcessFilter filter );
+
+// As ApplyFilter, but for filters that support it only half of the pixels are recomputed each
+// frame, alternating halves, and the rest are taken from the previous frame's output held in
+// the history. Distort recomputes a checkerboard. GaussianBlur recomputes alternate columns,
+// since each of its separable passes then only needs the same columns. A reused pixel is
+// rejected if its source pixel or any recomputed neighbour changed by more than the threshold
+// since the last frame, and is then computed. The first frame, a change of size or parameters,
+// frames after heavy rejection (see kTemporalBackoffFrames) and other filters are computed in
+// full. Returns false under the same conditions as ApplyFilter
+bool ApplyFilterTemporal
+(
+	EPostProcessFilter   filter,
+	const CImage&        source,
+	CImage&              dest,
+	const SFilterParams& params,
+	SFilterHistory&      history,
+	TUInt32              threshold = kTemporalThreshold
+);
+
+
+// Fill an image with smooth value noise, one independent pattern per channel, wrapping at the
+// edges. Used in place of the Noise, Burn and Distort textures when they are not available
+void BuildNoiseMap( CImage& map, TUInt32 size, TUInt32 cellSize, TUInt32 seed );
+
+
+} // namespace gen
@@ -0,0 +1,469 @@
+/*******************************************
+	PostProcessShaders.h
+
+	C++ versions of the pixel shaders in
+	PostProcess.fx. Generated by
+	PostProcessShaderGen - do not edit
+********************************************/
+
+#pragma once
+
+#include "ShaderTypes.h"
+
+namespace gen
+{
+namespace hlsl
+{
+
+
+//-----------------------------------------------------------------------------
+// Sampler states
+//-----------------------------------------------------------------------------
+
+const SSamplerState<kSamplerPoint, kSamplerClamp> PointClamp = {};
+const SSamplerState<kSamplerPoint, kSamplerBorder> PointBorder = {};
+const SSamplerState<kSamplerLinear, kSamplerClamp> BilinearClamp = {};
+const SSamplerState<kSamplerLinear, kSamplerWrap> BilinearWrap = {};
+const SSamplerState<kSamplerLinear, kSamplerWrap> TrilinearWrap = {};
+
+
+//-----------------------------------------------------------------------------
+// Constants and structures
+//-----------------------------------------------------------------------------
+
+const float BlurWeights[5] = { 0.2270270270f, 0.1945945946f, 0.1216216216f, 0.0540540541f, 0.0162162162f };
+
+struct PS_POSTPROCESS_INPUT
+{
+	float4 ProjPos;
+	float2 UVScene;
+	float2 UVArea;
+};
+
+
+//-----------------------------------------------------------------------------
+// Shaders
+//-----------------------------------------------------------------------------
+
+// The effect's variables and translated pixel shaders. Variables are zero until set
+struct SPostProcessShaders
+{
+	float2 PPAreaTopLeft;
+	float2 PPAreaBottomRight;
+	float PPAreaDepth;
+	float3 TintColour;
+	float2 NoiseScale;
+	float2 NoiseOffset;
+	float DistortLevel;
+	float BurnLevel;
+	float SpiralTimer;
+	float HeatHazeTimer;
+	float SceneTextureWidth;
+	float SceneTextureHeight;
+	float RippleTime;
+	float2 RipplePosition;
+	float ShockwaveScale;
+	float ShockwaveSin;
+	int BlurStrength;
+	Texture2D SceneTexture;
+	Texture2D PostProcessMap;
+	Texture2D PreviousSceneTexture;
+	Texture2D MultipassTexture;
+	Texture2D FeedbackTexture;
+
+	SPostProcessShaders()
+	{
+		PPAreaTopLeft = 0;
+		PPAreaBottomRight = 0;
+		PPAreaDepth = 0;
+		TintColour = 0;
+		NoiseScale = 0;
+		NoiseOffset = 0;
+		DistortLevel = 0;
+		BurnLevel = 0;
+		SpiralTimer = 0;
+		HeatHazeTimer = 0;
+		SceneTextureWidth = 0;
+		SceneTextureHeight = 0;
+		RippleTime = 0;
+		RipplePosition = 0;
+		ShockwaveScale = 0;
+		ShockwaveSin = 0;
+		BlurStrength = 0;
+	}
+
+	// PostProcess.fx line 146
+	float4 PPCopyShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		float3 ppColour = SceneTexture.Sample( PointClamp, ppIn.UVScene );
+		return float4( ppColour, 1.0f );
+	}
+
+	// PostProcess.fx line 154
+	float4 PPTintShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		// Sample the texture colour (look at shader above) and multiply it with the tint colour (variables near top)
+		float3 ppColour = SceneTexture.Sample( PointClamp, ppIn.UVScene ) * TintColour;
+		return float4( ppColour, 1.0f );
+	}
+
+	// PostProcess.fx line 163
+	float4 PPGreyNoiseShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		const float NoiseStrength = 0.5f; // How noticable the noise is
+	
+		// Get texture colour, and average r, g & b to get a single grey value
+	    float3 texColour = SceneTexture.Sample( PointClamp, ppIn.UVScene );
+	    float grey = (texColour.x + texColour.y + texColour.z) / 3.0f;
+	    
+	    // Get noise UV by scaling and offseting texture UV. Scaling adjusts how fine the noise is.
+	    // The offset is randomised to give a constantly changing noise effect (like tv static)
+	    float2 noiseUV = ppIn.UVArea * NoiseScale + NoiseOffset;
+	    grey += NoiseStrength * (PostProcessMap.Sample( BilinearWrap, noiseUV ).x - 0.5f); // Noise can increase or decrease grey value
+	    float3 ppColour = grey;
+	
+		// Calculate alpha to display the effect in a softened circle, could use a texture rather than calculations for the same task.
+		// Uses the second set of area texture coordinates, which range from (0,0) to (1,1) over the area being processed
+		float softEdge = 0.05f; // Softness of the edge of the circle - range 0.001 (hard edge) to 0.25 (very soft)
+		float2 centreVector = ppIn.UVArea - float2(0.5f, 0.5f);
+		float centreLengthSq = dot(centreVector, centreVector);
+		float ppAlpha = 1.0f - saturate( (centreLengthSq - 0.25f + softEdge) / softEdge ); // Soft circle calculation based on fact that this circle has a radius of 0.5 (as area UVs go from 0->1)
+	
+	    // Output final colour
+		return float4( ppColour, ppAlpha );
+	}
+
+	// PostProcess.fx line 190
+	float4 PPBurnShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		
+		// Pixels are burnt with these colours at the edges
+		const float4 BurnColour = float4(0.8f, 0.4f, 0.0f, 1.0f);
+		const float4 GlowColour = float4(1.0f, 0.8f, 0.0f, 1.0f);
+		const float GlowAmount = 0.15f; // Thickness of glowing area
+		const float Crinkle = 0.1f; // Amount of texture crinkle at the edges 
+	
+		// Get burn texture colour
+	    float4 burnTexture = PostProcessMap.Sample( TrilinearWrap, ppIn.UVArea );
+	    
+	    // The range of burning colours are from BurnLevel  to BurnLevelMax
+		float BurnLevelMax = BurnLevel + GlowAmount; 
+	
+	    // Output black when current burn texture value below burning range
+	    if (burnTexture.x <= BurnLevel)
+	    {
+			return float4( 1.0f, 1.0f, 1.0f, 1.0f );
+		}
+	    
+	    // Output scene texture untouched when current burnTexture texture value above burning range
+		else if (burnTexture.x >= BurnLevelMax)
+	    {
+			float3 ppColour = SceneTexture.Sample( PointClamp, ppIn.UVScene );
+			return float4( ppColour, 1.0f );
+		}
+		
+		else // Draw burning edges
+		{
+			float3 ppColour;
+	
+			// Get level of glow (0 = none, 1 = max)
+			float GlowLevel = 1.0f - (burnTexture.x - BurnLevel) / GlowAmount;
+	
+			// Extract direction to crinkle (2D vector) from the g & b components of the burn texture sampled above (converting from 0->1 range to -0.5->0.5 range)
+			float2 CrinkleVector = burnTexture.Swizzle<0, 1>() - float2(0.5f, 0.5f);
+			
+			// Get main texture colour using crinkle offset
+		    float4 texColour =  SceneTexture.Sample( PointClamp, ppIn.UVScene - GlowLevel * Crinkle * CrinkleVector );
+	
+			// Split glow into two regions - the very edge and the inner section
+			GlowLevel *= 2.0f;
+			if (GlowLevel < 1.0f)
+			{		
+				// Blend from main texture colour on inside to burn tint in middle of burning area
+				ppColour = lerp( texColour, BurnColour * texColour, GlowLevel );
+			}
+			else
+			{
+				// Blend from burn tint in middle of burning area to bright glow at the burning edges
+				ppColour = lerp( BurnColour * texColour, GlowColour, GlowLevel - 1.0f );
+			}
+			return float4( ppColour, 1.0f );
+		}
+	}
+
+	// PostProcess.fx line 250
+	float4 PPDistortShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		const float LightStrength = 0.025f;
+		
+		// Get distort texture colour
+	    float4 distortTexture = PostProcessMap.Sample( TrilinearWrap, ppIn.UVArea );
+	
+		// Get direction (2D vector) to distort UVs from the g & b components of the distort texture (converting from 0->1 range to -0.5->0.5 range)
+		float2 DistortVector = distortTexture.Swizzle<0, 1>() - float2(0.5f, 0.5f);
+				
+		// Simple fake diffuse lighting formula based on 2D vector, light coming from top-left
+		float light = dot( normalize(DistortVector), float2(0.707f, 0.707f) ) * LightStrength;
+		
+		// Get final colour by adding fake light colour plus scene texture sampled with distort texture offset
+		float3 ppColour = light + SceneTexture.Sample( BilinearClamp, ppIn.UVScene + DistortLevel * DistortVector );
+	
+	    return float4( ppColour, 1.0f );
+	}
+
+	// PostProcess.fx line 271
+	float4 PPSpiralShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		// Get vector from UV at centre of post-processing area to UV at pixel
+		const float2 centreUV = (PPAreaBottomRight.Swizzle<0, 1>() + PPAreaTopLeft.Swizzle<0, 1>()) / 2.0f;
+		float2 centreOffsetUV = ppIn.UVScene - centreUV;
+		float centreDistance = length( centreOffsetUV ); // Distance of pixel from UV (i.e. screen) centre
+		
+		// Get sin and cos of spiral amount, increasing with distance from centre
+		float s, c;
+		sincos( centreDistance * SpiralTimer * SpiralTimer, s, c );
+		
+		// Create a (2D) rotation matrix and apply to the vector - i.e. rotate the
+		// vector around the centre by the spiral amount
+		float2x2 rot2D = { c, s,
+		                           -s, c };
+		float2 rotOffsetUV = mul( centreOffsetUV, rot2D );
+	
+		// Sample texture at new position (centre UV + rotated UV offset)
+	    float3 ppColour = SceneTexture.Sample( BilinearClamp, centreUV + rotOffsetUV );
+	
+		// Calculate alpha to display the effect in a softened circle, could use a texture rather than calculations for the same task.
+		// Uses the second set of area texture coordinates, which range from (0,0) to (1,1) over the area being processed
+		const float softEdge = 0.05f; // Softness of the edge of the circle - range 0.001 (hard edge) to 0.25 (very soft)
+		float2 centreVector = ppIn.UVArea - float2(0.5f, 0.5f);
+		float centreLengthSq = dot(centreVector, centreVector);
+		float ppAlpha = 1.0f - saturate( (centreLengthSq - 0.25f + softEdge) / softEdge ); // Soft circle calculation based on fact that this circle has a radius of 0.5 (as area UVs go from 0->1)
+	
+	    return float4( ppColour, ppAlpha );
+	}
+
+	// PostProcess.fx line 303
+	float4 PPHeatHazeShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		const float EffectStrength = 0.02f;
+		
+		// Calculate alpha to display the effect in a softened circle, could use a texture rather than calculations for the same task.
+		// Uses the second set of area texture coordinates, which range from (0,0) to (1,1) over the area being processed
+		const float softEdge = 0.15f; // Softness of the edge of the circle - range 0.001 (hard edge) to 0.25 (very soft)
+		float2 centreVector = ppIn.UVArea - float2(0.5f, 0.5f);
+		float centreLengthSq = dot(centreVector, centreVector);
+		float ppAlpha = 1.0f - saturate( (centreLengthSq - 0.25f + softEdge) / softEdge ); // Soft circle calculation based on fact that this circle has a radius of 0.5 (as area UVs go from 0->1)
+	
+		// Haze is a combination of sine waves in x and y dimensions
+		float SinX = sin(ppIn.UVArea.x * radians(1440.0f) + HeatHazeTimer);
+		float SinY = sin(ppIn.UVArea.y * radians(3600.0f) + HeatHazeTimer * 0.7f);
+		
+		// Offset for scene texture UV based on haze effect
+		// Adjust size of UV offset based on the constant EffectStrength, the overall size of area being processed, and the alpha value calculated above
+		float2 hazeOffset = float2(SinY, SinX) * EffectStrength * ppAlpha * (PPAreaBottomRight.Swizzle<0, 1>() - PPAreaTopLeft.Swizzle<0, 1>());
+	
+		// Get pixel from scene texture, offset using haze
+	    float3 ppColour = SceneTexture.Sample( BilinearClamp, ppIn.UVScene + hazeOffset );
+	
+		// Adjust alpha on a sine wave - better to have it nearer to 1.0 (but don't allow it to exceed 1.0)
+	    ppAlpha *= saturate(SinX * SinY * 0.33f + 0.55f);
+	
+		return float4( ppColour, ppAlpha );
+	}
+
+	// PostProcess.fx line 332
+	float4 PPGaussianBlurShaderHorizontal( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		float baseOffset = 0.0005f * BlurStrength; //The offset each sample 
+		float2 offset = float2(baseOffset, baseOffset * SceneTextureHeight/SceneTextureWidth);	//Make the blur offset proportional to the scene texture size	
+	
+		//Sample the base colour
+	    float3 ppColour = SceneTexture.Sample(BilinearClamp, ppIn.UVScene) * BlurWeights[0];
+	
+	    float3 FragmentColor = float3(0.0f, 0.0f, 0.0f);
+	
+		//Merge with 5 samples in each direction (20 sample blur altogether)
+	    for (int i = 1; i < 5; i++) {
+			//Use 0.2^i to simulate bell curve distribution of gaussian
+	
+			// Vertical-pass																  	  
+	        FragmentColor +=
+				SceneTexture.Sample(BilinearClamp, ppIn.UVScene + float2(offset.x * i, 0.0f)) * BlurWeights[i] + //* pow(0.3f, i) +
+				SceneTexture.Sample(BilinearClamp, ppIn.UVScene - float2(offset.x * i, 0.0f)) * BlurWeights[i]; //* pow(0.3f, i);
+	    }
+		//Add blur colour to base colour
+		ppColour += FragmentColor;    
+		return float4(ppColour, 1.0f);
+	
+	}
+
+	// PostProcess.fx line 357
+	float4 PPGaussianBlurShaderVertical( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+	    float baseOffset = 0.0005f * BlurStrength; //The offset each sample 
+	    float2 offset = float2(baseOffset, baseOffset * SceneTextureHeight / SceneTextureWidth); //Make the blur offset proportional to the scene texture size	
+		
+		//Sample the base colour
+	    float3 ppColour = MultipassTexture.Sample(BilinearClamp, ppIn.UVScene) * BlurWeights[0];
+	
+	    float3 FragmentColor = float3(0.0f, 0.0f, 0.0f);
+	
+		//Merge with 2 samples in each direction (20 sample blur altogether)
+	    for (int i = 1; i < 5; i++)
+	    {
+			//Use 0.2^i to simulate bell curve distribution of gaussian
+			// Vertical-pass																  	  
+	        FragmentColor +=
+				MultipassTexture.Sample(BilinearClamp, ppIn.UVScene + float2(offset.y * i, 0.0f)) * BlurWeights[i] + // * pow(0.3f, i) +
+				MultipassTexture.Sample(BilinearClamp, ppIn.UVScene - float2(offset.y * i, 0.0f)) * BlurWeights[i]; // * pow(0.3f, i);
+	    }
+		//Add blur colour to base colour
+	    ppColour += FragmentColor;
+	    return float4(ppColour, 1.0f);
+	
+	}
+
+	// PostProcess.fx line 382
+	float4 PPRippleShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		float3 ppColour = float3(0.0f, 0.0f, 0.0f);
+	
+		float2 shockCentre = float2(RipplePosition.x / SceneTextureWidth, RipplePosition.y / SceneTextureHeight);	//The origin of the shock (in UV space)
+		float distanceToCentre = length(ppIn.UVScene - shockCentre);	//Distance from texel to shock origin
+	
+		float2 sampleCoord = ppIn.UVScene;	// The coordinate to sample
+		float3 shockParams = float3(0.1f, 0.1f, 0.05f);	//Parameters that change how the shock works //Z = shock time
+		
+		//If the pixel is within the Ripple
+		if ((distanceToCentre <= (RippleTime + shockParams.z)) && (distanceToCentre >= (RippleTime - shockParams.z)))
+		{
+			float diff = (distanceToCentre - RippleTime);	//How far into the Ripple is this pixel
+			float powDiff = 1.0f - pow(abs(diff*shockParams.x), shockParams.y);
+			float diffTime = diff  * powDiff;
+			float2 diffUV = normalize(ppIn.UVScene - shockCentre);
+			sampleCoord = ppIn.UVScene + (diffUV * diffTime);	//Set alternate sample coordinate 
+		}
+	
+		ppColour = SceneTexture.Sample( PointClamp, sampleCoord );
+		return float4(ppColour, 1.0f);
+	}
+
+	// PostProcess.fx line 406
+	float4 PPShockwaveShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+		float3 ppColour = float3(0.0f, 0.0f, 0.0f);
+	
+		float2 finalUV = ppIn.UVScene;
+		finalUV.x += ShockwaveSin;
+		finalUV.y += ShockwaveSin * (SceneTextureHeight / SceneTextureWidth);
+	
+		ppColour = SceneTexture.Sample(PointBorder, finalUV);
+	
+		return float4(ppColour, 1.0f);
+	}
+
+	// PostProcess.fx line 419
+	float4 PPNegativeShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+	    float3 ppColour = SceneTexture.Sample(PointClamp, ppIn.UVScene);
+	    ppColour.x = 1.0f - ppColour.x;
+	    ppColour.y = 1.0f - ppColour.y;
+	    ppColour.z = 1.0f - ppColour.z;
+	
+	    return float4(ppColour, 1.0f);
+	}
+
+	// PostProcess.fx line 429
+	float4 PPFeedbackShader( const PS_POSTPROCESS_INPUT& ppIn ) const
+	{
+	    float3 ppColour = (MultipassTexture.Sample(PointClamp, ppIn.UVScene) * 0.1f) + (PreviousSceneTexture.Sample(PointClamp, ppIn.UVScene) * 0.9f);
+	
+		return float4(ppColour, 1.0f);
+	}
+};
+
+
+//-----------------------------------------------------------------------------
+// Techniques
+//-----------------------------------------------------------------------------
+
+// Techniques whose passes all have translated shaders
+const TUInt32 kNumPostProcessTechniques = 12;
+const char* const PostProcessTechniques[kNumPostProcessTechniques] =
+{
+	"PPCopy",
+	"PPTint",
+	"PPGreyNoise",
+	"PPBurn",
+	"PPDistort",
+	"PPSpiral",
+	"PPHeatHaze",
+	"PPGaussianBlur",
+	"PPRipple",
+	"PPShockwave",
+	"PPFeedback",
+	"PPNegative",
+};
+
+// Run the passes of the named technique in order, calling the runner for each as
+// runner( pass, numPasses, alphaBlend, shader ), where shader( shaders, input ) runs the pass's
+// pixel shader. Stops if the runner returns false. Returns false if the runner failed or there
+// is no technique of that name in PostProcessTechniques
+template <class TRunner>
+bool RunPostProcessTechnique( const char* name, TRunner& runner )
+{
+	if (strcmp( name, "PPCopy" ) == 0)
+	{
+		return runner( 0, 1, false, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPCopyShader( input ); } );
+	}
+	if (strcmp( name, "PPTint" ) == 0)
+	{
+		return runner( 0, 1, false, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPTintShader( input ); } );
+	}
+	if (strcmp( name, "PPGreyNoise" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPGreyNoiseShader( input ); } );
+	}
+	if (strcmp( name, "PPBurn" ) == 0)
+	{
+		return runner( 0, 1, false, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPBurnShader( input ); } );
+	}
+	if (strcmp( name, "PPDistort" ) == 0)
+	{
+		return runner( 0, 1, false, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPDistortShader( input ); } );
+	}
+	if (strcmp( name, "PPSpiral" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPSpiralShader( input ); } );
+	}
+	if (strcmp( name, "PPHeatHaze" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPHeatHazeShader( input ); } );
+	}
+	if (strcmp( name, "PPGaussianBlur" ) == 0)
+	{
+		if (!runner( 0, 2, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPGaussianBlurShaderHorizontal( input ); } )) return false;
+		return runner( 1, 2, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPGaussianBlurShaderVertical( input ); } );
+	}
+	if (strcmp( name, "PPRipple" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPRippleShader( input ); } );
+	}
+	if (strcmp( name, "PPShockwave" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPShockwaveShader( input ); } );
+	}
+	if (strcmp( name, "PPFeedback" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPFeedbackShader( input ); } );
+	}
+	if (strcmp( name, "PPNegative" ) == 0)
+	{
+		return runner( 0, 1, true, []( const SPostProcessShaders& s, const PS_POSTPROCESS_INPUT& input ) { return s.PPNegativeShader( input ); } );
+	}
+	return false;
+}
+
+
+} // namespace hlsl
+} // namespace gen
@@ -0,0 +1,96 @@
+/*******************************************
+	Sampling.h
+
+	Texture sampling for the CPU filters, as
+	done by the samplers in PostProcess.fx
+********************************************/
+
+#pragma once
+
+#include <math.h>
+#include <emmintrin.h> // SSE2
+
+#include "Defines.h"
+#include "Image.h"
+#include "PixelSSE.h"
+
+namespace gen
+{
+
+// Texture sampling with the sampler states used in PostProcess.fx. Colours are float4 in the
+// 0->255 range. UVs are 0->1 across the image with texel centres at (x + 0.5) / width
+
+// Addressing for a single texel coordinate
+inline TInt32 ClampCoord( TInt32 c, TInt32 size )
+{
+	return (c < 0) ? 0 : ((c >= size) ? size - 1 : c);
+}
+inline TInt32 WrapCoord( TInt32 c, TInt32 size )
+{
+	c %= size;
+	return (c < 0) ? c + size : c;
+}
+
+// The samplers read any image layout - CImage, CTiledImage or CLineRing
+
+// PointClamp and PointBorder samplers. Border colour is transparent black
+template <class TImage>
+inline __m128 SamplePoint( const TImage& image, TFloat32 u, TFloat32 v, EAddressMode addressMode )
+{
+	const TInt32 width = static_cast<TInt32>(image.Width());
+	const TInt32 height = static_cast<TInt32>(image.Height());
+	TInt32 x = static_cast<TInt32>(floorf( u * width ));
+	TInt32 y = static_cast<TInt32>(floorf( v * height ));
+	if (addressMode == kAddressBorder && (x < 0 || x >= width || y < 0 || y >= height))
+	{
+		return _mm_setzero_ps();
+	}
+	return LoadPixelSSE( image.Pixel( ClampCoord( x, width ), ClampCoord( y, height ) ) );
+}
+
+// BilinearClamp sampler, or BilinearWrap if wrap is set (also used for the trilinear samplers -
+// the maps are magnified over the screen so the top mip is the one sampled)
+template <class TImage>
+inline __m128 SampleBilinear( const TImage& image, TFloat32 u, TFloat32 v, bool wrap = false )
+{
+	const TInt32 width = static_cast<TInt32>(image.Width());
+	const TInt32 height = static_cast<TInt32>(image.Height());
+	TFloat32 tx = u * width - 0.5f;
+	TFloat32 ty = v * height - 0.5f;
+	TFloat32 fx = floorf( tx );
+	TFloat32 fy = floorf( ty );
+	TInt32 x0 = static_cast<TInt32>(fx);
+	TInt32 y0 = static_cast<TInt32>(fy);
+	TInt32 x1, y1;
+	if (wrap)
+	{
+		x1 = WrapCoord( x0 + 1, width );
+		y1 = WrapCoord( y0 + 1, height );
+		x0 = WrapCoord( x0, width );
+		y0 = WrapCoord( y0, height );
+	}
+	else
+	{
+		x1 = ClampCoord( x0 + 1, width );
+		y1 = ClampCoord( y0 + 1, height );
+		x0 = ClampCoord( x0, width );
+		y0 = ClampCoord( y0, height );
+	}
+
+	__m128 wx = _mm_set1_ps( tx - fx );
+	__m128 wy = _mm_set1_ps( ty - fy );
+	const TUInt8* row0 = image.Row( y0 );
+	const TUInt8* row1 = image.Row( y1 );
+	TUInt32 column0 = image.ColumnOffset( x0 );
+	TUInt32 column1 = image.ColumnOffset( x1 );
+	__m128 p00 = LoadPixelSSE( row0 + column0 );
+	__m128 p10 = LoadPixelSSE( row0 + column1 );
+	__m128 p01 = LoadPixelSSE( row1 + column0 );
+	__m128 p11 = LoadPixelSSE( row1 + column1 );
+	__m128 top = _mm_add_ps( p00, _mm_mul_ps( wx, _mm_sub_ps( p10, p00 ) ) );
+	__m128 bottom = _mm_add_ps( p01, _mm_mul_ps( wx, _mm_sub_ps( p11, p01 ) ) );
+	return _mm_add_ps( top, _mm_mul_ps( wy, _mm_sub_ps( bottom, top ) ) );
+}
+
+
+} // namespace gen
@@ -0,0 +1,338 @@
+/*******************************************
+	ShaderTypes.h
+
+	HLSL types and intrinsics for the C++
+	versions of the PostProcess.fx shaders
+********************************************/
+
+#pragma once
+
+#include <math.h>
+#include <string.h>
+#include <emmintrin.h> // SSE2
+
+#include "Defines.h"
+#include "Image.h"
+#include "PixelSSE.h"
+#include "Sampling.h"
+
+namespace gen
+{
+
+// The subset of HLSL used by the pixel shaders in PostProcess.fx, so that PostProcessShaderGen
+// can translate shader code almost token for token (see PostProcessShaders.h). Names are as in
+// HLSL and are kept in their own namespace, where they hide the C library maths functions.
+// float3 and float4 each hold one SSE register, so colour maths works on all channels at once.
+// Colours are in the shader range 0->1, unlike the 0->255 of the hand-written filters
+namespace hlsl
+{
+
+struct float3;
+struct float4;
+
+//-----------------------------------------------------------------------------
+// Vector types
+//-----------------------------------------------------------------------------
+
+// Vectors convert from a scalar (all components set) and to a shorter vector (truncated) as in
+// HLSL. Swizzles are written v.Swizzle<0, 1>() for v.xy, single components are the members x,
+// y, z, w. Functions take vectors by reference, as MSVC cannot pass aligned types by value
+
+struct float2
+{
+	float x, y;
+
+	float2() {}
+	float2( float s ) : x( s ), y( s ) {}
+	float2( float x_, float y_ ) : x( x_ ), y( y_ ) {}
+	float2( const float3& v );
+	float2( const float4& v );
+
+	const float& operator[]( int i ) const
+	{
+		return (&x)[i];
+	}
+
+	template <int A, int B>
+	float2 Swizzle() const
+	{
+		return float2( (*this)[A], (*this)[B] );
+	}
+
+	float2& operator+=( const float2& v ) { x += v.x; y += v.y; return *this; }
+	float2& operator-=( const float2& v ) { x -= v.x; y -= v.y; return *this; }
+	float2& operator*=( const float2& v ) { x *= v.x; y *= v.y; return *this; }
+	float2& operator/=( const float2& v ) { x /= v.x; y /= v.y; return *this; }
+};
+
+struct float3
+{
+	union
+	{
+		__m128 v;   // w lane is unused
+		float  c[4];
+		struct
+		{
+			float x, y, z;
+		};
+	};
+
+	float3() {}
+	float3( float s ) : v( _mm_set1_ps( s ) ) {}
+	float3( float x_, float y_, float z_ ) : v( _mm_set_ps( 0.0f, z_, y_, x_ ) ) {}
+	float3( const float4& v );
+	explicit float3( __m128 m ) : v( m ) {}
+
+	template <int A, int B>
+	float2 Swizzle() const
+	{
+		return float2( c[A], c[B] );
+	}
+	template <int A, int B, int C>
+	float3 Swizzle() const
+	{
+		return float3( c[A], c[B], c[C] );
+	}
+
+	float3& operator+=( const float3& a ) { v = _mm_add_ps( v, a.v ); return *this; }
+	float3& operator-=( const float3& a ) { v = _mm_sub_ps( v, a.v ); return *this; }
+	float3& operator*=( const float3& a ) { v = _mm_mul_ps( v, a.v ); return *this; }
+	float3& operator/=( const float3& a ) { v = _mm_div_ps( v, a.v ); return *this; }
+};
+
+struct float4
+{
+	union
+	{
+		__m128 v;
+		float  c[4];
+		struct
+		{
+			float x, y, z, w;
+		};
+	};
+
+	float4() {}
+	float4( float s ) : v( _mm_set1_ps( s ) ) {}
+	float4( float x_, float y_, float z_, float w_ ) : v( _mm_set_ps( w_, z_, y_, x_ ) ) {}
+	float4( const float3& a, float w_ ) : v( a.v ) { w = w_; }
+	float4( const float2& a, float z_, float w_ ) : v( _mm_set_ps( w_, z_, a.y, a.x ) ) {}
+	explicit float4( __m128 m ) : v( m ) {}
+
+	template <int A, int B>
+	float2 Swizzle() const
+	{
+		return float2( c[A], c[B] );
+	}
+	template <int A, int B, int C>
+	float3 Swizzle() const
+	{
+		return float3( c[A], c[B], c[C] );
+	}
+	template <int A, int B, int C, int D>
+	float4 Swizzle() const
+	{
+		return float4( _mm_shuffle_ps( v, v, _MM_SHUFFLE( D, C, B, A ) ) );
+	}
+
+	float4& operator+=( const float4& a ) { v = _mm_add_ps( v, a.v ); return *this; }
+	float4& operator-=( const float4& a ) { v = _mm_sub_ps( v, a.v ); return *this; }
+	float4& operator*=( const float4& a ) { v = _mm_mul_ps( v, a.v ); return *this; }
+	float4& operator/=( const float4& a ) { v = _mm_div_ps( v, a.v ); return *this; }
+};
+
+inline float2::float2( const float3& v ) : x( v.x ), y( v.y ) {}
+inline float2::float2( const float4& v ) : x( v.x ), y( v.y ) {}
+inline float3::float3( const float4& a ) : v( a.v ) {}
+
+
+// Matrix for mul, set from its elements row by row as in HLSL initialiser lists
+struct float2x2
+{
+	float m[2][2];
+};
+
+
+//-----------------------------------------------------------------------------
+// Operators
+//-----------------------------------------------------------------------------
+
+// Each operator has a vector-scalar and scalar-vector version so that scalars do not need a
+// conversion, which would make mixed vector sizes ambiguous
+
+inline float2 operator-( const float2& a ) { return float2( -a.x, -a.y ); }
+inline float2 operator+( const float2& a, const float2& b ) { return float2( a.x + b.x, a.y + b.y ); }
+inline float2 operator-( const float2& a, const float2& b ) { return float2( a.x - b.x, a.y - b.y ); }
+inline float2 operator*( const float2& a, const float2& b ) { return float2( a.x * b.x, a.y * b.y ); }
+inline float2 operator/( const float2& a, const float2& b ) { return float2( a.x / b.x, a.y / b.y ); }
+inline float2 operator+( const float2& a, float s ) { return float2( a.x + s, a.y + s ); }
+inline float2 operator-( const float2& a, float s ) { return float2( a.x - s, a.y - s ); }
+inline float2 operator*( const float2& a, float s ) { return float2( a.x * s, a.y * s ); }
+inline float2 operator/( const float2& a, float s ) { return float2( a.x / s, a.y / s ); }
+inline float2 operator+( float s, const float2& a ) { return float2( s + a.x, s + a.y ); }
+inline float2 operator-( float s, const float2& a ) { return float2( s - a.x, s - a.y ); }
+inline float2 operator*( float s, const float2& a ) { return float2( s * a.x, s * a.y ); }
+inline float2 operator/( float s, const float2& a ) { return float2( s / a.x, s / a.y ); }
+
+inline float3 operator-( const float3& a ) { return float3( _mm_sub_ps( _mm_setzero_ps(), a.v ) ); }
+inline float3 operator+( const float3& a, const float3& b ) { return float3( _mm_add_ps( a.v, b.v ) ); }
+inline float3 operator-( const float3& a, const float3& b ) { return float3( _mm_sub_ps( a.v, b.v ) ); }
+inline float3 operator*( const float3& a, const float3& b ) { return float3( _mm_mul_ps( a.v, b.v ) ); }
+inline float3 operator/( const float3& a, const float3& b ) { return float3( _mm_div_ps( a.v, b.v ) ); }
+inline float3 operator+( const float3& a, float s ) { return float3( _mm_add_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float3 operator-( const float3& a, float s ) { return float3( _mm_sub_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float3 operator*( const float3& a, float s ) { return float3( _mm_mul_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float3 operator/( const float3& a, float s ) { return float3( _mm_div_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float3 operator+( float s, const float3& a ) { return float3( _mm_add_ps( _mm_set1_ps( s ), a.v ) ); }
+inline float3 operator-( float s, const float3& a ) { return float3( _mm_sub_ps( _mm_set1_ps( s ), a.v ) ); }
+inline float3 operator*( float s, const float3& a ) { return float3( _mm_mul_ps( _mm_set1_ps( s ), a.v ) ); }
+inline float3 operator/( float s, const float3& a ) { return float3( _mm_div_ps( _mm_set1_ps( s ), a.v ) ); }
+
+inline float4 operator-( const float4& a ) { return float4( _mm_sub_ps( _mm_setzero_ps(), a.v ) ); }
+inline float4 operator+( const float4& a, const float4& b ) { return float4( _mm_add_ps( a.v, b.v ) ); }
+inline float4 operator-( const float4& a, const float4& b ) { return float4( _mm_sub_ps( a.v, b.v ) ); }
+inline float4 operator*( const float4& a, const float4& b ) { return float4( _mm_mul_ps( a.v, b.v ) ); }
+inline float4 operator/( const float4& a, const float4& b ) { return float4( _mm_div_ps( a.v, b.v ) ); }
+inline float4 operator+( const float4& a, float s ) { return float4( _mm_add_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float4 operator-( const float4& a, float s ) { return float4( _mm_sub_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float4 operator*( const float4& a, float s ) { return float4( _mm_mul_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float4 operator/( const float4& a, float s ) { return float4( _mm_div_ps( a.v, _mm_set1_ps( s ) ) ); }
+inline float4 operator+( float s, const float4& a ) { return float4( _mm_add_ps( _mm_set1_ps( s ), a.v ) ); }
+inline float4 operator-( float s, const float4& a ) { return float4( _mm_sub_ps( _mm_set1_ps( s ), a.v ) ); }
+inline float4 operator*( float s, const float4& a ) { return float4( _mm_mul_ps( _mm_set1_ps( s ), a.v ) ); }
+inline float4 operator/( float s, const float4& a ) { return float4( _mm_div_ps( _mm_set1_ps( s ), a.v ) ); }
+
+
+//-----------------------------------------------------------------------------
+// Intrinsics
+//-----------------------------------------------------------------------------
+
+inline float abs( float x )     { return fabsf( x ); }
+inline float sqrt( float x )    { return sqrtf( x ); }
+inline float sin( float x )     { return sinf( x ); }
+inline float cos( float x )     { return cosf( x ); }
+inline float pow( float x, float y ) { return powf( x, y ); }
+inline float exp( float x )     { return expf( x ); }
+inline float floor( float x )   { return floorf( x ); }
+inline float frac( float x )    { return x - floorf( x ); }
+inline float radians( float x ) { return x * (3.14159265f / 180.0f); }
+inline float min( float a, float b ) { return (a < b) ? a : b; }
+inline float max( float a, float b ) { return (a > b) ? a : b; }
+inline float clamp( float x, float a, float b ) { return (x < a) ? a : ((x > b) ? b : x); }
+inline float saturate( float x )  { return (x < 0.0f) ? 0.0f : ((x > 1.0f) ? 1.0f : x); }
+inline float step( float a, float x ) { return (x >= a) ? 1.0f : 0.0f; }
+inline float lerp( float a, float b, float t ) { return a + t * (b - a); }
+
+inline void sincos( float x, float& s, float& c )
+{
+	s = sinf( x );
+	c = cosf( x );
+}
+
+inline float2 abs( const float2& a ) { return float2( fabsf( a.x ), fabsf( a.y ) ); }
+inline float3 abs( const float3& a ) { return float3( _mm_andnot_ps( _mm_set1_ps( -0.0f ), a.v ) ); }
+inline float4 abs( const float4& a ) { return float4( _mm_andnot_ps( _mm_set1_ps( -0.0f ), a.v ) ); }
+
+inline float2 saturate( const float2& a ) { return float2( saturate( a.x ), saturate( a.y ) ); }
+inline float3 saturate( const float3& a ) { return float3( _mm_min_ps( _mm_max_ps( a.v, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) ) ); }
+inline float4 saturate( const float4& a ) { return float4( _mm_min_ps( _mm_max_ps( a.v, _mm_setzero_ps() ), _mm_set1_ps( 1.0f ) ) ); }
+
+inline float2 min( const float2& a, const float2& b ) { return float2( min( a.x, b.x ), min( a.y, b.y ) ); }
+inline float3 min( const float3& a, const float3& b ) { return float3( _mm_min_ps( a.v, b.v ) ); }
+inline float4 min( const float4& a, const float4& b ) { return float4( _mm_min_ps( a.v, b.v ) ); }
+inline float2 max( const float2& a, const float2& b ) { return float2( max( a.x, b.x ), max( a.y, b.y ) ); }
+inline float3 max( const float3& a, const float3& b ) { return float3( _mm_max_ps( a.v, b.v ) ); }
+inline float4 max( const float4& a, const float4& b ) { return float4( _mm_max_ps( a.v, b.v ) ); }
+
+inline float2 lerp( const float2& a, const float2& b, float t ) { return a + t * (b - a); }
+inline float3 lerp( const float3& a, const float3& b, float t ) { return a + t * (b - a); }
+inline float4 lerp( const float4& a, const float4& b, float t ) { return a + t * (b - a); }
+inline float2 lerp( const float2& a, const float2& b, const float2& t ) { return a + t * (b - a); }
+inline float3 lerp( const float3& a, const float3& b, const float3& t ) { return a + t * (b - a); }
+inline float4 lerp( const float4& a, const float4& b, const float4& t ) { return a + t * (b - a); }
+
+inline float dot( const float2& a, const float2& b ) { return a.x * b.x + a.y * b.y; }
+inline float dot( const float3& a, const float3& b ) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline float dot( const float4& a, const float4& b ) { return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w; }
+
+inline float length( const float2& a ) { return sqrtf( dot( a, a ) ); }
+inline float length( const float3& a ) { return sqrtf( dot( a, a ) ); }
+inline float length( const float4& a ) { return sqrtf( dot( a, a ) ); }
+
+inline float distance( const float2& a, const float2& b ) { return length( b - a ); }
+inline float distance( const float3& a, const float3& b ) { return length( b - a ); }
+
+inline float2 normalize( const float2& a ) { return a / length( a ); }
+inline float3 normalize( const float3& a ) { return a / length( a ); }
+inline float4 normalize( const float4& a ) { return a / length( a ); }
+
+// Row vector times matrix
+inline float2 mul( const float2& v, const float2x2& m )
+{
+	return float2( v.x * m.m[0][0] + v.y * m.m[1][0], v.x * m.m[0][1] + v.y * m.m[1][1] );
+}
+
+
+//-----------------------------------------------------------------------------
+// Textures
+//-----------------------------------------------------------------------------
+
+// Sampler state filtering and addressing. Trilinear filtering samples the top mip (the maps are
+// magnified over the screen), and bilinear filtering with border addressing clamps as the
+// hand-written samplers do
+enum ESamplerFilter
+{
+	kSamplerPoint,
+	kSamplerLinear,
+};
+
+enum ESamplerAddress
+{
+	kSamplerClamp,
+	kSamplerBorder,
+	kSamplerWrap,
+};
+
+// A sampler state. The settings are template parameters so each Sample call is compiled for
+// its sampler, with no tests of the state per pixel
+template <ESamplerFilter Filter, ESamplerAddress Address>
+struct SSamplerState
+{
+};
+
+// A texture variable, bound to an image or 0. An unbound texture samples as zero, as in D3D
+struct Texture2D
+{
+	const CImage* Image;
+
+	Texture2D() : Image( 0 ) {}
+
+	template <ESamplerFilter Filter, ESamplerAddress Address>
+	float4 Sample( const SSamplerState<Filter, Address>&, const float2& uv ) const
+	{
+		if (!Image) return float4( 0.0f );
+
+		__m128 colour;
+		if (Filter == kSamplerLinear)
+		{
+			colour = SampleBilinear( *Image, uv.x, uv.y, Address == kSamplerWrap );
+		}
+		else if (Address == kSamplerWrap)
+		{
+			const TInt32 width = static_cast<TInt32>(Image->Width());
+			const TInt32 height = static_cast<TInt32>(Image->Height());
+			TInt32 x = WrapCoord( static_cast<TInt32>(floorf( uv.x * width )), width );
+			TInt32 y = WrapCoord( static_cast<TInt32>(floorf( uv.y * height )), height );
+			colour = LoadPixelSSE( Image->Pixel( x, y ) );
+		}
+		else
+		{
+			colour = SamplePoint( *Image, uv.x, uv.y, (Address == kSamplerBorder) ? kAddressBorder : kAddressClamp );
+		}
+		return float4( _mm_mul_ps( colour, _mm_set1_ps( 1.0f / 255.0f ) ) );
+	}
+};
+
+
+} // namespace hlsl
+} // namespace gen
@@ -0,0 +1,144 @@
+/*******************************************
+	StripExecutor.cpp
+
+	Runs a filter chain down the image in
+	horizontal strips with bounded memory
+********************************************/
+
+#include "StripExecutor.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+CStripExecutor::CStripExecutor( TUInt32 stripRows /*= kDefaultStripRows*/ )
+{
+	SetStripRows( stripRows );
+}
+
+CStripExecutor::~CStripExecutor()
+{
+	ReleaseRings();
+}
+
+// Release all rings
+void CStripExecutor::ReleaseRings()
+{
+	for (size_t i = 0; i < m_Buffers.size(); ++i)
+	{
+		delete m_Buffers[i];
+	}
+	m_Buffers.clear();
+}
+
+
+//-----------------------------------------------------------------------------
+// Processing
+//-----------------------------------------------------------------------------
+
+// Run a frame's steps over the source image into the result, which is resized to match.
+// With no steps the source is copied. Returns false if a filter fails or on memory failure
+bool CStripExecutor::Run( const vector<SFilterStep>& steps, const CImage& source, CImage& result )
+{
+	if (source.IsEmpty() || &source == &result) return false;
+	if (steps.empty())
+	{
+		result.CopyFrom( source );
+		return !result.IsEmpty();
+	}
+	const TUInt32 width = source.Width();
+	const TUInt32 height = source.Height();
+	if (!result.Create( width, height )) return false;
+
+	// Split the steps into passes
+	m_Stages.clear();
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		for (TUInt32 pass = 0; pass < FilterPasses( steps[i].Filter ); ++pass)
+		{
+			SStage stage;
+			stage.Filter = steps[i].Filter;
+			stage.Pass = pass;
+			stage.Params = &steps[i].Params;
+			stage.Reach = FilterRowReach( stage.Filter, pass, steps[i].Params, width, height );
+			stage.Produced = 0;
+			m_Stages.push_back( stage );
+		}
+	}
+	const size_t numStages = m_Stages.size();
+
+	// A ring is read by the stage after it, which needs reach rows above its strip still held
+	// and reach rows below written before it can start. Holding 2 * reach + strip rows lets the
+	// writer finish a strip while the reader works on the one before. Rings from the last frame
+	// are reused where the shape allows (Create keeps memory of the same shape)
+	while (m_Buffers.size() < numStages + 1)
+	{
+		m_Buffers.push_back( new CLineRing );
+	}
+	while (m_Buffers.size() > numStages + 1)
+	{
+		delete m_Buffers.back();
+		m_Buffers.pop_back();
+	}
+	m_Buffers[0]->Attach( source );
+	m_Buffers[numStages]->Attach( result );
+	for (size_t i = 1; i < numStages; ++i)
+	{
+		if (!m_Buffers[i]->Create( width, height, 2 * m_Stages[i].Reach + m_StripRows )) return false;
+	}
+
+	// Advance each stage in turn by up to a strip, as far as the rows written into its input and
+	// the space left in its output allow, until the last stage has written every row
+	while (m_Stages[numStages - 1].Produced < height)
+	{
+		bool progress = false;
+		for (size_t i = 0; i < numStages; ++i)
+		{
+			SStage& stage = m_Stages[i];
+			TUInt32 end = stage.Produced + m_StripRows;
+			if (end > height) end = height;
+
+			// Input rows available, the source is complete from the start
+			TUInt32 available = (i == 0) ? height : m_Stages[i - 1].Produced;
+			if (available < height)
+			{
+				available = (available > stage.Reach) ? available - stage.Reach : 0;
+				if (end > available) end = available;
+			}
+
+			// Output rows that would replace rows the next stage still needs
+			if (i + 1 < numStages)
+			{
+				const SStage& next = m_Stages[i + 1];
+				TUInt32 needed = (next.Produced > next.Reach) ? next.Produced - next.Reach : 0;
+				TUInt32 space = needed + m_Buffers[i + 1]->Capacity();
+				if (end > space) end = space;
+			}
+
+			if (end <= stage.Produced) continue;
+			m_Buffers[i + 1]->SetBand( stage.Produced, end );
+			if (!ApplyFilterPass( stage.Filter, stage.Pass, *m_Buffers[i], *m_Buffers[i + 1], *stage.Params )) return false;
+			stage.Produced = end;
+			progress = true;
+		}
+		if (!progress) return false; // Rings too small to make progress, not expected
+	}
+	return true;
+}
+
+// Bytes of row memory held between passes by the last Run
+size_t CStripExecutor::RingBytes() const
+{
+	size_t bytes = 0;
+	for (size_t i = 0; i < m_Buffers.size(); ++i)
+	{
+		bytes += m_Buffers[i]->Bytes();
+	}
+	return bytes;
+}
+
+
+} // namespace gen
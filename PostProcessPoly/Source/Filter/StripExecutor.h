@@ -0,0 +1,111 @@
+/*******************************************
+	StripExecutor.h
+
+	Runs a filter chain down the image in
+	horizontal strips with bounded memory
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+#include "LineRing.h"
+#include "FilterChain.h"
+
+namespace gen
+{
+
+// Rows each filter pass produces at a time by default
+const TUInt32 kDefaultStripRows = 32;
+
+
+// Runs a frame's filter steps a strip of rows at a time rather than each filter over the whole
+// frame. Between passes only the rows the next pass can still read are held, in a CLineRing
+// sized from the pass's row reach (see FilterRowReach), so the memory used besides the source
+// and result is about width * (sum of 2 * reach + strip rows) rather than two whole frames. The
+// output is identical to CFilterChain::Run.
+//
+// Most filters read a few percent of the height either side of a row. Spiral may read any row,
+// so the pass before it is held in full and nothing after it starts until that pass finishes -
+// with other filters around it the rings can then add up to more than a whole frame.
+// The rings are kept from frame to frame and only reallocated when the frame size, steps or
+// parameters change the rows needed
+class CStripExecutor
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CStripExecutor( TUInt32 stripRows = kDefaultStripRows );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CStripExecutor( const CStripExecutor& );
+	CStripExecutor& operator=( const CStripExecutor& );
+
+public:
+	~CStripExecutor();
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Settings
+
+	// Rows each pass produces at a time, at least 1. Smaller strips use less memory, larger
+	// ones share each pass's rows between more threads
+	void SetStripRows( TUInt32 stripRows )
+	{
+		m_StripRows = (stripRows > 0) ? stripRows : 1;
+	}
+	TUInt32 StripRows() const
+	{
+		return m_StripRows;
+	}
+
+
+	/////////////////////////////////////
+	// Processing
+
+	// Run a frame's steps over the source image into the result, which is resized to match.
+	// With no steps the source is copied. Returns false if a filter fails or on memory failure
+	bool Run( const vector<SFilterStep>& steps, const CImage& source, CImage& result );
+
+	// Bytes of row memory held between passes by the last Run
+	size_t RingBytes() const;
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// One pass of one filter in the chain
+	struct SStage
+	{
+		EPostProcessFilter   Filter;
+		TUInt32              Pass;
+		const SFilterParams* Params;
+		TUInt32              Reach;    // Rows of input either side of an output row the pass reads
+		TUInt32              Produced; // Rows of output written so far this frame
+	};
+
+	// Release all rings
+	void ReleaseRings();
+
+	TUInt32 m_StripRows;
+
+	// Passes of the current frame's steps and the images between them. Stage i reads buffer i
+	// and writes buffer i + 1. The first buffer is a view of the source, the last a view of the
+	// result and the others rings owned here (rings are not copyable, so are held by pointer)
+	vector<SStage>     m_Stages;
+	vector<CLineRing*> m_Buffers;
+};
+
+
+} // namespace gen
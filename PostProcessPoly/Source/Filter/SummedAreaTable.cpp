@@ -0,0 +1,234 @@
+/*******************************************
+	SummedAreaTable.cpp
+
+	Summed-area table (integral image) and the
+	variable radius box blur built on it
+********************************************/
+
+#include <math.h>
+#include <string.h>
+#include <emmintrin.h> // SSE2
+
+#include "SummedAreaTable.h"
+#include "PixelSSE.h"
+#include "Parallel.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Summed-area table
+//-----------------------------------------------------------------------------
+
+CSummedAreaTable::CSummedAreaTable()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_Stride = 0;
+}
+
+
+// Build the table from an image. Rows are prefix summed in parallel, then columns are
+// prefix summed in parallel. Returns false on memory failure
+bool CSummedAreaTable::Build( const CImage& source )
+{
+	m_Width = source.Width();
+	m_Height = source.Height();
+	m_Stride = (m_Width + 1) * 4;
+	if (!m_Table.Resize( m_Stride * (m_Height + 1) )) return false;
+
+	// Top row of zeros
+	memset( m_Table.Data(), 0, m_Stride * sizeof(TUInt32) );
+
+	// Horizontal scan - each row independently becomes a running sum of its pixels
+	TUInt32* table = m_Table.Data();
+	const TUInt32 width = m_Width;
+	const TUInt32 stride = m_Stride;
+	ParallelFor( 0, m_Height, [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		const __m128i zero = _mm_setzero_si128();
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			const TUInt8* pixel = source.Row( y );
+			__m128i* entry = reinterpret_cast<__m128i*>(table + (y + 1) * stride);
+			__m128i sum = zero;
+			_mm_store_si128( entry++, sum ); // Left column of zeros
+			for (TUInt32 x = 0; x < width; ++x)
+			{
+				__m128i p = _mm_cvtsi32_si128( *reinterpret_cast<const int*>(pixel) );
+				p = _mm_unpacklo_epi16( _mm_unpacklo_epi8( p, zero ), zero );
+				sum = _mm_add_epi32( sum, p );
+				_mm_store_si128( entry++, sum );
+				pixel += 4;
+			}
+		}
+	});
+
+	// Vertical scan - add each row to the one below. Split by columns so threads are independent
+	const TUInt32 height = m_Height;
+	ParallelFor( 1, m_Width + 1, [&]( TUInt32 columnBegin, TUInt32 columnEnd )
+	{
+		for (TUInt32 y = 2; y <= height; ++y)
+		{
+			const __m128i* above = reinterpret_cast<const __m128i*>(table + (y - 1) * stride) + columnBegin;
+			__m128i* entry = reinterpret_cast<__m128i*>(table + y * stride) + columnBegin;
+			for (TUInt32 x = columnBegin; x < columnEnd; ++x)
+			{
+				_mm_store_si128( entry, _mm_add_epi32( _mm_load_si128( entry ), _mm_load_si128( above ) ) );
+				++entry;
+				++above;
+			}
+		}
+	}, 64 );
+
+	return true;
+}
+
+
+// Per-channel RGBA sums over the inclusive pixel rectangle (x0, y0) -> (x1, y1). The
+// rectangle must lie within the image
+void CSummedAreaTable::BoxSum( TUInt32 x0, TUInt32 y0, TUInt32 x1, TUInt32 y1, TUInt32 sum[4] ) const
+{
+	const TUInt32* bottomRight = Entry( x1 + 1, y1 + 1 );
+	const TUInt32* topRight    = Entry( x1 + 1, y0 );
+	const TUInt32* bottomLeft  = Entry( x0,     y1 + 1 );
+	const TUInt32* topLeft     = Entry( x0,     y0 );
+	for (int channel = 0; channel < 4; ++channel)
+	{
+		// Wraps modulo 2^32 for large tables but the difference is exact (see header)
+		sum[channel] = bottomRight[channel] - topRight[channel] - bottomLeft[channel] + topLeft[channel];
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Variable radius blur
+//-----------------------------------------------------------------------------
+
+// Blur one row of an image of the given height, as a pass of VariableBoxBlur does. The table
+// holds the image's rows from firstRow on and must cover every row the boxes of this row reach
+void VariableBoxRow
+(
+	const CSummedAreaTable& table,
+	TUInt32                 firstRow,
+	TUInt32                 height,
+	TUInt32                 y,
+	const TUInt8*           radii,
+	TUInt8*                 out
+)
+{
+	const TInt32 width = static_cast<TInt32>(table.Width());
+	const TInt32 row = static_cast<TInt32>(y);
+	const TInt32 lastRow = static_cast<TInt32>(height) - 1;
+	const TInt32 tableRow = static_cast<TInt32>(firstRow);
+	for (TInt32 x = 0; x < width; ++x)
+	{
+		// Clip box to image
+		TInt32 r = *radii++;
+		TInt32 x0 = (x - r < 0) ? 0 : x - r;
+		TInt32 y0 = (row - r < 0) ? 0 : row - r;
+		TInt32 x1 = (x + r >= width) ? width - 1 : x + r;
+		TInt32 y1 = (row + r > lastRow) ? lastRow : row + r;
+
+		// Four corner lookups, all four channels at once. Epi32 arithmetic wraps as required
+		__m128i sum = _mm_load_si128( reinterpret_cast<const __m128i*>(table.Entry( x1 + 1, y1 + 1 - tableRow )) );
+		sum = _mm_sub_epi32( sum, _mm_load_si128( reinterpret_cast<const __m128i*>(table.Entry( x1 + 1, y0 - tableRow )) ) );
+		sum = _mm_sub_epi32( sum, _mm_load_si128( reinterpret_cast<const __m128i*>(table.Entry( x0, y1 + 1 - tableRow )) ) );
+		sum = _mm_add_epi32( sum, _mm_load_si128( reinterpret_cast<const __m128i*>(table.Entry( x0, y0 - tableRow )) ) );
+
+		// Average over clipped area. Box sums fit in a signed 32-bit integer for any box
+		// under 8.4 million pixels, so the signed conversion is safe
+		TFloat32 area = static_cast<TFloat32>((x1 - x0 + 1) * (y1 - y0 + 1));
+		__m128 average = _mm_mul_ps( _mm_cvtepi32_ps( sum ), _mm_set1_ps( 1.0f / area ) );
+		StorePixelSSE( out, average );
+		out += 4;
+	}
+}
+
+// One box blur pass of source into dest using an already built table for source
+void VariableBoxPass
+(
+	const CSummedAreaTable& table,
+	CImage&                 dest,
+	const TUInt8*           radiusMap
+)
+{
+	const TUInt32 width = table.Width();
+	const TUInt32 height = table.Height();
+	ParallelFor( 0, height, [&]( TUInt32 rowBegin, TUInt32 rowEnd )
+	{
+		for (TUInt32 y = rowBegin; y < rowEnd; ++y)
+		{
+			VariableBoxRow( table, 0, height, y, radiusMap + y * width, dest.Row( y ) );
+		}
+	}, 8 );
+}
+
+
+// Blur the source image into the destination using a box filter whose radius varies per pixel.
+// radiusMap holds one radius (in pixels) per source pixel, row-major with no padding. Each
+// output pixel is the average of the (2r+1) x (2r+1) box around it, clipped to the image, so
+// cost is independent of radius. Repeating the pass (iterations > 1) converges on a gaussian
+// profile - three iterations is usually indistinguishable. Source and destination must differ
+void VariableBoxBlur
+(
+	const CImage&  source,
+	CImage&        dest,
+	const TUInt8*  radiusMap,
+	TUInt32        iterations /*= 1*/
+)
+{
+	if (source.IsEmpty() || &source == &dest || iterations == 0) return;
+	if (!dest.Create( source.Width(), source.Height() )) return;
+
+	CSummedAreaTable table;
+	if (!table.Build( source )) return;
+	VariableBoxPass( table, dest, radiusMap );
+
+	// Further iterations blur the previous result. The table is rebuilt from a copy so the
+	// pass can write straight back to the destination
+	CImage previous;
+	for (TUInt32 i = 1; i < iterations; ++i)
+	{
+		previous.CopyFrom( dest );
+		if (!table.Build( previous )) return;
+		VariableBoxPass( table, dest, radiusMap );
+	}
+}
+
+
+// Fill a radius map for a focus falloff: zero radius within focusRadius pixels of the focus point
+// rising linearly to maxRadius at falloffRadius pixels and beyond. The map must hold
+// width * height entries. It may cover a band of a taller image starting at firstRow
+void BuildFocusRadiusMap
+(
+	TUInt8*  radiusMap,
+	TUInt32  width,
+	TUInt32  height,
+	TFloat32 focusX,
+	TFloat32 focusY,
+	TFloat32 focusRadius,
+	TFloat32 falloffRadius,
+	TUInt8   maxRadius,
+	TUInt32  firstRow /*= 0*/
+)
+{
+	TFloat32 falloffRange = falloffRadius - focusRadius;
+	if (falloffRange <= 0.0f) falloffRange = 1.0f;
+
+	for (TUInt32 y = firstRow; y < firstRow + height; ++y)
+	{
+		TFloat32 dy = y - focusY;
+		for (TUInt32 x = 0; x < width; ++x)
+		{
+			TFloat32 dx = x - focusX;
+			TFloat32 t = (sqrtf( dx * dx + dy * dy ) - focusRadius) / falloffRange;
+			if (t < 0.0f) t = 0.0f;
+			if (t > 1.0f) t = 1.0f;
+			*radiusMap++ = static_cast<TUInt8>(t * maxRadius + 0.5f);
+		}
+	}
+}
+
+
+} // namespace gen
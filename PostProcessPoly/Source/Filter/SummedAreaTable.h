@@ -0,0 +1,113 @@
+/*******************************************
+	SummedAreaTable.h
+
+	Summed-area table (integral image) and the
+	variable radius box blur built on it
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "Image.h"
+#include "AlignedArray.h"
+
+namespace gen
+{
+
+// Summed-area table of an RGBA image. Entry (x, y) holds the per-channel sum of all pixels above
+// and to the left of pixel (x, y), so the sum over any rectangle takes four lookups whatever its
+// size. The table has an extra row and column of zeros at the top and left to avoid edge tests.
+//
+// Sums are held as 32-bit unsigned integers. The full table total can exceed 32 bits for large
+// images, but the table is only ever used through differences of four entries. Unsigned
+// arithmetic is modulo 2^32, so a box sum is exact provided the box itself sums to less than
+// 2^32 - i.e. any box under 16.8 million pixels, far beyond a 4K frame (8.3 million)
+class CSummedAreaTable
+{
+public:
+	CSummedAreaTable();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSummedAreaTable( const CSummedAreaTable& );
+	CSummedAreaTable& operator=( const CSummedAreaTable& );
+
+public:
+	// Build the table from an image. Rows are prefix summed in parallel, then columns are
+	// prefix summed in parallel. Returns false on memory failure
+	bool Build( const CImage& source );
+
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+
+	// Per-channel RGBA sums over the inclusive pixel rectangle (x0, y0) -> (x1, y1). The
+	// rectangle must lie within the image
+	void BoxSum( TUInt32 x0, TUInt32 y0, TUInt32 x1, TUInt32 y1, TUInt32 sum[4] ) const;
+
+	// Pointer to the four channel entry for table position (x, y), where (0, 0) is the zero
+	// corner and (x, y) covers pixels up to (x - 1, y - 1)
+	const TUInt32* Entry( TUInt32 x, TUInt32 y ) const
+	{
+		return m_Table.Data() + y * m_Stride + x * 4;
+	}
+
+private:
+	TUInt32                m_Width;   // Image size (table is one larger in each direction)
+	TUInt32                m_Height;
+	TUInt32                m_Stride;  // Integers per table row
+	CAlignedArray<TUInt32> m_Table;
+};
+
+
+// Blur the source image into the destination using a box filter whose radius varies per pixel.
+// radiusMap holds one radius (in pixels) per source pixel, row-major with no padding. Each
+// output pixel is the average of the (2r+1) x (2r+1) box around it, clipped to the image, so
+// cost is independent of radius. Repeating the pass (iterations > 1) converges on a gaussian
+// profile - three iterations is usually indistinguishable. Source and destination must differ
+void VariableBoxBlur
+(
+	const CImage&  source,
+	CImage&        dest,
+	const TUInt8*  radiusMap,
+	TUInt32        iterations = 1
+);
+
+// Blur one row of an image of the given height, as a pass of VariableBoxBlur does. The table
+// holds the image's rows from firstRow on (it may be built from a band of them) and must cover
+// every row the boxes of this row reach, clipped to the image. radii holds this row's radii.
+// Writes width pixels of RGBA to out, alpha averaged as the other channels
+void VariableBoxRow
+(
+	const CSummedAreaTable& table,
+	TUInt32                 firstRow,
+	TUInt32                 height,
+	TUInt32                 y,
+	const TUInt8*           radii,
+	TUInt8*                 out
+);
+
+// Fill a radius map for a focus falloff: zero radius within focusRadius pixels of the focus point
+// rising linearly to maxRadius at falloffRadius pixels and beyond. The map must hold
+// width * height entries. It may cover a band of a taller image starting at firstRow, the focus
+// point is still given in the full image
+void BuildFocusRadiusMap
+(
+	TUInt8*  radiusMap,
+	TUInt32  width,
+	TUInt32  height,
+	TFloat32 focusX,
+	TFloat32 focusY,
+	TFloat32 focusRadius,
+	TFloat32 falloffRadius,
+	TUInt8   maxRadius,
+	TUInt32  firstRow = 0
+);
+
+
+} // namespace gen
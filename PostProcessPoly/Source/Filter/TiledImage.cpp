@@ -0,0 +1,155 @@
+/*******************************************
+	TiledImage.cpp
+
+	RGBA image stored in square tiles, used by
+	the software post-processing filters
+********************************************/
+
+#include <malloc.h>
+#include <string.h>
+
+#include "TiledImage.h"
+#include "Parallel.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+// Constructor creates an empty image, use Create to allocate pixels
+CTiledImage::CTiledImage()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_TilesX = 0;
+	m_TilesY = 0;
+	m_TileRowBytes = 0;
+	m_Pixels = 0;
+}
+
+CTiledImage::~CTiledImage()
+{
+	Release();
+}
+
+
+//-----------------------------------------------------------------------------
+// Creation
+//-----------------------------------------------------------------------------
+
+// Allocate pixels for an image of the given size, releasing any existing pixels. The
+// contents are undefined. Returns false on memory failure
+bool CTiledImage::Create( TUInt32 width, TUInt32 height )
+{
+	// Reuse existing memory if the size is unchanged
+	if (m_Pixels && width == m_Width && height == m_Height)
+	{
+		return true;
+	}
+	Release();
+	if (width == 0 || height == 0)
+	{
+		return false;
+	}
+
+	TUInt32 tilesX = (width + kTileMask) >> kTileShift;
+	TUInt32 tilesY = (height + kTileMask) >> kTileShift;
+	m_Pixels = static_cast<TUInt8*>(_aligned_malloc( static_cast<size_t>(tilesX) * tilesY * kTileBytes, 16 ));
+	if (!m_Pixels)
+	{
+		return false;
+	}
+
+	m_Width = width;
+	m_Height = height;
+	m_TilesX = tilesX;
+	m_TilesY = tilesY;
+	m_TileRowBytes = tilesX * kTileBytes;
+	return true;
+}
+
+// Release pixel memory
+void CTiledImage::Release()
+{
+	if (m_Pixels) _aligned_free( m_Pixels );
+	m_Pixels = 0;
+	m_Width = 0;
+	m_Height = 0;
+	m_TilesX = 0;
+	m_TilesY = 0;
+	m_TileRowBytes = 0;
+}
+
+// Copy the contents of another image into this one, resizing to match
+void CTiledImage::CopyFrom( const CTiledImage& source )
+{
+	if (!Create( source.Width(), source.Height() )) return;
+	memcpy( m_Pixels, source.m_Pixels, static_cast<size_t>(m_TilesX) * m_TilesY * kTileBytes );
+}
+
+
+//-----------------------------------------------------------------------------
+// Layout conversion
+//-----------------------------------------------------------------------------
+
+// Both conversions work through one row of tiles at a time, so the linear side reads or writes
+// kTileSize whole rows and the tiled side a contiguous block
+
+// Copy a linear image into this one, resizing to match. Returns false on memory failure
+bool CTiledImage::FromLinear( const CImage& source )
+{
+	if (source.IsEmpty() || !Create( source.Width(), source.Height() )) return false;
+
+	ParallelFor( 0, m_TilesY, [&]( TUInt32 tileRowBegin, TUInt32 tileRowEnd )
+	{
+		for (TUInt32 tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+		{
+			TUInt32 rowEnd = (tileY + 1) << kTileShift;
+			if (rowEnd > m_Height) rowEnd = m_Height;
+			for (TUInt32 y = tileY << kTileShift; y < rowEnd; ++y)
+			{
+				const TUInt8* sourceRow = source.Row( y );
+				TUInt8* tileRow = Row( y );
+				for (TUInt32 x = 0; x < m_Width; x += kTileSize)
+				{
+					TUInt32 count = (m_Width - x < kTileSize) ? m_Width - x : kTileSize;
+					memcpy( tileRow, sourceRow + x * 4, count * 4 );
+					tileRow += kTileBytes;
+				}
+			}
+		}
+	}, 1 );
+	return true;
+}
+
+// Copy this image into a linear image, resizing it to match. Returns false on memory failure
+bool CTiledImage::ToLinear( CImage& dest ) const
+{
+	if (IsEmpty() || !dest.Create( m_Width, m_Height )) return false;
+
+	ParallelFor( 0, m_TilesY, [&]( TUInt32 tileRowBegin, TUInt32 tileRowEnd )
+	{
+		for (TUInt32 tileY = tileRowBegin; tileY < tileRowEnd; ++tileY)
+		{
+			TUInt32 rowEnd = (tileY + 1) << kTileShift;
+			if (rowEnd > m_Height) rowEnd = m_Height;
+			for (TUInt32 y = tileY << kTileShift; y < rowEnd; ++y)
+			{
+				TUInt8* destRow = dest.Row( y );
+				const TUInt8* tileRow = Row( y );
+				for (TUInt32 x = 0; x < m_Width; x += kTileSize)
+				{
+					TUInt32 count = (m_Width - x < kTileSize) ? m_Width - x : kTileSize;
+					memcpy( destRow + x * 4, tileRow, count * 4 );
+					tileRow += kTileBytes;
+				}
+			}
+		}
+	}, 1 );
+	return true;
+}
+
+
+} // namespace gen
@@ -0,0 +1,158 @@
+/*******************************************
+	TiledImage.h
+
+	RGBA image stored in square tiles, used by
+	the software post-processing filters
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "Image.h"
+
+namespace gen
+{
+
+// Tiles are kTileSize pixels square. An 8x8 tile is 256 bytes, four cache lines, and a row of
+// tiles across a 3840 wide frame is 120KB. 16x16 tiles measured the same for the blur, 8x8 waste
+// less memory padding the edges
+const TUInt32 kTileShift = 3;
+const TUInt32 kTileSize = 1 << kTileShift;
+const TUInt32 kTileMask = kTileSize - 1;
+const TUInt32 kTileBytes = kTileSize * kTileSize * 4;
+
+
+// An 8-bit RGBA image with the same pixel format as CImage but stored as square tiles, each
+// tile's pixels row by row and the tiles themselves row by row. Pixels a few rows apart are
+// then close in memory rather than a pitch apart, which suits code that reads columns or
+// scattered neighbourhoods. Finding a pixel costs a few more instructions than in a CImage, so
+// whether a filter gains depends on how much of the frame the caches hold - PostProcessFilterBench
+// compares the layouts on a given machine. Tiles at the right and bottom edges are padded to
+// full size - the padding is allocated but has undefined contents. Each tile row is 16 byte
+// aligned so filters can use SSE loads
+class CTiledImage
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor creates an empty image, use Create to allocate pixels
+	CTiledImage();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CTiledImage( const CTiledImage& );
+	CTiledImage& operator=( const CTiledImage& );
+
+public:
+	~CTiledImage();
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Allocate pixels for an image of the given size, releasing any existing pixels. The
+	// contents are undefined. Returns false on memory failure
+	bool Create( TUInt32 width, TUInt32 height );
+
+	// Release pixel memory
+	void Release();
+
+	// Copy the contents of another image into this one, resizing to match
+	void CopyFrom( const CTiledImage& source );
+
+
+	/////////////////////////////////////
+	// Layout conversion
+
+	// Copy a linear image into this one, resizing to match. Returns false on memory failure
+	bool FromLinear( const CImage& source );
+
+	// Copy this image into a linear image, resizing it to match. Returns false on memory failure
+	bool ToLinear( CImage& dest ) const;
+
+
+	/////////////////////////////////////
+	// Access
+
+	TUInt32 Width() const
+	{
+		return m_Width;
+	}
+	TUInt32 Height() const
+	{
+		return m_Height;
+	}
+
+	// Number of tiles across and down, including partly used tiles at the edges
+	TUInt32 TilesX() const
+	{
+		return m_TilesX;
+	}
+	TUInt32 TilesY() const
+	{
+		return m_TilesY;
+	}
+
+	bool IsEmpty() const
+	{
+		return m_Pixels == 0;
+	}
+
+	// Pointer to the first byte of the given tile, the tile's rows are kTileSize * 4 bytes apart
+	TUInt8* Tile( TUInt32 tileX, TUInt32 tileY )
+	{
+		return m_Pixels + tileY * m_TileRowBytes + tileX * kTileBytes;
+	}
+	const TUInt8* Tile( TUInt32 tileX, TUInt32 tileY ) const
+	{
+		return m_Pixels + tileY * m_TileRowBytes + tileX * kTileBytes;
+	}
+
+	// Pointer to the first pixel of the given row. Unlike CImage the row is not contiguous, use
+	// ColumnOffset to find other pixels in it
+	TUInt8* Row( TUInt32 y )
+	{
+		return m_Pixels + (y >> kTileShift) * m_TileRowBytes + (y & kTileMask) * kTileSize * 4;
+	}
+	const TUInt8* Row( TUInt32 y ) const
+	{
+		return m_Pixels + (y >> kTileShift) * m_TileRowBytes + (y & kTileMask) * kTileSize * 4;
+	}
+
+	// Offset in bytes of the given column from the start of any row
+	TUInt32 ColumnOffset( TUInt32 x ) const
+	{
+		return (x >> kTileShift) * kTileBytes + (x & kTileMask) * 4;
+	}
+
+	// Pointer to the given pixel (4 bytes, RGBA order)
+	TUInt8* Pixel( TUInt32 x, TUInt32 y )
+	{
+		return Row( y ) + ColumnOffset( x );
+	}
+	const TUInt8* Pixel( TUInt32 x, TUInt32 y ) const
+	{
+		return Row( y ) + ColumnOffset( x );
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	TUInt32 m_Width;
+	TUInt32 m_Height;
+	TUInt32 m_TilesX;
+	TUInt32 m_TilesY;
+	TUInt32 m_TileRowBytes; // Bytes per row of tiles
+	TUInt8* m_Pixels;       // Aligned allocation
+};
+
+
+} // namespace gen
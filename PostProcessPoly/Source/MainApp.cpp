@@ -12,6 +12,11 @@
 #include "Input.h"
 #include "CTimer.h"
 #include "CVector2.h"
+#include "D3D10RenderDevice.h"
+#include "StateCacheRenderDevice.h"
+#include "MeshArena.h"
+#include "VertexFormat.h"
+#include "TextureCache.h"
 #include "PostProcessPoly.h"
 
 namespace gen
@@ -22,17 +27,23 @@ namespace gen
 // DirectX Variables
 //--------------------------------------------------------------------------------------
 
-// The main D3D interface, this pointer is used to access most D3D functions (and is shared across all cpp files through Defines.h)
-ID3D10Device* g_pd3dDevice = NULL;
+// The Direct3D 10 render device, which owns the D3D device, swap chain, depth buffer and OSD font
+CD3D10RenderDevice D3D10Device;
 
-// Variables used to setup D3D
-IDXGISwapChain*         SwapChain = NULL;
-ID3D10Texture2D*        DepthStencil = NULL;
-ID3D10DepthStencilView* DepthStencilView = NULL;
-ID3D10RenderTargetView* BackBufferRenderTarget = NULL;
+// Drops effect variable writes that would not change the value before they reach the device above
+CStateCacheRenderDevice StateCache( &D3D10Device );
 
-// D3DX font for OSD
-ID3DX10Font* OSDFont = NULL;
+// The render device used for all rendering (shared across cpp files with extern). Points at the state cache once the device is created
+IRenderDevice* RenderDevice = NULL;
+
+// Shared vertex and index buffers that all mesh geometry is allocated from (shared across cpp files with extern)
+CMeshArena MeshArena;
+
+// Distinct vertex formats of the meshes and the input layouts shared between them (shared across cpp files with extern)
+CVertexFormatRegistry VertexFormats;
+
+// Mesh textures, each loaded once and shared by every mesh using it (shared across cpp files with extern)
+CTextureCache TextureCache;
 
 
 //--------------------------------------------------------------------------------------
@@ -68,8 +79,6 @@ CTimer Timer;
 // Initialise Direct3D
 bool D3DSetup( HWND hWnd )
 {
-	HRESULT hr = S_OK;
-
 	////////////////////////////////
 	// Initialise Direct3D
 
@@ -80,53 +89,12 @@ bool D3DSetup( HWND hWnd )
 	BackBufferHeight = ClientRect.bottom - ClientRect.top;
 
 
-	// Create a Direct3D device (i.e. initialise D3D), and create a swap-chain (create a back buffer to render to)
-	DXGI_SWAP_CHAIN_DESC sd;         // Structure to contain all the information needed
-	ZeroMemory( &sd, sizeof( sd ) ); // Clear the structure to 0 - common Microsoft practice, not really good style
-	sd.BufferCount = 1;
-	sd.BufferDesc.Width = BackBufferWidth;               // Target window size
-	sd.BufferDesc.Height = BackBufferHeight;             // --"--
-	sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // Pixel format of target window
-	sd.BufferDesc.RefreshRate.Numerator = 60;          // Refresh rate of monitor
-	sd.BufferDesc.RefreshRate.Denominator = 1;         // --"--
-	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
-	sd.SampleDesc.Count = 1;
-	sd.SampleDesc.Quality = 0;
-	sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD; // Discard last frame's back buffer after it is shown, alternative is DXGI_SWAP_EFFECT_SEQUENTIAL, which retains the back buffer
-	sd.OutputWindow = hWnd;                   // Target window
-	sd.Windowed = TRUE;                       // Whether to render in a window (TRUE) or go fullscreen (FALSE)
-	if (FAILED( D3D10CreateDeviceAndSwapChain( NULL, D3D10_DRIVER_TYPE_HARDWARE, NULL, D3D10_CREATE_DEVICE_DEBUG, D3D10_SDK_VERSION, &sd, &SwapChain, &g_pd3dDevice ) )) return false;
-
-
-	// Here indicate that the back-buffer can be "viewed" as a render target - rendering to the back buffer is standard behaviour, so this code is standard
-	ID3D10Texture2D* pBackBuffer;
-	if (FAILED( SwapChain->GetBuffer( 0, __uuidof( ID3D10Texture2D ), ( LPVOID* )&pBackBuffer ) )) return false;
-	hr = g_pd3dDevice->CreateRenderTargetView( pBackBuffer, NULL, &BackBufferRenderTarget );
-	pBackBuffer->Release();
-	if( FAILED( hr ) ) return false;
-
-
-	// Create a texture (bitmap) to use for a depth buffer for the main viewport
-	D3D10_TEXTURE2D_DESC descDepth;
-	descDepth.Width = BackBufferWidth;
-	descDepth.Height = BackBufferHeight;
-	descDepth.MipLevels = 1;
-	descDepth.ArraySize = 1;
-	descDepth.Format = DXGI_FORMAT_D32_FLOAT;
-	descDepth.SampleDesc.Count = 1;
-	descDepth.SampleDesc.Quality = 0;
-	descDepth.Usage = D3D10_USAGE_DEFAULT;
-	descDepth.BindFlags = D3D10_BIND_DEPTH_STENCIL;
-	descDepth.CPUAccessFlags = 0;
-	descDepth.MiscFlags = 0;
-	if( FAILED( g_pd3dDevice->CreateTexture2D( &descDepth, NULL, &DepthStencil ) )) return false;
-
-	// Create the depth stencil view, i.e. indicate that the texture just created is to be used as a depth buffer
-	if( FAILED( g_pd3dDevice->CreateDepthStencilView( DepthStencil, NULL, &DepthStencilView ) )) return false;
-
-	// Create a font using D3DX helper functions
-    if (FAILED(D3DX10CreateFont( g_pd3dDevice, 12, 0, FW_BOLD, 1, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
-                                 DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Arial", &OSDFont ))) return false;
+	// Create a Direct3D device with a back buffer to render to, along with the depth buffer and font
+	if (!D3D10Device.Create( hWnd, BackBufferWidth, BackBufferHeight )) return false;
+	RenderDevice = &StateCache;
+	MeshArena.SetDevice( RenderDevice );
+	VertexFormats.SetDevice( RenderDevice );
+	TextureCache.SetDevice( RenderDevice );
 
 	return true;
 }
@@ -144,14 +112,12 @@ bool ResetDevice( HWND hWnd, bool ToggleFullscreen = false )
 // Uninitialise D3D
 void D3DShutdown()
 {
-	// Release D3D interfaces
-	if (g_pd3dDevice)           g_pd3dDevice->ClearState();
-	if (OSDFont)                OSDFont->Release();
-	if (DepthStencilView)       DepthStencilView->Release();
-	if (BackBufferRenderTarget) BackBufferRenderTarget->Release();
-	if (DepthStencil)           DepthStencil->Release();
-	if (SwapChain)              SwapChain->Release();
-	if (g_pd3dDevice)           g_pd3dDevice->Release();
+	// Release D3D interfaces, along with any mesh geometry buffers, input layouts and textures still held
+	MeshArena.Release();
+	VertexFormats.Release();
+	TextureCache.ReleaseAll();
+	D3D10Device.Shutdown();
+	RenderDevice = NULL;
 }
 
 
@@ -176,7 +142,7 @@ LRESULT WINAPI MsgProc( HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam )
         case WM_SIZE:
 		{
 			// Resized window - reset device to match back buffer to new window size
-			if (gen::g_pd3dDevice && !gen::ResetDevice( hWnd ))
+			if (gen::RenderDevice && !gen::ResetDevice( hWnd ))
 			{
 				DestroyWindow( hWnd );
 			}
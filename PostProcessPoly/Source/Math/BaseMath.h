@@ -76,7 +76,7 @@ enum ERoundingMethod
 // Many versions provided here to allow mixing of parameter types for these basic functions
 
 inline TUInt32 Abs( const TInt32 x ) { return abs( static_cast<int>(x) ); }
-inline TUInt64 Abs( const TInt64 x ) { return _abs64( x ); }
+inline TUInt64 Abs( const TInt64 x ) { return (x < 0) ? 0 - static_cast<TUInt64>(x) : static_cast<TUInt64>(x); }
 inline TFloat32 Abs( const TFloat32 x ) { return fabsf( x ); }
 inline TFloat64 Abs( const TFloat64 x ) { return fabs( x ); }
 
@@ -35,6 +35,7 @@ class CVector3;
 class CVector4;
 class CMatrix4x4;
 class CQuaternion;
+struct SColourRGBA;
 
 /*---------------------------------------------------------------------------------------------
 	Vector Conversions
@@ -160,6 +161,22 @@ inline const D3DXQUATERNION* ToD3DXQUATERNIONPtr( const CQuaternion* pQ )
 }
 
 
+/*---------------------------------------------------------------------------------------------
+	Colour Conversions
+---------------------------------------------------------------------------------------------*/
+
+// Reinterpret a SColourRGBA as a D3DXCOLOR - in various forms (const & ptr)
+inline D3DXCOLOR& ToD3DXCOLOR( SColourRGBA& colour )
+{
+	return *reinterpret_cast<D3DXCOLOR*>(&colour);
+}
+
+inline const D3DXCOLOR& ToD3DXCOLOR( const SColourRGBA& colour )
+{
+	return *reinterpret_cast<const D3DXCOLOR*>(&colour);
+}
+
+
 } // namespace gen
 
 #endif // GEN_C_MATHDX_H_INCLUDED
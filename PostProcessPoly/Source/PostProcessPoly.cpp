@@ -4,14 +4,11 @@
 	Main scene and game functions
 ********************************************/
 
-#include <Windows.h>
+#include <list>
 #include <sstream>
 #include <string>
 using namespace std;
 
-#include <d3d10.h>
-#include <d3dx10.h>
-
 #include "Defines.h"
 #include "CVector3.h"
 #include "CVector4.h"
@@ -22,6 +19,12 @@ using namespace std;
 #include "CParseLevel.h"
 #include "PostProcessPoly.h"
 #include "ColourConversion.h"
+#include "RenderDevice.h"
+#include "StateCacheRenderDevice.h"
+#include "DrawQueue.h"
+#include "Parallel.h"
+#include "SceneSnapshot.h"
+#include "SimulationThread.h"
 
 namespace gen
 {
@@ -39,7 +42,7 @@ float SpiralTimer = 0.0f;
 const float SpiralSpeed = 1.0f;
 float HeatHazeTimer = 0.0f;
 const float HeatHazeSpeed = 1.0f;
-D3DXVECTOR3 TintColourHSL = D3DXVECTOR3(0.0f, 1.0f, 0.5f);
+CVector3 TintColourHSL = CVector3(0.0f, 1.0f, 0.5f);
 const float TintHueSpeed = 0.1f;
 float RippleTime = 0.0f;
 CVector2 RipplePosition = CVector2(0.0f, 0.0f);
@@ -48,7 +51,7 @@ float ShockwaveScale = 1.0f;
 float BlurStrength = 1.0f;
 
 // Separate effect file for full screen & area post-processes. Not necessary to use a separate file, but convenient given the architecture of this lab
-ID3D10Effect* PPEffect;
+TRenderHandle PPEffect = kNoRenderHandle;
 
 // Enumeration of different post-processes
 enum PostProcesses
@@ -61,77 +64,66 @@ enum PostProcesses
 const string PPTechniqueNames[NumPostProcesses] = { "PPCopy", "PPTint", "PPGreyNoise", "PPBurn", "PPDistort", "PPSpiral", "PPHeatHaze", "PPGaussianBlur", "PPRipple", "PPShockwave", "PPNegative" };
 const int PPTechniquePassCount[NumPostProcesses] = {	1,		1,			1,				1,		1,				1,			1,			2,					1,			1,				1};
 
+// Post-processes that output alpha below 1, so are blended over what is already in their render target rather than replacing it
+const bool PPTechniqueBlends[NumPostProcesses] = {	false,	false,		true,			false,	false,			true,		true,		false,				false,		false,			false};
+
 
-// Technique pointers for each post-process
-ID3D10EffectTechnique* PPTechniques[NumPostProcesses];
+// Technique handles for each post-process
+TRenderHandle PPTechniques[NumPostProcesses];
 
 // Currently used post process
 PostProcesses FullScreenFilter = Copy;
 list<PostProcesses> FullScreenFilterList;
 
 // Will render the scene to a texture in a first pass, then copy that texture to the back buffer in a second post-processing pass
-// So need a texture and two "views": a render target view (to render into the texture - 1st pass) and a shader resource view (use the rendered texture as a normal texture - 2nd pass)
-struct Texture2D
-{
-	ID3D10Texture2D* Texture;
-	ID3D10ShaderResourceView* Resource;
-	ID3D10RenderTargetView* Target;
-
-	Texture2D()
-	{
-		Texture = NULL;
-		Resource = NULL;
-		Target = NULL;
-	}
-	
-	void SafeRelease()
-	{
-		if (Target) Target->Release();
-		if (Resource) Resource->Release();
-		if (Texture) Texture->Release();
-	}
-};
-
-Texture2D BufferTextureA = Texture2D();
-Texture2D BufferTextureB = Texture2D();
-Texture2D* WriteBuffer = &BufferTextureA;
-Texture2D* ReadBuffer = &BufferTextureB;
-
-Texture2D LastFrameBuffer = Texture2D();
-Texture2D MultipassBuffer = Texture2D();
+// Each buffer is a render texture from the render device - it can be rendered to (1st pass) and used as a normal texture (2nd pass)
+TRenderHandle BufferTextureA = kNoRenderHandle;
+TRenderHandle BufferTextureB = kNoRenderHandle;
+TRenderHandle BufferTextureC = kNoRenderHandle;
+TRenderHandle* WriteBuffer = &BufferTextureA;
+TRenderHandle* ReadBuffer = &BufferTextureB;
+
+// The final image of the last frame. The three buffers rotate: each frame's final image becomes the history by swapping pointers rather than copying
+TRenderHandle* LastFrameBuffer = &BufferTextureC;
+TRenderHandle MultipassBuffer = kNoRenderHandle;
+
+// Area post-processes first draw their quad as an occlusion test with this predicate, and the post-process itself is predicated on
+// some of those pixels passing, so an area entirely hidden by nearer geometry is never shaded. The GPU's own hierarchical depth test
+// already rejects hidden tiles within a visible area before shading, as the post-process shaders neither write depth nor discard
+TRenderHandle AreaOcclusionPredicate = kNoRenderHandle;
 
 // Additional textures used by post-processes
-ID3D10ShaderResourceView* NoiseMap = NULL;
-ID3D10ShaderResourceView* BurnMap = NULL;
-ID3D10ShaderResourceView* DistortMap = NULL;
+TRenderHandle NoiseMap = kNoRenderHandle;
+TRenderHandle BurnMap = kNoRenderHandle;
+TRenderHandle DistortMap = kNoRenderHandle;
 
 // Variables to link C++ post-process textures to HLSL shader variables (for area / full-screen post-processing)
-ID3D10EffectShaderResourceVariable* SceneTextureVar = NULL;
-ID3D10EffectShaderResourceVariable* PostProcessMapVar = NULL; // Single shader variable used for the three maps above (noise, burn, distort). Only one is needed at a time
-ID3D10EffectShaderResourceVariable* PreviousSceneTextureVar = NULL;
-ID3D10EffectShaderResourceVariable* MultipassTextureVar = NULL;
+TRenderHandle SceneTextureVar = kNoRenderHandle;
+TRenderHandle PostProcessMapVar = kNoRenderHandle; // Single shader variable used for the three maps above (noise, burn, distort). Only one is needed at a time
+TRenderHandle PreviousSceneTextureVar = kNoRenderHandle;
+TRenderHandle MultipassTextureVar = kNoRenderHandle;
 
 
 // Variables specifying the area used for post-processing
-ID3D10EffectVectorVariable* PPAreaTopLeftVar = NULL;
-ID3D10EffectVectorVariable* PPAreaBottomRightVar = NULL;
-ID3D10EffectScalarVariable* PPAreaDepthVar = NULL;
+TRenderHandle PPAreaTopLeftVar = kNoRenderHandle;
+TRenderHandle PPAreaBottomRightVar = kNoRenderHandle;
+TRenderHandle PPAreaDepthVar = kNoRenderHandle;
 
 // Other variables for individual post-processes
-ID3D10EffectVectorVariable* TintColourVar = NULL;
-ID3D10EffectVectorVariable* NoiseScaleVar = NULL;
-ID3D10EffectVectorVariable* NoiseOffsetVar = NULL;
-ID3D10EffectScalarVariable* DistortLevelVar = NULL;
-ID3D10EffectScalarVariable* BurnLevelVar = NULL;
-ID3D10EffectScalarVariable* SpiralTimerVar = NULL;
-ID3D10EffectScalarVariable* HeatHazeTimerVar = NULL;
-ID3D10EffectScalarVariable* SceneWidthVar = NULL;
-ID3D10EffectScalarVariable* SceneHeightVar = NULL;
-ID3D10EffectScalarVariable* RippleTimeVar = NULL;
-ID3D10EffectVectorVariable* RipplePositionVar = NULL;
-ID3D10EffectScalarVariable* ShockwaveScaleVar = NULL;
-ID3D10EffectScalarVariable* ShockwaveSinVar = NULL;
-ID3D10EffectScalarVariable* BlurStrengthVar = NULL;
+TRenderHandle TintColourVar = kNoRenderHandle;
+TRenderHandle NoiseScaleVar = kNoRenderHandle;
+TRenderHandle NoiseOffsetVar = kNoRenderHandle;
+TRenderHandle DistortLevelVar = kNoRenderHandle;
+TRenderHandle BurnLevelVar = kNoRenderHandle;
+TRenderHandle SpiralTimerVar = kNoRenderHandle;
+TRenderHandle HeatHazeTimerVar = kNoRenderHandle;
+TRenderHandle SceneWidthVar = kNoRenderHandle;
+TRenderHandle SceneHeightVar = kNoRenderHandle;
+TRenderHandle RippleTimeVar = kNoRenderHandle;
+TRenderHandle RipplePositionVar = kNoRenderHandle;
+TRenderHandle ShockwaveScaleVar = kNoRenderHandle;
+TRenderHandle ShockwaveSinVar = kNoRenderHandle;
+TRenderHandle BlurStrengthVar = kNoRenderHandle;
 
 //*****************************************************************************
 
@@ -157,12 +149,11 @@ const float UpdateTimePeriod = 0.25f;
 extern const string MediaFolder;
 extern const string ShaderFolder;
 
-// Get reference to global DirectX variables from another source file
-extern ID3D10Device*           g_pd3dDevice;
-extern IDXGISwapChain*         SwapChain;
-extern ID3D10DepthStencilView* DepthStencilView;
-extern ID3D10RenderTargetView* BackBufferRenderTarget;
-extern ID3DX10Font*            OSDFont;
+// Render device used for all rendering, from another source file
+extern IRenderDevice* RenderDevice;
+
+// Cache in front of the render device that drops effect variable writes that would not change the value
+extern CStateCacheRenderDevice StateCache;
 
 // Actual viewport dimensions (fullscreen or windowed)
 extern TUInt32 BackBufferWidth;
@@ -184,11 +175,31 @@ extern CMessenger Messenger;
 CEntityManager EntityManager;
 CParseLevel LevelParser( &EntityManager );
 
+// Draws of the scene pass, sorted to reduce state changes, and of the post-processed polygons
+CDrawQueue SceneQueue;
+CDrawQueue PostProcessQueue;
+
 // Other scene elements
 const int NumLights = 2;
 CLight*  Lights[NumLights];
 CCamera* MainCamera;
 
+// The entities and lights are updated on the simulation thread at a fixed tick rate. Each frame
+// is rendered from the snapshots it publishes - interpolated between the last two ticks unless
+// switched off - with the lights copied into RenderLights. Only the camera, which follows the
+// keys every frame, and the post-processes are updated on the main thread
+const float SimulationTickTime = 1.0f / 60.0f;
+bool InterpolateTicks = true;
+CSnapshotExchange SceneSnapshots;
+CSimulationThread Simulation;
+CSnapshotFrame SceneFrame;
+CLight* RenderLights[NumLights];
+TEntityUID CubeyUID;
+
+// Simulation ticks per second over the last update time period
+TUInt32 LastSimulationTicks = 0;
+float SimulationTickRate = 0.0f;
+
 // Sum of recent update times and number of times in the sum - used to calculate
 // average over a given time period
 float SumUpdateTimes = 0.0f;
@@ -212,15 +223,49 @@ const float LightOrbitSpeed = 0.2f;
 //-----------------------------------------------------------------------------
 void CycleReadWriteBuffers(bool ClearWriteBuffer)
 {
-	Texture2D* TempBuffer = WriteBuffer;
+	TRenderHandle* TempBuffer = WriteBuffer;
 	WriteBuffer = ReadBuffer;
 	ReadBuffer = TempBuffer;
 
-	if (ClearWriteBuffer)	g_pd3dDevice->ClearRenderTargetView(WriteBuffer->Target, &AmbientColour.r);
+	if (ClearWriteBuffer)	RenderDevice->ClearRenderTarget(*WriteBuffer, &AmbientColour.r);
 
 }
 
 
+//-----------------------------------------------------------------------------
+// Simulation
+//-----------------------------------------------------------------------------
+
+// The scene update run on the simulation thread: entity updates and the scripted movement of the
+// cube, its light and the post-processed block
+class CSceneSimulation : public ISimulation
+{
+public:
+	void Tick( TFloat32 tickTime )
+	{
+		// Call all entity update functions
+		EntityManager.UpdateAllEntities( tickTime );
+
+		// Rotate cube and attach light to it
+		CEntity* cubey = EntityManager.GetEntity( "Cubey" );
+		cubey->Matrix().RotateX( ToRadians(53.0f) * tickTime );
+		cubey->Matrix().RotateZ( ToRadians(42.0f) * tickTime );
+		cubey->Matrix().RotateWorldY( ToRadians(12.0f) * tickTime );
+		Lights[1]->SetPosition( cubey->Position() );
+
+		// Rotate polygon post-processed entity
+		CEntity* ppEntity = EntityManager.GetEntity( "PostProcessBlock" );
+		ppEntity->Matrix().RotateY( ToRadians(30.0f) * tickTime );
+	}
+
+	void Capture( CSceneSnapshot& snapshot, TUInt32 tick, TFloat64 time )
+	{
+		snapshot.Capture( EntityManager, Lights, NumLights, tick, time );
+	}
+};
+CSceneSimulation SceneSimulation;
+
+
 //-----------------------------------------------------------------------------
 // Scene management
 //-----------------------------------------------------------------------------
@@ -230,6 +275,9 @@ bool SceneSetup()
 {
 	// Prepare render methods
 	InitialiseMethods();
+
+	// Buffer of world matrices for instanced scene draws, grows if needed
+	SceneQueue.InitialiseInstancing( 1024 );
 	
 	// Read templates and entities from XML file
 	if (!LevelParser.ParseFile( "Entities.xml" )) return false;
@@ -244,6 +292,18 @@ bool SceneSetup()
 	// Light orbiting area
 	Lights[1] = new CLight(LightCentre, SColourRGBA(0.0f, 0.2f, 1.0f) * 50, 100.0f);
 
+	// Lights used by the render, set from the simulation's snapshots each frame
+	for (int light = 0; light < NumLights; ++light)
+	{
+		RenderLights[light] = new CLight( Lights[light]->GetPosition(), Lights[light]->GetColour(), Lights[light]->GetBrightness() );
+	}
+
+	// The area post-process follows the cube
+	CubeyUID = EntityManager.GetEntity( "Cubey" )->GetUID();
+
+	// From here on only the simulation thread uses the entities and lights
+	Simulation.Start( &SceneSimulation, &SceneSnapshots, SimulationTickTime );
+
 	return true;
 }
 
@@ -251,12 +311,17 @@ bool SceneSetup()
 // Release everything in the scene
 void SceneShutdown()
 {
-	// Release render methods
+	// Stop the simulation before releasing what it uses
+	Simulation.Stop();
+
+	// Release render methods and the scene queue's instance buffer
 	ReleaseMethods();
+	SceneQueue.ReleaseInstancing();
 
 	// Release lights
 	for (int light = NumLights - 1; light >= 0; --light)
 	{
+		delete RenderLights[light];
 		delete Lights[light];
 	}
 
@@ -277,88 +342,63 @@ void SceneShutdown()
 bool PostProcessSetup()
 {
 
-	// Create the "scene texture" - the texture into which the scene will be rendered in the first pass
-	D3D10_TEXTURE2D_DESC textureDesc;
-	textureDesc.Width  = BackBufferWidth;  // Match views to viewport size
-	textureDesc.Height = BackBufferHeight;
-	textureDesc.MipLevels = 1; // No mip-maps when rendering to textures (or we will have to render every level)
-	textureDesc.ArraySize = 1;
-	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // RGBA texture (8-bits each)
-	textureDesc.SampleDesc.Count = 1;
-	textureDesc.SampleDesc.Quality = 0;
-	textureDesc.Usage = D3D10_USAGE_DEFAULT;
-	textureDesc.BindFlags = D3D10_BIND_RENDER_TARGET | D3D10_BIND_SHADER_RESOURCE; // Indicate we will use texture as render target, and pass it to shaders
-	textureDesc.CPUAccessFlags = 0;
-	textureDesc.MiscFlags = 0;
-	if (FAILED(g_pd3dDevice->CreateTexture2D(&textureDesc, NULL, &BufferTextureA.Texture))) return false;
-	if (FAILED(g_pd3dDevice->CreateTexture2D( &textureDesc, NULL, &BufferTextureB.Texture ))) return false;
-	if (FAILED(g_pd3dDevice->CreateTexture2D(&textureDesc, NULL, &LastFrameBuffer.Texture))) return false;
-	if (FAILED(g_pd3dDevice->CreateTexture2D(&textureDesc, NULL, &MultipassBuffer.Texture))) return false;
-
-
-	// Get a "view" of the texture as a render target - giving us an interface for rendering to the texture
-	if (FAILED(g_pd3dDevice->CreateRenderTargetView(BufferTextureA.Texture, NULL, &BufferTextureA.Target))) return false;
-	if (FAILED(g_pd3dDevice->CreateRenderTargetView(BufferTextureB.Texture, NULL, &BufferTextureB.Target))) return false;
-	if (FAILED(g_pd3dDevice->CreateRenderTargetView(LastFrameBuffer.Texture, NULL, &LastFrameBuffer.Target ))) return false;
-	if (FAILED(g_pd3dDevice->CreateRenderTargetView(MultipassBuffer.Texture, NULL, &MultipassBuffer.Target ))) return false;
-
-	// And get a shader-resource "view" - giving us an interface for passing the texture to shaders
-	D3D10_SHADER_RESOURCE_VIEW_DESC srDesc;
-	srDesc.Format = textureDesc.Format;
-	srDesc.ViewDimension = D3D10_SRV_DIMENSION_TEXTURE2D;
-	srDesc.Texture2D.MostDetailedMip = 0;
-	srDesc.Texture2D.MipLevels = 1;
-	if (FAILED(g_pd3dDevice->CreateShaderResourceView(BufferTextureA.Texture, &srDesc, &BufferTextureA.Resource))) return false;
-	if (FAILED(g_pd3dDevice->CreateShaderResourceView(BufferTextureB.Texture, &srDesc, &BufferTextureB.Resource))) return false;
-	if (FAILED(g_pd3dDevice->CreateShaderResourceView(LastFrameBuffer.Texture, &srDesc, &LastFrameBuffer.Resource ))) return false;
-	if (FAILED(g_pd3dDevice->CreateShaderResourceView(MultipassBuffer.Texture, &srDesc, &MultipassBuffer.Resource ))) return false;
+	// Create the "scene textures" - the textures into which the scene will be rendered in the first pass. They have the back buffer's
+	// size and format, so the final image can be copied to the back buffer without a shader pass
+	BufferTextureA = RenderDevice->CreateRenderTexture(BackBufferWidth, BackBufferHeight);
+	BufferTextureB = RenderDevice->CreateRenderTexture(BackBufferWidth, BackBufferHeight);
+	BufferTextureC = RenderDevice->CreateRenderTexture(BackBufferWidth, BackBufferHeight);
+	MultipassBuffer = RenderDevice->CreateRenderTexture(BackBufferWidth, BackBufferHeight);
+	if (!BufferTextureA || !BufferTextureB || !BufferTextureC || !MultipassBuffer) return false;
+
+	// Predicate for the area post-process occlusion test
+	AreaOcclusionPredicate = RenderDevice->CreateOcclusionPredicate();
+	if (!AreaOcclusionPredicate) return false;
 
 	// Load post-processing support textures
-	if (FAILED( D3DX10CreateShaderResourceViewFromFile( g_pd3dDevice, (MediaFolder + "Noise.png").c_str() ,   NULL, NULL, &NoiseMap,   NULL ) )) return false;
-	if (FAILED( D3DX10CreateShaderResourceViewFromFile( g_pd3dDevice, (MediaFolder + "Burn.png").c_str() ,    NULL, NULL, &BurnMap,    NULL ) )) return false;
-	if (FAILED( D3DX10CreateShaderResourceViewFromFile( g_pd3dDevice, (MediaFolder + "Distort.png").c_str() , NULL, NULL, &DistortMap, NULL ) )) return false;
+	NoiseMap   = RenderDevice->LoadTexture( MediaFolder + "Noise.png" );
+	BurnMap    = RenderDevice->LoadTexture( MediaFolder + "Burn.png" );
+	DistortMap = RenderDevice->LoadTexture( MediaFolder + "Distort.png" );
+	if (!NoiseMap || !BurnMap || !DistortMap) return false;
 
 
 	// Load and compile a separate effect file for post-processes.
-	ID3D10Blob* pErrors;
-	DWORD dwShaderFlags = D3D10_SHADER_ENABLE_STRICTNESS; // These "flags" are used to set the compiler options
-
-	string fullFileName = ShaderFolder + "PostProcess.fx";
-	if( FAILED( D3DX10CreateEffectFromFile( fullFileName.c_str(), NULL, NULL, "fx_4_0", dwShaderFlags, 0, g_pd3dDevice, NULL, NULL, &PPEffect, &pErrors, NULL ) ))
+	string errors;
+	PPEffect = RenderDevice->LoadEffect( ShaderFolder + "PostProcess.fx", errors );
+	if (!PPEffect)
 	{
-		if (pErrors != 0)  MessageBox( NULL, reinterpret_cast<char*>(pErrors->GetBufferPointer()), "Error", MB_OK ); // Compiler error: display error message
-		else               MessageBox( NULL, "Error loading FX file. Ensure your FX file is in the same folder as this executable.", "Error", MB_OK );  // No error message - probably file not found
+		if (errors != "")  SystemMessageBox( errors.c_str(), "Error" ); // Compiler error: display error message
+		else               SystemMessageBox( "Error loading FX file. Ensure your FX file is in the same folder as this executable.", "Error" );  // No error message - probably file not found
 		return false;
 	}
 
 	// There's an array of post-processing technique names above - get array of post-process techniques matching those names from the compiled effect file
 	for (int pp = 0; pp < NumPostProcesses; pp++)
 	{
-		PPTechniques[pp] = PPEffect->GetTechniqueByName( PPTechniqueNames[pp].c_str() );
+		PPTechniques[pp] = RenderDevice->GetTechnique( PPEffect, PPTechniqueNames[pp] );
 	}
 
 	// Link to HLSL variables in post-process shaders
-	SceneTextureVar      = PPEffect->GetVariableByName( "SceneTexture" )->AsShaderResource();
-	PostProcessMapVar    = PPEffect->GetVariableByName( "PostProcessMap" )->AsShaderResource();
-	PreviousSceneTextureVar = PPEffect->GetVariableByName("PreviousSceneTexture")->AsShaderResource();
-	MultipassTextureVar = PPEffect->GetVariableByName("MultipassTexture")->AsShaderResource();
-	PPAreaTopLeftVar     = PPEffect->GetVariableByName( "PPAreaTopLeft" )->AsVector();
-	PPAreaBottomRightVar = PPEffect->GetVariableByName( "PPAreaBottomRight" )->AsVector();
-	PPAreaDepthVar       = PPEffect->GetVariableByName( "PPAreaDepth" )->AsScalar();
-	TintColourVar        = PPEffect->GetVariableByName( "TintColour" )->AsVector();
-	NoiseScaleVar        = PPEffect->GetVariableByName( "NoiseScale" )->AsVector();
-	NoiseOffsetVar       = PPEffect->GetVariableByName( "NoiseOffset" )->AsVector();
-	DistortLevelVar      = PPEffect->GetVariableByName( "DistortLevel" )->AsScalar();
-	BurnLevelVar         = PPEffect->GetVariableByName( "BurnLevel" )->AsScalar();
-	SpiralTimerVar       = PPEffect->GetVariableByName( "SpiralTimer" )->AsScalar();
-	HeatHazeTimerVar     = PPEffect->GetVariableByName( "HeatHazeTimer" )->AsScalar();
-	SceneWidthVar		 = PPEffect->GetVariableByName( "SceneTextureWidth")->AsScalar();
-	SceneHeightVar		 = PPEffect->GetVariableByName( "SceneTextureHeight")->AsScalar();
-	RippleTimeVar		 = PPEffect->GetVariableByName( "RippleTime" )->AsScalar();
-	RipplePositionVar	 = PPEffect->GetVariableByName( "RipplePosition" )->AsVector();
-	ShockwaveScaleVar	 = PPEffect->GetVariableByName( "ShockwaveScale")->AsScalar();
-	ShockwaveSinVar		 = PPEffect->GetVariableByName( "ShockwaveSin")->AsScalar();
-	BlurStrengthVar		 = PPEffect->GetVariableByName( "BlurStrength")->AsScalar();
+	SceneTextureVar      = RenderDevice->GetVariable( PPEffect, "SceneTexture" );
+	PostProcessMapVar    = RenderDevice->GetVariable( PPEffect, "PostProcessMap" );
+	PreviousSceneTextureVar = RenderDevice->GetVariable( PPEffect, "PreviousSceneTexture" );
+	MultipassTextureVar = RenderDevice->GetVariable( PPEffect, "MultipassTexture" );
+	PPAreaTopLeftVar     = RenderDevice->GetVariable( PPEffect, "PPAreaTopLeft" );
+	PPAreaBottomRightVar = RenderDevice->GetVariable( PPEffect, "PPAreaBottomRight" );
+	PPAreaDepthVar       = RenderDevice->GetVariable( PPEffect, "PPAreaDepth" );
+	TintColourVar        = RenderDevice->GetVariable( PPEffect, "TintColour" );
+	NoiseScaleVar        = RenderDevice->GetVariable( PPEffect, "NoiseScale" );
+	NoiseOffsetVar       = RenderDevice->GetVariable( PPEffect, "NoiseOffset" );
+	DistortLevelVar      = RenderDevice->GetVariable( PPEffect, "DistortLevel" );
+	BurnLevelVar         = RenderDevice->GetVariable( PPEffect, "BurnLevel" );
+	SpiralTimerVar       = RenderDevice->GetVariable( PPEffect, "SpiralTimer" );
+	HeatHazeTimerVar     = RenderDevice->GetVariable( PPEffect, "HeatHazeTimer" );
+	SceneWidthVar		 = RenderDevice->GetVariable( PPEffect, "SceneTextureWidth" );
+	SceneHeightVar		 = RenderDevice->GetVariable( PPEffect, "SceneTextureHeight" );
+	RippleTimeVar		 = RenderDevice->GetVariable( PPEffect, "RippleTime" );
+	RipplePositionVar	 = RenderDevice->GetVariable( PPEffect, "RipplePosition" );
+	ShockwaveScaleVar	 = RenderDevice->GetVariable( PPEffect, "ShockwaveScale" );
+	ShockwaveSinVar		 = RenderDevice->GetVariable( PPEffect, "ShockwaveSin" );
+	BlurStrengthVar		 = RenderDevice->GetVariable( PPEffect, "BlurStrength" );
 
 	FullScreenFilterList.push_back(Copy);
 
@@ -367,15 +407,16 @@ bool PostProcessSetup()
 
 void PostProcessShutdown()
 {
-	if (PPEffect)            PPEffect->Release();
-	if (DistortMap)          DistortMap->Release();
-	if (BurnMap)             BurnMap->Release();
-	if (NoiseMap)            NoiseMap->Release();
+	RenderDevice->Release(PPEffect);
+	RenderDevice->Release(DistortMap);
+	RenderDevice->Release(BurnMap);
+	RenderDevice->Release(NoiseMap);
 
-	BufferTextureA.SafeRelease();
-	BufferTextureB.SafeRelease();
-	LastFrameBuffer.SafeRelease();	
-	MultipassBuffer.SafeRelease();
+	RenderDevice->Release(BufferTextureA);
+	RenderDevice->Release(BufferTextureB);
+	RenderDevice->Release(BufferTextureC);
+	RenderDevice->Release(MultipassBuffer);
+	RenderDevice->Release(AreaOcclusionPredicate);
 
 }
 //*****************************************************************************
@@ -388,20 +429,20 @@ void PostProcessShutdown()
 // Set up shaders for given post-processing filter (used for full screen and area processing)
 void SelectPostProcess( PostProcesses filter )
 {
-	SceneHeightVar->SetFloat(BackBufferHeight);
-	SceneWidthVar->SetFloat(BackBufferWidth);
+	RenderDevice->SetFloat(SceneHeightVar, BackBufferHeight);
+	RenderDevice->SetFloat(SceneWidthVar, BackBufferWidth);
 
 	switch (filter)
 	{
 		case Tint:
 		{
-			D3DXCOLOR TintColour = D3DXCOLOR(1.0f, 0.0f, 0.0f, 1.0f);
+			SColourRGBA TintColour = SColourRGBA(1.0f, 0.0f, 0.0f, 1.0f);
 
 			HSLToRGB(TintColourHSL.x, TintColourHSL.y, TintColourHSL.z, TintColour.r, TintColour.g, TintColour.b);
 
 			// Set the colour used to tint the scene
 			
-			TintColourVar->SetRawValue( &TintColour, 0, 12 );
+			RenderDevice->SetVector( TintColourVar, &TintColour.r, 3 );
 		}
 		break;
 
@@ -411,24 +452,24 @@ void SelectPostProcess( PostProcesses filter )
 
 			// Set shader constants - scale and offset for noise. Scaling adjusts how fine the noise is.
 			CVector2 NoiseScale = CVector2( BackBufferWidth / GrainSize, BackBufferHeight / GrainSize );
-			NoiseScaleVar->SetRawValue( &NoiseScale, 0, 8 );
+			RenderDevice->SetVector( NoiseScaleVar, &NoiseScale.x, 2 );
 
 			// The offset is randomised to give a constantly changing noise effect (like tv static)
 			CVector2 RandomUVs = CVector2( Random( 0.0f,1.0f ),Random( 0.0f,1.0f ) );
-			NoiseOffsetVar->SetRawValue( &RandomUVs, 0, 8 );
+			RenderDevice->SetVector( NoiseOffsetVar, &RandomUVs.x, 2 );
 
 			// Set noise texture
-			PostProcessMapVar->SetResource( NoiseMap );
+			RenderDevice->SetTexture( PostProcessMapVar, NoiseMap );
 		break;
 		}
 
 		case Burn:
 		{
 			// Set the burn level (value from 0 to 1 during animation)
-			BurnLevelVar->SetFloat( BurnLevel );
+			RenderDevice->SetFloat( BurnLevelVar, BurnLevel );
 
 			// Set burn texture
-			PostProcessMapVar->SetResource( BurnMap );
+			RenderDevice->SetTexture( PostProcessMapVar, BurnMap );
 		break;
 		}
 
@@ -436,46 +477,46 @@ void SelectPostProcess( PostProcesses filter )
 		{
 			// Set the level of distortion
 			const float DistortLevel = 0.03f;
-			DistortLevelVar->SetFloat( DistortLevel );
+			RenderDevice->SetFloat( DistortLevelVar, DistortLevel );
 
 			// Set distort texture
-			PostProcessMapVar->SetResource( DistortMap );
+			RenderDevice->SetTexture( PostProcessMapVar, DistortMap );
 		break;
 		}
 
 		case Spiral:
 		{
 			// Set the amount of spiral - use a tweaked cos wave to animate
-			SpiralTimerVar->SetFloat( (1.0f - Cos(SpiralTimer)) * 4.0f );
+			RenderDevice->SetFloat( SpiralTimerVar, (1.0f - Cos(SpiralTimer)) * 4.0f );
 			break;
 		}
 
 		case HeatHaze:
 		{
 			// Set the amount of spiral - use a tweaked cos wave to animate
-			HeatHazeTimerVar->SetFloat( HeatHazeTimer );
+			RenderDevice->SetFloat( HeatHazeTimerVar, HeatHazeTimer );
 			break;
 		}
 
 		case GaussianBlur:
 		{
-			BlurStrengthVar->SetFloat(BlurStrength);
+			RenderDevice->SetFloat(BlurStrengthVar, BlurStrength);
 			break;
 		}
 
 		case Ripple:
 		{
-			RippleTimeVar->SetFloat(RippleTime);
+			RenderDevice->SetFloat(RippleTimeVar, RippleTime);
 			
-			RipplePositionVar->SetRawValue(&RipplePosition, 0, 8);
+			RenderDevice->SetVector(RipplePositionVar, &RipplePosition.x, 2);
 			break;
 		}
 
 		case Shockwave:
 		{
 			float foo = Sin(ShockwaveSin);
-			ShockwaveSinVar->SetFloat( Sin(ShockwaveSin) * ShockwaveScale );
-			ShockwaveScaleVar->SetFloat(ShockwaveScale);
+			RenderDevice->SetFloat( ShockwaveSinVar, Sin(ShockwaveSin) * ShockwaveScale );
+			RenderDevice->SetFloat(ShockwaveScaleVar, ShockwaveScale);
 			break;
 		}
 
@@ -661,9 +702,9 @@ void SetPostProcessArea( CCamera* camera, CVector3 areaCentre, float width, floa
 
 	// Send the values calculated to the shader. The post-processing vertex shader needs only these values to
 	// create the vertex buffer for the quad to render, we don't need to create a vertex buffer for post-processing at all.
-	PPAreaTopLeftVar->SetRawValue( &projTopLeft.Vector2(), 0, 8 );         // Viewport space x & y for top-left
-	PPAreaBottomRightVar->SetRawValue( &projBottomRight.Vector2(), 0, 8 ); // Same for bottom-right
-	PPAreaDepthVar->SetFloat( projTopLeft.z ); // Depth buffer value for area
+	RenderDevice->SetVector( PPAreaTopLeftVar, &projTopLeft.x, 2 );         // Viewport space x & y for top-left
+	RenderDevice->SetVector( PPAreaBottomRightVar, &projBottomRight.x, 2 ); // Same for bottom-right
+	RenderDevice->SetFloat( PPAreaDepthVar, projTopLeft.z ); // Depth buffer value for area
 
 	// ***NOTE*** Most applications you will see doing post-processing would continue here to create a vertex buffer in C++, and would
 	// not use the unusual vertex shader that you will see in the .fx file here. That might (or might not) give a tiny performance boost,
@@ -677,9 +718,9 @@ void SetFullScreenPostProcessArea()
 	CVector2 TopLeftUV     = CVector2( 0.0f, 0.0f ); // Top-left and bottom-right in UV space
 	CVector2 BottomRightUV = CVector2( 1.0f, 1.0f );
 
-	PPAreaTopLeftVar->SetRawValue( &TopLeftUV, 0, 8 );
-	PPAreaBottomRightVar->SetRawValue( &BottomRightUV, 0, 8 );
-	PPAreaDepthVar->SetFloat( 0.0f ); // Full screen depth set at 0 - in front of everything
+	RenderDevice->SetVector( PPAreaTopLeftVar, &TopLeftUV.x, 2 );
+	RenderDevice->SetVector( PPAreaBottomRightVar, &BottomRightUV.x, 2 );
+	RenderDevice->SetFloat( PPAreaDepthVar, 0.0f ); // Full screen depth set at 0 - in front of everything
 }
 
 
@@ -687,42 +728,63 @@ void SetFullScreenPostProcessArea()
 // Game loop functions
 //-----------------------------------------------------------------------------
 
-void RenderBaseScene(ID3D10RenderTargetView* renderTarget)
+void RenderBaseScene(TRenderHandle renderTarget)
 {
 	//------------------------------------------------
 	// SCENE RENDER PASS - rendering to a texture
 
 	// Specify that we will render to the scene texture in this first pass (rather than the backbuffer), will share the depth/stencil buffer with the backbuffer though
-	g_pd3dDevice->OMSetRenderTargets(1, &renderTarget, DepthStencilView);
+	RenderDevice->SetRenderTarget(renderTarget);
 
 	// Clear the texture and the depth buffer
-	g_pd3dDevice->ClearRenderTargetView(renderTarget, &AmbientColour.r);
-	g_pd3dDevice->ClearDepthStencilView(DepthStencilView, D3D10_CLEAR_DEPTH, 1.0f, 0);
+	RenderDevice->ClearRenderTarget(renderTarget, &AmbientColour.r);
+	RenderDevice->ClearDepth(1.0f);
 
 	// Prepare camera
 	MainCamera->SetAspect(static_cast<TFloat32>(BackBufferWidth) / BackBufferHeight);
 	MainCamera->CalculateMatrices();
 	MainCamera->CalculateFrustrumPlanes();
 
+	// Take the latest snapshots from the simulation and make this frame's scene from them, one tick behind the simulation time
+	// so it lies between the two
+	const CSceneSnapshot* previousSnapshot;
+	const CSceneSnapshot* latestSnapshot;
+	SceneSnapshots.Acquire(previousSnapshot, latestSnapshot);
+	float t = 1.0f;
+	if (InterpolateTicks)
+	{
+		t = CSnapshotFrame::InterpolationFactor(*previousSnapshot, *latestSnapshot, Simulation.Time() - Simulation.TickTime());
+	}
+	SceneFrame.Build(*previousSnapshot, *latestSnapshot, t, NumWorkerThreads());
+	for (int light = 0; light < NumLights; ++light)
+	{
+		RenderLights[light]->SetPosition(SceneFrame.LightPosition(light));
+		RenderLights[light]->SetColour(latestSnapshot->Light(light).Colour);
+		RenderLights[light]->SetBrightness(latestSnapshot->Light(light).Brightness);
+	}
+
 	// Set camera and light data in shaders
 	SetCamera(MainCamera);
 	SetAmbientLight(AmbientColour);
-	SetLights(&Lights[0]);
+	SetLights(&RenderLights[0]);
 
-	// Render entities
-	EntityManager.RenderAllEntities(MainCamera);
+	// Render entities - queue a draw for each visible sub-mesh (spread over the worker threads) then submit them sorted by state
+	SceneQueue.Clear();
+	SceneFrame.Queue(&SceneQueue, MainCamera, NumWorkerThreads());
+	SceneQueue.Sort();
+	SceneQueue.Submit();
 
 }
 
-void RenderFullscreenPostProcess(PostProcesses filter, ID3D10RenderTargetView* renderTarget, ID3D10ShaderResourceView* shaderResource)
+void RenderFullscreenPostProcess(PostProcesses filter, TRenderHandle renderTarget, TRenderHandle shaderResource)
 {
 
 	//------------------------------------------------
 	// FULL SCREEN POST PROCESS RENDER PASS - Render full screen quad on the back-buffer mapped with the scene texture, with post-processing
 
 	// Select the back buffer to use for rendering (will ignore depth-buffer for full-screen quad) and select scene texture for use in shader
-	SceneTextureVar->SetResource(shaderResource);
-	PreviousSceneTextureVar->SetResource(LastFrameBuffer.Resource);
+	RenderDevice->SetTexture(SceneTextureVar, shaderResource);
+	RenderDevice->SetTexture(PreviousSceneTextureVar, *LastFrameBuffer);
 
 	// Prepare shader settings for the current full screen filter
 	SelectPostProcess(filter);
@@ -730,30 +792,30 @@ void RenderFullscreenPostProcess(PostProcesses filter, ID3D10RenderTargetView* r
 
 									// Using special vertex shader than creates its own data for a full screen quad (see .fx file). No need to set vertex/index buffer, just draw 4 vertices of quad
 									// Select technique to match currently selected post-process
-	g_pd3dDevice->IASetInputLayout(NULL);
-	g_pd3dDevice->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+	RenderDevice->SetInputLayout(kNoRenderHandle);
+	RenderDevice->SetPrimitiveTopology(kTriangleStrip);
 	
 	if(PPTechniquePassCount[filter] > 1)	//More than one pass
 	{
 		//Write to multipass buffer
-		g_pd3dDevice->OMSetRenderTargets(1, &MultipassBuffer.Target, DepthStencilView); // No need to clear the back-buffer, we're going to overwrite it all
+		RenderDevice->SetRenderTarget(MultipassBuffer); // No need to clear the back-buffer, we're going to overwrite it all
 	}
 	else
 	{
 		//Write to render target
-		g_pd3dDevice->OMSetRenderTargets(1, &renderTarget, DepthStencilView); // No need to clear the back-buffer, we're going to overwrite it all
+		RenderDevice->SetRenderTarget(renderTarget); // No need to clear the back-buffer, we're going to overwrite it all
 	}
 	//Perform 0th pass
-	PPTechniques[filter]->GetPassByIndex(0)->Apply(0);
-	g_pd3dDevice->Draw(4, 0);
+	RenderDevice->ApplyPass(PPTechniques[filter], 0);
+	RenderDevice->Draw(4, 0);
 	
 	if (PPTechniquePassCount[filter] > 1)
 	{
-		MultipassTextureVar->SetResource(MultipassBuffer.Resource);
-		g_pd3dDevice->OMSetRenderTargets(1, &renderTarget, DepthStencilView); // No need to clear the back-buffer, we're going to overwrite it all
+		RenderDevice->SetTexture(MultipassTextureVar, MultipassBuffer);
+		RenderDevice->SetRenderTarget(renderTarget); // No need to clear the back-buffer, we're going to overwrite it all
 
-		PPTechniques[filter]->GetPassByIndex(1)->Apply(0);
-		g_pd3dDevice->Draw(4, 0);
+		RenderDevice->ApplyPass(PPTechniques[filter], 1);
+		RenderDevice->Draw(4, 0);
 
 	}
 
@@ -761,33 +823,35 @@ void RenderFullscreenPostProcess(PostProcesses filter, ID3D10RenderTargetView* r
 	//------------------------------------------------
 }
 
-void RenderPostProcessedPolygons(ID3D10RenderTargetView* renderTarget, ID3D10ShaderResourceView* shaderResource)
+void RenderPostProcessedPolygons(TRenderHandle renderTarget, TRenderHandle shaderResource)
 {
-	g_pd3dDevice->OMSetRenderTargets(1, &renderTarget, DepthStencilView); // No need to clear the back-buffer, we're going to overwrite it all
+	RenderDevice->SetRenderTarget(renderTarget); // No need to clear the back-buffer, we're going to overwrite it all
 
 	//**|PPPOLY|***************************************
 	// POLY POST PROCESS RENDER PASS
 	// The scene has been rendered in full into a texture then copied to the back-buffer. However, the post-processed polygons were missed out. Now render the entities
 	// again, but only the post-processed materials. These are rendered to the back-buffer in the correct places in the scene, but most importantly their shaders will
 	// have the scene texture available to them. So these polygons can distort or affect the scene behind them (e.g. distortion through cut glass). Note that this also
-	// means we can do blending (additive, multiplicative etc.) in the shader. The post-processed materials are identified with a boolean (RenderMethod.cpp). This entire
-	// approach works even better with "bucket" rendering, where post-process shaders are held in a separate bucket - making it unnecessary to "RenderAllEntities" as 
-	// we are doing here.
+	// means we can do blending (additive, multiplicative etc.) in the shader. The post-processed materials are identified with a boolean (RenderMethod.cpp). The entities
+	// belong to the simulation thread, so the post-processed sub-meshes are queued from this frame's snapshot, which holds a copy of the entity manager's post-process
+	// bucket. Only the sub-meshes in the bucket whose entities were visible in the scene pass are visited.
 
 	/// NOTE: Post-processing - need to set the back buffer as a render target. Relying on the fact that the section above already did that
 	// Polygon post-processing occurs in the scene rendering code (RenderMethod.cpp) - so pass over the scene texture and viewport dimensions for the scene post-processing materials/shaders
 	SetSceneTexture(shaderResource, BackBufferWidth, BackBufferHeight);
 
-	// Render all entities again, but flag that we only want the post-processed polygons
-	EntityManager.RenderAllEntities(MainCamera, true);
+	// Render the post-processed polygons, using the world matrices and visibility of the scene pass, in bucket order (unsorted) as they may blend
+	PostProcessQueue.Clear();
+	SceneFrame.QueuePostProcess(&PostProcessQueue, MainCamera);
+	PostProcessQueue.Submit();
 
 	//************************************************
 }
 
-void RenderAreaPostProcess( PostProcesses postProcess, ID3D10RenderTargetView* renderTarget, ID3D10ShaderResourceView* shaderResource, CVector3 targetPosition, float width, float height, float depthOffset)
+void RenderAreaPostProcess( PostProcesses postProcess, TRenderHandle renderTarget, TRenderHandle shaderResource, CVector3 targetPosition, float width, float height, float depthOffset)
 {
-	g_pd3dDevice->OMSetRenderTargets(1, &renderTarget, DepthStencilView); // No need to clear the back-buffer, we're going to overwrite it all
-	SceneTextureVar->SetResource(shaderResource);
+	RenderDevice->SetRenderTarget(renderTarget); // No need to clear the back-buffer, we're going to overwrite it all
+	RenderDevice->SetTexture(SceneTextureVar, shaderResource);
 
 	// AREA POST PROCESS RENDER PASS - Render smaller quad on the back-buffer mapped with a matching area of the scene texture, with different post-processing
 
@@ -801,89 +865,102 @@ void RenderAreaPostProcess( PostProcesses postProcess, ID3D10RenderTargetView* r
 
 	// Select one of the post-processing techniques and render the area using it
 	SelectPostProcess(postProcess); // Make sure you also update the line below when you change the post-process method here!
-	g_pd3dDevice->IASetInputLayout(NULL);
-	g_pd3dDevice->IASetPrimitiveTopology(D3D10_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
-	PPTechniques[postProcess]->GetPassByIndex(0)->Apply(0);
-	g_pd3dDevice->Draw(4, 0);
+	RenderDevice->SetInputLayout(kNoRenderHandle);
+	RenderDevice->SetPrimitiveTopology(kTriangleStrip);
+
+	// Occlusion test - the technique's quad and depth state with no pixel shader or colour writes
+	RenderDevice->ApplyPass(PPTechniques[postProcess], 0);
+	RenderDevice->BeginOcclusionTest(AreaOcclusionPredicate);
+	RenderDevice->Draw(4, 0);
+	RenderDevice->EndOcclusionTest(AreaOcclusionPredicate);
+
+	// The GPU skips the post-process draw if no pixels passed, the CPU never waits for the result
+	RenderDevice->SetPredication(AreaOcclusionPredicate);
+	RenderDevice->ApplyPass(PPTechniques[postProcess], 0);
+	RenderDevice->Draw(4, 0);
+	RenderDevice->SetPredication(kNoRenderHandle);
 }
 
 // Draw one frame of the scene
 void RenderScene()
 {
 	// Setup the viewport - defines which part of the back-buffer we will render to (usually all of it)
-	D3D10_VIEWPORT vp;
-	vp.Width  = BackBufferWidth;
-	vp.Height = BackBufferHeight;
-	vp.MinDepth = 0.0f;
-	vp.MaxDepth = 1.0f;
-	vp.TopLeftX = 0;
-	vp.TopLeftY = 0;
-	g_pd3dDevice->RSSetViewports( 1, &vp );
+	RenderDevice->SetViewport( BackBufferWidth, BackBufferHeight );
 
-	g_pd3dDevice->ClearRenderTargetView(BackBufferRenderTarget, &AmbientColour.r);
-	g_pd3dDevice->ClearRenderTargetView(ReadBuffer->Target, &AmbientColour.r);
-	g_pd3dDevice->ClearRenderTargetView(WriteBuffer->Target, &AmbientColour.r);
+	RenderDevice->ClearRenderTarget(RenderDevice->BackBuffer(), &AmbientColour.r);
+	RenderDevice->ClearRenderTarget(*ReadBuffer, &AmbientColour.r);
+	RenderDevice->ClearRenderTarget(*WriteBuffer, &AmbientColour.r);
 
 
 	//------------------------------------------------
 	//Render Base Scene onto WriteBuffer
-	RenderBaseScene(WriteBuffer->Target);
+	RenderBaseScene(*WriteBuffer);
 	
 	
 	//-----------------------------------------------
 	//Make Read and write buffers have same information so that drawing polygons can effectively write to their own source information
 
-	g_pd3dDevice->CopyResource(ReadBuffer->Texture, WriteBuffer->Texture);
-	RenderPostProcessedPolygons(WriteBuffer->Target, ReadBuffer->Resource);
+	RenderDevice->CopyTexture(*ReadBuffer, *WriteBuffer);
+	RenderPostProcessedPolygons(*WriteBuffer, *ReadBuffer);
 	
 	//------------------------------------------------
 	//Make Read and write buffers have same information so that drawing AreaPostProcess can effectively write to its own source information
 
-	g_pd3dDevice->CopyResource(ReadBuffer->Texture, WriteBuffer->Texture);
-	RenderAreaPostProcess(Spiral, WriteBuffer->Target, ReadBuffer->Resource, EntityManager.GetEntity("Cubey")->Position(), 20.0f, 20.0f, -9.0f);
+	RenderDevice->CopyTexture(*ReadBuffer, *WriteBuffer);
+	CMatrix4x4 cubeyMatrix;
+	if (SceneFrame.GetEntityMatrix(CubeyUID, cubeyMatrix))
+	{
+		RenderAreaPostProcess(Spiral, *WriteBuffer, *ReadBuffer, cubeyMatrix.Position(), 20.0f, 20.0f, -9.0f);
+	}
 	
 	//------------------------------------------------
 
+	// A blending filter draws over the contents its buffer was left with by earlier passes, which a Copy pass changes. Copy passes
+	// with no blending filter after them leave the image as it is, so are skipped - with just Copy in the list no passes are run
+	int lastBlendingFilter = -1;
+	int filterIndex = 0;
 	for (auto Filter : FullScreenFilterList)
 	{
-		CycleReadWriteBuffers(false);
-
-		RenderFullscreenPostProcess(Filter, WriteBuffer->Target, ReadBuffer->Resource );
+		if (PPTechniqueBlends[Filter])  lastBlendingFilter = filterIndex;
+		filterIndex++;
+	}
 
+	filterIndex = 0;
+	for (auto Filter : FullScreenFilterList)
+	{
+		if (Filter != Copy || filterIndex < lastBlendingFilter)
+		{
+			CycleReadWriteBuffers(false);
+			RenderFullscreenPostProcess(Filter, *WriteBuffer, *ReadBuffer );
+		}
+		filterIndex++;
 	}
-		
-	//Save scene for use next frame and Render to back buffer
-	CycleReadWriteBuffers(true);
-	g_pd3dDevice->CopyResource(LastFrameBuffer.Texture, ReadBuffer->Texture);
-	RenderFullscreenPostProcess(Copy, BackBufferRenderTarget, LastFrameBuffer.Resource);
+
+	//The final image is in the write buffer. Keep it for use next frame by making it the last frame buffer (the old one is cleared and
+	//reused next frame), then copy it to the back buffer - no copy into the history and no full screen pass
+	TRenderHandle* FinalBuffer = WriteBuffer;
+	WriteBuffer = LastFrameBuffer;
+	LastFrameBuffer = FinalBuffer;
+	RenderDevice->CopyTexture(RenderDevice->BackBuffer(), *LastFrameBuffer);
 
 	// These two lines unbind the scene texture from the shader to stop DirectX issuing a warning when we try to render to it again next frame
-	SceneTextureVar->SetResource(0);
-	PreviousSceneTextureVar->SetResource( 0 );
-	PPTechniques[FullScreenFilter]->GetPassByIndex(0)->Apply(0);
+	RenderDevice->SetTexture(SceneTextureVar, kNoRenderHandle);
+	RenderDevice->SetTexture( PreviousSceneTextureVar, kNoRenderHandle );
+	RenderDevice->ApplyPass(PPTechniques[FullScreenFilter], 0);
 
 	// Render UI elements last - don't want them post-processed
 	RenderSceneText();
 	
 	// Present the backbuffer contents to the display
-	SwapChain->Present(0, 0);
+	RenderDevice->Present();
 }
 
 
 // Render a single text string at the given position in the given colour, may optionally centre it
 void RenderText(const string& text, int X, int Y, float r, float g, float b, bool centre = false)
 {
-	RECT rect;
-	if (!centre)
-	{
-		SetRect(&rect, X, Y, 0, 0);
-		OSDFont->DrawText(NULL, text.c_str(), -1, &rect, DT_NOCLIP, D3DXCOLOR(r, g, b, 1.0f));
-	}
-	else
-	{
-		SetRect(&rect, X - 100, Y, X + 100, 0);
-		OSDFont->DrawText(NULL, text.c_str(), -1, &rect, DT_CENTER | DT_NOCLIP, D3DXCOLOR(r, g, b, 1.0f));
-	}
+	const float colour[4] = { r, g, b, 1.0f };
+	RenderDevice->DrawString(text, X, Y, colour, centre);
 }
 
 // Render on-screen text each frame
@@ -930,14 +1007,32 @@ void RenderSceneText()
 	//	break;
 	//}
 	RenderText(outText.str(), 0, 32, 1.0f, 1.0f, 1.0f);
+
+	// Effect variable writes sent to the device and dropped by the state cache last frame
+	const SStateCacheStats& cacheStats = StateCache.LastFrameStats();
+	outText.str("");
+	outText << "Variable writes: " << cacheStats.Submitted << " sent, " << cacheStats.Elided << " skipped";
+	RenderText(outText.str(), 0, BackBufferHeight - 16, 1.0f, 1.0f, 1.0f);
+
+	// Scene draws and the state changes between them
+	const SDrawQueueStats& queueStats = SceneQueue.Stats();
+	outText.str("");
+	outText << "Scene draws: " << queueStats.Draws << " (" << queueStats.InstancedDraws << " instanced, "
+	        << queueStats.Instances << " instances), method changes: " << queueStats.MethodChanges
+	        << ", material changes: " << queueStats.MaterialChanges << ", buffer changes: " << queueStats.BufferChanges;
+	RenderText(outText.str(), 0, BackBufferHeight - 32, 1.0f, 1.0f, 1.0f);
+
+	// Simulation thread
+	outText.str("");
+	outText << "Simulation: " << SimulationTickRate << " ticks/s, interpolation " << (InterpolateTicks ? "on" : "off") << " (F6)";
+	RenderText(outText.str(), 0, BackBufferHeight - 48, 1.0f, 1.0f, 1.0f);
 }
 
 
 // Update the scene between rendering
 void UpdateScene(float updateTime)
 {
-	// Call all entity update functions
-	EntityManager.UpdateAllEntities(updateTime);
+	// Entities are updated on the simulation thread
 
 	// Update any post processes that need updates
 	UpdatePostProcesses(updateTime);
@@ -949,18 +1044,8 @@ void UpdateScene(float updateTime)
 	if (KeyHit(Key_F4)) CameraMoveSpeed = 160.0f;
 	if (KeyHit(Key_F5)) CameraMoveSpeed = 640.0f;
 
-	
-
-	// Rotate cube and attach light to it
-	CEntity* cubey = EntityManager.GetEntity( "Cubey" );
-	cubey->Matrix().RotateX( ToRadians(53.0f) * updateTime );
-	cubey->Matrix().RotateZ( ToRadians(42.0f) * updateTime );
-	cubey->Matrix().RotateWorldY( ToRadians(12.0f) * updateTime );
-	Lights[1]->SetPosition( cubey->Position() );
-	
-	// Rotate polygon post-processed entity
-	CEntity* ppEntity = EntityManager.GetEntity( "PostProcessBlock" );
-	ppEntity->Matrix().RotateY( ToRadians(30.0f) * updateTime );
+	// Toggle interpolation between simulation ticks
+	if (KeyHit(Key_F6)) InterpolateTicks = !InterpolateTicks;
 
 	// Move the camera
 	MainCamera->Control( Key_Up, Key_Down, Key_Left, Key_Right, Key_W, Key_S, Key_A, Key_D, 
@@ -972,6 +1057,9 @@ void UpdateScene(float updateTime)
 	if (SumUpdateTimes >= UpdateTimePeriod)
 	{
 		AverageUpdateTime = SumUpdateTimes / NumUpdateTimes;
+		TUInt32 simulationTicks = Simulation.Stats().Ticks;
+		SimulationTickRate = (simulationTicks - LastSimulationTicks) / SumUpdateTimes;
+		LastSimulationTicks = simulationTicks;
 		SumUpdateTimes = 0.0f;
 		NumUpdateTimes = 0;
 	}
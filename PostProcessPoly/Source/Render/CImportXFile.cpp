@@ -369,31 +369,8 @@ void CImportXFile::GetMaterial
 	pOutMaterial->specularColour.a = 1.0f;
 	pOutMaterial->specularPower = xFileMaterial.fSpecularPower;
 
-	// Select render method and number of textures from material and texture name
-	pOutMaterial->renderMethod = RenderMethodFromMaterial( xFileMaterial.sName, xFileMaterial.sTextureName ); 
-	pOutMaterial->numTextures = NumTexturesUsedByRenderMethod( pOutMaterial->renderMethod );
-
-	// Set texture names. If a render method uses multiple textures, secondary texture names will be based on 
-	// the main texture name. E.g. if a normal mapping method uses 3 textures and the main texture is "wall.jpg"
-	// then the other textures must be named "wall1.jpg" and "wall2.jpg"
-	if (pOutMaterial->numTextures > 0)
-	{
-		pOutMaterial->textureFileNames[0] = xFileMaterial.sTextureName;
-		for (TUInt32 iExtraTex = 1; iExtraTex < pOutMaterial->numTextures; ++iExtraTex)
-		{
-			string::size_type lastDot = xFileMaterial.sTextureName.find_last_of( "." );
-			if (lastDot == string::npos)
-			{
-				pOutMaterial->textureFileNames[iExtraTex] = xFileMaterial.sTextureName + char('0' + iExtraTex);
-			}
-			else
-			{
-				string filename = xFileMaterial.sTextureName.substr( 0, lastDot );
-				string extension = xFileMaterial.sTextureName.substr( lastDot );
-				pOutMaterial->textureFileNames[iExtraTex] = filename + char('0' + iExtraTex) + extension;
-			}
-		}
-	}
+	// Select render method and textures from material and texture name
+	SetMaterialTextures( pOutMaterial, xFileMaterial.sName, xFileMaterial.sTextureName );
 
 	GEN_ENDGUARD;
 }
@@ -22,22 +22,13 @@ using namespace std;
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 #include "Mesh.h"
+#include "MeshImport.h"
 
 namespace gen
 {
 
-// List of errors returned from import functions
-enum EImportError
-{
-	kSuccess           = 0,
-	kSystemFailure     = 1,
-	kOutOfSystemMemory = 2,
-	kFileError         = 3,
-	kInvalidData       = 4,
-};
-
-
-class CImportXFile
+// Importer of Microsoft DirectX .X files using the D3DX X-file parser
+class CImportXFile : public IMeshImport
 {
 	GEN_CLASS( CImportXFile )
 
@@ -71,6 +62,12 @@ public:
 		return m_bImported;
 	}
 
+	// Whether the given file is a Microsoft X-File
+	bool IsMeshFile( const string& sFileName ) const
+	{
+		return IsXFile( sFileName );
+	}
+
 	// Import a Microsoft X-File into a list of meshes and a frame hierarchy
 	// Possible return values:
 	//		kSuccess:			...
@@ -115,7 +112,7 @@ public:
 	// Possible return values:
 	//		kSuccess:			...
 	//		kOutOfSystemMemory:	...
-	EImportError CImportXFile::GetSubMesh
+	EImportError GetSubMesh
 	(
 		const TUInt32 iSubMesh,
 		SSubMesh*     pSubMesh,
@@ -0,0 +1,636 @@
+/*******************************************
+	D3D10RenderDevice.cpp
+
+	Render device using Direct3D 10
+********************************************/
+
+#include <string.h>
+
+#include "D3D10RenderDevice.h"
+#include "CImportXFile.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+// Constructor creates an unusable device, use Create to initialise Direct3D
+CD3D10RenderDevice::CD3D10RenderDevice()
+{
+	m_Device = 0;
+	m_SwapChain = 0;
+	m_DepthStencil = 0;
+	m_DepthStencilView = 0;
+	m_NoColourWrites = 0;
+	m_Font = 0;
+	m_BackBuffer = kNoRenderHandle;
+}
+
+CD3D10RenderDevice::~CD3D10RenderDevice()
+{
+	Shutdown();
+}
+
+
+//-----------------------------------------------------------------------------
+// Creation
+//-----------------------------------------------------------------------------
+
+// Initialise Direct3D for rendering to a window with a back buffer of the given size. Returns
+// false on failure
+bool CD3D10RenderDevice::Create( HWND hWnd, TUInt32 width, TUInt32 height )
+{
+	// Entry 0 of the resource table is kNoRenderHandle
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	m_Resources.assign( 1, resource );
+
+	// Create a Direct3D device (i.e. initialise D3D), and create a swap-chain (create a back buffer to render to)
+	DXGI_SWAP_CHAIN_DESC sd;         // Structure to contain all the information needed
+	ZeroMemory( &sd, sizeof( sd ) ); // Clear the structure to 0 - common Microsoft practice, not really good style
+	sd.BufferCount = 1;
+	sd.BufferDesc.Width = width;                       // Target window size
+	sd.BufferDesc.Height = height;                     // --"--
+	sd.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // Pixel format of target window
+	sd.BufferDesc.RefreshRate.Numerator = 60;          // Refresh rate of monitor
+	sd.BufferDesc.RefreshRate.Denominator = 1;         // --"--
+	sd.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+	sd.SampleDesc.Count = 1;
+	sd.SampleDesc.Quality = 0;
+	sd.SwapEffect = DXGI_SWAP_EFFECT_DISCARD; // Discard last frame's back buffer after it is shown, alternative is DXGI_SWAP_EFFECT_SEQUENTIAL, which retains the back buffer
+	sd.OutputWindow = hWnd;                   // Target window
+	sd.Windowed = TRUE;                       // Whether to render in a window (TRUE) or go fullscreen (FALSE)
+	if (FAILED( D3D10CreateDeviceAndSwapChain( NULL, D3D10_DRIVER_TYPE_HARDWARE, NULL, D3D10_CREATE_DEVICE_DEBUG, D3D10_SDK_VERSION, &sd, &m_SwapChain, &m_Device ) )) return false;
+
+	// The back-buffer is a resource like any other, that can be "viewed" as a render target
+	if (FAILED( m_SwapChain->GetBuffer( 0, __uuidof( ID3D10Texture2D ), ( LPVOID* )&resource.Texture ) )) return false;
+	HRESULT hr = m_Device->CreateRenderTargetView( resource.Texture, NULL, &resource.RenderTarget );
+	m_BackBuffer = AddResource( resource );
+	if (FAILED( hr )) return false;
+
+	// Create a texture (bitmap) to use for a depth buffer for the main viewport
+	D3D10_TEXTURE2D_DESC descDepth;
+	descDepth.Width = width;
+	descDepth.Height = height;
+	descDepth.MipLevels = 1;
+	descDepth.ArraySize = 1;
+	descDepth.Format = DXGI_FORMAT_D32_FLOAT;
+	descDepth.SampleDesc.Count = 1;
+	descDepth.SampleDesc.Quality = 0;
+	descDepth.Usage = D3D10_USAGE_DEFAULT;
+	descDepth.BindFlags = D3D10_BIND_DEPTH_STENCIL;
+	descDepth.CPUAccessFlags = 0;
+	descDepth.MiscFlags = 0;
+	if (FAILED( m_Device->CreateTexture2D( &descDepth, NULL, &m_DepthStencil ) )) return false;
+
+	// Create the depth stencil view, i.e. indicate that the texture just created is to be used as a depth buffer
+	if (FAILED( m_Device->CreateDepthStencilView( m_DepthStencil, NULL, &m_DepthStencilView ) )) return false;
+
+	// Blend state that writes no colour for occlusion tests, they only need depth testing
+	D3D10_BLEND_DESC blendDesc;
+	ZeroMemory( &blendDesc, sizeof(blendDesc) );
+	blendDesc.SrcBlend = blendDesc.SrcBlendAlpha = D3D10_BLEND_ONE;
+	blendDesc.DestBlend = blendDesc.DestBlendAlpha = D3D10_BLEND_ZERO;
+	blendDesc.BlendOp = blendDesc.BlendOpAlpha = D3D10_BLEND_OP_ADD;
+	blendDesc.RenderTargetWriteMask[0] = 0;
+	if (FAILED( m_Device->CreateBlendState( &blendDesc, &m_NoColourWrites ) )) return false;
+
+	// Create a font using D3DX helper functions
+	if (FAILED( D3DX10CreateFont( m_Device, 12, 0, FW_BOLD, 1, FALSE, DEFAULT_CHARSET, OUT_DEFAULT_PRECIS,
+	                              DEFAULT_QUALITY, DEFAULT_PITCH | FF_DONTCARE, "Arial", &m_Font ) )) return false;
+
+	return true;
+}
+
+// Release all resources and Direct3D itself
+void CD3D10RenderDevice::Shutdown()
+{
+	if (m_Device) m_Device->ClearState();
+	for (TUInt32 handle = 1; handle < m_Resources.size(); ++handle)
+	{
+		ReleaseResource( m_Resources[handle] );
+	}
+	m_Resources.clear();
+	m_FreeHandles.clear();
+	m_BackBuffer = kNoRenderHandle;
+
+	if (m_Font)             m_Font->Release();
+	if (m_NoColourWrites)   m_NoColourWrites->Release();
+	if (m_DepthStencilView) m_DepthStencilView->Release();
+	if (m_DepthStencil)     m_DepthStencil->Release();
+	if (m_SwapChain)        m_SwapChain->Release();
+	if (m_Device)           m_Device->Release();
+	m_Font = 0;
+	m_NoColourWrites = 0;
+	m_DepthStencilView = 0;
+	m_DepthStencil = 0;
+	m_SwapChain = 0;
+	m_Device = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Frame buffers
+//-----------------------------------------------------------------------------
+
+TRenderHandle CD3D10RenderDevice::BackBuffer()
+{
+	return m_BackBuffer;
+}
+
+void CD3D10RenderDevice::Present()
+{
+	m_SwapChain->Present( 0, 0 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Resources
+//-----------------------------------------------------------------------------
+
+TRenderHandle CD3D10RenderDevice::CreateVertexBuffer( const void* data, TUInt32 size )
+{
+	D3D10_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
+	bufferDesc.Usage = D3D10_USAGE_DEFAULT; // Not a dynamic buffer
+	bufferDesc.ByteWidth = size;
+	bufferDesc.CPUAccessFlags = 0;          // Indicates that CPU won't access this buffer at all after creation
+	bufferDesc.MiscFlags = 0;
+	D3D10_SUBRESOURCE_DATA initData;
+	initData.pSysMem = data;
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( m_Device->CreateBuffer( &bufferDesc, data ? &initData : NULL, &resource.Buffer ) )) return kNoRenderHandle;
+	return AddResource( resource );
+}
+
+TRenderHandle CD3D10RenderDevice::CreateDynamicVertexBuffer( TUInt32 size )
+{
+	D3D10_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
+	bufferDesc.Usage = D3D10_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = size;
+	bufferDesc.CPUAccessFlags = D3D10_CPU_ACCESS_WRITE; // Rewritten by the CPU each frame
+	bufferDesc.MiscFlags = 0;
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( m_Device->CreateBuffer( &bufferDesc, NULL, &resource.Buffer ) )) return kNoRenderHandle;
+	return AddResource( resource );
+}
+
+// Discards the old contents, so the GPU can carry on drawing from them while the new data is written
+void CD3D10RenderDevice::UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size )
+{
+	ID3D10Buffer* vertexBuffer = Resource( buffer ).Buffer;
+	void* bufferData;
+	if (!vertexBuffer || FAILED( vertexBuffer->Map( D3D10_MAP_WRITE_DISCARD, 0, &bufferData ) )) return;
+	memcpy( bufferData, data, size );
+	vertexBuffer->Unmap();
+}
+
+TRenderHandle CD3D10RenderDevice::CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices )
+{
+	D3D10_BUFFER_DESC bufferDesc;
+	bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
+	bufferDesc.Usage = D3D10_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = numIndices * sizeof(TUInt16);
+	bufferDesc.CPUAccessFlags = 0;
+	bufferDesc.MiscFlags = 0;
+	D3D10_SUBRESOURCE_DATA initData;
+	initData.pSysMem = indices;
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( m_Device->CreateBuffer( &bufferDesc, indices ? &initData : NULL, &resource.Buffer ) )) return kNoRenderHandle;
+	return AddResource( resource );
+}
+
+// The buffers are default usage, so are written by the GPU from a copy of the data
+void CD3D10RenderDevice::WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size )
+{
+	ID3D10Buffer* d3dBuffer = Resource( buffer ).Buffer;
+	if (!d3dBuffer) return;
+
+	D3D10_BOX box;
+	box.left = offset;
+	box.right = offset + size;
+	box.top = 0;
+	box.bottom = 1;
+	box.front = 0;
+	box.back = 1;
+	m_Device->UpdateSubresource( d3dBuffer, 0, &box, data, 0, 0 );
+}
+
+TRenderHandle CD3D10RenderDevice::CreateRenderTexture( TUInt32 width, TUInt32 height )
+{
+	D3D10_TEXTURE2D_DESC textureDesc;
+	textureDesc.Width = width;
+	textureDesc.Height = height;
+	textureDesc.MipLevels = 1; // No mip-maps when rendering to textures (or we will have to render every level)
+	textureDesc.ArraySize = 1;
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM; // RGBA texture (8-bits each)
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.SampleDesc.Quality = 0;
+	textureDesc.Usage = D3D10_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D10_BIND_RENDER_TARGET | D3D10_BIND_SHADER_RESOURCE; // Render to it and read it in shaders
+	textureDesc.CPUAccessFlags = 0;
+	textureDesc.MiscFlags = 0;
+
+	D3D10_SHADER_RESOURCE_VIEW_DESC srDesc;
+	srDesc.Format = textureDesc.Format;
+	srDesc.ViewDimension = D3D10_SRV_DIMENSION_TEXTURE2D;
+	srDesc.Texture2D.MostDetailedMip = 0;
+	srDesc.Texture2D.MipLevels = 1;
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( m_Device->CreateTexture2D( &textureDesc, NULL, &resource.Texture ) ) ||
+	    FAILED( m_Device->CreateRenderTargetView( resource.Texture, NULL, &resource.RenderTarget ) ) ||
+	    FAILED( m_Device->CreateShaderResourceView( resource.Texture, &srDesc, &resource.ShaderResource ) ))
+	{
+		ReleaseResource( resource );
+		return kNoRenderHandle;
+	}
+	return AddResource( resource );
+}
+
+TRenderHandle CD3D10RenderDevice::LoadTexture( const string& fileName )
+{
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( D3DX10CreateShaderResourceViewFromFile( m_Device, fileName.c_str(), NULL, NULL, &resource.ShaderResource, NULL ) ))
+	{
+		return kNoRenderHandle;
+	}
+	return AddResource( resource );
+}
+
+// Meshes are X-files, read with the D3DX X-file parser
+IMeshImport* CD3D10RenderDevice::CreateMeshImport()
+{
+	return new CImportXFile;
+}
+
+TRenderHandle CD3D10RenderDevice::CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique )
+{
+	static const DXGI_FORMAT Formats[] =
+	{
+		DXGI_FORMAT_R32G32_FLOAT, DXGI_FORMAT_R32G32B32_FLOAT, DXGI_FORMAT_R32G32B32A32_FLOAT,
+		DXGI_FORMAT_R8G8B8A8_UINT, DXGI_FORMAT_R8G8B8A8_UNORM,
+	};
+	const TUInt32 kMaxElements = D3D10_IA_VERTEX_INPUT_STRUCTURE_ELEMENT_COUNT;
+	if (numElements > kMaxElements) return kNoRenderHandle;
+
+	D3D10_INPUT_ELEMENT_DESC elementDescs[kMaxElements];
+	for (TUInt32 element = 0; element < numElements; ++element)
+	{
+		elementDescs[element].SemanticName = elements[element].Semantic;
+		elementDescs[element].SemanticIndex = elements[element].SemanticIndex;
+		elementDescs[element].Format = Formats[elements[element].Format];
+		elementDescs[element].InputSlot = elements[element].Slot;
+		elementDescs[element].AlignedByteOffset = elements[element].Offset;
+		if (elements[element].Slot == 0)
+		{
+			elementDescs[element].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
+			elementDescs[element].InstanceDataStepRate = 0;
+		}
+		else
+		{
+			elementDescs[element].InputSlotClass = D3D10_INPUT_PER_INSTANCE_DATA;
+			elementDescs[element].InstanceDataStepRate = 1; // Next item for each instance
+		}
+	}
+
+	// The layout is checked against the vertex input of the technique's first pass
+	D3D10_PASS_DESC passDesc;
+	if (!Resource( technique ).Technique) return kNoRenderHandle;
+	Resource( technique ).Technique->GetPassByIndex( 0 )->GetDesc( &passDesc );
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( m_Device->CreateInputLayout( elementDescs, numElements, passDesc.pIAInputSignature, passDesc.IAInputSignatureSize, &resource.Layout ) ))
+	{
+		return kNoRenderHandle;
+	}
+	return AddResource( resource );
+}
+
+TRenderHandle CD3D10RenderDevice::CreateOcclusionPredicate()
+{
+	D3D10_QUERY_DESC predicateDesc;
+	predicateDesc.Query = D3D10_QUERY_OCCLUSION_PREDICATE;
+	predicateDesc.MiscFlags = 0;
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( m_Device->CreatePredicate( &predicateDesc, &resource.Predicate ) )) return kNoRenderHandle;
+	return AddResource( resource );
+}
+
+// Release a buffer, texture, layout, effect or predicate. Its entry is reused by later resources,
+// so the handle must not be used again
+void CD3D10RenderDevice::Release( TRenderHandle resource )
+{
+	if (resource == kNoRenderHandle || resource >= m_Resources.size()) return;
+
+	// The techniques and variables of an effect go with it
+	ID3D10Effect* effect = m_Resources[resource].Effect;
+	if (effect)
+	{
+		for (TUInt32 handle = 1; handle < m_Resources.size(); ++handle)
+		{
+			if (handle != resource && m_Resources[handle].Effect == effect)
+			{
+				FreeResource( handle );
+			}
+		}
+	}
+	FreeResource( resource );
+}
+
+
+//-----------------------------------------------------------------------------
+// Effects
+//-----------------------------------------------------------------------------
+
+TRenderHandle CD3D10RenderDevice::LoadEffect( const string& fileName, string& errors )
+{
+	ID3D10Blob* pErrors = 0; // This strangely typed variable collects any errors when compiling the effect file
+	DWORD dwShaderFlags = D3D10_SHADER_ENABLE_STRICTNESS; // These "flags" are used to set the compiler options
+
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	if (FAILED( D3DX10CreateEffectFromFile( fileName.c_str(), NULL, NULL, "fx_4_0", dwShaderFlags, 0, m_Device, NULL, NULL, &resource.Effect, &pErrors, NULL ) ))
+	{
+		if (pErrors)
+		{
+			errors = reinterpret_cast<char*>(pErrors->GetBufferPointer());
+			pErrors->Release();
+		}
+		return kNoRenderHandle;
+	}
+	if (pErrors) pErrors->Release();
+	return AddResource( resource );
+}
+
+// Techniques and variables keep their effect so they can be released with it, but only the
+// effect entry holds a reference. One asked for again gets its existing handle
+TRenderHandle CD3D10RenderDevice::GetTechnique( TRenderHandle effect, const string& name )
+{
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	resource.Effect = Resource( effect ).Effect;
+	if (!resource.Effect) return kNoRenderHandle;
+	resource.Technique = resource.Effect->GetTechniqueByName( name.c_str() );
+	if (!resource.Technique->IsValid()) return kNoRenderHandle;
+	TRenderHandle existing = FindEffectMember( resource.Technique, 0 );
+	return existing ? existing : AddResource( resource );
+}
+
+TRenderHandle CD3D10RenderDevice::GetVariable( TRenderHandle effect, const string& name )
+{
+	SResource resource;
+	memset( &resource, 0, sizeof(resource) );
+	resource.Effect = Resource( effect ).Effect;
+	if (!resource.Effect) return kNoRenderHandle;
+	resource.Variable = resource.Effect->GetVariableByName( name.c_str() );
+	if (!resource.Variable->IsValid()) return kNoRenderHandle;
+	TRenderHandle existing = FindEffectMember( 0, resource.Variable );
+	return existing ? existing : AddResource( resource );
+}
+
+TUInt32 CD3D10RenderDevice::NumPasses( TRenderHandle technique )
+{
+	if (!Resource( technique ).Technique) return 0;
+	D3D10_TECHNIQUE_DESC techDesc;
+	Resource( technique ).Technique->GetDesc( &techDesc );
+	return techDesc.Passes;
+}
+
+void CD3D10RenderDevice::SetFloat( TRenderHandle variable, TFloat32 value )
+{
+	ID3D10EffectVariable* var = Resource( variable ).Variable;
+	if (var) var->AsScalar()->SetFloat( value );
+}
+
+void CD3D10RenderDevice::SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count )
+{
+	ID3D10EffectVariable* var = Resource( variable ).Variable;
+	if (var) var->SetRawValue( const_cast<TFloat32*>(values), 0, count * sizeof(TFloat32) );
+}
+
+void CD3D10RenderDevice::SetMatrix( TRenderHandle variable, const TFloat32* matrix )
+{
+	ID3D10EffectVariable* var = Resource( variable ).Variable;
+	if (var) var->AsMatrix()->SetMatrix( const_cast<TFloat32*>(matrix) );
+}
+
+void CD3D10RenderDevice::SetTexture( TRenderHandle variable, TRenderHandle texture )
+{
+	ID3D10EffectVariable* var = Resource( variable ).Variable;
+	if (var) var->AsShaderResource()->SetResource( Resource( texture ).ShaderResource );
+}
+
+void CD3D10RenderDevice::ApplyPass( TRenderHandle technique, TUInt32 pass )
+{
+	ID3D10EffectTechnique* tech = Resource( technique ).Technique;
+	if (tech) tech->GetPassByIndex( pass )->Apply( 0 );
+}
+
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+void CD3D10RenderDevice::SetViewport( TUInt32 width, TUInt32 height )
+{
+	D3D10_VIEWPORT vp;
+	vp.Width = width;
+	vp.Height = height;
+	vp.MinDepth = 0.0f;
+	vp.MaxDepth = 1.0f;
+	vp.TopLeftX = 0;
+	vp.TopLeftY = 0;
+	m_Device->RSSetViewports( 1, &vp );
+}
+
+void CD3D10RenderDevice::SetRenderTarget( TRenderHandle target )
+{
+	ID3D10RenderTargetView* renderTarget = Resource( target ).RenderTarget;
+	m_Device->OMSetRenderTargets( 1, &renderTarget, m_DepthStencilView );
+}
+
+void CD3D10RenderDevice::ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] )
+{
+	ID3D10RenderTargetView* renderTarget = Resource( target ).RenderTarget;
+	if (renderTarget) m_Device->ClearRenderTargetView( renderTarget, colour );
+}
+
+void CD3D10RenderDevice::ClearDepth( TFloat32 depth )
+{
+	m_Device->ClearDepthStencilView( m_DepthStencilView, D3D10_CLEAR_DEPTH, depth, 0 );
+}
+
+void CD3D10RenderDevice::CopyTexture( TRenderHandle dest, TRenderHandle source )
+{
+	ID3D10Texture2D* destTexture = Resource( dest ).Texture;
+	ID3D10Texture2D* sourceTexture = Resource( source ).Texture;
+	if (destTexture && sourceTexture) m_Device->CopyResource( destTexture, sourceTexture );
+}
+
+
+//-----------------------------------------------------------------------------
+// Drawing
+//-----------------------------------------------------------------------------
+
+void CD3D10RenderDevice::SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize )
+{
+	ID3D10Buffer* vertexBuffer = Resource( buffer ).Buffer;
+	UINT stride = vertexSize;
+	UINT offset = 0;
+	m_Device->IASetVertexBuffers( 0, 1, &vertexBuffer, &stride, &offset );
+}
+
+void CD3D10RenderDevice::SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize )
+{
+	ID3D10Buffer* instanceBuffer = Resource( buffer ).Buffer;
+	UINT stride = instanceSize;
+	UINT offset = 0;
+	m_Device->IASetVertexBuffers( 1, 1, &instanceBuffer, &stride, &offset );
+}
+
+void CD3D10RenderDevice::SetIndexBuffer( TRenderHandle buffer )
+{
+	m_Device->IASetIndexBuffer( Resource( buffer ).Buffer, DXGI_FORMAT_R16_UINT, 0 );
+}
+
+void CD3D10RenderDevice::SetInputLayout( TRenderHandle layout )
+{
+	m_Device->IASetInputLayout( Resource( layout ).Layout );
+}
+
+void CD3D10RenderDevice::SetPrimitiveTopology( EPrimitiveTopology topology )
+{
+	m_Device->IASetPrimitiveTopology( topology == kTriangleStrip ? D3D10_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP
+	                                                             : D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
+}
+
+void CD3D10RenderDevice::Draw( TUInt32 numVertices, TUInt32 firstVertex )
+{
+	m_Device->Draw( numVertices, firstVertex );
+}
+
+void CD3D10RenderDevice::DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex )
+{
+	m_Device->DrawIndexed( numIndices, firstIndex, baseVertex );
+}
+
+void CD3D10RenderDevice::DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex, TInt32 baseVertex,
+                                               TUInt32 firstInstance )
+{
+	m_Device->DrawIndexedInstanced( numIndices, numInstances, firstIndex, baseVertex, firstInstance );
+}
+
+// Depth test only - no pixel shader and no colour writes. The pass applied before this call
+// restores both
+void CD3D10RenderDevice::BeginOcclusionTest( TRenderHandle predicate )
+{
+	ID3D10Predicate* pred = Resource( predicate ).Predicate;
+	if (!pred) return;
+	const FLOAT blendFactor[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	m_Device->PSSetShader( NULL );
+	m_Device->OMSetBlendState( m_NoColourWrites, blendFactor, 0xFFFFFFFF );
+	pred->Begin();
+}
+
+void CD3D10RenderDevice::EndOcclusionTest( TRenderHandle predicate )
+{
+	ID3D10Predicate* pred = Resource( predicate ).Predicate;
+	if (pred) pred->End();
+}
+
+// Draws are skipped when the predicate is FALSE, i.e. no pixels passed
+void CD3D10RenderDevice::SetPredication( TRenderHandle predicate )
+{
+	m_Device->SetPredication( Resource( predicate ).Predicate, FALSE );
+}
+
+
+//-----------------------------------------------------------------------------
+// Text
+//-----------------------------------------------------------------------------
+
+void CD3D10RenderDevice::DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre )
+{
+	if (!centre)
+	{
+		RECT rect = { x, y, 0, 0 };
+		m_Font->DrawText( NULL, text.c_str(), -1, &rect, DT_NOCLIP, D3DXCOLOR( colour ) );
+	}
+	else
+	{
+		RECT rect = { x - 100, y, x + 100, 0 };
+		m_Font->DrawText( NULL, text.c_str(), -1, &rect, DT_CENTER | DT_NOCLIP, D3DXCOLOR( colour ) );
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Private functions
+//-----------------------------------------------------------------------------
+
+// Add a resource to the table, in a released entry if there is one, returning its handle
+TRenderHandle CD3D10RenderDevice::AddResource( const SResource& resource )
+{
+	if (!m_FreeHandles.empty())
+	{
+		TRenderHandle handle = m_FreeHandles.back();
+		m_FreeHandles.pop_back();
+		m_Resources[handle] = resource;
+		return handle;
+	}
+	m_Resources.push_back( resource );
+	return static_cast<TRenderHandle>(m_Resources.size() - 1);
+}
+
+// Handle of an existing technique or variable entry, kNoRenderHandle if there is none. Only at
+// load time, so a search of the table is fine
+TRenderHandle CD3D10RenderDevice::FindEffectMember( ID3D10EffectTechnique* technique, ID3D10EffectVariable* variable ) const
+{
+	for (TUInt32 handle = 1; handle < m_Resources.size(); ++handle)
+	{
+		const SResource& resource = m_Resources[handle];
+		if ((technique && resource.Technique == technique) || (variable && resource.Variable == variable)) return handle;
+	}
+	return kNoRenderHandle;
+}
+
+// Release the entry for a handle and make it free for reuse. Empty entries are already free
+void CD3D10RenderDevice::FreeResource( TRenderHandle handle )
+{
+	SResource& resource = m_Resources[handle];
+	if (!resource.Buffer && !resource.Texture && !resource.Layout && !resource.Effect && !resource.Predicate) return;
+	ReleaseResource( resource );
+	m_FreeHandles.push_back( handle );
+}
+
+// Release the interfaces of a resource and clear it. Techniques and variables are owned by their
+// effect, which is only released from the effect's own entry
+void CD3D10RenderDevice::ReleaseResource( SResource& resource )
+{
+	if (!resource.Technique && !resource.Variable && resource.Effect) resource.Effect->Release();
+	if (resource.Buffer)         resource.Buffer->Release();
+	if (resource.ShaderResource) resource.ShaderResource->Release();
+	if (resource.RenderTarget)   resource.RenderTarget->Release();
+	if (resource.Texture)        resource.Texture->Release();
+	if (resource.Layout)         resource.Layout->Release();
+	if (resource.Predicate)      resource.Predicate->Release();
+	memset( &resource, 0, sizeof(resource) );
+}
+
+
+} // namespace gen
@@ -0,0 +1,160 @@
+/*******************************************
+	D3D10RenderDevice.h
+
+	Render device using Direct3D 10
+********************************************/
+
+#pragma once
+
+#include <windows.h>
+#include <vector>
+using namespace std;
+
+#include <d3d10.h>
+#include <d3dx10.h>
+
+#include "RenderDevice.h"
+
+namespace gen
+{
+
+// The render device for the app, passing each call to Direct3D 10. Owns the device, swap chain,
+// depth buffer and on-screen font along with the resources it creates. Handles index a table
+// of resources, so a call costs one lookup on top of the Direct3D call. Released entries are
+// reused, so the table stays the size of the most resources held at once
+class CD3D10RenderDevice : public IRenderDevice
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor creates an unusable device, use Create to initialise Direct3D
+	CD3D10RenderDevice();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CD3D10RenderDevice( const CD3D10RenderDevice& );
+	CD3D10RenderDevice& operator=( const CD3D10RenderDevice& );
+
+public:
+	~CD3D10RenderDevice();
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Creation
+
+	// Initialise Direct3D for rendering to a window with a back buffer of the given size.
+	// Returns false on failure
+	bool Create( HWND hWnd, TUInt32 width, TUInt32 height );
+
+	// Release all resources and Direct3D itself
+	void Shutdown();
+
+
+	/////////////////////////////////////
+	// IRenderDevice
+
+	TRenderHandle BackBuffer();
+	void Present();
+
+	TRenderHandle CreateVertexBuffer( const void* data, TUInt32 size );
+	TRenderHandle CreateDynamicVertexBuffer( TUInt32 size );
+	void UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size );
+	TRenderHandle CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices );
+	void WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size );
+	TRenderHandle CreateRenderTexture( TUInt32 width, TUInt32 height );
+	TRenderHandle LoadTexture( const string& fileName );
+	IMeshImport* CreateMeshImport();
+	TRenderHandle CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique );
+	TRenderHandle CreateOcclusionPredicate();
+	void Release( TRenderHandle resource );
+
+	TRenderHandle LoadEffect( const string& fileName, string& errors );
+	TRenderHandle GetTechnique( TRenderHandle effect, const string& name );
+	TRenderHandle GetVariable( TRenderHandle effect, const string& name );
+	TUInt32 NumPasses( TRenderHandle technique );
+	void SetFloat( TRenderHandle variable, TFloat32 value );
+	void SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count );
+	void SetMatrix( TRenderHandle variable, const TFloat32* matrix );
+	void SetTexture( TRenderHandle variable, TRenderHandle texture );
+	void ApplyPass( TRenderHandle technique, TUInt32 pass );
+
+	void SetViewport( TUInt32 width, TUInt32 height );
+	void SetRenderTarget( TRenderHandle target );
+	void ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] );
+	void ClearDepth( TFloat32 depth );
+	void CopyTexture( TRenderHandle dest, TRenderHandle source );
+
+	void SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize );
+	void SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize );
+	void SetIndexBuffer( TRenderHandle buffer );
+	void SetInputLayout( TRenderHandle layout );
+	void SetPrimitiveTopology( EPrimitiveTopology topology );
+	void Draw( TUInt32 numVertices, TUInt32 firstVertex );
+	void DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex );
+	void DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex, TInt32 baseVertex,
+	                           TUInt32 firstInstance );
+	void BeginOcclusionTest( TRenderHandle predicate );
+	void EndOcclusionTest( TRenderHandle predicate );
+	void SetPredication( TRenderHandle predicate );
+
+	void DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre );
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// A resource behind a handle. Only the members for its kind are set, textures have a render
+	// target view if made with CreateRenderTexture. Techniques and variables belong to an effect
+	struct SResource
+	{
+		ID3D10Buffer*             Buffer;
+		ID3D10Texture2D*          Texture;
+		ID3D10ShaderResourceView* ShaderResource;
+		ID3D10RenderTargetView*   RenderTarget;
+		ID3D10InputLayout*        Layout;
+		ID3D10Effect*             Effect;
+		ID3D10EffectTechnique*    Technique;
+		ID3D10EffectVariable*     Variable;
+		ID3D10Predicate*          Predicate;
+	};
+
+	// Add a resource to the table, in a released entry if there is one, returning its handle
+	TRenderHandle AddResource( const SResource& resource );
+
+	// Handle of an existing technique or variable entry, kNoRenderHandle if there is none
+	TRenderHandle FindEffectMember( ID3D10EffectTechnique* technique, ID3D10EffectVariable* variable ) const;
+
+	// Release the entry for a handle and make it free for reuse
+	void FreeResource( TRenderHandle handle );
+
+	// The resource for a handle, with all members null for kNoRenderHandle
+	const SResource& Resource( TRenderHandle handle ) const
+	{
+		return m_Resources[handle];
+	}
+
+	// Release the interfaces of a resource and clear it
+	void ReleaseResource( SResource& resource );
+
+	ID3D10Device*           m_Device;
+	IDXGISwapChain*         m_SwapChain;
+	ID3D10Texture2D*        m_DepthStencil;
+	ID3D10DepthStencilView* m_DepthStencilView;
+	ID3D10BlendState*       m_NoColourWrites; // For occlusion tests
+	ID3DX10Font*            m_Font;
+	TRenderHandle           m_BackBuffer;
+
+	// Resources by handle. Entry 0 is kNoRenderHandle and is always empty
+	vector<SResource>     m_Resources;
+	vector<TRenderHandle> m_FreeHandles; // Released entries, reused last released first
+};
+
+
+} // namespace gen
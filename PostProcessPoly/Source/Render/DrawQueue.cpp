@@ -0,0 +1,392 @@
+/*******************************************
+	DrawQueue.cpp
+
+	Queue of sub-mesh draws sorted to reduce
+	state changes
+********************************************/
+
+#include <string.h>
+
+#include "DrawQueue.h"
+
+namespace gen
+{
+
+// Get reference to global render device from another source file
+extern IRenderDevice* RenderDevice;
+
+
+//-----------------------------------------------------------------------------
+// Sort key
+//-----------------------------------------------------------------------------
+
+// Positions and sizes of the fields of the sort key (see CDrawQueue in DrawQueue.h)
+const TUInt32 kKeyPassShift       = 60;
+const TUInt32 kKeyMethodShift     = 52;
+const TUInt32 kKeyTextureSetShift = 36;
+const TUInt32 kKeyMeshShift       = 20;
+const TUInt32 kKeyDepthBits       = 20;
+
+const TUInt32 kKeyPassMask   = 0xf;
+const TUInt32 kKeyMethodMask = 0xff;
+const TUInt32 kKeyFieldMask  = 0xffff; // Texture set and mesh
+const TUInt32 kKeyDepthMask  = (1 << kKeyDepthBits) - 1;
+
+// Fold a 32-bit value into a 16-bit key field
+inline TUInt32 FoldToKeyField( TUInt32 value )
+{
+	return (value ^ (value >> 16)) & kKeyFieldMask;
+}
+
+// Mesh key field of a packet: 4 bits of vertex buffer then 12 bits folded from the position of
+// the geometry. Meshes share buffers, so the buffer alone doesn't tell sub-meshes apart
+inline TUInt32 MeshKeyField( const SDrawPacket& packet )
+{
+	TUInt32 position = FoldToKeyField( packet.StartIndex * 31 + static_cast<TUInt32>(packet.BaseVertex) + (packet.IndexBuffer << 24) );
+	return ((packet.VertexBuffer & 0xf) << 12) | ((position ^ (position >> 12)) & 0xfff);
+}
+
+
+//-----------------------------------------------------------------------------
+// Packet comparison
+//-----------------------------------------------------------------------------
+
+// Whether two packets use the same textures
+inline bool SameTextures( const SDrawPacket& a, const SDrawPacket& b )
+{
+	if (a.NumTextures != b.NumTextures) return false;
+	for (TUInt32 texture = 0; texture < a.NumTextures; ++texture)
+	{
+		if (a.Textures[texture] != b.Textures[texture]) return false;
+	}
+	return true;
+}
+
+// Whether two packets use the same material colours (always true for packets sharing a material)
+inline bool SameColours( const SDrawPacket& a, const SDrawPacket& b )
+{
+	if (a.DiffuseColour == b.DiffuseColour && a.SpecularColour == b.SpecularColour &&
+	    a.SpecularPower == b.SpecularPower)
+	{
+		return true;
+	}
+	return memcmp( a.DiffuseColour, b.DiffuseColour, sizeof(SColourRGBA) ) == 0 &&
+	       memcmp( a.SpecularColour, b.SpecularColour, sizeof(SColourRGBA) ) == 0 &&
+	       a.SpecularPower == b.SpecularPower;
+}
+
+// Whether two packets can be drawn as instances of one draw - everything but the world matrix
+// the same. Packets of a sub-mesh share its instanced layout, so that check alone nearly always
+// decides it
+inline bool CanInstanceTogether( const SDrawPacket& a, const SDrawPacket& b )
+{
+	return a.InstancedLayout != kNoRenderHandle && a.InstancedLayout == b.InstancedLayout &&
+	       a.Method == b.Method && a.VertexBuffer == b.VertexBuffer && a.BaseVertex == b.BaseVertex &&
+	       a.IndexBuffer == b.IndexBuffer && a.StartIndex == b.StartIndex && a.NumIndices == b.NumIndices &&
+	       SameTextures( a, b ) && SameColours( a, b );
+}
+
+
+//-----------------------------------------------------------------------------
+// Draw queue
+//-----------------------------------------------------------------------------
+
+// Constructor reserves space for a typical frame of draws
+CDrawQueue::CDrawQueue()
+{
+	m_Packets.reserve( 1024 );
+	m_Order.reserve( 1024 );
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+
+	m_InstanceBuffer = kNoRenderHandle;
+	m_MaxInstances = 0;
+	m_InstancingEnabled = false;
+}
+
+
+// Create an instance buffer on the global render device for the given number of instances (it
+// grows if a frame needs more), and draw runs of matching packets as instances from now on
+bool CDrawQueue::InitialiseInstancing( TUInt32 maxInstances )
+{
+	ReleaseInstancing();
+	if (maxInstances == 0) maxInstances = 1;
+
+	m_InstanceBuffer = RenderDevice->CreateDynamicVertexBuffer( maxInstances * sizeof(CMatrix4x4) );
+	if (!m_InstanceBuffer) return false;
+	m_MaxInstances = maxInstances;
+	m_InstancingEnabled = true;
+	return true;
+}
+
+// Release the instance buffer - packets are then drawn one at a time
+void CDrawQueue::ReleaseInstancing()
+{
+	RenderDevice->Release( m_InstanceBuffer );
+	m_InstanceBuffer = kNoRenderHandle;
+	m_MaxInstances = 0;
+	m_InstancingEnabled = false;
+}
+
+
+// Remove all packets, ready for the next frame
+void CDrawQueue::Clear()
+{
+	m_Packets.clear();
+	m_Order.clear();
+}
+
+// Add a draw to the queue. The pass (0-15) orders whole groups of draws, e.g. scene before
+// post-processed materials. Depth is the distance of the draw from the camera scaled to 0-1,
+// smaller depths being drawn first within a group
+void CDrawQueue::Add( const SDrawPacket& packet, TUInt32 pass, TFloat32 depth )
+{
+	TUInt32 textureSet = 0;
+	for (TUInt32 texture = 0; texture < packet.NumTextures; ++texture)
+	{
+		textureSet = textureSet * 31 + packet.Textures[texture];
+	}
+
+	if (depth < 0.0f) depth = 0.0f;
+	if (depth > 1.0f) depth = 1.0f;
+	TUInt32 depthField = static_cast<TUInt32>(depth * kKeyDepthMask);
+
+	SSortItem item;
+	item.Key = (static_cast<TUInt64>(pass & kKeyPassMask) << kKeyPassShift) |
+	           (static_cast<TUInt64>(packet.Method & kKeyMethodMask) << kKeyMethodShift) |
+	           (static_cast<TUInt64>(FoldToKeyField( textureSet )) << kKeyTextureSetShift) |
+	           (static_cast<TUInt64>(MeshKeyField( packet )) << kKeyMeshShift) |
+	           depthField;
+	item.Packet = static_cast<TUInt32>(m_Packets.size());
+
+	m_Packets.push_back( packet );
+	m_Packets.back().SortKey = item.Key;
+	m_Order.push_back( item );
+}
+
+// Add the packets of another queue after those already here, in the other queue's current order
+void CDrawQueue::Append( const CDrawQueue& other )
+{
+	TUInt32 firstPacket = static_cast<TUInt32>(m_Packets.size());
+	m_Packets.insert( m_Packets.end(), other.m_Packets.begin(), other.m_Packets.end() );
+	for (TUInt32 item = 0; item < other.m_Order.size(); ++item)
+	{
+		SSortItem appended = other.m_Order[item];
+		appended.Packet += firstPacket;
+		m_Order.push_back( appended );
+	}
+}
+
+
+// Sort the packets on their keys. A least significant digit radix sort on the 8 bytes of the
+// key, skipping bytes that are the same in every key (most of them in a typical frame - the pass
+// and method fields take few values)
+void CDrawQueue::Sort()
+{
+	TUInt32 numItems = static_cast<TUInt32>(m_Order.size());
+	if (numItems < 2) return;
+
+	// Count of each value of each byte, all in one pass over the keys
+	TUInt32 counts[8][256];
+	memset( counts, 0, sizeof(counts) );
+	for (TUInt32 item = 0; item < numItems; ++item)
+	{
+		TUInt64 key = m_Order[item].Key;
+		for (TUInt32 byte = 0; byte < 8; ++byte)
+		{
+			++counts[byte][(key >> (byte * 8)) & 0xff];
+		}
+	}
+
+	m_Scratch.resize( numItems );
+	for (TUInt32 byte = 0; byte < 8; ++byte)
+	{
+		// Nothing to do if every key has the same value in this byte
+		TUInt32* byteCounts = counts[byte];
+		if (byteCounts[(m_Order[0].Key >> (byte * 8)) & 0xff] == numItems) continue;
+
+		// Turn counts into starting positions, then scatter the items to them in order
+		TUInt32 position = 0;
+		for (TUInt32 value = 0; value < 256; ++value)
+		{
+			TUInt32 count = byteCounts[value];
+			byteCounts[value] = position;
+			position += count;
+		}
+		for (TUInt32 item = 0; item < numItems; ++item)
+		{
+			const SSortItem& sortItem = m_Order[item];
+			m_Scratch[byteCounts[(sortItem.Key >> (byte * 8)) & 0xff]++] = sortItem;
+		}
+		m_Order.swap( m_Scratch );
+	}
+}
+
+
+// Split the packets, in submit order, into runs and write the world matrices of every run of more
+// than one packet to the instance buffer. Returns false if there are no such runs
+bool CDrawQueue::BuildInstanceRuns()
+{
+	m_Runs.clear();
+	m_InstanceData.clear();
+
+	bool instancing = m_InstancingEnabled && m_InstanceBuffer != kNoRenderHandle;
+	TUInt32 numItems = static_cast<TUInt32>(m_Order.size());
+	for (TUInt32 item = 0; item < numItems; )
+	{
+		SDrawRun run;
+		run.First = item;
+		run.Count = 1;
+		run.FirstInstance = 0;
+
+		const SDrawPacket& first = m_Packets[m_Order[item].Packet];
+		if (instancing && first.InstancedLayout != kNoRenderHandle)
+		{
+			while (item + run.Count < numItems && CanInstanceTogether( first, m_Packets[m_Order[item + run.Count].Packet] ))
+			{
+				++run.Count;
+			}
+		}
+		if (run.Count > 1)
+		{
+			run.FirstInstance = static_cast<TUInt32>(m_InstanceData.size());
+			for (TUInt32 instance = 0; instance < run.Count; ++instance)
+			{
+				m_InstanceData.push_back( *m_Packets[m_Order[item + instance].Packet].WorldMatrix );
+			}
+		}
+		m_Runs.push_back( run );
+		item += run.Count;
+	}
+	if (m_InstanceData.empty()) return false;
+
+	// Grow the instance buffer if this frame has more instances than it holds. If a bigger buffer
+	// can't be made every packet is drawn on its own this frame
+	TUInt32 numInstances = static_cast<TUInt32>(m_InstanceData.size());
+	if (numInstances > m_MaxInstances)
+	{
+		TUInt32 maxInstances = m_MaxInstances;
+		while (maxInstances < numInstances) maxInstances *= 2;
+		TRenderHandle buffer = RenderDevice->CreateDynamicVertexBuffer( maxInstances * sizeof(CMatrix4x4) );
+		if (!buffer)
+		{
+			m_Runs.clear();
+			for (TUInt32 item = 0; item < numItems; ++item)
+			{
+				SDrawRun run = { item, 1, 0 };
+				m_Runs.push_back( run );
+			}
+			return false;
+		}
+		RenderDevice->Release( m_InstanceBuffer );
+		m_InstanceBuffer = buffer;
+		m_MaxInstances = maxInstances;
+	}
+
+	RenderDevice->UpdateVertexBuffer( m_InstanceBuffer, &m_InstanceData[0], numInstances * sizeof(CMatrix4x4) );
+	return true;
+}
+
+
+// Draw all the packets in their current order using the global render device, skipping state
+// that is unchanged from the previous packet, and drawing runs of matching packets as instances
+// if instancing is on
+void CDrawQueue::Submit()
+{
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+	if (m_Order.empty()) return;
+
+	RenderDevice->SetPrimitiveTopology( kTriangleList );
+
+	// Group the packets into draw calls, sending the world matrices of any instanced draws in one go.
+	// Layouts of single draws don't read the instance buffer, so it can stay bound throughout
+	if (BuildInstanceRuns())
+	{
+		RenderDevice->SetInstanceBuffer( m_InstanceBuffer, sizeof(CMatrix4x4) );
+	}
+
+	const SDrawPacket* last = 0;
+	TRenderHandle technique = kNoRenderHandle;
+	TRenderHandle instancedTechnique = kNoRenderHandle;
+	TUInt32 numPasses = 0;
+	TUInt32 numInstancedPasses = 0;
+	TRenderHandle layout = kNoRenderHandle;
+	for (TUInt32 r = 0; r < m_Runs.size(); ++r)
+	{
+		const SDrawRun& run = m_Runs[r];
+		const SDrawPacket& packet = m_Packets[m_Order[run.First].Packet];
+		bool instanced = run.Count > 1;
+
+		// Render method and material - the method's setup function sets the world matrix along with
+		// the material, so only the matrix is needed if the material is unchanged (and not even that
+		// for instances, which have their matrices in the instance buffer)
+		bool newMethod = !last || packet.Method != last->Method;
+		bool newTextures = !last || !SameTextures( packet, *last );
+		if (newMethod || newTextures || !SameColours( packet, *last ))
+		{
+			SetRenderMethod( packet.Method, packet.DiffuseColour, packet.SpecularColour, packet.SpecularPower,
+			                 packet.Textures, packet.WorldMatrix );
+			++m_Stats.MaterialChanges;
+		}
+		else if (!instanced)
+		{
+			SetWorldMatrix( packet.WorldMatrix );
+		}
+		if (newMethod)
+		{
+			technique = GetRenderMethodTechnique( packet.Method );
+			numPasses = RenderDevice->NumPasses( technique );
+			instancedTechnique = GetRenderMethodInstancedTechnique( packet.Method );
+			numInstancedPasses = instancedTechnique ? RenderDevice->NumPasses( instancedTechnique ) : 0;
+			++m_Stats.MethodChanges;
+		}
+		if (newTextures) ++m_Stats.TextureChanges;
+
+		// Geometry
+		if (!last || packet.VertexBuffer != last->VertexBuffer || packet.VertexSize != last->VertexSize)
+		{
+			RenderDevice->SetVertexBuffer( packet.VertexBuffer, packet.VertexSize );
+			++m_Stats.BufferChanges;
+		}
+		TRenderHandle runLayout = instanced ? packet.InstancedLayout : packet.VertexLayout;
+		if (!last || runLayout != layout)
+		{
+			RenderDevice->SetInputLayout( runLayout );
+			layout = runLayout;
+			++m_Stats.BufferChanges;
+		}
+		if (!last || packet.IndexBuffer != last->IndexBuffer)
+		{
+			RenderDevice->SetIndexBuffer( packet.IndexBuffer );
+			++m_Stats.BufferChanges;
+		}
+
+		// Same draws as CMesh::RenderSubMesh, once for all the instances of a run. Each pass is
+		// applied for every draw as applying a pass is what sends the new world matrix to the shaders
+		if (instanced)
+		{
+			for (TUInt32 p = 0; p < numInstancedPasses; ++p)
+			{
+				RenderDevice->ApplyPass( instancedTechnique, p );
+				RenderDevice->DrawIndexedInstanced( packet.NumIndices, run.Count, packet.StartIndex, packet.BaseVertex, run.FirstInstance );
+			}
+			RenderDevice->DrawIndexedInstanced( packet.NumIndices, run.Count, packet.StartIndex, packet.BaseVertex, run.FirstInstance );
+			++m_Stats.InstancedDraws;
+			m_Stats.Instances += run.Count;
+		}
+		else
+		{
+			for (TUInt32 p = 0; p < numPasses; ++p)
+			{
+				RenderDevice->ApplyPass( technique, p );
+				RenderDevice->DrawIndexed( packet.NumIndices, packet.StartIndex, packet.BaseVertex );
+			}
+			RenderDevice->DrawIndexed( packet.NumIndices, packet.StartIndex, packet.BaseVertex );
+		}
+		++m_Stats.Draws;
+
+		last = &m_Packets[m_Order[run.First + run.Count - 1].Packet];
+	}
+}
+
+
+} // namespace gen
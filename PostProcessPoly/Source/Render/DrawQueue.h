@@ -0,0 +1,283 @@
+/*******************************************
+	DrawQueue.h
+
+	Queue of sub-mesh draws sorted to reduce
+	state changes
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "RenderDevice.h"
+#include "RenderMethod.h"
+#include "CMatrix4x4.h"
+#include "Colour.h"
+#include "Parallel.h"
+
+namespace gen
+{
+
+// Everything needed to draw a sub-mesh with its material. The pointers are to data held by
+// the mesh and the entity, which must not change until the queue has been submitted
+struct SDrawPacket
+{
+	TUInt64        SortKey; // Set by CDrawQueue::Add
+
+	// Material
+	ERenderMethod  Method;
+	SColourRGBA*   DiffuseColour;
+	SColourRGBA*   SpecularColour;
+	TFloat32       SpecularPower;
+	TUInt32        NumTextures;
+	TRenderHandle* Textures;
+
+	CMatrix4x4*    WorldMatrix;
+
+	// Geometry - an indexed triangle list, in buffers that may hold other geometry too
+	TRenderHandle  VertexBuffer;
+	TUInt32        VertexSize;
+	TInt32         BaseVertex;      // Vertex in the buffer that index 0 refers to
+	TRenderHandle  VertexLayout;
+	TRenderHandle  InstancedLayout; // Layout for the method's instanced technique, 0 if the draw can't be instanced
+	TRenderHandle  IndexBuffer;
+	TUInt32        StartIndex;
+	TUInt32        NumIndices;
+};
+
+
+// State changes made by CDrawQueue::Submit. A change is counted when a draw needs a value that
+// differs from the draw before it
+struct SDrawQueueStats
+{
+	TUInt32 Draws;           // Draw calls, an instanced draw counting as one
+	TUInt32 InstancedDraws;  // Draw calls that drew more than one packet
+	TUInt32 Instances;       // Packets drawn by instanced draws
+	TUInt32 MethodChanges;   // Technique / render method
+	TUInt32 MaterialChanges; // Render method set up again for new colours or textures
+	TUInt32 TextureChanges;  // Draws whose textures differ from the last (part of a material change)
+	TUInt32 BufferChanges;   // Vertex buffer, index buffer and input layout binds
+};
+
+
+// A queue of sub-mesh draws for a frame. The scene traversal adds a packet for each visible
+// sub-mesh, the queue is sorted on a 64-bit key, then submitted in one loop that only sets up
+// state that differs from the previous packet. Submitting without sorting draws in the order
+// the packets were added, with the same redundant state skipped, to compare the two.
+//
+// The key, from most to least significant bits:
+//     63-60 pass, 59-52 render method, 51-36 texture set, 35-20 mesh, 19-0 depth
+// so draws are grouped by technique, then textures, then geometry, and front to back within
+// a group. The texture set is folded from the texture handles, and the mesh from the buffers
+// and where the geometry starts in them (the top bits from the vertex buffer, so draws sharing
+// a buffer are together) - two different sets may share a value, which only affects grouping
+// and not what is drawn.
+//
+// With instancing initialised, a run of consecutive packets that share render method, material
+// and geometry is drawn with one instanced draw if the method has an instanced technique. The
+// world matrices of all instanced packets are written to one instance buffer per submit. Sorting
+// first is what makes such runs long - the key puts the draws of a mesh with the same method and
+// textures next to each other
+class CDrawQueue
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Constructor reserves space for a typical frame of draws
+	CDrawQueue();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CDrawQueue( const CDrawQueue& );
+	CDrawQueue& operator=( const CDrawQueue& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Instancing
+
+	// Create an instance buffer on the global render device for the given number of instances
+	// (it grows if a frame needs more), and draw runs of matching packets as instances from now
+	// on. Returns false if the buffer could not be created
+	bool InitialiseInstancing( TUInt32 maxInstances );
+
+	// Release the instance buffer - packets are then drawn one at a time. Must be called before
+	// the render device is shut down
+	void ReleaseInstancing();
+
+	// Turn instancing on or off without releasing the buffer, e.g. to compare the two
+	void EnableInstancing( bool enable )
+	{
+		m_InstancingEnabled = enable;
+	}
+
+
+	/////////////////////////////////////
+	// Queue
+
+	// Remove all packets, ready for the next frame
+	void Clear();
+
+	// Add a draw to the queue. The pass (0-15) orders whole groups of draws, e.g. scene before
+	// post-processed materials. Depth is the distance of the draw from the camera scaled to 0-1,
+	// smaller depths being drawn first within a group
+	void Add( const SDrawPacket& packet, TUInt32 pass, TFloat32 depth );
+
+	// Add the packets of another queue after those already here, in the other queue's current
+	// order. Keys are kept, so the result sorts as if the packets had been added here. Used to
+	// merge lists built on separate threads
+	void Append( const CDrawQueue& other );
+
+	// Number of packets in the queue
+	TUInt32 NumPackets()
+	{
+		return static_cast<TUInt32>(m_Packets.size());
+	}
+
+	// A packet in the queue, by the order it was added
+	const SDrawPacket& GetPacket( TUInt32 packet )
+	{
+		return m_Packets[packet];
+	}
+
+	// A packet in the queue, by the order it will be submitted (the order added until sorted)
+	const SDrawPacket& GetSortedPacket( TUInt32 position )
+	{
+		return m_Packets[m_Order[position].Packet];
+	}
+
+	// Sort the packets on their keys (a radix sort, stable for equal keys)
+	void Sort();
+
+	// Draw all the packets in their current order using the global render device, skipping state
+	// that is unchanged from the previous packet, and drawing runs of matching packets as
+	// instances if instancing is on. Any state set before the call is not relied on
+	void Submit();
+
+	// State changes made by the last call to Submit
+	const SDrawQueueStats& Stats()
+	{
+		return m_Stats;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// A packet's key and its index in m_Packets, the unit of the sort
+	struct SSortItem
+	{
+		TUInt64 Key;
+		TUInt32 Packet;
+	};
+
+	// Packets drawn by one draw call - a single packet, or a run of packets drawn as instances
+	// whose world matrices start at FirstInstance in the instance buffer
+	struct SDrawRun
+	{
+		TUInt32 First; // Position in m_Order
+		TUInt32 Count;
+		TUInt32 FirstInstance;
+	};
+
+	// Split the packets, in submit order, into runs and write the world matrices of every run of
+	// more than one packet to the instance buffer. Returns false if there are no such runs
+	bool BuildInstanceRuns();
+
+	vector<SDrawPacket> m_Packets; // In order added
+	vector<SSortItem>   m_Order;   // Order to submit
+	vector<SSortItem>   m_Scratch; // Second buffer for the sort
+
+	// Instancing
+	TRenderHandle       m_InstanceBuffer;
+	TUInt32             m_MaxInstances;
+	bool                m_InstancingEnabled;
+	vector<SDrawRun>    m_Runs;
+	vector<CMatrix4x4>  m_InstanceData;
+
+	SDrawQueueStats     m_Stats;
+};
+
+
+// Draw lists for building one queue on several threads. The items to queue (e.g. entities) are
+// split into contiguous ranges, one for each thread, and each range is added to a list of its
+// own. The lists are then appended to the queue in range order, so the queue gets the same packets
+// in the same order as if all the items had been added to it on one thread. The lists are kept
+// between frames so their space is reused
+class CThreadDrawLists
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CThreadDrawLists() {}
+	~CThreadDrawLists()
+	{
+		for (TUInt32 list = 0; list < m_Lists.size(); ++list)
+		{
+			delete m_Lists[list];
+		}
+	}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CThreadDrawLists( const CThreadDrawLists& );
+	CThreadDrawLists& operator=( const CThreadDrawLists& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Add packets for the items [0, count) to the queue using up to numThreads threads, by calling
+	// queueRange( list, rangeBegin, rangeEnd ) to add each range of items to a draw queue. Fewer
+	// than minPerThread items for each thread use fewer threads, and with one thread the items are
+	// added to the queue directly
+	template <class TQueueRange>
+	void Queue( CDrawQueue* queue, TUInt32 count, TUInt32 numThreads, TQueueRange queueRange, TUInt32 minPerThread = 64 )
+	{
+		if (minPerThread > 0 && numThreads > count / minPerThread)
+		{
+			numThreads = count / minPerThread;
+		}
+		if (numThreads <= 1)
+		{
+			queueRange( queue, 0, count );
+			return;
+		}
+
+		while (m_Lists.size() < numThreads)
+		{
+			m_Lists.push_back( new CDrawQueue );
+		}
+		ParallelForRanges( count, numThreads, [&]( TUInt32 range, TUInt32 rangeBegin, TUInt32 rangeEnd )
+		{
+			m_Lists[range]->Clear();
+			queueRange( m_Lists[range], rangeBegin, rangeEnd );
+		} );
+
+		for (TUInt32 list = 0; list < numThreads; ++list)
+		{
+			queue->Append( *m_Lists[list] );
+		}
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	vector<CDrawQueue*> m_Lists;
+};
+
+
+} // namespace gen
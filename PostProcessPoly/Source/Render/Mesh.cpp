@@ -4,10 +4,11 @@
 	Mesh class implementation
 ********************************************/
 
-#include <d3d10.h>
-#include <d3dx10.h>
+#include <memory>
+using namespace std;
+
 #include "Mesh.h"
-#include "CImportXFile.h"
+#include "MeshImport.h"
 #include "RenderMethod.h"
 
 namespace gen
@@ -15,7 +16,14 @@ namespace gen
 
 // Get reference to global variables from another source file
 // Not good practice - these functions should be part of a class with this as a member
-extern ID3D10Device* g_pd3dDevice;
+extern IRenderDevice* RenderDevice;
+
+// Shared buffers holding the geometry of all meshes, and the vertex formats and layouts they use
+extern CMeshArena MeshArena;
+extern CVertexFormatRegistry VertexFormats;
+
+// Textures shared by all meshes
+extern CTextureCache TextureCache;
 
 // Folder for all texture and mesh files
 extern const string MediaFolder;
@@ -56,7 +64,7 @@ void CMesh::ReleaseResources()
 	{
 		for (TUInt32 texture = 0; texture < m_Materials[material].numTextures; ++texture)
 		{
-			if (m_Materials[material].textures[texture]) m_Materials[material].textures[texture]->Release();
+			TextureCache.Release( m_Materials[material].textures[texture] );
 		}
 	}
 	delete[] m_Materials;
@@ -65,9 +73,8 @@ void CMesh::ReleaseResources()
 
 	for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
 	{
-		if (m_SubMeshesDX[subMesh].indexBuffer)	 m_SubMeshesDX[subMesh].indexBuffer->Release();
-		if (m_SubMeshesDX[subMesh].vertexBuffer) m_SubMeshesDX[subMesh].vertexBuffer->Release();
-		if (m_SubMeshesDX[subMesh].vertexLayout) m_SubMeshesDX[subMesh].vertexLayout->Release();
+		MeshArena.Free( m_SubMeshesDX[subMesh].indexAllocation );
+		MeshArena.Free( m_SubMeshesDX[subMesh].vertexAllocation );
 	}
 	delete[] m_SubMeshesDX;
 	delete[] m_SubMeshes;
@@ -230,17 +237,22 @@ bool CMesh::GetVertex( CVector3* pVertex )
 // Creation
 //-----------------------------------------------------------------------------
 
-// Create the model from an X-File, returns true on success
+// Create the model from a mesh file (an X-File), returns true on success
 bool CMesh::Load( const string& fileName )
 {
-	// Create a X-File import helper class
-	CImportXFile importFile;
+	// Create an import helper from the render device, which knows how to read its mesh files
+	unique_ptr<IMeshImport> import( RenderDevice->CreateMeshImport() );
+	if (!import.get())
+	{
+		return false;
+	}
+	IMeshImport& importFile = *import;
 
 	// Add media folder path
 	string fullFileName = MediaFolder + fileName;
 
-	// Check that the given file is an X-file
-	if (!importFile.IsXFile( fullFileName ))
+	// Check that the given file is one the importer reads
+	if (!importFile.IsMeshFile( fullFileName ))
 	{
 		return false;
 	}
@@ -345,126 +357,132 @@ bool CMesh::CreateSubMeshDX
 	subMeshDX->numIndices = subMesh.numFaces * 3; // Using triangle lists, so always 3 indexes per face
 
 	// Create vertex element list & layout.
+	SVertexElement vertexElts[kMaxVertexElements];
 	unsigned int numElts = 0;
 	unsigned int offset = 0;
 
 	// Position is always required
-	subMeshDX->vertexElts[numElts].SemanticName = "POSITION";   // Semantic in HLSL (what is this data for)
-	subMeshDX->vertexElts[numElts].SemanticIndex = 0;           // Index to add to semantic (a count for this kind of data, when using multiple of the same type, e.g. TEXCOORD0, TEXCOORD1)
-	subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R32G32B32_FLOAT; // Type of data - this one will be a float3 in the shader. Most data communicated as though it were colours
-	subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;  // Offset of element from start of vertex data (e.g. if we have position (float3), uv (float2) then normal, the normal's offset is 5 floats = 5*4 = 20)
-	subMeshDX->vertexElts[numElts].InputSlot = 0;               // For when using multiple vertex buffers (e.g. instancing - an advanced topic)
-	subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA; // Use this value for most cases (only changed for instancing)
-	subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;                     // --"--
+	vertexElts[numElts].Semantic = "POSITION";       // Semantic in HLSL (what is this data for)
+	vertexElts[numElts].SemanticIndex = 0;           // Index to add to semantic (a count for this kind of data, when using multiple of the same type, e.g. TEXCOORD0, TEXCOORD1)
+	vertexElts[numElts].Format = kVertexFloat3;      // Type of data - this one will be a float3 in the shader
+	vertexElts[numElts].Offset = offset;             // Offset of element from start of vertex data (e.g. if we have position (float3), uv (float2) then normal, the normal's offset is 5 floats = 5*4 = 20)
+	vertexElts[numElts].Slot = 0;
 	offset += 12;
 	++numElts;
 
 	// Repeat for each kind of vertex data
 	if (subMesh.hasSkinningData) // If sub-mesh contains skinning data
 	{
-		subMeshDX->vertexElts[numElts].SemanticName = "BLENDWEIGHT";
-		subMeshDX->vertexElts[numElts].SemanticIndex = 0;
-		subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R32G32B32A32_FLOAT;
-		subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;
-		subMeshDX->vertexElts[numElts].InputSlot = 0;
-		subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;
+		vertexElts[numElts].Semantic = "BLENDWEIGHT";
+		vertexElts[numElts].SemanticIndex = 0;
+		vertexElts[numElts].Format = kVertexFloat4;
+		vertexElts[numElts].Offset = offset;
+		vertexElts[numElts].Slot = 0;
 		offset += 16;
 		++numElts;
-		subMeshDX->vertexElts[numElts].SemanticName = "BLENDINDICES";
-		subMeshDX->vertexElts[numElts].SemanticIndex = 0;
-		subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R8G8B8A8_UINT;
-		subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;
-		subMeshDX->vertexElts[numElts].InputSlot = 0;
-		subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;
+		vertexElts[numElts].Semantic = "BLENDINDICES";
+		vertexElts[numElts].SemanticIndex = 0;
+		vertexElts[numElts].Format = kVertexUByte4;
+		vertexElts[numElts].Offset = offset;
+		vertexElts[numElts].Slot = 0;
 		offset += 4;
 		++numElts;
 	}
 	if (subMesh.hasNormals)
 	{
-		subMeshDX->vertexElts[numElts].SemanticName = "NORMAL";
-		subMeshDX->vertexElts[numElts].SemanticIndex = 0;
-		subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;
-		subMeshDX->vertexElts[numElts].InputSlot = 0;
-		subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;
+		vertexElts[numElts].Semantic = "NORMAL";
+		vertexElts[numElts].SemanticIndex = 0;
+		vertexElts[numElts].Format = kVertexFloat3;
+		vertexElts[numElts].Offset = offset;
+		vertexElts[numElts].Slot = 0;
 		offset += 12;
 		++numElts;
 	}
 	if (subMesh.hasTangents)
 	{
-		subMeshDX->vertexElts[numElts].SemanticName = "TANGENT";
-		subMeshDX->vertexElts[numElts].SemanticIndex = 0;
-		subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R32G32B32_FLOAT;
-		subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;
-		subMeshDX->vertexElts[numElts].InputSlot = 0;
-		subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;
+		vertexElts[numElts].Semantic = "TANGENT";
+		vertexElts[numElts].SemanticIndex = 0;
+		vertexElts[numElts].Format = kVertexFloat3;
+		vertexElts[numElts].Offset = offset;
+		vertexElts[numElts].Slot = 0;
 		offset += 12;
 		++numElts;
 	}
 	if (subMesh.hasTextureCoords)
 	{
-		subMeshDX->vertexElts[numElts].SemanticName = "TEXCOORD";
-		subMeshDX->vertexElts[numElts].SemanticIndex = 0;
-		subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R32G32_FLOAT;
-		subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;
-		subMeshDX->vertexElts[numElts].InputSlot = 0;
-		subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;
+		vertexElts[numElts].Semantic = "TEXCOORD";
+		vertexElts[numElts].SemanticIndex = 0;
+		vertexElts[numElts].Format = kVertexFloat2;
+		vertexElts[numElts].Offset = offset;
+		vertexElts[numElts].Slot = 0;
 		offset += 8;
 		++numElts;
 	}
 	if (subMesh.hasVertexColours)
 	{
-		subMeshDX->vertexElts[numElts].SemanticName = "COLOR";
-		subMeshDX->vertexElts[numElts].SemanticIndex = 0;
-		subMeshDX->vertexElts[numElts].Format = DXGI_FORMAT_R8G8B8A8_UNORM; // A RGBA colour with 1 byte (0-255) per component
-		subMeshDX->vertexElts[numElts].AlignedByteOffset = offset;
-		subMeshDX->vertexElts[numElts].InputSlot = 0;
-		subMeshDX->vertexElts[numElts].InputSlotClass = D3D10_INPUT_PER_VERTEX_DATA;
-		subMeshDX->vertexElts[numElts].InstanceDataStepRate = 0;
+		vertexElts[numElts].Semantic = "COLOR";
+		vertexElts[numElts].SemanticIndex = 0;
+		vertexElts[numElts].Format = kVertexUByte4Norm; // A RGBA colour with 1 byte (0-255) per component
+		vertexElts[numElts].Offset = offset;
+		vertexElts[numElts].Slot = 0;
 		offset += 4;
 		++numElts;
 	}
 	subMeshDX->vertexSize = offset;
 
-	// Given the vertex element list, pass it to DirectX to create a vertex layout. We also need to pass an example of a technique that will
-	// render this model. We will only be able to render this model with techniques that have the same vertex input as the example we use here
-	D3D10_PASS_DESC PassDesc;
-	ID3D10EffectTechnique* technique = GetRenderMethodTechnique( m_Materials[subMeshDX->material].renderMethod );
-	technique->GetPassByIndex( 0 )->GetDesc( &PassDesc );
-	g_pd3dDevice->CreateInputLayout( subMeshDX->vertexElts, numElts, PassDesc.pIAInputSignature, PassDesc.IAInputSignatureSize, &subMeshDX->vertexLayout );
-
-
-	// Create the vertex buffer and fill it with the sub-mesh vertex data
-	D3D10_BUFFER_DESC bufferDesc;
-	bufferDesc.BindFlags = D3D10_BIND_VERTEX_BUFFER;
-	bufferDesc.Usage = D3D10_USAGE_DEFAULT; // Not a dynamic buffer
-	bufferDesc.ByteWidth = subMeshDX->numVertices * subMeshDX->vertexSize; // Buffer size
-	bufferDesc.CPUAccessFlags = 0;   // Indicates that CPU won't access this buffer at all after creation
-	bufferDesc.MiscFlags = 0;
-	D3D10_SUBRESOURCE_DATA initData; // Initial data
-	initData.pSysMem = subMesh.vertices;   
-	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &subMeshDX->vertexBuffer )))
+	// Given the vertex element list, get the shared vertex format and its layout. We also need to pass an example of a technique that will
+	// render this model. We will only be able to render this model with techniques that have the same vertex input as the example we use here.
+	// Sub-meshes with the same format and technique share one layout
+	if (!VertexFormats.RegisterFormat( vertexElts, numElts, subMeshDX->vertexFormat ))
+	{
+		return false;
+	}
+	TRenderHandle technique = GetRenderMethodTechnique( m_Materials[subMeshDX->material].renderMethod );
+	subMeshDX->vertexLayout = VertexFormats.GetInputLayout( subMeshDX->vertexFormat, technique );
+
+	// Methods with an instanced technique also get a layout for it - the same vertex elements followed by the rows of each instance's
+	// world matrix, read from the instance buffer (slot 1) rather than the vertex buffer. If the layout can't be made the sub-mesh is
+	// just never instanced
+	subMeshDX->instancedLayout = kNoRenderHandle;
+	TRenderHandle instancedTechnique = GetRenderMethodInstancedTechnique( m_Materials[subMeshDX->material].renderMethod );
+	TVertexFormat instancedFormat;
+	if (instancedTechnique && numElts + 4 <= kMaxVertexElements)
+	{
+		SVertexElement instancedElts[kMaxVertexElements];
+		for (unsigned int elt = 0; elt < numElts; ++elt)
+		{
+			instancedElts[elt] = vertexElts[elt];
+		}
+		for (unsigned int row = 0; row < 4; ++row)
+		{
+			instancedElts[numElts + row].Semantic = "WORLD";
+			instancedElts[numElts + row].SemanticIndex = row;
+			instancedElts[numElts + row].Format = kVertexFloat4;
+			instancedElts[numElts + row].Offset = row * 16; // Instance data is a CMatrix4x4, one row per element
+			instancedElts[numElts + row].Slot = 1;
+		}
+		if (VertexFormats.RegisterFormat( instancedElts, numElts + 4, instancedFormat ))
+		{
+			subMeshDX->instancedLayout = VertexFormats.GetInputLayout( instancedFormat, instancedTechnique );
+		}
+	}
+
+
+	// Copy the sub-mesh vertex data into the shared vertex buffers. The arena allocates in whole vertices, so the offset gives the base vertex
+	if (!MeshArena.AllocateVertices( subMesh.vertices, subMeshDX->numVertices, subMeshDX->vertexSize, subMeshDX->vertexAllocation ))
 	{
 		return false;
 	}
+	subMeshDX->baseVertex = static_cast<TInt32>(subMeshDX->vertexAllocation.Offset / subMeshDX->vertexSize);
 
 
-	// Create the index buffer - assuming 2-byte (WORD) index data
-	bufferDesc.BindFlags = D3D10_BIND_INDEX_BUFFER;
-	bufferDesc.Usage = D3D10_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = subMeshDX->numIndices * sizeof(WORD);
-	bufferDesc.CPUAccessFlags = 0;
-	bufferDesc.MiscFlags = 0;
-	initData.pSysMem = subMesh.faces;   
-	if (FAILED( g_pd3dDevice->CreateBuffer( &bufferDesc, &initData, &subMeshDX->indexBuffer )))
+	// Copy the index data into the shared index buffers - assuming 2-byte (WORD) index data
+	if (!MeshArena.AllocateIndices( reinterpret_cast<const TUInt16*>(subMesh.faces), subMeshDX->numIndices, subMeshDX->indexAllocation ))
 	{
+		MeshArena.Free( subMeshDX->vertexAllocation ); // A sub-mesh that fails to be created is not released with the others
 		return false;
 	}
+	subMeshDX->startIndex = subMeshDX->indexAllocation.Offset / sizeof(TUInt16);
 
 	return true;
 }
@@ -484,19 +502,20 @@ bool CMesh::CreateMaterialDX
 	}
 
 	// Copy colours and shininess from material
-	materialDX->diffuseColour = D3DXCOLOR( material.diffuseColour.r, material.diffuseColour.g, 
-	                                       material.diffuseColour.b, material.diffuseColour.a );
-	materialDX->specularColour = D3DXCOLOR( material.specularColour.r, material.specularColour.g, 
-	                                        material.specularColour.b, material.specularColour.a );
+	materialDX->diffuseColour = material.diffuseColour;
+	materialDX->specularColour = material.specularColour;
 	materialDX->specularPower = material.specularPower;
 
-	// Load material textures
+	// Get material textures from the cache, which loads those not already used by another mesh.
+	// On failure the textures already got are given back, as this material won't be released
 	materialDX->numTextures = material.numTextures;
 	for (TUInt32 texture = 0; texture < material.numTextures; ++texture)
 	{
 		string fullFileName = MediaFolder + material.textureFileNames[texture];
-		if (FAILED( D3DX10CreateShaderResourceViewFromFile( g_pd3dDevice, fullFileName.c_str(), NULL, NULL, &materialDX->textures[texture], NULL ) ))
+		materialDX->textures[texture] = TextureCache.Acquire( fullFileName );
+		if (!materialDX->textures[texture])
 		{
+			while (texture > 0) TextureCache.Release( materialDX->textures[--texture] );
 			string errorMsg = "Error loading texture " + fullFileName;
 			SystemMessageBox( errorMsg.c_str(), "Mesh Error" );
 			return false;
@@ -595,54 +614,123 @@ bool CMesh::PreProcess()
 //-----------------------------------------------------------------------------
 
 // Render the model from the given camera using the given matrix list as a hierarchy (must be one matrix per node)
-void CMesh::Render(	CMatrix4x4* matrices, CCamera* camera, bool postProcess /*= false*/ )
+// Returns false if the mesh was outside the camera frustum (or has no geometry) and nothing was rendered
+bool CMesh::Render(	CMatrix4x4* matrices, CCamera* camera, bool postProcess /*= false*/ )
 {
-	if (!m_HasGeometry) return;
-
-	// Test if mesh is visible - test the mesh's bounding sphere against the camera frustum
-	CVector3 scale = matrices[0].GetScale();
-	TFloat32 scaledRadius = m_BoundingRadius * Max(scale.x, Max(scale.y, scale.z) ); // Scale bounding sphere by largest dimension of mesh scale
-	if (!camera->SphereInFrustum( matrices->Position(), scaledRadius ))
-	{
-		return;
-	}
+	if (!InFrustum( matrices, camera )) return false;
 
 	// Render each sub-mesh
 	for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
 	{
-		// Get a reference to the submesh and its material to reduce code clutter
-		SSubMeshDX& subMeshDX = m_SubMeshesDX[subMesh];
-		SMeshMaterialDX& material = m_Materials[subMeshDX.material];
-
 		//****|PPPPOLY|********************************************************************************
 		// In the model rendering code, we can now request to render either normal or post-processed 
 		// materials. Post processed materials are rendered in a 2nd pass after all the normal materials
 		//
 		// Check that material type (normal or post-processed) matches request passed as parameter before rendering
-		if (RenderMethodIsPostProcess( material.renderMethod ) == postProcess)
+		if (IsPostProcessSubMesh( subMesh ) == postProcess)
 		{
-			// Set up render method passing material colours & textures and the sub-mesh's world matrix, also get back the fx file technique to use
-			SetRenderMethod( material.renderMethod, &material.diffuseColour, &material.specularColour, material.specularPower, material.textures, &matrices[subMeshDX.node] );
-			ID3D10EffectTechnique* technique = GetRenderMethodTechnique( material.renderMethod );
-
-			// Select vertex and index buffer for sub-mesh - assuming all geometry data is triangle lists
-			UINT offset = 0;
-			g_pd3dDevice->IASetVertexBuffers( 0, 1, &subMeshDX.vertexBuffer, &subMeshDX.vertexSize, &offset );
-			g_pd3dDevice->IASetInputLayout(subMeshDX.vertexLayout );
-			g_pd3dDevice->IASetIndexBuffer(subMeshDX.indexBuffer, DXGI_FORMAT_R16_UINT, 0 );
-			g_pd3dDevice->IASetPrimitiveTopology( D3D10_PRIMITIVE_TOPOLOGY_TRIANGLELIST );
-
-			// Render the sub-mesh. Geometry buffers and shader variables, just select the technique for this method and draw.
-			D3D10_TECHNIQUE_DESC techDesc;
-			technique->GetDesc( &techDesc );
-			for( UINT p = 0; p < techDesc.Passes; ++p )
-			{
-				technique->GetPassByIndex( p )->Apply( 0 );
-				g_pd3dDevice->DrawIndexed( subMeshDX.numIndices, 0, 0 );
-			}
-			g_pd3dDevice->DrawIndexed( subMeshDX.numIndices, 0, 0 );
+			RenderSubMesh( subMesh, matrices );
+		}
+	}
+	return true;
+}
+
+// Render a single sub-mesh using the given matrix list as a hierarchy, with no visibility test
+void CMesh::RenderSubMesh( TUInt32 subMesh, CMatrix4x4* matrices )
+{
+	// Get a reference to the submesh and its material to reduce code clutter
+	SSubMeshDX& subMeshDX = m_SubMeshesDX[subMesh];
+	SMeshMaterialDX& material = m_Materials[subMeshDX.material];
+
+	// Set up render method passing material colours & textures and the sub-mesh's world matrix, also get back the fx file technique to use
+	SetRenderMethod( material.renderMethod, &material.diffuseColour, &material.specularColour, material.specularPower, material.textures, &matrices[subMeshDX.node] );
+	TRenderHandle technique = GetRenderMethodTechnique( material.renderMethod );
+
+	// Select vertex and index buffer for sub-mesh - assuming all geometry data is triangle lists
+	RenderDevice->SetVertexBuffer( subMeshDX.vertexAllocation.Buffer, subMeshDX.vertexSize );
+	RenderDevice->SetInputLayout( subMeshDX.vertexLayout );
+	RenderDevice->SetIndexBuffer( subMeshDX.indexAllocation.Buffer );
+	RenderDevice->SetPrimitiveTopology( kTriangleList );
+
+	// Render the sub-mesh. Geometry buffers and shader variables, just select the technique for this method and draw.
+	TUInt32 numPasses = RenderDevice->NumPasses( technique );
+	for( TUInt32 p = 0; p < numPasses; ++p )
+	{
+		RenderDevice->ApplyPass( technique, p );
+		RenderDevice->DrawIndexed( subMeshDX.numIndices, subMeshDX.startIndex, subMeshDX.baseVertex );
+	}
+	RenderDevice->DrawIndexed( subMeshDX.numIndices, subMeshDX.startIndex, subMeshDX.baseVertex );
+}
+
+// Add a draw packet for each sub-mesh to the given queue rather than rendering it, for a mesh
+// using the given matrix list as a hierarchy. Either normal or post-processed materials are
+// queued, in the given queue pass. Returns false if the mesh was outside the camera frustum
+// (or has no geometry) and nothing was queued
+bool CMesh::Queue( CDrawQueue* queue, CMatrix4x4* matrices, CCamera* camera, bool postProcess /*= false*/,
+                   TUInt32 pass /*= 0*/ )
+{
+	if (!InFrustum( matrices, camera )) return false;
+
+	TFloat32 depth = QueueDepth( matrices, camera );
+	for (TUInt32 subMesh = 0; subMesh < m_NumSubMeshes; ++subMesh)
+	{
+		if (IsPostProcessSubMesh( subMesh ) == postProcess)
+		{
+			AddPacket( queue, subMesh, matrices, pass, depth );
 		}
 	}
+	return true;
+}
+
+// Add a draw packet for a single sub-mesh to the given queue, using the given matrix list as a
+// hierarchy, with no visibility test
+void CMesh::QueueSubMesh( CDrawQueue* queue, TUInt32 subMesh, CMatrix4x4* matrices, CCamera* camera,
+                          TUInt32 pass /*= 0*/ )
+{
+	AddPacket( queue, subMesh, matrices, pass, QueueDepth( matrices, camera ) );
+}
+
+// Sort depth of the mesh placed with the given matrix list - the distance to the mesh origin as a
+// fraction of the far clip distance
+TFloat32 CMesh::QueueDepth( CMatrix4x4* matrices, CCamera* camera )
+{
+	return Distance( camera->Position(), matrices[0].Position() ) / camera->GetFarClip();
+}
+
+// Add the draw packet for a sub-mesh to a queue with the given depth
+void CMesh::AddPacket( CDrawQueue* queue, TUInt32 subMesh, CMatrix4x4* matrices, TUInt32 pass, TFloat32 depth )
+{
+	SSubMeshDX& subMeshDX = m_SubMeshesDX[subMesh];
+	SMeshMaterialDX& material = m_Materials[subMeshDX.material];
+
+	SDrawPacket packet;
+	packet.Method         = material.renderMethod;
+	packet.DiffuseColour  = &material.diffuseColour;
+	packet.SpecularColour = &material.specularColour;
+	packet.SpecularPower  = material.specularPower;
+	packet.NumTextures    = material.numTextures;
+	packet.Textures       = material.textures;
+	packet.WorldMatrix    = &matrices[subMeshDX.node];
+	packet.VertexBuffer   = subMeshDX.vertexAllocation.Buffer;
+	packet.BaseVertex     = subMeshDX.baseVertex;
+	packet.VertexSize     = subMeshDX.vertexSize;
+	packet.VertexLayout   = subMeshDX.vertexLayout;
+	packet.InstancedLayout = subMeshDX.instancedLayout;
+	packet.IndexBuffer    = subMeshDX.indexAllocation.Buffer;
+	packet.StartIndex     = subMeshDX.startIndex;
+	packet.NumIndices     = subMeshDX.numIndices;
+	queue->Add( packet, pass, depth );
+}
+
+// Whether the mesh, placed with the given matrix list, is in the camera frustum
+bool CMesh::InFrustum( CMatrix4x4* matrices, CCamera* camera )
+{
+	if (!m_HasGeometry) return false;
+
+	// Test if mesh is visible - test the mesh's bounding sphere against the camera frustum
+	CVector3 scale = matrices[0].GetScale();
+	TFloat32 scaledRadius = m_BoundingRadius * Max(scale.x, Max(scale.y, scale.z) ); // Scale bounding sphere by largest dimension of mesh scale
+	return camera->SphereInFrustum( matrices->Position(), scaledRadius );
 }
 
 
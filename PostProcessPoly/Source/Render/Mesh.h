@@ -9,13 +9,16 @@
 #include <string>
 using namespace std;
 
-#include <d3d10.h>
-
 #include "Defines.h"
+#include "RenderDevice.h"
 #include "CVector3.h"
 #include "CMatrix4x4.h"
 #include "MeshData.h"
 #include "Camera.h"
+#include "DrawQueue.h"
+#include "MeshArena.h"
+#include "VertexFormat.h"
+#include "TextureCache.h"
 
 namespace gen
 {
@@ -104,6 +107,33 @@ public:
 	}
 
 
+	/////////////////////////////////////
+	// Sub-mesh access
+
+	TUInt32 GetNumSubMeshes()
+	{
+		return m_NumSubMeshes;
+	}
+
+	// Node controlling the given sub-mesh
+	TUInt32 GetSubMeshNode( TUInt32 subMesh )
+	{
+		return m_SubMeshesDX[subMesh].node;
+	}
+
+	// Whether the given sub-mesh uses a post-processed material (rendered in a second pass)
+	bool IsPostProcessSubMesh( TUInt32 subMesh )
+	{
+		return RenderMethodIsPostProcess( m_Materials[m_SubMeshesDX[subMesh].material].renderMethod );
+	}
+
+	// Bytes of render data held for each sub-mesh (its geometry is in the mesh arena)
+	static size_t SubMeshDataSize()
+	{
+		return sizeof(SSubMeshDX);
+	}
+
+
 	/////////////////////////////////////
 	// Creation
 
@@ -115,7 +145,21 @@ public:
 	// Rendering
 
 	// Render the model from the given camera using the given matrix list as a hierarchy (must be one matrix per node)
-	void Render( CMatrix4x4* matrices, CCamera* camera, bool postProcess = false );
+	// Returns false if the mesh was outside the camera frustum (or has no geometry) and nothing was rendered
+	bool Render( CMatrix4x4* matrices, CCamera* camera, bool postProcess = false );
+
+	// Render a single sub-mesh using the given matrix list as a hierarchy, with no visibility test
+	void RenderSubMesh( TUInt32 subMesh, CMatrix4x4* matrices );
+
+	// Add a draw packet for each sub-mesh to the given queue rather than rendering it, for a mesh
+	// using the given matrix list as a hierarchy. Either normal or post-processed materials are
+	// queued, in the given queue pass. Returns false if the mesh was outside the camera frustum
+	// (or has no geometry) and nothing was queued
+	bool Queue( CDrawQueue* queue, CMatrix4x4* matrices, CCamera* camera, bool postProcess = false, TUInt32 pass = 0 );
+
+	// Add a draw packet for a single sub-mesh to the given queue, using the given matrix list as a
+	// hierarchy, with no visibility test
+	void QueueSubMesh( CDrawQueue* queue, TUInt32 subMesh, CMatrix4x4* matrices, CCamera* camera, TUInt32 pass = 0 );
 
 
 /*-----------------------------------------------------------------------------------------
@@ -127,40 +171,45 @@ private:
 	// Types
 
 	// The DirectX form of a sub-mesh. Stores controlling node and material used. The vertex/index data is
-	// stored in seperate vertex and index buffers for each mesh. This is sub-optimal - it/ would be better
-	// to share buffers between different meshes where possible, but this would make the code much more complex
+	// stored in vertex and index buffers shared with other meshes (see CMeshArena), so the sub-mesh's
+	// data starts at a base vertex and start index in those buffers
 	struct SSubMeshDX
 	{
 		TUInt32                  node;     // Node controlling this sub-mesh 
 		TUInt32                  material; // Index of material used by this sub-mesh
 
-		// Vertex data for the sub-mesh stored in a vertex buffer and the number of vertices in the buffer
-		ID3D10Buffer*            vertexBuffer;
+		// Vertex data for the sub-mesh allocated in an arena vertex buffer, the index of the sub-mesh's
+		// first vertex in that buffer and the number of vertices
+		SArenaAllocation         vertexAllocation;
+		TInt32                   baseVertex;
 		TUInt32                  numVertices;
 
-		// Description of the elements in a single vertex (position, normal, UVs etc.)
-		static const int         MAX_VERTEX_ELTS = 64;
-		D3D10_INPUT_ELEMENT_DESC vertexElts[MAX_VERTEX_ELTS];
-		ID3D10InputLayout*       vertexLayout; // Layout of a vertex (derived from above array)
+		// Format of a single vertex (position, normal, UVs etc.) in the global vertex format registry, and the
+		// layouts for it shared with other sub-meshes of the same format and render method
+		TVertexFormat            vertexFormat;
+		TRenderHandle            vertexLayout;    // Layout of a vertex for the render method's technique
+		TRenderHandle            instancedLayout; // Layout of a vertex plus per-instance world matrix, for instanced techniques (0 if none)
 		unsigned int             vertexSize;   // Size of vertex calculated from contained elements
 
-		// Index data for the sub-mesh stored in a index buffer and the number of indices in the buffer
-		ID3D10Buffer*            indexBuffer;
+		// Index data for the sub-mesh allocated in an arena index buffer, the position of the first index
+		// and the number of indices. Indices are relative to the base vertex
+		SArenaAllocation         indexAllocation;
+		TUInt32                  startIndex;
 		TUInt32                  numIndices;
 	};
 
 
-	// DirectX form of a material - stores texture pointers instead of filenames
+	// DirectX form of a material - stores texture handles instead of filenames
 	struct SMeshMaterialDX
 	{
 		ERenderMethod renderMethod;
 
-		D3DXCOLOR     diffuseColour;
-		D3DXCOLOR     specularColour;
+		SColourRGBA   diffuseColour;
+		SColourRGBA   specularColour;
 		TFloat32      specularPower;
 
 		TUInt32       numTextures;
-		ID3D10ShaderResourceView* textures[kiMaxTextures];
+		TRenderHandle textures[kiMaxTextures];
 	};
 
 
@@ -170,6 +219,14 @@ private:
 	// Release all nodes, sub-meshes and materials along with any DirectX data
 	void ReleaseResources();
 
+	// Whether the mesh, placed with the given matrix list, is in the camera frustum
+	bool InFrustum( CMatrix4x4* matrices, CCamera* camera );
+
+	// Sort depth of the mesh placed with the given matrix list, and the draw packet for one of its
+	// sub-meshes added to a queue with a given depth
+	TFloat32 QueueDepth( CMatrix4x4* matrices, CCamera* camera );
+	void AddPacket( CDrawQueue* queue, TUInt32 subMesh, CMatrix4x4* matrices, TUInt32 pass, TFloat32 depth );
+
 	// Creates a DirectX specific material from an imported material
 	bool CreateMaterialDX
 	(
@@ -0,0 +1,213 @@
+/*******************************************
+	MeshArena.cpp
+
+	Shared vertex and index buffers that all
+	loaded mesh geometry is allocated from
+********************************************/
+
+#include "MeshArena.h"
+
+namespace gen
+{
+
+// Allocate from buffers of the given sizes (in bytes) on the given device
+CMeshArena::CMeshArena( IRenderDevice* device /*= 0*/, TUInt32 vertexBufferSize /*= 4 * 1024 * 1024*/,
+                        TUInt32 indexBufferSize /*= 1024 * 1024*/ )
+{
+	m_Device = device;
+	m_VertexBufferSize = vertexBufferSize;
+	m_IndexBufferSize = indexBufferSize;
+}
+
+
+//-----------------------------------------------------------------------------
+// Allocation
+//-----------------------------------------------------------------------------
+
+// Copy vertices into the arena, in the pool for their size
+bool CMeshArena::AllocateVertices( const void* vertices, TUInt32 numVertices, TUInt32 vertexSize,
+                                   SArenaAllocation& allocation )
+{
+	return Allocate( vertexSize, vertices, numVertices * vertexSize, allocation );
+}
+
+// Copy 16-bit indices into the arena
+bool CMeshArena::AllocateIndices( const TUInt16* indices, TUInt32 numIndices, SArenaAllocation& allocation )
+{
+	return Allocate( 0, indices, numIndices * sizeof(TUInt16), allocation );
+}
+
+// Find space for the given number of bytes in a pool, creating a buffer if none has room, and
+// copy the data there. Every allocation in a pool is a whole number of vertices (or indices), so
+// the offsets of all allocations and gaps stay multiples of the vertex size
+bool CMeshArena::Allocate( TUInt32 poolSize, const void* data, TUInt32 size, SArenaAllocation& allocation )
+{
+	allocation.Pool = poolSize;
+	allocation.Buffer = kNoRenderHandle;
+	allocation.Offset = 0;
+	allocation.Size = size;
+	if (size == 0) return true;
+
+	// First gap that fits, in any buffer of the pool
+	SArenaPool& pool = Pool( poolSize );
+	SArenaBuffer* buffer = 0;
+	TUInt32 range = 0;
+	for (TUInt32 b = 0; b < pool.Buffers.size() && !buffer; ++b)
+	{
+		vector<SFreeRange>& freeRanges = pool.Buffers[b].FreeRanges;
+		for (range = 0; range < freeRanges.size(); ++range)
+		{
+			if (freeRanges[range].Size >= size)
+			{
+				buffer = &pool.Buffers[b];
+				break;
+			}
+		}
+	}
+
+	// Otherwise a new buffer, of the usual size (rounded down to whole vertices) or bigger if needed
+	if (!buffer)
+	{
+		SArenaBuffer newBuffer;
+		if (poolSize == 0)
+		{
+			newBuffer.Size = m_IndexBufferSize - m_IndexBufferSize % sizeof(TUInt16);
+			if (newBuffer.Size < size) newBuffer.Size = size;
+			newBuffer.Buffer = m_Device->CreateIndexBuffer( 0, newBuffer.Size / sizeof(TUInt16) );
+		}
+		else
+		{
+			newBuffer.Size = m_VertexBufferSize - m_VertexBufferSize % poolSize;
+			if (newBuffer.Size < size) newBuffer.Size = size;
+			newBuffer.Buffer = m_Device->CreateVertexBuffer( 0, newBuffer.Size );
+		}
+		if (!newBuffer.Buffer) return false;
+
+		newBuffer.Allocations = 0;
+		SFreeRange all = { 0, newBuffer.Size };
+		newBuffer.FreeRanges.push_back( all );
+		pool.Buffers.push_back( newBuffer );
+		buffer = &pool.Buffers.back();
+		range = 0;
+	}
+
+	// Take the start of the gap
+	SFreeRange& freeRange = buffer->FreeRanges[range];
+	allocation.Buffer = buffer->Buffer;
+	allocation.Offset = freeRange.Offset;
+	freeRange.Offset += size;
+	freeRange.Size -= size;
+	if (freeRange.Size == 0) buffer->FreeRanges.erase( buffer->FreeRanges.begin() + range );
+	++buffer->Allocations;
+
+	m_Device->WriteBuffer( allocation.Buffer, allocation.Offset, data, size );
+	return true;
+}
+
+
+// Return an allocation's space to its buffer, releasing the buffer if nothing is left in it
+void CMeshArena::Free( SArenaAllocation& allocation )
+{
+	if (allocation.Buffer == kNoRenderHandle) return;
+
+	SArenaPool& pool = Pool( allocation.Pool );
+	for (TUInt32 b = 0; b < pool.Buffers.size(); ++b)
+	{
+		SArenaBuffer& buffer = pool.Buffers[b];
+		if (buffer.Buffer != allocation.Buffer) continue;
+
+		// Release the buffer if this was its last allocation
+		if (--buffer.Allocations == 0)
+		{
+			ReleaseBuffer( pool, b );
+			break;
+		}
+
+		// Otherwise insert the range in order and merge it with the gaps either side
+		vector<SFreeRange>& freeRanges = buffer.FreeRanges;
+		TUInt32 range = 0;
+		while (range < freeRanges.size() && freeRanges[range].Offset < allocation.Offset) ++range;
+		SFreeRange freed = { allocation.Offset, allocation.Size };
+		freeRanges.insert( freeRanges.begin() + range, freed );
+		if (range + 1 < freeRanges.size() && freeRanges[range].Offset + freeRanges[range].Size == freeRanges[range + 1].Offset)
+		{
+			freeRanges[range].Size += freeRanges[range + 1].Size;
+			freeRanges.erase( freeRanges.begin() + range + 1 );
+		}
+		if (range > 0 && freeRanges[range - 1].Offset + freeRanges[range - 1].Size == freeRanges[range].Offset)
+		{
+			freeRanges[range - 1].Size += freeRanges[range].Size;
+			freeRanges.erase( freeRanges.begin() + range );
+		}
+		break;
+	}
+
+	allocation.Buffer = kNoRenderHandle;
+	allocation.Offset = 0;
+	allocation.Size = 0;
+}
+
+// Release all the buffers
+void CMeshArena::Release()
+{
+	for (TUInt32 p = 0; p < m_Pools.size(); ++p)
+	{
+		while (!m_Pools[p].Buffers.empty())
+		{
+			ReleaseBuffer( m_Pools[p], static_cast<TUInt32>(m_Pools[p].Buffers.size() - 1) );
+		}
+	}
+	m_Pools.clear();
+}
+
+
+// Current use of the buffers
+SMeshArenaStats CMeshArena::Stats() const
+{
+	SMeshArenaStats stats = { static_cast<TUInt32>(m_Pools.size()), 0, 0, 0, 0, 0 };
+	for (TUInt32 p = 0; p < m_Pools.size(); ++p)
+	{
+		const vector<SArenaBuffer>& buffers = m_Pools[p].Buffers;
+		for (TUInt32 b = 0; b < buffers.size(); ++b)
+		{
+			++stats.Buffers;
+			stats.Allocations += buffers[b].Allocations;
+			stats.FreeRanges += static_cast<TUInt32>(buffers[b].FreeRanges.size());
+			stats.BytesReserved += buffers[b].Size;
+			stats.BytesUsed += buffers[b].Size;
+			for (TUInt32 range = 0; range < buffers[b].FreeRanges.size(); ++range)
+			{
+				stats.BytesUsed -= buffers[b].FreeRanges[range].Size;
+			}
+		}
+	}
+	return stats;
+}
+
+
+//-----------------------------------------------------------------------------
+// Pools
+//-----------------------------------------------------------------------------
+
+// The pool for a vertex size (0 for indices), added if there is none
+CMeshArena::SArenaPool& CMeshArena::Pool( TUInt32 vertexSize )
+{
+	for (TUInt32 p = 0; p < m_Pools.size(); ++p)
+	{
+		if (m_Pools[p].VertexSize == vertexSize) return m_Pools[p];
+	}
+	SArenaPool pool;
+	pool.VertexSize = vertexSize;
+	m_Pools.push_back( pool );
+	return m_Pools.back();
+}
+
+// Release a buffer of a pool
+void CMeshArena::ReleaseBuffer( SArenaPool& pool, TUInt32 buffer )
+{
+	m_Device->Release( pool.Buffers[buffer].Buffer );
+	pool.Buffers.erase( pool.Buffers.begin() + buffer );
+}
+
+
+} // namespace gen
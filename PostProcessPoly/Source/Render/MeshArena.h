@@ -0,0 +1,144 @@
+/*******************************************
+	MeshArena.h
+
+	Shared vertex and index buffers that all
+	loaded mesh geometry is allocated from
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "RenderDevice.h"
+
+namespace gen
+{
+
+// Part of an arena buffer given to a sub-mesh. Offset and size are in bytes - the first vertex
+// or index of the allocation is Offset divided by the vertex size or index size
+struct SArenaAllocation
+{
+	TUInt32       Pool;   // Vertex size of the pool, or 0 for the index pool
+	TRenderHandle Buffer; // Arena buffer holding the data, kNoRenderHandle if not allocated
+	TUInt32       Offset;
+	TUInt32       Size;
+};
+
+// Use of the arena's buffers
+struct SMeshArenaStats
+{
+	TUInt32 Pools;         // Distinct vertex sizes, plus one for indices
+	TUInt32 Buffers;       // Device buffers held
+	TUInt32 Allocations;   // Live allocations
+	TUInt32 FreeRanges;    // Gaps between allocations, after merging neighbouring gaps
+	size_t  BytesReserved; // Total size of the buffers
+	size_t  BytesUsed;     // Total size of the live allocations
+};
+
+
+// Allocator for static mesh geometry. Rather than a vertex and index buffer for every sub-mesh,
+// vertices are sub-allocated from a few large vertex buffers grouped by vertex size (a pool for
+// each size), and indices from large index buffers. Sub-meshes of a pool then share their
+// buffers, and draw using a base vertex and start index, so the scene binds a new buffer only
+// where the vertex size changes.
+//
+// Each buffer keeps a list of free byte ranges, sorted by offset. Allocation takes the first
+// range that fits; freeing returns the range and merges it with free neighbours, and a buffer
+// that becomes entirely free is released. Allocations larger than the usual buffer size get a
+// buffer to themselves. Live data is never moved, so allocations stay valid until freed.
+//
+// The arena uses the render device it is given, so can be run on a CNullRenderDevice or
+// CRecordingRenderDevice with no graphics API
+class CMeshArena
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Allocate from buffers of the given sizes (in bytes) on the given device, which may be set
+	// later with SetDevice
+	CMeshArena( IRenderDevice* device = 0, TUInt32 vertexBufferSize = 4 * 1024 * 1024,
+	            TUInt32 indexBufferSize = 1024 * 1024 );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CMeshArena( const CMeshArena& );
+	CMeshArena& operator=( const CMeshArena& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Set the device to create buffers on. Only while the arena holds no buffers
+	void SetDevice( IRenderDevice* device )
+	{
+		m_Device = device;
+	}
+
+	// Copy vertices into the arena, in the pool for their size. Returns false if a buffer could
+	// not be created
+	bool AllocateVertices( const void* vertices, TUInt32 numVertices, TUInt32 vertexSize, SArenaAllocation& allocation );
+
+	// Copy 16-bit indices into the arena. Returns false if a buffer could not be created
+	bool AllocateIndices( const TUInt16* indices, TUInt32 numIndices, SArenaAllocation& allocation );
+
+	// Return an allocation's space to its buffer, releasing the buffer if nothing is left in it.
+	// The allocation is cleared; freeing a cleared allocation does nothing
+	void Free( SArenaAllocation& allocation );
+
+	// Release all the buffers, e.g. on shutdown. Any allocations still held become invalid
+	void Release();
+
+	// Current use of the buffers
+	SMeshArenaStats Stats() const;
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// A gap in a buffer
+	struct SFreeRange
+	{
+		TUInt32 Offset;
+		TUInt32 Size;
+	};
+
+	// A device buffer and its gaps, sorted by offset
+	struct SArenaBuffer
+	{
+		TRenderHandle      Buffer;
+		TUInt32            Size;
+		TUInt32            Allocations;
+		vector<SFreeRange> FreeRanges;
+	};
+
+	// Buffers holding vertices of one size, or indices (size 0)
+	struct SArenaPool
+	{
+		TUInt32              VertexSize;
+		vector<SArenaBuffer> Buffers;
+	};
+
+	// Find space for the given number of bytes in a pool, creating a buffer if none has room,
+	// and copy the data there
+	bool Allocate( TUInt32 pool, const void* data, TUInt32 size, SArenaAllocation& allocation );
+
+	// The pool for a vertex size (0 for indices), added if there is none
+	SArenaPool& Pool( TUInt32 vertexSize );
+
+	// Release a buffer of a pool
+	void ReleaseBuffer( SArenaPool& pool, TUInt32 buffer );
+
+	IRenderDevice*     m_Device;
+	TUInt32            m_VertexBufferSize;
+	TUInt32            m_IndexBufferSize;
+	vector<SArenaPool> m_Pools;
+};
+
+
+} // namespace gen
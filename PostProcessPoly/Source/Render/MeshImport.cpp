@@ -0,0 +1,47 @@
+/*******************************************
+	MeshImport.cpp
+
+	Interface to the mesh file importers
+********************************************/
+
+#include "MeshImport.h"
+
+namespace gen
+{
+
+// Set the render method and texture file names of a material from the name of the material in
+// the file and its main texture
+void SetMaterialTextures
+(
+	SMeshMaterial* material,
+	const string&  materialName,
+	const string&  textureName
+)
+{
+	// Select render method and number of textures from material and texture name
+	material->renderMethod = RenderMethodFromMaterial( materialName, textureName );
+	material->numTextures = NumTexturesUsedByRenderMethod( material->renderMethod );
+
+	// Secondary textures have the main texture's name with their index added
+	if (material->numTextures > 0)
+	{
+		material->textureFileNames[0] = textureName;
+		for (TUInt32 iExtraTex = 1; iExtraTex < material->numTextures; ++iExtraTex)
+		{
+			string::size_type lastDot = textureName.find_last_of( "." );
+			if (lastDot == string::npos)
+			{
+				material->textureFileNames[iExtraTex] = textureName + char('0' + iExtraTex);
+			}
+			else
+			{
+				string filename = textureName.substr( 0, lastDot );
+				string extension = textureName.substr( lastDot );
+				material->textureFileNames[iExtraTex] = filename + char('0' + iExtraTex) + extension;
+			}
+		}
+	}
+}
+
+
+} // namespace gen
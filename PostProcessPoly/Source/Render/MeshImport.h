@@ -0,0 +1,92 @@
+/*******************************************
+	MeshImport.h
+
+	Interface to the mesh file importers
+********************************************/
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+#include "MeshData.h"
+
+namespace gen
+{
+
+// List of errors returned from import functions
+enum EImportError
+{
+	kSuccess           = 0,
+	kSystemFailure     = 1,
+	kOutOfSystemMemory = 2,
+	kFileError         = 3,
+	kInvalidData       = 4,
+};
+
+
+// Import of a mesh file into the nodes, sub-meshes and materials used by CMesh. Importers are
+// made by the render device (IRenderDevice::CreateMeshImport), as reading the file may need the
+// graphics API's own libraries - the X-file importer uses D3DX
+class IMeshImport
+{
+public:
+	// Destructor - base class destructors should always be virtual
+	virtual ~IMeshImport() {}
+
+
+	/////////////////////////////////////
+	// File import
+
+	// Whether the given file is one this importer reads
+	virtual bool IsMeshFile( const string& fileName ) const = 0;
+
+	// Import a mesh file
+	// Possible return values:
+	//		kSuccess:			...
+	//		kFileError:			Missing file or not a file this importer reads
+	//		kInvalidData:		The file could not be parsed correctly, or contains invalid data
+	//		kOutOfSystemMemory:	...
+	//		kSystemFailure:		File API failure
+	virtual EImportError ImportFile( const string& fileName ) = 0;
+
+
+	/////////////////////////////////////
+	// Data access
+
+	// Get number of nodes in the mesh hierarchy, and a single node returned through a pointer
+	virtual TUInt32 GetNumNodes() const = 0;
+	virtual void GetNode( const TUInt32 iNode, SMeshNode* const pNode ) const = 0;
+
+	// Get number of sub-meshes in the mesh hierarchy, and the render method used for one
+	virtual TUInt32 GetNumSubMeshes() const = 0;
+	virtual ERenderMethod GetSubMeshRenderMethod( const TUInt32 iSubMesh ) const = 0;
+
+	// Get the specification and data for given sub-mesh, returned through a pointer. The vertex
+	// and face arrays are allocated with new[]. May request tangents to be calculated
+	// Possible return values:
+	//		kSuccess:			...
+	//		kOutOfSystemMemory:	...
+	virtual EImportError GetSubMesh( const TUInt32 iSubMesh, SSubMesh* pSubMesh, bool bTangents = false ) const = 0;
+
+	// Get the number of materials used in the mesh (across all sub-meshes), and the specification
+	// of one returned through a pointer
+	virtual TUInt32 GetNumMaterials() const = 0;
+	virtual void GetMaterial( const TUInt32 iMaterial, SMeshMaterial* const pMaterial ) const = 0;
+};
+
+
+// Set the render method and texture file names of a material from the name of the material in
+// the file and its main texture. If a render method uses multiple textures, secondary texture
+// names are based on the main texture name. E.g. if a normal mapping method uses 3 textures and
+// the main texture is "wall.jpg" then the other textures must be named "wall1.jpg" and "wall2.jpg"
+void SetMaterialTextures
+(
+	SMeshMaterial* material,
+	const string&  materialName,
+	const string&  textureName
+);
+
+
+} // namespace gen
@@ -0,0 +1,331 @@
+/*******************************************
+	NullRenderDevice.cpp
+
+	Render device that does nothing, for
+	measuring the CPU cost of a frame
+********************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "NullRenderDevice.h"
+
+namespace gen
+{
+
+CNullRenderDevice::CNullRenderDevice()
+{
+	m_NextHandle = 2;
+}
+
+
+TRenderHandle CNullRenderDevice::BackBuffer()
+{
+	return 1;
+}
+
+TRenderHandle CNullRenderDevice::CreateVertexBuffer( const void* data, TUInt32 size )
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::CreateDynamicVertexBuffer( TUInt32 size )
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices )
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::CreateRenderTexture( TUInt32 width, TUInt32 height )
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::LoadTexture( const string& fileName )
+{
+	return m_NextHandle++;
+}
+
+IMeshImport* CNullRenderDevice::CreateMeshImport()
+{
+	return new CNullMeshImport;
+}
+
+TRenderHandle CNullRenderDevice::CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique )
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::CreateOcclusionPredicate()
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::LoadEffect( const string& fileName, string& errors )
+{
+	return m_NextHandle++;
+}
+
+TRenderHandle CNullRenderDevice::GetTechnique( TRenderHandle effect, const string& name )
+{
+	return NamedHandle( effect, name );
+}
+
+TRenderHandle CNullRenderDevice::GetVariable( TRenderHandle effect, const string& name )
+{
+	return NamedHandle( effect, name );
+}
+
+TUInt32 CNullRenderDevice::NumPasses( TRenderHandle technique )
+{
+	return 1;
+}
+
+
+// Handle of a technique or variable, made the first time it is asked for. Techniques and
+// variables share the table as nothing here tells them apart
+TRenderHandle CNullRenderDevice::NamedHandle( TRenderHandle effect, const string& name )
+{
+	TRenderHandle& handle = m_NamedHandles[make_pair( effect, name )];
+	if (handle == kNoRenderHandle) handle = m_NextHandle++;
+	return handle;
+}
+
+
+
+//-----------------------------------------------------------------------------
+// Mesh import
+//-----------------------------------------------------------------------------
+
+// Split a text X-file into words, numbers, quoted strings and braces. Separators (semicolons
+// and commas), comments and the header are dropped. Returns false if the file can't be read
+bool ReadXFileTokens( const string& fileName, vector<string>& tokens )
+{
+	FILE* file = fopen( fileName.c_str(), "rb" );
+	if (!file) return false;
+	string text;
+	char block[16384];
+	size_t read;
+	while ((read = fread( block, 1, sizeof(block), file )) > 0)
+	{
+		text.append( block, read );
+	}
+	bool readAll = !ferror( file );
+	fclose( file );
+	if (!readAll || text.size() < 16) return false;
+
+	string::size_type pos = 16; // Skip header, e.g. "xof 0303txt 0032"
+	while (pos < text.size())
+	{
+		char c = text[pos];
+		if (c == '/' || c == '#') // Comment to end of line (X-files use // or #)
+		{
+			pos = text.find( '\n', pos );
+		}
+		else if (c == '{' || c == '}')
+		{
+			tokens.push_back( string( 1, c ) );
+			++pos;
+		}
+		else if (c == '"')
+		{
+			string::size_type end = text.find( '"', pos + 1 );
+			if (end == string::npos) return false;
+			tokens.push_back( text.substr( pos + 1, end - pos - 1 ) );
+			pos = end + 1;
+		}
+		else if (strchr( " \t\r\n;,", c ))
+		{
+			++pos;
+		}
+		else
+		{
+			string::size_type end = text.find_first_of( " \t\r\n;,{}\"", pos );
+			tokens.push_back( text.substr( pos, end - pos ) );
+			pos = end;
+		}
+	}
+	return true;
+}
+
+
+// Only text X-files can be read, as there is no parser here for binary or compressed ones
+bool CNullMeshImport::IsMeshFile( const string& fileName ) const
+{
+	FILE* file = fopen( fileName.c_str(), "rb" );
+	if (!file) return false;
+	char header[12] = { 0 };
+	bool textXFile = (fread( header, 1, sizeof(header), file ) == sizeof(header) &&
+	                  memcmp( header, "xof ", 4 ) == 0 && memcmp( header + 8, "txt ", 4 ) == 0);
+	fclose( file );
+	return textXFile;
+}
+
+// Find the materials used by the meshes of the file: those in a mesh's material list, whether
+// given there or referred to by the name of one given earlier
+EImportError CNullMeshImport::ImportFile( const string& fileName )
+{
+	m_Materials.clear();
+	vector<string> tokens;
+	if (!IsMeshFile( fileName ) || !ReadXFileTokens( fileName, tokens )) return kFileError;
+
+	map<string, SMeshMaterial> namedMaterials;
+	TUInt32 depth = 0;
+	TUInt32 listDepth = 0; // Depth of the material list being read, 0 if none
+	for (TUInt32 token = 0; token < tokens.size(); ++token)
+	{
+		if (tokens[token] == "Material")
+		{
+			string name;
+			SMeshMaterial material;
+			token = ReadMaterial( tokens, token, name, material );
+			if (token >= tokens.size()) return kInvalidData;
+			namedMaterials[name] = material;
+			if (listDepth > 0 && depth == listDepth) m_Materials.push_back( material );
+		}
+		else if (tokens[token] == "MeshMaterialList")
+		{
+			while (token < tokens.size() && tokens[token] != "{") ++token;
+			listDepth = ++depth;
+		}
+		else if (tokens[token] == "{")
+		{
+			// A reference to an earlier material is its name in braces
+			if (listDepth > 0 && depth == listDepth && token + 2 < tokens.size() && tokens[token + 2] == "}")
+			{
+				map<string, SMeshMaterial>::const_iterator named = namedMaterials.find( tokens[token + 1] );
+				if (named == namedMaterials.end()) return kInvalidData;
+				m_Materials.push_back( named->second );
+				token += 2;
+			}
+			else
+			{
+				++depth;
+			}
+		}
+		else if (tokens[token] == "}")
+		{
+			if (depth == 0) return kInvalidData;
+			if (depth == listDepth) listDepth = 0;
+			--depth;
+		}
+	}
+
+	// A file with no material lists still draws
+	if (m_Materials.empty())
+	{
+		SMeshMaterial material;
+		material.diffuseColour = SColourRGBA( 1.0f, 1.0f, 1.0f, 1.0f );
+		material.specularColour = SColourRGBA( 0.0f, 0.0f, 0.0f, 1.0f );
+		material.specularPower = 1.0f;
+		SetMaterialTextures( &material, "", "" );
+		m_Materials.push_back( material );
+	}
+	return kSuccess;
+}
+
+// Read the material starting at the given token (the word Material), returning the index of its
+// closing brace, or the number of tokens if it is cut short
+TUInt32 CNullMeshImport::ReadMaterial( const vector<string>& tokens, TUInt32 token, string& name, SMeshMaterial& material )
+{
+	// Face colour (RGBA), specular power, specular colour and emissive colour (RGB), then any
+	// texture file name
+	const TUInt32 kNumValues = 11;
+	if (++token < tokens.size() && tokens[token] != "{") name = tokens[token++];
+	if (token + kNumValues >= tokens.size() || tokens[token] != "{") return static_cast<TUInt32>(tokens.size());
+	TFloat32 values[kNumValues];
+	for (TUInt32 value = 0; value < kNumValues; ++value)
+	{
+		values[value] = static_cast<TFloat32>(atof( tokens[++token].c_str() ));
+	}
+	string textureName;
+	if (token + 3 < tokens.size() && tokens[token + 1] == "TextureFilename" && tokens[token + 2] == "{")
+	{
+		textureName = tokens[token + 3];
+	}
+
+	material.diffuseColour = SColourRGBA( values[0], values[1], values[2], values[3] );
+	material.specularPower = values[4];
+	material.specularColour = SColourRGBA( values[5], values[6], values[7], 1.0f );
+	SetMaterialTextures( &material, name, textureName );
+
+	// Skip to the closing brace
+	TUInt32 depth = 1;
+	while (++token < tokens.size())
+	{
+		if (tokens[token] == "{") ++depth;
+		else if (tokens[token] == "}" && --depth == 0) break;
+	}
+	return token;
+}
+
+
+// A single node at the origin controls every sub-mesh
+void CNullMeshImport::GetNode( const TUInt32 iNode, SMeshNode* const pNode ) const
+{
+	pNode->name = "Root";
+	pNode->depth = 0;
+	pNode->parent = 0;
+	pNode->numChildren = 0;
+	pNode->positionMatrix = CMatrix4x4::kIdentity;
+	pNode->invMeshOffset = CMatrix4x4::kIdentity;
+}
+
+// Each sub-mesh is a cube from -1 to 1 with four vertices on each face, with normals, texture
+// coordinates and, if asked for, tangents
+EImportError CNullMeshImport::GetSubMesh( const TUInt32 iSubMesh, SSubMesh* pSubMesh, bool bTangents /*= false*/ ) const
+{
+	pSubMesh->node = 0;
+	pSubMesh->material = iSubMesh;
+	pSubMesh->hasSkinningData = false;
+	pSubMesh->hasNormals = true;
+	pSubMesh->hasTangents = bTangents;
+	pSubMesh->hasTextureCoords = true;
+	pSubMesh->hasVertexColours = false;
+	pSubMesh->vertexSize = (bTangents ? 11 : 8) * sizeof(TFloat32);
+	pSubMesh->numVertices = 24;
+	pSubMesh->numFaces = 12;
+	pSubMesh->vertices = new TUInt8[pSubMesh->numVertices * pSubMesh->vertexSize];
+	pSubMesh->faces = new SMeshFace[pSubMesh->numFaces];
+
+	TFloat32* vertex = reinterpret_cast<TFloat32*>(pSubMesh->vertices);
+	for (TUInt32 face = 0; face < 6; ++face)
+	{
+		// Normal along axis face / 2, facing the sign given by face % 2. The face's u and v run
+		// along the other two axes
+		TUInt32 axis = face / 2;
+		TFloat32 side = (face % 2) ? -1.0f : 1.0f;
+		CVector3 normal( 0.0f, 0.0f, 0.0f ), tangent( 0.0f, 0.0f, 0.0f ), bitangent( 0.0f, 0.0f, 0.0f );
+		normal[axis] = side;
+		tangent[(axis + 1) % 3] = side;
+		bitangent[(axis + 2) % 3] = 1.0f;
+		for (TUInt32 corner = 0; corner < 4; ++corner)
+		{
+			TFloat32 u = (corner & 1) ? 1.0f : 0.0f;
+			TFloat32 v = (corner & 2) ? 1.0f : 0.0f;
+			CVector3 position = normal + tangent * (u * 2.0f - 1.0f) + bitangent * (1.0f - v * 2.0f);
+			*vertex++ = position.x;  *vertex++ = position.y;  *vertex++ = position.z;
+			*vertex++ = normal.x;    *vertex++ = normal.y;    *vertex++ = normal.z;
+			if (bTangents)
+			{
+				*vertex++ = tangent.x;  *vertex++ = tangent.y;  *vertex++ = tangent.z;
+			}
+			*vertex++ = u;
+			*vertex++ = v;
+		}
+
+		// Two triangles for the face
+		TUInt16 first = static_cast<TUInt16>(face * 4);
+		SMeshFace* triangles = &pSubMesh->faces[face * 2];
+		triangles[0].aiVertex[0] = first;      triangles[0].aiVertex[1] = first + 2;  triangles[0].aiVertex[2] = first + 1;
+		triangles[1].aiVertex[0] = first + 1;  triangles[1].aiVertex[1] = first + 2;  triangles[1].aiVertex[2] = first + 3;
+	}
+	return kSuccess;
+}
+
+
+} // namespace gen
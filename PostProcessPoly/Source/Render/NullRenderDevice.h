@@ -0,0 +1,153 @@
+/*******************************************
+	NullRenderDevice.h
+
+	Render device that does nothing, for
+	measuring the CPU cost of a frame
+********************************************/
+
+#pragma once
+
+#include <map>
+#include <vector>
+using namespace std;
+
+#include "RenderDevice.h"
+#include "MeshImport.h"
+
+namespace gen
+{
+
+// A render device with no graphics API behind it. Every call returns at once, creation calls
+// hand out new handles and techniques have one pass, so a frame rendered with it costs only the
+// frame code's own CPU time - the overhead to measure when reducing work per draw. Techniques and
+// variables have one handle per effect and name, as they do on a real device, however often they
+// are asked for. Meshes are imported with CNullMeshImport. Needs no window, GPU or D3DX
+class CNullRenderDevice : public IRenderDevice
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CNullRenderDevice();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CNullRenderDevice( const CNullRenderDevice& );
+	CNullRenderDevice& operator=( const CNullRenderDevice& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface - see IRenderDevice
+-----------------------------------------------------------------------------------------*/
+public:
+	TRenderHandle BackBuffer();
+	void Present() {}
+
+	TRenderHandle CreateVertexBuffer( const void* data, TUInt32 size );
+	TRenderHandle CreateDynamicVertexBuffer( TUInt32 size );
+	void UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size ) {}
+	TRenderHandle CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices );
+	void WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size ) {}
+	TRenderHandle CreateRenderTexture( TUInt32 width, TUInt32 height );
+	TRenderHandle LoadTexture( const string& fileName );
+	IMeshImport* CreateMeshImport();
+	TRenderHandle CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique );
+	TRenderHandle CreateOcclusionPredicate();
+	void Release( TRenderHandle resource ) {}
+
+	TRenderHandle LoadEffect( const string& fileName, string& errors );
+	TRenderHandle GetTechnique( TRenderHandle effect, const string& name );
+	TRenderHandle GetVariable( TRenderHandle effect, const string& name );
+	TUInt32 NumPasses( TRenderHandle technique );
+	void SetFloat( TRenderHandle variable, TFloat32 value ) {}
+	void SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count ) {}
+	void SetMatrix( TRenderHandle variable, const TFloat32* matrix ) {}
+	void SetTexture( TRenderHandle variable, TRenderHandle texture ) {}
+	void ApplyPass( TRenderHandle technique, TUInt32 pass ) {}
+
+	void SetViewport( TUInt32 width, TUInt32 height ) {}
+	void SetRenderTarget( TRenderHandle target ) {}
+	void ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] ) {}
+	void ClearDepth( TFloat32 depth ) {}
+	void CopyTexture( TRenderHandle dest, TRenderHandle source ) {}
+
+	void SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize ) {}
+	void SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize ) {}
+	void SetIndexBuffer( TRenderHandle buffer ) {}
+	void SetInputLayout( TRenderHandle layout ) {}
+	void SetPrimitiveTopology( EPrimitiveTopology topology ) {}
+	void Draw( TUInt32 numVertices, TUInt32 firstVertex ) {}
+	void DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex ) {}
+	void DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex, TInt32 baseVertex,
+	                           TUInt32 firstInstance ) {}
+	void BeginOcclusionTest( TRenderHandle predicate ) {}
+	void EndOcclusionTest( TRenderHandle predicate ) {}
+	void SetPredication( TRenderHandle predicate ) {}
+
+	void DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre ) {}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// Handle of a technique or variable, made the first time it is asked for
+	TRenderHandle NamedHandle( TRenderHandle effect, const string& name );
+
+	// Next handle to hand out, handle 1 is the back buffer
+	TRenderHandle m_NextHandle;
+
+	// Techniques and variables handed out, by effect and name
+	map<pair<TRenderHandle, string>, TRenderHandle> m_NamedHandles;
+};
+
+
+
+// Mesh import for the null device, which has no X-file parser. It reads only the materials of a
+// text X-file and gives each material used by the file's meshes a cube two units across as its
+// sub-mesh. So a level loads with its real render methods and textures, post-processed materials
+// included, and a draw for each material, but none of its geometry
+class CNullMeshImport : public IMeshImport
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CNullMeshImport() {}
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CNullMeshImport( const CNullMeshImport& );
+	CNullMeshImport& operator=( const CNullMeshImport& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface - see IMeshImport
+-----------------------------------------------------------------------------------------*/
+public:
+	bool IsMeshFile( const string& fileName ) const;
+	EImportError ImportFile( const string& fileName );
+
+	TUInt32 GetNumNodes() const { return 1; }
+	void GetNode( const TUInt32 iNode, SMeshNode* const pNode ) const;
+	TUInt32 GetNumSubMeshes() const { return static_cast<TUInt32>(m_Materials.size()); }
+	ERenderMethod GetSubMeshRenderMethod( const TUInt32 iSubMesh ) const { return m_Materials[iSubMesh].renderMethod; }
+	EImportError GetSubMesh( const TUInt32 iSubMesh, SSubMesh* pSubMesh, bool bTangents = false ) const;
+	TUInt32 GetNumMaterials() const { return static_cast<TUInt32>(m_Materials.size()); }
+	void GetMaterial( const TUInt32 iMaterial, SMeshMaterial* const pMaterial ) const { *pMaterial = m_Materials[iMaterial]; }
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// Read the material starting at the given token (the word Material), returning the index of
+	// its closing brace
+	static TUInt32 ReadMaterial( const vector<string>& tokens, TUInt32 token, string& name, SMeshMaterial& material );
+
+	// Materials of the sub-meshes, in the order the meshes use them
+	vector<SMeshMaterial> m_Materials;
+};
+
+
+} // namespace gen
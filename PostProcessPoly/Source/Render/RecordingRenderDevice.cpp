@@ -0,0 +1,513 @@
+/*******************************************
+	RecordingRenderDevice.cpp
+
+	Render device that records every call in
+	a compact command stream
+********************************************/
+
+#include <string.h>
+#include <stdio.h>
+
+#include "RecordingRenderDevice.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Commands
+//-----------------------------------------------------------------------------
+
+// Name of each command (the IRenderDevice function name)
+const char* const RenderCommandNames[kNumRenderCommands] =
+{
+	"Present", "CreateVertexBuffer", "CreateIndexBuffer", "CreateRenderTexture", "LoadTexture", "CreateInputLayout",
+	"CreateOcclusionPredicate", "Release", "LoadEffect", "GetTechnique", "GetVariable", "SetFloat", "SetVector", "SetMatrix",
+	"SetTexture", "ApplyPass", "SetViewport", "SetRenderTarget", "ClearRenderTarget", "ClearDepth", "CopyTexture",
+	"SetVertexBuffer", "SetIndexBuffer", "SetInputLayout", "SetPrimitiveTopology", "Draw", "DrawIndexed", "BeginOcclusionTest",
+	"EndOcclusionTest", "SetPredication", "DrawString", "CreateDynamicVertexBuffer", "UpdateVertexBuffer",
+	"SetInstanceBuffer", "DrawIndexedInstanced", "WriteBuffer",
+};
+
+// Type of each argument of each command for Describe: h handle, u unsigned, i signed, f float,
+// s string. A * means any further arguments are floats
+const char* const RenderCommandArgs[kNumRenderCommands] =
+{
+	"", "hu", "hu", "huu", "hs", "huh",
+	"h", "h", "hs", "hhs", "hhs", "hf", "h*", "h*",
+	"hh", "hu", "uu", "h", "hffff", "f", "hh",
+	"hu", "h", "h", "u", "uu", "uui", "h",
+	"h", "h", "siiffffu", "hu", "hu",
+	"hu", "uuuiu", "huu",
+};
+
+// Header word of a command: the command in the low byte, the number of arguments above
+const TUInt32 kCommandBits = 8;
+
+// Float argument of a recorded command
+TFloat32 RecordedFloat( TUInt32 arg )
+{
+	TFloat32 value;
+	memcpy( &value, &arg, sizeof(value) );
+	return value;
+}
+
+// Float as a command argument
+inline TUInt32 FloatArg( TFloat32 value )
+{
+	TUInt32 arg;
+	memcpy( &arg, &value, sizeof(arg) );
+	return arg;
+}
+
+
+//-----------------------------------------------------------------------------
+// Constructor
+//-----------------------------------------------------------------------------
+
+// Record calls, passing them on to the target device if one is given
+CRecordingRenderDevice::CRecordingRenderDevice( IRenderDevice* target /*= 0*/ )
+{
+	m_Target = target;
+	m_NextHandle = 2; // Handle 1 is the back buffer
+	Clear();
+	m_HandleNames[BackBuffer()] = "BackBuffer";
+}
+
+
+//-----------------------------------------------------------------------------
+// Recording
+//-----------------------------------------------------------------------------
+
+// Remove the commands recorded so far. Handle names are kept
+void CRecordingRenderDevice::Clear()
+{
+	m_Stream.clear();
+	m_Strings.clear();
+	memset( m_Counts, 0, sizeof(m_Counts) );
+}
+
+// Number of commands recorded
+TUInt32 CRecordingRenderDevice::NumCommands() const
+{
+	TUInt32 total = 0;
+	for (TUInt32 command = 0; command < kNumRenderCommands; ++command)
+	{
+		total += m_Counts[command];
+	}
+	return total;
+}
+
+// Read the command at a position in the stream and return the position of the next
+TUInt32 CRecordingRenderDevice::ReadCommand( TUInt32 position, SRecordedCommand& command ) const
+{
+	TUInt32 header = m_Stream[position];
+	command.Command = static_cast<ERenderCommand>(header & ((1 << kCommandBits) - 1));
+	command.NumArgs = header >> kCommandBits;
+	command.Args = command.NumArgs > 0 ? &m_Stream[position + 1] : 0;
+	return position + 1 + command.NumArgs;
+}
+
+// Name given to a handle when it was created, or its number if it has none
+string CRecordingRenderDevice::HandleName( TRenderHandle handle ) const
+{
+	map<TRenderHandle, string>::const_iterator name = m_HandleNames.find( handle );
+	if (name != m_HandleNames.end()) return name->second;
+
+	char number[16];
+	sprintf( number, "#%u", handle );
+	return number;
+}
+
+// A command as text, e.g. "SetFloat SpiralTimer 2.5"
+string CRecordingRenderDevice::Describe( const SRecordedCommand& command ) const
+{
+	string text = RenderCommandNames[command.Command];
+	const char* argType = RenderCommandArgs[command.Command];
+	for (TUInt32 arg = 0; arg < command.NumArgs; ++arg)
+	{
+		char type = *argType;
+		if (type != '*' && type != 0) ++argType;
+
+		char value[32];
+		switch (type)
+		{
+			case 'h': text += " " + HandleName( command.Args[arg] ); continue;
+			case 's': text += " \"" + m_Strings[command.Args[arg]] + "\""; continue;
+			case 'u': sprintf( value, " %u", command.Args[arg] ); break;
+			case 'i': sprintf( value, " %d", static_cast<TInt32>(command.Args[arg]) ); break;
+			default:  sprintf( value, " %g", RecordedFloat( command.Args[arg] ) ); break;
+		}
+		text += value;
+	}
+	return text;
+}
+
+
+// Append a command with the given number of arguments to the stream, returning where to write
+// the arguments
+TUInt32* CRecordingRenderDevice::Record( ERenderCommand command, TUInt32 numArgs )
+{
+	++m_Counts[command];
+	size_t position = m_Stream.size();
+	m_Stream.resize( position + 1 + numArgs );
+	m_Stream[position] = command | (numArgs << kCommandBits);
+	return &m_Stream[position + 1];
+}
+
+// Add a string for a string argument, returning its index
+TUInt32 CRecordingRenderDevice::AddString( const string& text )
+{
+	m_Strings.push_back( text );
+	return static_cast<TUInt32>(m_Strings.size() - 1);
+}
+
+// A handle from the target for a resource it created, or a new one without a target
+TRenderHandle CRecordingRenderDevice::NewHandle( TRenderHandle targetHandle, const string& name /*= ""*/ )
+{
+	TRenderHandle handle = m_Target ? targetHandle : m_NextHandle++;
+	if (handle != kNoRenderHandle && !name.empty())
+	{
+		m_HandleNames[handle] = name;
+	}
+	return handle;
+}
+
+
+//-----------------------------------------------------------------------------
+// Frame buffers
+//-----------------------------------------------------------------------------
+
+TRenderHandle CRecordingRenderDevice::BackBuffer()
+{
+	return m_Target ? m_Target->BackBuffer() : 1;
+}
+
+void CRecordingRenderDevice::Present()
+{
+	Record( kCommandPresent, 0 );
+	if (m_Target) m_Target->Present();
+}
+
+
+//-----------------------------------------------------------------------------
+// Resources
+//-----------------------------------------------------------------------------
+
+TRenderHandle CRecordingRenderDevice::CreateVertexBuffer( const void* data, TUInt32 size )
+{
+	TRenderHandle buffer = NewHandle( m_Target ? m_Target->CreateVertexBuffer( data, size ) : 0 );
+	TUInt32* args = Record( kCommandCreateVertexBuffer, 2 );
+	args[0] = buffer;
+	args[1] = size;
+	return buffer;
+}
+
+TRenderHandle CRecordingRenderDevice::CreateDynamicVertexBuffer( TUInt32 size )
+{
+	TRenderHandle buffer = NewHandle( m_Target ? m_Target->CreateDynamicVertexBuffer( size ) : 0 );
+	TUInt32* args = Record( kCommandCreateDynamicVertexBuffer, 2 );
+	args[0] = buffer;
+	args[1] = size;
+	return buffer;
+}
+
+void CRecordingRenderDevice::UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size )
+{
+	TUInt32* args = Record( kCommandUpdateVertexBuffer, 2 );
+	args[0] = buffer;
+	args[1] = size;
+	if (m_Target) m_Target->UpdateVertexBuffer( buffer, data, size );
+}
+
+TRenderHandle CRecordingRenderDevice::CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices )
+{
+	TRenderHandle buffer = NewHandle( m_Target ? m_Target->CreateIndexBuffer( indices, numIndices ) : 0 );
+	TUInt32* args = Record( kCommandCreateIndexBuffer, 2 );
+	args[0] = buffer;
+	args[1] = numIndices;
+	return buffer;
+}
+
+void CRecordingRenderDevice::WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size )
+{
+	TUInt32* args = Record( kCommandWriteBuffer, 3 );
+	args[0] = buffer;
+	args[1] = offset;
+	args[2] = size;
+	if (m_Target) m_Target->WriteBuffer( buffer, offset, data, size );
+}
+
+TRenderHandle CRecordingRenderDevice::CreateRenderTexture( TUInt32 width, TUInt32 height )
+{
+	TRenderHandle texture = NewHandle( m_Target ? m_Target->CreateRenderTexture( width, height ) : 0 );
+	TUInt32* args = Record( kCommandCreateRenderTexture, 3 );
+	args[0] = texture;
+	args[1] = width;
+	args[2] = height;
+	return texture;
+}
+
+TRenderHandle CRecordingRenderDevice::LoadTexture( const string& fileName )
+{
+	TRenderHandle texture = NewHandle( m_Target ? m_Target->LoadTexture( fileName ) : 0, fileName );
+	TUInt32* args = Record( kCommandLoadTexture, 2 );
+	args[0] = texture;
+	args[1] = AddString( fileName );
+	return texture;
+}
+
+// Mesh import is not a device command so is not recorded. With no target device there is no
+// importer, so meshes can't be loaded
+IMeshImport* CRecordingRenderDevice::CreateMeshImport()
+{
+	return m_Target ? m_Target->CreateMeshImport() : NULL;
+}
+
+TRenderHandle CRecordingRenderDevice::CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique )
+{
+	TRenderHandle layout = NewHandle( m_Target ? m_Target->CreateInputLayout( elements, numElements, technique ) : 0 );
+	TUInt32* args = Record( kCommandCreateInputLayout, 3 );
+	args[0] = layout;
+	args[1] = numElements;
+	args[2] = technique;
+	return layout;
+}
+
+TRenderHandle CRecordingRenderDevice::CreateOcclusionPredicate()
+{
+	TRenderHandle predicate = NewHandle( m_Target ? m_Target->CreateOcclusionPredicate() : 0 );
+	Record( kCommandCreateOcclusionPredicate, 1 )[0] = predicate;
+	return predicate;
+}
+
+void CRecordingRenderDevice::Release( TRenderHandle resource )
+{
+	Record( kCommandRelease, 1 )[0] = resource;
+	if (m_Target) m_Target->Release( resource );
+}
+
+
+//-----------------------------------------------------------------------------
+// Effects
+//-----------------------------------------------------------------------------
+
+TRenderHandle CRecordingRenderDevice::LoadEffect( const string& fileName, string& errors )
+{
+	TRenderHandle effect = NewHandle( m_Target ? m_Target->LoadEffect( fileName, errors ) : 0, fileName );
+	TUInt32* args = Record( kCommandLoadEffect, 2 );
+	args[0] = effect;
+	args[1] = AddString( fileName );
+	return effect;
+}
+
+TRenderHandle CRecordingRenderDevice::GetTechnique( TRenderHandle effect, const string& name )
+{
+	TRenderHandle technique = NewHandle( m_Target ? m_Target->GetTechnique( effect, name ) : 0, name );
+	TUInt32* args = Record( kCommandGetTechnique, 3 );
+	args[0] = technique;
+	args[1] = effect;
+	args[2] = AddString( name );
+	return technique;
+}
+
+TRenderHandle CRecordingRenderDevice::GetVariable( TRenderHandle effect, const string& name )
+{
+	TRenderHandle variable = NewHandle( m_Target ? m_Target->GetVariable( effect, name ) : 0, name );
+	TUInt32* args = Record( kCommandGetVariable, 3 );
+	args[0] = variable;
+	args[1] = effect;
+	args[2] = AddString( name );
+	return variable;
+}
+
+// Not recorded - a query with no effect on rendering
+TUInt32 CRecordingRenderDevice::NumPasses( TRenderHandle technique )
+{
+	return m_Target ? m_Target->NumPasses( technique ) : 1;
+}
+
+void CRecordingRenderDevice::SetFloat( TRenderHandle variable, TFloat32 value )
+{
+	TUInt32* args = Record( kCommandSetFloat, 2 );
+	args[0] = variable;
+	args[1] = FloatArg( value );
+	if (m_Target) m_Target->SetFloat( variable, value );
+}
+
+void CRecordingRenderDevice::SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count )
+{
+	TUInt32* args = Record( kCommandSetVector, 1 + count );
+	args[0] = variable;
+	memcpy( args + 1, values, count * sizeof(TFloat32) );
+	if (m_Target) m_Target->SetVector( variable, values, count );
+}
+
+void CRecordingRenderDevice::SetMatrix( TRenderHandle variable, const TFloat32* matrix )
+{
+	TUInt32* args = Record( kCommandSetMatrix, 17 );
+	args[0] = variable;
+	memcpy( args + 1, matrix, 16 * sizeof(TFloat32) );
+	if (m_Target) m_Target->SetMatrix( variable, matrix );
+}
+
+void CRecordingRenderDevice::SetTexture( TRenderHandle variable, TRenderHandle texture )
+{
+	TUInt32* args = Record( kCommandSetTexture, 2 );
+	args[0] = variable;
+	args[1] = texture;
+	if (m_Target) m_Target->SetTexture( variable, texture );
+}
+
+void CRecordingRenderDevice::ApplyPass( TRenderHandle technique, TUInt32 pass )
+{
+	TUInt32* args = Record( kCommandApplyPass, 2 );
+	args[0] = technique;
+	args[1] = pass;
+	if (m_Target) m_Target->ApplyPass( technique, pass );
+}
+
+
+//-----------------------------------------------------------------------------
+// Output
+//-----------------------------------------------------------------------------
+
+void CRecordingRenderDevice::SetViewport( TUInt32 width, TUInt32 height )
+{
+	TUInt32* args = Record( kCommandSetViewport, 2 );
+	args[0] = width;
+	args[1] = height;
+	if (m_Target) m_Target->SetViewport( width, height );
+}
+
+void CRecordingRenderDevice::SetRenderTarget( TRenderHandle target )
+{
+	Record( kCommandSetRenderTarget, 1 )[0] = target;
+	if (m_Target) m_Target->SetRenderTarget( target );
+}
+
+void CRecordingRenderDevice::ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] )
+{
+	TUInt32* args = Record( kCommandClearRenderTarget, 5 );
+	args[0] = target;
+	memcpy( args + 1, colour, 4 * sizeof(TFloat32) );
+	if (m_Target) m_Target->ClearRenderTarget( target, colour );
+}
+
+void CRecordingRenderDevice::ClearDepth( TFloat32 depth )
+{
+	Record( kCommandClearDepth, 1 )[0] = FloatArg( depth );
+	if (m_Target) m_Target->ClearDepth( depth );
+}
+
+void CRecordingRenderDevice::CopyTexture( TRenderHandle dest, TRenderHandle source )
+{
+	TUInt32* args = Record( kCommandCopyTexture, 2 );
+	args[0] = dest;
+	args[1] = source;
+	if (m_Target) m_Target->CopyTexture( dest, source );
+}
+
+
+//-----------------------------------------------------------------------------
+// Drawing
+//-----------------------------------------------------------------------------
+
+void CRecordingRenderDevice::SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize )
+{
+	TUInt32* args = Record( kCommandSetVertexBuffer, 2 );
+	args[0] = buffer;
+	args[1] = vertexSize;
+	if (m_Target) m_Target->SetVertexBuffer( buffer, vertexSize );
+}
+
+void CRecordingRenderDevice::SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize )
+{
+	TUInt32* args = Record( kCommandSetInstanceBuffer, 2 );
+	args[0] = buffer;
+	args[1] = instanceSize;
+	if (m_Target) m_Target->SetInstanceBuffer( buffer, instanceSize );
+}
+
+void CRecordingRenderDevice::SetIndexBuffer( TRenderHandle buffer )
+{
+	Record( kCommandSetIndexBuffer, 1 )[0] = buffer;
+	if (m_Target) m_Target->SetIndexBuffer( buffer );
+}
+
+void CRecordingRenderDevice::SetInputLayout( TRenderHandle layout )
+{
+	Record( kCommandSetInputLayout, 1 )[0] = layout;
+	if (m_Target) m_Target->SetInputLayout( layout );
+}
+
+void CRecordingRenderDevice::SetPrimitiveTopology( EPrimitiveTopology topology )
+{
+	Record( kCommandSetPrimitiveTopology, 1 )[0] = topology;
+	if (m_Target) m_Target->SetPrimitiveTopology( topology );
+}
+
+void CRecordingRenderDevice::Draw( TUInt32 numVertices, TUInt32 firstVertex )
+{
+	TUInt32* args = Record( kCommandDraw, 2 );
+	args[0] = numVertices;
+	args[1] = firstVertex;
+	if (m_Target) m_Target->Draw( numVertices, firstVertex );
+}
+
+void CRecordingRenderDevice::DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex )
+{
+	TUInt32* args = Record( kCommandDrawIndexed, 3 );
+	args[0] = numIndices;
+	args[1] = firstIndex;
+	args[2] = static_cast<TUInt32>(baseVertex);
+	if (m_Target) m_Target->DrawIndexed( numIndices, firstIndex, baseVertex );
+}
+
+void CRecordingRenderDevice::DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex,
+                                                   TInt32 baseVertex, TUInt32 firstInstance )
+{
+	TUInt32* args = Record( kCommandDrawIndexedInstanced, 5 );
+	args[0] = numIndices;
+	args[1] = numInstances;
+	args[2] = firstIndex;
+	args[3] = static_cast<TUInt32>(baseVertex);
+	args[4] = firstInstance;
+	if (m_Target) m_Target->DrawIndexedInstanced( numIndices, numInstances, firstIndex, baseVertex, firstInstance );
+}
+
+void CRecordingRenderDevice::BeginOcclusionTest( TRenderHandle predicate )
+{
+	Record( kCommandBeginOcclusionTest, 1 )[0] = predicate;
+	if (m_Target) m_Target->BeginOcclusionTest( predicate );
+}
+
+void CRecordingRenderDevice::EndOcclusionTest( TRenderHandle predicate )
+{
+	Record( kCommandEndOcclusionTest, 1 )[0] = predicate;
+	if (m_Target) m_Target->EndOcclusionTest( predicate );
+}
+
+void CRecordingRenderDevice::SetPredication( TRenderHandle predicate )
+{
+	Record( kCommandSetPredication, 1 )[0] = predicate;
+	if (m_Target) m_Target->SetPredication( predicate );
+}
+
+
+//-----------------------------------------------------------------------------
+// Text
+//-----------------------------------------------------------------------------
+
+void CRecordingRenderDevice::DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre )
+{
+	TUInt32* args = Record( kCommandDrawString, 8 );
+	args[0] = AddString( text );
+	args[1] = static_cast<TUInt32>(x);
+	args[2] = static_cast<TUInt32>(y);
+	memcpy( args + 3, colour, 4 * sizeof(TFloat32) );
+	args[7] = centre ? 1 : 0;
+	if (m_Target) m_Target->DrawString( text, x, y, colour, centre );
+}
+
+
+} // namespace gen
@@ -0,0 +1,226 @@
+/*******************************************
+	RecordingRenderDevice.h
+
+	Render device that records every call in
+	a compact command stream
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+using namespace std;
+
+#include "RenderDevice.h"
+
+namespace gen
+{
+
+// Calls recorded by CRecordingRenderDevice, one for each IRenderDevice function
+enum ERenderCommand
+{
+	kCommandPresent,
+	kCommandCreateVertexBuffer,
+	kCommandCreateIndexBuffer,
+	kCommandCreateRenderTexture,
+	kCommandLoadTexture,
+	kCommandCreateInputLayout,
+	kCommandCreateOcclusionPredicate,
+	kCommandRelease,
+	kCommandLoadEffect,
+	kCommandGetTechnique,
+	kCommandGetVariable,
+	kCommandSetFloat,
+	kCommandSetVector,
+	kCommandSetMatrix,
+	kCommandSetTexture,
+	kCommandApplyPass,
+	kCommandSetViewport,
+	kCommandSetRenderTarget,
+	kCommandClearRenderTarget,
+	kCommandClearDepth,
+	kCommandCopyTexture,
+	kCommandSetVertexBuffer,
+	kCommandSetIndexBuffer,
+	kCommandSetInputLayout,
+	kCommandSetPrimitiveTopology,
+	kCommandDraw,
+	kCommandDrawIndexed,
+	kCommandBeginOcclusionTest,
+	kCommandEndOcclusionTest,
+	kCommandSetPredication,
+	kCommandDrawString,
+	kCommandCreateDynamicVertexBuffer,
+	kCommandUpdateVertexBuffer,
+	kCommandSetInstanceBuffer,
+	kCommandDrawIndexedInstanced,
+	kCommandWriteBuffer,
+	kNumRenderCommands
+};
+
+// Name of each command (the IRenderDevice function name)
+extern const char* const RenderCommandNames[kNumRenderCommands];
+
+
+// One command read back from the stream. The arguments are those of the function in order, with
+// the handle a creation function returned first. Handles and integers are held as they are,
+// floats as their bits (see RecordedFloat) and strings as indices for String. Buffer contents
+// are not kept, only their size, and the elements of an input layout only their number
+struct SRecordedCommand
+{
+	ERenderCommand Command;
+	TUInt32        NumArgs;
+	const TUInt32* Args;
+};
+
+// Float argument of a recorded command
+TFloat32 RecordedFloat( TUInt32 arg );
+
+
+// A render device that appends each call to a command stream of 32-bit words, a header word
+// then the arguments, so a whole frame costs a few KB and can be checked for its draws and
+// state changes - e.g. how many draws RenderScene makes, or that a variable is set before the
+// pass that uses it. Names of effects, techniques, variables and texture files are kept by
+// handle to make the stream readable.
+//
+// On its own the device stands in for the graphics API like CNullRenderDevice. Given a target
+// device every call is also passed on to it, so a frame on the real API can be recorded
+class CRecordingRenderDevice : public IRenderDevice
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Record calls, passing them on to the target device if one is given
+	CRecordingRenderDevice( IRenderDevice* target = 0 );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CRecordingRenderDevice( const CRecordingRenderDevice& );
+	CRecordingRenderDevice& operator=( const CRecordingRenderDevice& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Recording
+
+	// Remove the commands recorded so far, e.g. after setup to record a single frame. Handle
+	// names are kept
+	void Clear();
+
+	// Words in the stream, and its size in bytes
+	TUInt32 StreamSize() const
+	{
+		return static_cast<TUInt32>(m_Stream.size());
+	}
+	size_t StreamBytes() const
+	{
+		return m_Stream.size() * sizeof(TUInt32);
+	}
+
+	// Number of commands recorded, in all or of one kind
+	TUInt32 NumCommands() const;
+	TUInt32 NumCommands( ERenderCommand command ) const
+	{
+		return m_Counts[command];
+	}
+
+	// Read the command at a position in the stream and return the position of the next. Start
+	// at 0 and stop at StreamSize()
+	TUInt32 ReadCommand( TUInt32 position, SRecordedCommand& command ) const;
+
+	// String argument of a recorded command
+	const string& String( TUInt32 index ) const
+	{
+		return m_Strings[index];
+	}
+
+	// Name given to a handle when it was created (file, technique or variable name), or its
+	// number if it has none
+	string HandleName( TRenderHandle handle ) const;
+
+	// A command as text, e.g. "SetFloat SpiralTimer 2.5"
+	string Describe( const SRecordedCommand& command ) const;
+
+
+	/////////////////////////////////////
+	// IRenderDevice
+
+	TRenderHandle BackBuffer();
+	void Present();
+
+	TRenderHandle CreateVertexBuffer( const void* data, TUInt32 size );
+	TRenderHandle CreateDynamicVertexBuffer( TUInt32 size );
+	void UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size );
+	TRenderHandle CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices );
+	void WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size );
+	TRenderHandle CreateRenderTexture( TUInt32 width, TUInt32 height );
+	TRenderHandle LoadTexture( const string& fileName );
+	IMeshImport* CreateMeshImport();
+	TRenderHandle CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique );
+	TRenderHandle CreateOcclusionPredicate();
+	void Release( TRenderHandle resource );
+
+	TRenderHandle LoadEffect( const string& fileName, string& errors );
+	TRenderHandle GetTechnique( TRenderHandle effect, const string& name );
+	TRenderHandle GetVariable( TRenderHandle effect, const string& name );
+	TUInt32 NumPasses( TRenderHandle technique );
+	void SetFloat( TRenderHandle variable, TFloat32 value );
+	void SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count );
+	void SetMatrix( TRenderHandle variable, const TFloat32* matrix );
+	void SetTexture( TRenderHandle variable, TRenderHandle texture );
+	void ApplyPass( TRenderHandle technique, TUInt32 pass );
+
+	void SetViewport( TUInt32 width, TUInt32 height );
+	void SetRenderTarget( TRenderHandle target );
+	void ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] );
+	void ClearDepth( TFloat32 depth );
+	void CopyTexture( TRenderHandle dest, TRenderHandle source );
+
+	void SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize );
+	void SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize );
+	void SetIndexBuffer( TRenderHandle buffer );
+	void SetInputLayout( TRenderHandle layout );
+	void SetPrimitiveTopology( EPrimitiveTopology topology );
+	void Draw( TUInt32 numVertices, TUInt32 firstVertex );
+	void DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex );
+	void DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex, TInt32 baseVertex,
+	                           TUInt32 firstInstance );
+	void BeginOcclusionTest( TRenderHandle predicate );
+	void EndOcclusionTest( TRenderHandle predicate );
+	void SetPredication( TRenderHandle predicate );
+
+	void DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre );
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// Append a command with the given number of arguments to the stream, returning where to
+	// write the arguments
+	TUInt32* Record( ERenderCommand command, TUInt32 numArgs );
+
+	// Add a string for a string argument, returning its index
+	TUInt32 AddString( const string& text );
+
+	// A handle from the target for a resource it created, or a new one without a target. Gives
+	// the handle a name if one is given
+	TRenderHandle NewHandle( TRenderHandle targetHandle, const string& name = "" );
+
+	IRenderDevice* m_Target;
+	TRenderHandle  m_NextHandle; // Next handle to hand out without a target
+
+	vector<TUInt32>            m_Stream;
+	vector<string>             m_Strings;     // Strings of string arguments
+	TUInt32                    m_Counts[kNumRenderCommands];
+	map<TRenderHandle, string> m_HandleNames;
+};
+
+
+} // namespace gen
@@ -0,0 +1,210 @@
+/*******************************************
+	RenderDevice.h
+
+	Interface between the frame code and the
+	graphics API
+********************************************/
+
+#pragma once
+
+#include <string>
+using namespace std;
+
+#include "Defines.h"
+
+namespace gen
+{
+
+class IMeshImport;
+
+
+//-----------------------------------------------------------------------------
+// Render device types
+//-----------------------------------------------------------------------------
+
+// Handle to a resource created by a render device: a buffer, texture, input layout, effect,
+// technique, effect variable or predicate. Handles are only meaningful to the device that
+// created them, and 0 is never a valid handle
+typedef TUInt32 TRenderHandle;
+const TRenderHandle kNoRenderHandle = 0;
+
+
+// Format of an element of a vertex
+enum EVertexFormat
+{
+	kVertexFloat2,
+	kVertexFloat3,
+	kVertexFloat4,
+	kVertexUByte4,     // Four unsigned integers 0->255, e.g. blend indices
+	kVertexUByte4Norm, // Four values 0->1 stored as 0->255, e.g. a colour
+};
+
+// One element of a vertex, e.g. the position or a set of UVs
+struct SVertexElement
+{
+	const char*   Semantic;      // Semantic in HLSL (what this data is for)
+	TUInt32       SemanticIndex; // Count for this kind of data, e.g. 1 for TEXCOORD1
+	EVertexFormat Format;
+	TUInt32       Offset;        // Bytes from the start of the vertex
+	TUInt32       Slot;          // 0 for the vertex buffer, 1 for per-instance data in the instance buffer
+};
+
+// How the vertices of a draw are joined up
+enum EPrimitiveTopology
+{
+	kTriangleList,
+	kTriangleStrip,
+};
+
+
+//-----------------------------------------------------------------------------
+// Render device interface
+//-----------------------------------------------------------------------------
+
+// Everything the frame code (RenderScene, render methods, meshes) asks of the graphics API:
+// buffers, textures, render targets, effects and their variables, and draws. Resources are
+// named by handles rather than API pointers, so a frame can be rendered by the Direct3D 10
+// device (CD3D10RenderDevice), measured with no API cost at all (CNullRenderDevice) or recorded
+// as a command stream to be checked (CRecordingRenderDevice).
+//
+// Creation functions return kNoRenderHandle on failure. Setting a variable or using a handle
+// of kNoRenderHandle is allowed and does nothing (or unbinds, for textures and layouts)
+class IRenderDevice
+{
+public:
+	// Destructor - base class destructors should always be virtual
+	virtual ~IRenderDevice() {}
+
+
+	/////////////////////////////////////
+	// Frame buffers
+
+	// The back buffer, usable as a render target and as the destination of CopyTexture. It has
+	// the size and format of the textures made by CreateRenderTexture with the same size
+	virtual TRenderHandle BackBuffer() = 0;
+
+	// Present the back buffer to the display
+	virtual void Present() = 0;
+
+
+	/////////////////////////////////////
+	// Resources
+
+	// Create a vertex buffer holding the given data. With no data the contents are undefined
+	// until written with WriteBuffer
+	virtual TRenderHandle CreateVertexBuffer( const void* data, TUInt32 size ) = 0;
+
+	// Create a vertex buffer of the given size whose contents are replaced each frame with
+	// UpdateVertexBuffer, e.g. an instance buffer
+	virtual TRenderHandle CreateDynamicVertexBuffer( TUInt32 size ) = 0;
+
+	// Replace the contents of a dynamic vertex buffer with the given data (up to its size)
+	virtual void UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size ) = 0;
+
+	// Create an index buffer holding the given 16-bit indices, or undefined contents if none
+	virtual TRenderHandle CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices ) = 0;
+
+	// Write data to part of a vertex or index buffer made by CreateVertexBuffer / CreateIndexBuffer,
+	// starting the given number of bytes in. For geometry that changes rarely, e.g. on loading a mesh
+	virtual void WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size ) = 0;
+
+	// Create an 8-bit RGBA texture that can be rendered to and read in shaders
+	virtual TRenderHandle CreateRenderTexture( TUInt32 width, TUInt32 height ) = 0;
+
+	// Load a texture from an image file to read in shaders
+	virtual TRenderHandle LoadTexture( const string& fileName ) = 0;
+
+	// Create an importer for mesh files, deleted by the caller when done, or NULL on failure.
+	// Reading X-files needs the graphics API's own library (D3DX), so it comes from the device
+	virtual IMeshImport* CreateMeshImport() = 0;
+
+	// Create a layout for vertices made of the given elements, for use with techniques that have
+	// the same vertex input as the given one
+	virtual TRenderHandle CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique ) = 0;
+
+	// Create a predicate for BeginOcclusionTest / SetPredication
+	virtual TRenderHandle CreateOcclusionPredicate() = 0;
+
+	// Release a buffer, texture, layout, effect or predicate (techniques and variables are
+	// released with their effect). The device may give the handle to a later resource
+	virtual void Release( TRenderHandle resource ) = 0;
+
+
+	/////////////////////////////////////
+	// Effects
+
+	// Load and compile an effect file. On failure returns kNoRenderHandle with any compiler
+	// messages in errors
+	virtual TRenderHandle LoadEffect( const string& fileName, string& errors ) = 0;
+
+	// Technique or variable of an effect by name, kNoRenderHandle if there is none
+	virtual TRenderHandle GetTechnique( TRenderHandle effect, const string& name ) = 0;
+	virtual TRenderHandle GetVariable( TRenderHandle effect, const string& name ) = 0;
+
+	// Number of passes in a technique
+	virtual TUInt32 NumPasses( TRenderHandle technique ) = 0;
+
+	// Set effect variables. Vectors are given as count floats (e.g. 3 for a float3), matrices
+	// as 16 floats and textures by handle (kNoRenderHandle to unbind)
+	virtual void SetFloat( TRenderHandle variable, TFloat32 value ) = 0;
+	virtual void SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count ) = 0;
+	virtual void SetMatrix( TRenderHandle variable, const TFloat32* matrix ) = 0;
+	virtual void SetTexture( TRenderHandle variable, TRenderHandle texture ) = 0;
+
+	// Set the shaders and states of a pass of a technique, with the current variable values
+	virtual void ApplyPass( TRenderHandle technique, TUInt32 pass ) = 0;
+
+
+	/////////////////////////////////////
+	// Output
+
+	// Render to the given area of the render target from its top-left
+	virtual void SetViewport( TUInt32 width, TUInt32 height ) = 0;
+
+	// Render to the given texture (or the back buffer), depth testing against the depth buffer
+	virtual void SetRenderTarget( TRenderHandle target ) = 0;
+
+	virtual void ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] ) = 0;
+	virtual void ClearDepth( TFloat32 depth ) = 0;
+
+	// Copy the whole of one texture (or the back buffer) to another of the same size and format
+	virtual void CopyTexture( TRenderHandle dest, TRenderHandle source ) = 0;
+
+
+	/////////////////////////////////////
+	// Drawing
+
+	// Geometry used by the draws. Without an input layout draws have no vertex input, for vertex
+	// shaders that make their own vertices. The instance buffer holds the data read by layout
+	// elements in slot 1, one item for each instance of an instanced draw
+	virtual void SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize ) = 0;
+	virtual void SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize ) = 0;
+	virtual void SetIndexBuffer( TRenderHandle buffer ) = 0;
+	virtual void SetInputLayout( TRenderHandle layout ) = 0;
+	virtual void SetPrimitiveTopology( EPrimitiveTopology topology ) = 0;
+
+	virtual void Draw( TUInt32 numVertices, TUInt32 firstVertex ) = 0;
+	virtual void DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex ) = 0;
+	virtual void DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex, TInt32 baseVertex,
+	                                   TUInt32 firstInstance ) = 0;
+
+	// Draws between these calls are depth tested only, with no shading or colour writes, and set
+	// the predicate to whether any of their pixels passed. Begin after applying the pass to test
+	virtual void BeginOcclusionTest( TRenderHandle predicate ) = 0;
+	virtual void EndOcclusionTest( TRenderHandle predicate ) = 0;
+
+	// Skip draws until the next call if the predicate shows no pixels passed its occlusion test.
+	// kNoRenderHandle draws everything again. The CPU does not wait for the test result
+	virtual void SetPredication( TRenderHandle predicate ) = 0;
+
+
+	/////////////////////////////////////
+	// Text
+
+	// Draw a string in the on-screen font to the back buffer, with the top-left (or top-centre
+	// if centred) at the given pixel. Lines are separated with '\n'
+	virtual void DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre ) = 0;
+};
+
+
+} // namespace gen
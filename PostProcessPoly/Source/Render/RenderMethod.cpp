@@ -6,7 +6,6 @@
 ****************************************************************************************/
 
 #include "RenderMethod.h"
-#include "MathDX.h"
 
 namespace gen
 {
@@ -17,7 +16,7 @@ namespace gen
 
 // Get reference to global variables from another source file
 // Not good practice - these functions should be part of a class with this as a member
-extern ID3D10Device* g_pd3dDevice;
+extern IRenderDevice* RenderDevice;
 
 // Folders used for meshes/textures and effect file
 extern const string MediaFolder;
@@ -30,39 +29,39 @@ extern const string ShaderFolder;
 // Variables to connect C++ code to HLSL shaders
 
 // Effects / techniques
-ID3D10Effect* Effect = NULL;
+TRenderHandle Effect = kNoRenderHandle;
 
 // Matrices / camera
-ID3D10EffectMatrixVariable* WorldMatrixVar = NULL;
-ID3D10EffectMatrixVariable* ViewMatrixVar = NULL;
-ID3D10EffectMatrixVariable* ProjMatrixVar = NULL;
-ID3D10EffectMatrixVariable* ViewProjMatrixVar = NULL;
-ID3D10EffectVectorVariable* CameraPosVar = NULL;
+TRenderHandle WorldMatrixVar = kNoRenderHandle;
+TRenderHandle ViewMatrixVar = kNoRenderHandle;
+TRenderHandle ProjMatrixVar = kNoRenderHandle;
+TRenderHandle ViewProjMatrixVar = kNoRenderHandle;
+TRenderHandle CameraPosVar = kNoRenderHandle;
 
 // Lighting
-ID3D10EffectVectorVariable* Light1PosVar = NULL;
-ID3D10EffectVectorVariable* Light1ColourVar = NULL;
-ID3D10EffectVectorVariable* Light2PosVar = NULL;
-ID3D10EffectVectorVariable* Light2ColourVar = NULL;
-ID3D10EffectVectorVariable* AmbientColourVar = NULL;
+TRenderHandle Light1PosVar = kNoRenderHandle;
+TRenderHandle Light1ColourVar = kNoRenderHandle;
+TRenderHandle Light2PosVar = kNoRenderHandle;
+TRenderHandle Light2ColourVar = kNoRenderHandle;
+TRenderHandle AmbientColourVar = kNoRenderHandle;
 
 // Material colour
-ID3D10EffectVectorVariable* DiffuseColourVar = NULL;
-ID3D10EffectVectorVariable* SpecularColourVar = NULL;
-ID3D10EffectScalarVariable* SpecularPowerVar = NULL;
+TRenderHandle DiffuseColourVar = kNoRenderHandle;
+TRenderHandle SpecularColourVar = kNoRenderHandle;
+TRenderHandle SpecularPowerVar = kNoRenderHandle;
 
 // Textures
-ID3D10EffectShaderResourceVariable* DiffuseMapVar = NULL;
-ID3D10EffectShaderResourceVariable* DiffuseMap2Var = NULL; // Second diffuse map for special techniques
-ID3D10EffectShaderResourceVariable* NormalMapVar = NULL;
+TRenderHandle DiffuseMapVar = kNoRenderHandle;
+TRenderHandle DiffuseMap2Var = kNoRenderHandle; // Second diffuse map for special techniques
+TRenderHandle NormalMapVar = kNoRenderHandle;
 
 // Scene texture used for post-processing materials (passed over from the main post process code via the SetSceneTexture function)
-ID3D10EffectShaderResourceVariable* SceneTexturePolyVar = NULL;
-ID3D10EffectScalarVariable* ViewportWidthVar = NULL; // Dimensions of the viewport needed to help access the scene texture (see poly post-processing shaders)
-ID3D10EffectScalarVariable* ViewportHeightVar = NULL;
+TRenderHandle SceneTexturePolyVar = kNoRenderHandle;
+TRenderHandle ViewportWidthVar = kNoRenderHandle; // Dimensions of the viewport needed to help access the scene texture (see poly post-processing shaders)
+TRenderHandle ViewportHeightVar = kNoRenderHandle;
 
 // Other
-ID3D10EffectScalarVariable* ParallaxDepthVar = NULL;
+TRenderHandle ParallaxDepthVar = kNoRenderHandle;
 
 	
 
@@ -73,13 +72,13 @@ ID3D10EffectScalarVariable* ParallaxDepthVar = NULL;
 // Prototypes for shader initialisation functions in array below
 // The functions are defined using a function pointer type (PShaderFn in RenderMethod.h)
 // These functions must all have the same style of prototype as shown above
-void RM_TransformColour( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
-void RM_TransformTex( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
-void RM_TransformTexColour( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
-void RM_TransformMaterial( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
-void RM_TransformTexMaterial( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
-void RM_NormalMapping( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
-void RM_ParallaxMapping( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
+void RM_TransformColour( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
+void RM_TransformTex( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
+void RM_TransformTexColour( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
+void RM_TransformMaterial( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
+void RM_TransformTexMaterial( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
+void RM_NormalMapping( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
+void RM_ParallaxMapping( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix );
 
 
 
@@ -91,15 +90,15 @@ void RM_ParallaxMapping( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, fl
 // the Post-Process bool set true, which indicates this material will be rendered in a second pass - see the PostProcessPoly.cpp code
 SRenderMethod RenderMethods[NumRenderMethods] =
 {
-//	|Technique name|  |Method init fn|         |Num Tex|  |Tangents|  |Post-Process|  |for internal use|   |Method Name|
-	"PlainColour",     RM_TransformColour,      0,         false,      false,          0,                // PlainColour   
-	"TexColour",       RM_TransformTexColour,   1,         false,      false,          0,                // PlainTexture  
-	"PixelLit",        RM_TransformMaterial,    0,         false,      false,          0,                // PixelLit      
-	"PixelLitTex",     RM_TransformTexMaterial, 1,         false,      false,          0,                // PixelLitTex   
-	"NormalMapping",   RM_NormalMapping,        2,         true,       false,          0,                // NormalMap       
-	"ParallaxMapping", RM_ParallaxMapping,      2,         true,       false,          0,                // ParallaxMap       
-	"PPTintPoly",      RM_TransformColour,      0,         false,      true,           0,                // PPTint       
-	"PPCutGlassPoly",  RM_ParallaxMapping,		2,		   true,	   true,		   0,				 // PPCutGlass
+//	|Technique name|  |Method init fn|         |Num Tex|  |Tangents|  |Post-Process|  |for internal use|  |Instanced technique|      |Method Name|
+	"PlainColour",     RM_TransformColour,      0,         false,      false,          0,                 "PlainColourInstanced",  0, // PlainColour   
+	"TexColour",       RM_TransformTexColour,   1,         false,      false,          0,                 "TexColourInstanced",    0, // PlainTexture  
+	"PixelLit",        RM_TransformMaterial,    0,         false,      false,          0,                 "PixelLitInstanced",     0, // PixelLit      
+	"PixelLitTex",     RM_TransformTexMaterial, 1,         false,      false,          0,                 "PixelLitTexInstanced",  0, // PixelLitTex   
+	"NormalMapping",   RM_NormalMapping,        2,         true,       false,          0,                 "",                      0, // NormalMap       
+	"ParallaxMapping", RM_ParallaxMapping,      2,         true,       false,          0,                 "",                      0, // ParallaxMap       
+	"PPTintPoly",      RM_TransformColour,      0,         false,      true,           0,                 "",                      0, // PPTint       
+	"PPCutGlassPoly",  RM_ParallaxMapping,		2,		   true,	   true,		   0,				  "",                      0, // PPCutGlass
 };
 
 
@@ -178,14 +177,26 @@ bool RenderMethodIsPostProcess( ERenderMethod method )
 }
 
 // Return the .fx file technique used by given render method
-ID3D10EffectTechnique* GetRenderMethodTechnique( ERenderMethod method )
+TRenderHandle GetRenderMethodTechnique( ERenderMethod method )
 {
 	return RenderMethods[method].technique;
 }
 
+// Return whether given render method has an instanced technique
+bool RenderMethodCanInstance( ERenderMethod method )
+{
+	return RenderMethods[method].instancedTechnique != kNoRenderHandle;
+}
+
+// Return the .fx file instanced technique used by given render method, 0 if it has none
+TRenderHandle GetRenderMethodInstancedTechnique( ERenderMethod method )
+{
+	return RenderMethods[method].instancedTechnique;
+}
+
 // Use the given method for rendering
-void SetRenderMethod( ERenderMethod method, D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower,
-                      ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void SetRenderMethod( ERenderMethod method, SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower,
+                      TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
 	// Initialise shader constants and other render settings
 	RenderMethods[method].setupFn( diffuseColour, specularColour, specularPower, textures, worldMatrix );
@@ -199,49 +210,47 @@ void SetRenderMethod( ERenderMethod method, D3DXCOLOR* diffuseColour, D3DXCOLOR*
 // Initialise general method data
 bool InitialiseMethods()
 {
-	ID3D10Blob* pErrors; // This strangely typed variable collects any errors when compiling the effect file
-	DWORD dwShaderFlags = D3D10_SHADER_ENABLE_STRICTNESS; // These "flags" are used to set the compiler options
-
 	// Load and compile the effect file
-	string fullFileName = ShaderFolder + "Scene.fx";
-	if( FAILED( D3DX10CreateEffectFromFile( fullFileName.c_str(), NULL, NULL, "fx_4_0", dwShaderFlags, 0, g_pd3dDevice, NULL, NULL, &Effect, &pErrors, NULL ) ))
+	string errors;
+	Effect = RenderDevice->LoadEffect( ShaderFolder + "Scene.fx", errors );
+	if (!Effect)
 	{
-		if (pErrors != 0)  MessageBox( NULL, reinterpret_cast<char*>(pErrors->GetBufferPointer()), "Error", MB_OK ); // Compiler error: display error message
-		else               MessageBox( NULL, "Error loading FX file. Ensure your FX file is in the same folder as this executable.", "Error", MB_OK );  // No error message - probably file not found
+		if (errors != "")  SystemMessageBox( errors.c_str(), "Error" ); // Compiler error: display error message
+		else               SystemMessageBox( "Error loading FX file. Ensure your FX file is in the same folder as this executable.", "Error" );  // No error message - probably file not found
 		return false;
 	}
 
 	// Access matrix / camera shader variables
-	WorldMatrixVar    = Effect->GetVariableByName( "WorldMatrix"    )->AsMatrix();
-	ViewMatrixVar     = Effect->GetVariableByName( "ViewMatrix"     )->AsMatrix();
-	ProjMatrixVar     = Effect->GetVariableByName( "ProjMatrix"     )->AsMatrix();
-	ViewProjMatrixVar = Effect->GetVariableByName( "ViewProjMatrix" )->AsMatrix();
-	CameraPosVar      = Effect->GetVariableByName( "CameraPos"     )->AsVector();
+	WorldMatrixVar    = RenderDevice->GetVariable( Effect, "WorldMatrix" );
+	ViewMatrixVar     = RenderDevice->GetVariable( Effect, "ViewMatrix" );
+	ProjMatrixVar     = RenderDevice->GetVariable( Effect, "ProjMatrix" );
+	ViewProjMatrixVar = RenderDevice->GetVariable( Effect, "ViewProjMatrix" );
+	CameraPosVar      = RenderDevice->GetVariable( Effect, "CameraPos" );
 
 	// Access lighting shader variables
-	Light1PosVar     = Effect->GetVariableByName( "Light1Pos"     )->AsVector();
-	Light1ColourVar  = Effect->GetVariableByName( "Light1Colour"  )->AsVector();
-	Light2PosVar     = Effect->GetVariableByName( "Light2Pos"     )->AsVector();
-	Light2ColourVar  = Effect->GetVariableByName( "Light2Colour"  )->AsVector();
-	AmbientColourVar = Effect->GetVariableByName( "AmbientColour" )->AsVector();
+	Light1PosVar     = RenderDevice->GetVariable( Effect, "Light1Pos" );
+	Light1ColourVar  = RenderDevice->GetVariable( Effect, "Light1Colour" );
+	Light2PosVar     = RenderDevice->GetVariable( Effect, "Light2Pos" );
+	Light2ColourVar  = RenderDevice->GetVariable( Effect, "Light2Colour" );
+	AmbientColourVar = RenderDevice->GetVariable( Effect, "AmbientColour" );
 
 	// Access material colour shader variables
-	DiffuseColourVar  = Effect->GetVariableByName( "DiffuseColour" )->AsVector();
-	SpecularColourVar = Effect->GetVariableByName( "SpecularColour" )->AsVector();
-	SpecularPowerVar  = Effect->GetVariableByName( "SpecularPower" )->AsScalar();
+	DiffuseColourVar  = RenderDevice->GetVariable( Effect, "DiffuseColour" );
+	SpecularColourVar = RenderDevice->GetVariable( Effect, "SpecularColour" );
+	SpecularPowerVar  = RenderDevice->GetVariable( Effect, "SpecularPower" );
 
 	// Access texture shader variables (not referred to as textures - any GPU memory accessed in a shader is a "Shader Resource")
-	DiffuseMapVar       = Effect->GetVariableByName( "DiffuseMap" )->AsShaderResource();
-	DiffuseMap2Var      = Effect->GetVariableByName( "DiffuseMap2" )->AsShaderResource();
-	NormalMapVar        = Effect->GetVariableByName( "NormalMap"  )->AsShaderResource();
+	DiffuseMapVar       = RenderDevice->GetVariable( Effect, "DiffuseMap" );
+	DiffuseMap2Var      = RenderDevice->GetVariable( Effect, "DiffuseMap2" );
+	NormalMapVar        = RenderDevice->GetVariable( Effect, "NormalMap" );
 
 	// Polygon post-processing variables
-	SceneTexturePolyVar = Effect->GetVariableByName( "SceneTexture" )->AsShaderResource();
-	ViewportWidthVar    = Effect->GetVariableByName( "ViewportWidth" )->AsScalar();
-	ViewportHeightVar   = Effect->GetVariableByName( "ViewportHeight" )->AsScalar();
+	SceneTexturePolyVar = RenderDevice->GetVariable( Effect, "SceneTexture" );
+	ViewportWidthVar    = RenderDevice->GetVariable( Effect, "ViewportWidth" );
+	ViewportHeightVar   = RenderDevice->GetVariable( Effect, "ViewportHeight" );
 
 	// Access to other shader variables
-	ParallaxDepthVar = Effect->GetVariableByName( "ParallaxDepth" )->AsScalar();
+	ParallaxDepthVar = RenderDevice->GetVariable( Effect, "ParallaxDepth" );
 
 	return true;
 }
@@ -252,8 +261,8 @@ bool PrepareMethod( ERenderMethod method )
 	// Initialise the technique for this method if it hasn't been already
 	if (!RenderMethods[method].technique)
 	{
-		RenderMethods[method].technique = Effect->GetTechniqueByName( RenderMethods[method].techniqueName.c_str() );
-		if (!RenderMethods[method].technique->IsValid())
+		RenderMethods[method].technique = RenderDevice->GetTechnique( Effect, RenderMethods[method].techniqueName );
+		if (!RenderMethods[method].technique)
 		{
 			string errorMsg = "Error selecting technique " + RenderMethods[method].techniqueName;
 			SystemMessageBox( errorMsg.c_str(), "Shader Error" );
@@ -261,13 +270,25 @@ bool PrepareMethod( ERenderMethod method )
 		}
 	}
 
+	// Likewise the instanced technique if the method has one
+	if (!RenderMethods[method].instancedTechnique && RenderMethods[method].instancedTechniqueName != "")
+	{
+		RenderMethods[method].instancedTechnique = RenderDevice->GetTechnique( Effect, RenderMethods[method].instancedTechniqueName );
+		if (!RenderMethods[method].instancedTechnique)
+		{
+			string errorMsg = "Error selecting technique " + RenderMethods[method].instancedTechniqueName;
+			SystemMessageBox( errorMsg.c_str(), "Shader Error" );
+			return false;
+		}
+	}
+
 	return true;
 }
 
-// Releases the DirectX data associated with all render methods
+// Releases the render device data associated with all render methods
 void ReleaseMethods()
 {
-	if (Effect) Effect->Release();
+	RenderDevice->Release( Effect );
 }
 
 
@@ -278,17 +299,20 @@ void ReleaseMethods()
 // Set the ambient light colour used for all methods
 void SetAmbientLight( const SColourRGBA& ambientColour )
 {
-	SColourRGBA ambient = ambientColour; // Can't pass constant parameter to SetRawValue function
-	AmbientColourVar->SetRawValue( &ambient, 0, 12 );
+	RenderDevice->SetVector( AmbientColourVar, &ambientColour.r, 3 );
 }
 
 // Set the light list to use for all methods
 void SetLights( CLight** lights )
 {
-	Light1PosVar->   SetRawValue( &lights[0]->GetPosition(), 0, 12 );  // Send 3 floats (12 bytes) from C++ light position variable (x,y,z) to shader counterpart (middle parameter is unused) 
-	Light2PosVar->   SetRawValue( &lights[1]->GetPosition(), 0, 12 );
-	Light1ColourVar->SetRawValue( &lights[0]->GetColour(), 0, 12 );
-	Light2ColourVar->SetRawValue( &lights[1]->GetColour(), 0, 12 );
+	CVector3 light1Pos = lights[0]->GetPosition();
+	CVector3 light2Pos = lights[1]->GetPosition();
+	SColourRGBA light1Colour = lights[0]->GetColour();
+	SColourRGBA light2Colour = lights[1]->GetColour();
+	RenderDevice->SetVector( Light1PosVar,    &light1Pos.x, 3 );  // Send 3 floats from C++ light position variable (x,y,z) to shader counterpart
+	RenderDevice->SetVector( Light2PosVar,    &light2Pos.x, 3 );
+	RenderDevice->SetVector( Light1ColourVar, &light1Colour.r, 3 );
+	RenderDevice->SetVector( Light2ColourVar, &light2Colour.r, 3 );
 }
 
 // Set the camera to use for all methods
@@ -296,17 +320,23 @@ void SetCamera( CCamera* camera )
 {
 	CMatrix4x4 viewMatrix = camera->GetViewMatrix();
 	CMatrix4x4 projMatrix = camera->GetProjMatrix();
-	ViewMatrixVar->SetMatrix( &viewMatrix.e00 );
-	ProjMatrixVar->SetMatrix( &projMatrix.e00 );
-	CameraPosVar->SetRawValue( &camera->Position(), 0, 12 );
+	RenderDevice->SetMatrix( ViewMatrixVar, &viewMatrix.e00 );
+	RenderDevice->SetMatrix( ProjMatrixVar, &projMatrix.e00 );
+	RenderDevice->SetVector( CameraPosVar, &camera->Position().x, 3 );
+}
+
+// Set the world matrix alone, for a draw using the same render method and material as the last
+void SetWorldMatrix( CMatrix4x4* worldMatrix )
+{
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
 }
 
 // Set the scene texture / viewport dimensions used for post-processing material shaders - called from post-processing code
-void SetSceneTexture( ID3D10ShaderResourceView* sceneShaderResource, int ViewportWidth, int ViewportHeight )
+void SetSceneTexture( TRenderHandle sceneShaderResource, int ViewportWidth, int ViewportHeight )
 {
-	SceneTexturePolyVar->SetResource( sceneShaderResource );
-	ViewportWidthVar->SetFloat( static_cast<float>(ViewportWidth) );
-	ViewportHeightVar->SetFloat( static_cast<float>(ViewportHeight) );
+	RenderDevice->SetTexture( SceneTexturePolyVar, sceneShaderResource );
+	RenderDevice->SetFloat( ViewportWidthVar, static_cast<float>(ViewportWidth) );
+	RenderDevice->SetFloat( ViewportHeightVar, static_cast<float>(ViewportHeight) );
 }
 
 
@@ -315,67 +345,67 @@ void SetSceneTexture( ID3D10ShaderResourceView* sceneShaderResource, int Viewpor
 //-----------------------------------------------------------------------------
 
 // Pass world matrix and diffuse colour to shaders
-void RM_TransformColour( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_TransformColour( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-	DiffuseColourVar->SetRawValue( *diffuseColour, 0, 12 );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+	RenderDevice->SetVector( DiffuseColourVar, &diffuseColour->r, 3 );
 }
 
 // Pass world matrix and diffuse texture map to shaders
-void RM_TransformTex( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_TransformTex( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-    DiffuseMapVar->SetResource( textures[0] );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+    RenderDevice->SetTexture( DiffuseMapVar, textures[0] );
 }
 
 // Pass world matrix, diffuse texture map and diffuse colour to shaders
-void RM_TransformTexColour( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_TransformTexColour( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-	DiffuseColourVar->SetRawValue( *diffuseColour, 0, 12 );
-    DiffuseMapVar->SetResource( textures[0] );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+	RenderDevice->SetVector( DiffuseColourVar, &diffuseColour->r, 3 );
+    RenderDevice->SetTexture( DiffuseMapVar, textures[0] );
 }
 
 // Pass world matrix and full material colours to shaders
-void RM_TransformMaterial( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_TransformMaterial( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-	DiffuseColourVar->SetRawValue( *diffuseColour, 0, 12 );
-	SpecularColourVar->SetRawValue( *specularColour, 0, 12 );
-	SpecularPowerVar->SetFloat( specularPower );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+	RenderDevice->SetVector( DiffuseColourVar, &diffuseColour->r, 3 );
+	RenderDevice->SetVector( SpecularColourVar, &specularColour->r, 3 );
+	RenderDevice->SetFloat( SpecularPowerVar, specularPower );
 }
 
 // Pass world matrix, diffuse texture map and full material colours to shaders
-void RM_TransformTexMaterial( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_TransformTexMaterial( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-	DiffuseColourVar->SetRawValue( *diffuseColour, 0, 12 );
-	SpecularColourVar->SetRawValue( *specularColour, 0, 12 );
-	SpecularPowerVar->SetFloat( specularPower );
-    DiffuseMapVar->SetResource( textures[0] );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+	RenderDevice->SetVector( DiffuseColourVar, &diffuseColour->r, 3 );
+	RenderDevice->SetVector( SpecularColourVar, &specularColour->r, 3 );
+	RenderDevice->SetFloat( SpecularPowerVar, specularPower );
+    RenderDevice->SetTexture( DiffuseMapVar, textures[0] );
 }
 
 // Pass world matrix, diffuse and normal map and full material colours to shaders
-void RM_NormalMapping( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_NormalMapping( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-	DiffuseColourVar->SetRawValue( *diffuseColour, 0, 12 );
-	SpecularColourVar->SetRawValue( *specularColour, 0, 12 );
-	SpecularPowerVar->SetFloat( specularPower );
-    DiffuseMapVar->SetResource( textures[0] );
-    NormalMapVar->SetResource( textures[1] );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+	RenderDevice->SetVector( DiffuseColourVar, &diffuseColour->r, 3 );
+	RenderDevice->SetVector( SpecularColourVar, &specularColour->r, 3 );
+	RenderDevice->SetFloat( SpecularPowerVar, specularPower );
+    RenderDevice->SetTexture( DiffuseMapVar, textures[0] );
+    RenderDevice->SetTexture( NormalMapVar, textures[1] );
 }
 
 // Pass world matrix, diffuse and normal map and full material colours to shaders, also set parallax depth
-void RM_ParallaxMapping( D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix )
+void RM_ParallaxMapping( SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix )
 {
-	WorldMatrixVar->SetMatrix( &worldMatrix->e00 );
-	DiffuseColourVar->SetRawValue( *diffuseColour, 0, 12 );
-	SpecularColourVar->SetRawValue( *specularColour, 0, 12 );
-	SpecularPowerVar->SetFloat( specularPower );
-    DiffuseMapVar->SetResource( textures[0] );
-    NormalMapVar->SetResource( textures[1] );
-	ParallaxDepthVar->SetFloat( 0.1f );
+	RenderDevice->SetMatrix( WorldMatrixVar, &worldMatrix->e00 );
+	RenderDevice->SetVector( DiffuseColourVar, &diffuseColour->r, 3 );
+	RenderDevice->SetVector( SpecularColourVar, &specularColour->r, 3 );
+	RenderDevice->SetFloat( SpecularPowerVar, specularPower );
+    RenderDevice->SetTexture( DiffuseMapVar, textures[0] );
+    RenderDevice->SetTexture( NormalMapVar, textures[1] );
+	RenderDevice->SetFloat( ParallaxDepthVar, 0.1f );
 }
 
 
@@ -10,10 +10,8 @@
 #include <string>
 using namespace std;
 
-#include <d3d10.h>
-#include <d3dx10.h>
-
 #include "Defines.h"
+#include "RenderDevice.h"
 #include "CMatrix4x4.h"
 #include "Camera.h"
 #include "Light.h"
@@ -42,11 +40,11 @@ enum ERenderMethod
 
 
 // Pointer to a function to initialise a render method - typically sets shader constants
-typedef void (*PRenderMethodFn)(D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower, ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix);
+typedef void (*PRenderMethodFn)(SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower, TRenderHandle* textures, CMatrix4x4* worldMatrix);
 
 // Structure defining a rendering method - defines vertex and pixel shader source files,
 // initialisation functions, number of textures used and the structure of the vertex elements
-// Also contains DirectX pointers associated with the shaders and the vertex declaration
+// Also contains the render device handle of the technique
 struct SRenderMethod
 {
 	string                 techniqueName; // Name of technique in fx file for this render method
@@ -57,7 +55,10 @@ struct SRenderMethod
 
 	bool                   isPostProcess; //**** Whether this render method is a post-process or not. Post process methods are rendered in a second pass (see main code)
 
-	ID3D10EffectTechnique* technique;     // Pointer to actual technique
+	TRenderHandle          technique;     // Handle of actual technique
+
+	string                 instancedTechniqueName; // Technique drawing many copies of a mesh in one call, each with its own world matrix, "" if none
+	TRenderHandle          instancedTechnique;     // Handle of instanced technique
 };
 
 
@@ -88,11 +89,18 @@ bool RenderMethodUsesTangents( ERenderMethod method );
 bool RenderMethodIsPostProcess( ERenderMethod method );
 
 // Return the .fx file technique used by given render method
-ID3D10EffectTechnique* GetRenderMethodTechnique( ERenderMethod method );
+TRenderHandle GetRenderMethodTechnique( ERenderMethod method );
+
+// Return whether given render method has an instanced technique, which takes the world matrix of
+// each instance from the instance buffer (four float4 rows, WORLD0-3) instead of from SetWorldMatrix
+bool RenderMethodCanInstance( ERenderMethod method );
+
+// Return the .fx file instanced technique used by given render method, 0 if it has none
+TRenderHandle GetRenderMethodInstancedTechnique( ERenderMethod method );
 
 // Use the given method for rendering
-void SetRenderMethod( ERenderMethod method, D3DXCOLOR* diffuseColour, D3DXCOLOR* specularColour, float specularPower,
-                      ID3D10ShaderResourceView** textures, CMatrix4x4* worldMatrix );
+void SetRenderMethod( ERenderMethod method, SColourRGBA* diffuseColour, SColourRGBA* specularColour, float specularPower,
+                      TRenderHandle* textures, CMatrix4x4* worldMatrix );
 
 
 //-----------------------------------------------------------------------------
@@ -105,7 +113,7 @@ bool InitialiseMethods();
 // Initialises the given render method, returns true on success
 bool PrepareMethod( ERenderMethod method );
 
-// Releases the DirectX data associated with all render methods
+// Releases the render device data associated with all render methods
 void ReleaseMethods();
 
 
@@ -122,8 +130,11 @@ void SetLights( CLight** lights );
 // Set the camera to use for all methods
 void SetCamera( CCamera* camera );
 
+// Set the world matrix alone, for a draw using the same render method and material as the last
+void SetWorldMatrix( CMatrix4x4* worldMatrix );
+
 // Set the scene texture / viewport dimensions used for post-processing material shaders - called from post-processing code
-void SetSceneTexture( ID3D10ShaderResourceView* sceneShaderResource, int ViewportWidth, int ViewportHeight );
+void SetSceneTexture( TRenderHandle sceneShaderResource, int ViewportWidth, int ViewportHeight );
 
 
 } // namespace gen
\ No newline at end of file
@@ -73,6 +73,19 @@ struct VS_INPUT
 	float2 UV      : TEXCOORD0;
 };
 
+// Standard vertex data with the world matrix of an instance, for instanced techniques. The matrix rows
+// come from a second buffer that steps once per instance rather than once per vertex
+struct VS_INSTANCED_INPUT
+{
+    float3 Pos     : POSITION;
+    float3 Normal  : NORMAL;
+	float2 UV      : TEXCOORD0;
+	float4 World0  : WORLD0;
+	float4 World1  : WORLD1;
+	float4 World2  : WORLD2;
+	float4 World3  : WORLD3;
+};
+
 // Input vertex data with additional tangents for normal mapping
 struct VS_NORMALMAP_INPUT
 {
@@ -130,15 +143,19 @@ struct VS_NORMALMAP_OUTPUT
 // Vertex Shaders
 //--------------------------------------------------------------------------------------
 
+// The vertex shaders below that are used for both single and instanced draws are written as functions
+// of the world matrix, called with WorldMatrix by the single version and with the instance's own
+// matrix by the instanced version (see the end of this section)
+
 // Basic vertex shader to transform 3D model vertices to 2D only
 //
-VS_BASIC_OUTPUT VSTransformOnly( VS_INPUT vIn )
+VS_BASIC_OUTPUT TransformOnlyVertex( VS_INPUT vIn, float4x4 worldMatrix )
 {
 	VS_BASIC_OUTPUT vOut;
 	
 	// Transform the input model vertex position into world space, then view space, then 2D projection space
 	float4 modelPos = float4(vIn.Pos, 1.0f); // Promote to 1x4 so we can multiply by 4x4 matrix, put 1.0 in 4th element for a point (0.0 for a vector)
-	float4 worldPos = mul( modelPos, WorldMatrix );
+	float4 worldPos = mul( modelPos, worldMatrix );
 	float4 viewPos  = mul( worldPos, ViewMatrix );
 	vOut.ProjPos    = mul( viewPos,  ProjMatrix );
 
@@ -148,13 +165,13 @@ VS_BASIC_OUTPUT VSTransformOnly( VS_INPUT vIn )
 
 // Basic vertex shader to transform 3D model vertices to 2D and pass UVs to the pixel shader
 //
-VS_TEX_OUTPUT VSTransformTex( VS_INPUT vIn )
+VS_TEX_OUTPUT TransformTexVertex( VS_INPUT vIn, float4x4 worldMatrix )
 {
 	VS_TEX_OUTPUT vOut;
 	
 	// Transform the input model vertex position into world space, then view space, then 2D projection space
 	float4 modelPos = float4(vIn.Pos, 1.0f); // Promote to 1x4 so we can multiply by 4x4 matrix, put 1.0 in 4th element for a point (0.0 for a vector)
-	float4 worldPos = mul( modelPos, WorldMatrix );
+	float4 worldPos = mul( modelPos, worldMatrix );
 	float4 viewPos  = mul( worldPos, ViewMatrix );
 	vOut.ProjPos    = mul( viewPos,  ProjMatrix );
 	
@@ -167,7 +184,7 @@ VS_TEX_OUTPUT VSTransformTex( VS_INPUT vIn )
 
 // Standard vertex shader for pixel-lit untextured models
 //
-VS_LIGHTING_OUTPUT VSPixelLit( VS_INPUT vIn )
+VS_LIGHTING_OUTPUT PixelLitVertex( VS_INPUT vIn, float4x4 worldMatrix )
 {
 	VS_LIGHTING_OUTPUT vOut;
 
@@ -176,8 +193,8 @@ VS_LIGHTING_OUTPUT VSPixelLit( VS_INPUT vIn )
 	float4 modelNormal = float4(vIn.Normal, 0.0f);
 
 	// Transform model vertex position and normal to world space
-	float4 worldPos    = mul( modelPos,    WorldMatrix );
-	float3 worldNormal = mul( modelNormal, WorldMatrix );
+	float4 worldPos    = mul( modelPos,    worldMatrix );
+	float3 worldNormal = mul( modelNormal, worldMatrix );
 
 	// Pass world space position & normal to pixel shader for lighting calculations
    	vOut.WorldPos    = worldPos.xyz;
@@ -192,7 +209,7 @@ VS_LIGHTING_OUTPUT VSPixelLit( VS_INPUT vIn )
 
 // Standard vertex shader for pixel-lit textured models
 //
-VS_LIGHTINGTEX_OUTPUT VSPixelLitTex( VS_INPUT vIn )
+VS_LIGHTINGTEX_OUTPUT PixelLitTexVertex( VS_INPUT vIn, float4x4 worldMatrix )
 {
 	VS_LIGHTINGTEX_OUTPUT vOut;
 
@@ -201,8 +218,8 @@ VS_LIGHTINGTEX_OUTPUT VSPixelLitTex( VS_INPUT vIn )
 	float4 modelNormal = float4(vIn.Normal, 0.0f);
 
 	// Transform model vertex position and normal to world space
-	float4 worldPos    = mul( modelPos,    WorldMatrix );
-	float3 worldNormal = mul( modelNormal, WorldMatrix );
+	float4 worldPos    = mul( modelPos,    worldMatrix );
+	float3 worldNormal = mul( modelNormal, worldMatrix );
 
 	// Pass world space position & normal to pixel shader for lighting calculations
    	vOut.WorldPos    = worldPos.xyz;
@@ -219,6 +236,60 @@ VS_LIGHTINGTEX_OUTPUT VSPixelLitTex( VS_INPUT vIn )
 }
 
 
+// Vertex shaders using the world matrix shader variable
+//
+VS_BASIC_OUTPUT VSTransformOnly( VS_INPUT vIn )
+{
+	return TransformOnlyVertex( vIn, WorldMatrix );
+}
+VS_TEX_OUTPUT VSTransformTex( VS_INPUT vIn )
+{
+	return TransformTexVertex( vIn, WorldMatrix );
+}
+VS_LIGHTING_OUTPUT VSPixelLit( VS_INPUT vIn )
+{
+	return PixelLitVertex( vIn, WorldMatrix );
+}
+VS_LIGHTINGTEX_OUTPUT VSPixelLitTex( VS_INPUT vIn )
+{
+	return PixelLitTexVertex( vIn, WorldMatrix );
+}
+
+
+// Instanced vertex shaders - the world matrix is rebuilt from the rows sent with each instance.
+// A single instanced draw renders many copies of a sub-mesh, each with its own matrix
+//
+VS_INPUT InstanceVertex( VS_INSTANCED_INPUT vIn )
+{
+	VS_INPUT vertex;
+	vertex.Pos    = vIn.Pos;
+	vertex.Normal = vIn.Normal;
+	vertex.UV     = vIn.UV;
+	return vertex;
+}
+float4x4 InstanceWorldMatrix( VS_INSTANCED_INPUT vIn )
+{
+	return float4x4( vIn.World0, vIn.World1, vIn.World2, vIn.World3 );
+}
+
+VS_BASIC_OUTPUT VSTransformOnlyInstanced( VS_INSTANCED_INPUT vIn )
+{
+	return TransformOnlyVertex( InstanceVertex( vIn ), InstanceWorldMatrix( vIn ) );
+}
+VS_TEX_OUTPUT VSTransformTexInstanced( VS_INSTANCED_INPUT vIn )
+{
+	return TransformTexVertex( InstanceVertex( vIn ), InstanceWorldMatrix( vIn ) );
+}
+VS_LIGHTING_OUTPUT VSPixelLitInstanced( VS_INSTANCED_INPUT vIn )
+{
+	return PixelLitVertex( InstanceVertex( vIn ), InstanceWorldMatrix( vIn ) );
+}
+VS_LIGHTINGTEX_OUTPUT VSPixelLitTexInstanced( VS_INSTANCED_INPUT vIn )
+{
+	return PixelLitTexVertex( InstanceVertex( vIn ), InstanceWorldMatrix( vIn ) );
+}
+
+
 // Vertex shader for normal-mapped models
 //
 VS_NORMALMAP_OUTPUT VSNormalMap( VS_NORMALMAP_INPUT vIn )
@@ -690,6 +761,74 @@ technique10 ParallaxMapping
 }
 
 
+// Instanced versions of the techniques above, the world matrix coming from the instance data rather than
+// WorldMatrix. Render methods whose pixel shaders also use WorldMatrix (normal and parallax mapping) have none
+
+// Diffuse material colour only, instanced
+technique10 PlainColourInstanced
+{
+    pass P0
+    {
+        SetVertexShader( CompileShader( vs_4_0, VSTransformOnlyInstanced() ) );
+        SetGeometryShader( NULL );                                   
+        SetPixelShader( CompileShader( ps_4_0, PSPlainColour() ) );
+
+		// Switch off blending states
+		SetBlendState( NoBlending, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+		SetRasterizerState( CullBack ); 
+		SetDepthStencilState( DepthWritesOn, 0 );
+	}
+}
+
+// Texture tinted with diffuse material colour, instanced
+technique10 TexColourInstanced
+{
+    pass P0
+    {
+        SetVertexShader( CompileShader( vs_4_0, VSTransformTexInstanced() ) );
+        SetGeometryShader( NULL );                                   
+        SetPixelShader( CompileShader( ps_4_0, PSTexColour() ) );
+
+		// Switch off blending states
+		SetBlendState( NoBlending, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+		SetRasterizerState( CullBack ); 
+		SetDepthStencilState( DepthWritesOn, 0 );
+	}
+}
+
+// Pixel lighting, instanced
+technique10 PixelLitInstanced
+{
+    pass P0
+    {
+        SetVertexShader( CompileShader( vs_4_0, VSPixelLitInstanced() ) );
+        SetGeometryShader( NULL );                                   
+        SetPixelShader( CompileShader( ps_4_0, PSPixelLit() ) );
+
+		// Switch off blending states
+		SetBlendState( NoBlending, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+		SetRasterizerState( CullBack ); 
+		SetDepthStencilState( DepthWritesOn, 0 );
+	}
+}
+
+// Pixel lighting with diffuse texture, instanced
+technique10 PixelLitTexInstanced
+{
+    pass P0
+    {
+        SetVertexShader( CompileShader( vs_4_0, VSPixelLitTexInstanced() ) );
+        SetGeometryShader( NULL );                                   
+        SetPixelShader( CompileShader( ps_4_0, PSPixelLitTex() ) );
+
+		// Switch off blending states
+		SetBlendState( NoBlending, float4( 0.0f, 0.0f, 0.0f, 0.0f ), 0xFFFFFFFF );
+		SetRasterizerState( CullBack ); 
+		SetDepthStencilState( DepthWritesOn, 0 );
+	}
+}
+
+
 //**|PPPOLY|****************************************************************************
 // Polygon post-processing materials (shaders & techniques)
 //**************************************************************************************
@@ -0,0 +1,119 @@
+/*******************************************
+	StateCacheRenderDevice.cpp
+
+	Render device that drops effect variable
+	writes that would not change the value
+********************************************/
+
+#include <string.h>
+
+#include "StateCacheRenderDevice.h"
+
+namespace gen
+{
+
+// Cache variable writes to the given device (which may be set later with SetTarget)
+CStateCacheRenderDevice::CStateCacheRenderDevice( IRenderDevice* target /*= 0*/ )
+{
+	m_Target = target;
+	m_Enabled = true;
+	memset( &m_Frame, 0, sizeof(m_Frame) );
+	memset( &m_LastFrame, 0, sizeof(m_LastFrame) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Cache
+//-----------------------------------------------------------------------------
+
+// Forget all cached values, so the next write to each variable is passed on
+void CStateCacheRenderDevice::Invalidate()
+{
+	for (TUInt32 variable = 0; variable < m_Values.size(); ++variable)
+	{
+		m_Values[variable].Type = kValueNone;
+	}
+}
+
+// Whether a write of the given value to a variable changes it, storing the value if so. Counts
+// the write as submitted or elided
+bool CStateCacheRenderDevice::Changes( TRenderHandle variable, EValueType type, const void* words, TUInt32 numWords )
+{
+	if (!m_Enabled || variable == kNoRenderHandle || variable > kMaxCachedHandle || numWords > kMaxValueWords)
+	{
+		++m_Frame.Submitted;
+		return true;
+	}
+
+	if (variable >= m_Values.size())
+	{
+		SVariableValue unknown;
+		unknown.Type = kValueNone;
+		unknown.NumWords = 0;
+		m_Values.resize( variable + 1, unknown );
+	}
+	SVariableValue& value = m_Values[variable];
+	if (value.Type == type && value.NumWords == numWords && memcmp( value.Words, words, numWords * sizeof(TUInt32) ) == 0)
+	{
+		++m_Frame.Elided;
+		return false;
+	}
+
+	value.Type = type;
+	value.NumWords = numWords;
+	memcpy( value.Words, words, numWords * sizeof(TUInt32) );
+	++m_Frame.Submitted;
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// IRenderDevice
+//-----------------------------------------------------------------------------
+
+// Ends the frame for the counters
+void CStateCacheRenderDevice::Present()
+{
+	m_Target->Present();
+	m_LastFrame = m_Frame;
+	memset( &m_Frame, 0, sizeof(m_Frame) );
+}
+
+// Releasing an effect releases its variables, and a released texture's handle may be reused by
+// the target, so the cache starts again. Resources are only released on shutdown or unload
+void CStateCacheRenderDevice::Release( TRenderHandle resource )
+{
+	m_Target->Release( resource );
+	Invalidate();
+}
+
+// A variable handle may be one the target has reused, so its cached value is forgotten
+TRenderHandle CStateCacheRenderDevice::GetVariable( TRenderHandle effect, const string& name )
+{
+	TRenderHandle variable = m_Target->GetVariable( effect, name );
+	if (variable < m_Values.size()) m_Values[variable].Type = kValueNone;
+	return variable;
+}
+
+void CStateCacheRenderDevice::SetFloat( TRenderHandle variable, TFloat32 value )
+{
+	if (Changes( variable, kValueFloat, &value, 1 )) m_Target->SetFloat( variable, value );
+}
+
+void CStateCacheRenderDevice::SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count )
+{
+	if (Changes( variable, kValueVector, values, count )) m_Target->SetVector( variable, values, count );
+}
+
+void CStateCacheRenderDevice::SetMatrix( TRenderHandle variable, const TFloat32* matrix )
+{
+	if (Changes( variable, kValueMatrix, matrix, 16 )) m_Target->SetMatrix( variable, matrix );
+}
+
+void CStateCacheRenderDevice::SetTexture( TRenderHandle variable, TRenderHandle texture )
+{
+	if (Changes( variable, kValueTexture, &texture, 1 )) m_Target->SetTexture( variable, texture );
+}
+
+
+} // namespace gen
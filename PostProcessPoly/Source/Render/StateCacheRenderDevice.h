@@ -0,0 +1,188 @@
+/*******************************************
+	StateCacheRenderDevice.h
+
+	Render device that drops effect variable
+	writes that would not change the value
+********************************************/
+
+#pragma once
+
+#include <vector>
+using namespace std;
+
+#include "RenderDevice.h"
+
+namespace gen
+{
+
+// Effect variable writes passed on and dropped by CStateCacheRenderDevice
+struct SStateCacheStats
+{
+	TUInt32 Submitted; // Writes passed on to the target device
+	TUInt32 Elided;    // Writes dropped as the variable already had the value
+};
+
+
+// A render device in front of another that keeps a shadow copy of the value last written to each
+// effect variable, and only passes a SetFloat / SetVector / SetMatrix / SetTexture on if the
+// value differs. The frame code re-sends camera, light and material values for every entity and
+// post-process pass, most of them unchanged. An effect keeps its variables' values until they
+// are set again, so dropping these writes leaves every pass with the same values.
+//
+// Values are compared bit for bit. The shadow copy is indexed by variable handle, which is
+// fine for devices that hand out handles in sequence (all in this project do); handles beyond
+// kMaxCachedHandle are always passed on. Every other call goes straight to the target
+class CStateCacheRenderDevice : public IRenderDevice
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Cache variable writes to the given device (which may be set later with SetTarget)
+	CStateCacheRenderDevice( IRenderDevice* target = 0 );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CStateCacheRenderDevice( const CStateCacheRenderDevice& );
+	CStateCacheRenderDevice& operator=( const CStateCacheRenderDevice& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	/////////////////////////////////////
+	// Cache
+
+	// Largest variable handle cached
+	static const TRenderHandle kMaxCachedHandle = 65535;
+
+	// Set the device to pass calls on to. Forgets all cached values
+	void SetTarget( IRenderDevice* target )
+	{
+		m_Target = target;
+		Invalidate();
+	}
+
+	// Forget all cached values, so the next write to each variable is passed on, e.g. if
+	// variables have been set on the target device directly
+	void Invalidate();
+
+	// Turn the cache on or off. When off every write is passed on (and counted as submitted)
+	void Enable( bool enable )
+	{
+		m_Enabled = enable;
+		if (!enable) Invalidate();
+	}
+
+	// Writes in the current frame so far, and in the last complete frame (frames end at Present)
+	const SStateCacheStats& FrameStats() const
+	{
+		return m_Frame;
+	}
+	const SStateCacheStats& LastFrameStats() const
+	{
+		return m_LastFrame;
+	}
+
+
+	/////////////////////////////////////
+	// IRenderDevice
+
+	TRenderHandle BackBuffer() { return m_Target->BackBuffer(); }
+	void Present();
+
+	TRenderHandle CreateVertexBuffer( const void* data, TUInt32 size ) { return m_Target->CreateVertexBuffer( data, size ); }
+	TRenderHandle CreateDynamicVertexBuffer( TUInt32 size ) { return m_Target->CreateDynamicVertexBuffer( size ); }
+	void UpdateVertexBuffer( TRenderHandle buffer, const void* data, TUInt32 size ) { m_Target->UpdateVertexBuffer( buffer, data, size ); }
+	TRenderHandle CreateIndexBuffer( const TUInt16* indices, TUInt32 numIndices ) { return m_Target->CreateIndexBuffer( indices, numIndices ); }
+	void WriteBuffer( TRenderHandle buffer, TUInt32 offset, const void* data, TUInt32 size )
+	{
+		m_Target->WriteBuffer( buffer, offset, data, size );
+	}
+	TRenderHandle CreateRenderTexture( TUInt32 width, TUInt32 height ) { return m_Target->CreateRenderTexture( width, height ); }
+	TRenderHandle LoadTexture( const string& fileName ) { return m_Target->LoadTexture( fileName ); }
+	IMeshImport* CreateMeshImport() { return m_Target->CreateMeshImport(); }
+	TRenderHandle CreateInputLayout( const SVertexElement* elements, TUInt32 numElements, TRenderHandle technique )
+	{
+		return m_Target->CreateInputLayout( elements, numElements, technique );
+	}
+	TRenderHandle CreateOcclusionPredicate() { return m_Target->CreateOcclusionPredicate(); }
+	void Release( TRenderHandle resource );
+
+	TRenderHandle LoadEffect( const string& fileName, string& errors ) { return m_Target->LoadEffect( fileName, errors ); }
+	TRenderHandle GetTechnique( TRenderHandle effect, const string& name ) { return m_Target->GetTechnique( effect, name ); }
+	TRenderHandle GetVariable( TRenderHandle effect, const string& name );
+	TUInt32 NumPasses( TRenderHandle technique ) { return m_Target->NumPasses( technique ); }
+	void SetFloat( TRenderHandle variable, TFloat32 value );
+	void SetVector( TRenderHandle variable, const TFloat32* values, TUInt32 count );
+	void SetMatrix( TRenderHandle variable, const TFloat32* matrix );
+	void SetTexture( TRenderHandle variable, TRenderHandle texture );
+	void ApplyPass( TRenderHandle technique, TUInt32 pass ) { m_Target->ApplyPass( technique, pass ); }
+
+	void SetViewport( TUInt32 width, TUInt32 height ) { m_Target->SetViewport( width, height ); }
+	void SetRenderTarget( TRenderHandle target ) { m_Target->SetRenderTarget( target ); }
+	void ClearRenderTarget( TRenderHandle target, const TFloat32 colour[4] ) { m_Target->ClearRenderTarget( target, colour ); }
+	void ClearDepth( TFloat32 depth ) { m_Target->ClearDepth( depth ); }
+	void CopyTexture( TRenderHandle dest, TRenderHandle source ) { m_Target->CopyTexture( dest, source ); }
+
+	void SetVertexBuffer( TRenderHandle buffer, TUInt32 vertexSize ) { m_Target->SetVertexBuffer( buffer, vertexSize ); }
+	void SetInstanceBuffer( TRenderHandle buffer, TUInt32 instanceSize ) { m_Target->SetInstanceBuffer( buffer, instanceSize ); }
+	void SetIndexBuffer( TRenderHandle buffer ) { m_Target->SetIndexBuffer( buffer ); }
+	void SetInputLayout( TRenderHandle layout ) { m_Target->SetInputLayout( layout ); }
+	void SetPrimitiveTopology( EPrimitiveTopology topology ) { m_Target->SetPrimitiveTopology( topology ); }
+	void Draw( TUInt32 numVertices, TUInt32 firstVertex ) { m_Target->Draw( numVertices, firstVertex ); }
+	void DrawIndexed( TUInt32 numIndices, TUInt32 firstIndex, TInt32 baseVertex ) { m_Target->DrawIndexed( numIndices, firstIndex, baseVertex ); }
+	void DrawIndexedInstanced( TUInt32 numIndices, TUInt32 numInstances, TUInt32 firstIndex, TInt32 baseVertex, TUInt32 firstInstance )
+	{
+		m_Target->DrawIndexedInstanced( numIndices, numInstances, firstIndex, baseVertex, firstInstance );
+	}
+	void BeginOcclusionTest( TRenderHandle predicate ) { m_Target->BeginOcclusionTest( predicate ); }
+	void EndOcclusionTest( TRenderHandle predicate ) { m_Target->EndOcclusionTest( predicate ); }
+	void SetPredication( TRenderHandle predicate ) { m_Target->SetPredication( predicate ); }
+
+	void DrawString( const string& text, TInt32 x, TInt32 y, const TFloat32 colour[4], bool centre )
+	{
+		m_Target->DrawString( text, x, y, colour, centre );
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// Kind of value last written to a variable
+	enum EValueType
+	{
+		kValueNone, // Not known - the next write is passed on
+		kValueFloat,
+		kValueVector,
+		kValueMatrix,
+		kValueTexture,
+	};
+
+	// The value last written to a variable, as the words of its floats or its texture handle
+	static const TUInt32 kMaxValueWords = 16;
+	struct SVariableValue
+	{
+		EValueType Type;
+		TUInt32    NumWords;
+		TUInt32    Words[kMaxValueWords];
+	};
+
+	// Whether a write of the given value to a variable changes it, storing the value if so.
+	// Counts the write as submitted or elided
+	bool Changes( TRenderHandle variable, EValueType type, const void* words, TUInt32 numWords );
+
+	IRenderDevice* m_Target;
+	bool           m_Enabled;
+
+	vector<SVariableValue> m_Values; // By variable handle
+
+	SStateCacheStats m_Frame;
+	SStateCacheStats m_LastFrame;
+};
+
+
+} // namespace gen
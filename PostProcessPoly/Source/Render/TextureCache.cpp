@@ -0,0 +1,181 @@
+/*******************************************
+	TextureCache.cpp
+
+	Shared, reference counted textures found
+	by file path and by file content
+********************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "TextureCache.h"
+
+namespace gen
+{
+
+// Load textures on the given device
+CTextureCache::CTextureCache( IRenderDevice* device /*= 0*/ )
+{
+	m_Device = device;
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+}
+
+
+//-----------------------------------------------------------------------------
+// Textures
+//-----------------------------------------------------------------------------
+
+// The texture in the given file, loaded if it is not already held, with one more user
+TRenderHandle CTextureCache::Acquire( const string& fileName )
+{
+	++m_Stats.Requests;
+
+	// Same path as a texture held
+	string path = NormalisePath( fileName );
+	map<string, TRenderHandle>::iterator byPath = m_ByPath.find( path );
+	if (byPath != m_ByPath.end())
+	{
+		STexture& texture = m_Textures[byPath->second];
+		++texture.Users;
+		++m_Stats.PathHits;
+		m_Stats.BytesSaved += texture.Content.Size;
+		return byPath->second;
+	}
+
+	// Same content as a texture held, under another path
+	SContentKey content = { 0, 0 };
+	if (HashFile( fileName, content ))
+	{
+		map<SContentKey, TRenderHandle>::iterator byContent = m_ByContent.find( content );
+		if (byContent != m_ByContent.end())
+		{
+			STexture& texture = m_Textures[byContent->second];
+			++texture.Users;
+			texture.Paths.push_back( path );
+			m_ByPath[path] = byContent->second;
+			++m_Stats.ContentHits;
+			m_Stats.BytesSaved += content.Size;
+			return byContent->second;
+		}
+	}
+
+	// Otherwise load it
+	TRenderHandle handle = m_Device->LoadTexture( fileName );
+	if (!handle) return kNoRenderHandle;
+
+	STexture& texture = m_Textures[handle];
+	texture.Users = 1;
+	texture.Content = content;
+	texture.Paths.push_back( path );
+	m_ByPath[path] = handle;
+	if (content.Size > 0) m_ByContent[content] = handle;
+
+	++m_Stats.Loads;
+	++m_Stats.Textures;
+	m_Stats.BytesLoaded += content.Size;
+	return handle;
+}
+
+
+// One less user of a texture from Acquire, released when it has none left
+void CTextureCache::Release( TRenderHandle handle )
+{
+	map<TRenderHandle, STexture>::iterator texture = m_Textures.find( handle );
+	if (texture == m_Textures.end() || --texture->second.Users > 0) return;
+
+	for (TUInt32 path = 0; path < texture->second.Paths.size(); ++path)
+	{
+		m_ByPath.erase( texture->second.Paths[path] );
+	}
+	if (texture->second.Content.Size > 0) m_ByContent.erase( texture->second.Content );
+	m_Textures.erase( texture );
+	m_Device->Release( handle );
+
+	++m_Stats.Evictions;
+	--m_Stats.Textures;
+}
+
+// Release all textures
+void CTextureCache::ReleaseAll()
+{
+	for (map<TRenderHandle, STexture>::iterator texture = m_Textures.begin(); texture != m_Textures.end(); ++texture)
+	{
+		m_Device->Release( texture->first );
+	}
+	m_Textures.clear();
+	m_ByPath.clear();
+	m_ByContent.clear();
+	m_Stats.Textures = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Keys
+//-----------------------------------------------------------------------------
+
+// A path in the form used as the cache key: lower case, back slashes, with "." and
+// "folder\.." parts removed
+string CTextureCache::NormalisePath( const string& fileName )
+{
+	// Split into lower case parts, dropping empty and "." parts and letting ".." remove the part
+	// before it. A ".." with nothing before it to remove is kept
+	vector<string> parts;
+	string part;
+	for (TUInt32 c = 0; c <= fileName.length(); ++c)
+	{
+		if (c < fileName.length() && fileName[c] != '\\' && fileName[c] != '/')
+		{
+			part += static_cast<char>(tolower( static_cast<unsigned char>(fileName[c]) ));
+			continue;
+		}
+		if (part == ".." && !parts.empty() && parts.back() != "..")
+		{
+			parts.pop_back();
+		}
+		else if (!part.empty() && part != ".")
+		{
+			parts.push_back( part );
+		}
+		part.clear();
+	}
+
+	string path;
+	for (TUInt32 p = 0; p < parts.size(); ++p)
+	{
+		if (p > 0) path += '\\';
+		path += parts[p];
+	}
+	return path;
+}
+
+// Read a file and hash its content with 64-bit FNV-1a
+bool CTextureCache::HashFile( const string& fileName, SContentKey& content )
+{
+	FILE* file = fopen( fileName.c_str(), "rb" );
+	if (!file) return false;
+
+	TUInt64 hash = 14695981039346656037ull;
+	TUInt64 size = 0;
+	unsigned char block[16384];
+	size_t read;
+	while ((read = fread( block, 1, sizeof(block), file )) > 0)
+	{
+		for (size_t byte = 0; byte < read; ++byte)
+		{
+			hash = (hash ^ block[byte]) * 1099511628211ull;
+		}
+		size += read;
+	}
+	bool readAll = !ferror( file );
+	fclose( file );
+
+	// Files of more than 4GB are not textures this project can load, so are treated as unreadable
+	if (!readAll || size == 0 || size > 0xffffffffu) return false;
+	content.Hash = hash;
+	content.Size = static_cast<TUInt32>(size);
+	return true;
+}
+
+
+} // namespace gen
@@ -0,0 +1,131 @@
+/*******************************************
+	TextureCache.h
+
+	Shared, reference counted textures found
+	by file path and by file content
+********************************************/
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+using namespace std;
+
+#include "Defines.h"
+#include "RenderDevice.h"
+
+namespace gen
+{
+
+// Texture requests served by a CTextureCache and what they saved
+struct STextureCacheStats
+{
+	TUInt32 Requests;    // Calls to Acquire
+	TUInt32 Loads;       // Textures loaded on the device
+	TUInt32 PathHits;    // Requests for a path already loaded
+	TUInt32 ContentHits; // Requests for a new path whose file matched a texture already loaded
+	TUInt32 Evictions;   // Textures released as their last user released them
+	TUInt32 Textures;    // Textures held now
+	size_t  BytesLoaded; // Size of the files loaded
+	size_t  BytesSaved;  // Size of the files not loaded again as they were found in the cache
+};
+
+
+// Meshes load every texture their materials name, so a texture used by several meshes (or by
+// several entity templates using the same mesh) would be loaded, decoded and uploaded once for
+// each. The cache loads a texture on first request and hands the same device texture to every
+// later request, counting users, and releases it when the last user does.
+//
+// Requests are found first by path, normalised so different spellings of the same file match.
+// A path not seen before has its file read and hashed, and if the content matches a texture
+// already loaded (e.g. a copy of a texture under another name) that texture is shared too. Files
+// that can't be read are loaded by path alone and left to the device to report.
+//
+// Sizes are of the image files, not of the decoded textures, as the device does not report those
+class CTextureCache
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Load textures on the given device, which may be set later with SetDevice
+	CTextureCache( IRenderDevice* device = 0 );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CTextureCache( const CTextureCache& );
+	CTextureCache& operator=( const CTextureCache& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Set the device to load textures on. Only while the cache holds no textures
+	void SetDevice( IRenderDevice* device )
+	{
+		m_Device = device;
+	}
+
+	// The texture in the given file, loaded if it is not already held, with one more user.
+	// Returns kNoRenderHandle if it can't be loaded
+	TRenderHandle Acquire( const string& fileName );
+
+	// One less user of a texture from Acquire, released when it has none left. Releasing
+	// kNoRenderHandle does nothing
+	void Release( TRenderHandle texture );
+
+	// Release all textures, e.g. on shutdown. Any handles still held become invalid
+	void ReleaseAll();
+
+	// Requests so far and what they saved
+	const STextureCacheStats& Stats() const
+	{
+		return m_Stats;
+	}
+
+	// A path in the form used as the cache key: lower case, back slashes, with "." and
+	// "folder\.." parts removed
+	static string NormalisePath( const string& fileName );
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// Hash and size of a file's content. A size of 0 is used for files that can't be read
+	struct SContentKey
+	{
+		TUInt64 Hash;
+		TUInt32 Size;
+
+		bool operator<( const SContentKey& other ) const
+		{
+			return Hash < other.Hash || (Hash == other.Hash && Size < other.Size);
+		}
+	};
+
+	// A texture held on the device
+	struct STexture
+	{
+		TUInt32        Users;
+		SContentKey    Content;
+		vector<string> Paths; // Normalised paths that refer to it
+	};
+
+	// Read a file and hash its content. Returns false if the file can't be read
+	static bool HashFile( const string& fileName, SContentKey& content );
+
+	IRenderDevice* m_Device;
+
+	map<TRenderHandle, STexture>    m_Textures;
+	map<string, TRenderHandle>      m_ByPath;
+	map<SContentKey, TRenderHandle> m_ByContent;
+
+	STextureCacheStats m_Stats;
+};
+
+
+} // namespace gen
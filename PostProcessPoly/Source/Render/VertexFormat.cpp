@@ -0,0 +1,132 @@
+/*******************************************
+	VertexFormat.cpp
+
+	Registry of the distinct vertex formats
+	and the input layouts made for them
+********************************************/
+
+#include <string.h>
+
+#include "VertexFormat.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Element hashing
+//-----------------------------------------------------------------------------
+
+// Add a word to an FNV-1a hash, a byte at a time
+inline TUInt32 HashWord( TUInt32 hash, TUInt32 word )
+{
+	for (TUInt32 byte = 0; byte < 4; ++byte)
+	{
+		hash = (hash ^ ((word >> (byte * 8)) & 0xff)) * 16777619u;
+	}
+	return hash;
+}
+
+// Hash of a list of elements. Semantics are hashed by their characters, not their addresses, as
+// equal semantics from different source files may be different literals
+TUInt32 HashElements( const SVertexElement* elements, TUInt32 numElements )
+{
+	TUInt32 hash = 2166136261u;
+	for (TUInt32 element = 0; element < numElements; ++element)
+	{
+		for (const char* c = elements[element].Semantic; *c; ++c)
+		{
+			hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+		}
+		hash = HashWord( hash, elements[element].SemanticIndex );
+		hash = HashWord( hash, elements[element].Format );
+		hash = HashWord( hash, elements[element].Offset );
+		hash = HashWord( hash, elements[element].Slot );
+	}
+	return HashWord( hash, numElements );
+}
+
+// Whether two elements are the same
+inline bool SameElement( const SVertexElement& a, const SVertexElement& b )
+{
+	return a.SemanticIndex == b.SemanticIndex && a.Format == b.Format && a.Offset == b.Offset && a.Slot == b.Slot &&
+	       (a.Semantic == b.Semantic || strcmp( a.Semantic, b.Semantic ) == 0);
+}
+
+
+//-----------------------------------------------------------------------------
+// Registry
+//-----------------------------------------------------------------------------
+
+// Create layouts on the given device
+CVertexFormatRegistry::CVertexFormatRegistry( IRenderDevice* device /*= 0*/ )
+{
+	m_Device = device;
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+}
+
+
+// The format made of the given elements, added if it is new
+bool CVertexFormatRegistry::RegisterFormat( const SVertexElement* elements, TUInt32 numElements, TVertexFormat& format )
+{
+	if (numElements > kMaxVertexElements) return false;
+	++m_Stats.FormatRequests;
+
+	// Compare in full only the formats with the same hash
+	TUInt32 hash = HashElements( elements, numElements );
+	for (TUInt32 f = 0; f < m_Formats.size(); ++f)
+	{
+		const SFormat& existing = m_Formats[f];
+		if (existing.Hash != hash || existing.NumElements != numElements) continue;
+
+		TUInt32 element = 0;
+		while (element < numElements && SameElement( existing.Elements[element], elements[element] )) ++element;
+		if (element == numElements)
+		{
+			format = static_cast<TVertexFormat>(f);
+			return true;
+		}
+	}
+
+	SFormat newFormat;
+	newFormat.Hash = hash;
+	newFormat.NumElements = numElements;
+	memcpy( newFormat.Elements, elements, numElements * sizeof(SVertexElement) );
+	m_Formats.push_back( newFormat );
+	++m_Stats.Formats;
+
+	format = static_cast<TVertexFormat>(m_Formats.size() - 1);
+	return true;
+}
+
+
+// The input layout for a format used with a technique, created on first use
+TRenderHandle CVertexFormatRegistry::GetInputLayout( TVertexFormat format, TRenderHandle technique )
+{
+	++m_Stats.LayoutRequests;
+
+	TUInt64 key = (static_cast<TUInt64>(format) << 32) | technique;
+	map<TUInt64, TRenderHandle>::iterator layout = m_Layouts.find( key );
+	if (layout != m_Layouts.end()) return layout->second;
+
+	const SFormat& vertexFormat = m_Formats[format];
+	TRenderHandle newLayout = m_Device->CreateInputLayout( vertexFormat.Elements, vertexFormat.NumElements, technique );
+	m_Layouts[key] = newLayout;
+	if (newLayout) ++m_Stats.Layouts;
+	return newLayout;
+}
+
+
+// Release all layouts and forget all formats
+void CVertexFormatRegistry::Release()
+{
+	for (map<TUInt64, TRenderHandle>::iterator layout = m_Layouts.begin(); layout != m_Layouts.end(); ++layout)
+	{
+		m_Device->Release( layout->second );
+	}
+	m_Layouts.clear();
+	m_Formats.clear();
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+}
+
+
+} // namespace gen
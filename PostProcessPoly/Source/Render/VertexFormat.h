@@ -0,0 +1,122 @@
+/*******************************************
+	VertexFormat.h
+
+	Registry of the distinct vertex formats
+	and the input layouts made for them
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <map>
+using namespace std;
+
+#include "Defines.h"
+#include "RenderDevice.h"
+
+namespace gen
+{
+
+// Index of a format in a CVertexFormatRegistry
+typedef TUInt16 TVertexFormat;
+
+// Most elements in a vertex format (the number of inputs a Direct3D 10 vertex shader can have)
+const TUInt32 kMaxVertexElements = 16;
+
+
+// Formats and layouts held by a CVertexFormatRegistry, and how often they were asked for
+struct SVertexFormatStats
+{
+	TUInt32 Formats;        // Distinct formats
+	TUInt32 FormatRequests; // Calls to RegisterFormat
+	TUInt32 Layouts;        // Input layouts created
+	TUInt32 LayoutRequests; // Calls to GetInputLayout
+};
+
+
+// Every sub-mesh describes its vertices with a list of elements, but a level only uses a few
+// distinct lists. The registry keeps each distinct list once, found by a hash of its elements,
+// and gives sub-meshes a small index for it. Input layouts are made on demand, one for each
+// pair of format and technique, and shared by every sub-mesh asking for that pair.
+//
+// A layout is checked against the vertex input of the technique it is made for, and the device
+// gives no way to compare techniques' inputs, so layouts are keyed by technique handle. Methods
+// with the same technique share layouts; methods with different techniques have their own even
+// if the inputs match
+class CVertexFormatRegistry
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	// Create layouts on the given device, which may be set later with SetDevice
+	CVertexFormatRegistry( IRenderDevice* device = 0 );
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CVertexFormatRegistry( const CVertexFormatRegistry& );
+	CVertexFormatRegistry& operator=( const CVertexFormatRegistry& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Set the device to create layouts on. Only while the registry holds no layouts
+	void SetDevice( IRenderDevice* device )
+	{
+		m_Device = device;
+	}
+
+	// The format made of the given elements, added if it is new. Element semantics are kept as
+	// pointers, so must be string literals. Returns false if there are too many elements
+	bool RegisterFormat( const SVertexElement* elements, TUInt32 numElements, TVertexFormat& format );
+
+	// Elements of a format
+	TUInt32 NumElements( TVertexFormat format ) const
+	{
+		return m_Formats[format].NumElements;
+	}
+	const SVertexElement* Elements( TVertexFormat format ) const
+	{
+		return m_Formats[format].Elements;
+	}
+
+	// The input layout for a format used with a technique, created on first use.
+	// kNoRenderHandle if the device can't make it (e.g. the technique needs other elements)
+	TRenderHandle GetInputLayout( TVertexFormat format, TRenderHandle technique );
+
+	// Release all layouts and forget all formats, e.g. on shutdown
+	void Release();
+
+	SVertexFormatStats Stats() const
+	{
+		return m_Stats;
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// A distinct list of elements
+	struct SFormat
+	{
+		TUInt32        Hash;
+		TUInt32        NumElements;
+		SVertexElement Elements[kMaxVertexElements];
+	};
+
+	IRenderDevice*  m_Device;
+	vector<SFormat> m_Formats;
+
+	// Layouts by format (high 32 bits) and technique (low 32 bits). Layouts that failed are kept
+	// too, as kNoRenderHandle, so they are not tried again
+	map<TUInt64, TRenderHandle> m_Layouts;
+
+	SVertexFormatStats m_Stats;
+};
+
+
+} // namespace gen
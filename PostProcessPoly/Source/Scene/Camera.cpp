@@ -5,9 +5,7 @@
 	Camera class implementation
 ********************************************/
 
-#include <d3dx9.h>
 #include "CVector4.h"
-#include "MathDX.h"
 #include "Camera.h"
 
 namespace gen
@@ -47,9 +45,18 @@ void CCamera::CalculateMatrices()
     // a perpsective transform, we need the field of view, the viewport 
 	// aspect ratio, and the near and far clipping planes (which define at
     // what distances geometry should be no longer be rendered).
+	// The matrix is the left-handed one made by D3DXMatrixPerspectiveFovLH, built here so the
+	// camera has no dependency on D3DX
 	TFloat32 fovY = ATan(Tan( m_FOV * 0.5f ) / m_Aspect) * 2.0f; // Need fovY, storing fovX
-    D3DXMatrixPerspectiveFovLH( ToD3DXMATRIXPtr(&m_MatProj), fovY, m_Aspect,
-	                            m_NearClip, m_FarClip );
+	TFloat32 scaleY = 1.0f / Tan( fovY * 0.5f );
+	TFloat32 depthScale = m_FarClip / (m_FarClip - m_NearClip);
+	m_MatProj = CMatrix4x4::kIdentity;
+	m_MatProj.e00 = scaleY / m_Aspect;
+	m_MatProj.e11 = scaleY;
+	m_MatProj.e22 = depthScale;
+	m_MatProj.e23 = 1.0f;
+	m_MatProj.e32 = -m_NearClip * depthScale;
+	m_MatProj.e33 = 0.0f;
 
 	// Combine the view and projection matrix into a single matrix - this will
 	// be passed to vertex shaders (more efficient this way)
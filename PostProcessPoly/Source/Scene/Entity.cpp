@@ -50,6 +50,23 @@ CEntity::CEntity
 // Render the model from the given camera
 // May request to render either normal or post-processed materials in the entity (defaults to normal)
 void CEntity::Render( CCamera* camera, bool postProcess /*= false*/ )
+{
+	CalculateMatrices();
+
+	// Render with absolute matrices
+	m_Template->Mesh()->Render( m_Matrices, camera, postProcess );
+}
+
+// Add draw packets for the entity to the given queue rather than rendering it. As Render,
+// calculates the world matrices first
+void CEntity::Queue( CDrawQueue* queue, CCamera* camera, bool postProcess /*= false*/ )
+{
+	CalculateMatrices();
+	m_Template->Mesh()->Queue( queue, m_Matrices, camera, postProcess );
+}
+
+// Calculate absolute world matrices from the relative node matrices and node hierarchy
+void CEntity::CalculateMatrices()
 {
 	// Get pointer to mesh to simplify code
 	CMesh* Mesh = m_Template->Mesh();
@@ -63,9 +80,6 @@ void CEntity::Render( CCamera* camera, bool postProcess /*= false*/ )
 	}
 	// Incorporate any bone<->mesh offsets (only relevant for skinning)
 	// Don't need this step for this exercise
-
-	// Render with absolute matrices
-	Mesh->Render( m_Matrices, camera, postProcess );
 }
 
 
@@ -194,11 +194,18 @@ public:
 	// May request to render either normal or post-processed materials in the entity (defaults to normal)
 	void Render( CCamera* camera, bool postProcess = false );
 
+	// Add draw packets for the entity to the given queue rather than rendering it. As Render,
+	// calculates the world matrices first
+	void Queue( CDrawQueue* queue, CCamera* camera, bool postProcess = false );
+
 
 /////////////////////////////////////
 //	Private interface
 private:
 
+	// Calculate absolute world matrices from the relative node matrices and node hierarchy
+	void CalculateMatrices();
+
 	// The template used by this entity - the common data for all entities of this type
 	CEntityTemplate* m_Template;
 
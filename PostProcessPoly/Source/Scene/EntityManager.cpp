@@ -113,6 +113,9 @@ TEntityUID CEntityManager::CreateEntity
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue( m_NextUID, entityIndex );
+
+	// Add any post-processed sub-meshes to the bucket
+	AddPostProcessItems( newEntity );
 	
 	m_IsEnumerating = false; // Cancel any entity enumeration (entity list has changed)
 
@@ -145,6 +148,9 @@ TEntityUID CEntityManager::CreatePlanet
 
 	// Add mapping from UID to entity index into hash map
 	m_EntityUIDMap->SetKeyValue( m_NextUID, entityIndex );
+
+	// Add any post-processed sub-meshes to the bucket
+	AddPostProcessItems( newEntity );
 	
 	m_IsEnumerating = false; // Cancel any entity enumeration (entity list has changed)
 
@@ -163,7 +169,8 @@ bool CEntityManager::DestroyEntity( TEntityUID UID )
 		return false;
 	}
 
-	// Delete the given entity and remove from UID map
+	// Delete the given entity and remove from UID map and post-process bucket
+	RemovePostProcessItems( m_Entities[entityIndex] );
 	delete m_Entities[entityIndex];
 	m_EntityUIDMap->RemoveKey( UID );
 
@@ -185,6 +192,7 @@ bool CEntityManager::DestroyEntity( TEntityUID UID )
 void CEntityManager::DestroyAllEntities()
 {
 	m_EntityUIDMap->RemoveAllKeys();
+	m_PostProcessItems.clear();
 	while (m_Entities.size())
 	{
 		delete m_Entities.back();
@@ -195,6 +203,51 @@ void CEntityManager::DestroyAllEntities()
 }
 
 
+/////////////////////////////////////
+// Post-process bucket
+
+// Add the post-processed sub-meshes of the given entity to the bucket
+void CEntityManager::AddPostProcessItems( CEntity* entity )
+{
+	CMesh* mesh = entity->Template()->Mesh();
+	for (TUInt32 subMesh = 0; subMesh < mesh->GetNumSubMeshes(); ++subMesh)
+	{
+		if (mesh->IsPostProcessSubMesh( subMesh ))
+		{
+			SPostProcessItem item = { entity, subMesh };
+			m_PostProcessItems.push_back( item );
+		}
+	}
+}
+
+// Remove the post-processed sub-meshes of the given entity from the bucket. The remaining items
+// stay in order of entity creation. That is not the order of the entity list once an entity has
+// been destroyed (DestroyEntity moves the last entity into the gap), so post-processed polygons,
+// queued in bucket order, may be drawn in a different order to a walk of the entity list
+void CEntityManager::RemovePostProcessItems( CEntity* entity )
+{
+	TUInt32 kept = 0;
+	for (TUInt32 item = 0; item < m_PostProcessItems.size(); ++item)
+	{
+		if (m_PostProcessItems[item].entity != entity)
+		{
+			m_PostProcessItems[kept++] = m_PostProcessItems[item];
+		}
+	}
+	m_PostProcessItems.resize( kept );
+}
+
+// Return a sub-mesh in the post-process bucket as the index of its entity in the entity list and
+// the sub-mesh number. The entity is found through the UID map, as its index changes when other
+// entities are destroyed
+void CEntityManager::GetPostProcessItem( TUInt32 item, TUInt32& entityIndex, TUInt32& subMesh )
+{
+	const SPostProcessItem& postProcessItem = m_PostProcessItems[item];
+	m_EntityUIDMap->LookUpKey( postProcessItem.entity->GetUID(), &entityIndex );
+	subMesh = postProcessItem.subMesh;
+}
+
+
 /////////////////////////////////////
 // Update / Rendering
 
@@ -228,6 +281,24 @@ void CEntityManager::RenderAllEntities( CCamera* camera, bool postProcess /*= fa
 	}
 }
 
+// Add draw packets for all entities visible from the given camera to a draw queue, to be sorted
+// and submitted by the caller. Either normal or post-processed materials are queued. Uses the
+// given number of threads, each queuing a range of entities into a list of its own
+void CEntityManager::QueueAllEntities( CDrawQueue* queue, CCamera* camera, bool postProcess /*= false*/,
+                                       TUInt32 numThreads /*= 1*/ )
+{
+	// A thread only writes to its own list and the entities of its own range, and only reads the
+	// shared camera and meshes
+	m_ThreadLists.Queue( queue, static_cast<TUInt32>(m_Entities.size()), numThreads,
+	                     [&]( CDrawQueue* list, TUInt32 firstEntity, TUInt32 endEntity )
+	{
+		for (TUInt32 entity = firstEntity; entity < endEntity; ++entity)
+		{
+			m_Entities[entity]->Queue( list, camera, postProcess );
+		}
+	} );
+}
+
 
 } // namespace gen
 
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <map>
+#include <vector>
 using namespace std;
 
 #include "Defines.h"
@@ -48,7 +49,7 @@ public:
 
 	// Create a base entity template with the given type, name and mesh. Returns the new entity
 	// template pointer
-	CEntityTemplate* CEntityManager::CreateTemplate
+	CEntityTemplate* CreateTemplate
 	(
 		const string& type,
 		const string& name,
@@ -216,6 +217,26 @@ public:
 	// May request to render either normal or post-processed materials in the entities (defaults to normal)
 	void RenderAllEntities( CCamera* camera, bool postProcess = false );
 
+	// Add draw packets for all entities visible from the given camera to a draw queue, to be sorted
+	// and submitted by the caller. Either normal or post-processed materials are queued.
+	// With more than one thread, the entities are split into contiguous ranges, one for each thread,
+	// and each range is culled, has its world matrices calculated and is queued into a list of its
+	// own. The lists are appended to the queue in range order, so the queue ends up with the same
+	// packets in the same order whatever the number of threads
+	void QueueAllEntities( CDrawQueue* queue, CCamera* camera, bool postProcess = false, TUInt32 numThreads = 1 );
+
+	/////////////////////////////////////
+	// Post-process bucket
+
+	// Return the number of sub-meshes in the post-process bucket, and one of them as the index of
+	// its entity in the entity list and the sub-mesh number. Scene snapshots copy the bucket, so
+	// the render can queue these sub-meshes without visiting every entity
+	TUInt32 NumPostProcessItems()
+	{
+		return static_cast<TUInt32>(m_PostProcessItems.size());
+	}
+	void GetPostProcessItem( TUInt32 item, TUInt32& entityIndex, TUInt32& subMesh );
+
 		
 /////////////////////////////////////
 //	Private interface
@@ -232,6 +253,22 @@ private:
 	typedef vector<CEntity*> TEntities;
 	typedef TEntities::iterator TEntityIter;
 
+	// A sub-mesh of an entity that uses a post-processed material
+	struct SPostProcessItem
+	{
+		CEntity* entity;
+		TUInt32  subMesh;
+	};
+	typedef vector<SPostProcessItem> TPostProcessItems;
+
+
+	/////////////////////////////////////
+	// Post-process bucket
+
+	// Add / remove the post-processed sub-meshes of the given entity to / from the bucket
+	void AddPostProcessItems( CEntity* entity );
+	void RemovePostProcessItems( CEntity* entity );
+
 
 	/////////////////////////////////////
 	// Template Data
@@ -254,6 +291,14 @@ private:
 	// Entity IDs are provided using a single increasing integer
 	TEntityUID m_NextUID;
 
+	// The post-process bucket - every entity sub-mesh with a post-processed material, in order of
+	// entity creation. Kept up to date as entities are created and destroyed, so a snapshot can
+	// copy it rather than search the entities' meshes
+	TPostProcessItems m_PostProcessItems;
+
+	// Draw lists of the threads used by QueueAllEntities
+	CThreadDrawLists m_ThreadLists;
+
 
 	/////////////////////////////////////
 	// Data for Entity Enumeration
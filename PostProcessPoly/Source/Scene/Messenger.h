@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <string.h>
 #include <map>
 using namespace std;
 
@@ -52,7 +53,7 @@ struct SMessage
 	{
 		struct
 		{
-			CVector3 pt;
+			TFloat32 pt[3]; // x, y, z - a CVector3 has constructors so standard C++ won't allow it here
 			TFloat32 distPt;
 		};
 		struct
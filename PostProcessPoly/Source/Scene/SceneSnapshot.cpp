@@ -0,0 +1,295 @@
+/*******************************************
+	SceneSnapshot.cpp
+
+	Copies of the scene state made by the
+	simulation each tick, and the handoff of
+	them to the render thread
+********************************************/
+
+#include <string.h>
+
+#include "SceneSnapshot.h"
+#include "CQuatTransform.h"
+
+namespace gen
+{
+
+/*-----------------------------------------------------------------------------------------
+	Scene snapshot
+-----------------------------------------------------------------------------------------*/
+
+CSceneSnapshot::CSceneSnapshot()
+{
+	m_Tick = 0;
+	m_Time = 0.0;
+}
+
+// Copy the entities and lights as they are after the given tick, which ended at the given
+// simulation time (in seconds)
+void CSceneSnapshot::Capture( CEntityManager& entities, CLight* const* lights, TUInt32 numLights,
+                              TUInt32 tick, TFloat64 time )
+{
+	m_Tick = tick;
+	m_Time = time;
+
+	// Relative matrices of all entities go in one list, each entity noting where its own start
+	m_Entities.clear();
+	m_Matrices.clear();
+	TUInt32 numEntities = entities.NumEntities();
+	m_Entities.reserve( numEntities );
+	for (TUInt32 index = 0; index < numEntities; ++index)
+	{
+		CEntity* entity = entities.GetEntityAtIndex( index );
+		SEntitySnapshot snapshot;
+		snapshot.UID = entity->GetUID();
+		snapshot.Mesh = entity->Template()->Mesh();
+		snapshot.FirstMatrix = static_cast<TUInt32>(m_Matrices.size());
+		m_Entities.push_back( snapshot );
+
+		TUInt32 numNodes = snapshot.Mesh->GetNumNodes();
+		for (TUInt32 node = 0; node < numNodes; ++node)
+		{
+			m_Matrices.push_back( entity->Matrix( node ) );
+		}
+	}
+
+	// The post-process bucket, by entity index
+	TUInt32 numPostProcessItems = entities.NumPostProcessItems();
+	m_PostProcessItems.resize( numPostProcessItems );
+	for (TUInt32 item = 0; item < numPostProcessItems; ++item)
+	{
+		entities.GetPostProcessItem( item, m_PostProcessItems[item].Entity, m_PostProcessItems[item].SubMesh );
+	}
+
+	m_Lights.resize( numLights );
+	for (TUInt32 light = 0; light < numLights; ++light)
+	{
+		m_Lights[light].Position = lights[light]->GetPosition();
+		m_Lights[light].Colour = lights[light]->GetColour();
+		m_Lights[light].Brightness = lights[light]->GetBrightness();
+	}
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Snapshot exchange
+-----------------------------------------------------------------------------------------*/
+
+CSnapshotExchange::CSnapshotExchange()
+{
+	Reset();
+}
+
+// Simulation thread: a snapshot to fill with the next tick, one the render thread is not using
+CSceneSnapshot& CSnapshotExchange::BeginWrite()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	m_Writing = 0;
+	while (m_Writing == m_Latest || m_Writing == m_ReadLatest || m_Writing == m_ReadPrevious)
+	{
+		++m_Writing;
+	}
+	return m_Snapshots[m_Writing];
+}
+
+// Simulation thread: make the snapshot from BeginWrite the latest
+void CSnapshotExchange::Publish()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	if (m_Writing < 0) return;
+
+	// A latest snapshot the render thread never took is dropped
+	if (m_Latest >= 0 && m_Latest != m_ReadLatest) ++m_Stats.Skipped;
+	m_Latest = m_Writing;
+	m_Writing = -1;
+	++m_Stats.Published;
+}
+
+// Render thread: take the latest snapshot, along with the one taken before it
+bool CSnapshotExchange::Acquire( const CSceneSnapshot*& previous, const CSceneSnapshot*& latest )
+{
+	lock_guard<mutex> lock( m_Mutex );
+	if (m_Latest < 0) return false;
+
+	if (m_Latest != m_ReadLatest)
+	{
+		m_ReadPrevious = (m_ReadLatest >= 0) ? m_ReadLatest : m_Latest;
+		m_ReadLatest = m_Latest;
+		++m_Stats.Taken;
+	}
+	previous = &m_Snapshots[m_ReadPrevious];
+	latest = &m_Snapshots[m_ReadLatest];
+	return true;
+}
+
+// Forget all snapshots. Only while neither thread is using the exchange
+void CSnapshotExchange::Reset()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	m_Writing = -1;
+	m_Latest = -1;
+	m_ReadLatest = -1;
+	m_ReadPrevious = -1;
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+}
+
+// Snapshots published and taken so far
+SSnapshotExchangeStats CSnapshotExchange::Stats()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return m_Stats;
+}
+
+
+/*-----------------------------------------------------------------------------------------
+	Snapshot frame
+-----------------------------------------------------------------------------------------*/
+
+CSnapshotFrame::CSnapshotFrame()
+{
+	m_Snapshot = 0;
+}
+
+// Interpolation factor (0-1) for rendering the given simulation time between two snapshots
+TFloat32 CSnapshotFrame::InterpolationFactor( const CSceneSnapshot& previous, const CSceneSnapshot& latest,
+                                              TFloat64 renderTime )
+{
+	TFloat64 span = latest.Time() - previous.Time();
+	if (span <= 0.0) return 1.0f;
+
+	TFloat64 t = (renderTime - previous.Time()) / span;
+	if (t < 0.0) return 0.0f;
+	if (t > 1.0) return 1.0f;
+	return static_cast<TFloat32>(t);
+}
+
+// Make the frame from two snapshots, the given fraction (0-1) of the way from the previous to
+// the latest, on up to the given number of threads
+void CSnapshotFrame::Build( const CSceneSnapshot& previous, const CSceneSnapshot& latest, TFloat32 t,
+                            TUInt32 numThreads /*= 1*/ )
+{
+	m_Snapshot = &latest;
+	m_WorldMatrices.resize( latest.NumMatrices() );
+	m_Visible.assign( latest.NumEntities(), 0 );
+	bool interpolate = (&previous != &latest && t < 1.0f);
+
+	// Entities are independent so are split between threads in contiguous ranges
+	TUInt32 numEntities = latest.NumEntities();
+	const TUInt32 kMinPerThread = 256;
+	if (numThreads > numEntities / kMinPerThread) numThreads = numEntities / kMinPerThread;
+	if (numThreads < 1) numThreads = 1;
+	ParallelForRanges( numEntities, numThreads, [&]( TUInt32 range, TUInt32 firstEntity, TUInt32 endEntity )
+	{
+		for (TUInt32 entity = firstEntity; entity < endEntity; ++entity)
+		{
+			const SEntitySnapshot& latestEntity = latest.Entity( entity );
+			const CMatrix4x4* latestMatrices = latest.Matrices( entity );
+			CMesh* mesh = latestEntity.Mesh;
+			TUInt32 numNodes = mesh->GetNumNodes();
+
+			// Interpolate from the previous snapshot only if it has the same entity in the same place
+			const CMatrix4x4* previousMatrices = 0;
+			if (interpolate && entity < previous.NumEntities() && previous.Entity( entity ).UID == latestEntity.UID)
+			{
+				previousMatrices = previous.Matrices( entity );
+			}
+
+			// Calculate absolute matrices from relative node matrices & node hierarchy, as
+			// CEntity::CalculateMatrices
+			CMatrix4x4* world = &m_WorldMatrices[latestEntity.FirstMatrix];
+			for (TUInt32 node = 0; node < numNodes; ++node)
+			{
+				CMatrix4x4 relative = latestMatrices[node];
+				if (previousMatrices &&
+				    memcmp( &previousMatrices[node], &latestMatrices[node], sizeof(CMatrix4x4) ) != 0)
+				{
+					CQuatTransform q0( previousMatrices[node] );
+					CQuatTransform q1( latestMatrices[node] );
+					if (q0.quat.Dot( q1.quat ) < 0.0f) q1.quat = -q1.quat; // Take the short way round
+					CQuatTransform qt;
+					NLerp( q0, q1, t, qt );
+					qt.GetMatrix( relative );
+				}
+
+				if (node == 0)
+				{
+					world[0] = relative;
+				}
+				else
+				{
+					world[node] = relative * world[mesh->GetNode( node ).parent];
+				}
+			}
+		}
+	} );
+
+	// Lights move little enough between ticks to lerp their positions
+	TUInt32 numLights = latest.NumLights();
+	m_LightPositions.resize( numLights );
+	for (TUInt32 light = 0; light < numLights; ++light)
+	{
+		m_LightPositions[light] = latest.Light( light ).Position;
+		if (interpolate && light < previous.NumLights())
+		{
+			m_LightPositions[light] = previous.Light( light ).Position * (1.0f - t) +
+			                          latest.Light( light ).Position * t;
+		}
+	}
+}
+
+// Add draw packets for the normal materials of the entities visible from the given camera to a
+// draw queue, noting which entities are visible. Each thread only writes the visibility of the
+// entities in its own range
+void CSnapshotFrame::Queue( CDrawQueue* queue, CCamera* camera, TUInt32 numThreads /*= 1*/ )
+{
+	if (!m_Snapshot) return;
+
+	const CSceneSnapshot& snapshot = *m_Snapshot;
+	m_ThreadLists.Queue( queue, snapshot.NumEntities(), numThreads,
+	                     [&]( CDrawQueue* list, TUInt32 firstEntity, TUInt32 endEntity )
+	{
+		for (TUInt32 entity = firstEntity; entity < endEntity; ++entity)
+		{
+			const SEntitySnapshot& entitySnapshot = snapshot.Entity( entity );
+			m_Visible[entity] = entitySnapshot.Mesh->Queue( list, &m_WorldMatrices[entitySnapshot.FirstMatrix], camera );
+		}
+	} );
+}
+
+// Add draw packets for the post-processed sub-meshes of the entities that were visible in the last
+// call to Queue, in the order of the post-process bucket
+void CSnapshotFrame::QueuePostProcess( CDrawQueue* queue, CCamera* camera )
+{
+	if (!m_Snapshot) return;
+
+	const CSceneSnapshot& snapshot = *m_Snapshot;
+	for (TUInt32 item = 0; item < snapshot.NumPostProcessItems(); ++item)
+	{
+		const SPostProcessSnapshot& postProcessItem = snapshot.PostProcessItem( item );
+		if (m_Visible[postProcessItem.Entity])
+		{
+			const SEntitySnapshot& entitySnapshot = snapshot.Entity( postProcessItem.Entity );
+			entitySnapshot.Mesh->QueueSubMesh( queue, postProcessItem.SubMesh, &m_WorldMatrices[entitySnapshot.FirstMatrix], camera );
+		}
+	}
+}
+
+// World matrix of the entity with the given UID. Returns false if it is not in the frame
+bool CSnapshotFrame::GetEntityMatrix( TEntityUID uid, CMatrix4x4& matrix )
+{
+	if (!m_Snapshot) return false;
+
+	for (TUInt32 entity = 0; entity < m_Snapshot->NumEntities(); ++entity)
+	{
+		const SEntitySnapshot& entitySnapshot = m_Snapshot->Entity( entity );
+		if (entitySnapshot.UID == uid)
+		{
+			matrix = m_WorldMatrices[entitySnapshot.FirstMatrix];
+			return true;
+		}
+	}
+	return false;
+}
+
+
+} // namespace gen
@@ -0,0 +1,295 @@
+/*******************************************
+	SceneSnapshot.h
+
+	Copies of the scene state made by the
+	simulation each tick, and the handoff of
+	them to the render thread
+********************************************/
+
+#pragma once
+
+#include <vector>
+#include <mutex>
+using namespace std;
+
+#include "Defines.h"
+#include "CVector3.h"
+#include "CMatrix4x4.h"
+#include "Colour.h"
+#include "Camera.h"
+#include "Light.h"
+#include "DrawQueue.h"
+#include "EntityManager.h"
+
+namespace gen
+{
+
+// An entity as it was at the end of a tick
+struct SEntitySnapshot
+{
+	TEntityUID UID;
+	CMesh*     Mesh;
+	TUInt32    FirstMatrix; // Relative matrices of its nodes start here in the snapshot's matrix list
+};
+
+// A sub-mesh with a post-processed material, from the entity manager's post-process bucket
+struct SPostProcessSnapshot
+{
+	TUInt32 Entity;  // Index of the entity in the snapshot
+	TUInt32 SubMesh;
+};
+
+// A light as it was at the end of a tick
+struct SLightSnapshot
+{
+	CVector3    Position;
+	SColourRGBA Colour;
+	TFloat32    Brightness;
+};
+
+
+// Everything the render needs from the simulation at the end of one tick: each entity's mesh and
+// the relative matrices of its nodes, the sub-meshes in the post-process bucket, and the lights. Filled by the simulation thread, then not
+// changed while the render thread can see it. Meshes are referred to, not copied, so templates
+// must not be destroyed while snapshots of their entities are in use.
+//
+// Capturing reuses the lists of the snapshot, so once they have grown to the size of the scene
+// no memory is allocated
+class CSceneSnapshot
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CSceneSnapshot();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSceneSnapshot( const CSceneSnapshot& );
+	CSceneSnapshot& operator=( const CSceneSnapshot& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Copy the entities and lights as they are after the given tick, which ended at the given
+	// simulation time (in seconds)
+	void Capture( CEntityManager& entities, CLight* const* lights, TUInt32 numLights, TUInt32 tick, TFloat64 time );
+
+	// Tick captured and the simulation time it ended at
+	TUInt32 Tick() const
+	{
+		return m_Tick;
+	}
+	TFloat64 Time() const
+	{
+		return m_Time;
+	}
+
+	// Entities, in the order of the entity manager
+	TUInt32 NumEntities() const
+	{
+		return static_cast<TUInt32>(m_Entities.size());
+	}
+	const SEntitySnapshot& Entity( TUInt32 entity ) const
+	{
+		return m_Entities[entity];
+	}
+
+	// Relative matrices of an entity's nodes, one for each node of its mesh
+	const CMatrix4x4* Matrices( TUInt32 entity ) const
+	{
+		return &m_Matrices[m_Entities[entity].FirstMatrix];
+	}
+
+	// Total matrices of all entities
+	TUInt32 NumMatrices() const
+	{
+		return static_cast<TUInt32>(m_Matrices.size());
+	}
+
+	// Sub-meshes with post-processed materials, in the order of the post-process bucket
+	TUInt32 NumPostProcessItems() const
+	{
+		return static_cast<TUInt32>(m_PostProcessItems.size());
+	}
+	const SPostProcessSnapshot& PostProcessItem( TUInt32 item ) const
+	{
+		return m_PostProcessItems[item];
+	}
+
+	// Lights
+	TUInt32 NumLights() const
+	{
+		return static_cast<TUInt32>(m_Lights.size());
+	}
+	const SLightSnapshot& Light( TUInt32 light ) const
+	{
+		return m_Lights[light];
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	TUInt32                 m_Tick;
+	TFloat64                m_Time;
+	vector<SEntitySnapshot> m_Entities;
+	vector<CMatrix4x4>      m_Matrices;
+	vector<SPostProcessSnapshot> m_PostProcessItems;
+	vector<SLightSnapshot>  m_Lights;
+};
+
+
+// Snapshots published and taken through a CSnapshotExchange
+struct SSnapshotExchangeStats
+{
+	TUInt32 Published; // Snapshots published by the simulation thread
+	TUInt32 Taken;     // Snapshots taken by the render thread
+	TUInt32 Skipped;   // Snapshots replaced by a newer one before the render thread took them
+};
+
+
+// Passes snapshots from the simulation thread to the render thread without either waiting for
+// the other. The simulation fills a snapshot the render thread can't see, then publishes it as
+// the latest. The render thread takes the latest when it starts a frame, and keeps the one it had
+// before as well to interpolate from. Four snapshots are enough for the one being written, the
+// latest published and the two held by the render thread to all be different.
+//
+// A lock is only held to swap indices, never while a snapshot is filled or read
+class CSnapshotExchange
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CSnapshotExchange();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSnapshotExchange( const CSnapshotExchange& );
+	CSnapshotExchange& operator=( const CSnapshotExchange& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Simulation thread: a snapshot to fill with the next tick, one the render thread is not
+	// using. It stays the caller's until Publish
+	CSceneSnapshot& BeginWrite();
+
+	// Simulation thread: make the snapshot from BeginWrite the latest
+	void Publish();
+
+	// Render thread: take the latest snapshot, along with the one taken before it (the same
+	// snapshot if there has only been one, or nothing new has been published since the last call
+	// and there was only one before). Both stay unchanged until the next call. Returns false if
+	// nothing has been published yet
+	bool Acquire( const CSceneSnapshot*& previous, const CSceneSnapshot*& latest );
+
+	// Forget all snapshots, e.g. when the simulation is restarted. Only while neither thread is
+	// using the exchange
+	void Reset();
+
+	// Snapshots published and taken so far
+	SSnapshotExchangeStats Stats();
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	static const TInt32 kNumSnapshots = 4;
+
+	CSceneSnapshot m_Snapshots[kNumSnapshots];
+
+	// Indices into m_Snapshots, -1 for none. All protected by the mutex
+	mutex   m_Mutex;
+	TInt32  m_Writing;      // Being filled by the simulation thread
+	TInt32  m_Latest;       // Latest published
+	TInt32  m_ReadLatest;   // Held by the render thread
+	TInt32  m_ReadPrevious;
+
+	SSnapshotExchangeStats m_Stats;
+};
+
+
+// The scene for one rendered frame, made from two snapshots. Each entity's node matrices are
+// interpolated between the snapshots (if the entity is in both) and combined into world matrices
+// as CEntity::CalculateMatrices does; the frame then queues draws for the entities using those
+// world matrices, which stay valid until the next Build. Queuing the scene notes which entities
+// are visible, so the post-processed sub-meshes can then be queued from the snapshot's copy of the
+// post-process bucket without testing every entity again.
+//
+// Matrices that are the same in both snapshots (most of a typical scene) are copied. Others are
+// split into rotation, position and scale, with the rotation interpolated by normalised lerp.
+// Entities are matched by position in the lists and UID, so an entity moved in the entity list
+// (when another is destroyed) is shown without interpolation for one tick
+class CSnapshotFrame
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CSnapshotFrame();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSnapshotFrame( const CSnapshotFrame& );
+	CSnapshotFrame& operator=( const CSnapshotFrame& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Interpolation factor (0-1) for rendering the given simulation time between two snapshots.
+	// Render a tick behind the simulation time so the time is between two complete ticks
+	static TFloat32 InterpolationFactor( const CSceneSnapshot& previous, const CSceneSnapshot& latest,
+	                                     TFloat64 renderTime );
+
+	// Make the frame from two snapshots, the given fraction (0-1) of the way from the previous to
+	// the latest, on up to the given number of threads. The snapshots must stay unchanged until
+	// the frame is finished with
+	void Build( const CSceneSnapshot& previous, const CSceneSnapshot& latest, TFloat32 t, TUInt32 numThreads = 1 );
+
+	// Add draw packets for the normal materials of the entities visible from the given camera to
+	// a draw queue, noting which entities are visible. Uses up to the given number of threads,
+	// with the same packets in the same order whatever the number
+	void Queue( CDrawQueue* queue, CCamera* camera, TUInt32 numThreads = 1 );
+
+	// Add draw packets for the post-processed sub-meshes of the entities that were visible in the
+	// last call to Queue, in the order of the post-process bucket. Only those sub-meshes are visited
+	void QueuePostProcess( CDrawQueue* queue, CCamera* camera );
+
+	// World matrix of the entity with the given UID. Returns false if it is not in the frame.
+	// A search through all entities, for the odd entity the render needs to know about
+	bool GetEntityMatrix( TEntityUID uid, CMatrix4x4& matrix );
+
+	// Position of a light in the frame
+	CVector3 LightPosition( TUInt32 light )
+	{
+		return m_LightPositions[light];
+	}
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	const CSceneSnapshot* m_Snapshot; // The latest snapshot the frame was built from
+	vector<CMatrix4x4>    m_WorldMatrices;
+	vector<TUInt8>        m_Visible;        // Whether each entity was visible in the last Queue
+	vector<CVector3>      m_LightPositions;
+
+	CThreadDrawLists      m_ThreadLists;
+};
+
+
+} // namespace gen
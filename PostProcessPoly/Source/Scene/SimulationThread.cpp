@@ -0,0 +1,132 @@
+/*******************************************
+	SimulationThread.cpp
+
+	Runs the scene simulation at a fixed tick
+	rate on its own thread, publishing a
+	snapshot of the scene after each tick
+********************************************/
+
+#include <string.h>
+#include <chrono>
+
+#include "SimulationThread.h"
+
+namespace gen
+{
+
+CSimulationThread::CSimulationThread()
+{
+	m_Simulation = 0;
+	m_Exchange = 0;
+	m_TickTime = 1.0f / 60.0f;
+	m_RealTime = true;
+	m_Stopping = false;
+	m_StartTime = 0;
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+}
+
+CSimulationThread::~CSimulationThread()
+{
+	Stop();
+}
+
+
+// Start ticking a simulation, publishing snapshots through the given exchange
+void CSimulationThread::Start( ISimulation* simulation, CSnapshotExchange* exchange, TFloat32 tickTime,
+                               bool realTime /*= true*/ )
+{
+	Stop();
+
+	m_Simulation = simulation;
+	m_Exchange = exchange;
+	m_TickTime = tickTime;
+	m_RealTime = realTime;
+	memset( &m_Stats, 0, sizeof(m_Stats) );
+
+	// The scene as it is now, so the render has a snapshot before the first tick
+	m_Exchange->Reset();
+	m_Simulation->Capture( m_Exchange->BeginWrite(), 0, 0.0 );
+	m_Exchange->Publish();
+
+	m_StartTime = Now();
+	m_Stopping = false;
+	m_Thread = thread( &CSimulationThread::SimulationThread, this );
+}
+
+// Stop the thread, waiting for the tick in progress to finish
+void CSimulationThread::Stop()
+{
+	if (!m_Thread.joinable()) return;
+
+	m_Stopping = true;
+	m_Thread.join();
+}
+
+
+// Current simulation time in seconds
+TFloat64 CSimulationThread::Time()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	if (!m_RealTime) return m_Stats.Ticks * static_cast<TFloat64>(m_TickTime);
+	return (Now() - m_StartTime) / 1000000.0;
+}
+
+// Ticks run so far
+SSimulationStats CSimulationThread::Stats()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	return m_Stats;
+}
+
+
+void CSimulationThread::SimulationThread()
+{
+	TUInt64 tickMicroseconds = static_cast<TUInt64>(m_TickTime * 1000000.0);
+	TUInt32 tick = 0;
+	while (!m_Stopping)
+	{
+		++tick;
+
+		if (m_RealTime)
+		{
+			// Wait until the tick is due, or if too far behind, drop ticks by moving the start later
+			TUInt64 now = Now();
+			m_Mutex.lock();
+			TUInt64 due = m_StartTime + tick * tickMicroseconds;
+			if (now > due + kMaxLateTicks * tickMicroseconds)
+			{
+				TUInt64 late = (now - due) / tickMicroseconds;
+				m_StartTime += late * tickMicroseconds;
+				m_Stats.DroppedTicks += static_cast<TUInt32>(late);
+				due = m_StartTime + tick * tickMicroseconds;
+			}
+			m_Mutex.unlock();
+
+			if (now < due)
+			{
+				this_thread::sleep_for( chrono::microseconds( due - now ) );
+				if (m_Stopping) break;
+			}
+		}
+
+		// Tick and publish the result. Simulation time counts ticks run, so it is unaffected by
+		// dropped ticks
+		TUInt64 busyStart = Now();
+		m_Simulation->Tick( m_TickTime );
+		m_Simulation->Capture( m_Exchange->BeginWrite(), tick, tick * static_cast<TFloat64>(m_TickTime) );
+		m_Exchange->Publish();
+		TUInt64 busyEnd = Now();
+
+		lock_guard<mutex> lock( m_Mutex );
+		++m_Stats.Ticks;
+		m_Stats.BusySeconds += (busyEnd - busyStart) / 1000000.0;
+	}
+}
+
+TUInt64 CSimulationThread::Now()
+{
+	return static_cast<TUInt64>(chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now().time_since_epoch() ).count());
+}
+
+
+} // namespace gen
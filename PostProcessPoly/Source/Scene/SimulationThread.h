@@ -0,0 +1,131 @@
+/*******************************************
+	SimulationThread.h
+
+	Runs the scene simulation at a fixed tick
+	rate on its own thread, publishing a
+	snapshot of the scene after each tick
+********************************************/
+
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+using namespace std;
+
+#include "Defines.h"
+#include "SceneSnapshot.h"
+
+namespace gen
+{
+
+// The simulation run by a CSimulationThread. Both functions are called on the simulation thread
+// only, so a simulation may use its scene freely as long as nothing else changes it while the
+// thread runs
+class ISimulation
+{
+public:
+	virtual ~ISimulation() {}
+
+	// Advance the simulation by one tick of the given length (in seconds)
+	virtual void Tick( TFloat32 tickTime ) = 0;
+
+	// Copy what the render needs into a snapshot, which is of the given tick ending at the given
+	// simulation time. Called once before the first tick too, as tick 0 at time 0
+	virtual void Capture( CSceneSnapshot& snapshot, TUInt32 tick, TFloat64 time ) = 0;
+};
+
+
+// Simulation ticks run by a CSimulationThread
+struct SSimulationStats
+{
+	TUInt32  Ticks;        // Ticks run
+	TUInt32  DroppedTicks; // Ticks not run in real time as the simulation fell too far behind
+	TFloat64 BusySeconds;  // Time spent ticking and capturing, i.e. not waiting for the next tick
+};
+
+
+// Ticks a simulation at a fixed rate on its own thread and publishes a snapshot through an
+// exchange after every tick, so the render thread never waits for the simulation or sees a scene
+// half way through an update.
+//
+// In real time, ticks are run when due by the wall clock. A simulation that can't keep up runs its
+// ticks back to back, but never more than a few ticks behind - any more are dropped and simulation
+// time slips behind the clock. Otherwise ticks run back to back as fast as they can, for measuring
+// simulation throughput
+class CSimulationThread
+{
+/*-----------------------------------------------------------------------------------------
+	Constructors/Destructors
+-----------------------------------------------------------------------------------------*/
+public:
+	CSimulationThread();
+	~CSimulationThread(); // Stops the thread
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSimulationThread( const CSimulationThread& );
+	CSimulationThread& operator=( const CSimulationThread& );
+
+
+/*-----------------------------------------------------------------------------------------
+	Public interface
+-----------------------------------------------------------------------------------------*/
+public:
+
+	// Start ticking a simulation, publishing snapshots through the given exchange, which is reset.
+	// A snapshot of the simulation as it is now is published before returning, so the render
+	// always has one. Stops any simulation already running first
+	void Start( ISimulation* simulation, CSnapshotExchange* exchange, TFloat32 tickTime, bool realTime = true );
+
+	// Stop the thread, waiting for the tick in progress to finish. The simulation may then be
+	// used on other threads again
+	void Stop();
+
+	bool IsRunning()
+	{
+		return m_Thread.joinable();
+	}
+
+	// Length of a tick in seconds
+	TFloat32 TickTime()
+	{
+		return m_TickTime;
+	}
+
+	// Current simulation time (in seconds) in real time: the time since Start, less any time
+	// dropped. Render one tick behind this so there are always snapshots either side. Otherwise
+	// the time of the last tick run
+	TFloat64 Time();
+
+	// Ticks run so far
+	SSimulationStats Stats();
+
+
+/*-----------------------------------------------------------------------------------------
+	Private interface
+-----------------------------------------------------------------------------------------*/
+private:
+	// Most ticks the simulation may fall behind in real time before ticks are dropped
+	static const TUInt32 kMaxLateTicks = 4;
+
+	void SimulationThread();
+
+	static TUInt64 Now(); // Microseconds
+
+	ISimulation*       m_Simulation;
+	CSnapshotExchange* m_Exchange;
+	TFloat32           m_TickTime;
+	bool               m_RealTime;
+
+	thread             m_Thread;
+	atomic<bool>       m_Stopping;
+
+	// Time tick 0 was at (moved later when ticks are dropped) and statistics, protected by the mutex
+	mutex              m_Mutex;
+	TUInt64            m_StartTime;
+	SSimulationStats   m_Stats;
+};
+
+
+} // namespace gen
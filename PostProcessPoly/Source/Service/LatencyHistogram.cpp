@@ -0,0 +1,108 @@
+/*******************************************
+	LatencyHistogram.cpp
+
+	Log-scale histogram of request latencies
+********************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "LatencyHistogram.h"
+
+namespace gen
+{
+
+CLatencyHistogram::CLatencyHistogram()
+{
+	Clear();
+}
+
+// Remove all values
+void CLatencyHistogram::Clear()
+{
+	memset( m_Buckets, 0, sizeof(m_Buckets) );
+	m_Count = 0;
+	m_Total = 0;
+	m_Max = 0;
+}
+
+// Record one latency
+void CLatencyHistogram::Add( TUInt64 microseconds )
+{
+	++m_Buckets[Bucket( microseconds )];
+	++m_Count;
+	m_Total += microseconds;
+	if (microseconds > m_Max) m_Max = microseconds;
+}
+
+// Add the counts of another histogram to this one
+void CLatencyHistogram::Merge( const CLatencyHistogram& other )
+{
+	for (TUInt32 i = 0; i < kNumBuckets; ++i)
+	{
+		m_Buckets[i] += other.m_Buckets[i];
+	}
+	m_Count += other.m_Count;
+	m_Total += other.m_Total;
+	if (other.m_Max > m_Max) m_Max = other.m_Max;
+}
+
+// Latency below which the given fraction (0->1) of values lie. Returns the top of the bucket
+// holding that value (but no more than the maximum), so errs on the high side
+TUInt64 CLatencyHistogram::Percentile( TFloat64 fraction ) const
+{
+	if (m_Count == 0) return 0;
+	TUInt64 rank = static_cast<TUInt64>(fraction * m_Count);
+	if (rank >= m_Count) rank = m_Count - 1;
+
+	TUInt64 seen = 0;
+	for (TUInt32 i = 0; i < kNumBuckets; ++i)
+	{
+		seen += m_Buckets[i];
+		if (seen > rank)
+		{
+			TUInt64 top = BucketTop( i );
+			return (top < m_Max) ? top : m_Max;
+		}
+	}
+	return m_Max;
+}
+
+// One line summary: count, mean and percentiles in milliseconds
+string CLatencyHistogram::Summary() const
+{
+	char text[256];
+	sprintf( text, "n %llu  mean %.3f  p50 %.3f  p90 %.3f  p99 %.3f  p99.9 %.3f  max %.3f ms",
+	         static_cast<unsigned long long>(m_Count), Mean() * 1e-3, Percentile( 0.5 ) * 1e-3,
+	         Percentile( 0.9 ) * 1e-3, Percentile( 0.99 ) * 1e-3, Percentile( 0.999 ) * 1e-3, m_Max * 1e-3 );
+	return text;
+}
+
+
+// Bucket for a latency: values below 4 have their own bucket, then each power of two 2^e is
+// split into four by the two bits below the top bit
+TUInt32 CLatencyHistogram::Bucket( TUInt64 microseconds )
+{
+	if (microseconds < 4) return static_cast<TUInt32>(microseconds);
+	if (microseconds >= (static_cast<TUInt64>(1) << 32)) return kNumBuckets - 1;
+
+	TUInt32 exponent = 2;
+	while ((microseconds >> (exponent + 1)) != 0)
+	{
+		++exponent;
+	}
+	TUInt32 quarter = static_cast<TUInt32>(microseconds >> (exponent - 2)) & 3;
+	return exponent * 4 - 4 + quarter;
+}
+
+// Largest latency that falls in a bucket
+TUInt64 CLatencyHistogram::BucketTop( TUInt32 bucket )
+{
+	if (bucket < 4) return bucket;
+	TUInt32 exponent = bucket / 4 + 1;
+	TUInt64 quarter = bucket % 4;
+	return ((4 + quarter + 1) << (exponent - 2)) - 1;
+}
+
+
+} // namespace gen
@@ -0,0 +1,65 @@
+/*******************************************
+	LatencyHistogram.h
+
+	Log-scale histogram of request latencies
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// Counts of latencies in microseconds, in buckets of roughly constant relative width: four
+// buckets per power of two, so any percentile is reported to within 25%. Fixed size, so adding
+// a value is constant time and never allocates. Not thread safe
+class CLatencyHistogram
+{
+public:
+	// Four sub-buckets per power of two from 4us up to 2^32us, plus exact buckets for 0->3us
+	static const TUInt32 kNumBuckets = 4 * 31;
+
+	CLatencyHistogram();
+
+	// Remove all values
+	void Clear();
+
+	// Record one latency
+	void Add( TUInt64 microseconds );
+
+	// Add the counts of another histogram to this one
+	void Merge( const CLatencyHistogram& other );
+
+	TUInt64 Count() const
+	{
+		return m_Count;
+	}
+	TUInt64 Max() const
+	{
+		return m_Max;
+	}
+	TFloat64 Mean() const
+	{
+		return (m_Count > 0) ? static_cast<TFloat64>(m_Total) / m_Count : 0.0;
+	}
+
+	// Latency below which the given fraction (0->1) of values lie. Returns the top of the bucket
+	// holding that value (but no more than the maximum), so errs on the high side
+	TUInt64 Percentile( TFloat64 fraction ) const;
+
+	// One line summary: count, mean and percentiles in milliseconds
+	string Summary() const;
+
+private:
+	static TUInt32 Bucket( TUInt64 microseconds );
+	static TUInt64 BucketTop( TUInt32 bucket );
+
+	TUInt64 m_Buckets[kNumBuckets];
+	TUInt64 m_Count;
+	TUInt64 m_Total;
+	TUInt64 m_Max;
+};
+
+
+} // namespace gen
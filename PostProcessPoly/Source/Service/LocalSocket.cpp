@@ -0,0 +1,222 @@
+/*******************************************
+	LocalSocket.cpp
+
+	Minimal blocking Unix domain socket layer
+	for the post-processing service
+********************************************/
+
+#include <string.h>
+
+#if defined(_WIN32)
+	#include <winsock2.h>
+	#include <afunix.h> // AF_UNIX is supported from Windows 10 1803
+	#include <io.h>
+#else
+	#include <errno.h>
+	#include <signal.h>
+	#include <unistd.h>
+	#include <poll.h>
+	#include <sys/socket.h>
+	#include <sys/un.h>
+#endif
+
+#include "LocalSocket.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Platform differences
+//-----------------------------------------------------------------------------
+
+#if defined(_WIN32)
+
+typedef SOCKET TNativeSocket;
+typedef int TTransferSize;
+
+inline void RemoveSocketFile( const string& path )
+{
+	_unlink( path.c_str() );
+}
+
+inline bool Interrupted()
+{
+	return false;
+}
+
+inline void CloseNative( TNativeSocket socket )
+{
+	closesocket( socket );
+}
+
+#else
+
+typedef int TNativeSocket;
+typedef size_t TTransferSize;
+
+inline void RemoveSocketFile( const string& path )
+{
+	unlink( path.c_str() );
+}
+
+inline bool Interrupted()
+{
+	return errno == EINTR;
+}
+
+inline void CloseNative( TNativeSocket socket )
+{
+	close( socket );
+}
+
+#endif
+
+inline TNativeSocket Native( TSocket socket )
+{
+	return static_cast<TNativeSocket>(socket);
+}
+
+// Fill a socket address for a path. Returns false if the path is too long
+bool LocalAddress( const string& path, sockaddr_un& address )
+{
+	memset( &address, 0, sizeof(address) );
+	address.sun_family = AF_UNIX;
+	if (path.empty() || path.length() >= sizeof(address.sun_path)) return false;
+	memcpy( address.sun_path, path.c_str(), path.length() );
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Sockets
+//-----------------------------------------------------------------------------
+
+// Initialise the socket library (Windows) and ignore broken pipe signals (POSIX), so a client
+// that disconnects mid-response gives an error rather than ending the process. Call once at
+// startup. Returns false on failure
+bool InitLocalSockets()
+{
+#if defined(_WIN32)
+	WSADATA data;
+	return WSAStartup( MAKEWORD( 2, 2 ), &data ) == 0;
+#else
+	signal( SIGPIPE, SIG_IGN );
+	return true;
+#endif
+}
+
+// Create a socket listening on the given path, replacing any stale socket file left there.
+// Returns kInvalidSocket on failure
+TSocket ListenLocal( const string& path, TUInt32 backlog )
+{
+	sockaddr_un address;
+	if (!LocalAddress( path, address )) return kInvalidSocket;
+
+	TSocket listener = static_cast<TSocket>(socket( AF_UNIX, SOCK_STREAM, 0 ));
+	if (listener == kInvalidSocket) return kInvalidSocket;
+
+	RemoveSocketFile( path );
+	if (bind( Native( listener ), reinterpret_cast<sockaddr*>(&address), sizeof(address) ) != 0 ||
+	    listen( Native( listener ), static_cast<int>(backlog) ) != 0)
+	{
+		CloseNative( Native( listener ) );
+		return kInvalidSocket;
+	}
+	return listener;
+}
+
+// Wait up to the timeout (milliseconds) for a connection on a listening socket. Returns
+// kInvalidSocket on timeout or error
+TSocket AcceptLocal( TSocket listener, TUInt32 timeout )
+{
+#if defined(_WIN32)
+	fd_set readable;
+	FD_ZERO( &readable );
+	FD_SET( Native( listener ), &readable );
+	timeval wait;
+	wait.tv_sec = timeout / 1000;
+	wait.tv_usec = (timeout % 1000) * 1000;
+	if (select( 0, &readable, 0, 0, &wait ) <= 0) return kInvalidSocket;
+#else
+	pollfd poller;
+	poller.fd = Native( listener );
+	poller.events = POLLIN;
+	poller.revents = 0;
+	if (poll( &poller, 1, static_cast<int>(timeout) ) <= 0) return kInvalidSocket;
+#endif
+	return static_cast<TSocket>(accept( Native( listener ), 0, 0 ));
+}
+
+// Connect to a listening socket. Returns kInvalidSocket on failure
+TSocket ConnectLocal( const string& path )
+{
+	sockaddr_un address;
+	if (!LocalAddress( path, address )) return kInvalidSocket;
+
+	TSocket connection = static_cast<TSocket>(socket( AF_UNIX, SOCK_STREAM, 0 ));
+	if (connection == kInvalidSocket) return kInvalidSocket;
+	if (connect( Native( connection ), reinterpret_cast<sockaddr*>(&address), sizeof(address) ) != 0)
+	{
+		CloseNative( Native( connection ) );
+		return kInvalidSocket;
+	}
+	return connection;
+}
+
+// Send or receive exactly the given number of bytes, retrying partial transfers. Return false
+// if the connection closes or fails first
+bool SendAll( TSocket socket, const void* data, size_t size )
+{
+	const char* bytes = static_cast<const char*>(data);
+	while (size > 0)
+	{
+		TTransferSize chunk = static_cast<TTransferSize>((size < 0x40000000) ? size : 0x40000000);
+		long sent = static_cast<long>(send( Native( socket ), bytes, chunk, 0 ));
+		if (sent <= 0)
+		{
+			if (sent < 0 && Interrupted()) continue;
+			return false;
+		}
+		bytes += sent;
+		size -= sent;
+	}
+	return true;
+}
+
+bool ReceiveAll( TSocket socket, void* data, size_t size )
+{
+	char* bytes = static_cast<char*>(data);
+	while (size > 0)
+	{
+		TTransferSize chunk = static_cast<TTransferSize>((size < 0x40000000) ? size : 0x40000000);
+		long received = static_cast<long>(recv( Native( socket ), bytes, chunk, 0 ));
+		if (received <= 0)
+		{
+			if (received < 0 && Interrupted()) continue;
+			return false;
+		}
+		bytes += received;
+		size -= received;
+	}
+	return true;
+}
+
+// Stop further transfers in both directions, waking any thread blocked on the socket
+void ShutdownSocket( TSocket socket )
+{
+#if defined(_WIN32)
+	shutdown( Native( socket ), SD_BOTH );
+#else
+	shutdown( Native( socket ), SHUT_RDWR );
+#endif
+}
+
+// Close the socket (and remove the socket file if given the path it listened on)
+void CloseSocket( TSocket socket, const string& listenPath )
+{
+	if (socket != kInvalidSocket) CloseNative( Native( socket ) );
+	if (!listenPath.empty()) RemoveSocketFile( listenPath );
+}
+
+
+} // namespace gen
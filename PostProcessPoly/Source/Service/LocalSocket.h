@@ -0,0 +1,48 @@
+/*******************************************
+	LocalSocket.h
+
+	Minimal blocking Unix domain socket layer
+	for the post-processing service
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+
+namespace gen
+{
+
+// A socket handle. Wide enough for both a Windows SOCKET and a POSIX file descriptor, with the
+// invalid value of each mapping to kInvalidSocket
+typedef size_t TSocket;
+const TSocket kInvalidSocket = static_cast<TSocket>(-1);
+
+// Initialise the socket library (Windows) and ignore broken pipe signals (POSIX), so a client
+// that disconnects mid-response gives an error rather than ending the process. Call once at
+// startup. Returns false on failure
+bool InitLocalSockets();
+
+// Create a socket listening on the given path, replacing any stale socket file left there.
+// Returns kInvalidSocket on failure
+TSocket ListenLocal( const string& path, TUInt32 backlog );
+
+// Wait up to the timeout (milliseconds) for a connection on a listening socket. Returns
+// kInvalidSocket on timeout or error
+TSocket AcceptLocal( TSocket listener, TUInt32 timeout );
+
+// Connect to a listening socket. Returns kInvalidSocket on failure
+TSocket ConnectLocal( const string& path );
+
+// Send or receive exactly the given number of bytes, retrying partial transfers. Return false
+// if the connection closes or fails first
+bool SendAll( TSocket socket, const void* data, size_t size );
+bool ReceiveAll( TSocket socket, void* data, size_t size );
+
+// Stop further transfers in both directions, waking any thread blocked on the socket
+void ShutdownSocket( TSocket socket );
+
+// Close the socket (and remove the socket file if given the path it listened on)
+void CloseSocket( TSocket socket, const string& listenPath = "" );
+
+
+} // namespace gen
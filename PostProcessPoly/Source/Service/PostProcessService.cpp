@@ -0,0 +1,478 @@
+/*******************************************
+	PostProcessService.cpp
+
+	Local service applying post-process chains
+	to frames sent over a Unix domain socket
+********************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+using namespace std;
+
+#include "PostProcessService.h"
+#include "Parallel.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Worker state
+//-----------------------------------------------------------------------------
+
+// State a worker keeps between requests. Filter parameters depend on the whole history of the
+// animation (the noise offset is random), so a frame's steps are found by replaying the animation
+// from frame 0. Keeping the animation lets consecutive frames of a sequence each cost one update
+struct SWorkerCache
+{
+	const void*         Chain;   // Chain entry the animation is for, 0 if none
+	TUInt32             Width;
+	TUInt32             Height;
+	TFloat32            FrameRate;
+	TFloat32            RipplePosition[2];
+	TUInt32             Frame;   // Frame the animation and steps are for
+	CFilterAnimation    Animation;
+	vector<SFilterStep> Steps;
+	CImage              Work[2]; // Reused between requests of the same size
+
+	SWorkerCache()
+	{
+		Chain = 0;
+	}
+};
+
+// Get the filter steps for a request, advancing or restarting the cached animation
+const vector<SFilterStep>& SelectSteps
+(
+	SWorkerCache&                cache,
+	const void*                  chainEntry,
+	const CFilterChain&          chain,
+	const SServiceRequestHeader& request
+)
+{
+	TFloat32 frameRate = (request.FrameRate > 0.0f) ? request.FrameRate : 60.0f;
+	TFloat32 rippleX = (request.RipplePosition[0] >= 0.0f) ? request.RipplePosition[0] : request.Width * 0.5f;
+	TFloat32 rippleY = (request.RipplePosition[1] >= 0.0f) ? request.RipplePosition[1] : request.Height * 0.5f;
+
+	if (cache.Chain != chainEntry || cache.Width != request.Width || cache.Height != request.Height ||
+	    cache.FrameRate != frameRate || cache.RipplePosition[0] != rippleX || cache.RipplePosition[1] != rippleY ||
+	    cache.Frame > request.Frame)
+	{
+		cache.Chain = chainEntry;
+		cache.Width = request.Width;
+		cache.Height = request.Height;
+		cache.FrameRate = frameRate;
+		cache.RipplePosition[0] = rippleX;
+		cache.RipplePosition[1] = rippleY;
+		cache.Frame = 0;
+		cache.Animation.Reset();
+		cache.Animation.StartRipple( rippleX, rippleY );
+		chain.SelectSteps( cache.Animation, request.Width, request.Height, cache.Steps );
+	}
+
+	// Same sequence of updates and selections as the batch tool
+	while (cache.Frame < request.Frame)
+	{
+		cache.Animation.Update( 1.0f / frameRate );
+		chain.SelectSteps( cache.Animation, request.Width, request.Height, cache.Steps );
+		++cache.Frame;
+	}
+	return cache.Steps;
+}
+
+
+//-----------------------------------------------------------------------------
+// Construction
+//-----------------------------------------------------------------------------
+
+CPostProcessService::CPostProcessService( const SServiceOptions& options )
+{
+	m_Options = options;
+	if (m_Options.Workers == 0) m_Options.Workers = 1;
+	if (m_Options.MaxBatch == 0) m_Options.MaxBatch = 1;
+	m_Stopping = false;
+	m_RejectedBusy = 0;
+	m_Connections = 0;
+
+	// Load every map up front as chains arrive at any time
+	LoadFilterMaps( m_Options.MapDirectory, 0, m_Maps );
+}
+
+CPostProcessService::~CPostProcessService()
+{
+	for (deque<SRequest*>::iterator request = m_Queue.begin(); request != m_Queue.end(); ++request)
+	{
+		delete *request;
+	}
+	for (map<string, SChainEntry*>::iterator chain = m_Chains.begin(); chain != m_Chains.end(); ++chain)
+	{
+		delete chain->second;
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Service
+//-----------------------------------------------------------------------------
+
+// Serve requests until stopped by Stop or a shutdown request. Returns false if the socket
+// could not be created
+bool CPostProcessService::Run()
+{
+	TSocket listener = ListenLocal( m_Options.SocketPath, m_Options.MaxConnections );
+	if (listener == kInvalidSocket) return false;
+
+	// Workers either run their filters single threaded, or share the hardware threads
+	TUInt32 filterThreads = m_Options.FilterThreads;
+	if (filterThreads == 0)
+	{
+		filterThreads = NumWorkerThreads() / m_Options.Workers;
+		if (filterThreads == 0) filterThreads = 1;
+	}
+	SetNumWorkerThreads( filterThreads );
+
+	vector<thread> workers;
+	for (TUInt32 i = 0; i < m_Options.Workers; ++i)
+	{
+		workers.push_back( thread( &CPostProcessService::WorkerThread, this ) );
+	}
+
+	// Accept connections, checking regularly for a stop request
+	while (!m_Stopping)
+	{
+		// Join the threads of connections that have closed
+		for (size_t i = 0; i < m_ActiveConnections.size();)
+		{
+			if (m_ActiveConnections[i]->Finished)
+			{
+				m_ActiveConnections[i]->Reader.join();
+				m_ActiveConnections.erase( m_ActiveConnections.begin() + i );
+			}
+			else
+			{
+				++i;
+			}
+		}
+
+		TSocket socket = AcceptLocal( listener, 100 );
+		if (socket == kInvalidSocket) continue;
+		if (m_ActiveConnections.size() >= m_Options.MaxConnections)
+		{
+			CloseSocket( socket );
+			continue;
+		}
+
+		shared_ptr<SConnection> connection( new SConnection );
+		connection->Socket = socket;
+		connection->Finished = false;
+		connection->Reader = thread( &CPostProcessService::ConnectionThread, this, connection );
+		m_ActiveConnections.push_back( connection );
+		lock_guard<mutex> lock( m_Mutex );
+		++m_Connections;
+	}
+	CloseSocket( listener, m_Options.SocketPath );
+
+	// Let the workers finish the current batch, then close the connections
+	{
+		lock_guard<mutex> lock( m_Mutex );
+		m_WorkAvailable.notify_all();
+	}
+	for (size_t i = 0; i < workers.size(); ++i)
+	{
+		workers[i].join();
+	}
+	for (size_t i = 0; i < m_ActiveConnections.size(); ++i)
+	{
+		ShutdownSocket( m_ActiveConnections[i]->Socket );
+		m_ActiveConnections[i]->Reader.join();
+	}
+	m_ActiveConnections.clear();
+	return true;
+}
+
+// Statistics for each chain used so far, as text
+string CPostProcessService::Statistics()
+{
+	lock_guard<mutex> lock( m_Mutex );
+	char line[256];
+	sprintf( line, "%llu connections, %llu requests refused as busy, %u queued\n",
+	         static_cast<unsigned long long>(m_Connections), static_cast<unsigned long long>(m_RejectedBusy),
+	         static_cast<TUInt32>(m_Queue.size()) );
+	string text = line;
+	for (map<string, SChainEntry*>::iterator it = m_Chains.begin(); it != m_Chains.end(); ++it)
+	{
+		const SChainEntry& chain = *it->second;
+		sprintf( line, "Chain \"%s\": %llu requests in %llu batches (mean %.2f), %llu refused\n",
+		         chain.Description.c_str(), static_cast<unsigned long long>(chain.Requests),
+		         static_cast<unsigned long long>(chain.Batches),
+		         (chain.Batches > 0) ? static_cast<TFloat64>(chain.Requests) / chain.Batches : 0.0,
+		         static_cast<unsigned long long>(chain.Rejected) );
+		text += line;
+		text += "  queue    " + chain.QueueTimes.Summary() + "\n";
+		text += "  process  " + chain.ProcessTimes.Summary() + "\n";
+		text += "  total    " + chain.TotalTimes.Summary() + "\n";
+	}
+	return text;
+}
+
+
+//-----------------------------------------------------------------------------
+// Connections
+//-----------------------------------------------------------------------------
+
+// Read requests from one connection and queue them. Runs until the client disconnects, sends
+// something invalid or the service stops
+void CPostProcessService::ConnectionThread( shared_ptr<SConnection> connection )
+{
+	SServiceRequestHeader header;
+	vector<char> chainText;
+	bool dropConnection = true; // Unless the client closes it cleanly
+	while (!m_Stopping)
+	{
+		if (!ReceiveAll( connection->Socket, &header, sizeof(header) ))
+		{
+			dropConnection = false;
+			break;
+		}
+		if (header.Magic != kServiceMagic) break;
+
+		if (header.Type == kRequestStats)
+		{
+			if (!RespondStatus( *connection, header.Id, kStatusOK, Statistics() )) break;
+			continue;
+		}
+		if (header.Type == kRequestShutdown)
+		{
+			RespondStatus( *connection, header.Id, kStatusOK, "" );
+			Stop();
+			dropConnection = false;
+			break;
+		}
+
+		// The rest of the message can't be skipped if the sizes are unreasonable, so the
+		// connection is dropped after the error
+		if (header.Type != kRequestProcess || header.ChainBytes > kServiceMaxChainBytes ||
+		    header.Width == 0 || header.Height == 0 || header.Width > kServiceMaxSize || header.Height > kServiceMaxSize)
+		{
+			RespondStatus( *connection, header.Id, kStatusBadRequest, "Invalid request" );
+			break;
+		}
+
+		SRequest* request = new SRequest;
+		request->Connection = connection;
+		request->Header = header;
+		chainText.resize( header.ChainBytes );
+		if ((header.ChainBytes > 0 && !ReceiveAll( connection->Socket, &chainText[0], header.ChainBytes )) ||
+		    !request->Frame.Create( header.Width, header.Height ) || !ReceivePixels( connection->Socket, request->Frame ))
+		{
+			delete request;
+			break;
+		}
+		request->ArrivalTime = Now();
+		string error;
+		request->Chain = FindChain( string( chainText.begin(), chainText.end() ), error );
+		if (!request->Chain)
+		{
+			bool sent = RespondStatus( *connection, header.Id, kStatusBadRequest, error );
+			delete request;
+			if (!sent) break;
+			continue;
+		}
+
+		// Refuse work beyond the queue limit rather than let latency grow without bound
+		bool queued = false;
+		{
+			lock_guard<mutex> lock( m_Mutex );
+			if (m_Queue.size() < m_Options.MaxQueue)
+			{
+				m_Queue.push_back( request );
+				m_WorkAvailable.notify_all();
+				queued = true;
+			}
+			else
+			{
+				++m_RejectedBusy;
+				++request->Chain->Rejected;
+			}
+		}
+		if (!queued)
+		{
+			delete request;
+			if (!RespondStatus( *connection, header.Id, kStatusBusy, "Queue full" )) break;
+		}
+	}
+
+	// After a clean close by the client, responses to queued requests are still sent (the
+	// workers hold their own references). Otherwise stop all transfers
+	if (dropConnection) ShutdownSocket( connection->Socket );
+	connection->Finished = true;
+}
+
+// Find or create the entry for a chain description. Returns 0 and sets the error if the
+// description is invalid (invalid chains are not kept, so they can't fill the table)
+CPostProcessService::SChainEntry* CPostProcessService::FindChain( const string& description, string& error )
+{
+	lock_guard<mutex> lock( m_Mutex );
+	map<string, SChainEntry*>::iterator found = m_Chains.find( description );
+	if (found != m_Chains.end()) return found->second;
+
+	SChainEntry* entry = new SChainEntry;
+	if (!entry->Chain.Parse( description, error ))
+	{
+		delete entry;
+		return 0;
+	}
+	entry->Description = description;
+	entry->Chain.SetMaps( m_Maps );
+	entry->Requests = 0;
+	entry->Batches = 0;
+	entry->Rejected = 0;
+	m_Chains[description] = entry;
+	return entry;
+}
+
+
+//-----------------------------------------------------------------------------
+// Workers
+//-----------------------------------------------------------------------------
+
+// Take the next batch of requests from the queue, waiting for work. Returns false when the
+// service is stopping
+bool CPostProcessService::NextBatch( vector<SRequest*>& batch )
+{
+	batch.clear();
+	unique_lock<mutex> lock( m_Mutex );
+	for (;;)
+	{
+		if (m_Stopping) return false;
+		if (m_Queue.empty())
+		{
+			m_WorkAvailable.wait_for( lock, chrono::milliseconds( 100 ) );
+			continue;
+		}
+
+		// Give the oldest request a short window to gather others with the same chain, unless a
+		// full batch is already waiting
+		SRequest* oldest = m_Queue.front();
+		TUInt32 matching = 0;
+		for (size_t i = 0; i < m_Queue.size() && matching < m_Options.MaxBatch; ++i)
+		{
+			if (m_Queue[i]->Chain == oldest->Chain) ++matching;
+		}
+		TUInt64 deadline = oldest->ArrivalTime + m_Options.BatchWindow;
+		TUInt64 now = Now();
+		if (matching < m_Options.MaxBatch && now < deadline)
+		{
+			m_WorkAvailable.wait_for( lock, chrono::microseconds( deadline - now ) );
+			continue; // Another worker may have taken it
+		}
+		break;
+	}
+
+	// Take the oldest request and the others for the same chain, in arrival order
+	SChainEntry* chain = m_Queue.front()->Chain;
+	for (deque<SRequest*>::iterator request = m_Queue.begin(); request != m_Queue.end() && batch.size() < m_Options.MaxBatch;)
+	{
+		if ((*request)->Chain == chain)
+		{
+			batch.push_back( *request );
+			request = m_Queue.erase( request );
+		}
+		else
+		{
+			++request;
+		}
+	}
+	return true;
+}
+
+// Process batches of requests until the service stops
+void CPostProcessService::WorkerThread()
+{
+	SWorkerCache cache;
+	vector<SRequest*> batch;
+	vector<TUInt64> queueTimes, processTimes;
+	while (NextBatch( batch ))
+	{
+		queueTimes.clear();
+		processTimes.clear();
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			SRequest& request = *batch[i];
+			TUInt64 start = Now();
+			const CFilterChain& chain = request.Chain->Chain;
+			const vector<SFilterStep>& steps = SelectSteps( cache, request.Chain, chain, request.Header );
+			const CImage* result;
+			bool success = CFilterChain::Run( steps, request.Frame, cache.Work[0], cache.Work[1], result );
+			TUInt64 end = Now();
+
+			SServiceResponseHeader response;
+			memset( &response, 0, sizeof(response) );
+			response.Magic = kServiceMagic;
+			response.Status = success ? kStatusOK : kStatusFailed;
+			response.Id = request.Header.Id;
+			response.Width = success ? result->Width() : 0;
+			response.Height = success ? result->Height() : 0;
+			response.BatchSize = static_cast<TUInt32>(batch.size());
+			response.QueueTime = static_cast<TUInt32>(start - request.ArrivalTime);
+			response.ProcessTime = static_cast<TUInt32>(end - start);
+			Respond( *request.Connection, response, success ? result : 0, success ? "" : "Filter failed" );
+
+			queueTimes.push_back( start - request.ArrivalTime );
+			processTimes.push_back( end - start );
+		}
+
+		lock_guard<mutex> lock( m_Mutex );
+		SChainEntry& chain = *batch[0]->Chain;
+		++chain.Batches;
+		chain.Requests += batch.size();
+		for (size_t i = 0; i < batch.size(); ++i)
+		{
+			chain.QueueTimes.Add( queueTimes[i] );
+			chain.ProcessTimes.Add( processTimes[i] );
+			chain.TotalTimes.Add( queueTimes[i] + processTimes[i] );
+			delete batch[i];
+		}
+	}
+}
+
+
+//-----------------------------------------------------------------------------
+// Support
+//-----------------------------------------------------------------------------
+
+// Send a response on a connection with optional pixels and text
+bool CPostProcessService::Respond
+(
+	SConnection&                  connection,
+	const SServiceResponseHeader& response,
+	const CImage*                 pixels,
+	const string&                 text
+)
+{
+	SServiceResponseHeader header = response;
+	header.TextBytes = static_cast<TUInt32>(text.length());
+
+	lock_guard<mutex> lock( connection.SendMutex );
+	return SendAll( connection.Socket, &header, sizeof(header) ) &&
+	       (!pixels || SendPixels( connection.Socket, *pixels )) &&
+	       (text.empty() || SendAll( connection.Socket, text.c_str(), text.length() ));
+}
+
+bool CPostProcessService::RespondStatus( SConnection& connection, TUInt32 id, EServiceStatus status, const string& text )
+{
+	SServiceResponseHeader response;
+	memset( &response, 0, sizeof(response) );
+	response.Magic = kServiceMagic;
+	response.Status = status;
+	response.Id = id;
+	return Respond( connection, response, 0, text );
+}
+
+TUInt64 CPostProcessService::Now()
+{
+	return static_cast<TUInt64>(chrono::duration_cast<chrono::microseconds>( chrono::steady_clock::now().time_since_epoch() ).count());
+}
+
+
+} // namespace gen
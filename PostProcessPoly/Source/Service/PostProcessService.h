@@ -0,0 +1,162 @@
+/*******************************************
+	PostProcessService.h
+
+	Local service applying post-process chains
+	to frames sent over a Unix domain socket
+********************************************/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+#include "FilterChain.h"
+#include "LocalSocket.h"
+#include "ServiceProtocol.h"
+#include "LatencyHistogram.h"
+
+namespace gen
+{
+
+struct SServiceOptions
+{
+	string  SocketPath;
+	TUInt32 Workers;        // Batches processed at once
+	TUInt32 FilterThreads;  // Threads each filter uses within a frame, 0 to share the hardware threads between workers
+	TUInt32 MaxBatch;       // Most requests processed in one batch
+	TUInt32 BatchWindow;    // Microseconds a request may wait for others with the same chain
+	TUInt32 MaxQueue;       // Requests waiting beyond this are refused as busy
+	TUInt32 MaxConnections;
+	string  MapDirectory;   // Noise / Burn / Distort maps, empty for procedural stand-ins
+
+	SServiceOptions()
+	{
+		Workers = 2;
+		FilterThreads = 0;
+		MaxBatch = 8;
+		BatchWindow = 1000;
+		MaxQueue = 64;
+		MaxConnections = 32;
+	}
+};
+
+
+// Accepts connections on a Unix domain socket and processes frames sent by clients. Requests are
+// queued and each worker takes the oldest along with any others waiting that use the same chain
+// (waiting briefly for more to arrive), so a batch shares one parsed chain, one set of filter
+// parameters where frames match and one worker's warm buffers. Latency statistics are kept for
+// each chain
+class CPostProcessService
+{
+public:
+	CPostProcessService( const SServiceOptions& options );
+	~CPostProcessService();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CPostProcessService( const CPostProcessService& );
+	CPostProcessService& operator=( const CPostProcessService& );
+
+public:
+	// Serve requests until stopped by Stop or a shutdown request. Returns false if the socket
+	// could not be created
+	bool Run();
+
+	// Ask the service to stop. Safe to call from any thread or a signal handler
+	void Stop()
+	{
+		m_Stopping = true;
+	}
+
+	// Statistics for each chain used so far, as text
+	string Statistics();
+
+
+private:
+	// One client connection, shared by its reader thread and the workers that send it responses
+	struct SConnection
+	{
+		TSocket      Socket;
+		mutex        SendMutex;
+		thread       Reader;
+		atomic<bool> Finished;
+
+		// Closed once the reader and any workers with responses to send have finished with it
+		~SConnection()
+		{
+			CloseSocket( Socket );
+		}
+	};
+
+	// Statistics and setup shared by all requests with one chain description
+	struct SChainEntry
+	{
+		string            Description;
+		CFilterChain      Chain;
+		TUInt64           Requests;  // Statistics are protected by the service mutex
+		TUInt64           Batches;
+		TUInt64           Rejected;
+		CLatencyHistogram QueueTimes;
+		CLatencyHistogram ProcessTimes;
+		CLatencyHistogram TotalTimes;
+	};
+
+	// A frame waiting to be processed
+	struct SRequest
+	{
+		shared_ptr<SConnection> Connection;
+		SServiceRequestHeader   Header;
+		SChainEntry*            Chain;
+		CImage                  Frame;
+		TUInt64                 ArrivalTime;
+	};
+
+	void ConnectionThread( shared_ptr<SConnection> connection );
+	void WorkerThread();
+
+	// Find or create the entry for a chain description. Returns 0 and sets the error if the
+	// description is invalid (invalid chains are not kept, so they can't fill the table)
+	SChainEntry* FindChain( const string& description, string& error );
+
+	// Take the next batch of requests from the queue, waiting for work. Returns false when the
+	// service is stopping
+	bool NextBatch( vector<SRequest*>& batch );
+
+	// Send a response on a connection with optional pixels and text
+	bool Respond
+	(
+		SConnection&                  connection,
+		const SServiceResponseHeader& response,
+		const CImage*                 pixels,
+		const string&                 text
+	);
+	bool RespondStatus( SConnection& connection, TUInt32 id, EServiceStatus status, const string& text );
+
+	static TUInt64 Now(); // Microseconds
+
+	SServiceOptions m_Options;
+	SFilterMaps     m_Maps;
+	atomic<bool>    m_Stopping;
+
+	// Queue and chain entries, protected by the mutex
+	mutex                       m_Mutex;
+	condition_variable          m_WorkAvailable;
+	deque<SRequest*>            m_Queue;
+	map<string, SChainEntry*>   m_Chains;
+	TUInt64                     m_RejectedBusy;
+	TUInt64                     m_Connections;
+
+	vector<shared_ptr<SConnection> > m_ActiveConnections; // Accept thread only
+};
+
+
+} // namespace gen
@@ -0,0 +1,143 @@
+/*******************************************
+	ServiceProtocol.cpp
+
+	Messages exchanged with the post-processing
+	service, and a client for it
+********************************************/
+
+#include <string.h>
+#include <vector>
+using namespace std;
+
+#include "ServiceProtocol.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Messages
+//-----------------------------------------------------------------------------
+
+// Send / receive the pixels of an image without row padding
+bool SendPixels( TSocket socket, const CImage& image )
+{
+	const size_t rowBytes = image.Width() * 4;
+	if (image.Pitch() == rowBytes)
+	{
+		return SendAll( socket, image.Row( 0 ), rowBytes * image.Height() );
+	}
+	for (TUInt32 y = 0; y < image.Height(); ++y)
+	{
+		if (!SendAll( socket, image.Row( y ), rowBytes )) return false;
+	}
+	return true;
+}
+
+bool ReceivePixels( TSocket socket, CImage& image )
+{
+	const size_t rowBytes = image.Width() * 4;
+	if (image.Pitch() == rowBytes)
+	{
+		return ReceiveAll( socket, image.Row( 0 ), rowBytes * image.Height() );
+	}
+	for (TUInt32 y = 0; y < image.Height(); ++y)
+	{
+		if (!ReceiveAll( socket, image.Row( y ), rowBytes )) return false;
+	}
+	return true;
+}
+
+
+//-----------------------------------------------------------------------------
+// Client
+//-----------------------------------------------------------------------------
+
+CServiceClient::CServiceClient()
+{
+	m_Socket = kInvalidSocket;
+}
+
+CServiceClient::~CServiceClient()
+{
+	Disconnect();
+}
+
+// Connect to the service listening on the given socket path. Returns false on failure
+bool CServiceClient::Connect( const string& path )
+{
+	Disconnect();
+	m_Socket = ConnectLocal( path );
+	return m_Socket != kInvalidSocket;
+}
+
+void CServiceClient::Disconnect()
+{
+	if (m_Socket != kInvalidSocket) CloseSocket( m_Socket );
+	m_Socket = kInvalidSocket;
+}
+
+// Send a frame to process with the given chain. Returns false if the connection failed
+bool CServiceClient::SendProcess
+(
+	TUInt32       id,
+	const string& chain,
+	const CImage& frame,
+	TUInt32       frameNumber /*= 0*/,
+	TFloat32      frameRate /*= 60.0f*/,
+	TFloat32      rippleX /*= -1.0f*/,
+	TFloat32      rippleY /*= -1.0f*/
+)
+{
+	SServiceRequestHeader request;
+	memset( &request, 0, sizeof(request) );
+	request.Magic = kServiceMagic;
+	request.Type = kRequestProcess;
+	request.Id = id;
+	request.Width = frame.Width();
+	request.Height = frame.Height();
+	request.Frame = frameNumber;
+	request.FrameRate = frameRate;
+	request.RipplePosition[0] = rippleX;
+	request.RipplePosition[1] = rippleY;
+	request.ChainBytes = static_cast<TUInt32>(chain.length());
+
+	return SendAll( m_Socket, &request, sizeof(request) ) &&
+	       (chain.empty() || SendAll( m_Socket, chain.c_str(), chain.length() )) &&
+	       SendPixels( m_Socket, frame );
+}
+
+// Send a request with no data (statistics or shutdown)
+bool CServiceClient::SendRequest( EServiceRequest type, TUInt32 id )
+{
+	SServiceRequestHeader request;
+	memset( &request, 0, sizeof(request) );
+	request.Magic = kServiceMagic;
+	request.Type = type;
+	request.Id = id;
+	return SendAll( m_Socket, &request, sizeof(request) );
+}
+
+// Receive the next response. Pixels are written to the result image and any text to the
+// text string. Returns false if the connection failed
+bool CServiceClient::Receive( SServiceResponseHeader& response, CImage& result, string& text )
+{
+	if (!ReceiveAll( m_Socket, &response, sizeof(response) ) || response.Magic != kServiceMagic) return false;
+
+	if (response.Width > 0 && response.Height > 0)
+	{
+		if (response.Width > kServiceMaxSize || response.Height > kServiceMaxSize) return false;
+		if (!result.Create( response.Width, response.Height ) || !ReceivePixels( m_Socket, result )) return false;
+	}
+
+	text.clear();
+	if (response.TextBytes > 0)
+	{
+		vector<char> buffer( response.TextBytes );
+		if (!ReceiveAll( m_Socket, &buffer[0], buffer.size() )) return false;
+		text.assign( buffer.begin(), buffer.end() );
+	}
+	return true;
+}
+
+
+} // namespace gen
@@ -0,0 +1,127 @@
+/*******************************************
+	ServiceProtocol.h
+
+	Messages exchanged with the post-processing
+	service, and a client for it
+********************************************/
+
+#pragma once
+
+#include "Defines.h"
+#include "Image.h"
+#include "LocalSocket.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Messages
+//-----------------------------------------------------------------------------
+
+// Messages are fixed size headers in native byte order (both ends are on the same machine),
+// each followed by variable length data as described below
+
+const TUInt32 kServiceMagic = 0x53505050;     // "PPPS"
+const TUInt32 kServiceMaxChainBytes = 4096;
+const TUInt32 kServiceMaxSize = 16384;        // Largest frame width or height
+
+enum EServiceRequest
+{
+	kRequestProcess,  // Process a frame
+	kRequestStats,    // Return the service statistics as text
+	kRequestShutdown, // Stop the service once current work is done
+};
+
+enum EServiceStatus
+{
+	kStatusOK,
+	kStatusBadRequest, // Unknown filter or invalid frame, see the response text
+	kStatusBusy,       // Too many requests queued, try again later
+	kStatusFailed,     // A filter failed (e.g. out of memory)
+};
+
+// Request header. A process request is followed by the chain description (ChainBytes of text,
+// as for CFilterChain::Parse), then Width * Height RGBA pixels with no row padding. The filter
+// parameters are those for the given frame of a sequence at the given frame rate, as computed by
+// the batch tool, with the ripple starting on frame 0 at the given position
+struct SServiceRequestHeader
+{
+	TUInt32  Magic;
+	TUInt32  Type;              // EServiceRequest
+	TUInt32  Id;                // Returned in the response, so requests may be pipelined
+	TUInt32  Width;
+	TUInt32  Height;
+	TUInt32  Frame;
+	TFloat32 FrameRate;
+	TFloat32 RipplePosition[2]; // In pixels, negative for the frame centre
+	TUInt32  ChainBytes;
+};
+
+// Response header. Followed by Width * Height RGBA pixels with no row padding (none unless the
+// status is OK for a process request), then TextBytes of text (statistics or an error message).
+// Responses on one connection may arrive in a different order to the requests
+struct SServiceResponseHeader
+{
+	TUInt32 Magic;
+	TUInt32 Status;      // EServiceStatus
+	TUInt32 Id;
+	TUInt32 Width;
+	TUInt32 Height;
+	TUInt32 BatchSize;   // Requests processed together with this one
+	TUInt32 QueueTime;   // Microseconds from arrival to processing
+	TUInt32 ProcessTime; // Microseconds processing
+	TUInt32 TextBytes;
+};
+
+// Send / receive the pixels of an image without row padding
+bool SendPixels( TSocket socket, const CImage& image );
+bool ReceivePixels( TSocket socket, CImage& image );
+
+
+//-----------------------------------------------------------------------------
+// Client
+//-----------------------------------------------------------------------------
+
+// A connection to the service. Requests can be sent ahead of reading their responses
+class CServiceClient
+{
+public:
+	CServiceClient();
+	~CServiceClient();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CServiceClient( const CServiceClient& );
+	CServiceClient& operator=( const CServiceClient& );
+
+public:
+	// Connect to the service listening on the given socket path. Returns false on failure
+	bool Connect( const string& path );
+
+	void Disconnect();
+
+	// Send a frame to process with the given chain. Returns false if the connection failed
+	bool SendProcess
+	(
+		TUInt32       id,
+		const string& chain,
+		const CImage& frame,
+		TUInt32       frameNumber = 0,
+		TFloat32      frameRate = 60.0f,
+		TFloat32      rippleX = -1.0f,
+		TFloat32      rippleY = -1.0f
+	);
+
+	// Send a request with no data (statistics or shutdown)
+	bool SendRequest( EServiceRequest type, TUInt32 id );
+
+	// Receive the next response. Pixels are written to the result image and any text to the
+	// text string. Returns false if the connection failed
+	bool Receive( SServiceResponseHeader& response, CImage& result, string& text );
+
+private:
+	TSocket m_Socket;
+};
+
+
+} // namespace gen
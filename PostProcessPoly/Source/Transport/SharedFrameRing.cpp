@@ -0,0 +1,555 @@
+/*******************************************
+	SharedFrameRing.cpp
+
+	Ring of frame slots in shared memory for
+	passing frames between processes
+********************************************/
+
+#include <string.h>
+#include <chrono>
+#include <new>
+using namespace std;
+
+#if defined(_WIN32)
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <limits.h>
+	#include <time.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/syscall.h>
+	#include <linux/futex.h>
+#endif
+
+#include "SharedFrameRing.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Constants
+//-----------------------------------------------------------------------------
+
+const TUInt32 kRingMagic = 0x474e5246; // "FRNG"
+const TUInt32 kRingVersion = 5; // 2: SFilterParams holds several ripples, 3: the FocusBlur settings, 4: LinearLight, 5: signal words
+const TUInt32 kRingPageSize = 4096;
+
+// Control block size, rounded up so the first slot is page aligned
+const TUInt32 kRingControlBytes = (sizeof(SRingControl) + kRingPageSize - 1) & ~(kRingPageSize - 1);
+
+inline size_t RoundToPage( size_t bytes )
+{
+	return (bytes + kRingPageSize - 1) & ~static_cast<size_t>(kRingPageSize - 1);
+}
+
+
+//-----------------------------------------------------------------------------
+// Platform layer
+//-----------------------------------------------------------------------------
+
+#if defined(_WIN32)
+
+// Named shared memory and auto-reset events for each direction. Events are named after the ring
+// so the other process can open them
+bool CreateMapping( const string& name, size_t size, bool create, void*& mapping, TUInt8*& memory )
+{
+	HANDLE handle;
+	if (create)
+	{
+		handle = CreateFileMappingA( INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, static_cast<DWORD>(static_cast<TUInt64>(size) >> 32),
+		                             static_cast<DWORD>(size), name.c_str() );
+	}
+	else
+	{
+		handle = OpenFileMappingA( FILE_MAP_ALL_ACCESS, FALSE, name.c_str() );
+	}
+	if (!handle) return false;
+
+	memory = static_cast<TUInt8*>(MapViewOfFile( handle, FILE_MAP_ALL_ACCESS, 0, 0, size ));
+	if (!memory)
+	{
+		CloseHandle( handle );
+		return false;
+	}
+	mapping = handle;
+	return true;
+}
+
+void DestroyMapping( const string&, bool, void* mapping, TUInt8* memory, size_t )
+{
+	UnmapViewOfFile( memory );
+	CloseHandle( static_cast<HANDLE>(mapping) );
+}
+
+void* CreateRingEvent( const string& name, bool create )
+{
+	return create ? CreateEventA( 0, FALSE, FALSE, name.c_str() ) : OpenEventA( EVENT_ALL_ACCESS, FALSE, name.c_str() );
+}
+
+void DestroyRingEvent( void* event )
+{
+	if (event) CloseHandle( static_cast<HANDLE>(event) );
+}
+
+// Size of an existing mapping, read from its control block
+bool MappingSize( const string& name, size_t& size )
+{
+	void* mapping;
+	TUInt8* memory;
+	if (!CreateMapping( name, sizeof(SRingControl), false, mapping, memory )) return false;
+	const SRingControl* control = reinterpret_cast<const SRingControl*>(memory);
+	bool valid = (control->Magic == kRingMagic && control->Version == kRingVersion);
+	size = kRingControlBytes + static_cast<size_t>(control->NumSlots) * control->SlotBytes;
+	DestroyMapping( name, false, mapping, memory, sizeof(SRingControl) );
+	return valid;
+}
+
+#else
+
+// POSIX shared memory object. Wake-ups use a futex on a signal word in the control block, which
+// works across processes as the futex is keyed on the physical page, so no other objects are needed
+string ShmName( const string& name )
+{
+	return (name[0] == '/') ? name : "/" + name;
+}
+
+bool CreateMapping( const string& name, size_t size, bool create, void*& mapping, TUInt8*& memory )
+{
+	int file;
+	if (create)
+	{
+		shm_unlink( ShmName( name ).c_str() ); // Remove any stale ring left by a crashed process
+		file = shm_open( ShmName( name ).c_str(), O_RDWR | O_CREAT | O_EXCL, 0600 );
+		if (file >= 0 && ftruncate( file, static_cast<off_t>(size) ) != 0)
+		{
+			close( file );
+			shm_unlink( ShmName( name ).c_str() );
+			return false;
+		}
+	}
+	else
+	{
+		file = shm_open( ShmName( name ).c_str(), O_RDWR, 0600 );
+	}
+	if (file < 0) return false;
+
+	void* address = mmap( 0, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0 );
+	close( file );
+	if (address == MAP_FAILED)
+	{
+		if (create) shm_unlink( ShmName( name ).c_str() );
+		return false;
+	}
+	memory = static_cast<TUInt8*>(address);
+	mapping = 0;
+	return true;
+}
+
+void DestroyMapping( const string& name, bool creator, void*, TUInt8* memory, size_t size )
+{
+	munmap( memory, size );
+	if (creator) shm_unlink( ShmName( name ).c_str() );
+}
+
+void* CreateRingEvent( const string&, bool )
+{
+	return 0;
+}
+
+void DestroyRingEvent( void* )
+{
+}
+
+bool MappingSize( const string& name, size_t& size )
+{
+	int file = shm_open( ShmName( name ).c_str(), O_RDONLY, 0600 );
+	if (file < 0) return false;
+	struct stat status;
+	bool success = (fstat( file, &status ) == 0 && status.st_size >= static_cast<off_t>(sizeof(SRingControl)));
+	close( file );
+	size = success ? static_cast<size_t>(status.st_size) : 0;
+	return success;
+}
+
+// Atomics are plain 32-bit words in memory so can be used as futexes directly
+int Futex( atomic<TUInt32>& word, int operation, TUInt32 value, const timespec* timeout )
+{
+	return static_cast<int>(syscall( SYS_futex, reinterpret_cast<TUInt32*>(&word), operation, value, timeout, 0, 0 ));
+}
+
+#endif
+
+
+//-----------------------------------------------------------------------------
+// Constructor / destructor
+//-----------------------------------------------------------------------------
+
+CSharedFrameRing::CSharedFrameRing()
+{
+	m_Control = 0;
+	m_Memory = 0;
+	m_Size = 0;
+	m_Creator = false;
+	m_Writing = false;
+	m_Reading = false;
+	m_Mapping = 0;
+	m_FrameEvent = 0;
+	m_SpaceEvent = 0;
+}
+
+CSharedFrameRing::~CSharedFrameRing()
+{
+	Destroy();
+}
+
+
+//-----------------------------------------------------------------------------
+// Setup
+//-----------------------------------------------------------------------------
+
+// Create a new ring with the given name and number of slots, each holding frames up to the
+// given size. Replaces any stale ring of the same name. The creator removes the name when
+// the ring is destroyed. Returns false on failure
+bool CSharedFrameRing::Create( const string& name, TUInt32 numSlots, TUInt32 maxWidth, TUInt32 maxHeight )
+{
+	Destroy();
+	if (name.empty() || numSlots == 0 || maxWidth == 0 || maxHeight == 0) return false;
+
+	// Pixel rows use the same padding as CImage, and pixels start on a page boundary
+	const TUInt32 pitch = (maxWidth * 4 + 15) & ~15u;
+	const TUInt32 headerBytes = static_cast<TUInt32>(RoundToPage( sizeof(SRingFrame) ));
+	const size_t slotBytes = headerBytes + RoundToPage( static_cast<size_t>(pitch) * maxHeight );
+	if (slotBytes > 0xffffffffu) return false;
+	const size_t size = kRingControlBytes + slotBytes * numSlots;
+
+	if (!CreateMapping( name, size, true, m_Mapping, m_Memory )) return false;
+	m_Size = size;
+	m_Name = name;
+	m_Creator = true;
+
+	m_Control = new (m_Memory) SRingControl;
+	m_Control->NumSlots = numSlots;
+	m_Control->MaxWidth = maxWidth;
+	m_Control->MaxHeight = maxHeight;
+	m_Control->Pitch = pitch;
+	m_Control->HeaderBytes = headerBytes;
+	m_Control->SlotBytes = static_cast<TUInt32>(slotBytes);
+	m_Control->Head = 0;
+	m_Control->ConsumerWaiting = 0;
+	m_Control->FrameSignal = 0;
+	m_Control->Tail = 0;
+	m_Control->ProducerWaiting = 0;
+	m_Control->SpaceSignal = 0;
+	m_Control->Closed = 0;
+	for (TUInt32 i = 0; i < numSlots; ++i)
+	{
+		new (Slot( i )) SRingFrame;
+	}
+
+	m_FrameEvent = CreateRingEvent( name + "_Frame", true );
+	m_SpaceEvent = CreateRingEvent( name + "_Space", true );
+#if defined(_WIN32)
+	if (!m_FrameEvent || !m_SpaceEvent)
+	{
+		Destroy();
+		return false;
+	}
+#endif
+
+	// Publish the magic number last so an opener never sees a half built ring
+	m_Control->Version = kRingVersion;
+	atomic_thread_fence( memory_order_release );
+	m_Control->Magic = kRingMagic;
+	return true;
+}
+
+// Open a ring created by another process. Returns false if it does not exist or is invalid
+bool CSharedFrameRing::Open( const string& name )
+{
+	Destroy();
+	size_t size;
+	if (name.empty() || !MappingSize( name, size )) return false;
+	if (!CreateMapping( name, size, false, m_Mapping, m_Memory )) return false;
+	m_Size = size;
+	m_Name = name;
+	m_Creator = false;
+	m_Control = reinterpret_cast<SRingControl*>(m_Memory);
+
+	if (m_Control->Magic != kRingMagic || m_Control->Version != kRingVersion ||
+	    size < kRingControlBytes + static_cast<size_t>(m_Control->NumSlots) * m_Control->SlotBytes)
+	{
+		Destroy();
+		return false;
+	}
+	atomic_thread_fence( memory_order_acquire );
+
+	m_FrameEvent = CreateRingEvent( name + "_Frame", false );
+	m_SpaceEvent = CreateRingEvent( name + "_Space", false );
+#if defined(_WIN32)
+	if (!m_FrameEvent || !m_SpaceEvent)
+	{
+		Destroy();
+		return false;
+	}
+#endif
+	return true;
+}
+
+// Unmap the ring (and remove the name if this process created it)
+void CSharedFrameRing::Destroy()
+{
+	if (m_Memory)
+	{
+		DestroyMapping( m_Name, m_Creator, m_Mapping, m_Memory, m_Size );
+	}
+	DestroyRingEvent( m_FrameEvent );
+	DestroyRingEvent( m_SpaceEvent );
+	m_Control = 0;
+	m_Memory = 0;
+	m_Size = 0;
+	m_Creator = false;
+	m_Writing = false;
+	m_Reading = false;
+	m_Mapping = 0;
+	m_FrameEvent = 0;
+	m_SpaceEvent = 0;
+}
+
+
+//-----------------------------------------------------------------------------
+// Producer
+//-----------------------------------------------------------------------------
+
+// Wait for a free slot and prepare it for a frame of the given size. The image becomes a view
+// of the slot's pixels to draw into. Returns 0 if the frame is too big, the ring is closed or
+// no slot came free within the timeout (milliseconds)
+SRingFrame* CSharedFrameRing::BeginWrite( TUInt32 width, TUInt32 height, CImage& pixels, TUInt32 timeout )
+{
+	if (!m_Control || m_Writing || width == 0 || height == 0 ||
+	    width > m_Control->MaxWidth || height > m_Control->MaxHeight)
+	{
+		return 0;
+	}
+
+	// Only this side writes the head so it can be read relaxed. The acquire on the tail makes
+	// sure the consumer has finished with a slot before it is reused
+	const TUInt32 head = m_Control->Head.load( memory_order_relaxed );
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds( timeout );
+	for (;;)
+	{
+		if (m_Control->Closed.load( memory_order_relaxed )) return 0;
+		TUInt32 tail = m_Control->Tail.load( memory_order_acquire );
+		if (head - tail < m_Control->NumSlots) break;
+
+		// Full: announce we are about to sleep, then check again in case the consumer released a
+		// slot before it could see the flag. All are sequentially consistent so one side always
+		// sees the other. The signal is read before the checks, so a release or close after them
+		// changes it and the futex wait returns at once
+		m_Control->ProducerWaiting.store( 1 );
+		const TUInt32 signal = m_Control->SpaceSignal.load();
+		tail = m_Control->Tail.load();
+		if (head - tail >= m_Control->NumSlots && !m_Control->Closed.load())
+		{
+			chrono::steady_clock::duration remaining = deadline - chrono::steady_clock::now();
+			if (remaining <= chrono::steady_clock::duration::zero())
+			{
+				m_Control->ProducerWaiting.store( 0 );
+				return 0;
+			}
+			Wait( m_Control->SpaceSignal, signal, m_SpaceEvent,
+			      static_cast<TUInt32>(chrono::duration_cast<chrono::milliseconds>( remaining ).count()) + 1 );
+		}
+		m_Control->ProducerWaiting.store( 0 );
+	}
+
+	SRingFrame* frame = Slot( head % m_Control->NumSlots );
+	frame->Index = head;
+	frame->Width = width;
+	frame->Height = height;
+	frame->Pitch = m_Control->Pitch;
+	frame->NumSteps = 0;
+	pixels.Attach( reinterpret_cast<TUInt8*>(frame) + m_Control->HeaderBytes, width, height, m_Control->Pitch );
+	m_Writing = true;
+	return frame;
+}
+
+// Store the filter steps for the frame being written. Returns false if there are too many
+bool CSharedFrameRing::SetSteps( SRingFrame* frame, const vector<SFilterStep>& steps )
+{
+	if (steps.size() > kMaxRingSteps) return false;
+	frame->NumSteps = static_cast<TUInt32>(steps.size());
+	for (size_t i = 0; i < steps.size(); ++i)
+	{
+		frame->Steps[i] = steps[i];
+		frame->Steps[i].Params.NoiseMap = 0;
+		frame->Steps[i].Params.BurnMap = 0;
+		frame->Steps[i].Params.DistortMap = 0;
+	}
+	return true;
+}
+
+// Publish the frame from BeginWrite to the consumer
+void CSharedFrameRing::EndWrite()
+{
+	if (!m_Writing) return;
+	m_Writing = false;
+
+	const TUInt32 head = m_Control->Head.load( memory_order_relaxed );
+	Slot( head % m_Control->NumSlots )->SubmitTime = RingTime();
+	m_Control->Head.store( head + 1 ); // Sequentially consistent - releases the slot contents
+	Wake( m_Control->FrameSignal, m_Control->ConsumerWaiting, m_FrameEvent );
+}
+
+// No more frames will be written. The consumer sees the remaining frames then end of stream
+void CSharedFrameRing::Close()
+{
+	if (!m_Control) return;
+	m_Control->Closed.store( 1 );
+
+	// Close moves neither index, so it is the signal bumps that stop a waiter which read its
+	// signal before the close from sleeping. Set both flags so the wake-up call is always made
+	m_Control->ConsumerWaiting.store( 1 );
+	m_Control->ProducerWaiting.store( 1 );
+	Wake( m_Control->FrameSignal, m_Control->ConsumerWaiting, m_FrameEvent );
+	Wake( m_Control->SpaceSignal, m_Control->ProducerWaiting, m_SpaceEvent );
+}
+
+
+//-----------------------------------------------------------------------------
+// Consumer
+//-----------------------------------------------------------------------------
+
+// Wait for the next frame. The image becomes a read-only view of the slot's pixels. Returns
+// 0 at end of stream or on timeout - use IsFinished to tell the difference
+const SRingFrame* CSharedFrameRing::BeginRead( CImage& pixels, TUInt32 timeout )
+{
+	if (!m_Control || m_Reading) return 0;
+
+	const TUInt32 tail = m_Control->Tail.load( memory_order_relaxed );
+	chrono::steady_clock::time_point deadline = chrono::steady_clock::now() + chrono::milliseconds( timeout );
+	for (;;)
+	{
+		TUInt32 head = m_Control->Head.load( memory_order_acquire );
+		if (head != tail) break;
+		if (m_Control->Closed.load())
+		{
+			// The producer may have published a last frame just before closing
+			if (m_Control->Head.load() == tail) return 0;
+			continue;
+		}
+
+		// Empty: same protocol as the producer in BeginWrite
+		m_Control->ConsumerWaiting.store( 1 );
+		const TUInt32 signal = m_Control->FrameSignal.load();
+		head = m_Control->Head.load();
+		if (head == tail && !m_Control->Closed.load())
+		{
+			chrono::steady_clock::duration remaining = deadline - chrono::steady_clock::now();
+			if (remaining <= chrono::steady_clock::duration::zero())
+			{
+				m_Control->ConsumerWaiting.store( 0 );
+				return 0;
+			}
+			Wait( m_Control->FrameSignal, signal, m_FrameEvent,
+			      static_cast<TUInt32>(chrono::duration_cast<chrono::milliseconds>( remaining ).count()) + 1 );
+		}
+		m_Control->ConsumerWaiting.store( 0 );
+	}
+
+	SRingFrame* frame = Slot( tail % m_Control->NumSlots );
+	pixels.Attach( reinterpret_cast<TUInt8*>(frame) + m_Control->HeaderBytes, frame->Width, frame->Height, frame->Pitch );
+	m_Reading = true;
+	return frame;
+}
+
+// Copy out the filter steps of a frame being read
+void CSharedFrameRing::GetSteps( const SRingFrame* frame, vector<SFilterStep>& steps ) const
+{
+	TUInt32 numSteps = (frame->NumSteps < kMaxRingSteps) ? frame->NumSteps : kMaxRingSteps;
+	steps.assign( frame->Steps, frame->Steps + numSteps );
+}
+
+// Return the slot from BeginRead to the producer. The image views must no longer be used
+void CSharedFrameRing::EndRead()
+{
+	if (!m_Reading) return;
+	m_Reading = false;
+
+	const TUInt32 tail = m_Control->Tail.load( memory_order_relaxed );
+	m_Control->Tail.store( tail + 1 );
+	Wake( m_Control->SpaceSignal, m_Control->ProducerWaiting, m_SpaceEvent );
+}
+
+// Whether the producer has closed the ring and every frame has been read
+bool CSharedFrameRing::IsFinished() const
+{
+	return m_Control && m_Control->Closed.load() &&
+	       m_Control->Head.load() == m_Control->Tail.load( memory_order_relaxed );
+}
+
+
+//-----------------------------------------------------------------------------
+// Support
+//-----------------------------------------------------------------------------
+
+// Time in nanoseconds from a clock shared by all processes on this machine
+TUInt64 CSharedFrameRing::RingTime()
+{
+#if defined(_WIN32)
+	// The performance counter is system wide
+	static LARGE_INTEGER frequency = { 0 };
+	if (frequency.QuadPart == 0) QueryPerformanceFrequency( &frequency );
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter( &counter );
+	return static_cast<TUInt64>(counter.QuadPart / frequency.QuadPart) * 1000000000u +
+	       static_cast<TUInt64>(counter.QuadPart % frequency.QuadPart) * 1000000000u / frequency.QuadPart;
+#else
+	timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return static_cast<TUInt64>(now.tv_sec) * 1000000000u + now.tv_nsec;
+#endif
+}
+
+SRingFrame* CSharedFrameRing::Slot( TUInt32 index ) const
+{
+	return reinterpret_cast<SRingFrame*>(m_Memory + kRingControlBytes + static_cast<size_t>(index) * m_Control->SlotBytes);
+}
+
+// Sleep until the word changes from the given value or is woken, or the timeout passes
+void CSharedFrameRing::Wait( atomic<TUInt32>& word, TUInt32 value, void* event, TUInt32 timeout )
+{
+#if defined(_WIN32)
+	(void)word;
+	(void)value;
+	// A stale signal from an earlier wake only causes an extra trip round the caller's loop
+	WaitForSingleObject( static_cast<HANDLE>(event), timeout );
+#else
+	(void)event;
+	// Returns at once if the word has already changed
+	timespec wait;
+	wait.tv_sec = timeout / 1000;
+	wait.tv_nsec = (timeout % 1000) * 1000000;
+	Futex( word, FUTEX_WAIT, value, &wait );
+#endif
+}
+
+// Bump the given signal word and wake the other side if it is asleep on it
+void CSharedFrameRing::Wake( atomic<TUInt32>& signal, atomic<TUInt32>& waiting, void* event )
+{
+	// Always bump the signal, after the change it announces, so a side about to sleep on the old
+	// value returns at once. Then a cheap check - most of the time nobody is waiting and there is
+	// no system call
+	signal.fetch_add( 1 );
+	if (!waiting.load() || !waiting.exchange( 0 )) return;
+#if defined(_WIN32)
+	SetEvent( static_cast<HANDLE>(event) );
+#else
+	(void)event;
+	Futex( signal, FUTEX_WAKE, INT_MAX, 0 );
+#endif
+}
+
+
+} // namespace gen
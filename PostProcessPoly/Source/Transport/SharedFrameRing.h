@@ -0,0 +1,196 @@
+/*******************************************
+	SharedFrameRing.h
+
+	Ring of frame slots in shared memory for
+	passing frames between processes
+********************************************/
+
+#pragma once
+
+#include <atomic>
+#include <vector>
+using namespace std;
+
+#include "Defines.h"
+#include "Image.h"
+#include "FilterChain.h"
+
+namespace gen
+{
+
+//-----------------------------------------------------------------------------
+// Shared layout
+//-----------------------------------------------------------------------------
+
+// Most filter steps one frame can carry
+const TUInt32 kMaxRingSteps = 16;
+
+// Header at the start of each slot, followed by the pixels. Written by the producer, read by the
+// consumer. The map pointers in the step parameters are not meaningful in the other process and
+// are cleared (see CFilterChain::AttachMaps)
+struct SRingFrame
+{
+	TUInt32     Index;      // Frame number set by the producer
+	TUInt32     Width;
+	TUInt32     Height;
+	TUInt32     Pitch;      // Bytes per row, the same for every frame in the ring
+	TUInt64     SubmitTime; // Producer's RingTime when the frame was published, for latency
+	TUInt32     NumSteps;
+	SFilterStep Steps[kMaxRingSteps];
+};
+
+// Control block at the start of the shared memory. Head and tail count frames since creation and
+// are written by one side each, on separate cache lines so the two processes do not contend for
+// one line. The waiting flags let the other side skip the wake-up call when nobody is asleep.
+// Each side sleeps on a signal word rather than an index: it is bumped by every change the
+// sleeper waits for - a publish or release, and a close, which moves neither index
+struct SRingControl
+{
+	TUInt32 Magic;
+	TUInt32 Version;
+	TUInt32 NumSlots;
+	TUInt32 MaxWidth;
+	TUInt32 MaxHeight;
+	TUInt32 Pitch;
+	TUInt32 HeaderBytes;  // Slot header size, rounded up so pixels start page aligned
+	TUInt32 SlotBytes;    // Header and pixels
+	TUInt8  Pad0[32];
+
+	atomic<TUInt32> Head;             // Frames published (producer writes)
+	atomic<TUInt32> ConsumerWaiting;
+	atomic<TUInt32> FrameSignal;      // Bumped on publish and close, the consumer sleeps on it
+	TUInt8          Pad1[52];
+
+	atomic<TUInt32> Tail;             // Frames released (consumer writes)
+	atomic<TUInt32> ProducerWaiting;
+	atomic<TUInt32> SpaceSignal;      // Bumped on release and close, the producer sleeps on it
+	TUInt8          Pad2[52];
+
+	atomic<TUInt32> Closed;           // Producer has finished
+};
+
+
+//-----------------------------------------------------------------------------
+// Ring
+//-----------------------------------------------------------------------------
+
+// A single producer, single consumer queue of frames in named shared memory. The producer fills
+// a slot in place and publishes it; the consumer processes it in place and releases it, so pixels
+// are never copied between the processes. Indices are lock-free, and a side only makes a system
+// call when it has to sleep (ring full or empty) or when the other side is asleep. Waits use a
+// futex on a signal word on Linux and named events on Windows. To scale post-processing across
+// processes, give each worker its own ring
+class CSharedFrameRing
+{
+public:
+	CSharedFrameRing();
+	~CSharedFrameRing();
+
+private:
+	// Disallow use of copy constructor and assignment operator (private and not defined)
+	CSharedFrameRing( const CSharedFrameRing& );
+	CSharedFrameRing& operator=( const CSharedFrameRing& );
+
+public:
+	/////////////////////////////////////
+	// Setup
+
+	// Create a new ring with the given name and number of slots, each holding frames up to the
+	// given size. Replaces any stale ring of the same name. The creator removes the name when
+	// the ring is destroyed. Returns false on failure
+	bool Create( const string& name, TUInt32 numSlots, TUInt32 maxWidth, TUInt32 maxHeight );
+
+	// Open a ring created by another process. Returns false if it does not exist or is invalid
+	bool Open( const string& name );
+
+	// Unmap the ring (and remove the name if this process created it)
+	void Destroy();
+
+	bool IsOpen() const
+	{
+		return m_Control != 0;
+	}
+
+	TUInt32 NumSlots() const
+	{
+		return m_Control->NumSlots;
+	}
+	TUInt32 MaxWidth() const
+	{
+		return m_Control->MaxWidth;
+	}
+	TUInt32 MaxHeight() const
+	{
+		return m_Control->MaxHeight;
+	}
+
+
+	/////////////////////////////////////
+	// Producer
+
+	// Wait for a free slot and prepare it for a frame of the given size. The image becomes a view
+	// of the slot's pixels to draw into. Returns 0 if the frame is too big, the ring is closed or
+	// no slot came free within the timeout (milliseconds)
+	SRingFrame* BeginWrite( TUInt32 width, TUInt32 height, CImage& pixels, TUInt32 timeout );
+
+	// Store the filter steps for the frame being written. Returns false if there are too many
+	bool SetSteps( SRingFrame* frame, const vector<SFilterStep>& steps );
+
+	// Publish the frame from BeginWrite to the consumer
+	void EndWrite();
+
+	// No more frames will be written. The consumer sees the remaining frames then end of stream
+	void Close();
+
+
+	/////////////////////////////////////
+	// Consumer
+
+	// Wait for the next frame. The image becomes a read-only view of the slot's pixels. Returns
+	// 0 at end of stream or on timeout - use IsFinished to tell the difference
+	const SRingFrame* BeginRead( CImage& pixels, TUInt32 timeout );
+
+	// Copy out the filter steps of a frame being read
+	void GetSteps( const SRingFrame* frame, vector<SFilterStep>& steps ) const;
+
+	// Return the slot from BeginRead to the producer. The image views must no longer be used
+	void EndRead();
+
+	// Whether the producer has closed the ring and every frame has been read
+	bool IsFinished() const;
+
+
+	/////////////////////////////////////
+	// Timing
+
+	// Time in nanoseconds from a clock shared by all processes on this machine
+	static TUInt64 RingTime();
+
+
+private:
+	SRingFrame* Slot( TUInt32 index ) const;
+
+	// Sleep until the word changes from the given value or is woken, or the timeout passes
+	void Wait( atomic<TUInt32>& word, TUInt32 value, void* event, TUInt32 timeout );
+
+	// Bump the given signal word and wake the other side if it is asleep on it
+	void Wake( atomic<TUInt32>& signal, atomic<TUInt32>& waiting, void* event );
+
+	SRingControl* m_Control;
+	TUInt8*       m_Memory;
+	size_t        m_Size;
+	bool          m_Creator;
+	string        m_Name;
+
+	// Slot claimed by BeginWrite / BeginRead, if any
+	bool          m_Writing;
+	bool          m_Reading;
+
+	// Platform handles (events are only used on Windows)
+	void*         m_Mapping;
+	void*         m_FrameEvent;  // Signalled when a frame is published
+	void*         m_SpaceEvent;  // Signalled when a slot is released
+};
+
+
+} // namespace gen